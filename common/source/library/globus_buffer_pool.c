@@ -0,0 +1,810 @@
+/*
+ * Copyright 1999-2006 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/**
+ * @file globus_buffer_pool.c
+ * @brief Buffer Pool Implementation
+ *
+ * A magazine allocator: each cache holds a loaded and a previous
+ * magazine of free blocks, and swaps them, or trades one with the depot,
+ * when the loaded one runs empty on a get or full on a put.  Threads are
+ * numbered the first time they use any pool and use the cache their
+ * number maps to, so with no more threads than caches each thread has one
+ * to itself.
+ */
+#endif /* GLOBUS_DONT_DOCUMENT_INTERNAL */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "globus_i_common_config.h"
+#include "globus_buffer_pool.h"
+#include "globus_libc.h"
+#include "globus_thread.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_GETCPU
+#include <sched.h>
+#endif
+
+#define GLOBUS_L_BUFFER_POOL_CACHE_LINE         64
+#define GLOBUS_L_BUFFER_POOL_HUGE_PAGE          (2 * 1024 * 1024)
+/* bytes of blocks one magazine may hold, so per-thread caches of large
+ * data buffers stay small
+ */
+#define GLOBUS_L_BUFFER_POOL_MAGAZINE_BYTES     (1024 * 1024)
+#define GLOBUS_L_BUFFER_POOL_MAGAZINE_MAX       32
+#define GLOBUS_L_BUFFER_POOL_MAX_CACHES         64
+#define GLOBUS_L_BUFFER_POOL_MAX_NODES          8
+
+typedef struct globus_l_buffer_pool_magazine_s
+{
+    struct globus_l_buffer_pool_magazine_s *    next;
+    int                                         rounds;
+    void *                                      blocks[1];
+} globus_l_buffer_pool_magazine_t;
+
+typedef struct
+{
+    globus_mutex_t                              lock;
+    globus_l_buffer_pool_magazine_t *           loaded;
+    globus_l_buffer_pool_magazine_t *           previous;
+    globus_size_t                               gets;
+    globus_size_t                               puts;
+    globus_size_t                               hits;
+} globus_l_buffer_pool_cache_t;
+
+struct globus_buffer_pool_s
+{
+    globus_size_t                               block_size;
+    globus_size_t                               alignment;
+    int                                         flags;
+    int                                         magazine_size;
+    int                                         high_water;
+    int                                         ncaches;
+    /* created on first use */
+    globus_l_buffer_pool_cache_t **             caches;
+
+    /* everything below is protected by lock */
+    globus_mutex_t                              lock;
+    globus_l_buffer_pool_magazine_t *           full[GLOBUS_L_BUFFER_POOL_MAX_NODES];
+    globus_l_buffer_pool_magazine_t *           empty;
+    int                                         depot_blocks;
+    /* gets and puts which could not use a cache */
+    globus_size_t                               gets;
+    globus_size_t                               puts;
+    globus_size_t                               depot_hits;
+    globus_size_t                               misses;
+    globus_size_t                               allocated;
+    globus_size_t                               peak;
+    globus_size_t                               trimmed;
+};
+
+static globus_thread_key_t                      globus_l_buffer_pool_thread_key;
+static int                                      globus_l_buffer_pool_threads;
+static int                                      globus_l_buffer_pool_ncpus = 1;
+static globus_size_t                            globus_l_buffer_pool_page_size =
+                                                    4096;
+
+globus_bool_t
+globus_i_buffer_pool_pre_activate(void)
+{
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    long                                        ncpus;
+
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(ncpus > 0)
+    {
+        globus_l_buffer_pool_ncpus = ncpus;
+    }
+#endif
+#if defined(HAVE_UNISTD_H) && defined(_SC_PAGESIZE)
+    if(sysconf(_SC_PAGESIZE) > 0)
+    {
+        globus_l_buffer_pool_page_size = sysconf(_SC_PAGESIZE);
+    }
+#endif
+
+    return (globus_thread_key_create(
+        &globus_l_buffer_pool_thread_key, NULL) == 0);
+}
+
+static
+int
+globus_l_buffer_pool_node(
+    struct globus_buffer_pool_s *               s_pool)
+{
+#ifdef HAVE_GETCPU
+    unsigned int                                cpu;
+    unsigned int                                node;
+
+    if((s_pool->flags & GLOBUS_BUFFER_POOL_NUMA_LOCAL) &&
+        getcpu(&cpu, &node) == 0)
+    {
+        return node % GLOBUS_L_BUFFER_POOL_MAX_NODES;
+    }
+#endif
+
+    return 0;
+}
+
+static
+globus_l_buffer_pool_cache_t *
+globus_l_buffer_pool_cache(
+    struct globus_buffer_pool_s *               s_pool)
+{
+    globus_l_buffer_pool_cache_t *              cache;
+    intptr_t                                    id;
+    int                                         ndx;
+
+    id = (intptr_t) globus_thread_getspecific(globus_l_buffer_pool_thread_key);
+    if(id == 0)
+    {
+        id = __atomic_add_fetch(
+            &globus_l_buffer_pool_threads, 1, __ATOMIC_RELAXED);
+        globus_thread_setspecific(
+            globus_l_buffer_pool_thread_key, (void *) id);
+    }
+    ndx = (id - 1) & (s_pool->ncaches - 1);
+
+    cache = __atomic_load_n(&s_pool->caches[ndx], __ATOMIC_ACQUIRE);
+    if(cache == NULL)
+    {
+        globus_mutex_lock(&s_pool->lock);
+        cache = s_pool->caches[ndx];
+        if(cache == NULL)
+        {
+            cache = globus_calloc(1, sizeof(globus_l_buffer_pool_cache_t));
+            if(cache != NULL)
+            {
+                globus_mutex_init(&cache->lock, NULL);
+                __atomic_store_n(
+                    &s_pool->caches[ndx], cache, __ATOMIC_RELEASE);
+            }
+        }
+        globus_mutex_unlock(&s_pool->lock);
+    }
+
+    return cache;
+}
+
+static
+globus_l_buffer_pool_magazine_t *
+globus_l_buffer_pool_magazine_create(
+    struct globus_buffer_pool_s *               s_pool)
+{
+    globus_l_buffer_pool_magazine_t *           mag;
+
+    mag = globus_malloc(sizeof(globus_l_buffer_pool_magazine_t) +
+        sizeof(void *) * (s_pool->magazine_size - 1));
+    if(mag != NULL)
+    {
+        mag->next = NULL;
+        mag->rounds = 0;
+    }
+
+    return mag;
+}
+
+static
+void *
+globus_l_buffer_pool_block_alloc(
+    struct globus_buffer_pool_s *               s_pool)
+{
+    void *                                      block;
+    globus_size_t                               off;
+
+#ifdef HAVE_POSIX_MEMALIGN
+    if(posix_memalign(&block, s_pool->alignment, s_pool->block_size) != 0)
+    {
+        return NULL;
+    }
+#else
+    block = globus_malloc(s_pool->block_size);
+    if(block == NULL)
+    {
+        return NULL;
+    }
+#endif
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_HUGEPAGE)
+    if(s_pool->flags & GLOBUS_BUFFER_POOL_HUGE_PAGES)
+    {
+        madvise(block, s_pool->block_size, MADV_HUGEPAGE);
+    }
+#endif
+    if(s_pool->flags & GLOBUS_BUFFER_POOL_NUMA_LOCAL)
+    {
+        /* pages are placed on the node of the thread that first touches
+         * them, which should be this one rather than whoever fills it
+         */
+        for(off = 0;
+            off < s_pool->block_size;
+            off += globus_l_buffer_pool_page_size)
+        {
+            ((volatile char *) block)[off] = 0;
+        }
+    }
+
+    return block;
+}
+
+static
+void
+globus_l_buffer_pool_magazines_free(
+    globus_l_buffer_pool_magazine_t *           mag)
+{
+    globus_l_buffer_pool_magazine_t *           next;
+
+    for(; mag != NULL; mag = next)
+    {
+        next = mag->next;
+        while(mag->rounds > 0)
+        {
+            free(mag->blocks[--mag->rounds]);
+        }
+        globus_free(mag);
+    }
+}
+
+/*
+ * called locked.  moves full magazines beyond the high water mark onto
+ * *trim for the caller to free once unlocked
+ */
+static
+void
+globus_l_buffer_pool_trim_depot(
+    struct globus_buffer_pool_s *               s_pool,
+    int                                         high_water,
+    globus_l_buffer_pool_magazine_t **          trim)
+{
+    globus_l_buffer_pool_magazine_t *           mag;
+    int                                         node = 0;
+
+    while(s_pool->depot_blocks > high_water)
+    {
+        while(s_pool->full[node] == NULL)
+        {
+            node++;
+        }
+        mag = s_pool->full[node];
+        s_pool->full[node] = mag->next;
+        s_pool->depot_blocks -= mag->rounds;
+        s_pool->allocated -= mag->rounds;
+        s_pool->trimmed += mag->rounds;
+        mag->next = *trim;
+        *trim = mag;
+    }
+}
+
+/**
+ * @brief Initialize a buffer pool
+ * @ingroup globus_buffer_pool
+ * @details
+ * Initialize a pool of blocks of block_size bytes, allocating
+ * initial_count of them up front.
+ *
+ * @param pool
+ *        The pool to initialize
+ * @param block_size
+ *        The size of the blocks returned by globus_buffer_pool_get().  It is
+ *        rounded up to the block alignment: a cache line, or a page with
+ *        GLOBUS_BUFFER_POOL_PAGE_ALIGNED.
+ * @param initial_count
+ *        The number of blocks to allocate now.
+ * @param high_water
+ *        The number of free blocks the depot may hold before the excess is
+ *        released to the system, or 0 for no limit.  Blocks cached by
+ *        threads do not count against it.
+ * @param flags
+ *        A bitwise or of globus_buffer_pool_flags_t values.
+ * @return
+ *        GLOBUS_SUCCESS, or GLOBUS_FAILURE if memory could not be allocated.
+ */
+int
+globus_buffer_pool_init(
+    globus_buffer_pool_t *                      pool,
+    globus_size_t                               block_size,
+    int                                         initial_count,
+    int                                         high_water,
+    int                                         flags)
+{
+    struct globus_buffer_pool_s *               s_pool;
+    globus_l_buffer_pool_magazine_t *           mag = NULL;
+    void *                                      block;
+    int                                         node;
+
+    globus_assert(pool != NULL && block_size > 0);
+
+    s_pool = globus_calloc(1, sizeof(struct globus_buffer_pool_s));
+    if(s_pool == NULL)
+    {
+        goto error_pool;
+    }
+
+    if(flags & GLOBUS_BUFFER_POOL_HUGE_PAGES)
+    {
+        flags |= GLOBUS_BUFFER_POOL_PAGE_ALIGNED;
+    }
+    if((flags & GLOBUS_BUFFER_POOL_HUGE_PAGES) &&
+        block_size >= GLOBUS_L_BUFFER_POOL_HUGE_PAGE)
+    {
+        s_pool->alignment = GLOBUS_L_BUFFER_POOL_HUGE_PAGE;
+    }
+    else if(flags & GLOBUS_BUFFER_POOL_PAGE_ALIGNED)
+    {
+        s_pool->alignment = globus_l_buffer_pool_page_size;
+    }
+    else
+    {
+        s_pool->alignment = GLOBUS_L_BUFFER_POOL_CACHE_LINE;
+    }
+    s_pool->block_size = (block_size + s_pool->alignment - 1) &
+        ~(s_pool->alignment - 1);
+    s_pool->flags = flags;
+    s_pool->high_water = high_water;
+
+    s_pool->magazine_size =
+        GLOBUS_L_BUFFER_POOL_MAGAZINE_BYTES / s_pool->block_size;
+    if(s_pool->magazine_size < 1)
+    {
+        s_pool->magazine_size = 1;
+    }
+    else if(s_pool->magazine_size > GLOBUS_L_BUFFER_POOL_MAGAZINE_MAX)
+    {
+        s_pool->magazine_size = GLOBUS_L_BUFFER_POOL_MAGAZINE_MAX;
+    }
+
+    s_pool->ncaches = 1;
+    while(s_pool->ncaches < globus_l_buffer_pool_ncpus &&
+        s_pool->ncaches < GLOBUS_L_BUFFER_POOL_MAX_CACHES)
+    {
+        s_pool->ncaches *= 2;
+    }
+    s_pool->caches = globus_calloc(
+        s_pool->ncaches, sizeof(globus_l_buffer_pool_cache_t *));
+    if(s_pool->caches == NULL)
+    {
+        goto error_caches;
+    }
+    globus_mutex_init(&s_pool->lock, NULL);
+
+    node = globus_l_buffer_pool_node(s_pool);
+    while(initial_count-- > 0)
+    {
+        if(mag == NULL || mag->rounds == s_pool->magazine_size)
+        {
+            mag = globus_l_buffer_pool_magazine_create(s_pool);
+            if(mag == NULL)
+            {
+                goto error_prealloc;
+            }
+            mag->next = s_pool->full[node];
+            s_pool->full[node] = mag;
+        }
+        block = globus_l_buffer_pool_block_alloc(s_pool);
+        if(block == NULL)
+        {
+            goto error_prealloc;
+        }
+        mag->blocks[mag->rounds++] = block;
+        s_pool->depot_blocks++;
+        s_pool->allocated++;
+    }
+    s_pool->peak = s_pool->allocated;
+
+    *pool = s_pool;
+
+    return GLOBUS_SUCCESS;
+
+error_prealloc:
+    globus_l_buffer_pool_magazines_free(s_pool->full[node]);
+    globus_mutex_destroy(&s_pool->lock);
+    globus_free(s_pool->caches);
+error_caches:
+    globus_free(s_pool);
+error_pool:
+    *pool = NULL;
+
+    return GLOBUS_FAILURE;
+}
+
+/**
+ * @brief Retrieve a block from a pool
+ * @ingroup globus_buffer_pool
+ * @details
+ * Return a free block, allocating a new one if none is cached.  The block
+ * is returned to the pool with globus_buffer_pool_put(), from any thread.
+ *
+ * @return
+ *        The block, or NULL if memory could not be allocated.
+ */
+void *
+globus_buffer_pool_get(
+    globus_buffer_pool_t *                      pool)
+{
+    struct globus_buffer_pool_s *               s_pool;
+    globus_l_buffer_pool_cache_t *              cache;
+    globus_l_buffer_pool_magazine_t *           mag;
+    void *                                      block = NULL;
+    int                                         node;
+
+    globus_assert(pool != NULL && *pool != NULL);
+    s_pool = *pool;
+
+    cache = globus_l_buffer_pool_cache(s_pool);
+    if(cache != NULL)
+    {
+        globus_mutex_lock(&cache->lock);
+        cache->gets++;
+        if(cache->loaded == NULL || cache->loaded->rounds == 0)
+        {
+            if(cache->previous != NULL && cache->previous->rounds > 0)
+            {
+                mag = cache->loaded;
+                cache->loaded = cache->previous;
+                cache->previous = mag;
+            }
+        }
+        if(cache->loaded != NULL && cache->loaded->rounds > 0)
+        {
+            cache->hits++;
+            block = cache->loaded->blocks[--cache->loaded->rounds];
+            globus_mutex_unlock(&cache->lock);
+
+            return block;
+        }
+    }
+
+    /* both magazines are empty; trade one for a full one from the depot */
+    node = globus_l_buffer_pool_node(s_pool);
+    globus_mutex_lock(&s_pool->lock);
+    if(cache == NULL)
+    {
+        s_pool->gets++;
+    }
+    mag = s_pool->full[node];
+    if(mag != NULL && cache != NULL)
+    {
+        s_pool->full[node] = mag->next;
+        s_pool->depot_blocks -= mag->rounds;
+        s_pool->depot_hits++;
+
+        if(cache->previous != NULL)
+        {
+            cache->previous->next = s_pool->empty;
+            s_pool->empty = cache->previous;
+        }
+        cache->previous = cache->loaded;
+        cache->loaded = mag;
+        block = mag->blocks[--mag->rounds];
+    }
+    else if(mag != NULL)
+    {
+        s_pool->depot_blocks--;
+        s_pool->depot_hits++;
+        block = mag->blocks[--mag->rounds];
+        if(mag->rounds == 0)
+        {
+            s_pool->full[node] = mag->next;
+            mag->next = s_pool->empty;
+            s_pool->empty = mag;
+        }
+    }
+    else
+    {
+        s_pool->misses++;
+        s_pool->allocated++;
+        if(s_pool->allocated > s_pool->peak)
+        {
+            s_pool->peak = s_pool->allocated;
+        }
+    }
+    globus_mutex_unlock(&s_pool->lock);
+    if(cache != NULL)
+    {
+        globus_mutex_unlock(&cache->lock);
+    }
+
+    if(block == NULL)
+    {
+        block = globus_l_buffer_pool_block_alloc(s_pool);
+        if(block == NULL)
+        {
+            globus_mutex_lock(&s_pool->lock);
+            s_pool->allocated--;
+            if(cache == NULL)
+            {
+                s_pool->gets--;
+            }
+            globus_mutex_unlock(&s_pool->lock);
+            if(cache != NULL)
+            {
+                globus_mutex_lock(&cache->lock);
+                cache->gets--;
+                globus_mutex_unlock(&cache->lock);
+            }
+        }
+    }
+
+    return block;
+}
+
+/**
+ * @brief Return a block to a pool
+ * @ingroup globus_buffer_pool
+ * @details
+ * Return a block obtained from globus_buffer_pool_get() on the same pool.
+ */
+void
+globus_buffer_pool_put(
+    globus_buffer_pool_t *                      pool,
+    void *                                      block)
+{
+    struct globus_buffer_pool_s *               s_pool;
+    globus_l_buffer_pool_cache_t *              cache;
+    globus_l_buffer_pool_magazine_t *           mag;
+    globus_l_buffer_pool_magazine_t *           trim = NULL;
+    int                                         node;
+
+    globus_assert(pool != NULL && *pool != NULL);
+    s_pool = *pool;
+
+    cache = globus_l_buffer_pool_cache(s_pool);
+    if(cache != NULL)
+    {
+        globus_mutex_lock(&cache->lock);
+        cache->puts++;
+        if(cache->loaded == NULL ||
+            cache->loaded->rounds == s_pool->magazine_size)
+        {
+            if(cache->previous != NULL &&
+                cache->previous->rounds < s_pool->magazine_size)
+            {
+                mag = cache->loaded;
+                cache->loaded = cache->previous;
+                cache->previous = mag;
+            }
+        }
+        if(cache->loaded != NULL &&
+            cache->loaded->rounds < s_pool->magazine_size)
+        {
+            cache->loaded->blocks[cache->loaded->rounds++] = block;
+            globus_mutex_unlock(&cache->lock);
+
+            return;
+        }
+    }
+
+    /* both magazines are full; hand one to the depot for an empty one */
+    node = globus_l_buffer_pool_node(s_pool);
+    globus_mutex_lock(&s_pool->lock);
+    if(cache == NULL)
+    {
+        s_pool->puts++;
+    }
+    mag = s_pool->empty;
+    if(mag != NULL)
+    {
+        s_pool->empty = mag->next;
+    }
+    else
+    {
+        mag = globus_l_buffer_pool_magazine_create(s_pool);
+    }
+    if(mag == NULL)
+    {
+        s_pool->allocated--;
+        s_pool->trimmed++;
+        globus_mutex_unlock(&s_pool->lock);
+        if(cache != NULL)
+        {
+            globus_mutex_unlock(&cache->lock);
+        }
+        free(block);
+
+        return;
+    }
+
+    mag->blocks[0] = block;
+    mag->rounds = 1;
+    if(cache != NULL)
+    {
+        if(cache->previous != NULL)
+        {
+            s_pool->depot_blocks += cache->previous->rounds;
+            cache->previous->next = s_pool->full[node];
+            s_pool->full[node] = cache->previous;
+        }
+        cache->previous = cache->loaded;
+        cache->loaded = mag;
+    }
+    else
+    {
+        s_pool->depot_blocks++;
+        mag->next = s_pool->full[node];
+        s_pool->full[node] = mag;
+    }
+    if(s_pool->high_water > 0)
+    {
+        globus_l_buffer_pool_trim_depot(s_pool, s_pool->high_water, &trim);
+    }
+    globus_mutex_unlock(&s_pool->lock);
+    if(cache != NULL)
+    {
+        globus_mutex_unlock(&cache->lock);
+    }
+
+    globus_l_buffer_pool_magazines_free(trim);
+}
+
+/**
+ * @brief Release cached blocks
+ * @ingroup globus_buffer_pool
+ * @details
+ * Release every free block held by the pool, in the depot or in a thread
+ * cache, back to the system.
+ */
+void
+globus_buffer_pool_trim(
+    globus_buffer_pool_t *                      pool)
+{
+    struct globus_buffer_pool_s *               s_pool;
+    globus_l_buffer_pool_cache_t *              cache;
+    globus_l_buffer_pool_magazine_t *           trim = NULL;
+    globus_l_buffer_pool_magazine_t *           mag;
+    int                                         i;
+    int                                         j;
+
+    globus_assert(pool != NULL && *pool != NULL);
+    s_pool = *pool;
+
+    for(i = 0; i < s_pool->ncaches; i++)
+    {
+        cache = __atomic_load_n(&s_pool->caches[i], __ATOMIC_ACQUIRE);
+        if(cache == NULL)
+        {
+            continue;
+        }
+        globus_mutex_lock(&cache->lock);
+        globus_mutex_lock(&s_pool->lock);
+        for(j = 0; j < 2; j++)
+        {
+            mag = j ? cache->previous : cache->loaded;
+            if(mag != NULL)
+            {
+                s_pool->allocated -= mag->rounds;
+                s_pool->trimmed += mag->rounds;
+                mag->next = trim;
+                trim = mag;
+            }
+        }
+        cache->loaded = NULL;
+        cache->previous = NULL;
+        globus_mutex_unlock(&s_pool->lock);
+        globus_mutex_unlock(&cache->lock);
+    }
+
+    globus_mutex_lock(&s_pool->lock);
+    globus_l_buffer_pool_trim_depot(s_pool, 0, &trim);
+    globus_mutex_unlock(&s_pool->lock);
+
+    globus_l_buffer_pool_magazines_free(trim);
+}
+
+/**
+ * @brief Get buffer pool statistics
+ * @ingroup globus_buffer_pool
+ * @details
+ * Fill in stats with the pool's counters.  The cache hit rate of the pool
+ * is cache_hits / (cache_hits + depot_hits + misses).
+ */
+void
+globus_buffer_pool_stats(
+    globus_buffer_pool_t *                      pool,
+    globus_buffer_pool_stats_t *                stats)
+{
+    struct globus_buffer_pool_s *               s_pool;
+    globus_l_buffer_pool_cache_t *              cache;
+    globus_size_t                               gets;
+    globus_size_t                               puts;
+    int                                         i;
+
+    globus_assert(pool != NULL && *pool != NULL && stats != NULL);
+    s_pool = *pool;
+
+    memset(stats, 0, sizeof(globus_buffer_pool_stats_t));
+
+    globus_mutex_lock(&s_pool->lock);
+    gets = s_pool->gets;
+    puts = s_pool->puts;
+    stats->depot_hits = s_pool->depot_hits;
+    stats->misses = s_pool->misses;
+    stats->allocated = s_pool->allocated;
+    stats->peak = s_pool->peak;
+    stats->trimmed = s_pool->trimmed;
+    globus_mutex_unlock(&s_pool->lock);
+
+    for(i = 0; i < s_pool->ncaches; i++)
+    {
+        cache = __atomic_load_n(&s_pool->caches[i], __ATOMIC_ACQUIRE);
+        if(cache == NULL)
+        {
+            continue;
+        }
+        globus_mutex_lock(&cache->lock);
+        gets += cache->gets;
+        puts += cache->puts;
+        stats->cache_hits += cache->hits;
+        globus_mutex_unlock(&cache->lock);
+    }
+    stats->in_use = gets - puts;
+}
+
+/**
+ * @brief Destroy a buffer pool
+ * @ingroup globus_buffer_pool
+ * @details
+ * Free the pool and every free block it holds.  Blocks still in use are
+ * not freed and must not be returned to the pool afterwards.
+ */
+void
+globus_buffer_pool_destroy(
+    globus_buffer_pool_t *                      pool)
+{
+    struct globus_buffer_pool_s *               s_pool;
+    globus_l_buffer_pool_cache_t *              cache;
+    int                                         i;
+
+    globus_assert(pool != NULL && *pool != NULL);
+    s_pool = *pool;
+
+    for(i = 0; i < s_pool->ncaches; i++)
+    {
+        cache = s_pool->caches[i];
+        if(cache != NULL)
+        {
+            if(cache->loaded != NULL)
+            {
+                cache->loaded->next = NULL;
+                globus_l_buffer_pool_magazines_free(cache->loaded);
+            }
+            if(cache->previous != NULL)
+            {
+                cache->previous->next = NULL;
+                globus_l_buffer_pool_magazines_free(cache->previous);
+            }
+            globus_mutex_destroy(&cache->lock);
+            globus_free(cache);
+        }
+    }
+    for(i = 0; i < GLOBUS_L_BUFFER_POOL_MAX_NODES; i++)
+    {
+        globus_l_buffer_pool_magazines_free(s_pool->full[i]);
+    }
+    globus_l_buffer_pool_magazines_free(s_pool->empty);
+
+    globus_mutex_destroy(&s_pool->lock);
+    globus_free(s_pool->caches);
+    globus_free(s_pool);
+    *pool = NULL;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 1999-2006 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file globus_buffer_pool.h
+ * @brief Buffer Pool
+ */
+
+#if !defined(GLOBUS_BUFFER_POOL_H)
+#define GLOBUS_BUFFER_POOL_H
+
+#include "globus_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup globus_buffer_pool Buffer Pool
+ * @ingroup globus_common
+ * @brief Buffer Pool
+ *
+ * @details
+ * The globus_buffer_pool abstraction manages a pool of same-sized blocks,
+ * like @ref globus_memory, but is meant for data buffers that are
+ * allocated and freed from many threads at once.
+ *
+ * Freed blocks are kept in small per-thread caches (magazines), so most
+ * calls to globus_buffer_pool_get() and globus_buffer_pool_put() take no
+ * lock shared with other threads. Whole magazines are exchanged with a
+ * shared depot when a thread's cache runs empty or full. Blocks are
+ * allocated individually, so the depot can release them to the system once
+ * it holds more than the pool's high water mark.
+ */
+
+struct globus_buffer_pool_s;
+/**
+ * @brief Buffer pool handle
+ * @ingroup globus_buffer_pool
+ */
+typedef struct globus_buffer_pool_s *           globus_buffer_pool_t;
+
+/**
+ * @brief Buffer pool flags
+ * @ingroup globus_buffer_pool
+ */
+typedef enum
+{
+    /** Align blocks to, and round their size up to, the system page size,
+     *  as needed for O_DIRECT I/O */
+    GLOBUS_BUFFER_POOL_PAGE_ALIGNED = 1 << 0,
+    /** Ask for blocks to be backed by transparent huge pages where the
+     *  system supports it; only useful for blocks of 2MB or more */
+    GLOBUS_BUFFER_POOL_HUGE_PAGES = 1 << 1,
+    /** Keep a separate depot per NUMA node, and touch the pages of new
+     *  blocks from the allocating thread so they are placed on its node */
+    GLOBUS_BUFFER_POOL_NUMA_LOCAL = 1 << 2
+} globus_buffer_pool_flags_t;
+
+/**
+ * @brief Buffer pool statistics
+ * @ingroup globus_buffer_pool
+ */
+typedef struct
+{
+    /** Gets served from the calling thread's cache */
+    globus_size_t                               cache_hits;
+    /** Gets served from a magazine in the depot */
+    globus_size_t                               depot_hits;
+    /** Gets that had to allocate a new block */
+    globus_size_t                               misses;
+    /** Blocks currently handed out */
+    globus_size_t                               in_use;
+    /** Blocks currently allocated, whether handed out or cached */
+    globus_size_t                               allocated;
+    /** Most blocks allocated at any one time */
+    globus_size_t                               peak;
+    /** Blocks released to the system by trimming */
+    globus_size_t                               trimmed;
+} globus_buffer_pool_stats_t;
+
+globus_bool_t
+globus_i_buffer_pool_pre_activate(void);
+
+int
+globus_buffer_pool_init(
+    globus_buffer_pool_t *                      pool,
+    globus_size_t                               block_size,
+    int                                         initial_count,
+    int                                         high_water,
+    int                                         flags);
+
+void *
+globus_buffer_pool_get(
+    globus_buffer_pool_t *                      pool);
+
+void
+globus_buffer_pool_put(
+    globus_buffer_pool_t *                      pool,
+    void *                                      block);
+
+void
+globus_buffer_pool_trim(
+    globus_buffer_pool_t *                      pool);
+
+void
+globus_buffer_pool_stats(
+    globus_buffer_pool_t *                      pool,
+    globus_buffer_pool_stats_t *                stats);
+
+void
+globus_buffer_pool_destroy(
+    globus_buffer_pool_t *                      pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GLOBUS_BUFFER_POOL_H */
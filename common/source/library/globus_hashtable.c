@@ -17,67 +17,353 @@
 
 /********************************************************************
  *
- * This file implements the hashtable_t type, a lightweight chaining hashtable
+ * This file implements the hashtable_t type, a lightweight open addressing
+ * hashtable
+ *
+ * Mappings are kept in a dense array of entries in insertion order, which
+ * the iterators walk.  Removed entries leave a hole (NULL datum) until the
+ * array is compacted.  Lookups go through a separate linear probing index
+ * of entry numbers, sized to a power of two and grown at 70% occupancy.
+ * Growing the index is done incrementally: the old index is kept alongside
+ * the new one and a few of its slots are moved on each insert or remove,
+ * so no single call pays for rehashing the whole table.
  *
  ********************************************************************/
 
 #include "globus_hashtable.h"
 #include "globus_libc.h"
-#include "globus_memory.h"
-
-#define GlobusLInsertNodeBefore(_node, _before)                             \
-    do                                                                      \
-    {                                                                       \
-        (_node)->prev = (_before)->prev;                                    \
-        if((_before)->prev)                                                 \
-        {                                                                   \
-            (_node)->prev->next = (_node);                                  \
-        }                                                                   \
-                                                                            \
-        (_node)->next = (_before);                                          \
-        (_before)->prev = (_node);                                          \
-    } while(0)
-
-typedef struct globus_l_hashtable_bucket_entry_s
+
+#include <limits.h>
+
+#define GLOBUS_L_HASHTABLE_EMPTY        -1
+#define GLOBUS_L_HASHTABLE_REMOVED      -2
+#define GLOBUS_L_HASHTABLE_MIN_BITS     3
+#define GLOBUS_L_HASHTABLE_MAX_BITS     30
+/* old index slots moved into the new index per insert or remove */
+#define GLOBUS_L_HASHTABLE_MIGRATE_STEP 64
+
+/* the index is resized once 70% of its slots are in use, to a size
+ * where the live mappings take up no more than 40% of it
+ */
+#define GlobusLHashtableIndexFull(_used, _bits)                             \
+    ((size_t) (_used) * 10 > ((size_t) 7 << (_bits)))
+#define GlobusLHashtableIndexFits(_used, _bits)                             \
+    ((size_t) (_used) * 10 <= ((size_t) 4 << (_bits)))
+
+/* fibonacci hashing, so that weak hash funcs like globus_hashtable_int_hash()
+ * still spread over the top bits of a power of two index
+ */
+#define GlobusLHashtableSlot(_hash, _bits)                                  \
+    ((uint32_t) ((_hash) * 2654435769u) >> (32 - (_bits)))
+
+typedef struct
 {
     void *                              key;
+    /* NULL if the mapping has been removed */
     void *                              datum;
-    struct globus_l_hashtable_bucket_entry_s * prev;
-    struct globus_l_hashtable_bucket_entry_s * next;
-} globus_l_hashtable_bucket_entry_t;
+    uint32_t                            hash;
+} globus_l_hashtable_entry_t;
 
-typedef struct globus_l_hashtable_bucket_s
+typedef struct
 {
-    globus_l_hashtable_bucket_entry_t * first;
-    globus_l_hashtable_bucket_entry_t * last;
-} globus_l_hashtable_bucket_t;
+    /* entry number, GLOBUS_L_HASHTABLE_EMPTY or GLOBUS_L_HASHTABLE_REMOVED */
+    int32_t                             ndx;
+    uint32_t                            hash;
+} globus_l_hashtable_slot_t;
 
 typedef struct globus_l_hashtable_s
 {
-    int                                 size;
+    /* number of live mappings */
     int                                 load;
-    globus_l_hashtable_bucket_t *       buckets;
-    globus_l_hashtable_bucket_entry_t * first;
-    globus_l_hashtable_bucket_entry_t * last;
-    globus_l_hashtable_bucket_entry_t * current;
+    /* entries in use, including removed ones not yet compacted away */
+    int                                 used;
+    int                                 entries_size;
+    globus_l_hashtable_entry_t *        entries;
+
+    globus_l_hashtable_slot_t *         index;
+    int                                 index_bits;
+    /* index slots which are not EMPTY */
+    int                                 index_used;
+    int                                 min_bits;
+
+    /* index being migrated into index, NULL unless resizing */
+    globus_l_hashtable_slot_t *         old_index;
+    int                                 old_bits;
+    int                                 migrate_next;
+
+    /* iterator entry, -1 if unset or past an end */
+    int                                 current;
     globus_hashtable_hash_func_t        hash_func;
     globus_hashtable_keyeq_func_t       keyeq_func;
-    globus_memory_t                     memory;
 } globus_l_hashtable_t;
 
+static
+globus_l_hashtable_slot_t *
+globus_l_hashtable_index_alloc(
+    int                                 bits)
+{
+    globus_l_hashtable_slot_t *         index;
+    size_t                              len;
+
+    len = sizeof(globus_l_hashtable_slot_t) << bits;
+    index = (globus_l_hashtable_slot_t *) globus_malloc(len);
+    if(index)
+    {
+        /* all ones is GLOBUS_L_HASHTABLE_EMPTY */
+        memset(index, 0xff, len);
+    }
+
+    return index;
+}
+
+static
+globus_l_hashtable_slot_t *
+globus_l_hashtable_index_find(
+    globus_l_hashtable_t *              itable,
+    globus_l_hashtable_slot_t *         index,
+    int                                 bits,
+    void *                              key,
+    uint32_t                            hash)
+{
+    globus_l_hashtable_slot_t *         slot;
+    uint32_t                            mask;
+    uint32_t                            i;
+
+    mask = ((uint32_t) 1 << bits) - 1;
+    for(i = GlobusLHashtableSlot(hash, bits); ; i = (i + 1) & mask)
+    {
+        slot = &index[i];
+        if(slot->ndx == GLOBUS_L_HASHTABLE_EMPTY)
+        {
+            return GLOBUS_NULL;
+        }
+        if(slot->ndx >= 0 && slot->hash == hash &&
+            itable->keyeq_func(itable->entries[slot->ndx].key, key))
+        {
+            return slot;
+        }
+    }
+}
+
+static
+globus_l_hashtable_slot_t *
+globus_l_hashtable_find(
+    globus_l_hashtable_t *              itable,
+    void *                              key,
+    uint32_t                            hash)
+{
+    globus_l_hashtable_slot_t *         slot;
+
+    slot = globus_l_hashtable_index_find(
+        itable, itable->index, itable->index_bits, key, hash);
+    if(!slot && itable->old_index)
+    {
+        slot = globus_l_hashtable_index_find(
+            itable, itable->old_index, itable->old_bits, key, hash);
+    }
+
+    return slot;
+}
+
+/* caller has checked that the mapping isn't already in either index */
+static
+void
+globus_l_hashtable_index_add(
+    globus_l_hashtable_t *              itable,
+    int32_t                             ndx,
+    uint32_t                            hash)
+{
+    globus_l_hashtable_slot_t *         slot;
+    uint32_t                            mask;
+    uint32_t                            i;
+
+    mask = ((uint32_t) 1 << itable->index_bits) - 1;
+    i = GlobusLHashtableSlot(hash, itable->index_bits);
+    while(itable->index[i].ndx >= 0)
+    {
+        i = (i + 1) & mask;
+    }
+
+    slot = &itable->index[i];
+    if(slot->ndx == GLOBUS_L_HASHTABLE_EMPTY)
+    {
+        itable->index_used++;
+    }
+    slot->ndx = ndx;
+    slot->hash = hash;
+}
+
+/* move up to steps slots of the old index into the new one, or all of them
+ * if steps is negative
+ */
+static
+void
+globus_l_hashtable_migrate(
+    globus_l_hashtable_t *              itable,
+    int                                 steps)
+{
+    globus_l_hashtable_slot_t *         slot;
+    int                                 size;
+
+    if(!itable->old_index)
+    {
+        return;
+    }
+
+    size = 1 << itable->old_bits;
+    while(itable->migrate_next < size && steps-- != 0)
+    {
+        slot = &itable->old_index[itable->migrate_next++];
+        if(slot->ndx >= 0)
+        {
+            globus_l_hashtable_index_add(itable, slot->ndx, slot->hash);
+            slot->ndx = GLOBUS_L_HASHTABLE_REMOVED;
+        }
+    }
+
+    if(itable->migrate_next == size)
+    {
+        globus_free(itable->old_index);
+        itable->old_index = GLOBUS_NULL;
+    }
+}
+
+/* start migrating to a new index big enough for one more mapping.  The
+ * index never shrinks here; a full index with few live mappings is rebuilt
+ * at the same size to clear out its REMOVED slots.
+ */
+static
+int
+globus_l_hashtable_grow_index(
+    globus_l_hashtable_t *              itable)
+{
+    globus_l_hashtable_slot_t *         index;
+    int                                 bits;
+
+    bits = itable->index_bits;
+    while(!GlobusLHashtableIndexFits(itable->load + 1, bits) &&
+        bits < GLOBUS_L_HASHTABLE_MAX_BITS)
+    {
+        bits++;
+    }
+
+    index = globus_l_hashtable_index_alloc(bits);
+    if(!index)
+    {
+        return GLOBUS_FAILURE;
+    }
+
+    globus_l_hashtable_migrate(itable, -1);
+    itable->old_index = itable->index;
+    itable->old_bits = itable->index_bits;
+    itable->migrate_next = 0;
+    itable->index = index;
+    itable->index_bits = bits;
+    itable->index_used = 0;
+
+    return GLOBUS_SUCCESS;
+}
+
+/* squeeze removed entries out of the entries array and rebuild the index
+ * from scratch, keeping the iterator on the entry it was on
+ */
+static
+int
+globus_l_hashtable_compact(
+    globus_l_hashtable_t *              itable)
+{
+    globus_l_hashtable_slot_t *         index;
+    int                                 bits;
+    int                                 current = -1;
+    int                                 i;
+    int                                 j;
+
+    bits = itable->min_bits;
+    while(!GlobusLHashtableIndexFits(itable->load, bits) &&
+        bits < GLOBUS_L_HASHTABLE_MAX_BITS)
+    {
+        bits++;
+    }
+
+    index = globus_l_hashtable_index_alloc(bits);
+    if(!index)
+    {
+        return GLOBUS_FAILURE;
+    }
+
+    for(i = 0, j = 0; i < itable->used; i++)
+    {
+        if(itable->entries[i].datum)
+        {
+            if(i == itable->current)
+            {
+                current = j;
+            }
+            itable->entries[j++] = itable->entries[i];
+        }
+    }
+    itable->used = j;
+    itable->current = current;
+
+    globus_free(itable->index);
+    if(itable->old_index)
+    {
+        globus_free(itable->old_index);
+        itable->old_index = GLOBUS_NULL;
+    }
+    itable->index = index;
+    itable->index_bits = bits;
+    itable->index_used = 0;
+
+    for(i = 0; i < itable->used; i++)
+    {
+        globus_l_hashtable_index_add(itable, i, itable->entries[i].hash);
+    }
+
+    return GLOBUS_SUCCESS;
+}
+
+/* iterators walk the entries from newest to oldest */
+static
+int
+globus_l_hashtable_live_down(
+    globus_l_hashtable_t *              itable,
+    int                                 ndx)
+{
+    while(ndx >= 0 && !itable->entries[ndx].datum)
+    {
+        ndx--;
+    }
+
+    return ndx;
+}
+
+static
+int
+globus_l_hashtable_live_up(
+    globus_l_hashtable_t *              itable,
+    int                                 ndx)
+{
+    while(ndx < itable->used && !itable->entries[ndx].datum)
+    {
+        ndx++;
+    }
+
+    return (ndx < itable->used ? ndx : -1);
+}
+
 /**
  * @brief Initialize a hash table
  * @ingroup globus_hashtable
  * @details
- * Initializes a generic chaining hashtable to represent an empty mapping and
- * returns zero, or returns non-zero on failure. The size parameter specifies
- * the number of chains with which to represent the mapping. This defines the
- * maximum possible number of mappings that can be represented without conflict
- * given a perfect hash, and therefore affects performance as hash conflicts
- * will be resolved by linear chains.
+ * Initializes a generic open addressing hashtable to represent an empty
+ * mapping and returns zero, or returns non-zero on failure. The size
+ * parameter is a hint for the number of mappings the table will hold; the
+ * table grows as needed, so it only saves the first few resizes.
  *
  * The hash_func and keyeq_func anonymous functions will be used by the table
- * to manipulate the user's keys.
+ * to manipulate the user's keys.  The table calls hash_func with a limit of
+ * INT_MAX and derives its own index from the result.
  */
 int
 globus_hashtable_init(
@@ -87,6 +373,7 @@ globus_hashtable_init(
     globus_hashtable_keyeq_func_t       keyeq_func)
 {
     globus_l_hashtable_t *              itable;
+    int                                 bits;
     
     if(table == GLOBUS_NULL || 
         hash_func == GLOBUS_NULL || 
@@ -103,40 +390,36 @@ globus_hashtable_init(
         goto error_malloc_table;
     }
     
-    itable->buckets = (globus_l_hashtable_bucket_t *)
-        globus_malloc(sizeof(globus_l_hashtable_bucket_t) * size);
-    if(!itable->buckets)
+    bits = GLOBUS_L_HASHTABLE_MIN_BITS;
+    while((1 << bits) < size && bits < GLOBUS_L_HASHTABLE_MAX_BITS)
     {
-        goto error_malloc_buckets;
+        bits++;
     }
     
-    if(!globus_memory_init(
-        &itable->memory, sizeof(globus_l_hashtable_bucket_entry_t), 16))
+    itable->index = globus_l_hashtable_index_alloc(bits);
+    if(!itable->index)
     {
-        goto error_memory_init;
+        goto error_malloc_index;
     }
     
-    itable->size = size;
     itable->load = 0;
-    itable->first = GLOBUS_NULL;
-    itable->last = GLOBUS_NULL;
-    itable->current = GLOBUS_NULL;
+    itable->used = 0;
+    itable->entries_size = 0;
+    itable->entries = GLOBUS_NULL;
+    itable->index_bits = bits;
+    itable->index_used = 0;
+    itable->min_bits = bits;
+    itable->old_index = GLOBUS_NULL;
+    itable->old_bits = 0;
+    itable->migrate_next = 0;
+    itable->current = -1;
     itable->hash_func = hash_func;
     itable->keyeq_func = keyeq_func;
     
-    while(size--)
-    {
-        itable->buckets[size].first = GLOBUS_NULL;
-        itable->buckets[size].last = GLOBUS_NULL;
-    }
-    
     *table = itable;
     return GLOBUS_SUCCESS;
 
-error_memory_init:
-    globus_free(itable->buckets);
-    
-error_malloc_buckets:
+error_malloc_index:
     globus_free(itable);
     
 error_malloc_table:
@@ -158,10 +441,9 @@ globus_hashtable_copy(
 {
     globus_l_hashtable_t *              src_itable;
     globus_l_hashtable_t *              dest_itable;
+    globus_l_hashtable_entry_t *        src_entry;
+    globus_l_hashtable_entry_t *        dest_entry;
     int                                 i;
-    int                                 size;
-    globus_l_hashtable_bucket_entry_t * list;
-    globus_l_hashtable_bucket_entry_t   dummy_entry;
     
     if(dest_table == GLOBUS_NULL || 
         src_table == GLOBUS_NULL || 
@@ -174,7 +456,7 @@ globus_hashtable_copy(
     
     if(globus_hashtable_init(
         dest_table,
-        src_itable->size,
+        1 << src_itable->min_bits,
         src_itable->hash_func,
         src_itable->keyeq_func) != GLOBUS_SUCCESS)
     {
@@ -182,63 +464,49 @@ globus_hashtable_copy(
     }
     
     dest_itable = *dest_table;
-    size = src_itable->size;
-    dest_itable->load = src_itable->load;
+    if(src_itable->load == 0)
+    {
+        return GLOBUS_SUCCESS;
+    }
     
-    dummy_entry.next = GLOBUS_NULL;
-    list = &dummy_entry;
-    for(i = 0; i < size; i++)
+    dest_itable->entries = (globus_l_hashtable_entry_t *)
+        globus_malloc(sizeof(globus_l_hashtable_entry_t) * src_itable->load);
+    if(!dest_itable->entries)
     {
-        if(src_itable->buckets[i].first)
+        goto error_alloc;
+    }
+    dest_itable->entries_size = src_itable->load;
+    
+    for(i = 0; i < src_itable->used; i++)
+    {
+        src_entry = &src_itable->entries[i];
+        if(!src_entry->datum)
         {
-            globus_l_hashtable_bucket_entry_t * src_entry;
-            globus_l_hashtable_bucket_entry_t * dest_entry;
-            globus_l_hashtable_bucket_entry_t ** bucket_first;
-            
-            src_entry = src_itable->buckets[i].first;
-            bucket_first = &list->next;
-            do
-            {
-                dest_entry = (globus_l_hashtable_bucket_entry_t *)
-                    globus_memory_pop_node(&dest_itable->memory);
-                if(!dest_entry)
-                {
-                    goto error_alloc;
-                }
-                
-                if(copy_func)
-                {
-                    copy_func(
-                        &dest_entry->key,
-                        &dest_entry->datum,
-                        src_entry->key,
-                        src_entry->datum);
-                }
-                else
-                {
-                    dest_entry->key = src_entry->key;
-                    dest_entry->datum = src_entry->datum;
-                }
-                
-                dest_entry->prev = list;
-                dest_entry->next = GLOBUS_NULL;
-                list->next = dest_entry;
-                list = dest_entry;
-                
-                src_entry = src_entry->next;
-            } while(
-                src_entry && src_entry->prev != src_itable->buckets[i].last);
-            
-            dest_itable->buckets[i].first = *bucket_first;
-            dest_itable->buckets[i].last = dest_entry;
-            dest_itable->last = dest_entry;
+            continue;
         }
+        
+        dest_entry = &dest_itable->entries[dest_itable->used++];
+        if(copy_func)
+        {
+            copy_func(
+                &dest_entry->key,
+                &dest_entry->datum,
+                src_entry->key,
+                src_entry->datum);
+        }
+        else
+        {
+            dest_entry->key = src_entry->key;
+            dest_entry->datum = src_entry->datum;
+        }
+        dest_entry->hash = src_entry->hash;
     }
+    dest_itable->load = dest_itable->used;
     
-    if(dummy_entry.next)
+    /* builds the index for the copied entries */
+    if(globus_l_hashtable_compact(dest_itable) != GLOBUS_SUCCESS)
     {
-        dest_itable->first = dummy_entry.next;
-        dummy_entry.next->prev = GLOBUS_NULL;
+        goto error_alloc;
     }
     
     return GLOBUS_SUCCESS;
@@ -252,44 +520,16 @@ error_init:
 error_parm:
     return GLOBUS_FAILURE;
 }
-    
-static
-globus_l_hashtable_bucket_entry_t *
-globus_l_hashtable_search_bucket(
-    globus_l_hashtable_bucket_t *       bucket,
-    globus_hashtable_keyeq_func_t       keyeq_func,
-    void *                              key)
-{
-    globus_l_hashtable_bucket_entry_t * i;
-    globus_l_hashtable_bucket_entry_t * end;
-    
-    if(bucket->first)
-    {
-        i = bucket->first;
-        end = bucket->last->next;
-        
-        do
-        {
-            if(keyeq_func(i->key, key))
-            {
-                return i;
-            }
-            
-            i = i->next;
-        } while(i != end);
-    }
-    
-    return GLOBUS_NULL;
-}
 
 /**
  * @brief Insert a datum into a hash table
  * @ingroup globus_hashtable
  * @details
  * The routine globus_hashtable_insert adds a new mapping to the table,
- * returning zero on success or non-zero on failure. Any previous mapping for
- * the same key (where equality is defined by the keyeq_func provided at table
- * initialization) is lost.
+ * returning zero on success or non-zero on failure. It fails if the table
+ * already maps the key (where equality is defined by the keyeq_func provided
+ * at table initialization); use globus_hashtable_update() to replace a
+ * mapping.
  *
  * It is an error to call this routine on an uninitialized table.
  */
@@ -300,8 +540,8 @@ globus_hashtable_insert(
     void *                              datum)
 {
     globus_l_hashtable_t *              itable;
-    globus_l_hashtable_bucket_t *       bucket;
-    globus_l_hashtable_bucket_entry_t * entry;
+    globus_l_hashtable_entry_t *        entry;
+    uint32_t                            hash;
     
     if(!table || !*table || !datum)
     {
@@ -310,50 +550,53 @@ globus_hashtable_insert(
     }
     
     itable = *table;
-    bucket = &itable->buckets[itable->hash_func(key, itable->size)];
+    hash = (uint32_t) itable->hash_func(key, INT_MAX);
     
     /* make sure it doesn't already exist */
-    if(globus_l_hashtable_search_bucket(bucket, itable->keyeq_func, key))
+    if(globus_l_hashtable_find(itable, key, hash))
     {
         goto error_exists;
     }
     
-    entry = (globus_l_hashtable_bucket_entry_t *)
-        globus_memory_pop_node(&itable->memory);
-    if(!entry)
-    {
-        goto error_alloc;
-    }
-    
-    entry->key = key;
-    entry->datum = datum;
-    
-    if(bucket->first)
+    if(itable->used == itable->entries_size)
     {
-        if(bucket->first == itable->first)
+        /* reuse the space of removed entries if they make up half the
+         * array, otherwise double it
+         */
+        if(itable->used == 0 ||
+            itable->used - itable->load < itable->used / 2 ||
+            globus_l_hashtable_compact(itable) != GLOBUS_SUCCESS)
         {
-            itable->first = entry;
+            globus_l_hashtable_entry_t * entries;
+            int                         size;
+            
+            size = itable->entries_size ? itable->entries_size * 2 : 8;
+            entries = (globus_l_hashtable_entry_t *) globus_realloc(
+                itable->entries, sizeof(globus_l_hashtable_entry_t) * size);
+            if(!entries)
+            {
+                goto error_alloc;
+            }
+            itable->entries = entries;
+            itable->entries_size = size;
         }
-        GlobusLInsertNodeBefore(entry, bucket->first);
     }
-    else
+    
+    if(GlobusLHashtableIndexFull(itable->index_used + 1, itable->index_bits))
     {
-        if(itable->first)
+        if(globus_l_hashtable_grow_index(itable) != GLOBUS_SUCCESS)
         {
-            GlobusLInsertNodeBefore(entry, itable->first);
+            goto error_alloc;
         }
-        else
-        {
-            entry->prev = GLOBUS_NULL;
-            entry->next = GLOBUS_NULL;
-            itable->last = entry;
-        }
-        
-        itable->first = entry;
-        bucket->last = entry;
     }
+    globus_l_hashtable_migrate(itable, GLOBUS_L_HASHTABLE_MIGRATE_STEP);
     
-    bucket->first = entry;
+    entry = &itable->entries[itable->used];
+    entry->key = key;
+    entry->datum = datum;
+    entry->hash = hash;
+    globus_l_hashtable_index_add(itable, itable->used, hash);
+    itable->used++;
     itable->load++;
     
     return GLOBUS_SUCCESS;
@@ -380,8 +623,8 @@ globus_hashtable_update(
     void *                              datum)
 {
     globus_l_hashtable_t *              itable;
-    globus_l_hashtable_bucket_t *       bucket;
-    globus_l_hashtable_bucket_entry_t * entry;
+    globus_l_hashtable_slot_t *         slot;
+    globus_l_hashtable_entry_t *        entry;
     void *                              old_datum;
     
     if(!table || !*table || !datum)
@@ -391,14 +634,14 @@ globus_hashtable_update(
     }
     
     itable = *table;
-    bucket = &itable->buckets[itable->hash_func(key, itable->size)];
-    
-    entry = globus_l_hashtable_search_bucket(bucket, itable->keyeq_func, key);
-    if(!entry)
+    slot = globus_l_hashtable_find(
+        itable, key, (uint32_t) itable->hash_func(key, INT_MAX));
+    if(!slot)
     {
         goto error_notfound;
     }
     
+    entry = &itable->entries[slot->ndx];
     old_datum = entry->datum;
     entry->datum = datum;
     entry->key = key;
@@ -425,8 +668,7 @@ globus_hashtable_lookup(
     void *                              key)
 {
     globus_l_hashtable_t *              itable;
-    globus_l_hashtable_bucket_t *       bucket;
-    globus_l_hashtable_bucket_entry_t * entry;
+    globus_l_hashtable_slot_t *         slot;
     
     if(!table || !*table)
     {
@@ -435,15 +677,14 @@ globus_hashtable_lookup(
     }
     
     itable = *table;
-    bucket = &itable->buckets[itable->hash_func(key, itable->size)];
-    
-    entry = globus_l_hashtable_search_bucket(bucket, itable->keyeq_func, key);
-    if(!entry)
+    slot = globus_l_hashtable_find(
+        itable, key, (uint32_t) itable->hash_func(key, INT_MAX));
+    if(!slot)
     {
         goto error_notfound;
     }
     
-    return entry->datum;
+    return itable->entries[slot->ndx].datum;
     
 error_notfound:
 error_param:
@@ -465,9 +706,10 @@ globus_hashtable_remove(
     void *                              key)
 {
     globus_l_hashtable_t *              itable;
-    globus_l_hashtable_bucket_t *       bucket;
-    globus_l_hashtable_bucket_entry_t * entry;
+    globus_l_hashtable_slot_t *         slot;
+    globus_l_hashtable_entry_t *        entry;
     void *                              datum;
+    int                                 ndx;
     
     if(!table || !*table)
     {
@@ -476,59 +718,43 @@ globus_hashtable_remove(
     }
     
     itable = *table;
-    bucket = &itable->buckets[itable->hash_func(key, itable->size)];
-    
-    entry = globus_l_hashtable_search_bucket(bucket, itable->keyeq_func, key);
-    if(!entry)
+    slot = globus_l_hashtable_find(
+        itable, key, (uint32_t) itable->hash_func(key, INT_MAX));
+    if(!slot)
     {
         goto error_notfound;
     }
     
-    if(entry == bucket->first)
-    {
-        if(entry == bucket->last)
-        {
-            bucket->first = GLOBUS_NULL;
-            bucket->last = GLOBUS_NULL;
-            
-        }
-        else
-        {
-            bucket->first = entry->next;
-        }
-    }
-    else if(entry == bucket->last)
-    {
-        bucket->last = entry->prev;
-    }
+    ndx = slot->ndx;
+    slot->ndx = GLOBUS_L_HASHTABLE_REMOVED;
+    
+    entry = &itable->entries[ndx];
+    datum = entry->datum;
+    entry->key = GLOBUS_NULL;
+    entry->datum = GLOBUS_NULL;
+    itable->load--;
     
-    if(entry->prev)
+    if(ndx == itable->current)
     {
-        entry->prev->next = entry->next;
+        itable->current = globus_l_hashtable_live_down(itable, ndx - 1);
     }
-    else
+    
+    /* removed entries at the end can be reused right away */
+    while(itable->used > 0 && !itable->entries[itable->used - 1].datum)
     {
-        itable->first = entry->next;
+        itable->used--;
     }
     
-    if(entry->next)
+    if(itable->used - itable->load > itable->load && itable->used > 16)
     {
-        entry->next->prev = entry->prev;
+        /* on failure, just keep the holes */
+        globus_l_hashtable_compact(itable);
     }
     else
     {
-        itable->last = entry->prev;
-    }
-    
-    if(entry == itable->current)
-    {
-        itable->current = entry->next;
+        globus_l_hashtable_migrate(itable, GLOBUS_L_HASHTABLE_MIGRATE_STEP);
     }
     
-    datum = entry->datum;
-    globus_memory_push_node(&itable->memory, entry);
-    itable->load--;
-    
     return datum;
 
 error_notfound:
@@ -546,7 +772,7 @@ globus_hashtable_to_list(
     globus_list_t **                    list)
 {
     globus_l_hashtable_t *              itable;
-    globus_l_hashtable_bucket_entry_t * entry;
+    int                                 i;
     
     if(!table || !*table || !list)
     {
@@ -555,13 +781,14 @@ globus_hashtable_to_list(
     }
     
     itable = *table;
-    entry = itable->first;
     *list = GLOBUS_NULL;
     
-    while(entry)
+    for(i = itable->used - 1; i >= 0; i--)
     {
-        globus_list_insert(list, entry->datum);
-        entry = entry->next;
+        if(itable->entries[i].datum)
+        {
+            globus_list_insert(list, itable->entries[i].datum);
+        }
     }
 
     return GLOBUS_SUCCESS;
@@ -581,7 +808,7 @@ globus_hashtable_empty(
     globus_hashtable_t *                table)
 {
     return ((!table || !*table || 
-        (*table)->first == GLOBUS_NULL) ? GLOBUS_TRUE : GLOBUS_FALSE);
+        (*table)->load == 0) ? GLOBUS_TRUE : GLOBUS_FALSE);
 }
 
 /**
@@ -621,9 +848,10 @@ globus_hashtable_first(
     }
     
     itable = *table;
-    itable->current = itable->first;
+    itable->current = globus_l_hashtable_live_down(itable, itable->used - 1);
     
-    return (itable->current ? itable->current->datum : GLOBUS_NULL);
+    return (itable->current >= 0 ?
+        itable->entries[itable->current].datum : GLOBUS_NULL);
     
 error_param:
     return GLOBUS_NULL;
@@ -648,12 +876,14 @@ globus_hashtable_next(
     }
     
     itable = *table;
-    if(itable->current)
+    if(itable->current >= 0)
     {
-        itable->current = itable->current->next;
+        itable->current =
+            globus_l_hashtable_live_down(itable, itable->current - 1);
     }
     
-    return (itable->current ? itable->current->datum : GLOBUS_NULL);
+    return (itable->current >= 0 ?
+        itable->entries[itable->current].datum : GLOBUS_NULL);
     
 error_param:
     return GLOBUS_NULL;
@@ -678,9 +908,10 @@ globus_hashtable_last(
     }
     
     itable = *table;
-    itable->current = itable->last;
+    itable->current = globus_l_hashtable_live_up(itable, 0);
     
-    return (itable->current ? itable->current->datum : GLOBUS_NULL);
+    return (itable->current >= 0 ?
+        itable->entries[itable->current].datum : GLOBUS_NULL);
     
 error_param:
     return GLOBUS_NULL;
@@ -705,12 +936,14 @@ globus_hashtable_prev(
     }
     
     itable = *table;
-    if(itable->current)
+    if(itable->current >= 0)
     {
-        itable->current = itable->current->prev;
+        itable->current =
+            globus_l_hashtable_live_up(itable, itable->current + 1);
     }
     
-    return (itable->current ? itable->current->datum : GLOBUS_NULL);
+    return (itable->current >= 0 ?
+        itable->entries[itable->current].datum : GLOBUS_NULL);
     
 error_param:
     return GLOBUS_NULL;
@@ -732,7 +965,6 @@ globus_hashtable_destroy(
     globus_hashtable_t *                table)
 {
     globus_l_hashtable_t *              itable;
-    globus_l_hashtable_bucket_entry_t * entry;
     
     if(!table || !*table)
     {
@@ -741,19 +973,16 @@ globus_hashtable_destroy(
     }
     
     itable = *table;
-    entry = itable->first;
     
-    while(entry)
+    if(itable->entries)
     {
-        globus_l_hashtable_bucket_entry_t * save;
-        
-        save = entry->next;
-        globus_memory_push_node(&itable->memory, entry);
-        entry = save;
+        globus_free(itable->entries);
     }
-    
-    globus_memory_destroy(&itable->memory);
-    globus_free(itable->buckets);
+    if(itable->old_index)
+    {
+        globus_free(itable->old_index);
+    }
+    globus_free(itable->index);
     globus_free(itable);
     *table = GLOBUS_NULL;
     
@@ -769,7 +998,7 @@ globus_hashtable_destroy_all(
     globus_hashtable_destructor_func_t  element_free)
 {
     globus_l_hashtable_t *              itable;
-    globus_l_hashtable_bucket_entry_t * entry;
+    int                                 i;
     
     if(!table || !*table || !element_free)
     {
@@ -778,12 +1007,13 @@ globus_hashtable_destroy_all(
     }
     
     itable = *table;
-    entry = itable->first;
     
-    while(entry)
+    for(i = itable->used - 1; i >= 0; i--)
     {
-        element_free(entry->datum);
-        entry = entry->next;
+        if(itable->entries[i].datum)
+        {
+            element_free(itable->entries[i].datum);
+        }
     }
     
     globus_hashtable_destroy(table);
@@ -31,6 +31,7 @@
 #include "globus_list.h"
 #include "globus_thread_common.h"
 #include "globus_memory.h"
+#include "globus_buffer_pool.h"
 #include "globus_hashtable.h"
 #include "globus_libc.h"
 #include "globus_thread.h"
@@ -896,6 +897,7 @@ globus_l_module_initialize()
      */
     globus_i_thread_pre_activate();
     globus_i_memory_pre_activate();
+    globus_i_buffer_pool_pre_activate();
     /*
      * Initialize the registered module table and list
      */
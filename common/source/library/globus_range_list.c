@@ -15,25 +15,317 @@
  */
 
 /********************************************************************
+ *
+ * Ranges are kept in an AVL tree ordered by offset, with each node
+ * counting the nodes below it so globus_range_list_at() can find the
+ * ndx'th range without walking the list. Ranges in the tree never touch
+ * or overlap: inserting a range merges it with every range it reaches.
  *
  ********************************************************************/
 #include "globus_common_include.h"
 #include "globus_range_list.h"
 #include "globus_libc.h"
 
+/* end offset of a range of length GLOBUS_RANGE_LIST_MAX */
+#define GLOBUS_L_RANGE_END_MAX          INT64_MAX
+
 typedef struct globus_l_range_ent_s
 {
     globus_off_t                        offset;
     globus_off_t                        length;
-    struct globus_l_range_ent_s *       next;
+    struct globus_l_range_ent_s *       left;
+    struct globus_l_range_ent_s *       right;
+    int                                 height;
+    int                                 count;
 } globus_l_range_ent_t;
 
 typedef struct globus_l_range_list_s
 {
-    int                                 size;
-    globus_l_range_ent_t *              head;
+    globus_l_range_ent_t *              root;
 } globus_l_range_list_t;
 
+static
+globus_off_t
+globus_l_range_end(
+    globus_off_t                        offset,
+    globus_off_t                        length)
+{
+    return length == GLOBUS_RANGE_LIST_MAX
+        ? GLOBUS_L_RANGE_END_MAX : offset + length;
+}
+
+static
+globus_off_t
+globus_l_range_length(
+    globus_off_t                        offset,
+    globus_off_t                        end)
+{
+    return end == GLOBUS_L_RANGE_END_MAX
+        ? GLOBUS_RANGE_LIST_MAX : end - offset;
+}
+
+#define GlobusLRangeHeight(ent) ((ent) ? (ent)->height : 0)
+#define GlobusLRangeCount(ent) ((ent) ? (ent)->count : 0)
+
+static
+void
+globus_l_range_update(
+    globus_l_range_ent_t *              ent)
+{
+    int                                 lh = GlobusLRangeHeight(ent->left);
+    int                                 rh = GlobusLRangeHeight(ent->right);
+
+    ent->height = (lh > rh ? lh : rh) + 1;
+    ent->count = GlobusLRangeCount(ent->left) +
+        GlobusLRangeCount(ent->right) + 1;
+}
+
+static
+globus_l_range_ent_t *
+globus_l_range_rotate_right(
+    globus_l_range_ent_t *              ent)
+{
+    globus_l_range_ent_t *              left = ent->left;
+
+    ent->left = left->right;
+    left->right = ent;
+    globus_l_range_update(ent);
+    globus_l_range_update(left);
+
+    return left;
+}
+
+static
+globus_l_range_ent_t *
+globus_l_range_rotate_left(
+    globus_l_range_ent_t *              ent)
+{
+    globus_l_range_ent_t *              right = ent->right;
+
+    ent->right = right->left;
+    right->left = ent;
+    globus_l_range_update(ent);
+    globus_l_range_update(right);
+
+    return right;
+}
+
+static
+globus_l_range_ent_t *
+globus_l_range_balance(
+    globus_l_range_ent_t *              ent)
+{
+    int                                 balance;
+
+    globus_l_range_update(ent);
+    balance = GlobusLRangeHeight(ent->left) - GlobusLRangeHeight(ent->right);
+    if(balance > 1)
+    {
+        if(GlobusLRangeHeight(ent->left->left) <
+            GlobusLRangeHeight(ent->left->right))
+        {
+            ent->left = globus_l_range_rotate_left(ent->left);
+        }
+        ent = globus_l_range_rotate_right(ent);
+    }
+    else if(balance < -1)
+    {
+        if(GlobusLRangeHeight(ent->right->right) <
+            GlobusLRangeHeight(ent->right->left))
+        {
+            ent->right = globus_l_range_rotate_right(ent->right);
+        }
+        ent = globus_l_range_rotate_left(ent);
+    }
+
+    return ent;
+}
+
+static
+globus_l_range_ent_t *
+globus_l_range_insert_ent(
+    globus_l_range_ent_t *              root,
+    globus_l_range_ent_t *              new_ent)
+{
+    if(root == NULL)
+    {
+        new_ent->left = NULL;
+        new_ent->right = NULL;
+        globus_l_range_update(new_ent);
+        return new_ent;
+    }
+    if(new_ent->offset < root->offset)
+    {
+        root->left = globus_l_range_insert_ent(root->left, new_ent);
+    }
+    else
+    {
+        root->right = globus_l_range_insert_ent(root->right, new_ent);
+    }
+
+    return globus_l_range_balance(root);
+}
+
+static
+globus_l_range_ent_t *
+globus_l_range_remove_min(
+    globus_l_range_ent_t *              root,
+    globus_l_range_ent_t **             min)
+{
+    if(root->left == NULL)
+    {
+        *min = root;
+        return root->right;
+    }
+    root->left = globus_l_range_remove_min(root->left, min);
+
+    return globus_l_range_balance(root);
+}
+
+/* unlink the entry at offset from the tree, it is not freed */
+static
+globus_l_range_ent_t *
+globus_l_range_remove_ent(
+    globus_l_range_ent_t *              root,
+    globus_off_t                        offset)
+{
+    globus_l_range_ent_t *              min;
+
+    if(root == NULL)
+    {
+        return NULL;
+    }
+    if(offset < root->offset)
+    {
+        root->left = globus_l_range_remove_ent(root->left, offset);
+    }
+    else if(offset > root->offset)
+    {
+        root->right = globus_l_range_remove_ent(root->right, offset);
+    }
+    else
+    {
+        if(root->right == NULL)
+        {
+            return root->left;
+        }
+        root->right = globus_l_range_remove_min(root->right, &min);
+        min->left = root->left;
+        min->right = root->right;
+        root = min;
+    }
+
+    return globus_l_range_balance(root);
+}
+
+/* the last range starting at or before offset (or strictly before it) */
+static
+globus_l_range_ent_t *
+globus_l_range_floor(
+    globus_l_range_ent_t *              root,
+    globus_off_t                        offset,
+    globus_bool_t                       strict)
+{
+    globus_l_range_ent_t *              found = NULL;
+
+    while(root != NULL)
+    {
+        if(root->offset < offset || (!strict && root->offset == offset))
+        {
+            found = root;
+            root = root->right;
+        }
+        else
+        {
+            root = root->left;
+        }
+    }
+
+    return found;
+}
+
+static
+globus_l_range_ent_t *
+globus_l_range_select(
+    globus_l_range_ent_t *              root,
+    int                                 ndx)
+{
+    int                                 left_count;
+
+    while(root != NULL)
+    {
+        left_count = GlobusLRangeCount(root->left);
+        if(ndx < left_count)
+        {
+            root = root->left;
+        }
+        else if(ndx > left_count)
+        {
+            ndx -= left_count + 1;
+            root = root->right;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return root;
+}
+
+static
+void
+globus_l_range_free(
+    globus_l_range_ent_t *              root)
+{
+    if(root != NULL)
+    {
+        globus_l_range_free(root->left);
+        globus_l_range_free(root->right);
+        globus_free(root);
+    }
+}
+
+static
+globus_l_range_ent_t *
+globus_l_range_clone(
+    globus_l_range_ent_t *              root,
+    globus_bool_t *                     failed)
+{
+    globus_l_range_ent_t *              ent;
+
+    if(root == NULL || *failed)
+    {
+        return NULL;
+    }
+    ent = (globus_l_range_ent_t *) globus_malloc(sizeof(globus_l_range_ent_t));
+    if(ent == NULL)
+    {
+        *failed = GLOBUS_TRUE;
+        return NULL;
+    }
+    *ent = *root;
+    ent->left = globus_l_range_clone(root->left, failed);
+    ent->right = globus_l_range_clone(root->right, failed);
+
+    return ent;
+}
+
+/* insert every range in src into range_list */
+static
+void
+globus_l_range_insert_all(
+    globus_range_list_t                 range_list,
+    globus_l_range_ent_t *              src)
+{
+    if(src != NULL)
+    {
+        globus_l_range_insert_all(range_list, src->left);
+        globus_range_list_insert(range_list, src->offset, src->length);
+        globus_l_range_insert_all(range_list, src->right);
+    }
+}
+
 int
 globus_range_list_init(
     globus_range_list_t *               range_list)
@@ -59,10 +351,7 @@ globus_range_list_merge_destructive(
     globus_range_list_t                 src2)
 {
     globus_l_range_list_t *             tmp_dst;
-    globus_l_range_ent_t *              ent1 = NULL;
-    globus_l_range_ent_t *              ent2 = NULL;
-    int                                 size_inc = 0;
-    int                                 ent2_size = 0;
+    globus_l_range_ent_t *              other;
     int                                 rc;
 
     if(src1 == NULL || src2 == NULL)
@@ -74,152 +363,30 @@ globus_range_list_merge_destructive(
     {
         return -1;
     }
-    
-    if(src1->head == NULL)
-    {
-        tmp_dst->head = src2->head;
-        tmp_dst->size = src2->size;
-    }
-    else if(src2->head == NULL)
-    {
-        tmp_dst->head = src1->head;
-        tmp_dst->size = src1->size;
-    }
-    else if(src1->head->offset <= src2->head->offset)
+
+    /* take over the larger tree and insert the smaller one into it */
+    if(GlobusLRangeCount(src1->root) >= GlobusLRangeCount(src2->root))
     {
-        tmp_dst->head = src1->head;
-        tmp_dst->size = src1->size;
-        ent1 = src1->head;
-        ent2 = src2->head;
-        ent2_size = src2->size;
+        tmp_dst->root = src1->root;
+        other = src2->root;
     }
     else
     {
-        tmp_dst->head = src2->head;
-        tmp_dst->size = src2->size;
-        ent1 = src2->head;
-        ent2 = src1->head;
-        ent2_size = src1->size;
+        tmp_dst->root = src2->root;
+        other = src1->root;
     }
 
     /* we're going to move or free every entry... null out the source lists
     so the user can destroy or reuse them safely */
-    src1->head = NULL;
-    src2->head = NULL;
-    src1->size = 0;
-    src2->size = 0;
-
-    if(ent1 && ent2)
-    {
-        globus_l_range_ent_t *              curr1;
-        globus_l_range_ent_t *              curr2;
-        globus_l_range_ent_t *              prev;
-        globus_l_range_ent_t *              next;
-        globus_off_t                        curr1_end;
-        globus_off_t                        curr2_end;
-        globus_bool_t                       done = GLOBUS_FALSE;
-
-        while(ent2)
-        {
-            curr2 = ent2;
-            if(curr2->length == GLOBUS_RANGE_LIST_MAX)
-            {
-                curr2_end = GLOBUS_RANGE_LIST_MAX;
-            }
-            else
-            {
-                curr2_end = curr2->offset + curr2->length;
-            }
-            prev = NULL;
-            while(ent1 != NULL && !done)
-            {
-                curr1 = ent1;
-                if(curr1->length == GLOBUS_RANGE_LIST_MAX)
-                {
-                    curr1_end = GLOBUS_RANGE_LIST_MAX;
-                }
-                else
-                {
-                    curr1_end = curr1->offset + curr1->length;
-                }
-                next = curr1->next;
-                /* if it is discontigous and in front of this one - this if
-                   will not be entered on the first iteration */
-                if(curr2_end < curr1->offset &&
-                    curr2_end != GLOBUS_RANGE_LIST_MAX)
-                {
-                    prev->next = curr2;
-                    ent2 = curr2->next;
-                    curr2->next = curr1;
-                    ent1 = curr2;
-                    done = GLOBUS_TRUE;
-                    size_inc++;
-                }
-                /* if it is merging */
-                else if((curr2_end >= curr1->offset ||
-                    curr2_end == GLOBUS_RANGE_LIST_MAX)
-                    && (curr2->offset <= curr1_end ||
-                    curr1_end == GLOBUS_RANGE_LIST_MAX))
-                {
-                    if(curr2->offset < curr1->offset)
-                    {
-                        curr1->offset = curr2->offset;
-                    }
-                    if(curr2_end == GLOBUS_RANGE_LIST_MAX ||
-                        curr1_end == GLOBUS_RANGE_LIST_MAX)
-                    {
-                        curr1->length = GLOBUS_RANGE_LIST_MAX;
-                    }
-                    else if(curr2_end > curr1_end)
-                    {
-                        curr1->length = curr2_end - curr1->offset;
-                    }
-                    if(next != NULL && curr2_end >= next->offset)
-                    {
-                        if(next->length == GLOBUS_RANGE_LIST_MAX)
-                        {
-                            curr1->length = GLOBUS_RANGE_LIST_MAX;
-                        } 
-                        else
-                        {
-                            curr1->length =
-                                next->offset + next->length - curr1->offset;
-                        }
-                        size_inc--;
-                        curr1->next = next->next;
-                        globus_free(next);
-                    } 
-                    ent2 = curr2->next;
-                    globus_free(curr2);
-                    ent1 = curr1;
-                    done = GLOBUS_TRUE;
-                }
-                else
-                {   
-                    prev = curr1;
-                    ent1 = curr1->next;
-                }
-            }      
-            /* must be last entry - if we hit this, we can just point
-               prev->next to curr2 (ent2) and thats it */
-            if(!done)
-            {       
-                prev->next = curr2;
-                ent2 = NULL;
-                size_inc += ent2_size;
-            }       
-            else    
-            {   
-                ent2_size--;
-                done = GLOBUS_FALSE;
-            }   
-        }           
-        tmp_dst->size += size_inc;
-    }
-    
-    *dest = tmp_dst;               
+    src1->root = NULL;
+    src2->root = NULL;
+
+    globus_l_range_insert_all(tmp_dst, other);
+    globus_l_range_free(other);
+
+    *dest = tmp_dst;
     return GLOBUS_SUCCESS;
-}                   
+}
 
 int
 globus_range_list_copy(
@@ -228,9 +395,7 @@ globus_range_list_copy(
 {
     int                                 rc;
     globus_l_range_list_t *             tmp_dst;
-    globus_l_range_ent_t *              prev = NULL;
-    globus_l_range_ent_t *              dst_ent;
-    globus_l_range_ent_t *              src_ent;
+    globus_bool_t                       failed = GLOBUS_FALSE;
 
     if(src == NULL)
     {
@@ -243,33 +408,12 @@ globus_range_list_copy(
         return -1;
     }
 
-    src_ent = src->head;        
-    while(src_ent != NULL)
+    tmp_dst->root = globus_l_range_clone(src->root, &failed);
+    if(failed)
     {
-        dst_ent = (globus_l_range_ent_t *) 
-            globus_malloc(sizeof(globus_l_range_ent_t));
-        if(dst_ent == NULL)
-        {
-            goto err;
-        }
-        dst_ent->offset = src_ent->offset;
-        dst_ent->length = src_ent->length;
-        dst_ent->next = NULL;
-        
-        if(tmp_dst->head != NULL)
-        {
-            prev->next = dst_ent;
-        }
-        else
-        {
-            tmp_dst->head = dst_ent;
-        }
-        
-        prev = dst_ent;
-        src_ent = src_ent->next;
+        goto err;
     }
-    tmp_dst->size = src->size;
-    
+
     *dest = tmp_dst;    
     return GLOBUS_SUCCESS;
 
@@ -285,64 +429,64 @@ globus_range_list_merge(
     globus_range_list_t                 src2)
 {
     int                                 rc;
-    globus_range_list_t                 src1_tmp;
-    globus_range_list_t                 src2_tmp;
+    globus_range_list_t                 tmp_dst;
 
-    if(src1 == NULL && src2 == NULL)
+    if(src1 == NULL || src2 == NULL)
     {
         return -1;
     }
-    
-    rc = globus_range_list_copy(&src1_tmp, src1);
-    if(rc != 0)
+
+    /* copy the larger list and insert the smaller one into the copy */
+    if(GlobusLRangeCount(src1->root) < GlobusLRangeCount(src2->root))
     {
-        return -1;
+        globus_range_list_t             tmp = src1;
+
+        src1 = src2;
+        src2 = tmp;
     }
-    
-    rc = globus_range_list_copy(&src2_tmp, src2);
+
+    rc = globus_range_list_copy(&tmp_dst, src1);
     if(rc != 0)
     {
-        goto err1;
+        return -1;
     }
-    
-    rc = globus_range_list_merge_destructive(dest, src1_tmp, src2_tmp);
+
+    rc = globus_range_list_merge_into(tmp_dst, src2);
     if(rc != 0)
     {
-        goto err2;
+        globus_range_list_destroy(tmp_dst);
+        return -1;
     }
-    
-    globus_range_list_destroy(src2_tmp);   
-    globus_range_list_destroy(src1_tmp);
-    
-    return GLOBUS_SUCCESS;
 
-err2:
-    globus_range_list_destroy(src2_tmp);   
-err1:
-    globus_range_list_destroy(src1_tmp);   
-    return -1;
+    *dest = tmp_dst;
+    return GLOBUS_SUCCESS;
 }
 
+int
+globus_range_list_merge_into(
+    globus_range_list_t                 range_list,
+    globus_range_list_t                 src)
+{
+    if(range_list == NULL || src == NULL)
+    {
+        return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
+    }
+
+    globus_l_range_insert_all(range_list, src->root);
+
+    return GLOBUS_SUCCESS;
+}
 
 void
 globus_range_list_destroy(
     globus_range_list_t                 range_list)
 {
-    globus_l_range_ent_t *              i;
-    globus_l_range_ent_t *              j;
-
     if(range_list == NULL)
     {
         return;
     }
 
-    i = range_list->head;
-    while(i != NULL)
-    {
-        j = i;
-        i = i->next;
-        globus_free(j);
-    }
+    globus_l_range_free(range_list->root);
     globus_free(range_list);
 }
 
@@ -352,13 +496,10 @@ globus_range_list_insert(
     globus_off_t                        offset,
     globus_off_t                        length)
 {
-    globus_l_range_ent_t *              prev;
     globus_l_range_ent_t *              ent;
-    globus_l_range_ent_t *              next;
-    globus_l_range_ent_t *              new_ent;
+    globus_l_range_ent_t *              new_ent = NULL;
     globus_off_t                        end_offset;
     globus_off_t                        ent_end;
-    globus_bool_t                       done = GLOBUS_FALSE;
 
     if(offset < 0)
     {
@@ -368,116 +509,41 @@ globus_range_list_insert(
     {
         return GLOBUS_SUCCESS;
     }
-    
-    if(range_list->head == NULL)
-    {
-        new_ent = (globus_l_range_ent_t *) globus_malloc(
-            sizeof(globus_l_range_ent_t));
-        if(new_ent == NULL)
-        {
-            globus_assert(0);
-        }
-        new_ent->offset = offset;
-        new_ent->length = length;
-        new_ent->next = NULL;
-        range_list->head = new_ent;
-        range_list->size = 1;
-        
-        return GLOBUS_SUCCESS;
-    }
 
-    if(length == GLOBUS_RANGE_LIST_MAX)
-    {
-        end_offset = GLOBUS_RANGE_LIST_MAX;
-    }
-    else
-    {
-        end_offset = offset + length;
-    }
+    end_offset = globus_l_range_end(offset, length);
 
-    prev = NULL;
-    ent = range_list->head;
-    while(ent != NULL && !done)
+    /* absorb every range that overlaps or touches the new one, starting
+     * with the last one beginning at or before its end
+     */
+    while((ent = globus_l_range_floor(
+                range_list->root, end_offset, GLOBUS_FALSE)) != NULL)
     {
-        if(ent->length == GLOBUS_RANGE_LIST_MAX)
+        ent_end = globus_l_range_end(ent->offset, ent->length);
+        if(ent_end < offset)
         {
-            ent_end = GLOBUS_RANGE_LIST_MAX;
+            break;
         }
-        else
+        if(ent->offset < offset)
         {
-            ent_end = ent->offset + ent->length;
+            offset = ent->offset;
         }
-        next = ent->next;
-        /* if it is discontigous and in front of this one */
-        if(end_offset < ent->offset && end_offset != GLOBUS_RANGE_LIST_MAX)
+        if(ent_end > end_offset)
         {
-            new_ent = (globus_l_range_ent_t *) globus_malloc(
-                sizeof(globus_l_range_ent_t));
-            if(new_ent == NULL)
-            {
-                globus_assert(0);
-            }
-            new_ent->offset = offset;
-            new_ent->length = length;
-            new_ent->next = ent;
-            if(prev == NULL)
-            {
-                range_list->head = new_ent;
-            }
-            else
-            {
-                prev->next = new_ent;
-            }
-            range_list->size++;
-            done = GLOBUS_TRUE;
+            end_offset = ent_end;
         }
-        /* if it is merging */
-        else if((end_offset >= ent->offset || 
-            end_offset == GLOBUS_RANGE_LIST_MAX) 
-            && (offset <= ent_end || 
-            ent_end == GLOBUS_RANGE_LIST_MAX))
+        range_list->root = globus_l_range_remove_ent(
+            range_list->root, ent->offset);
+        if(new_ent == NULL)
         {
-            if(offset < ent->offset)
-            {
-                if(ent->length != GLOBUS_RANGE_LIST_MAX)
-                {
-                    ent->length += ent->offset - offset;
-                }
-                ent->offset = offset;
-            }
-            if(end_offset == GLOBUS_RANGE_LIST_MAX || 
-                ent_end == GLOBUS_RANGE_LIST_MAX)
-            {
-                ent->length = GLOBUS_RANGE_LIST_MAX;
-            }
-            else if(end_offset > ent_end)
-            {
-                ent->length = end_offset - ent->offset;
-            }
-            if(next != NULL && end_offset >= next->offset)
-            {
-                if(next->length == GLOBUS_RANGE_LIST_MAX)
-                {
-                    ent->length = GLOBUS_RANGE_LIST_MAX;    
-                }
-                else
-                {   
-                    ent->length = next->offset + next->length - ent->offset;
-                }
-                range_list->size--;
-                ent->next = next->next;
-                globus_free(next);
-            }
-            done = GLOBUS_TRUE;
+            new_ent = ent;
         }
         else
         {
-            prev = ent;
-            ent = ent->next;
+            globus_free(ent);
         }
     }
-    /* must be last entry */
-    if(!done)
+
+    if(new_ent == NULL)
     {
         new_ent = (globus_l_range_ent_t *) globus_malloc(
             sizeof(globus_l_range_ent_t));
@@ -485,14 +551,10 @@ globus_range_list_insert(
         {
             globus_assert(0);
         }
-        new_ent->offset = offset;
-        new_ent->length = length;
-        new_ent->next = ent;
-
-        globus_assert(prev != NULL);
-        prev->next = new_ent;
-        range_list->size++;
     }
+    new_ent->offset = offset;
+    new_ent->length = globus_l_range_length(offset, end_offset);
+    range_list->root = globus_l_range_insert_ent(range_list->root, new_ent);
 
     return GLOBUS_SUCCESS;
 }
@@ -503,13 +565,10 @@ globus_range_list_remove(
     globus_off_t                        offset,
     globus_off_t                        length)
 {
-    globus_l_range_ent_t *              prev;
     globus_l_range_ent_t *              ent;
-    globus_l_range_ent_t *              next;
     globus_l_range_ent_t *              new_ent;
     globus_off_t                        end_offset;
     globus_off_t                        ent_end;
-    globus_bool_t                       done = GLOBUS_FALSE;
 
     if(offset < 0)
     {
@@ -520,102 +579,60 @@ globus_range_list_remove(
         return GLOBUS_SUCCESS;
     }
 
-    if(length == GLOBUS_RANGE_LIST_MAX)
-    {
-        end_offset = GLOBUS_RANGE_LIST_MAX;
-    }
-    else
-    {
-        end_offset = offset + length;
-    }
-    prev = NULL;
-    ent = range_list->head;
-    while(ent != NULL && !done)
+    end_offset = globus_l_range_end(offset, length);
+
+    /* walk back from the last range starting before the end of the foul
+     * range until we reach one that ends before it starts
+     */
+    while((ent = globus_l_range_floor(
+                range_list->root, end_offset, GLOBUS_TRUE)) != NULL)
     {
-        next = ent->next;
-        if(ent->length == GLOBUS_RANGE_LIST_MAX)
-        {
-            ent_end = GLOBUS_RANGE_LIST_MAX;
-        }
-        else
+        ent_end = globus_l_range_end(ent->offset, ent->length);
+        if(ent_end <= offset)
         {
-            ent_end = ent->offset + ent->length;
+            break;
         }
-        
-        /* this range is all foul, remove it */
-        if(ent->offset >= offset && 
-            ((ent_end <= end_offset && ent_end != GLOBUS_RANGE_LIST_MAX) || 
-            end_offset == GLOBUS_RANGE_LIST_MAX))
+
+        if(ent->offset >= offset)
         {
-            if(prev == NULL)
+            if(ent_end <= end_offset)
             {
-                range_list->head = next;
+                /* this range is all foul, remove it */
+                range_list->root = globus_l_range_remove_ent(
+                    range_list->root, ent->offset);
+                globus_free(ent);
             }
             else
             {
-                prev->next = next;
+                /* this range starts foul and extends fair, adjust offset.
+                 * it stays between its neighbours, so the tree is still
+                 * in order
+                 */
+                ent->offset = end_offset;
+                ent->length = globus_l_range_length(end_offset, ent_end);
             }
-            range_list->size--;
-            globus_free(ent);
         }
-        /* this range starts fair and extends foul, adjust length */
-        else if(ent->offset < offset && 
-            ((ent_end < end_offset && ent_end != GLOBUS_RANGE_LIST_MAX) ||
-                end_offset == GLOBUS_RANGE_LIST_MAX) && 
-            (ent_end > offset || ent_end == GLOBUS_RANGE_LIST_MAX))
-        {   
-            ent->length = offset - ent->offset;
-            prev = ent;
-        }
-        /* this range starts foul and extends fair, adjust offset */
-        else if(ent->offset >= offset && ent->offset < end_offset &&
-            ((ent_end > end_offset && end_offset != GLOBUS_RANGE_LIST_MAX) || 
-                ent_end == GLOBUS_RANGE_LIST_MAX))
-        {
-            ent->offset = end_offset;
-            prev = ent;
-            done = GLOBUS_TRUE;
-        }
-        /* this range starts fair and ends fair, but crosses foul,
-             adjust offset and length */
-        else if(ent->offset < offset && 
-            ((ent_end > end_offset && end_offset != GLOBUS_RANGE_LIST_MAX) || 
-            ent_end == GLOBUS_RANGE_LIST_MAX))
-        {
-            new_ent = (globus_l_range_ent_t *) globus_malloc(
-                sizeof(globus_l_range_ent_t));
-            if(new_ent == NULL)
-            {
-                globus_assert(0);
-            }
-            new_ent->next = NULL;
-            new_ent->offset = end_offset;
-            if(ent_end == GLOBUS_RANGE_LIST_MAX)
-            {
-                new_ent->length = GLOBUS_RANGE_LIST_MAX;    
-            }
-            else
-            {   
-                new_ent->length = ent_end - new_ent->offset;
-            }
-            ent->length = offset - ent->offset;
-            ent->next = new_ent;
-    
-            range_list->size++;
-            
-            prev = ent;
-            done = GLOBUS_TRUE;
-        }
-        /* this range is all fair */
         else
         {
-            if(ent->offset > end_offset && end_offset != GLOBUS_RANGE_LIST_MAX)
+            /* this range starts fair, trim it, and split off what
+             * extends fair past the end
+             */
+            ent->length = offset - ent->offset;
+            if(ent_end > end_offset)
             {
-                done = GLOBUS_TRUE;
+                new_ent = (globus_l_range_ent_t *) globus_malloc(
+                    sizeof(globus_l_range_ent_t));
+                if(new_ent == NULL)
+                {
+                    globus_assert(0);
+                }
+                new_ent->offset = end_offset;
+                new_ent->length = globus_l_range_length(end_offset, ent_end);
+                range_list->root = globus_l_range_insert_ent(
+                    range_list->root, new_ent);
             }
-            prev = ent;
+            break;
         }
-        ent = next;
     }
 
     return GLOBUS_SUCCESS;
@@ -630,7 +647,7 @@ globus_range_list_size(
         return 0;
     }
 
-    return range_list->size;
+    return GlobusLRangeCount(range_list->root);
 }
 
 int
@@ -640,7 +657,6 @@ globus_range_list_at(
     globus_off_t *                      offset,
     globus_off_t *                      length)
 {
-    int                                 ctr;
     globus_l_range_ent_t *              i;
 
     if(range_list == NULL)
@@ -656,14 +672,10 @@ globus_range_list_at(
         return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
     }
 
-    i = range_list->head;
-    for(ctr = 0; ctr < ndx; ctr++)
+    i = globus_l_range_select(range_list->root, ndx);
+    if(i == NULL)
     {
-        if(i == NULL)
-        {
-            return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
-        }
-        i = i->next;
+        return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
     }
 
     *offset = i->offset;
@@ -679,9 +691,7 @@ globus_range_list_remove_at(
     globus_off_t *                      offset,
     globus_off_t *                      length)
 {
-    int                                 ctr;
     globus_l_range_ent_t *              i;
-    globus_l_range_ent_t *              prev;
 
     if(range_list == NULL)
     {
@@ -696,34 +706,14 @@ globus_range_list_remove_at(
         return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
     }
 
-    prev = NULL;
-    i = range_list->head;
-    for(ctr = 0; ctr < ndx; ctr++)
-    {
-        if(i == NULL)
-        {
-            return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
-        }
-        prev = i;
-        i = i->next;
-    }
-
+    i = globus_l_range_select(range_list->root, ndx);
     if(i == NULL)
     {
         return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
     }
 
-    if(prev == NULL)
-    {
-        range_list->head = i->next;
-    }
-    else
-    {
-        prev->next = i->next;
-    }
+    range_list->root = globus_l_range_remove_ent(range_list->root, i->offset);
 
-    range_list->size--;
-    
     *offset = i->offset;
     *length = i->length;
     globus_free(i);
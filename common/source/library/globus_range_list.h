@@ -61,6 +61,15 @@ globus_range_list_merge(
     globus_range_list_t                 src1,
     globus_range_list_t                 src2);
 
+/* merge every range of src into range_list in place.  src is unchanged.
+ * cheaper than globus_range_list_merge() when range_list is the larger
+ * list, as it is not copied.
+ */
+int
+globus_range_list_merge_into(
+    globus_range_list_t                 range_list,
+    globus_range_list_t                 src);
+
 int
 globus_range_list_copy(
     globus_range_list_t *               dest,
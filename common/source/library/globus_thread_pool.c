@@ -17,7 +17,7 @@
 #include "globus_common_include.h"
 #include "globus_thread_pool.h"
 #include "version.h"
-#include "globus_fifo.h"
+#include "globus_list.h"
 #include "globus_time.h"
 #include "globus_libc.h"
 #include "globus_callback.h"
@@ -30,27 +30,79 @@
 #define MAX_IDLE_THREADS                     32
 #define TOO_MANY_IDLE_TIMEOUT		     30
 
+/* Number of times an idle thread scans the queues, yielding in between,
+ * before parking on the condition variable. Tasks submitted in bursts are
+ * then picked up without a trip through the kernel.
+ */
+#define GLOBUS_L_THREAD_POOL_SPIN            64
+
+/* Each pool thread (up to GLOBUS_L_THREAD_POOL_MAX_DEQUES of them) owns a
+ * fixed-size deque. Tasks started from a pool thread are pushed onto its
+ * own deque without locking, and idle threads steal from the other end.
+ * Tasks started from other threads, or from a thread whose deque is full,
+ * go on the shared injection queue.
+ */
+#define GLOBUS_L_THREAD_POOL_MAX_DEQUES      64
+#define GLOBUS_L_THREAD_POOL_DEQUE_SIZE      256
+#define GLOBUS_L_THREAD_POOL_DEQUE_MASK      (GLOBUS_L_THREAD_POOL_DEQUE_SIZE-1)
+
+typedef struct globus_l_thread_pool_task_s
+{
+    globus_thread_func_t                func; 
+    void *                              func_user_arg;
+    struct globus_l_thread_pool_task_s * next;
+} globus_l_thread_pool_task_t;
 
-/* Task Queue Management. Threads execute tasks from the task queue, waiting
- * on the task queue condition variable when there's nothing for them to do.
+/* Chase-Lev work-stealing deque. The owner pushes and pops at bottom,
+ * thieves take from top. Tasks are stored by value, so nothing is
+ * allocated for them.
  */
-globus_mutex_t                            globus_l_thread_pool_q_mutex;
-globus_cond_t				              globus_l_thread_pool_q_cond;
-globus_fifo_t                             globus_l_thread_pool_q;
-volatile int                              globus_l_thread_pool_pending_tasks;
-
-/* Thread Counts. We count threads so that we don't destroy the task queue until
- * everything's completed. Each thread shows up in one of these lists. Idle threads
- * are in their condition wait loop, and active threads are executing tasks.
+typedef struct
+{
+    int64_t                             top;
+    char                                pad1[64 - sizeof(int64_t)];
+    int64_t                             bottom;
+    char                                pad2[64 - sizeof(int64_t)];
+    struct
+    {
+        globus_thread_func_t            func;
+        void *                          func_user_arg;
+    }                                   tasks[GLOBUS_L_THREAD_POOL_DEQUE_SIZE];
+    globus_bool_t                       in_use;
+} globus_l_thread_pool_deque_t;
+
+/* Thread and task accounting. Threads park on the condition variable when
+ * there's nothing for them to do. The mutex only protects parking, thread
+ * exit and deque ownership; the counters are updated atomically.
+ *
+ * spare is the number of idle threads that no queued task has been promised
+ * to; a task is only queued when it can reserve one of them, otherwise a new
+ * thread is created for it.
  */
-volatile int                              globus_l_thread_pool_idle_threads;
-volatile int                              globus_l_thread_pool_active_threads;
+static globus_mutex_t                   globus_l_thread_pool_q_mutex;
+static globus_cond_t                    globus_l_thread_pool_q_cond;
+static int                              globus_l_thread_pool_spare;
+static int                              globus_l_thread_pool_queued;
+static int                              globus_l_thread_pool_parked;
+static int                              globus_l_thread_pool_idle_threads;
+static int                              globus_l_thread_pool_threads;
+
+/* Shared injection queue and its pool of task nodes */
+static globus_mutex_t                   globus_l_thread_pool_inject_mutex;
+static globus_l_thread_pool_task_t *    globus_l_thread_pool_inject_head;
+static globus_l_thread_pool_task_t **   globus_l_thread_pool_inject_tail;
+static globus_l_thread_pool_task_t *    globus_l_thread_pool_free_tasks;
+
+static globus_l_thread_pool_deque_t     globus_l_thread_pool_deques[
+                                            GLOBUS_L_THREAD_POOL_MAX_DEQUES];
+static int                              globus_l_thread_pool_deque_count;
+static globus_thread_key_t              globus_l_thread_pool_deque_key;
 
 /* Condition variable to indicate to deactivation function that all threads are
  * done.
  */
-globus_cond_t				  globus_l_thread_pool_shutdown_cond;
-volatile int				  globus_l_thread_pool_done;
+static globus_cond_t                    globus_l_thread_pool_shutdown_cond;
+static int                              globus_l_thread_pool_done;
 
 /* Thread starter function */
 void *
@@ -60,12 +112,6 @@ globus_l_thread_pool_thread_start(
 void
 globus_l_thread_pool_key_clean();
 
-typedef struct
-{
-    globus_thread_func_t                func; 
-    void *                              func_user_arg;
-} globus_l_thread_pool_task_t;
-
 typedef struct 
 {
     globus_thread_key_destructor_func_t  dest_func;
@@ -106,17 +152,32 @@ globus_i_thread_pool_activate(void)
         return rc;
     }
 
+    rc = globus_thread_key_create(&globus_l_thread_pool_deque_key, NULL);
+    if(rc != GLOBUS_SUCCESS)
+    {
+        globus_module_deactivate(GLOBUS_THREAD_MODULE);
+        return rc;
+    }
+
     globus_l_thread_pool_key_list = GLOBUS_NULL;
-    globus_fifo_init(&globus_l_thread_pool_q);
     globus_mutex_init(&globus_l_thread_pool_q_mutex, GLOBUS_NULL);
+    globus_mutex_init(&globus_l_thread_pool_inject_mutex, GLOBUS_NULL);
     globus_mutex_lock(&globus_l_thread_pool_q_mutex);
     globus_mutex_init(&globus_l_thread_pool_key_mutex, GLOBUS_NULL);
     globus_cond_init(&globus_l_thread_pool_q_cond, GLOBUS_NULL);
     globus_cond_init(&globus_l_thread_pool_shutdown_cond, GLOBUS_NULL);
+    globus_l_thread_pool_spare = 0;
+    globus_l_thread_pool_queued = 0;
+    globus_l_thread_pool_parked = 0;
     globus_l_thread_pool_idle_threads = 0;
-    globus_l_thread_pool_active_threads = 0;
+    globus_l_thread_pool_threads = 0;
     globus_l_thread_pool_done = GLOBUS_FALSE;
-    globus_l_thread_pool_pending_tasks = 0;
+    globus_l_thread_pool_inject_head = NULL;
+    globus_l_thread_pool_inject_tail = &globus_l_thread_pool_inject_head;
+    globus_l_thread_pool_free_tasks = NULL;
+    memset(globus_l_thread_pool_deques, 0,
+           sizeof(globus_l_thread_pool_deques));
+    globus_l_thread_pool_deque_count = 0;
     globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
 
     return GLOBUS_SUCCESS;
@@ -182,13 +243,15 @@ globus_l_thread_pool_key_clean()
 int
 globus_i_thread_pool_deactivate(void)
 {
+    globus_l_thread_pool_task_t *       task;
+
     globus_mutex_lock(&globus_l_thread_pool_q_mutex);
     {
-        globus_l_thread_pool_done = GLOBUS_TRUE;
+        __atomic_store_n(&globus_l_thread_pool_done, GLOBUS_TRUE,
+                         __ATOMIC_SEQ_CST);
 	globus_cond_broadcast(&globus_l_thread_pool_q_cond);
 
-        while(globus_l_thread_pool_idle_threads ||
-	      globus_l_thread_pool_active_threads)
+        while(globus_l_thread_pool_threads)
 	{
 	    globus_cond_wait(&globus_l_thread_pool_shutdown_cond,
 	                     &globus_l_thread_pool_q_mutex);
@@ -196,15 +259,257 @@ globus_i_thread_pool_deactivate(void)
     }
     globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
 
+    /* tasks still queued at shutdown are dropped, as they always were */
+    while(globus_l_thread_pool_inject_head != NULL)
+    {
+        task = globus_l_thread_pool_inject_head;
+        globus_l_thread_pool_inject_head = task->next;
+        globus_libc_free(task);
+    }
+    while(globus_l_thread_pool_free_tasks != NULL)
+    {
+        task = globus_l_thread_pool_free_tasks;
+        globus_l_thread_pool_free_tasks = task->next;
+        globus_libc_free(task);
+    }
 
-    globus_fifo_destroy(&globus_l_thread_pool_q);
     globus_mutex_destroy(&globus_l_thread_pool_q_mutex);
+    globus_mutex_destroy(&globus_l_thread_pool_inject_mutex);
     globus_mutex_destroy(&globus_l_thread_pool_key_mutex);
     globus_cond_destroy(&globus_l_thread_pool_q_cond);
+    globus_cond_destroy(&globus_l_thread_pool_shutdown_cond);
+    globus_thread_key_delete(globus_l_thread_pool_deque_key);
 
     return GLOBUS_SUCCESS;
 }
 
+/*
+ * Owner end of the deque. Returns GLOBUS_FALSE if the deque is full.
+ */
+static
+globus_bool_t
+globus_l_thread_pool_deque_push(
+    globus_l_thread_pool_deque_t *      deque,
+    globus_thread_func_t                func,
+    void *                              user_arg)
+{
+    int64_t                             bottom;
+    int64_t                             top;
+
+    bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if(bottom - top >= GLOBUS_L_THREAD_POOL_DEQUE_SIZE)
+    {
+        return GLOBUS_FALSE;
+    }
+
+    __atomic_store_n(
+        &deque->tasks[bottom & GLOBUS_L_THREAD_POOL_DEQUE_MASK].func,
+        func, __ATOMIC_RELAXED);
+    __atomic_store_n(
+        &deque->tasks[bottom & GLOBUS_L_THREAD_POOL_DEQUE_MASK].func_user_arg,
+        user_arg, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+
+    return GLOBUS_TRUE;
+}
+
+/*
+ * Owner end of the deque, newest task first.
+ */
+static
+globus_bool_t
+globus_l_thread_pool_deque_pop(
+    globus_l_thread_pool_deque_t *      deque,
+    globus_thread_func_t *              func,
+    void **                             user_arg)
+{
+    int64_t                             bottom;
+    int64_t                             top;
+    globus_bool_t                       found = GLOBUS_FALSE;
+
+    bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if(top <= bottom)
+    {
+        *func = __atomic_load_n(
+            &deque->tasks[bottom & GLOBUS_L_THREAD_POOL_DEQUE_MASK].func,
+            __ATOMIC_RELAXED);
+        *user_arg = __atomic_load_n(
+            &deque->tasks[bottom & GLOBUS_L_THREAD_POOL_DEQUE_MASK]
+                .func_user_arg,
+            __ATOMIC_RELAXED);
+        found = GLOBUS_TRUE;
+
+        if(top == bottom)
+        {
+            /* last task: race the thieves for it */
+            found = __atomic_compare_exchange_n(
+                &deque->top, &top, top + 1, GLOBUS_FALSE,
+                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+            __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        }
+    }
+    else
+    {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return found;
+}
+
+/*
+ * Thief end of the deque, oldest task first.
+ */
+static
+globus_bool_t
+globus_l_thread_pool_deque_steal(
+    globus_l_thread_pool_deque_t *      deque,
+    globus_thread_func_t *              func,
+    void **                             user_arg)
+{
+    int64_t                             bottom;
+    int64_t                             top;
+
+    top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if(top >= bottom)
+    {
+        return GLOBUS_FALSE;
+    }
+
+    *func = __atomic_load_n(
+        &deque->tasks[top & GLOBUS_L_THREAD_POOL_DEQUE_MASK].func,
+        __ATOMIC_RELAXED);
+    *user_arg = __atomic_load_n(
+        &deque->tasks[top & GLOBUS_L_THREAD_POOL_DEQUE_MASK].func_user_arg,
+        __ATOMIC_RELAXED);
+
+    return __atomic_compare_exchange_n(
+        &deque->top, &top, top + 1, GLOBUS_FALSE,
+        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static
+globus_l_thread_pool_task_t *
+globus_l_thread_pool_task_alloc(
+    globus_thread_func_t                func,
+    void *                              user_arg)
+{
+    globus_l_thread_pool_task_t *       task;
+
+    globus_mutex_lock(&globus_l_thread_pool_inject_mutex);
+    {
+        task = globus_l_thread_pool_free_tasks;
+        if(task != NULL)
+        {
+            globus_l_thread_pool_free_tasks = task->next;
+        }
+    }
+    globus_mutex_unlock(&globus_l_thread_pool_inject_mutex);
+
+    if(task == NULL)
+    {
+        task = (globus_l_thread_pool_task_t *)
+            globus_libc_malloc(sizeof(globus_l_thread_pool_task_t));
+        globus_assert(task != NULL);
+    }
+    task->func = func;
+    task->func_user_arg = user_arg;
+    task->next = NULL;
+
+    return task;
+}
+
+static
+void
+globus_l_thread_pool_task_free(
+    globus_l_thread_pool_task_t *       task)
+{
+    globus_mutex_lock(&globus_l_thread_pool_inject_mutex);
+    {
+        task->next = globus_l_thread_pool_free_tasks;
+        globus_l_thread_pool_free_tasks = task;
+    }
+    globus_mutex_unlock(&globus_l_thread_pool_inject_mutex);
+}
+
+/*
+ * Look for a queued task: our own deque first, then the injection queue,
+ * then the other threads' deques.
+ */
+static
+globus_bool_t
+globus_l_thread_pool_take(
+    globus_l_thread_pool_deque_t *      own,
+    globus_thread_func_t *              func,
+    void **                             user_arg)
+{
+    globus_l_thread_pool_task_t *       task = NULL;
+    int                                 count;
+    int                                 start;
+    int                                 i;
+
+    if(own != NULL && globus_l_thread_pool_deque_pop(own, func, user_arg))
+    {
+        return GLOBUS_TRUE;
+    }
+
+    if(__atomic_load_n(&globus_l_thread_pool_inject_head, __ATOMIC_RELAXED))
+    {
+        globus_mutex_lock(&globus_l_thread_pool_inject_mutex);
+        {
+            task = globus_l_thread_pool_inject_head;
+            if(task != NULL)
+            {
+                globus_l_thread_pool_inject_head = task->next;
+                if(globus_l_thread_pool_inject_head == NULL)
+                {
+                    globus_l_thread_pool_inject_tail =
+                        &globus_l_thread_pool_inject_head;
+                }
+                *func = task->func;
+                *user_arg = task->func_user_arg;
+                task->next = globus_l_thread_pool_free_tasks;
+                globus_l_thread_pool_free_tasks = task;
+            }
+        }
+        globus_mutex_unlock(&globus_l_thread_pool_inject_mutex);
+
+        if(task != NULL)
+        {
+            return GLOBUS_TRUE;
+        }
+    }
+
+    count = __atomic_load_n(
+        &globus_l_thread_pool_deque_count, __ATOMIC_ACQUIRE);
+    if(count == 0)
+    {
+        return GLOBUS_FALSE;
+    }
+    /* spread the thieves out over the deques */
+    start = own ? (int) (own - globus_l_thread_pool_deques) + 1 : 0;
+    for(i = 0; i < count; i++)
+    {
+        globus_l_thread_pool_deque_t *  victim;
+
+        victim = &globus_l_thread_pool_deques[(start + i) % count];
+        if(victim != own &&
+           globus_l_thread_pool_deque_steal(victim, func, user_arg))
+        {
+            return GLOBUS_TRUE;
+        }
+    }
+
+    return GLOBUS_FALSE;
+}
+
 /*
  * This is the code that the threads in the thread pool execute.
  * User thread functions are dispatched here.
@@ -214,99 +519,184 @@ globus_l_thread_pool_thread_start(
     void *                                      user_arg)
 {
     globus_l_thread_pool_task_t *               task;
+    globus_l_thread_pool_deque_t *              deque = NULL;
+    globus_thread_func_t                        func;
+    void *                                      func_user_arg;
     globus_abstime_t                            timeout;
     globus_bool_t                               first = GLOBUS_TRUE;
-   
+    globus_bool_t                               found;
+    int                                         spare;
+    int                                         rc;
+    int                                         i;
+
+    /* Claim a deque, if there are any left */
+    globus_mutex_lock(&globus_l_thread_pool_q_mutex);
+    {
+        for(i = 0; i < GLOBUS_L_THREAD_POOL_MAX_DEQUES; i++)
+        {
+            if(!globus_l_thread_pool_deques[i].in_use)
+            {
+                deque = &globus_l_thread_pool_deques[i];
+                deque->in_use = GLOBUS_TRUE;
+                if(i >= globus_l_thread_pool_deque_count)
+                {
+                    __atomic_store_n(&globus_l_thread_pool_deque_count,
+                                     i + 1, __ATOMIC_RELEASE);
+                }
+                break;
+            }
+        }
+    }
+    globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
+    globus_thread_setspecific(globus_l_thread_pool_deque_key, deque);
+
     /* Handle the task we were created to do */
     task = (globus_l_thread_pool_task_t *) user_arg;
-    task->func(task->func_user_arg);
+    func = task->func;
+    func_user_arg = task->func_user_arg;
+    globus_l_thread_pool_task_free(task);
+    task = GLOBUS_NULL;
+
+    func(func_user_arg);
     globus_thread_blocking_reset();
     globus_l_thread_pool_key_clean();
-    globus_libc_free(task);
-    task = GLOBUS_NULL;
 
     /* Now enter the thread pool */
-    globus_mutex_lock(&globus_l_thread_pool_q_mutex);
-
-    globus_l_thread_pool_active_threads--;
-    globus_l_thread_pool_idle_threads++;
-
-    while(!globus_l_thread_pool_done)
+    while(!__atomic_load_n(&globus_l_thread_pool_done, __ATOMIC_ACQUIRE))
     {
+        __atomic_add_fetch(
+            &globus_l_thread_pool_idle_threads, 1, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&globus_l_thread_pool_spare, 1, __ATOMIC_SEQ_CST);
 
-        /* If there is nothing to do, and there are plenty of idle threads
-         * then we'll give up this thread after a timeout if nothing new
-         * shows up.
-         */
-        if(globus_fifo_empty(&globus_l_thread_pool_q) &&
-           globus_l_thread_pool_idle_threads > MAX_IDLE_THREADS &&
-           !first)
-        {
-            GlobusTimeAbstimeSet(timeout, TOO_MANY_IDLE_TIMEOUT, 0);
-        }
-        else
+        /* Spin for a while before parking */
+        found = GLOBUS_FALSE;
+        for(i = 0; i < GLOBUS_L_THREAD_POOL_SPIN && !found; i++)
         {
-            timeout = globus_i_abstime_infinity;
-            first = GLOBUS_FALSE;
+            if(__atomic_load_n(&globus_l_thread_pool_queued, __ATOMIC_ACQUIRE))
+            {
+                found = globus_l_thread_pool_take(
+                    deque, &func, &func_user_arg);
+            }
+            if(!found)
+            {
+                globus_thread_yield();
+            }
         }
-    
-        errno = 0;
 
-        /* Wait for a task to become available, or timeout, or a shutdown */
-        while(errno != ETIMEDOUT &&
-              globus_fifo_empty(&globus_l_thread_pool_q) &&
-              !globus_l_thread_pool_done)
+        while(!found &&
+              !__atomic_load_n(&globus_l_thread_pool_done, __ATOMIC_ACQUIRE))
         {
-            if(globus_time_abstime_is_infinity(&timeout))
+            /* If there are plenty of idle threads then we'll give up this
+             * thread after a timeout if nothing new shows up.
+             */
+            if(__atomic_load_n(
+                   &globus_l_thread_pool_idle_threads, __ATOMIC_RELAXED)
+                    > MAX_IDLE_THREADS &&
+               !first)
+            {
+                GlobusTimeAbstimeSet(timeout, TOO_MANY_IDLE_TIMEOUT, 0);
+            }
+            else
             {
+                timeout = globus_i_abstime_infinity;
+                first = GLOBUS_FALSE;
+            }
 
-		globus_cond_wait(&globus_l_thread_pool_q_cond,
-                                 &globus_l_thread_pool_q_mutex);
+            globus_mutex_lock(&globus_l_thread_pool_q_mutex);
+            __atomic_add_fetch(
+                &globus_l_thread_pool_parked, 1, __ATOMIC_SEQ_CST);
+            rc = 0;
+
+            /* Wait for a task to become available, or timeout, or a
+             * shutdown. Submitters signal only after seeing parked, and
+             * we only wait after seeing queued, so no wakeup is lost.
+             */
+            while(rc != ETIMEDOUT &&
+                  !__atomic_load_n(
+                      &globus_l_thread_pool_queued, __ATOMIC_SEQ_CST) &&
+                  !globus_l_thread_pool_done)
+            {
+                if(globus_time_abstime_is_infinity(&timeout))
+                {
+                    globus_cond_wait(&globus_l_thread_pool_q_cond,
+                                     &globus_l_thread_pool_q_mutex);
+                }
+                else
+                {
+                    rc = globus_cond_timedwait(
+                        &globus_l_thread_pool_q_cond,
+                        &globus_l_thread_pool_q_mutex,
+                        &timeout);
+                }
             }
-	    else
-	    {
+            __atomic_sub_fetch(
+                &globus_l_thread_pool_parked, 1, __ATOMIC_SEQ_CST);
+
+            if(rc == ETIMEDOUT &&
+               !__atomic_load_n(
+                   &globus_l_thread_pool_queued, __ATOMIC_SEQ_CST) &&
+               __atomic_load_n(
+                   &globus_l_thread_pool_idle_threads, __ATOMIC_RELAXED)
+                    > MAX_IDLE_THREADS)
+            {
+                /* No task, and we timed out. Leave unless a task has
+                 * already been promised to this thread.
+                 */
+                spare = __atomic_load_n(
+                    &globus_l_thread_pool_spare, __ATOMIC_SEQ_CST);
+                while(spare > 0 &&
+                      !__atomic_compare_exchange_n(
+                          &globus_l_thread_pool_spare, &spare, spare - 1,
+                          GLOBUS_FALSE,
+                          __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+                {
+                }
+                if(spare > 0)
+                {
+                    __atomic_sub_fetch(
+                        &globus_l_thread_pool_idle_threads, 1,
+                        __ATOMIC_SEQ_CST);
+                    goto exit_locked;
+                }
+            }
+            globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
 
-	    	globus_cond_timedwait(&globus_l_thread_pool_q_cond,
-		                      &globus_l_thread_pool_q_mutex,
-				      &timeout);
-	    }
-	}
-	if(! globus_fifo_empty(&globus_l_thread_pool_q))
-	{
-            /* Execute task */
-	    globus_l_thread_pool_active_threads++;
-	    globus_l_thread_pool_idle_threads--;
-	    task = globus_fifo_dequeue(&globus_l_thread_pool_q);
-            globus_l_thread_pool_pending_tasks--;
+            found = globus_l_thread_pool_take(deque, &func, &func_user_arg);
+        }
 
-	    globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
-	    {
-		task->func(task->func_user_arg);
-                globus_thread_blocking_reset();
-                globus_l_thread_pool_key_clean();
-		globus_libc_free(task);
-	    }
-	    globus_mutex_lock(&globus_l_thread_pool_q_mutex);
-
-	    globus_l_thread_pool_idle_threads++;
-	    globus_l_thread_pool_active_threads--;
-	    timeout = globus_i_abstime_infinity;
-	}
-	else if(errno == ETIMEDOUT &&
-		globus_l_thread_pool_idle_threads > MAX_IDLE_THREADS)
-	{
-            /* No task, and we timed out */
-	    break;
-	}
+        if(!found)
+        {
+            /* shutting down */
+            break;
+        }
+
+        /* Execute task. spare was already taken when it was queued. */
+        __atomic_sub_fetch(&globus_l_thread_pool_queued, 1, __ATOMIC_SEQ_CST);
+        __atomic_sub_fetch(
+            &globus_l_thread_pool_idle_threads, 1, __ATOMIC_SEQ_CST);
+
+        func(func_user_arg);
+        globus_thread_blocking_reset();
+        globus_l_thread_pool_key_clean();
     }
 
+    globus_mutex_lock(&globus_l_thread_pool_q_mutex);
+
+exit_locked:
     /* This thread is terminating. If it is the last one, then signal
-     * the deactivate() thread
+     * the deactivate() thread. Our deque is empty unless we're shutting
+     * down, in which case the tasks in it are dropped.
      */
-    globus_l_thread_pool_idle_threads--;
+    if(deque != NULL)
+    {
+        __atomic_store_n(&deque->top,
+                         __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+        deque->in_use = GLOBUS_FALSE;
+    }
+    globus_l_thread_pool_threads--;
     if(globus_l_thread_pool_done &&
-       globus_l_thread_pool_idle_threads == 0 &&
-       globus_l_thread_pool_active_threads == 0)
+       globus_l_thread_pool_threads == 0)
     {
         globus_cond_signal(&globus_l_thread_pool_shutdown_cond);
     }
@@ -324,35 +714,59 @@ globus_i_thread_start(
     globus_thread_func_t                func,
     void *                              user_arg)
 {
-    globus_l_thread_pool_task_t *      task;
+    globus_l_thread_pool_task_t *       task;
+    globus_l_thread_pool_deque_t *      deque;
+    int                                 spare;
+    int                                 rc;
 
-    task = (globus_l_thread_pool_task_t *)
-        globus_libc_malloc(sizeof(globus_l_thread_pool_task_t));
-    task->func = func;
-    task->func_user_arg = user_arg;
+    /* Queue the task only if an idle thread other than the last one can be
+     * promised to it, otherwise start a new thread.
+     */
+    spare = __atomic_load_n(&globus_l_thread_pool_spare, __ATOMIC_SEQ_CST);
+    while(spare > 1 &&
+          !__atomic_compare_exchange_n(
+              &globus_l_thread_pool_spare, &spare, spare - 1, GLOBUS_FALSE,
+              __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+    {
+    }
 
-    globus_mutex_lock(&globus_l_thread_pool_q_mutex);
+    if(spare > 1)
     {
-        if(globus_l_thread_pool_idle_threads > globus_l_thread_pool_pending_tasks+1)
-	{
-            globus_l_thread_pool_pending_tasks++;
-	    globus_fifo_enqueue(&globus_l_thread_pool_q,
-	                        task);
-	    globus_cond_signal(&globus_l_thread_pool_q_cond);
-	}
-	else
-	{
-		int rc;
+        deque = globus_thread_getspecific(globus_l_thread_pool_deque_key);
+        if(deque == NULL ||
+           !globus_l_thread_pool_deque_push(deque, func, user_arg))
+        {
+            task = globus_l_thread_pool_task_alloc(func, user_arg);
+            globus_mutex_lock(&globus_l_thread_pool_inject_mutex);
+            {
+                *globus_l_thread_pool_inject_tail = task;
+                globus_l_thread_pool_inject_tail = &task->next;
+            }
+            globus_mutex_unlock(&globus_l_thread_pool_inject_mutex);
+        }
 
-		globus_l_thread_pool_active_threads++;
+        __atomic_add_fetch(&globus_l_thread_pool_queued, 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&globus_l_thread_pool_parked, __ATOMIC_SEQ_CST))
+        {
+            globus_mutex_lock(&globus_l_thread_pool_q_mutex);
+            globus_cond_signal(&globus_l_thread_pool_q_cond);
+            globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
+        }
+    }
+    else
+    {
+        task = globus_l_thread_pool_task_alloc(func, user_arg);
 
-	    rc= globus_thread_create(GLOBUS_NULL,
-	                         GLOBUS_NULL,
-				 globus_l_thread_pool_thread_start,
-				 task);
-		globus_assert( rc == 0 );
-	}
+        globus_mutex_lock(&globus_l_thread_pool_q_mutex);
+        {
+            globus_l_thread_pool_threads++;
+        }
+        globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
+
+        rc = globus_thread_create(GLOBUS_NULL,
+                                  GLOBUS_NULL,
+                                  globus_l_thread_pool_thread_start,
+                                  task);
+        globus_assert( rc == 0 );
     }
-    globus_mutex_unlock(&globus_l_thread_pool_q_mutex);
 }
-
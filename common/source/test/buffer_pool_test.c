@@ -0,0 +1,231 @@
+/*
+ * Copyright 1999-2006 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file buffer_pool_test.c
+ * @brief Test cases for globus_buffer_pool_t
+ *
+ * Checks block alignment, reuse through the caches, the high water trim
+ * and the statistics counters, then reports get/put rates next to
+ * globus_memory_t as TAP diagnostics.
+ */
+
+#include "globus_common.h"
+#include "globus_buffer_pool.h"
+#include "globus_test_tap.h"
+
+#define BLOCKS                          100
+#define OPS                             1000000
+
+static
+int
+alignment_test(void)
+{
+    globus_buffer_pool_t                pool;
+    void *                              blocks[BLOCKS];
+    long                                page_size = sysconf(_SC_PAGESIZE);
+    int                                 failed = 0;
+    int                                 i;
+
+    if(globus_buffer_pool_init(
+        &pool, 1000, 10, 0, GLOBUS_BUFFER_POOL_PAGE_ALIGNED) != GLOBUS_SUCCESS)
+    {
+        return 1;
+    }
+    for(i = 0; i < BLOCKS; i++)
+    {
+        blocks[i] = globus_buffer_pool_get(&pool);
+        failed += blocks[i] == NULL || ((uintptr_t) blocks[i] % page_size) != 0;
+        /* the whole rounded up page is usable */
+        memset(blocks[i], i, page_size);
+    }
+    for(i = 0; i < BLOCKS; i++)
+    {
+        globus_buffer_pool_put(&pool, blocks[i]);
+    }
+    globus_buffer_pool_destroy(&pool);
+
+    return failed;
+}
+
+static
+int
+reuse_test(void)
+{
+    globus_buffer_pool_t                pool;
+    globus_buffer_pool_stats_t          stats;
+    void *                              blocks[BLOCKS];
+    int                                 failed = 0;
+    int                                 round;
+    int                                 i;
+
+    if(globus_buffer_pool_init(&pool, 64, 0, 0, 0) != GLOBUS_SUCCESS)
+    {
+        return 1;
+    }
+    for(round = 0; round < 3; round++)
+    {
+        for(i = 0; i < BLOCKS; i++)
+        {
+            blocks[i] = globus_buffer_pool_get(&pool);
+        }
+        globus_buffer_pool_stats(&pool, &stats);
+        failed += stats.in_use != BLOCKS;
+        for(i = 0; i < BLOCKS; i++)
+        {
+            globus_buffer_pool_put(&pool, blocks[i]);
+        }
+    }
+    globus_buffer_pool_stats(&pool, &stats);
+
+    /* only the first round should have had to allocate */
+    failed += stats.misses != BLOCKS;
+    failed += stats.allocated != BLOCKS;
+    failed += stats.peak != BLOCKS;
+    failed += stats.in_use != 0;
+    failed += stats.cache_hits + stats.depot_hits != 2 * BLOCKS;
+    failed += stats.cache_hits == 0;
+
+    globus_buffer_pool_trim(&pool);
+    globus_buffer_pool_stats(&pool, &stats);
+    failed += stats.allocated != 0;
+    failed += stats.trimmed != BLOCKS;
+
+    globus_buffer_pool_destroy(&pool);
+
+    return failed;
+}
+
+static
+int
+high_water_test(void)
+{
+    globus_buffer_pool_t                pool;
+    globus_buffer_pool_stats_t          stats;
+    void *                              blocks[BLOCKS];
+    int                                 failed = 0;
+    int                                 i;
+
+    if(globus_buffer_pool_init(&pool, 256 * 1024, 4, 8, 0) != GLOBUS_SUCCESS)
+    {
+        return 1;
+    }
+    for(i = 0; i < BLOCKS; i++)
+    {
+        blocks[i] = globus_buffer_pool_get(&pool);
+    }
+    for(i = 0; i < BLOCKS; i++)
+    {
+        globus_buffer_pool_put(&pool, blocks[i]);
+    }
+    globus_buffer_pool_stats(&pool, &stats);
+
+    /* what is left is what the depot may hold and two magazines */
+    failed += stats.trimmed == 0;
+    failed += stats.allocated > 8 + 2 * 4;
+    failed += stats.allocated + stats.trimmed != BLOCKS;
+    failed += stats.peak != BLOCKS;
+
+    globus_buffer_pool_destroy(&pool);
+
+    return failed;
+}
+
+static
+double
+rate(
+    globus_abstime_t *                  then)
+{
+    globus_abstime_t                    now;
+    globus_reltime_t                    elapsed;
+    long                                usecs;
+
+    GlobusTimeAbstimeGetCurrent(now);
+    GlobusTimeAbstimeDiff(elapsed, now, *then);
+    GlobusTimeReltimeToUSec(usecs, elapsed);
+
+    return (double) OPS * 1000000.0 / (usecs ? usecs : 1);
+}
+
+static
+int
+bench(void)
+{
+    globus_buffer_pool_t                pool;
+    globus_memory_t                     mem;
+    globus_abstime_t                    then;
+    void *                              blocks[8];
+    double                              pool_rate;
+    double                              mem_rate;
+    int                                 i;
+    int                                 j;
+
+    globus_buffer_pool_init(&pool, 64 * 1024, 8, 0, 0);
+    GlobusTimeAbstimeGetCurrent(then);
+    for(i = 0; i < OPS; i += 8)
+    {
+        for(j = 0; j < 8; j++)
+        {
+            blocks[j] = globus_buffer_pool_get(&pool);
+        }
+        for(j = 0; j < 8; j++)
+        {
+            globus_buffer_pool_put(&pool, blocks[j]);
+        }
+    }
+    pool_rate = rate(&then);
+    globus_buffer_pool_destroy(&pool);
+
+    globus_memory_init(&mem, 64 * 1024, 8);
+    GlobusTimeAbstimeGetCurrent(then);
+    for(i = 0; i < OPS; i += 8)
+    {
+        for(j = 0; j < 8; j++)
+        {
+            blocks[j] = globus_memory_pop_node(&mem);
+        }
+        for(j = 0; j < 8; j++)
+        {
+            globus_memory_push_node(&mem, blocks[j]);
+        }
+    }
+    mem_rate = rate(&then);
+    globus_memory_destroy(&mem);
+
+    printf("# buffer_pool %10.0f get+put/sec\n", pool_rate);
+    printf("# memory      %10.0f pop+push/sec\n", mem_rate);
+
+    return 0;
+}
+
+int
+main(
+    int                                 argc,
+    char *                              argv[])
+{
+    printf("1..4\n");
+
+    globus_module_activate(GLOBUS_COMMON_MODULE);
+
+    ok(alignment_test() == 0, "alignment");
+    ok(reuse_test() == 0, "reuse");
+    ok(high_water_test() == 0, "high_water");
+    ok(bench() == 0, "bench");
+
+    globus_module_deactivate(GLOBUS_COMMON_MODULE);
+
+    return TEST_EXIT_CODE;
+}
@@ -17,17 +17,213 @@
 /**
  * @file hash_test.c
  * @brief Hashtable Test Cases
+ *
+ * Besides the basic cases, checks that tables grow well past their
+ * initial size and that iteration survives removals, then reports
+ * insert and lookup throughput as TAP diagnostics for tables of 1k
+ * entries up to a maximum size.
+ *
+ * Usage: hash_test [MAX-ENTRIES]
  */
 
 #include "globus_common.h"
 #include "globus_test_tap.h"
 
+#include <stdio.h>
+
+#define HASH_KEY(i) ((void *) (intptr_t) ((i) + 1))
+
+/**
+ * @brief Grow a table from a tiny initial size, then remove every other key
+ * @return 0 if every lookup found what it should
+ */
+static
+int
+hash_grow_test(
+    int                                 n)
+{
+    globus_hashtable_t                  hash_table;
+    int                                 i;
+    int                                 failed = 0;
+
+    globus_hashtable_init(&hash_table,
+                          1,
+                          globus_hashtable_int_hash,
+                          globus_hashtable_int_keyeq);
+    for(i = 0; i < n; i++)
+    {
+        failed += globus_hashtable_insert(
+            &hash_table, HASH_KEY(i), HASH_KEY(i)) != 0;
+    }
+    failed += globus_hashtable_insert(&hash_table, HASH_KEY(0), "dup") == 0;
+    for(i = 0; i < n; i += 2)
+    {
+        failed += globus_hashtable_remove(&hash_table, HASH_KEY(i))
+            != HASH_KEY(i);
+    }
+    for(i = 0; i < n; i++)
+    {
+        void *                          datum;
+
+        datum = globus_hashtable_lookup(&hash_table, HASH_KEY(i));
+        failed += (i % 2 == 0) ? (datum != NULL) : (datum != HASH_KEY(i));
+    }
+    failed += globus_hashtable_size(&hash_table) != n / 2;
+    globus_hashtable_destroy(&hash_table);
+
+    return failed;
+}
+
+/**
+ * @brief Walk a table with the iterators, removing the current entry as
+ * we go, and check that every entry is visited once in each direction
+ * @return 0 if so
+ */
+static
+int
+hash_iterate_test(
+    int                                 n)
+{
+    globus_hashtable_t                  hash_table;
+    char *                              seen;
+    void *                              datum;
+    int                                 i;
+    int                                 count = 0;
+    int                                 failed = 0;
+
+    seen = calloc(n, 1);
+    globus_hashtable_init(&hash_table,
+                          16,
+                          globus_hashtable_int_hash,
+                          globus_hashtable_int_keyeq);
+    for(i = 0; i < n; i++)
+    {
+        globus_hashtable_insert(&hash_table, HASH_KEY(i), HASH_KEY(i));
+    }
+
+    for(datum = globus_hashtable_last(&hash_table);
+        datum != NULL;
+        datum = globus_hashtable_prev(&hash_table))
+    {
+        failed += seen[(intptr_t) datum - 1]++ != 0;
+        count++;
+    }
+    failed += count != n;
+
+    /* removing the current entry moves the iterator on to the next one,
+     * so next() then skips over that one
+     */
+    count = 0;
+    for(datum = globus_hashtable_first(&hash_table);
+        datum != NULL;
+        datum = globus_hashtable_next(&hash_table))
+    {
+        seen[(intptr_t) datum - 1] = 2;
+        globus_hashtable_remove(&hash_table, datum);
+        count++;
+    }
+    failed += count != (n + 1) / 2;
+    failed += globus_hashtable_size(&hash_table) != n / 2;
+
+    count = 0;
+    while((datum = globus_hashtable_first(&hash_table)) != NULL)
+    {
+        failed += seen[(intptr_t) datum - 1] != 1;
+        globus_hashtable_remove(&hash_table, datum);
+        count++;
+    }
+    failed += count != n / 2;
+    failed += !globus_hashtable_empty(&hash_table);
+
+    globus_hashtable_destroy(&hash_table);
+    free(seen);
+
+    return failed;
+}
+
+static
+double
+hash_rate(
+    int                                 n,
+    globus_abstime_t *                  then)
+{
+    globus_abstime_t                    now;
+    globus_reltime_t                    elapsed;
+    long                                usecs;
+
+    GlobusTimeAbstimeGetCurrent(now);
+    GlobusTimeAbstimeDiff(elapsed, now, *then);
+    GlobusTimeReltimeToUSec(usecs, elapsed);
+    if(usecs == 0)
+    {
+        usecs = 1;
+    }
+    *then = now;
+
+    return (double) n * 1000000.0 / usecs;
+}
+
+/**
+ * @brief Time n inserts, n lookups of present keys and n lookups of
+ * missing keys into a table created with the default size
+ * @return 0 if every lookup found what it should
+ */
+static
+int
+hash_bench(
+    int                                 n)
+{
+    globus_hashtable_t                  hash_table;
+    globus_abstime_t                    then;
+    double                              insert_rate;
+    double                              hit_rate;
+    double                              miss_rate;
+    int                                 i;
+    int                                 failed = 0;
+
+    globus_hashtable_init(&hash_table,
+                          256,
+                          globus_hashtable_voidp_hash,
+                          globus_hashtable_voidp_keyeq);
+
+    GlobusTimeAbstimeGetCurrent(then);
+    for(i = 0; i < n; i++)
+    {
+        globus_hashtable_insert(&hash_table, HASH_KEY(i), HASH_KEY(i));
+    }
+    insert_rate = hash_rate(n, &then);
+    for(i = 0; i < n; i++)
+    {
+        failed += globus_hashtable_lookup(&hash_table, HASH_KEY(i))
+            != HASH_KEY(i);
+    }
+    hit_rate = hash_rate(n, &then);
+    for(i = n; i < 2 * n; i++)
+    {
+        failed += globus_hashtable_lookup(&hash_table, HASH_KEY(i)) != NULL;
+    }
+    miss_rate = hash_rate(n, &then);
+
+    printf("# %9d entries: %10.0f inserts/sec %10.0f hits/sec "
+           "%10.0f misses/sec\n",
+           n, insert_rate, hit_rate, miss_rate);
+    globus_hashtable_destroy(&hash_table);
+
+    return failed;
+}
+
 /** @brief Globus Hashtable Test Cases */
-int hash_test(void)
+int hash_test(int max_entries)
 {
     globus_hashtable_t hash_table;
+    int n;
+    int nbench = 0;
 
-    printf("1..8\n");
+    for(n = 1000; n <= max_entries; n *= 10)
+    {
+        nbench++;
+    }
+    printf("1..%d\n", 10 + nbench);
     /**
      * @test
      * Initialize hashtable with globus_hashtable_init()
@@ -84,10 +280,36 @@ int hash_test(void)
      * Destroy hashtable with globus_hashtable_destroy()
      */
     ok(globus_hashtable_destroy(&hash_table) == 0, "hashtable_destroy");
+
+    /**
+     * @test
+     * Grow a hashtable from size 1 to 100000 entries
+     */
+    ok(hash_grow_test(100000) == 0, "hashtable_grow");
+    /**
+     * @test
+     * Iterate over and empty a hashtable
+     */
+    ok(hash_iterate_test(10000) == 0, "hashtable_iterate");
+
+    /**
+     * @test
+     * Insert and look up 1000 entries and up, by factors of 10
+     */
+    for(n = 1000; n <= max_entries; n *= 10)
+    {
+        ok(hash_bench(n) == 0, "hashtable_bench_%d", n);
+    }
     return TEST_EXIT_CODE;
 }
 
 int main(int argc, char **argv)
 {
-    return hash_test();
+    int max_entries = 1000000;
+
+    if(argc > 1)
+    {
+        max_entries = atoi(argv[1]);
+    }
+    return hash_test(max_entries);
 }
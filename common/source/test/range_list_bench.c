@@ -0,0 +1,678 @@
+/*
+ * Copyright 1999-2006 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file range_list_bench.c
+ * @brief Range List Benchmark
+ *
+ * Checks globus_range_list_t against the sorted linked list it replaced,
+ * operation by operation, and then times both on restart marker
+ * bookkeeping for blocks arriving out of order.
+ *
+ * Usage: range_list_bench [BLOCKS]
+ */
+
+#include "globus_common.h"
+#include "globus_test_tap.h"
+
+#include <stdio.h>
+
+/* The linked list globus_range_list_t used to be, kept for comparison */
+typedef struct list_range_ent_s
+{
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    struct list_range_ent_s *           next;
+} list_range_ent_t;
+
+typedef struct
+{
+    int                                 size;
+    list_range_ent_t *                  head;
+} *list_range_list_t;
+
+static
+int
+list_range_list_insert(
+    list_range_list_t                   range_list,
+    globus_off_t                        offset,
+    globus_off_t                        length)
+{
+    list_range_ent_t *              prev;
+    list_range_ent_t *              ent;
+    list_range_ent_t *              next;
+    list_range_ent_t *              new_ent;
+    globus_off_t                        end_offset;
+    globus_off_t                        ent_end;
+    globus_bool_t                       done = GLOBUS_FALSE;
+
+    if(offset < 0)
+    {
+        return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
+    }
+    if(length == 0)
+    {
+        return GLOBUS_SUCCESS;
+    }
+    
+    if(range_list->head == NULL)
+    {
+        new_ent = (list_range_ent_t *) globus_malloc(
+            sizeof(list_range_ent_t));
+        if(new_ent == NULL)
+        {
+            globus_assert(0);
+        }
+        new_ent->offset = offset;
+        new_ent->length = length;
+        new_ent->next = NULL;
+        range_list->head = new_ent;
+        range_list->size = 1;
+        
+        return GLOBUS_SUCCESS;
+    }
+
+    if(length == GLOBUS_RANGE_LIST_MAX)
+    {
+        end_offset = GLOBUS_RANGE_LIST_MAX;
+    }
+    else
+    {
+        end_offset = offset + length;
+    }
+
+    prev = NULL;
+    ent = range_list->head;
+    while(ent != NULL && !done)
+    {
+        if(ent->length == GLOBUS_RANGE_LIST_MAX)
+        {
+            ent_end = GLOBUS_RANGE_LIST_MAX;
+        }
+        else
+        {
+            ent_end = ent->offset + ent->length;
+        }
+        next = ent->next;
+        /* if it is discontigous and in front of this one */
+        if(end_offset < ent->offset && end_offset != GLOBUS_RANGE_LIST_MAX)
+        {
+            new_ent = (list_range_ent_t *) globus_malloc(
+                sizeof(list_range_ent_t));
+            if(new_ent == NULL)
+            {
+                globus_assert(0);
+            }
+            new_ent->offset = offset;
+            new_ent->length = length;
+            new_ent->next = ent;
+            if(prev == NULL)
+            {
+                range_list->head = new_ent;
+            }
+            else
+            {
+                prev->next = new_ent;
+            }
+            range_list->size++;
+            done = GLOBUS_TRUE;
+        }
+        /* if it is merging */
+        else if((end_offset >= ent->offset || 
+            end_offset == GLOBUS_RANGE_LIST_MAX) 
+            && (offset <= ent_end || 
+            ent_end == GLOBUS_RANGE_LIST_MAX))
+        {
+            if(offset < ent->offset)
+            {
+                if(ent->length != GLOBUS_RANGE_LIST_MAX)
+                {
+                    ent->length += ent->offset - offset;
+                }
+                ent->offset = offset;
+            }
+            if(end_offset == GLOBUS_RANGE_LIST_MAX || 
+                ent_end == GLOBUS_RANGE_LIST_MAX)
+            {
+                ent->length = GLOBUS_RANGE_LIST_MAX;
+            }
+            else if(end_offset > ent_end)
+            {
+                ent->length = end_offset - ent->offset;
+            }
+            if(next != NULL && end_offset >= next->offset)
+            {
+                if(next->length == GLOBUS_RANGE_LIST_MAX)
+                {
+                    ent->length = GLOBUS_RANGE_LIST_MAX;    
+                }
+                else
+                {   
+                    ent->length = next->offset + next->length - ent->offset;
+                }
+                range_list->size--;
+                ent->next = next->next;
+                globus_free(next);
+            }
+            done = GLOBUS_TRUE;
+        }
+        else
+        {
+            prev = ent;
+            ent = ent->next;
+        }
+    }
+    /* must be last entry */
+    if(!done)
+    {
+        new_ent = (list_range_ent_t *) globus_malloc(
+            sizeof(list_range_ent_t));
+        if(new_ent == NULL)
+        {
+            globus_assert(0);
+        }
+        new_ent->offset = offset;
+        new_ent->length = length;
+        new_ent->next = ent;
+
+        globus_assert(prev != NULL);
+        prev->next = new_ent;
+        range_list->size++;
+    }
+
+    return GLOBUS_SUCCESS;
+}
+
+static
+int
+list_range_list_remove(
+    list_range_list_t                   range_list,
+    globus_off_t                        offset,
+    globus_off_t                        length)
+{
+    list_range_ent_t *              prev;
+    list_range_ent_t *              ent;
+    list_range_ent_t *              next;
+    list_range_ent_t *              new_ent;
+    globus_off_t                        end_offset;
+    globus_off_t                        ent_end;
+    globus_bool_t                       done = GLOBUS_FALSE;
+
+    if(offset < 0)
+    {
+        return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
+    }
+    if(length == 0)
+    {
+        return GLOBUS_SUCCESS;
+    }
+
+    if(length == GLOBUS_RANGE_LIST_MAX)
+    {
+        end_offset = GLOBUS_RANGE_LIST_MAX;
+    }
+    else
+    {
+        end_offset = offset + length;
+    }
+    prev = NULL;
+    ent = range_list->head;
+    while(ent != NULL && !done)
+    {
+        next = ent->next;
+        if(ent->length == GLOBUS_RANGE_LIST_MAX)
+        {
+            ent_end = GLOBUS_RANGE_LIST_MAX;
+        }
+        else
+        {
+            ent_end = ent->offset + ent->length;
+        }
+        
+        /* this range is all foul, remove it */
+        if(ent->offset >= offset && 
+            ((ent_end <= end_offset && ent_end != GLOBUS_RANGE_LIST_MAX) || 
+            end_offset == GLOBUS_RANGE_LIST_MAX))
+        {
+            if(prev == NULL)
+            {
+                range_list->head = next;
+            }
+            else
+            {
+                prev->next = next;
+            }
+            range_list->size--;
+            globus_free(ent);
+        }
+        /* this range starts fair and extends foul, adjust length */
+        else if(ent->offset < offset && 
+            ((ent_end < end_offset && ent_end != GLOBUS_RANGE_LIST_MAX) ||
+                end_offset == GLOBUS_RANGE_LIST_MAX) && 
+            (ent_end > offset || ent_end == GLOBUS_RANGE_LIST_MAX))
+        {   
+            ent->length = offset - ent->offset;
+            prev = ent;
+        }
+        /* this range starts foul and extends fair, adjust offset */
+        else if(ent->offset >= offset && ent->offset < end_offset &&
+            ((ent_end > end_offset && end_offset != GLOBUS_RANGE_LIST_MAX) || 
+                ent_end == GLOBUS_RANGE_LIST_MAX))
+        {
+            /* the library list kept the old length here, moving the end
+             * of the range out; keep the end where it was
+             */
+            if(ent->length != GLOBUS_RANGE_LIST_MAX)
+            {
+                ent->length = ent_end - end_offset;
+            }
+            ent->offset = end_offset;
+            prev = ent;
+            done = GLOBUS_TRUE;
+        }
+        /* this range starts fair and ends fair, but crosses foul,
+             adjust offset and length */
+        else if(ent->offset < offset && 
+            ((ent_end > end_offset && end_offset != GLOBUS_RANGE_LIST_MAX) || 
+            ent_end == GLOBUS_RANGE_LIST_MAX))
+        {
+            new_ent = (list_range_ent_t *) globus_malloc(
+                sizeof(list_range_ent_t));
+            if(new_ent == NULL)
+            {
+                globus_assert(0);
+            }
+            new_ent->next = NULL;
+            new_ent->offset = end_offset;
+            if(ent_end == GLOBUS_RANGE_LIST_MAX)
+            {
+                new_ent->length = GLOBUS_RANGE_LIST_MAX;    
+            }
+            else
+            {   
+                new_ent->length = ent_end - new_ent->offset;
+            }
+            ent->length = offset - ent->offset;
+            ent->next = new_ent;
+    
+            range_list->size++;
+            
+            prev = ent;
+            done = GLOBUS_TRUE;
+        }
+        /* this range is all fair */
+        else
+        {
+            if(ent->offset > end_offset && end_offset != GLOBUS_RANGE_LIST_MAX)
+            {
+                done = GLOBUS_TRUE;
+            }
+            prev = ent;
+        }
+        ent = next;
+    }
+
+    return GLOBUS_SUCCESS;
+}
+
+static
+int
+list_range_list_at(
+    list_range_list_t                   range_list,
+    int                                 ndx,
+    globus_off_t *                      offset,
+    globus_off_t *                      length)
+{
+    int                                 ctr;
+    list_range_ent_t *              i;
+
+    if(range_list == NULL)
+    {
+        return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
+    }
+    if(offset == NULL)
+    {
+        return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
+    }
+    if(length == NULL)
+    {
+        return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
+    }
+
+    i = range_list->head;
+    for(ctr = 0; ctr < ndx; ctr++)
+    {
+        if(i == NULL)
+        {
+            return GLOBUS_RANGE_LIST_ERROR_PARAMETER;
+        }
+        i = i->next;
+    }
+
+    *offset = i->offset;
+    *length = i->length;
+
+    return GLOBUS_SUCCESS;
+}
+
+static
+list_range_list_t
+list_range_list_init(void)
+{
+    return calloc(1, sizeof(*(list_range_list_t) NULL));
+}
+
+static
+void
+list_range_list_destroy(
+    list_range_list_t                   range_list)
+{
+    list_range_ent_t *                  ent;
+
+    while((ent = range_list->head) != NULL)
+    {
+        range_list->head = ent->next;
+        free(ent);
+    }
+    free(range_list);
+}
+
+/* simple deterministic generator so runs are repeatable */
+static unsigned long                    bench_seed = 1;
+
+static
+unsigned long
+bench_rand(void)
+{
+    bench_seed = bench_seed * 1103515245 + 12345;
+    return (bench_seed / 65536) % 32768;
+}
+
+static
+globus_bool_t
+bench_same(
+    globus_range_list_t                 tree,
+    list_range_list_t                   list)
+{
+    list_range_ent_t *                  ent;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    int                                 ndx = 0;
+
+    if(globus_range_list_size(tree) != list->size)
+    {
+        return GLOBUS_FALSE;
+    }
+    for(ent = list->head; ent != NULL; ent = ent->next, ndx++)
+    {
+        if(globus_range_list_at(tree, ndx, &offset, &length) != 0 ||
+            offset != ent->offset || length != ent->length)
+        {
+            return GLOBUS_FALSE;
+        }
+    }
+    return globus_range_list_at(tree, ndx, &offset, &length) != 0;
+}
+
+/**
+ * @brief Random inserts and removes give the same ranges as the old list
+ * @details
+ *     Inserts never span more than one existing range, as the old list
+ *     only merged one neighbour past the range it extended.
+ */
+static
+int
+compare_random(void)
+{
+    globus_range_list_t                 tree;
+    list_range_list_t                   list;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    int                                 i;
+    int                                 ok = 1;
+
+    globus_range_list_init(&tree);
+    list = list_range_list_init();
+
+    for(i = 0; i < 20000 && ok; i++)
+    {
+        offset = bench_rand() % 4096 * 16;
+        if(bench_rand() % 3 == 0)
+        {
+            length = bench_rand() % 64 == 0
+                ? GLOBUS_RANGE_LIST_MAX : bench_rand() % 128;
+            globus_range_list_remove(tree, offset, length);
+            list_range_list_remove(list, offset, length);
+        }
+        else
+        {
+            length = bench_rand() % 16 + 1;
+            globus_range_list_insert(tree, offset, length);
+            list_range_list_insert(list, offset, length);
+        }
+        ok = bench_same(tree, list);
+    }
+
+    globus_range_list_destroy(tree);
+    list_range_list_destroy(list);
+
+    return ok;
+}
+
+/**
+ * @brief The merge calls agree with inserting each range
+ */
+static
+int
+compare_merge(void)
+{
+    globus_range_list_t                 a;
+    globus_range_list_t                 b;
+    globus_range_list_t                 merged;
+    globus_range_list_t                 destructive;
+    globus_range_list_t                 a_copy;
+    globus_range_list_t                 b_copy;
+    list_range_list_t                   list;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    int                                 i;
+    int                                 ok;
+
+    globus_range_list_init(&a);
+    globus_range_list_init(&b);
+    list = list_range_list_init();
+    for(i = 0; i < 2000; i++)
+    {
+        offset = bench_rand() % 8192 * 8;
+        length = bench_rand() % 8 + 1;
+        globus_range_list_insert((i % 2) ? a : b, offset, length);
+        list_range_list_insert(list, offset, length);
+    }
+
+    globus_range_list_merge(&merged, a, b);
+    ok = bench_same(merged, list);
+
+    globus_range_list_copy(&a_copy, a);
+    globus_range_list_copy(&b_copy, b);
+    globus_range_list_merge_destructive(&destructive, a_copy, b_copy);
+    ok = ok && bench_same(destructive, list) &&
+        globus_range_list_size(a_copy) == 0 &&
+        globus_range_list_size(b_copy) == 0;
+
+    globus_range_list_merge_into(a, b);
+    ok = ok && bench_same(a, list);
+
+    while(ok && globus_range_list_size(a) > 0)
+    {
+        globus_range_list_remove_at(a, 0, &offset, &length);
+        ok = offset == list->head->offset && length == list->head->length;
+        list_range_list_remove(list, offset, length);
+    }
+
+    globus_range_list_destroy(a);
+    globus_range_list_destroy(b);
+    globus_range_list_destroy(merged);
+    globus_range_list_destroy(destructive);
+    globus_range_list_destroy(a_copy);
+    globus_range_list_destroy(b_copy);
+    list_range_list_destroy(list);
+
+    return ok;
+}
+
+/*
+ * Blocks of a file arriving over many streams: each stream sends every
+ * nstreams'th block, and the streams advance at random, so the received
+ * ranges fragment before they coalesce. A restart marker walks the whole
+ * list every 64 blocks.
+ */
+static
+double
+bench_markers(
+    globus_bool_t                       use_tree,
+    int                                 nblocks,
+    int                                 nstreams)
+{
+    globus_range_list_t                 tree = NULL;
+    list_range_list_t                   list = NULL;
+    int *                               next_block;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    globus_abstime_t                    then;
+    globus_abstime_t                    now;
+    globus_reltime_t                    elapsed;
+    long                                usecs;
+    int                                 stream;
+    int                                 done = 0;
+    int                                 size;
+    int                                 i;
+
+    next_block = calloc(nstreams, sizeof(int));
+    for(i = 0; i < nstreams; i++)
+    {
+        next_block[i] = i;
+    }
+    if(use_tree)
+    {
+        globus_range_list_init(&tree);
+    }
+    else
+    {
+        list = list_range_list_init();
+    }
+
+    GlobusTimeAbstimeGetCurrent(then);
+    while(done < nblocks)
+    {
+        /* favour low streams so the fast ones run far ahead */
+        stream = bench_rand() % nstreams;
+        stream = bench_rand() % (stream + 1);
+        if(next_block[stream] >= nblocks)
+        {
+            for(stream = 0; next_block[stream] >= nblocks; stream++)
+            {
+            }
+        }
+        offset = (globus_off_t) next_block[stream] * 65536;
+        next_block[stream] += nstreams;
+        done++;
+
+        if(use_tree)
+        {
+            globus_range_list_insert(tree, offset, 65536);
+        }
+        else
+        {
+            list_range_list_insert(list, offset, 65536);
+        }
+
+        if(done % 64 == 0)
+        {
+            size = use_tree ? globus_range_list_size(tree) : list->size;
+            for(i = 0; i < size; i++)
+            {
+                if(use_tree)
+                {
+                    globus_range_list_at(tree, i, &offset, &length);
+                }
+                else
+                {
+                    list_range_list_at(list, i, &offset, &length);
+                }
+            }
+        }
+    }
+    GlobusTimeAbstimeGetCurrent(now);
+
+    if(use_tree)
+    {
+        globus_range_list_destroy(tree);
+    }
+    else
+    {
+        list_range_list_destroy(list);
+    }
+    free(next_block);
+
+    GlobusTimeAbstimeDiff(elapsed, now, then);
+    GlobusTimeReltimeToUSec(usecs, elapsed);
+    if(usecs == 0)
+    {
+        usecs = 1;
+    }
+
+    return (double) nblocks * 1000000.0 / usecs;
+}
+
+int
+main(
+    int                                 argc,
+    char *                              argv[])
+{
+    int                                 nblocks = 5000;
+    int                                 streams[] = { 4, 64, 512 };
+    size_t                              i;
+
+    if(argc > 1)
+    {
+        nblocks = atoi(argv[1]);
+    }
+
+    printf("1..2\n");
+    globus_module_activate(GLOBUS_COMMON_MODULE);
+
+    ok(compare_random(), "compare_random");
+    ok(compare_merge(), "compare_merge");
+
+    for(i = 0; i < sizeof(streams)/sizeof(streams[0]); i++)
+    {
+        unsigned long                   seed = bench_seed;
+        double                          tree_rate;
+        double                          list_rate;
+
+        tree_rate = bench_markers(GLOBUS_TRUE, nblocks, streams[i]);
+        bench_seed = seed;
+        list_rate = bench_markers(GLOBUS_FALSE, nblocks, streams[i]);
+
+        printf("# %3d streams: range_list %10.0f blocks/sec, "
+                "linked list %10.0f blocks/sec\n",
+                streams[i], tree_rate, list_rate);
+    }
+
+    globus_module_deactivate(GLOBUS_COMMON_MODULE);
+
+    return TEST_EXIT_CODE;
+}
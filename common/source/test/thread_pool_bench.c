@@ -0,0 +1,313 @@
+/*
+ * Copyright 1999-2006 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @file thread_pool_bench.c
+ * @brief Thread Pool Benchmark
+ *
+ * Runs chains of tiny tasks through globus_i_thread_start(), each task
+ * starting the next one in its chain like callbacks that register more
+ * callbacks do, and through a copy of the single-queue pool it replaced.
+ * Reports ops/sec for each as TAP diagnostics.
+ *
+ * Usage: thread_pool_bench [OPS-PER-CHAIN]
+ */
+
+#include "globus_common.h"
+#include "globus_test_tap.h"
+
+#include <stdio.h>
+
+#include "globus_preload.h"
+
+typedef void (*bench_start_func_t)(globus_thread_func_t, void *);
+
+static globus_mutex_t                   bench_mutex;
+static globus_cond_t                    bench_cond;
+static int                              bench_chains_left;
+static bench_start_func_t               bench_start;
+
+typedef struct
+{
+    int                                 remaining;
+} bench_chain_t;
+
+static
+void *
+bench_task(
+    void *                              arg)
+{
+    bench_chain_t *                     chain = arg;
+
+    if(--chain->remaining > 0)
+    {
+        bench_start(bench_task, chain);
+    }
+    else
+    {
+        globus_mutex_lock(&bench_mutex);
+        if(--bench_chains_left == 0)
+        {
+            globus_cond_signal(&bench_cond);
+        }
+        globus_mutex_unlock(&bench_mutex);
+    }
+    return NULL;
+}
+
+/* The single fifo pool globus_i_thread_start() used to dispatch through,
+ * kept here for comparison.
+ */
+static globus_mutex_t                   fifo_pool_mutex;
+static globus_cond_t                    fifo_pool_cond;
+static globus_cond_t                    fifo_pool_shutdown_cond;
+static globus_fifo_t                    fifo_pool_q;
+static int                              fifo_pool_pending;
+static int                              fifo_pool_idle;
+static int                              fifo_pool_active;
+static globus_bool_t                    fifo_pool_done;
+
+typedef struct
+{
+    globus_thread_func_t                func;
+    void *                              arg;
+} fifo_pool_task_t;
+
+static
+void *
+fifo_pool_thread(
+    void *                              arg)
+{
+    fifo_pool_task_t *                  task = arg;
+
+    task->func(task->arg);
+    free(task);
+
+    globus_mutex_lock(&fifo_pool_mutex);
+    fifo_pool_active--;
+    fifo_pool_idle++;
+    while(!fifo_pool_done)
+    {
+        while(globus_fifo_empty(&fifo_pool_q) && !fifo_pool_done)
+        {
+            globus_cond_wait(&fifo_pool_cond, &fifo_pool_mutex);
+        }
+        if(!globus_fifo_empty(&fifo_pool_q))
+        {
+            fifo_pool_active++;
+            fifo_pool_idle--;
+            task = globus_fifo_dequeue(&fifo_pool_q);
+            fifo_pool_pending--;
+            globus_mutex_unlock(&fifo_pool_mutex);
+
+            task->func(task->arg);
+            free(task);
+
+            globus_mutex_lock(&fifo_pool_mutex);
+            fifo_pool_idle++;
+            fifo_pool_active--;
+        }
+    }
+    fifo_pool_idle--;
+    if(fifo_pool_idle == 0 && fifo_pool_active == 0)
+    {
+        globus_cond_signal(&fifo_pool_shutdown_cond);
+    }
+    globus_mutex_unlock(&fifo_pool_mutex);
+
+    return NULL;
+}
+
+static
+void
+fifo_pool_start(
+    globus_thread_func_t                func,
+    void *                              arg)
+{
+    fifo_pool_task_t *                  task;
+    int                                 rc;
+
+    task = malloc(sizeof(fifo_pool_task_t));
+    task->func = func;
+    task->arg = arg;
+
+    globus_mutex_lock(&fifo_pool_mutex);
+    if(fifo_pool_idle > fifo_pool_pending + 1)
+    {
+        fifo_pool_pending++;
+        globus_fifo_enqueue(&fifo_pool_q, task);
+        globus_cond_signal(&fifo_pool_cond);
+    }
+    else
+    {
+        fifo_pool_active++;
+        rc = globus_thread_create(NULL, NULL, fifo_pool_thread, task);
+        globus_assert(rc == 0);
+    }
+    globus_mutex_unlock(&fifo_pool_mutex);
+}
+
+static
+void
+fifo_pool_init(void)
+{
+    globus_mutex_init(&fifo_pool_mutex, NULL);
+    globus_cond_init(&fifo_pool_cond, NULL);
+    globus_cond_init(&fifo_pool_shutdown_cond, NULL);
+    globus_fifo_init(&fifo_pool_q);
+    fifo_pool_pending = fifo_pool_idle = fifo_pool_active = 0;
+    fifo_pool_done = GLOBUS_FALSE;
+}
+
+static
+void
+fifo_pool_destroy(void)
+{
+    globus_mutex_lock(&fifo_pool_mutex);
+    fifo_pool_done = GLOBUS_TRUE;
+    globus_cond_broadcast(&fifo_pool_cond);
+    while(fifo_pool_idle || fifo_pool_active)
+    {
+        globus_cond_wait(&fifo_pool_shutdown_cond, &fifo_pool_mutex);
+    }
+    globus_mutex_unlock(&fifo_pool_mutex);
+
+    globus_fifo_destroy(&fifo_pool_q);
+    globus_cond_destroy(&fifo_pool_shutdown_cond);
+    globus_cond_destroy(&fifo_pool_cond);
+    globus_mutex_destroy(&fifo_pool_mutex);
+}
+
+/**
+ * @brief Run nchains chains of ops tasks each through start
+ * @return 0 if every task ran
+ */
+static
+int
+bench_run(
+    const char *                        name,
+    bench_start_func_t                  start,
+    int                                 nchains,
+    int                                 ops)
+{
+    bench_chain_t *                     chains;
+    globus_abstime_t                    then;
+    globus_abstime_t                    now;
+    globus_reltime_t                    elapsed;
+    long                                usecs;
+    int                                 i;
+    int                                 failed = 0;
+
+    chains = calloc(nchains, sizeof(bench_chain_t));
+    bench_start = start;
+    bench_chains_left = nchains;
+
+    GlobusTimeAbstimeGetCurrent(then);
+    globus_mutex_lock(&bench_mutex);
+    for(i = 0; i < nchains; i++)
+    {
+        chains[i].remaining = ops;
+        start(bench_task, &chains[i]);
+    }
+    while(bench_chains_left > 0)
+    {
+        globus_cond_wait(&bench_cond, &bench_mutex);
+    }
+    globus_mutex_unlock(&bench_mutex);
+    GlobusTimeAbstimeGetCurrent(now);
+
+    GlobusTimeAbstimeDiff(elapsed, now, then);
+    GlobusTimeReltimeToUSec(usecs, elapsed);
+    if(usecs == 0)
+    {
+        usecs = 1;
+    }
+    for(i = 0; i < nchains; i++)
+    {
+        if(chains[i].remaining != 0)
+        {
+            failed++;
+        }
+    }
+    printf("# %-12s %3d chains: %10.0f ops/sec\n",
+            name,
+            nchains,
+            (double) nchains * ops * 1000000.0 / usecs);
+    free(chains);
+
+    return failed;
+}
+
+int
+main(
+    int                                 argc,
+    char *                              argv[])
+{
+    const char *                        thread_model = THREAD_MODEL;
+    globus_bool_t                       no_threads;
+    int                                 ops = 20000;
+    int                                 chains[] = { 1, 4, 16 };
+    size_t                              nchains =
+                                            sizeof(chains)/sizeof(chains[0]);
+    size_t                              i;
+
+    LTDL_SET_PRELOADED_SYMBOLS();
+    globus_thread_set_model(thread_model);
+
+    setvbuf(stdout, NULL, _IONBF, 0);
+    setvbuf(stderr, NULL, _IONBF, 0);
+
+    if(argc > 1)
+    {
+        ops = atoi(argv[1]);
+    }
+    no_threads = (thread_model == NULL || strcmp(thread_model, "none") == 0);
+
+    printf("1..%zu\n", 2 * nchains);
+
+    globus_module_activate(GLOBUS_COMMON_MODULE);
+    globus_mutex_init(&bench_mutex, NULL);
+    globus_cond_init(&bench_cond, NULL);
+
+    for(i = 0; i < nchains; i++)
+    {
+        skip(no_threads,
+            ok(bench_run("thread_pool", globus_i_thread_start,
+                    chains[i], ops) == 0,
+                "thread_pool_%d_chains", chains[i]));
+    }
+
+    if(!no_threads)
+    {
+        fifo_pool_init();
+    }
+    for(i = 0; i < nchains; i++)
+    {
+        skip(no_threads,
+            ok(bench_run("fifo_pool", fifo_pool_start, chains[i], ops) == 0,
+                "fifo_pool_%d_chains", chains[i]));
+    }
+    if(!no_threads)
+    {
+        fifo_pool_destroy();
+    }
+
+    globus_cond_destroy(&bench_cond);
+    globus_mutex_destroy(&bench_mutex);
+    globus_module_deactivate(GLOBUS_COMMON_MODULE);
+
+    return TEST_EXIT_CODE;
+}
@@ -2039,6 +2039,21 @@ globus_l_gass_copy_target_populate(
 		target->n_simultaneous = tmp_parallelism.fixed.size;
 		/*target->n_simultaneous = 1;*/
 	    }
+	    else if(tmp_parallelism.mode ==
+	        GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC)
+	    {
+		globus_size_t  min_size;
+		globus_size_t  max_size;
+
+		/* enough buffers in flight for the most streams it may use */
+		globus_ftp_client_operationattr_get_parallelism_range(
+		    attr->ftp_attr, &min_size, &max_size);
+		target->n_simultaneous = tmp_parallelism.base.size;
+		if(max_size > target->n_simultaneous)
+		{
+		    target->n_simultaneous = max_size;
+		}
+	    }
 	    else
 		target->n_simultaneous = 1;
 	}
@@ -222,6 +222,8 @@ typedef struct
     globus_size_t                       block_size;
     globus_size_t                       tcp_buffer_size;
     int                                 num_streams;
+    int                                 num_streams_min;
+    int                                 num_streams_max;
     int                                 conc;
     globus_bool_t                       no_3pt;
     globus_bool_t                       no_dcau;
@@ -570,6 +572,11 @@ const char * long_usage =
 "       underlying transfer methods\n"
 "  -p <parallelism> | -parallel <parallelism>\n"
 "       specify the number of parallel data connections should be used.\n"
+"  -pmin <parallelism> | -parallel-min <parallelism>\n"
+"  -pmax <parallelism> | -parallel-max <parallelism>\n"
+"       let the sender open or retire data connections during the transfer,\n"
+"       within this range, as throughput changes.  -pmin defaults to 1,\n"
+"       and the transfer starts with -p (or -pmin) connections.\n"
    
 "  -notpt | -no-third-party-transfers\n"
 "       turn third-party transfers off (on by default)\n"
@@ -778,6 +785,8 @@ enum
     arg_s, 
     arg_t, 
     arg_p, 
+    arg_pmin,
+    arg_pmax,
     arg_f, 
     arg_vb,
     arg_q, 
@@ -929,6 +938,8 @@ oneargdef(arg_stripe_bs, "-sbs", "-striped-block-size", test_integer, GLOBUS_NUL
 oneargdef(arg_bs, "-bs", "-block-size", test_integer, GLOBUS_NULL);
 oneargdef(arg_tcp_bs, "-tcp-bs", "-tcp-buffer-size", test_integer, GLOBUS_NULL);
 oneargdef(arg_p, "-p", "-parallel", test_integer, GLOBUS_NULL);
+oneargdef(arg_pmin, "-pmin", "-parallel-min", test_integer, GLOBUS_NULL);
+oneargdef(arg_pmax, "-pmax", "-parallel-max", test_integer, GLOBUS_NULL);
 oneargdef(arg_t, "-t", "-transfer-time", GLOBUS_NULL, GLOBUS_NULL);
 oneargdef(arg_s, "-s", "-subject", GLOBUS_NULL, GLOBUS_NULL);
 oneargdef(arg_ss, "-ss", "-source-subject", GLOBUS_NULL, GLOBUS_NULL);
@@ -997,6 +1008,8 @@ static globus_args_option_descriptor_t args_options[arg_num];
     setupopt(arg_bs);                   \
     setupopt(arg_conc);                 \
     setupopt(arg_p);                    \
+    setupopt(arg_pmin);                 \
+    setupopt(arg_pmax);                 \
     setupopt(arg_notpt);                \
     setupopt(arg_nodcau);               \
     setupopt(arg_data_safe);            \
@@ -3647,6 +3660,8 @@ globus_l_guc_parse_arguments(
     guc_info->data_private = GLOBUS_FALSE;
     guc_info->recurse = GLOBUS_FALSE;
     guc_info->num_streams = 0;
+    guc_info->num_streams_min = 0;
+    guc_info->num_streams_max = 0;
     guc_info->conc = 1;
     guc_info->tcp_buffer_size = 0;
     guc_info->block_size = 0;
@@ -3869,6 +3884,12 @@ globus_l_guc_parse_arguments(
                 guc_info->num_streams = 1;
             }
             break;
+        case arg_pmin:
+            guc_info->num_streams_min = atoi(instance->values[0]);
+            break;
+        case arg_pmax:
+            guc_info->num_streams_max = atoi(instance->values[0]);
+            break;
         case arg_conc:
             guc_info->conc = atoi(instance->values[0]);
             break;
@@ -5878,6 +5899,8 @@ globus_l_guc_gass_attr_init(
     globus_gass_copy_url_mode_t         url_mode;
     globus_ftp_control_tcpbuffer_t      tcp_buffer;
     globus_ftp_control_parallelism_t    parallelism;
+    globus_size_t                       min_size;
+    globus_size_t                       max_size;
     globus_ftp_control_dcau_t           dcau;
     globus_ftp_control_layout_t         layout;
     const char *                        gsi_driver_str = NULL;
@@ -5939,14 +5962,42 @@ globus_l_guc_gass_attr_init(
                 &tcp_buffer);
         }
 
-        if(guc_info->num_streams >= 1)
+        if(guc_info->num_streams >= 1 || guc_info->num_streams_max > 1)
         {
             globus_ftp_client_operationattr_set_mode(
                 ftp_attr,
                 GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK);
 
-            parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_FIXED;
-            parallelism.fixed.size = guc_info->num_streams;
+            if(guc_info->num_streams_max > 1)
+            {
+                min_size = guc_info->num_streams_min;
+                if(min_size < 1)
+                {
+                    min_size = 1;
+                }
+                max_size = guc_info->num_streams_max;
+                if(max_size < min_size)
+                {
+                    max_size = min_size;
+                }
+                parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC;
+                parallelism.base.size = guc_info->num_streams;
+                if(parallelism.base.size < min_size)
+                {
+                    parallelism.base.size = min_size;
+                }
+                if(parallelism.base.size > max_size)
+                {
+                    parallelism.base.size = max_size;
+                }
+                globus_ftp_client_operationattr_set_parallelism_range(
+                    ftp_attr, min_size, max_size);
+            }
+            else
+            {
+                parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_FIXED;
+                parallelism.fixed.size = guc_info->num_streams;
+            }
             globus_ftp_client_operationattr_set_parallelism(
                 ftp_attr,
                 &parallelism); 
@@ -106,6 +106,15 @@ globus_l_gram_job_manager_request_load_all_from_dir(
     globus_gram_job_manager_t *         manager,
     const char *                        state_file_dir,
     const char *                        state_file_pattern);
+
+static
+int
+globus_l_gram_job_manager_request_load(
+    globus_gram_job_manager_t *         manager,
+    const char *                        state_file_dir,
+    uint64_t                            uniq1,
+    uint64_t                            uniq2,
+    char *                              key);
 #endif /* GLOBUS_DONT_DOCUMENT_INTERNAL */
 
 /**
@@ -152,6 +161,7 @@ globus_gram_job_manager_init(
     manager->expiration_handle = GLOBUS_NULL_HANDLE;
     manager->lockcheck_handle = GLOBUS_NULL_HANDLE;
     manager->idle_script_handle = GLOBUS_NULL_HANDLE;
+    manager->state_journal = NULL;
 
     rc = globus_mutex_init(&manager->mutex, NULL);
     if (rc != GLOBUS_SUCCESS)
@@ -2216,6 +2226,10 @@ globus_gram_job_manager_request_load_all(
 {
     int                                 rc = GLOBUS_SUCCESS;
     char *                              state_file_pattern = NULL;
+    globus_list_t *                     journal_jobs = NULL;
+    char *                              uniq_id;
+    uint64_t                            uniq1, uniq2;
+    char *                              key;
 
     GlobusGramJobManagerLock(manager);
     globus_gram_job_manager_log(
@@ -2225,6 +2239,41 @@ globus_gram_job_manager_request_load_all(
             "level=DEBUG "
             "\n");
 
+    if (manager->config->state_journal_disabled)
+    {
+        /* Move jobs from a journal left by an earlier job manager to state
+         * files, which are loaded below
+         */
+        globus_gram_job_manager_state_journal_export_all(manager);
+    }
+    else if (globus_gram_job_manager_state_journal_open(manager)
+                == GLOBUS_SUCCESS)
+    {
+        globus_gram_job_manager_state_journal_list(manager, &journal_jobs);
+    }
+    while (!globus_list_empty(journal_jobs))
+    {
+        uniq_id = globus_list_remove(&journal_jobs, journal_jobs);
+
+        if (sscanf(uniq_id, "%"PRIu64".%"PRIu64, &uniq1, &uniq2) == 2)
+        {
+            key = globus_common_create_string(
+                    "/%"PRIu64"/%"PRIu64"/",
+                    uniq1,
+                    uniq2);
+            if (key != NULL)
+            {
+                globus_l_gram_job_manager_request_load(
+                        manager,
+                        manager->config->job_state_file_dir,
+                        uniq1,
+                        uniq2,
+                        key);
+            }
+        }
+        free(uniq_id);
+    }
+
     state_file_pattern = globus_common_create_string(
             "job.%s.%%"PRIu64".%%"PRIu64"%%n",
             manager->config->hostname);
@@ -2325,8 +2374,6 @@ globus_l_gram_job_manager_request_load_all_from_dir(
     int                                 lock;
     struct dirent *                     entry;
     uint64_t                            uniq1, uniq2;
-    globus_gram_jobmanager_request_t *  request;
-    globus_gram_job_manager_ref_t *     ref;
     struct stat                         st;
     char *                              full_path;
     uid_t                               uid = getuid();
@@ -2437,8 +2484,6 @@ globus_l_gram_job_manager_request_load_all_from_dir(
             }
 
             rc = stat(full_path, &st);
-            free(full_path);
-            full_path = NULL;
             if (rc < 0)
             {
                 globus_gram_job_manager_log(
@@ -2460,6 +2505,8 @@ globus_l_gram_job_manager_request_load_all_from_dir(
                         errno,
                         strerror(errno));
 
+                free(full_path);
+                full_path = NULL;
                 free(key);
                 key = NULL;
                 free(entry);
@@ -2481,181 +2528,50 @@ globus_l_gram_job_manager_request_load_all_from_dir(
                         entry->d_name,
                         (int) st.st_uid,
                         (int) uid);
+                free(full_path);
+                full_path = NULL;
                 free(key);
                 key = NULL;
                 free(entry);
                 entry = NULL;
                 continue;
             }
-            rc = globus_l_gram_restart_job(
-                    manager,
-                    &request,
-                    key+1);
-            free(entry);
-
-            if (rc != GLOBUS_SUCCESS)
-            {
-                if (rc != GLOBUS_GRAM_PROTOCOL_ERROR_OLD_JM_ALIVE)
-                {
-                    globus_gram_job_manager_log(
-                            manager,
-                            GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
-                            "event=gram.reload_requests.info "
-                            "level=WARN "
-                            "statedir=\"%s\" "
-                            "msg=\"%s\" "
-                            "gramid=/%"PRIu64"/%"PRIu64"/ "
-                            "status=%d "
-                            "reason=\"%s\"\n",
-                            state_file_dir,
-                            "Error restarting job",
-                            uniq1,
-                            uniq2,
-                            -rc,
-                            globus_gram_protocol_error_string(rc));
-                }
-
-                free(key);
-                continue;
-            }
-
-            /* Set the SEG timestamp to be the earliest value in any of the
-             * jobs we will manage.
-             */
-            if (manager->seg_last_timestamp == 0 ||
-                manager->seg_last_timestamp > request->seg_last_timestamp)
-            {
-                manager->seg_last_timestamp = request->seg_last_timestamp;
-            }
-
-            /* Optimize the (hopefully) common case. The job is pending
-             * or active in the queue and we will want to wait for
-             * job state changes. In this case, we add the reference to
-             * the job's LRM job id 
-             */
-            if ((request->config->seg_module != NULL ||
-                 strcmp(request->config->jobmanager_type, "fork") == 0 ||
-                 strcmp(request->config->jobmanager_type, "condor") == 0) &&
-                (request->restart_state ==
-                        GLOBUS_GRAM_JOB_MANAGER_STATE_POLL1 ||
-                 request->restart_state ==
-                        GLOBUS_GRAM_JOB_MANAGER_STATE_POLL2 ||
-                 request->restart_state ==
-                        GLOBUS_GRAM_JOB_MANAGER_STATE_POLL_QUERY1 ||
-                 request->restart_state ==
-                        GLOBUS_GRAM_JOB_MANAGER_STATE_POLL_QUERY2))
-            {
-                rc = globus_gram_job_manager_register_job_id(
-                        request->manager,
-                        request->job_id_string,
-                        request,
-                        GLOBUS_TRUE);
-                if (rc != GLOBUS_SUCCESS)
-                {
-                    globus_gram_job_manager_request_log(
-                            request,
-                            GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
-                            "event=gram.reload_requests.info "
-                            "level=WARN "
-                            "statedir=\"%s\" "
-                            "msg=\"%s\" "
-                            "gramid=/%"PRIu64"/%"PRIu64"/ "
-                            "status=%d "
-                            "reason=\"%s\" "
-                            "\n",
-                            state_file_dir,
-                            "Error registering job id",
-                            uniq1,
-                            uniq2,
-                            -rc,
-                            globus_gram_protocol_error_string(rc));
-                }
-                request->jobmanager_state = GLOBUS_GRAM_JOB_MANAGER_STATE_POLL2;
-            }
-            /* Add a stub in the job manager's request_hash for this job. The
-             * Reference count will be left at 0, and we will null out the
-             * ref->request pointer below. This allows queries, SEG events, and 
-             * the restart code to look up the job ID without the entire
-             * request remaining in memory.
-             */
-            rc = globus_l_gram_job_manager_add_ref_stub(
-                    request->manager,
-                    request->job_contact_path,
-                    request,
-                    &ref);
-            if (rc != GLOBUS_SUCCESS)
+            if (globus_gram_job_manager_state_journal_contains(
+                    manager, key+1))
             {
-                globus_gram_job_manager_request_log(
-                        request,
-                        GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
+                /* Already imported into the state journal */
+                globus_gram_job_manager_log(
+                        manager,
+                        GLOBUS_GRAM_JOB_MANAGER_LOG_DEBUG,
                         "event=gram.reload_requests.info "
-                        "level=WARN "
+                        "level=DEBUG "
                         "statedir=\"%s\" "
+                        "statefile=\"%s\" "
                         "msg=\"%s\" "
-                        "gramid=%"PRIu64"/%"PRIu64" "
-                        "status=%d "
-                        "reason=\"%s\" "
+                        "gramid=/%"PRIu64"/%"PRIu64"/ "
                         "\n",
                         state_file_dir,
-                        "Error registering job id",
+                        entry->d_name,
+                        "Removing state file of job in state journal",
                         uniq1,
-                        uniq2,
-                        -rc,
-                        globus_gram_protocol_error_string(rc));
-            }
-            if (ref != NULL)
-            {
-                /* We don't want to keep this reference active. We want it
-                 * to look like the job was swapped out
-                 */
-                ref->request = NULL;
-            }
-            if (request &&
-                request->jobmanager_state !=
-                        GLOBUS_GRAM_JOB_MANAGER_STATE_POLL2)
-            {
-                rc = globus_list_insert(
-                        &manager->pending_restarts,
-                        key);
-                key = NULL;
-            }
-            /* Indicate that it will need some special handling when its
-             * first reference is added
-             */
-            ref->loaded_only = GLOBUS_TRUE;
-
-            if (request)
-            {
-                globus_gram_job_manager_request_free(request);
-                free(request);
-                request = NULL;
+                        uniq2);
+                remove(full_path);
+                free(key);
             }
-            if (rc != GLOBUS_SUCCESS)
+            else
             {
-                rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
-
-                globus_gram_job_manager_log(
+                globus_l_gram_job_manager_request_load(
                         manager,
-                        GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
-                        "event=gram.reload_requests.info "
-                        "level=WARN "
-                        "statedir=\"%s\" "
-                        "msg=\"%s\" "
-                        "gramid=%"PRIu64"/%"PRIu64" "
-                        "errno=%d "
-                        "reason=\"%s\"\n",
                         state_file_dir,
-                        "Error inserting job into request list",
                         uniq1,
                         uniq2,
-                        globus_gram_protocol_error_string(rc));
-
-            }
-            if (key)
-            {
-                free(key);
-                key = NULL;
+                        key);
             }
+            key = NULL;
+            free(full_path);
+            full_path = NULL;
+            free(entry);
+            entry = NULL;
         }
         else
         {
@@ -2670,6 +2586,213 @@ opendir_failed:
 }
 /* globus_l_gram_job_manager_request_load_all_from_dir() */
 
+/*
+ * Restart the job with the given key, adding it to the list of jobs to
+ * restart or, if it is waiting for LRM events, leaving it swapped out. A job
+ * restarted from a state file is moved into the state journal, if the job
+ * manager has one. The key is freed or kept in the pending_restarts list.
+ */
+static
+int
+globus_l_gram_job_manager_request_load(
+    globus_gram_job_manager_t *         manager,
+    const char *                        state_file_dir,
+    uint64_t                            uniq1,
+    uint64_t                            uniq2,
+    char *                              key)
+{
+    int                                 rc;
+    globus_gram_jobmanager_request_t *  request;
+    globus_gram_job_manager_ref_t *     ref;
+
+    rc = globus_l_gram_restart_job(
+            manager,
+            &request,
+            key+1);
+
+    if (rc == GLOBUS_SUCCESS &&
+        manager->state_journal != NULL &&
+        !globus_gram_job_manager_state_journal_contains(manager, key+1))
+    {
+        /* Import the job into the journal. Its state file is removed once
+         * the journal has it.
+         */
+        rc = globus_gram_job_manager_state_file_write(request);
+        if (rc != GLOBUS_SUCCESS)
+        {
+            globus_gram_job_manager_request_free(request);
+            free(request);
+            request = NULL;
+        }
+    }
+    if (rc != GLOBUS_SUCCESS)
+    {
+        if (rc != GLOBUS_GRAM_PROTOCOL_ERROR_OLD_JM_ALIVE)
+        {
+            globus_gram_job_manager_log(
+                    manager,
+                    GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
+                    "event=gram.reload_requests.info "
+                    "level=WARN "
+                    "statedir=\"%s\" "
+                    "msg=\"%s\" "
+                    "gramid=/%"PRIu64"/%"PRIu64"/ "
+                    "status=%d "
+                    "reason=\"%s\"\n",
+                    state_file_dir,
+                    "Error restarting job",
+                    uniq1,
+                    uniq2,
+                    -rc,
+                    globus_gram_protocol_error_string(rc));
+        }
+
+        free(key);
+        return rc;
+    }
+
+    /* Set the SEG timestamp to be the earliest value in any of the
+     * jobs we will manage.
+     */
+    if (manager->seg_last_timestamp == 0 ||
+        manager->seg_last_timestamp > request->seg_last_timestamp)
+    {
+        manager->seg_last_timestamp = request->seg_last_timestamp;
+    }
+
+    /* Optimize the (hopefully) common case. The job is pending
+     * or active in the queue and we will want to wait for
+     * job state changes. In this case, we add the reference to
+     * the job's LRM job id 
+     */
+    if ((request->config->seg_module != NULL ||
+         strcmp(request->config->jobmanager_type, "fork") == 0 ||
+         strcmp(request->config->jobmanager_type, "condor") == 0) &&
+        (request->restart_state ==
+                GLOBUS_GRAM_JOB_MANAGER_STATE_POLL1 ||
+         request->restart_state ==
+                GLOBUS_GRAM_JOB_MANAGER_STATE_POLL2 ||
+         request->restart_state ==
+                GLOBUS_GRAM_JOB_MANAGER_STATE_POLL_QUERY1 ||
+         request->restart_state ==
+                GLOBUS_GRAM_JOB_MANAGER_STATE_POLL_QUERY2))
+    {
+        rc = globus_gram_job_manager_register_job_id(
+                request->manager,
+                request->job_id_string,
+                request,
+                GLOBUS_TRUE);
+        if (rc != GLOBUS_SUCCESS)
+        {
+            globus_gram_job_manager_request_log(
+                    request,
+                    GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
+                    "event=gram.reload_requests.info "
+                    "level=WARN "
+                    "statedir=\"%s\" "
+                    "msg=\"%s\" "
+                    "gramid=/%"PRIu64"/%"PRIu64"/ "
+                    "status=%d "
+                    "reason=\"%s\" "
+                    "\n",
+                    state_file_dir,
+                    "Error registering job id",
+                    uniq1,
+                    uniq2,
+                    -rc,
+                    globus_gram_protocol_error_string(rc));
+        }
+        request->jobmanager_state = GLOBUS_GRAM_JOB_MANAGER_STATE_POLL2;
+    }
+    /* Add a stub in the job manager's request_hash for this job. The
+     * Reference count will be left at 0, and we will null out the
+     * ref->request pointer below. This allows queries, SEG events, and 
+     * the restart code to look up the job ID without the entire
+     * request remaining in memory.
+     */
+    rc = globus_l_gram_job_manager_add_ref_stub(
+            request->manager,
+            request->job_contact_path,
+            request,
+            &ref);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        globus_gram_job_manager_request_log(
+                request,
+                GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
+                "event=gram.reload_requests.info "
+                "level=WARN "
+                "statedir=\"%s\" "
+                "msg=\"%s\" "
+                "gramid=%"PRIu64"/%"PRIu64" "
+                "status=%d "
+                "reason=\"%s\" "
+                "\n",
+                state_file_dir,
+                "Error registering job id",
+                uniq1,
+                uniq2,
+                -rc,
+                globus_gram_protocol_error_string(rc));
+    }
+    if (ref != NULL)
+    {
+        /* We don't want to keep this reference active. We want it
+         * to look like the job was swapped out
+         */
+        ref->request = NULL;
+    }
+    if (request &&
+        request->jobmanager_state !=
+                GLOBUS_GRAM_JOB_MANAGER_STATE_POLL2)
+    {
+        rc = globus_list_insert(
+                &manager->pending_restarts,
+                key);
+        key = NULL;
+    }
+    /* Indicate that it will need some special handling when its
+     * first reference is added
+     */
+    ref->loaded_only = GLOBUS_TRUE;
+
+    if (request)
+    {
+        globus_gram_job_manager_request_free(request);
+        free(request);
+        request = NULL;
+    }
+    if (rc != GLOBUS_SUCCESS)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+
+        globus_gram_job_manager_log(
+                manager,
+                GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
+                "event=gram.reload_requests.info "
+                "level=WARN "
+                "statedir=\"%s\" "
+                "msg=\"%s\" "
+                "gramid=%"PRIu64"/%"PRIu64" "
+                "errno=%d "
+                "reason=\"%s\"\n",
+                state_file_dir,
+                "Error inserting job into request list",
+                uniq1,
+                uniq2,
+                globus_gram_protocol_error_string(rc));
+
+    }
+    if (key)
+    {
+        free(key);
+        key = NULL;
+    }
+
+    return rc;
+}
+/* globus_l_gram_job_manager_request_load() */
+
 int
 globus_i_gram_mkdir(
     char *                              path)
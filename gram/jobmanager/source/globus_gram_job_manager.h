@@ -122,6 +122,20 @@ typedef struct
 }
 globus_gram_script_priority_t;
 
+/** Script latency statistics for one priority level */
+typedef struct
+{
+    /** Number of script commands completed */
+    int                                 count;
+    /** Total and longest time commands waited in the queue, in ms */
+    long                                wait_total;
+    long                                wait_max;
+    /** Total and longest time from dispatch to reply, in ms */
+    long                                run_total;
+    long                                run_max;
+}
+globus_gram_script_stats_t;
+
 typedef struct
 {
     globus_gram_job_manager_staging_type_t
@@ -266,6 +280,11 @@ typedef struct
     char *                              tcp_source_range;
     /** Directory to store job_state files */
     char *                              job_state_file_dir;
+    /**
+     * Save job state in one state file per job instead of the state journal.
+     * Set from the config option -disable-state-journal.
+     */
+    globus_bool_t                       state_journal_disabled;
     /**
      * Site-wide trusted certificate path.
      */
@@ -347,6 +366,21 @@ typedef struct
      * on GRAM operations or not. Default to no.
      */
     globus_bool_t                       enable_callout;
+    /**
+     * Number of LRM script processes each client's requests may use,
+     * set by -script-pool-size. The default is 5.
+     */
+    int                                 script_pool_size;
+    /**
+     * Number of LRM script processes the pool may grow to when requests
+     * back up, set by -script-pool-max. The default is 20.
+     */
+    int                                 script_pool_max;
+    /**
+     * Number of script commands of the same kind written to a script
+     * process at once, set by -script-pipeline. The default is 4.
+     */
+    int                                 script_pipeline_depth;
 }
 globus_gram_job_manager_config_t;
 
@@ -408,9 +442,23 @@ typedef struct
     int                                 script_slots_available;
     /** Fifo of available script handles */
     globus_fifo_t                       script_handles;
+    /**
+     * Current limit on script processes, between the configured
+     * script_pool_size and script_pool_max
+     */
+    int                                 script_pool_size;
+    /** Longest script_queue since the statistics were last logged */
+    int                                 script_queue_peak;
+    /** Latency statistics per priority level since they were last logged */
+    globus_gram_script_stats_t          script_stats[
+                                        GLOBUS_GRAM_SCRIPT_PRIORITY_LEVEL_POLL+1];
 }
 globus_gram_job_manager_scripts_t;
 
+/** Append-only journal of job state, see globus_gram_job_manager_state_file.c */
+typedef struct globus_gram_job_manager_state_journal_s
+globus_gram_job_manager_state_journal_t;
+
 /**
  * Runtime state for a LRM instance. All of these items are
  * computed from the configuration state above and may change during the
@@ -517,6 +565,13 @@ typedef struct globus_gram_job_manager_s
      * Periodic callback handle to clse idle perl script xio handles
      */
     globus_callback_handle_t            idle_script_handle;
+
+    /**
+     * Journal holding the state of this job manager's jobs, or NULL if
+     * state is kept in per-job state files.
+     */
+    globus_gram_job_manager_state_journal_t *
+                                        state_journal;
 }
 globus_gram_job_manager_t;
 
@@ -1326,6 +1381,40 @@ int
 globus_gram_job_manager_state_file_write(
     globus_gram_jobmanager_request_t *  request);
 
+int
+globus_gram_job_manager_state_file_export(
+    globus_gram_jobmanager_request_t *  request);
+
+void
+globus_gram_job_manager_state_file_remove(
+    globus_gram_jobmanager_request_t *  request);
+
+void
+globus_gram_job_manager_state_file_touch(
+    globus_gram_jobmanager_request_t *  request);
+
+int
+globus_gram_job_manager_state_journal_open(
+    globus_gram_job_manager_t *         manager);
+
+void
+globus_gram_job_manager_state_journal_close(
+    globus_gram_job_manager_t *         manager);
+
+int
+globus_gram_job_manager_state_journal_list(
+    globus_gram_job_manager_t *         manager,
+    globus_list_t **                    uniq_ids);
+
+globus_bool_t
+globus_gram_job_manager_state_journal_contains(
+    globus_gram_job_manager_t *         manager,
+    const char *                        uniq_id);
+
+int
+globus_gram_job_manager_state_journal_export_all(
+    globus_gram_job_manager_t *         manager);
+
 int
 globus_gram_job_manager_state_file_register_update(
     globus_gram_jobmanager_request_t *  request);
@@ -238,6 +238,25 @@ globus_gram_job_manager_config_init(
         {
             config->job_state_file_dir = strdup(argv[++i]);
         }
+        else if (strcmp(argv[i], "-disable-state-journal") == 0)
+        {
+            config->state_journal_disabled = GLOBUS_TRUE;
+        }
+        else if ((strcmp(argv[i], "-script-pool-size") == 0)
+                 && (i + 1 < argc))
+        {
+            config->script_pool_size = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-script-pool-max") == 0)
+                 && (i + 1 < argc))
+        {
+            config->script_pool_max = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-script-pipeline") == 0)
+                 && (i + 1 < argc))
+        {
+            config->script_pipeline_depth = atoi(argv[++i]);
+        }
         else if ((strcmp(argv[i], "-x509-cert-dir") == 0)
                  && (i + 1 < argc))
         {
@@ -406,6 +425,10 @@ globus_gram_job_manager_config_init(
                     "\t-stdio-log DIRECTORY\n"
                     "\t-log-levels TRACE|INFO|DEBUG|WARN|ERROR|FATAL\n"
                     "\t-state-file-dir state-directory\n"
+                    "\t-disable-state-journal\n"
+                    "\t-script-pool-size COUNT\n"
+                    "\t-script-pool-max COUNT\n"
+                    "\t-script-pipeline COUNT\n"
                     "\t-globus-tcp-port-range <min port #>,<max port #>\n"
                     "\t-globus-tcp-source-range <min port #>,<max port #>\n"
                     "\t-x509-cert-dir DIRECTORY\n"
@@ -447,6 +470,24 @@ globus_gram_job_manager_config_init(
     config->log_levels |= GLOBUS_GRAM_JOB_MANAGER_LOG_FATAL
                        |  GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR;
 
+    /* Script pool defaults. The pool never shrinks below its initial size */
+    if (config->script_pool_size <= 0)
+    {
+        config->script_pool_size = 5;
+    }
+    if (config->script_pool_max <= 0)
+    {
+        config->script_pool_max = 20;
+    }
+    if (config->script_pool_max < config->script_pool_size)
+    {
+        config->script_pool_max = config->script_pool_size;
+    }
+    if (config->script_pipeline_depth <= 0)
+    {
+        config->script_pipeline_depth = 4;
+    }
+
     /* Verify that required values are present */
     if(config->jobmanager_type == NULL)
     {
@@ -20,7 +20,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
-#include <utime.h>
 
 static const char * GLOBUS_GRAM_SCRIPT_NO_CLIENT = "noclient";
 
@@ -38,9 +37,24 @@ typedef struct globus_gram_script_handle_s
     globus_result_t                     result;
     int                                 pending_ops;
     time_t                              last_use;
+    /** Script contexts written to the script, in the order it replies */
+    globus_fifo_t                       contexts;
+    /** Commands of all contexts in the batch, written with one writev */
+    struct iovec *                      iov;
+    int                                 iovcnt;
 }
 *globus_gram_script_handle_t;
 
+static const char * globus_l_gram_script_priority_names[] =
+{
+    "cancel",
+    "signal",
+    "submit",
+    "stage_out",
+    "stage_in",
+    "poll"
+};
+
 int
 globus_gram_job_manager_script_handle_init(
     globus_gram_job_manager_t *         manager,
@@ -88,6 +102,9 @@ typedef struct
     int                                 iovcnt;
     globus_gram_script_handle_t         handle;
     globus_gram_script_priority_t       priority;
+    /** When the context was queued and when it was written to a script */
+    globus_abstime_t                    queued_time;
+    globus_abstime_t                    start_time;
 }
 globus_gram_job_manager_script_context_t;
 
@@ -197,9 +214,43 @@ globus_l_gram_script_open_callback(
 static
 int
 globus_l_gram_script_register_read_and_write(
-    globus_gram_job_manager_script_context_t * 
+    globus_gram_script_handle_t         script_handle);
+
+static
+void
+globus_l_gram_script_read_next(
+    globus_gram_job_manager_script_context_t *
                                         script_context);
 
+static
+void
+globus_l_gram_script_requeue_locked(
+    globus_gram_job_manager_scripts_t * scripts,
+    globus_gram_script_handle_t         script_handle);
+
+static
+void
+globus_l_gram_script_fail_contexts(
+    globus_fifo_t *                     contexts);
+
+static
+void
+globus_l_gram_script_handle_destroy(
+    globus_gram_script_handle_t         script_handle);
+
+static
+void
+globus_l_gram_script_stats_update_locked(
+    globus_gram_job_manager_scripts_t * scripts,
+    globus_gram_job_manager_script_context_t *
+                                        script_context);
+
+static
+void
+globus_l_gram_script_stats_log_locked(
+    globus_gram_job_manager_t *         manager,
+    globus_gram_job_manager_scripts_t * scripts);
+
 static
 int
 globus_l_gram_script_priority_cmp(
@@ -373,6 +424,9 @@ globus_l_gram_job_manager_script_read(
     int                                 failure_code = 0;
     int                                 i;
     globus_gram_job_manager_scripts_t * scripts;
+    globus_gram_job_manager_script_context_t *
+                                        next_context;
+    globus_fifo_t                       failed;
 
     script_context = user_arg;
     request = script_context->request;
@@ -484,8 +538,13 @@ globus_l_gram_job_manager_script_read(
 
         if (*script_variable == 0)
         {
-            /* End of input */
+            /* End of input. Anything after it is the reply to the next
+             * command in the batch.
+             */
             eof = GLOBUS_TRUE;
+            memmove(&script_handle->return_buf[0],
+                    &script_handle->return_buf[newline_offset+1],
+                    script_handle->return_buf_offset - newline_offset - 1);
             script_handle->return_buf_offset -= newline_offset + 1;
             break;
         }
@@ -632,7 +691,22 @@ globus_l_gram_job_manager_script_read(
     script_handle = script_context->handle;
 
     GlobusGramJobManagerLock(request->manager);
-    script_handle->pending_ops--;
+    globus_fifo_dequeue(&script_handle->contexts);
+    if (result != GLOBUS_SUCCESS)
+    {
+        if (script_handle->result == GLOBUS_SUCCESS)
+        {
+            script_handle->result = result;
+        }
+        /* The script won't answer the rest of the batch */
+        globus_fifo_move(&failed, &script_handle->contexts);
+    }
+    else
+    {
+        globus_fifo_init(&failed);
+    }
+    next_context = globus_fifo_empty(&script_handle->contexts)
+            ? NULL : globus_fifo_peek(&script_handle->contexts);
 
     scripts = globus_list_first(
             globus_list_search_pred(
@@ -642,7 +716,13 @@ globus_l_gram_job_manager_script_read(
                         ? request->job_stats.client_address
                         : (void *) GLOBUS_GRAM_SCRIPT_NO_CLIENT));
 
-    globus_l_gram_job_manager_script_done(request->manager, scripts, script_handle);
+    globus_l_gram_script_stats_update_locked(scripts, script_context);
+    if (next_context == NULL)
+    {
+        script_handle->pending_ops--;
+        globus_l_gram_job_manager_script_done(
+                request->manager, scripts, script_handle);
+    }
     GlobusGramJobManagerUnlock(request->manager);
 
     script_context->callback(
@@ -679,9 +759,76 @@ globus_l_gram_job_manager_script_read(
     }
     free(script_context->iov);
     free(script_context);
+
+    globus_l_gram_script_fail_contexts(&failed);
+    globus_fifo_destroy(&failed);
+
+    if (next_context != NULL)
+    {
+        globus_l_gram_script_read_next(next_context);
+    }
 }
 /* globus_l_gram_job_manager_script_read() */
 
+/**
+ * Read the reply to the next command in a batch
+ *
+ * Processes the reply if it is already buffered, otherwise registers a read
+ * for it.
+ *
+ * @param script_context
+ *     Context of the next command in its script handle's batch.
+ */
+static
+void
+globus_l_gram_script_read_next(
+    globus_gram_job_manager_script_context_t *
+                                        script_context)
+{
+    globus_gram_script_handle_t         script_handle;
+    globus_result_t                     result;
+
+    script_handle = script_context->handle;
+
+    if (script_handle->return_buf_offset == sizeof(script_handle->return_buf)
+        || memchr(script_handle->return_buf,
+                  '\n',
+                  script_handle->return_buf_offset) != NULL)
+    {
+        globus_l_gram_job_manager_script_read(
+                script_handle->handle,
+                GLOBUS_SUCCESS,
+                script_handle->return_buf,
+                sizeof(script_handle->return_buf),
+                0,
+                NULL,
+                script_context);
+        return;
+    }
+    result = globus_xio_register_read(
+            script_handle->handle,
+            &script_handle->return_buf[script_handle->return_buf_offset],
+            sizeof(script_handle->return_buf)
+                - script_handle->return_buf_offset,
+            1,
+            NULL,
+            globus_l_gram_job_manager_script_read,
+            script_context);
+    if (result != GLOBUS_SUCCESS)
+    {
+        /* Fails this and the rest of the batch */
+        globus_l_gram_job_manager_script_read(
+                script_handle->handle,
+                result,
+                script_handle->return_buf,
+                sizeof(script_handle->return_buf),
+                0,
+                NULL,
+                script_context);
+    }
+}
+/* globus_l_gram_script_read_next() */
+
 /**
  * Submit a job request to a local scheduler.
  *
@@ -1069,7 +1216,7 @@ globus_gram_job_manager_script_poll(
      */ 
     if(request->job_state_file)
     {
-        utime(request->job_state_file, NULL);
+        globus_gram_job_manager_state_file_touch(request);
     }
 
 
@@ -2361,6 +2508,7 @@ globus_l_gram_script_queue(
 
     GlobusGramJobManagerLock(manager);
     context->priority.sequence = globus_l_gram_next_script_sequence++;
+    GlobusTimeAbstimeGetCurrent(context->queued_time);
 
     tmp = globus_list_search_pred(
                 manager->scripts_per_client,
@@ -2406,8 +2554,13 @@ globus_l_gram_script_queue(
             goto script_queue_init_failed;
         }
 
-        /* Default number of scripts which can be run simultaneously */
-        scripts->script_slots_available = 5;
+        /* Number of scripts which can be run simultaneously until the
+         * queue backs up
+         */
+        scripts->script_pool_size = manager->config->script_pool_size;
+        scripts->script_slots_available = scripts->script_pool_size;
+        scripts->script_queue_peak = 0;
+        memset(scripts->script_stats, 0, sizeof(scripts->script_stats));
 
         rc = globus_fifo_init(&scripts->script_handles);
         if (rc != GLOBUS_SUCCESS)
@@ -2446,6 +2599,12 @@ scripts_contact_malloc_failed:
 
             goto fifo_enqueue_failed;
         }
+        if (globus_priority_q_size(&scripts->script_queue) >
+                scripts->script_queue_peak)
+        {
+            scripts->script_queue_peak =
+                    globus_priority_q_size(&scripts->script_queue);
+        }
 
         globus_l_gram_process_script_queue_locked(manager, scripts);
     }
@@ -2461,13 +2620,17 @@ fifo_enqueue_failed:
 /**
  * Start processing queued script commands on XIO handles.
  *
- * For each script context queued in the script fifo, either write its command
- * to an existing XIO handle or create a new XIO handle to process the script,
- * provided there are slots available for running more scripts. 
+ * For each batch of script contexts queued in the script queue, either write
+ * their commands to an existing XIO handle or create a new XIO handle to
+ * process them, provided there are slots available for running more scripts.
+ * A batch is up to script_pipeline_depth contexts of the same priority level,
+ * which the script answers in order. When there are more queued contexts than
+ * the running scripts could take in one batch each, the pool grows by one
+ * script, up to script_pool_max.
  *
  * The mutex associated with the @a manager parameter must be locked when this
  * procedure is called.
- * 
+ *
  * @param manager
  *     Job manager state
  * @param scripts
@@ -2482,24 +2645,50 @@ globus_l_gram_process_script_queue_locked(
     int                                 rc = GLOBUS_SUCCESS;
     globus_gram_job_manager_script_context_t *
                                         head = NULL;
+    globus_gram_script_handle_t         handle;
+    globus_gram_script_priority_level_t priority_level;
+    globus_bool_t                       reused;
+    globus_abstime_t                    now;
     globus_result_t                     result;
 
-    while ((!globus_priority_q_empty(&scripts->script_queue)) &&
-           (scripts->script_slots_available > 0 ||
-            !globus_fifo_empty(&scripts->script_handles)))
+    while (!globus_priority_q_empty(&scripts->script_queue))
     {
-        /* head may be non-null if we fail due to an I/O error below (see
-         * the "continue" statements
-         */
-        if (head == NULL)
+        if (scripts->script_slots_available == 0 &&
+            globus_fifo_empty(&scripts->script_handles) &&
+            scripts->script_pool_size < manager->config->script_pool_max &&
+            globus_priority_q_size(&scripts->script_queue) >
+                scripts->script_pool_size *
+                manager->config->script_pipeline_depth)
         {
-            head = globus_priority_q_first(&scripts->script_queue);
+            scripts->script_pool_size++;
+            scripts->script_slots_available++;
+
+            globus_gram_job_manager_log(
+                    manager,
+                    GLOBUS_GRAM_JOB_MANAGER_LOG_INFO,
+                    "event=gram.script_pool.info "
+                    "level=INFO "
+                    "client=%s "
+                    "msg=\"%s\" "
+                    "pool_size=%d "
+                    "queued=%d "
+                    "\n",
+                    scripts->client_addr,
+                    "Growing script pool",
+                    scripts->script_pool_size,
+                    globus_priority_q_size(&scripts->script_queue));
+        }
+        if (scripts->script_slots_available == 0 &&
+            globus_fifo_empty(&scripts->script_handles))
+        {
+            break;
         }
 
         /* Prefer to reuse a handle to the script */
         if (!globus_fifo_empty(&scripts->script_handles))
         {
-            head->handle = globus_fifo_dequeue(&scripts->script_handles);
+            handle = globus_fifo_dequeue(&scripts->script_handles);
+            reused = GLOBUS_TRUE;
             globus_gram_job_manager_log(
                     manager,
                     GLOBUS_GRAM_JOB_MANAGER_LOG_DEBUG,
@@ -2509,22 +2698,16 @@ globus_l_gram_process_script_queue_locked(
                     "handle=%p "
                     "\n",
                     "Using script handle from fifo",
-                    head->handle);
-            rc = globus_l_gram_script_register_read_and_write(head);
-            if (rc != GLOBUS_SUCCESS)
-            {
-                rc = GLOBUS_SUCCESS;
-                continue;
-            }
+                    handle);
         }
-        else 
+        else
         {
             /* Create a new script if more slots are available */
-            assert(scripts->script_slots_available > 0);
             rc = globus_gram_job_manager_script_handle_init(
                     manager,
                     scripts,
-                    &head->handle);
+                    &handle);
+            reused = GLOBUS_FALSE;
             globus_gram_job_manager_log(
                     manager,
                     GLOBUS_GRAM_JOB_MANAGER_LOG_DEBUG,
@@ -2535,84 +2718,136 @@ globus_l_gram_process_script_queue_locked(
                     "rc=%d "
                     "\n",
                     "Created new script handle",
-                    head->handle,
+                    handle,
                     -rc);
             if (rc != GLOBUS_SUCCESS)
             {
-                continue;
+                /* Try again when the next script finishes */
+                break;
             }
+            scripts->script_slots_available--;
+        }
 
+        /* Batch commands of the same kind, e.g. a burst of submits or
+         * polls, so the script handles them one after another
+         */
+        GlobusTimeAbstimeGetCurrent(now);
+        head = globus_priority_q_first(&scripts->script_queue);
+        priority_level = head->priority.priority_level;
+        do
+        {
+            head = globus_priority_q_dequeue(&scripts->script_queue);
+            head->handle = handle;
+            head->start_time = now;
+            globus_fifo_enqueue(&handle->contexts, head);
+
+            head = globus_priority_q_first(&scripts->script_queue);
+        }
+        while (head != NULL &&
+               head->priority.priority_level == priority_level &&
+               globus_fifo_size(&handle->contexts) <
+                    manager->config->script_pipeline_depth);
+
+        if (reused)
+        {
+            rc = globus_l_gram_script_register_read_and_write(handle);
+            if (rc != GLOBUS_SUCCESS)
+            {
+                /* Try the batch with another script */
+                globus_l_gram_script_requeue_locked(scripts, handle);
+                globus_xio_register_close(
+                        handle->handle,
+                        NULL,
+                        globus_l_script_close_callback,
+                        handle);
+                scripts->script_slots_available++;
+                rc = GLOBUS_SUCCESS;
+                continue;
+            }
+        }
+        else
+        {
             result = globus_xio_register_open(
-                head->handle->handle,
+                handle->handle,
                 NULL,
                 manager->script_attr,
                 globus_l_gram_script_open_callback,
-                head);
+                handle);
 
             if (result != GLOBUS_SUCCESS)
             {
+                globus_l_gram_script_requeue_locked(scripts, handle);
                 /* I think blocking call is safe here */
-                globus_xio_close(head->handle->handle, NULL);
-                head->handle->handle = NULL;
-                continue;
+                globus_xio_close(handle->handle, NULL);
+                globus_l_gram_script_handle_destroy(handle);
+                scripts->script_slots_available++;
+                break;
             }
 
-            head->handle->pending_ops++;
-            scripts->script_slots_available--;
+            handle->pending_ops++;
         }
-        globus_priority_q_dequeue(&scripts->script_queue);
-        head = NULL;
     }
 
     return;
 }
 /* globus_l_gram_process_script_queue_locked() */
 
+/**
+ * Return a script handle's batch to the script queue
+ *
+ * The mutex associated with the job manager must be locked when this
+ * procedure is called.
+ *
+ * @param scripts
+ *     Client-specific script handle collection
+ * @param script_handle
+ *     Handle whose batch could not be written.
+ */
 static
 void
-globus_l_gram_script_open_callback(
-    globus_xio_handle_t                 handle,
-    globus_result_t                     result,
-    void *                              user_arg)
+globus_l_gram_script_requeue_locked(
+    globus_gram_job_manager_scripts_t * scripts,
+    globus_gram_script_handle_t         script_handle)
 {
     globus_gram_job_manager_script_context_t *
-                                        context = user_arg;
-    globus_gram_script_handle_t         script_handle = context->handle;
-    globus_gram_jobmanager_request_t *  request = context->request;
-    int                                 rc = GLOBUS_SUCCESS;
-    int                                 i;
-    globus_gram_job_manager_scripts_t * scripts;
+                                        context;
 
-    script_handle->pending_ops--;
-
-    if (result == GLOBUS_SUCCESS)
-    {
-        rc = globus_l_gram_script_register_read_and_write(context);
-    }
-    else
+    while (!globus_fifo_empty(&script_handle->contexts))
     {
-        rc = GLOBUS_GRAM_PROTOCOL_ERROR_OPENING_JOBMANAGER_SCRIPT;
+        context = globus_fifo_dequeue(&script_handle->contexts);
+        context->handle = NULL;
+        globus_priority_q_enqueue(
+                &scripts->script_queue,
+                context,
+                &context->priority);
     }
+}
+/* globus_l_gram_script_requeue_locked() */
 
+/**
+ * Fail script contexts which a script will not answer
+ *
+ * Calls each context's callback with a script failure, as though the script
+ * had failed, and frees it.
+ *
+ * @param contexts
+ *     Fifo of contexts. All contexts are removed from this fifo, but it will
+ *     not be destroyed.
+ */
+static
+void
+globus_l_gram_script_fail_contexts(
+    globus_fifo_t *                     contexts)
+{
+    globus_gram_job_manager_script_context_t *
+                                        context;
+    globus_gram_jobmanager_request_t *  request;
+    int                                 i;
 
-    if (rc != GLOBUS_SUCCESS)
+    while (!globus_fifo_empty(contexts))
     {
-        GlobusGramJobManagerLock(script_handle->manager);
-        scripts = globus_list_first(
-                globus_list_search_pred(
-                        request->manager->scripts_per_client,
-                        globus_l_match_script_client_addr,
-                        request->job_stats.client_address
-                        ? request->job_stats.client_address
-                        : (void *) GLOBUS_GRAM_SCRIPT_NO_CLIENT));
-        
-        globus_xio_register_close(
-                handle,
-                NULL,
-                globus_l_script_close_callback,
-                script_handle);
-        scripts->script_slots_available++;
-        GlobusGramJobManagerUnlock(script_handle->manager);
+        context = globus_fifo_dequeue(contexts);
+        request = context->request;
 
         context->callback(
             context->callback_arg,
@@ -2635,42 +2870,145 @@ globus_l_gram_script_open_callback(
         free(context);
     }
 }
+/* globus_l_gram_script_fail_contexts() */
+
+static
+void
+globus_l_gram_script_open_callback(
+    globus_xio_handle_t                 handle,
+    globus_result_t                     result,
+    void *                              user_arg)
+{
+    globus_gram_script_handle_t         script_handle = user_arg;
+    int                                 rc = GLOBUS_SUCCESS;
+    globus_fifo_t                       failed;
+
+    GlobusGramJobManagerLock(script_handle->manager);
+    script_handle->pending_ops--;
+
+    if (result == GLOBUS_SUCCESS)
+    {
+        rc = globus_l_gram_script_register_read_and_write(script_handle);
+    }
+    else
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_OPENING_JOBMANAGER_SCRIPT;
+    }
+
+    if (rc != GLOBUS_SUCCESS)
+    {
+        globus_fifo_move(&failed, &script_handle->contexts);
+
+        globus_xio_register_close(
+                handle,
+                NULL,
+                globus_l_script_close_callback,
+                script_handle);
+        script_handle->scripts->script_slots_available++;
+    }
+    GlobusGramJobManagerUnlock(script_handle->manager);
+
+    if (rc != GLOBUS_SUCCESS)
+    {
+        globus_l_gram_script_fail_contexts(&failed);
+        globus_fifo_destroy(&failed);
+    }
+}
 /* globus_l_gram_script_open_callback() */
 
+/**
+ * Write a script handle's batch of commands and read the first reply
+ *
+ * The read is registered first, so that if it fails nothing has been written
+ * and the caller may close the handle and run the batch elsewhere. Once the
+ * read is registered, the batch belongs to the handle: if the write fails,
+ * the read is canceled and the batch fails in the read callback. When the
+ * write is registered, the handle takes over the command buffers from the
+ * contexts and frees them in the writev callback, as the script may reply to
+ * the first commands of the batch before the write finishes.
+ *
+ * The mutex associated with the job manager must be locked when this
+ * procedure is called.
+ *
+ * @param script_handle
+ *     Handle with a batch of contexts to run.
+ *
+ * @retval GLOBUS_SUCCESS
+ *     Success
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED
+ *     Malloc failed
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_OPENING_JOBMANAGER_SCRIPT
+ *     Error reading from the script
+ */
 static
 int
 globus_l_gram_script_register_read_and_write(
-    globus_gram_job_manager_script_context_t * 
-                                        script_context)
+    globus_gram_script_handle_t         script_handle)
 {
-    int                                 i, total_iov_contents;
+    int                                 i, j, n;
+    int                                 iovcnt, total_iov_contents;
     globus_result_t                     result;
     globus_gram_job_manager_t *         manager;
-    globus_gram_jobmanager_request_t *  request = script_context->request;
-    globus_gram_job_manager_scripts_t * scripts;
-    
-    manager = script_context->handle->manager;
+    globus_gram_job_manager_script_context_t *
+                                        script_context;
 
-    scripts = globus_list_first(
-            globus_list_search_pred(
-                manager->scripts_per_client,
-                globus_l_match_script_client_addr,
-                request->job_stats.client_address
-                ? request->job_stats.client_address
-                : (void *) GLOBUS_GRAM_SCRIPT_NO_CLIENT));
+    manager = script_handle->manager;
+
+    /* Rotate through the batch to gather the commands in order */
+    n = globus_fifo_size(&script_handle->contexts);
+    for (i = 0, iovcnt = 0; i < n; i++)
+    {
+        script_context = globus_fifo_dequeue(&script_handle->contexts);
+        iovcnt += script_context->iovcnt;
+        globus_fifo_enqueue(&script_handle->contexts, script_context);
+    }
+    script_handle->iov = malloc(iovcnt * sizeof(struct iovec));
+    if (script_handle->iov == NULL)
+    {
+        return GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+    }
+    script_handle->iovcnt = iovcnt;
+    for (i = 0, iovcnt = 0, total_iov_contents = 0; i < n; i++)
+    {
+        script_context = globus_fifo_dequeue(&script_handle->contexts);
+        for (j = 0; j < script_context->iovcnt; j++)
+        {
+            script_handle->iov[iovcnt++] = script_context->iov[j];
+            total_iov_contents += script_context->iov[j].iov_len;
+        }
+        globus_fifo_enqueue(&script_handle->contexts, script_context);
+    }
 
-    for (i = 0, total_iov_contents = 0; i < script_context->iovcnt; i++)
+    /* The replies are read one context at a time, starting with the head of
+     * the batch
+     */
+    script_handle->return_buf_offset = 0;
+    result = globus_xio_register_read(
+            script_handle->handle,
+            script_handle->return_buf,
+            sizeof(script_handle->return_buf),
+            1,
+            NULL,
+            globus_l_gram_job_manager_script_read,
+            globus_fifo_peek(&script_handle->contexts));
+    if (result != GLOBUS_SUCCESS)
     {
-        total_iov_contents += script_context->iov[i].iov_len;
+        free(script_handle->iov);
+        script_handle->iov = NULL;
+        script_handle->iovcnt = 0;
+
+        return GLOBUS_GRAM_PROTOCOL_ERROR_OPENING_JOBMANAGER_SCRIPT;
     }
+    script_handle->pending_ops++;
+
     result = globus_xio_register_writev(
-            script_context->handle->handle,
-            script_context->iov,
-            script_context->iovcnt,
+            script_handle->handle,
+            script_handle->iov,
+            script_handle->iovcnt,
             total_iov_contents,
             NULL,
             globus_l_script_writev_callback,
-            script_context->handle);
+            script_handle);
     if (result != GLOBUS_SUCCESS)
     {
         char *errstr = globus_error_print_friendly(
@@ -2695,41 +3033,38 @@ globus_l_gram_script_register_read_and_write(
         {
             free(escaped_errstr);
         }
-        globus_xio_register_close(
-                script_context->handle->handle,
-                NULL,
-                globus_l_script_close_callback,
-                script_context->handle);
-        script_context->handle = NULL;
-        scripts->script_slots_available++;
-        return GLOBUS_GRAM_PROTOCOL_ERROR_OPENING_JOBMANAGER_SCRIPT;
+        free(script_handle->iov);
+        script_handle->iov = NULL;
+        script_handle->iovcnt = 0;
+
+        /* The script will never reply; fail the batch from the read
+         * callback and close the handle when it is done
+         */
+        if (script_handle->result == GLOBUS_SUCCESS)
+        {
+            script_handle->result = result;
+        }
+        globus_xio_handle_cancel_operations(
+                script_handle->handle,
+                GLOBUS_XIO_CANCEL_READ);
+
+        return GLOBUS_SUCCESS;
     }
-    script_context->handle->pending_ops++;
+    script_handle->pending_ops++;
 
-    result = globus_xio_register_read(
-            script_context->handle->handle,
-            script_context->handle->return_buf,
-            sizeof(script_context->handle->return_buf),
-            1,
-            NULL,
-            globus_l_gram_job_manager_script_read,
-            script_context);
-    if (result != GLOBUS_SUCCESS)
+    for (i = 0; i < n; i++)
     {
-        globus_xio_register_close(
-                script_context->handle->handle,
-                NULL,
-                globus_l_script_close_callback,
-                script_context->handle);
-        script_context->handle = NULL;
-        scripts->script_slots_available++;
-
-        return GLOBUS_GRAM_PROTOCOL_ERROR_OPENING_JOBMANAGER_SCRIPT;
+        script_context = globus_fifo_dequeue(&script_handle->contexts);
+        free(script_context->iov);
+        script_context->iov = NULL;
+        script_context->iovcnt = 0;
+        globus_fifo_enqueue(&script_handle->contexts, script_context);
     }
-    script_context->handle->pending_ops++;
 
     return GLOBUS_SUCCESS;
 }
+/* globus_l_gram_script_register_read_and_write() */
+
 /**
  * Convert a fifo of NULL-terminated strings into an array of iovec structs
  *
@@ -2851,7 +3186,7 @@ globus_gram_job_manager_script_close_all(
             globus_xio_close(
                     handle->handle,
                     NULL);
-            free(handle);
+            globus_l_gram_script_handle_destroy(handle);
             scripts->script_slots_available++;
         }
     }
@@ -2880,6 +3215,15 @@ globus_gram_job_manager_script_handle_init(
     (*handle)->manager = manager;
     (*handle)->pending_ops = 0;
     (*handle)->last_use = time(NULL);
+    (*handle)->iov = NULL;
+    (*handle)->iovcnt = 0;
+
+    rc = globus_fifo_init(&(*handle)->contexts);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+        goto contexts_init_failed;
+    }
 
     result = globus_xio_handle_create(
             &(*handle)->handle,
@@ -2893,6 +3237,8 @@ globus_gram_job_manager_script_handle_init(
     if (rc != GLOBUS_SUCCESS)
     {
 handle_create_failed:
+        globus_fifo_destroy(&(*handle)->contexts);
+contexts_init_failed:
         free(*handle);
     }
 fail:
@@ -2904,6 +3250,32 @@ fail:
 }
 /* globus_gram_job_manager_script_handle_init() */
 
+/**
+ * Free a script handle after its XIO handle is closed
+ *
+ * @param script_handle
+ *     Handle to free.
+ */
+static
+void
+globus_l_gram_script_handle_destroy(
+    globus_gram_script_handle_t         script_handle)
+{
+    int                                 i;
+
+    globus_fifo_destroy(&script_handle->contexts);
+    if (script_handle->iov != NULL)
+    {
+        for (i = 0; i < script_handle->iovcnt; i++)
+        {
+            free(script_handle->iov[i].iov_base);
+        }
+        free(script_handle->iov);
+    }
+    free(script_handle);
+}
+/* globus_l_gram_script_handle_destroy() */
+
 static
 void
 globus_l_script_close_callback(
@@ -2911,7 +3283,7 @@ globus_l_script_close_callback(
     globus_result_t                     result,
     void *                              user_arg)
 {
-    free(user_arg);
+    globus_l_gram_script_handle_destroy(user_arg);
 }
 /* globus_l_script_close_callback() */
 
@@ -2927,6 +3299,7 @@ globus_l_script_writev_callback(
     void *                              user_arg)
 {
     globus_gram_script_handle_t         script_handle = user_arg;
+    int                                 i;
 
     globus_gram_job_manager_log(
             script_handle->manager,
@@ -2943,6 +3316,14 @@ globus_l_script_writev_callback(
             (int) result,
             script_handle->pending_ops);
     GlobusGramJobManagerLock(script_handle->manager);
+    for (i = 0; i < script_handle->iovcnt; i++)
+    {
+        free(script_handle->iov[i].iov_base);
+    }
+    free(script_handle->iov);
+    script_handle->iov = NULL;
+    script_handle->iovcnt = 0;
+
     if (script_handle->result == GLOBUS_SUCCESS)
     {
         script_handle->result = result;
@@ -2960,7 +3341,10 @@ globus_l_script_writev_callback(
  *
  * If a script handle hasn't been used in over 30 seconds, and there are
  * no pending script events, it will be closed by this callback and removed
- * from the script handle fifo.
+ * from the script handle fifo. Scripts added to a client's pool while its
+ * queue was backed up are dropped again as they are closed, until the pool is
+ * back to script_pool_size. The queue and latency statistics for each client
+ * are logged and reset.
  */
 void
 globus_gram_script_close_idle(
@@ -2978,9 +3362,18 @@ globus_gram_script_close_idle(
     {
         scripts = globus_list_first(tmp);
 
+        globus_l_gram_script_stats_log_locked(manager, scripts);
+        scripts->script_queue_peak =
+                globus_priority_q_size(&scripts->script_queue);
+        memset(scripts->script_stats, 0, sizeof(scripts->script_stats));
+
         if (!globus_priority_q_empty(&scripts->script_queue))
         {
-            goto nonempty_queue;
+            /* Retry anything left queued after a failure to start a
+             * script
+             */
+            globus_l_gram_process_script_queue_locked(manager, scripts);
+            continue;
         }
 
         while (!globus_fifo_empty(&scripts->script_handles))
@@ -3002,7 +3395,7 @@ globus_gram_script_close_idle(
                 globus_xio_close(
                         handle->handle,
                         NULL);
-                free(handle);
+                globus_l_gram_script_handle_destroy(handle);
                 scripts->script_slots_available++;
             }
             else
@@ -3010,13 +3403,140 @@ globus_gram_script_close_idle(
                 break;
             }
         }
-nonempty_queue:
-        ;
+        while (scripts->script_pool_size > manager->config->script_pool_size
+               && scripts->script_slots_available > 0)
+        {
+            scripts->script_pool_size--;
+            scripts->script_slots_available--;
+        }
     }
     GlobusGramJobManagerUnlock(manager);
 }
 /* globus_gram_script_close_idle() */
 
+/**
+ * Record how long a script command waited and ran
+ *
+ * The mutex associated with the job manager must be locked when this
+ * procedure is called.
+ *
+ * @param scripts
+ *     Client-specific script handle collection
+ * @param script_context
+ *     Context whose reply was just read.
+ */
+static
+void
+globus_l_gram_script_stats_update_locked(
+    globus_gram_job_manager_scripts_t * scripts,
+    globus_gram_job_manager_script_context_t *
+                                        script_context)
+{
+    globus_gram_script_stats_t *        stats;
+    globus_abstime_t                    now;
+    globus_reltime_t                    delta;
+    long                                wait_ms;
+    long                                run_ms;
+
+    GlobusTimeAbstimeGetCurrent(now);
+    GlobusTimeAbstimeDiff(
+            delta,
+            script_context->start_time,
+            script_context->queued_time);
+    GlobusTimeReltimeToMilliSec(wait_ms, delta);
+    GlobusTimeAbstimeDiff(delta, now, script_context->start_time);
+    GlobusTimeReltimeToMilliSec(run_ms, delta);
+
+    stats = &scripts->script_stats[script_context->priority.priority_level];
+    stats->count++;
+    stats->wait_total += wait_ms;
+    stats->run_total += run_ms;
+    if (wait_ms > stats->wait_max)
+    {
+        stats->wait_max = wait_ms;
+    }
+    if (run_ms > stats->run_max)
+    {
+        stats->run_max = run_ms;
+    }
+}
+/* globus_l_gram_script_stats_update_locked() */
+
+/**
+ * Log a client's script pool state and latency statistics
+ *
+ * The mutex associated with the job manager must be locked when this
+ * procedure is called.
+ *
+ * @param manager
+ *     Job manager state
+ * @param scripts
+ *     Client-specific script handle collection
+ */
+static
+void
+globus_l_gram_script_stats_log_locked(
+    globus_gram_job_manager_t *         manager,
+    globus_gram_job_manager_scripts_t * scripts)
+{
+    globus_gram_script_stats_t *        stats;
+    int                                 idle;
+    int                                 i;
+
+    idle = globus_fifo_size(&scripts->script_handles);
+
+    globus_gram_job_manager_log(
+            manager,
+            GLOBUS_GRAM_JOB_MANAGER_LOG_INFO,
+            "event=gram.script_pool.info "
+            "level=INFO "
+            "client=%s "
+            "queued=%d "
+            "queue_peak=%d "
+            "running=%d "
+            "idle=%d "
+            "pool_size=%d "
+            "\n",
+            scripts->client_addr,
+            globus_priority_q_size(&scripts->script_queue),
+            scripts->script_queue_peak,
+            scripts->script_pool_size
+                - scripts->script_slots_available - idle,
+            idle,
+            scripts->script_pool_size);
+
+    for (i = 0; i <= GLOBUS_GRAM_SCRIPT_PRIORITY_LEVEL_POLL; i++)
+    {
+        stats = &scripts->script_stats[i];
+
+        if (stats->count == 0)
+        {
+            continue;
+        }
+        globus_gram_job_manager_log(
+                manager,
+                GLOBUS_GRAM_JOB_MANAGER_LOG_INFO,
+                "event=gram.script_latency.info "
+                "level=INFO "
+                "client=%s "
+                "priority=%s "
+                "count=%d "
+                "wait_avg_ms=%ld "
+                "wait_max_ms=%ld "
+                "run_avg_ms=%ld "
+                "run_max_ms=%ld "
+                "\n",
+                scripts->client_addr,
+                globus_l_gram_script_priority_names[i],
+                stats->count,
+                stats->wait_total / stats->count,
+                stats->wait_max,
+                stats->run_total / stats->count,
+                stats->run_max);
+    }
+}
+/* globus_l_gram_script_stats_log_locked() */
+
 static
 int
 globus_l_gram_script_priority_cmp(
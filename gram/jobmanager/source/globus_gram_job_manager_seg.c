@@ -20,7 +20,6 @@
 #include "globus_scheduler_event_generator_app.h"
 
 #include <sys/types.h>
-#include <utime.h>
 #include <regex.h>
 
 typedef struct globus_gram_seg_resume_s
@@ -755,7 +754,7 @@ globus_l_gram_deliver_event(
      * processes leaves it alone */
     if(request->job_state_file)
     {
-        utime(request->job_state_file, NULL);
+        globus_gram_job_manager_state_file_touch(request);
     }
 
     rc = globus_fifo_enqueue(&request->seg_event_queue, event);
@@ -17,6 +17,103 @@
 #include "globus_gram_job_manager.h"
 
 #include <string.h>
+#include <fcntl.h>
+#include <utime.h>
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/*
+ * Job state journal
+ *
+ * Instead of one state file per job, rewritten through a temporary file and
+ * a rename on each state change, the active job manager appends each job's
+ * state to a single journal file. A record is a header line
+ *     W <uniq_id> <length>
+ * followed by <length> bytes in the per-job state file format and a newline,
+ * or
+ *     D <uniq_id> 0
+ * followed by a newline when the job's state is removed. The last record for
+ * a job wins. Appends are group-committed: whichever writer finds no commit in
+ * progress writes and syncs everything queued so far, and the others wait for
+ * it. The journal is rewritten with only the live records when it grows past
+ * twice their size, and is replayed when the job manager restarts.
+ */
+#define GLOBUS_L_GRAM_JOURNAL_NAME_FORMAT "%s/%s/%s/%s/journal.%s"
+#define GLOBUS_L_GRAM_JOURNAL_COMPACT_MIN (1024 * 1024)
+#define GLOBUS_L_GRAM_JOURNAL_COMPACT_PERIOD 60
+
+typedef struct
+{
+    char *                              uniq_id;
+    /** Offset of the state in the journal */
+    off_t                               offset;
+    size_t                              length;
+    /** A per-job state file may exist for this job too */
+    globus_bool_t                       state_file;
+}
+globus_l_gram_journal_entry_t;
+
+struct globus_gram_job_manager_state_journal_s
+{
+    globus_gram_job_manager_t *         manager;
+    globus_mutex_t                      mutex;
+    globus_cond_t                       cond;
+    char *                              path;
+    int                                 fd;
+    /** Journal bytes written and synced */
+    off_t                               durable;
+    /** Journal offset after the last queued record */
+    off_t                               tail;
+    /** Records appended after durable, waiting for the next commit */
+    char *                              batch;
+    size_t                              batch_len;
+    size_t                              batch_size;
+    globus_bool_t                       committing;
+    /** Set when a commit fails; per-job state files are used from then on */
+    globus_bool_t                       broken;
+    /** Bytes of the journal in records that are still current */
+    size_t                              live;
+    /** uniq_id -> globus_l_gram_journal_entry_t */
+    globus_hashtable_t                  entries;
+    globus_callback_handle_t            compact_handle;
+};
+
+static
+int
+globus_l_gram_state_file_print(
+    globus_gram_jobmanager_request_t *  request,
+    FILE *                              fp);
+
+static
+int
+globus_l_gram_state_file_scan(
+    globus_gram_jobmanager_request_t *  request,
+    FILE *                              fp,
+    char *                              buffer,
+    size_t                              file_len);
+
+static
+int
+globus_l_gram_journal_write(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    globus_gram_jobmanager_request_t *  request);
+
+static
+int
+globus_l_gram_journal_read(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    globus_gram_jobmanager_request_t *  request,
+    char **                             record,
+    size_t *                            length);
+
+static
+globus_bool_t
+globus_l_gram_journal_remove(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    const char *                        uniq_id);
+#endif /* GLOBUS_DONT_DOCUMENT_INTERNAL */
 
 
 /**
@@ -55,12 +152,16 @@ globus_gram_job_manager_state_file_set(
         goto create_state_file_failed;
     }
 
-    if ((access(*state_file, R_OK) != 0) && errno == ENOENT)
+    if ((request->manager &&
+         globus_gram_job_manager_state_journal_contains(
+                request->manager, request->uniq_id)) ||
+        ((access(*state_file, R_OK) != 0) && errno == ENOENT))
     {
         char * dirname_end;
 
         /* If it doesn't exist yet, we'll use a per-user state file dir
-         * to reduce the size of the global state file dir (GT-157)
+         * to reduce the size of the global state file dir (GT-157). Jobs in
+         * the state journal use it for any state file exported for them.
          */
         free(*state_file);
 
@@ -90,9 +191,82 @@ create_state_file_failed:
 }
 /* globus_gram_job_manager_state_file_set() */
 
+/**
+ * Save a job's state
+ *
+ * Appends the job's state to the job manager's state journal if it has one,
+ * otherwise writes the job's state file. Jobs with output streams also get a
+ * state file when the journal is used, as globus-gram-streamer reads it.
+ *
+ * @param request
+ *     The request to save.
+ *
+ * @retval GLOBUS_SUCCESS
+ *     Success.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE
+ *     Error writing state.
+ */
 int
 globus_gram_job_manager_state_file_write(
     globus_gram_jobmanager_request_t *  request)
+{
+    int                                 rc;
+    globus_gram_job_manager_state_journal_t *
+                                        journal = NULL;
+    globus_l_gram_journal_entry_t *     entry;
+
+    if (request->manager)
+    {
+        journal = request->manager->state_journal;
+    }
+    if (journal == NULL)
+    {
+        return globus_gram_job_manager_state_file_export(request);
+    }
+    rc = globus_l_gram_journal_write(journal, request);
+    if (rc == GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE)
+    {
+        /* The journal could not be written and is no longer used */
+        return globus_gram_job_manager_state_file_export(request);
+    }
+    if (rc == GLOBUS_SUCCESS && request->stage_stream_todo != NULL)
+    {
+        rc = globus_gram_job_manager_state_file_export(request);
+        if (rc == GLOBUS_SUCCESS)
+        {
+            globus_mutex_lock(&journal->mutex);
+            entry = globus_hashtable_lookup(
+                    &journal->entries, request->uniq_id);
+            if (entry)
+            {
+                entry->state_file = GLOBUS_TRUE;
+            }
+            globus_mutex_unlock(&journal->mutex);
+        }
+    }
+    return rc;
+}
+/* globus_gram_job_manager_state_file_write() */
+
+/**
+ * Write a job's state file
+ *
+ * Writes the job's state in the per-job state file format to the path in
+ * the request's job_state_file, replacing any earlier version atomically.
+ * This is how job state is saved without a journal, and how state is
+ * exported from the journal for tools that read state files.
+ *
+ * @param request
+ *     The request to save.
+ *
+ * @retval GLOBUS_SUCCESS
+ *     Success.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE
+ *     Error writing state file.
+ */
+int
+globus_gram_job_manager_state_file_export(
+    globus_gram_jobmanager_request_t *  request)
 {
     int                                 rc = GLOBUS_SUCCESS;
     FILE *                              fp = NULL;
@@ -143,12 +317,104 @@ globus_gram_job_manager_state_file_write(
         return rc;
     }
 
+    rc = globus_l_gram_state_file_print(request, fp);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto error_exit;
+    }
+
+    /*
+     * On some filsystems, write + rename is *not* atomic, so we explicitly
+     * flush to disk here. fdatasync might be better, but only on systems with
+     * POSIX realtime extensions
+     */
+    fflush(fp);
+    fsync(fileno(fp));
+    fclose( fp );
+    fp = NULL;
+
+    rc = rename( tmp_file, request->job_state_file );
+    if (rc != 0)
+    {
+        rc = GLOBUS_FAILURE;
+
+        globus_gram_job_manager_request_log(
+                request,
+                GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
+                "event=gram.write_state_file.end "
+                "level=ERROR "
+                "gramid=%s "
+                "path=%s "
+                "status=-1 "
+                "msg=\"%s\" "
+                "errno=%d "
+                "reason=\"%s\" "
+                "\n",
+                request->job_contact_path,
+                request->job_state_file,
+                "Error renaming temporary state file",
+                errno,
+                strerror(errno));
+        goto rename_failed;
+    }
+
+    globus_gram_job_manager_request_log(
+            request,
+            GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE,
+            "event=gram.write_state_file.end "
+            "level=TRACE "
+            "gramid=%s "
+            "path=%s "
+            "status=0 "
+            "\n",
+            request->job_contact_path,
+            request->job_state_file);
+
+    return GLOBUS_SUCCESS;
+
+error_exit:
+    globus_gram_job_manager_request_log(
+            request,
+            GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
+            "event=gram.write_state_file.end "
+            "level=ERROR "
+            "gramid=%s "
+            "path=\"%s\" "
+            "status=%d "
+            "msg=\"%s\"\n",
+            request->job_contact_path,
+            tmp_file,
+            rc,
+            "Error writing to state file");
+
+    if (fp)
+    {
+        fclose(fp);
+    }
+rename_failed:
+    if (tmp_file[0] != 0)
+    {
+        remove(tmp_file);
+    }
+
+    return rc;
+}
+/* globus_gram_job_manager_state_file_export() */
+
+static
+int
+globus_l_gram_state_file_print(
+    globus_gram_jobmanager_request_t *  request,
+    FILE *                              fp)
+{
+    int                                 rc;
+
     rc = fprintf(fp, "%s\n", request->job_contact ? request->job_contact : " ");
     if (rc < 0)
     {
         rc = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
 
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%4d\n",
             (request->jobmanager_state == GLOBUS_GRAM_JOB_MANAGER_STATE_STOP)
@@ -156,84 +422,84 @@ globus_gram_job_manager_state_file_write(
                     : (int) request->jobmanager_state);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%4d\n", (int) request->status);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
 
     rc = fprintf(fp, "%4d\n", request->failure_code);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n", request->job_id_string ? request->job_id_string : " ");
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n", request->rsl_spec);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n", request->cache_tag);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n", request->config->jobmanager_type);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%d\n", request->two_phase_commit);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n", request->scratchdir ? request->scratchdir : " ");
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%lld\n", (long long) request->seg_last_timestamp);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%lld\n", (long long) request->creation_time);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%lld\n", (long long) request->queued_time);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = globus_gram_job_manager_staging_write_state(request, fp);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = globus_gram_job_manager_write_callback_contacts(request, fp);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n", request->gateway_user ? request->gateway_user : " ");
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
 
     rc = fprintf(fp, "%d\n", request->exit_code);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp,
             "%lld.%09ld %lld.%09ld %lld.%09ld "
@@ -275,7 +541,7 @@ globus_gram_job_manager_state_file_write(
             request->job_stats.file_stage_out_gsiftp_count);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp,
             "%s\n%s\n",
@@ -287,17 +553,17 @@ globus_gram_job_manager_state_file_write(
                 : " ");
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%4d\n", (int) request->expected_terminal_state);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n", request->config->service_tag);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
     rc = fprintf(fp, "%s\n",
                 request->original_job_id_string
@@ -305,132 +571,119 @@ globus_gram_job_manager_state_file_write(
                 : "");
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
 
     rc = fprintf(fp, "%d\n",
                 request->job_log_level);
     if (rc < 0)
     {
-        goto error_exit;
+        goto print_failed;
     }
+    return GLOBUS_SUCCESS;
 
+print_failed:
+    return GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+}
+/* globus_l_gram_state_file_print() */
 
+/**
+ * Load a job's state
+ *
+ * Reads the job's state from the job manager's state journal, or from the
+ * job's state file if the journal has no record of the job.
+ *
+ * @param request
+ *     The request to load. Its uniq_id and job_state_file must be set.
+ *
+ * @retval GLOBUS_SUCCESS
+ *     Success.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE
+ *     No state for the job.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_READING_STATE_FILE
+ *     Error reading state.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_OLD_JM_ALIVE
+ *     The job belongs to another job manager.
+ */
+int
+globus_gram_job_manager_state_file_read(
+    globus_gram_jobmanager_request_t *  request)
+{
+    FILE *                              fp = NULL;
+    char *                              buffer = NULL;
+    char *                              record = NULL;
+    size_t                              file_len;
+    struct stat                         statbuf;
+    int                                 rc = GLOBUS_SUCCESS;
+    const char *                        source;
 
-    /*
-     * On some filsystems, write + rename is *not* atomic, so we explicitly
-     * flush to disk here. fdatasync might be better, but only on systems with
-     * POSIX realtime extensions
-     */
-    fflush(fp);
-    fsync(fileno(fp));
-    fclose( fp );
-    fp = NULL;
+    request->old_job_contact = NULL;
 
-    rc = rename( tmp_file, request->job_state_file );
-    if (rc != 0)
+    globus_gram_job_manager_request_log(
+            request,
+            GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE,
+            "event=gram.state_file_read.start "
+            "level=TRACE "
+            "gramid=%s "
+            "path=%s "
+            "\n",
+            request->job_contact_path,
+            request->job_state_file);
+
+    if (request->manager && request->manager->state_journal)
     {
-        rc = GLOBUS_FAILURE;
+        rc = globus_l_gram_journal_read(
+                request->manager->state_journal,
+                request,
+                &record,
+                &file_len);
+        if (rc == GLOBUS_SUCCESS)
+        {
+            source = request->manager->state_journal->path;
+            fp = fmemopen(record, file_len, "r");
+            if (fp == NULL)
+            {
+                rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+                goto fopen_state_file_failed;
+            }
+            goto read_state;
+        }
+        else if (rc != GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE)
+        {
+            goto exit;
+        }
+        rc = GLOBUS_SUCCESS;
+    }
+    source = request->job_state_file;
+
+    if (stat(request->job_state_file, &statbuf) != 0)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
 
         globus_gram_job_manager_request_log(
                 request,
                 GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
-                "event=gram.write_state_file.end "
+                "event=gram.state_file_read.end "
                 "level=ERROR "
                 "gramid=%s "
                 "path=%s "
-                "status=-1 "
                 "msg=\"%s\" "
+                "status=%d "
                 "errno=%d "
                 "reason=\"%s\" "
                 "\n",
                 request->job_contact_path,
                 request->job_state_file,
-                "Error renaming temporary state file",
+                "Error checking file status",
+                -rc,
                 errno,
                 strerror(errno));
-        goto rename_failed;
-    }
-
-    globus_gram_job_manager_request_log(
-            request,
-            GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE,
-            "event=gram.write_state_file.end "
-            "level=TRACE "
-            "gramid=%s "
-            "path=%s "
-            "status=0 "
-            "\n",
-            request->job_contact_path,
-            request->job_state_file);
 
-    return GLOBUS_SUCCESS;
-
-error_exit:
-    globus_gram_job_manager_request_log(
-            request,
-            GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
-            "event=gram.write_state_file.end "
-            "level=ERROR "
-            "gramid=%s "
-            "path=\"%s\" "
-            "status=%d "
-            "msg=\"%s\"\n",
-            request->job_contact_path,
-            tmp_file,
-            rc,
-            "Error writing to state file");
-
-    if (fp)
-    {
-        fclose(fp);
-    }
-rename_failed:
-    if (tmp_file[0] != 0)
-    {
-        remove(tmp_file);
-    }
-
-    return rc;
-}
-/* globus_gram_job_manager_state_file_write() */
-
-int
-globus_gram_job_manager_state_file_read(
-    globus_gram_jobmanager_request_t *  request)
-{
-    FILE *                              fp;
-    char *                              buffer = NULL;
-    size_t                              file_len;
-    struct stat                         statbuf;
-    int                                 rc = GLOBUS_SUCCESS;
-    int                                 i;
-    long long                           tmp_timestamp;
-
-    long long                           tmp_unsubmitted_timestamp;
-    long long                           tmp_file_stage_in_timestamp;
-    long long                           tmp_pending_timestamp;
-    long long                           tmp_active_timestamp;
-    long long                           tmp_failed_timestamp;
-    long long                           tmp_file_stage_out_timestamp;
-    long long                           tmp_done_timestamp;
-
-    request->old_job_contact = NULL;
-
-    globus_gram_job_manager_request_log(
-            request,
-            GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE,
-            "event=gram.state_file_read.start "
-            "level=TRACE "
-            "gramid=%s "
-            "path=%s "
-            "\n",
-            request->job_contact_path,
-            request->job_state_file);
-
-    if (stat(request->job_state_file, &statbuf) != 0)
-    {
-        rc = GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
+        return rc;
+    }
+    if (statbuf.st_uid != getuid())
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
 
         globus_gram_job_manager_request_log(
                 request,
@@ -446,39 +699,40 @@ globus_gram_job_manager_state_file_read(
                 "\n",
                 request->job_contact_path,
                 request->job_state_file,
-                "Error checking file status",
+                "State file not owned by me",
                 -rc,
                 errno,
                 strerror(errno));
 
         return rc;
     }
-    if (statbuf.st_uid != getuid())
+    file_len = (size_t) statbuf.st_size;
+
+    fp = fopen( request->job_state_file, "r" );
+    if(!fp)
     {
         rc = GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
 
         globus_gram_job_manager_request_log(
                 request,
                 GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
-                "event=gram.state_file_read.end "
+                "event=gram.state_file.read.end "
                 "level=ERROR "
-                "gramid=%s "
                 "path=%s "
-                "msg=\"%s\" "
                 "status=%d "
+                "msg=\"%s\" "
                 "errno=%d "
                 "reason=\"%s\" "
                 "\n",
-                request->job_contact_path,
                 request->job_state_file,
-                "State file not owned by me",
                 -rc,
+                "Error opening state file",
                 errno,
                 strerror(errno));
-
-        return rc;
+        goto fopen_state_file_failed;
     }
-    file_len = (size_t) statbuf.st_size;
+
+read_state:
     buffer = malloc(file_len+1);
     if (buffer == NULL)
     {
@@ -497,19 +751,17 @@ globus_gram_job_manager_state_file_read(
                 "reason=\"%s\" "
                 "\n",
                 request->job_contact_path,
-                request->job_state_file,
+                source,
                 "Malloc failed",
                 -rc,
                 errno,
                 strerror(errno));
-        goto exit;
+        goto malloc_failed;
     }
 
-    fp = fopen( request->job_state_file, "r" );
-    if(!fp)
+    rc = globus_l_gram_state_file_scan(request, fp, buffer, file_len);
+    if (rc != GLOBUS_SUCCESS)
     {
-        rc = GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
-
         globus_gram_job_manager_request_log(
                 request,
                 GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
@@ -518,16 +770,59 @@ globus_gram_job_manager_state_file_read(
                 "path=%s "
                 "status=%d "
                 "msg=\"%s\" "
-                "errno=%d "
                 "reason=\"%s\" "
                 "\n",
-                request->job_state_file,
+                source,
                 -rc,
-                "Error opening state file",
-                errno,
-                strerror(errno));
-        goto fopen_state_file_failed;
+                "Error reading state file",
+                globus_gram_protocol_error_string(rc));
+        goto scan_failed;
+    }
+
+    globus_gram_job_manager_request_log(
+            request,
+            GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE,
+            "event=gram.state_file.read.end "
+            "level=TRACE "
+            "path=%s "
+            "status=%d "
+            "\n",
+            source,
+            0);
+
+scan_failed:
+    free(buffer);
+malloc_failed:
+    fclose(fp);
+fopen_state_file_failed:
+    if (record != NULL)
+    {
+        free(record);
     }
+exit:
+    return rc;
+}
+/* globus_gram_job_manager_state_file_read() */
+
+static
+int
+globus_l_gram_state_file_scan(
+    globus_gram_jobmanager_request_t *  request,
+    FILE *                              fp,
+    char *                              buffer,
+    size_t                              file_len)
+{
+    int                                 rc = GLOBUS_SUCCESS;
+    int                                 i;
+    long long                           tmp_timestamp;
+
+    long long                           tmp_unsubmitted_timestamp;
+    long long                           tmp_file_stage_in_timestamp;
+    long long                           tmp_pending_timestamp;
+    long long                           tmp_active_timestamp;
+    long long                           tmp_failed_timestamp;
+    long long                           tmp_file_stage_out_timestamp;
+    long long                           tmp_done_timestamp;
 
     if(fgets( buffer, file_len, fp )  == NULL)
     {
@@ -795,22 +1090,6 @@ globus_gram_job_manager_state_file_read(
     {
         request->job_log_level = atoi(buffer);
     }
-
-    fclose(fp);
-
-    free(buffer);
-
-    globus_gram_job_manager_request_log(
-            request,
-            GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE,
-            "event=gram.state_file.read.end "
-            "level=TRACE "
-            "path=%s "
-            "status=%d "
-            "\n",
-            request->job_state_file,
-            0);
-
     return GLOBUS_SUCCESS;
 
 free_original_job_id_string:
@@ -873,32 +1152,1235 @@ error_exit:
     {
         rc = GLOBUS_GRAM_PROTOCOL_ERROR_READING_STATE_FILE;
     }
+    return rc;
+}
+/* globus_l_gram_state_file_scan() */
+
+/**
+ * Remove a job's saved state
+ *
+ * Records the removal in the state journal and removes the job's state
+ * file, if it may have one.
+ *
+ * @param request
+ *     The request whose state to remove.
+ */
+void
+globus_gram_job_manager_state_file_remove(
+    globus_gram_jobmanager_request_t *  request)
+{
+    globus_bool_t                       remove_file = GLOBUS_TRUE;
+
+    if (request->manager && request->manager->state_journal)
+    {
+        remove_file = globus_l_gram_journal_remove(
+                request->manager->state_journal,
+                request->uniq_id);
+    }
+    if (remove_file && request->job_state_file)
+    {
+        remove(request->job_state_file);
+    }
+}
+/* globus_gram_job_manager_state_file_remove() */
+
+/**
+ * Update the timestamp of a job's state file
+ *
+ * Keeps anything scrubbing the state files of old and dead processes from
+ * removing a live job's state file. Jobs kept only in the state journal have
+ * no file to update.
+ *
+ * @param request
+ *     The request whose state file to update.
+ */
+void
+globus_gram_job_manager_state_file_touch(
+    globus_gram_jobmanager_request_t *  request)
+{
+    globus_gram_job_manager_state_journal_t *
+                                        journal = NULL;
+    globus_l_gram_journal_entry_t *     entry;
+    globus_bool_t                       has_file = GLOBUS_TRUE;
+
+    if (request->job_state_file == NULL)
+    {
+        return;
+    }
+    if (request->manager)
+    {
+        journal = request->manager->state_journal;
+    }
+    if (journal != NULL)
+    {
+        globus_mutex_lock(&journal->mutex);
+        if (!journal->broken)
+        {
+            entry = globus_hashtable_lookup(
+                    &journal->entries, request->uniq_id);
+            has_file = (entry == NULL || entry->state_file);
+        }
+        globus_mutex_unlock(&journal->mutex);
+    }
+    if (has_file)
+    {
+        utime(request->job_state_file, NULL);
+    }
+}
+/* globus_gram_job_manager_state_file_touch() */
+
+#ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/* Length of the record holding entry */
+static
+size_t
+globus_l_gram_journal_record_len(
+    globus_l_gram_journal_entry_t *     entry)
+{
+    char                                header[128];
+
+    return snprintf(header, sizeof(header), "W %s %lu\n",
+            entry->uniq_id, (unsigned long) entry->length)
+        + entry->length + 1;
+}
+
+/*
+ * Queue a record for the next commit, returning the journal offset just past
+ * it. Called with the journal mutex locked.
+ */
+static
+int
+globus_l_gram_journal_append(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    char                                op,
+    const char *                        uniq_id,
+    const char *                        data,
+    size_t                              length,
+    off_t *                             data_offset,
+    off_t *                             end)
+{
+    char                                header[128];
+    int                                 header_len;
+    size_t                              needed;
+    char *                              tmp;
+
+    header_len = snprintf(header, sizeof(header), "%c %s %lu\n",
+            op, uniq_id, (unsigned long) length);
+    if (header_len < 0 || header_len >= sizeof(header))
+    {
+        return GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+    }
+    needed = journal->batch_len + header_len + length + 1;
+    if (needed > journal->batch_size)
+    {
+        tmp = realloc(journal->batch, needed * 2);
+        if (tmp == NULL)
+        {
+            return GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+        }
+        journal->batch = tmp;
+        journal->batch_size = needed * 2;
+    }
+    memcpy(journal->batch + journal->batch_len, header, header_len);
+    journal->batch_len += header_len;
+    *data_offset = journal->tail + header_len;
+    if (length > 0)
+    {
+        memcpy(journal->batch + journal->batch_len, data, length);
+        journal->batch_len += length;
+    }
+    journal->batch[journal->batch_len++] = '\n';
+    journal->tail += header_len + length + 1;
+    *end = journal->tail;
+
+    return GLOBUS_SUCCESS;
+}
+/* globus_l_gram_journal_append() */
+
+/*
+ * Wait until the journal is durable up to end, committing the queued records
+ * if no other thread is. Called with the journal mutex locked; it is released
+ * while writing.
+ */
+static
+int
+globus_l_gram_journal_commit(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    off_t                               end)
+{
+    char *                              batch;
+    size_t                              batch_len;
+    size_t                              written;
+    ssize_t                             rc;
+    int                                 save_errno = 0;
+
+    while (journal->durable < end && !journal->broken)
+    {
+        if (journal->committing)
+        {
+            globus_cond_wait(&journal->cond, &journal->mutex);
+            continue;
+        }
+        if (journal->batch_len == 0)
+        {
+            /* Everything appended is durable; end may be an offset from
+             * before a compaction
+             */
+            break;
+        }
+        journal->committing = GLOBUS_TRUE;
+        batch = journal->batch;
+        batch_len = journal->batch_len;
+        journal->batch = NULL;
+        journal->batch_len = 0;
+        journal->batch_size = 0;
+        globus_mutex_unlock(&journal->mutex);
+
+        for (written = 0, rc = 0; written < batch_len; written += rc)
+        {
+            rc = write(journal->fd, batch + written, batch_len - written);
+            if (rc < 0 && errno == EINTR)
+            {
+                rc = 0;
+            }
+            else if (rc < 0)
+            {
+                break;
+            }
+        }
+        if (rc >= 0 && fsync(journal->fd) < 0)
+        {
+            rc = -1;
+        }
+        save_errno = errno;
+        free(batch);
+
+        globus_mutex_lock(&journal->mutex);
+        journal->committing = GLOBUS_FALSE;
+        if (rc < 0)
+        {
+            /* Keep what is known to be good, stop using the journal */
+            if (ftruncate(journal->fd, journal->durable) < 0)
+            {
+                save_errno = errno;
+            }
+            journal->broken = GLOBUS_TRUE;
+            journal->batch_len = 0;
+            journal->tail = journal->durable;
+
+            globus_gram_job_manager_log(
+                    journal->manager,
+                    GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
+                    "event=gram.state_journal.commit.end "
+                    "level=ERROR "
+                    "path=\"%s\" "
+                    "msg=\"%s\" "
+                    "errno=%d "
+                    "reason=\"%s\" "
+                    "\n",
+                    journal->path,
+                    "Error writing state journal, using state files",
+                    save_errno,
+                    strerror(save_errno));
+        }
+        else
+        {
+            journal->durable += batch_len;
+        }
+        globus_cond_broadcast(&journal->cond);
+    }
+    return journal->broken
+            ? GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE
+            : GLOBUS_SUCCESS;
+}
+/* globus_l_gram_journal_commit() */
+
+/*
+ * Append a job's state to the journal and wait for it to be committed.
+ * Returns GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE if the journal can't be
+ * used, in which case the caller writes a state file instead.
+ */
+static
+int
+globus_l_gram_journal_write(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    globus_gram_jobmanager_request_t *  request)
+{
+    char *                              data = NULL;
+    size_t                              length = 0;
+    FILE *                              fp;
+    int                                 rc;
+    off_t                               data_offset;
+    off_t                               end;
+    globus_l_gram_journal_entry_t *     entry;
+    globus_bool_t                       stale_file = GLOBUS_FALSE;
 
     globus_gram_job_manager_request_log(
             request,
-            GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
-            "event=gram.state_file.read.end "
-            "level=ERROR "
-            "path=%s "
-            "status=%d "
-            "msg=\"%s\" "
-            "reason=\"%s\" "
+            GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE,
+            "event=gram.write_state_file.start "
+            "level=TRACE "
+            "gramid=%s "
+            "path=\"%s\" "
             "\n",
-            request->job_state_file,
-            -rc,
-            "Error reading state file",
-            globus_gram_protocol_error_string(rc));
+            request->job_contact_path,
+            journal->path);
 
+    fp = open_memstream(&data, &length);
+    if (fp == NULL)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+        goto memstream_failed;
+    }
+    rc = globus_l_gram_state_file_print(request, fp);
     fclose(fp);
-fopen_state_file_failed:
-    if (buffer != NULL)
+    if (rc != GLOBUS_SUCCESS)
     {
-        free(buffer);
+        goto print_failed;
     }
-exit:
-    return rc;
-}
-/* globus_gram_job_manager_state_file_read() */
+
+    globus_mutex_lock(&journal->mutex);
+    if (journal->broken)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
+        goto append_failed;
+    }
+    entry = globus_hashtable_lookup(&journal->entries, request->uniq_id);
+    if (entry == NULL)
+    {
+        entry = calloc(1, sizeof(globus_l_gram_journal_entry_t));
+        if (entry == NULL)
+        {
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+            goto append_failed;
+        }
+        entry->uniq_id = strdup(request->uniq_id);
+        if (entry->uniq_id == NULL)
+        {
+            free(entry);
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+            goto append_failed;
+        }
+        globus_hashtable_insert(&journal->entries, entry->uniq_id, entry);
+        /* A restarted job may have been loaded from a state file */
+        stale_file = (request->jm_restart != NULL);
+    }
+    else
+    {
+        journal->live -= globus_l_gram_journal_record_len(entry);
+    }
+    rc = globus_l_gram_journal_append(
+            journal,
+            'W',
+            request->uniq_id,
+            data,
+            length,
+            &data_offset,
+            &end);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        /* The last committed record stays current */
+        journal->live += globus_l_gram_journal_record_len(entry);
+        goto append_failed;
+    }
+    entry->offset = data_offset;
+    entry->length = length;
+    journal->live += globus_l_gram_journal_record_len(entry);
+
+    rc = globus_l_gram_journal_commit(journal, end);
+append_failed:
+    globus_mutex_unlock(&journal->mutex);
+print_failed:
+    free(data);
+memstream_failed:
+    if (rc == GLOBUS_SUCCESS && stale_file)
+    {
+        remove(request->job_state_file);
+    }
+    globus_gram_job_manager_request_log(
+            request,
+            rc == GLOBUS_SUCCESS
+                ? GLOBUS_GRAM_JOB_MANAGER_LOG_TRACE
+                : GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
+            "event=gram.write_state_file.end "
+            "level=%s "
+            "gramid=%s "
+            "path=\"%s\" "
+            "status=%d "
+            "\n",
+            rc == GLOBUS_SUCCESS ? "TRACE" : "ERROR",
+            request->job_contact_path,
+            journal->path,
+            -rc);
+    return rc;
+}
+/* globus_l_gram_journal_write() */
+
+/*
+ * Copy a job's state out of the journal. Returns
+ * GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE if the journal has none, or if it
+ * is no longer used and the job has a state file.
+ */
+static
+int
+globus_l_gram_journal_read(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    globus_gram_jobmanager_request_t *  request,
+    char **                             record,
+    size_t *                            length)
+{
+    globus_l_gram_journal_entry_t *     entry;
+    off_t                               offset;
+    size_t                              len;
+    size_t                              got;
+    ssize_t                             rc;
+    char *                              data;
+
+    globus_mutex_lock(&journal->mutex);
+    entry = globus_hashtable_lookup(&journal->entries, request->uniq_id);
+    if (entry == NULL ||
+        (journal->broken && access(request->job_state_file, R_OK) == 0))
+    {
+        globus_mutex_unlock(&journal->mutex);
+        return GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
+    }
+    globus_l_gram_journal_commit(journal, entry->offset + entry->length);
+    if (journal->durable < entry->offset + entry->length)
+    {
+        /* Lost with a failed commit */
+        globus_mutex_unlock(&journal->mutex);
+        return GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
+    }
+    offset = entry->offset;
+    len = entry->length;
+
+    data = malloc(len + 1);
+    if (data == NULL)
+    {
+        globus_mutex_unlock(&journal->mutex);
+        return GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+    }
+    for (got = 0, rc = 0; got < len; got += rc)
+    {
+        rc = pread(journal->fd, data + got, len - got, offset + got);
+        if (rc < 0 && errno == EINTR)
+        {
+            rc = 0;
+        }
+        else if (rc <= 0)
+        {
+            break;
+        }
+    }
+    globus_mutex_unlock(&journal->mutex);
+
+    if (got < len)
+    {
+        free(data);
+        return GLOBUS_GRAM_PROTOCOL_ERROR_READING_STATE_FILE;
+    }
+    data[len] = '\0';
+    *record = data;
+    *length = len;
+
+    return GLOBUS_SUCCESS;
+}
+/* globus_l_gram_journal_read() */
+
+/*
+ * Record that a job's state is gone. Returns GLOBUS_TRUE if the job may also
+ * have a state file to remove.
+ */
+static
+globus_bool_t
+globus_l_gram_journal_remove(
+    globus_gram_job_manager_state_journal_t *
+                                        journal,
+    const char *                        uniq_id)
+{
+    globus_l_gram_journal_entry_t *     entry;
+    globus_bool_t                       state_file = GLOBUS_TRUE;
+    off_t                               data_offset;
+    off_t                               end;
+
+    globus_mutex_lock(&journal->mutex);
+    entry = globus_hashtable_remove(&journal->entries, (void *) uniq_id);
+    if (entry != NULL)
+    {
+        journal->live -= globus_l_gram_journal_record_len(entry);
+        state_file = entry->state_file || journal->broken;
+
+        if (!journal->broken &&
+            globus_l_gram_journal_append(
+                    journal, 'D', uniq_id, NULL, 0, &data_offset, &end)
+                == GLOBUS_SUCCESS)
+        {
+            globus_l_gram_journal_commit(journal, end);
+        }
+        free(entry->uniq_id);
+        free(entry);
+    }
+    globus_mutex_unlock(&journal->mutex);
+
+    return state_file;
+}
+/* globus_l_gram_journal_remove() */
+
+/*
+ * Rewrite the journal with only the current record of each job. Called with
+ * the journal mutex locked.
+ */
+static
+int
+globus_l_gram_journal_compact(
+    globus_gram_job_manager_state_journal_t *
+                                        journal)
+{
+    char *                              tmp_path;
+    FILE *                              fp;
+    int                                 fd;
+    globus_l_gram_journal_entry_t *     entry;
+    globus_list_t *                     entries = NULL;
+    globus_list_t *                     l;
+    off_t                               offset = 0;
+    off_t *                             offsets;
+    int                                 count;
+    int                                 i;
+    char *                              data = NULL;
+    size_t                              data_size = 0;
+    size_t                              got;
+    ssize_t                             rc;
+    int                                 result = GLOBUS_SUCCESS;
+
+    /* Commit everything appended so far and wait for any other committer
+     * to finish, so no thread is writing to the old file when it is
+     * replaced. The mutex is held from here on, so no new commit starts.
+     */
+    while (!journal->broken &&
+           (journal->committing || journal->batch_len > 0))
+    {
+        if (journal->committing)
+        {
+            globus_cond_wait(&journal->cond, &journal->mutex);
+        }
+        else
+        {
+            globus_l_gram_journal_commit(journal, journal->tail);
+        }
+    }
+    if (journal->broken)
+    {
+        return GLOBUS_GRAM_PROTOCOL_ERROR_NO_STATE_FILE;
+    }
+    globus_hashtable_to_list(&journal->entries, &entries);
+    count = globus_list_size(entries);
+
+    tmp_path = globus_common_create_string("%s.tmp", journal->path);
+    offsets = malloc((count + 1) * sizeof(off_t));
+    if (tmp_path == NULL || offsets == NULL)
+    {
+        result = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+        goto malloc_failed;
+    }
+    fd = open(tmp_path, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR);
+    if (fd < 0 || (fp = fdopen(fd, "w")) == NULL)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        result = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+        goto open_failed;
+    }
+
+    for (l = entries, i = 0; l != NULL; l = globus_list_rest(l), i++)
+    {
+        entry = globus_list_first(l);
+
+        if (entry->length + 1 > data_size)
+        {
+            free(data);
+            data_size = entry->length + 1;
+            data = malloc(data_size);
+            if (data == NULL)
+            {
+                result = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+                break;
+            }
+        }
+        for (got = 0, rc = 0; got < entry->length; got += rc)
+        {
+            rc = pread(journal->fd, data + got, entry->length - got,
+                    entry->offset + got);
+            if (rc < 0 && errno == EINTR)
+            {
+                rc = 0;
+            }
+            else if (rc <= 0)
+            {
+                break;
+            }
+        }
+        if (got < entry->length)
+        {
+            result = GLOBUS_GRAM_PROTOCOL_ERROR_READING_STATE_FILE;
+            break;
+        }
+        rc = fprintf(fp, "W %s %lu\n",
+                entry->uniq_id, (unsigned long) entry->length);
+        if (rc < 0 ||
+            fwrite(data, 1, entry->length, fp) != entry->length ||
+            fputc('\n', fp) == EOF)
+        {
+            result = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+            break;
+        }
+        offsets[i] = offset + rc;
+        offset += rc + entry->length + 1;
+    }
+    if (result == GLOBUS_SUCCESS &&
+        (fflush(fp) != 0 || fsync(fileno(fp)) != 0))
+    {
+        result = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+    }
+    if (fclose(fp) != 0 && result == GLOBUS_SUCCESS)
+    {
+        result = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+    }
+    if (result == GLOBUS_SUCCESS)
+    {
+        fd = open(tmp_path, O_RDWR|O_APPEND);
+        if (fd < 0)
+        {
+            result = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+        }
+        else if (rename(tmp_path, journal->path) != 0)
+        {
+            close(fd);
+            result = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+        }
+    }
+    if (result != GLOBUS_SUCCESS)
+    {
+        globus_gram_job_manager_log(
+                journal->manager,
+                GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
+                "event=gram.state_journal.compact.end "
+                "level=WARN "
+                "path=\"%s\" "
+                "status=%d "
+                "msg=\"%s\" "
+                "errno=%d "
+                "reason=\"%s\" "
+                "\n",
+                journal->path,
+                -result,
+                "Error compacting state journal",
+                errno,
+                strerror(errno));
+        remove(tmp_path);
+        goto write_failed;
+    }
+
+    close(journal->fd);
+    journal->fd = fd;
+    for (l = entries, i = 0; l != NULL; l = globus_list_rest(l), i++)
+    {
+        entry = globus_list_first(l);
+        entry->offset = offsets[i];
+    }
+    globus_gram_job_manager_log(
+            journal->manager,
+            GLOBUS_GRAM_JOB_MANAGER_LOG_DEBUG,
+            "event=gram.state_journal.compact.end "
+            "level=DEBUG "
+            "path=\"%s\" "
+            "jobs=%d "
+            "old_size=%lld "
+            "new_size=%lld "
+            "status=0 "
+            "\n",
+            journal->path,
+            count,
+            (long long) journal->durable,
+            (long long) offset);
+    journal->durable = offset;
+    journal->tail = offset;
+    journal->live = offset;
+
+write_failed:
+    free(data);
+open_failed:
+malloc_failed:
+    free(offsets);
+    free(tmp_path);
+    globus_list_free(entries);
+
+    return result;
+}
+/* globus_l_gram_journal_compact() */
+
+static
+void
+globus_l_gram_journal_compact_callback(
+    void *                              user_arg)
+{
+    globus_gram_job_manager_state_journal_t *
+                                        journal = user_arg;
+
+    globus_mutex_lock(&journal->mutex);
+    if (!journal->broken &&
+        journal->durable > GLOBUS_L_GRAM_JOURNAL_COMPACT_MIN &&
+        journal->durable > 2 * journal->live)
+    {
+        globus_l_gram_journal_compact(journal);
+    }
+    globus_mutex_unlock(&journal->mutex);
+}
+/* globus_l_gram_journal_compact_callback() */
+
+/*
+ * Load the index of a journal file, dropping a partially written record at
+ * its end.
+ */
+static
+int
+globus_l_gram_journal_replay(
+    globus_gram_job_manager_state_journal_t *
+                                        journal)
+{
+    FILE *                              fp;
+    struct stat                         st;
+    char                                line[256];
+    char                                uniq_id[128];
+    char                                op;
+    unsigned long                       length;
+    size_t                              header_len;
+    off_t                               offset = 0;
+    globus_l_gram_journal_entry_t *     entry;
+    int                                 records = 0;
+
+    if (fstat(journal->fd, &st) != 0)
+    {
+        return GLOBUS_GRAM_PROTOCOL_ERROR_READING_STATE_FILE;
+    }
+    fp = fdopen(dup(journal->fd), "r");
+    if (fp == NULL)
+    {
+        return GLOBUS_GRAM_PROTOCOL_ERROR_READING_STATE_FILE;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        header_len = strlen(line);
+        if (line[header_len-1] != '\n' ||
+            sscanf(line, "%c %127s %lu", &op, uniq_id, &length) != 3 ||
+            (op != 'W' && op != 'D') ||
+            offset + header_len + length + 1 > st.st_size ||
+            fseeko(fp, offset + header_len + length, SEEK_SET) != 0 ||
+            fgetc(fp) != '\n')
+        {
+            break;
+        }
+        entry = globus_hashtable_lookup(&journal->entries, uniq_id);
+        if (entry != NULL)
+        {
+            journal->live -= globus_l_gram_journal_record_len(entry);
+        }
+        if (op == 'D' && entry != NULL)
+        {
+            globus_hashtable_remove(&journal->entries, uniq_id);
+            free(entry->uniq_id);
+            free(entry);
+        }
+        else if (op == 'W')
+        {
+            if (entry == NULL)
+            {
+                entry = calloc(1, sizeof(globus_l_gram_journal_entry_t));
+                if (entry == NULL || (entry->uniq_id = strdup(uniq_id)) == NULL)
+                {
+                    free(entry);
+                    fclose(fp);
+                    return GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+                }
+                globus_hashtable_insert(
+                        &journal->entries, entry->uniq_id, entry);
+            }
+            entry->offset = offset + header_len;
+            entry->length = length;
+            journal->live += globus_l_gram_journal_record_len(entry);
+        }
+        offset += header_len + length + 1;
+        records++;
+    }
+    fclose(fp);
+
+    if (offset < st.st_size)
+    {
+        globus_gram_job_manager_log(
+                journal->manager,
+                GLOBUS_GRAM_JOB_MANAGER_LOG_WARN,
+                "event=gram.state_journal.replay.info "
+                "level=WARN "
+                "path=\"%s\" "
+                "offset=%lld "
+                "msg=\"%s\" "
+                "\n",
+                journal->path,
+                (long long) offset,
+                "Discarding incomplete record at end of state journal");
+        if (ftruncate(journal->fd, offset) != 0)
+        {
+            return GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+        }
+    }
+    journal->durable = offset;
+    journal->tail = offset;
+
+    globus_gram_job_manager_log(
+            journal->manager,
+            GLOBUS_GRAM_JOB_MANAGER_LOG_DEBUG,
+            "event=gram.state_journal.replay.end "
+            "level=DEBUG "
+            "path=\"%s\" "
+            "records=%d "
+            "jobs=%d "
+            "status=0 "
+            "\n",
+            journal->path,
+            records,
+            globus_hashtable_size(&journal->entries));
+
+    return GLOBUS_SUCCESS;
+}
+/* globus_l_gram_journal_replay() */
+
+static
+void
+globus_l_gram_journal_entry_destroy(
+    void *                              datum)
+{
+    globus_l_gram_journal_entry_t *     entry = datum;
+
+    free(entry->uniq_id);
+    free(entry);
+}
+/* globus_l_gram_journal_entry_destroy() */
+#endif /* GLOBUS_DONT_DOCUMENT_INTERNAL */
+
+/**
+ * Open the job manager's state journal
+ *
+ * Opens (creating if needed) the state journal for this job manager's user,
+ * service tag, LRM and host, and loads the index of the jobs recorded in it.
+ * Only the job manager holding the startup lock may do this.
+ *
+ * @param manager
+ *     Job manager to open the journal for. Its state_journal member is set
+ *     on success.
+ *
+ * @retval GLOBUS_SUCCESS
+ *     Success.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED
+ *     Malloc failed.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE
+ *     Error opening the journal.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_READING_STATE_FILE
+ *     Error reading the journal.
+ */
+int
+globus_gram_job_manager_state_journal_open(
+    globus_gram_job_manager_t *         manager)
+{
+    globus_gram_job_manager_state_journal_t *
+                                        journal;
+    globus_reltime_t                    period;
+    char *                              dirname_end;
+    int                                 rc;
+
+    journal = calloc(1, sizeof(globus_gram_job_manager_state_journal_t));
+    if (journal == NULL)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+        goto journal_malloc_failed;
+    }
+    journal->manager = manager;
+    journal->fd = -1;
+    journal->compact_handle = GLOBUS_NULL_HANDLE;
+    journal->path = globus_common_create_string(
+            GLOBUS_L_GRAM_JOURNAL_NAME_FORMAT,
+            manager->config->job_state_file_dir,
+            manager->config->logname,
+            manager->config->service_tag,
+            manager->config->jobmanager_type,
+            manager->config->hostname);
+    if (journal->path == NULL)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+        goto path_malloc_failed;
+    }
+    dirname_end = strrchr(journal->path, '/');
+    *dirname_end = '\0';
+    globus_i_gram_mkdir(journal->path);
+    *dirname_end = '/';
+
+    rc = globus_hashtable_init(
+            &journal->entries,
+            1024,
+            globus_hashtable_string_hash,
+            globus_hashtable_string_keyeq);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+        goto hashtable_init_failed;
+    }
+    globus_mutex_init(&journal->mutex, NULL);
+    globus_cond_init(&journal->cond, NULL);
+
+    journal->fd = open(journal->path, O_RDWR|O_CREAT|O_APPEND, S_IRUSR|S_IWUSR);
+    if (journal->fd < 0)
+    {
+        rc = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+
+        globus_gram_job_manager_log(
+                manager,
+                GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
+                "event=gram.state_journal.open.end "
+                "level=ERROR "
+                "path=\"%s\" "
+                "status=%d "
+                "msg=\"%s\" "
+                "errno=%d "
+                "reason=\"%s\" "
+                "\n",
+                journal->path,
+                -rc,
+                "Error opening state journal",
+                errno,
+                strerror(errno));
+        goto open_failed;
+    }
+    fcntl(journal->fd, F_SETFD, FD_CLOEXEC);
+
+    rc = globus_l_gram_journal_replay(journal);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        goto replay_failed;
+    }
+
+    GlobusTimeReltimeSet(period, GLOBUS_L_GRAM_JOURNAL_COMPACT_PERIOD, 0);
+    globus_callback_register_periodic(
+            &journal->compact_handle,
+            &period,
+            &period,
+            globus_l_gram_journal_compact_callback,
+            journal);
+
+    manager->state_journal = journal;
+
+    return GLOBUS_SUCCESS;
+
+replay_failed:
+    close(journal->fd);
+open_failed:
+    globus_cond_destroy(&journal->cond);
+    globus_mutex_destroy(&journal->mutex);
+    globus_hashtable_destroy_all(
+            &journal->entries, globus_l_gram_journal_entry_destroy);
+hashtable_init_failed:
+    free(journal->path);
+path_malloc_failed:
+    free(journal);
+journal_malloc_failed:
+    return rc;
+}
+/* globus_gram_job_manager_state_journal_open() */
+
+/**
+ * Close the job manager's state journal
+ *
+ * Compacts the journal, or removes it if it records no jobs, and frees it.
+ *
+ * @param manager
+ *     Job manager whose journal to close.
+ */
+void
+globus_gram_job_manager_state_journal_close(
+    globus_gram_job_manager_t *         manager)
+{
+    globus_gram_job_manager_state_journal_t *
+                                        journal = manager->state_journal;
+
+    if (journal == NULL)
+    {
+        return;
+    }
+    if (journal->compact_handle != GLOBUS_NULL_HANDLE)
+    {
+        globus_callback_unregister(journal->compact_handle, NULL, NULL, NULL);
+    }
+    globus_mutex_lock(&journal->mutex);
+    if (!journal->broken)
+    {
+        if (globus_hashtable_empty(&journal->entries))
+        {
+            remove(journal->path);
+        }
+        else
+        {
+            globus_l_gram_journal_compact(journal);
+        }
+    }
+    manager->state_journal = NULL;
+    globus_mutex_unlock(&journal->mutex);
+
+    close(journal->fd);
+    free(journal->batch);
+    globus_cond_destroy(&journal->cond);
+    globus_mutex_destroy(&journal->mutex);
+    globus_hashtable_destroy_all(
+            &journal->entries, globus_l_gram_journal_entry_destroy);
+    free(journal->path);
+    free(journal);
+}
+/* globus_gram_job_manager_state_journal_close() */
+
+/**
+ * List the jobs in the state journal
+ *
+ * @param manager
+ *     Job manager whose journal to list.
+ * @param uniq_ids
+ *     Set to a list of copies of the uniq_id of each job recorded in the
+ *     journal. The caller must free the list and its strings.
+ *
+ * @retval GLOBUS_SUCCESS
+ *     Success.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED
+ *     Malloc failed.
+ */
+int
+globus_gram_job_manager_state_journal_list(
+    globus_gram_job_manager_t *         manager,
+    globus_list_t **                    uniq_ids)
+{
+    globus_gram_job_manager_state_journal_t *
+                                        journal = manager->state_journal;
+    globus_l_gram_journal_entry_t *     entry;
+    char *                              uniq_id;
+    int                                 rc = GLOBUS_SUCCESS;
+
+    *uniq_ids = NULL;
+    if (journal == NULL)
+    {
+        return GLOBUS_SUCCESS;
+    }
+    globus_mutex_lock(&journal->mutex);
+    for (entry = globus_hashtable_first(&journal->entries);
+         entry != NULL;
+         entry = globus_hashtable_next(&journal->entries))
+    {
+        uniq_id = strdup(entry->uniq_id);
+        if (uniq_id == NULL || globus_list_insert(uniq_ids, uniq_id) != 0)
+        {
+            free(uniq_id);
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+            break;
+        }
+    }
+    globus_mutex_unlock(&journal->mutex);
+
+    return rc;
+}
+/* globus_gram_job_manager_state_journal_list() */
+
+/**
+ * Check whether the state journal records a job
+ *
+ * @param manager
+ *     Job manager whose journal to check.
+ * @param uniq_id
+ *     Unique ID of the job.
+ */
+globus_bool_t
+globus_gram_job_manager_state_journal_contains(
+    globus_gram_job_manager_t *         manager,
+    const char *                        uniq_id)
+{
+    globus_gram_job_manager_state_journal_t *
+                                        journal = manager->state_journal;
+    globus_bool_t                       found;
+
+    if (journal == NULL)
+    {
+        return GLOBUS_FALSE;
+    }
+    globus_mutex_lock(&journal->mutex);
+    found = globus_hashtable_lookup(&journal->entries, (void *) uniq_id)
+            != NULL;
+    globus_mutex_unlock(&journal->mutex);
+
+    return found;
+}
+/* globus_gram_job_manager_state_journal_contains() */
+
+/**
+ * Move the jobs in a state journal to state files
+ *
+ * Used when the journal is disabled, so that jobs recorded in an existing
+ * journal are restarted from state files. Each job's state is copied as is
+ * to the per-user state file that globus_gram_job_manager_state_file_set()
+ * would choose, and the journal is removed once all are written.
+ *
+ * @param manager
+ *     Job manager, which must not have a journal open.
+ *
+ * @retval GLOBUS_SUCCESS
+ *     Success, or there is no journal.
+ * @retval GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE
+ *     Error writing a state file. The journal is kept.
+ */
+int
+globus_gram_job_manager_state_journal_export_all(
+    globus_gram_job_manager_t *         manager)
+{
+    globus_gram_job_manager_state_journal_t *
+                                        journal;
+    globus_l_gram_journal_entry_t *     entry;
+    char *                              path;
+    char *                              state_file;
+    char *                              tmp_file;
+    char *                              data = NULL;
+    FILE *                              fp;
+    size_t                              got;
+    ssize_t                             n;
+    int                                 rc = GLOBUS_SUCCESS;
+    struct stat                         st;
+
+    path = globus_common_create_string(
+            GLOBUS_L_GRAM_JOURNAL_NAME_FORMAT,
+            manager->config->job_state_file_dir,
+            manager->config->logname,
+            manager->config->service_tag,
+            manager->config->jobmanager_type,
+            manager->config->hostname);
+    if (path == NULL)
+    {
+        return GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+    }
+    rc = stat(path, &st);
+    free(path);
+    if (rc != 0)
+    {
+        return GLOBUS_SUCCESS;
+    }
+
+    rc = globus_gram_job_manager_state_journal_open(manager);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        return rc;
+    }
+    journal = manager->state_journal;
+    globus_callback_unregister(journal->compact_handle, NULL, NULL, NULL);
+    journal->compact_handle = GLOBUS_NULL_HANDLE;
+
+    for (entry = globus_hashtable_first(&journal->entries);
+         entry != NULL && rc == GLOBUS_SUCCESS;
+         entry = globus_hashtable_next(&journal->entries))
+    {
+        state_file = globus_common_create_string(
+                "%s/%s/%s/%s/job.%s",
+                manager->config->job_state_file_dir,
+                manager->config->logname,
+                manager->config->service_tag,
+                manager->config->jobmanager_type,
+                entry->uniq_id);
+        tmp_file = globus_common_create_string("%s.tmp", state_file);
+        data = malloc(entry->length + 1);
+        if (state_file == NULL || tmp_file == NULL || data == NULL)
+        {
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_MALLOC_FAILED;
+            goto next;
+        }
+        for (got = 0, n = 0; got < entry->length; got += n)
+        {
+            n = pread(journal->fd, data + got, entry->length - got,
+                    entry->offset + got);
+            if (n < 0 && errno == EINTR)
+            {
+                n = 0;
+            }
+            else if (n <= 0)
+            {
+                break;
+            }
+        }
+        fp = fopen(tmp_file, "w");
+        if (got < entry->length || fp == NULL)
+        {
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+            if (fp)
+            {
+                fclose(fp);
+            }
+            goto next;
+        }
+        if (fwrite(data, 1, entry->length, fp) != entry->length ||
+            fflush(fp) != 0 ||
+            fsync(fileno(fp)) != 0)
+        {
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+        }
+        if (fclose(fp) != 0 && rc == GLOBUS_SUCCESS)
+        {
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+        }
+        if (rc == GLOBUS_SUCCESS && rename(tmp_file, state_file) != 0)
+        {
+            rc = GLOBUS_GRAM_PROTOCOL_ERROR_WRITING_STATE_FILE;
+        }
+        if (rc != GLOBUS_SUCCESS)
+        {
+            remove(tmp_file);
+        }
+next:
+        free(state_file);
+        free(tmp_file);
+        free(data);
+        data = NULL;
+    }
+
+    globus_gram_job_manager_log(
+            manager,
+            rc == GLOBUS_SUCCESS
+                ? GLOBUS_GRAM_JOB_MANAGER_LOG_DEBUG
+                : GLOBUS_GRAM_JOB_MANAGER_LOG_ERROR,
+            "event=gram.state_journal.export.end "
+            "level=%s "
+            "path=\"%s\" "
+            "jobs=%d "
+            "status=%d "
+            "\n",
+            rc == GLOBUS_SUCCESS ? "DEBUG" : "ERROR",
+            journal->path,
+            globus_hashtable_size(&journal->entries),
+            -rc);
+
+    if (rc == GLOBUS_SUCCESS)
+    {
+        remove(journal->path);
+    }
+    /* Keep the journal file as it is */
+    journal->broken = GLOBUS_TRUE;
+    globus_gram_job_manager_state_journal_close(manager);
+
+    return rc;
+}
+/* globus_gram_job_manager_state_journal_export_all() */
 
 /**
  * Try to set an advisory write lock on a file descriptor
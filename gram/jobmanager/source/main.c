@@ -661,6 +661,7 @@ main(
     if (manager.socket_fd != -1)
     {
         globus_gram_job_manager_script_close_all(&manager);
+        globus_gram_job_manager_state_journal_close(&manager);
         remove(manager.pid_path);
         remove(manager.cred_path);
         remove(manager.socket_path);
@@ -921,6 +921,18 @@ globus_ftp_client_operationattr_get_parallelism(
     const globus_ftp_client_operationattr_t *	attr,
     globus_ftp_control_parallelism_t *		parallelism);
 
+globus_result_t
+globus_ftp_client_operationattr_set_parallelism_range(
+    globus_ftp_client_operationattr_t *		attr,
+    globus_size_t				min_size,
+    globus_size_t				max_size);
+
+globus_result_t
+globus_ftp_client_operationattr_get_parallelism_range(
+    const globus_ftp_client_operationattr_t *	attr,
+    globus_size_t *				min_size,
+    globus_size_t *				max_size);
+
 globus_result_t
 globus_ftp_client_operationattr_set_storage_module(
     globus_ftp_client_operationattr_t *     attr,
@@ -1171,6 +1171,8 @@ globus_ftp_client_operationattr_init(
     i_attr->using_default_auth		= GLOBUS_TRUE;
     i_attr->parallelism.mode		= GLOBUS_FTP_CONTROL_PARALLELISM_NONE;
     i_attr->parallelism.fixed.size	= 1;
+    i_attr->parallelism_min_size	= 0;
+    i_attr->parallelism_max_size	= 0;
     i_attr->layout.mode			= GLOBUS_FTP_CONTROL_STRIPING_NONE;
     i_attr->buffer.mode			= GLOBUS_FTP_CONTROL_TCPBUFFER_DEFAULT;
     i_attr->type			= GLOBUS_FTP_CONTROL_TYPE_IMAGE;
@@ -1684,10 +1686,12 @@ error_exit:
  *
  * This attribute allows the user to control the level of parallelism
  * to be used on an extended block mode file transfer. 
- * Currently, only a "fixed" parallelism level is supported. This
- * is interpreted by the FTP server as the number of parallel data
- * connections to be allowed for each stripe of data. Currently, only
- * the "fixed" parallelism type is 
+ * A "fixed" parallelism level is interpreted by the FTP server as the
+ * number of parallel data connections to be allowed for each stripe of
+ * data. A "dynamic" parallelism level starts with size connections per
+ * stripe and lets the sending side open more or retire some, within the
+ * range set by globus_ftp_client_operationattr_set_parallelism_range(),
+ * as it measures the transfer.
  *
  * This attribute is ignored in stream mode.
  *
@@ -1729,7 +1733,15 @@ globus_ftp_client_operationattr_set_parallelism(
     }
     i_attr = *(globus_i_ftp_client_operationattr_t **) attr;
 
+    if(parallelism->mode == GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC &&
+       parallelism->base.size < 1)
+    {
+	err = GLOBUS_I_FTP_CLIENT_ERROR_INVALID_PARAMETER("parallelism");
+
+	goto error_exit;
+    }
     if(parallelism->mode == GLOBUS_FTP_CONTROL_PARALLELISM_FIXED ||
+       parallelism->mode == GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC ||
        parallelism->mode == GLOBUS_FTP_CONTROL_PARALLELISM_NONE)
     {
 	memcpy(&i_attr->parallelism,
@@ -1784,6 +1796,105 @@ error_exit:
     return globus_error_put(err);
 }
 /* globus_ftp_client_operationattr_get_parallelism() */
+
+/**
+ * Set/Get the dynamic parallelism range for an ftp client attribute set.
+ * @ingroup globus_ftp_client_operationattr
+ *
+ * With a GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC parallelism attribute,
+ * the sending side may scale between min_size and max_size data
+ * connections per stripe, starting from the parallelism size.  A starting
+ * size outside the range widens it.  Without a range, or with any other
+ * parallelism mode, the range is not used; get returns 0 for both when
+ * it was never set.
+ *
+ * @param attr
+ *        The attribute set to query or modify.
+ * @param min_size
+ *        The fewest parallel data connections per stripe, at least 1.
+ * @param max_size
+ *        The most parallel data connections per stripe, at least
+ *        min_size.
+ *
+ * @see globus_ftp_client_operationattr_set_parallelism()
+ *
+ * @note This is a Grid-FTP extension, and may not be supported on all FTP
+ * servers.
+ */
+globus_result_t
+globus_ftp_client_operationattr_set_parallelism_range(
+    globus_ftp_client_operationattr_t *		attr,
+    globus_size_t				min_size,
+    globus_size_t				max_size)
+{
+    globus_object_t *				err;
+    globus_i_ftp_client_operationattr_t *	i_attr;
+    GlobusFuncName(globus_ftp_client_operationattr_set_parallelism_range);
+
+    if(attr == GLOBUS_NULL)
+    {
+	err = GLOBUS_I_FTP_CLIENT_ERROR_NULL_PARAMETER("attr");
+
+	goto error_exit;
+    }
+    if(min_size < 1 || max_size < min_size)
+    {
+	err = GLOBUS_I_FTP_CLIENT_ERROR_INVALID_PARAMETER("max_size");
+
+	goto error_exit;
+    }
+    i_attr = *(globus_i_ftp_client_operationattr_t **) attr;
+
+    i_attr->parallelism_min_size = min_size;
+    i_attr->parallelism_max_size = max_size;
+
+    return GLOBUS_SUCCESS;
+
+error_exit:
+    return globus_error_put(err);
+}
+/* globus_ftp_client_operationattr_set_parallelism_range() */
+
+globus_result_t
+globus_ftp_client_operationattr_get_parallelism_range(
+    const globus_ftp_client_operationattr_t *	attr,
+    globus_size_t *				min_size,
+    globus_size_t *				max_size)
+{
+    globus_object_t *				err;
+    const globus_i_ftp_client_operationattr_t *	i_attr;
+    GlobusFuncName(globus_ftp_client_operationattr_get_parallelism_range);
+
+    if(attr == GLOBUS_NULL)
+    {
+	err = GLOBUS_I_FTP_CLIENT_ERROR_NULL_PARAMETER("attr");
+
+	goto error_exit;
+    }
+    if(min_size == GLOBUS_NULL)
+    {
+	err = GLOBUS_I_FTP_CLIENT_ERROR_NULL_PARAMETER("min_size");
+
+	goto error_exit;
+    }
+    if(max_size == GLOBUS_NULL)
+    {
+	err = GLOBUS_I_FTP_CLIENT_ERROR_NULL_PARAMETER("max_size");
+
+	goto error_exit;
+    }
+
+    i_attr = *(const globus_i_ftp_client_operationattr_t **) attr;
+
+    *min_size = i_attr->parallelism_min_size;
+    *max_size = i_attr->parallelism_max_size;
+
+    return GLOBUS_SUCCESS;
+
+error_exit:
+    return globus_error_put(err);
+}
+/* globus_ftp_client_operationattr_get_parallelism_range() */
 /* @} */
 
 /**
@@ -3715,6 +3826,8 @@ globus_ftp_client_operationattr_copy(
     {
 	goto destroy_exit;
     }
+    i_dst->parallelism_min_size = i_src->parallelism_min_size;
+    i_dst->parallelism_max_size = i_src->parallelism_max_size;
 
     result =
 	globus_ftp_client_operationattr_set_layout(dst,
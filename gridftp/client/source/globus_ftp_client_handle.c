@@ -1064,6 +1064,8 @@ globus_l_ftp_client_target_new(
     target->structure = GLOBUS_FTP_CONTROL_STRUCTURE_NONE;
     target->layout.mode = GLOBUS_FTP_CONTROL_STRIPING_NONE;
     target->parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_NONE;
+    target->parallelism_min_size = 0;
+    target->parallelism_max_size = 0;
     target->data_prot = GLOBUS_FTP_CONTROL_PROTECTION_CLEAR;
     target->pbsz = 0;
     GlobusTimeAbstimeSet(target->last_access, 0, 0);
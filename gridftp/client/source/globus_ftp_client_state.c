@@ -61,6 +61,13 @@ char *
 globus_l_ftp_client_parallelism_string(
     globus_i_ftp_client_target_t *		target);
 
+static
+void
+globus_l_ftp_client_parallelism_range(
+    globus_i_ftp_client_operationattr_t *	attr,
+    globus_size_t *				min_size,
+    globus_size_t *				max_size);
+
 static
 char *
 globus_l_ftp_client_layout_string(
@@ -273,6 +280,8 @@ globus_i_ftp_client_response_callback(
     const char *				buffer_cmd = GLOBUS_NULL;
     char *					parallelism_opt = GLOBUS_NULL;
     char *					layout_opt = GLOBUS_NULL;
+    globus_size_t				min_size;
+    globus_size_t				max_size;
     char *                                      list_str = GLOBUS_NULL;    
     unsigned long				pbsz = 0;
     int						rc, oldrc, i;
@@ -1676,6 +1685,14 @@ redo:
             (target->parallelism.mode != GLOBUS_FTP_CONTROL_PARALLELISM_FIXED 
                 || target->attr->parallelism.fixed.size ==
 	            target->parallelism.fixed.size) &&
+            (target->parallelism.mode !=
+                GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC
+                || (target->attr->parallelism.base.size ==
+                    target->parallelism.base.size &&
+                target->attr->parallelism_min_size ==
+                    target->parallelism_min_size &&
+                target->attr->parallelism_max_size ==
+                    target->parallelism_max_size)) &&
 	    target->attr->layout.mode == target->layout.mode &&
 	        (target->layout.mode !=
 	            GLOBUS_FTP_CONTROL_STRIPING_BLOCKED_ROUND_ROBIN
@@ -1693,6 +1710,18 @@ redo:
 	{
 	    goto result_fault;
 	}
+	if(target->attr->parallelism.mode ==
+	    GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC)
+	{
+	    globus_l_ftp_client_parallelism_range(
+		target->attr, &min_size, &max_size);
+	    result = globus_ftp_control_local_parallelism_range(
+		target->control_handle, min_size, max_size);
+	    if(result)
+	    {
+		goto result_fault;
+	    }
+	}
 	result = globus_ftp_control_local_layout(target->control_handle,
 						 &target->attr->layout,
 						 0);
@@ -1708,6 +1737,8 @@ redo:
 	memcpy(&target->parallelism,
 	       &target->attr->parallelism,
 	       sizeof(globus_ftp_control_parallelism_t));
+	target->parallelism_min_size = target->attr->parallelism_min_size;
+	target->parallelism_max_size = target->attr->parallelism_max_size;
 
 	goto skip_opts_retr;
 
@@ -1725,6 +1756,8 @@ redo:
 	    memcpy(&target->parallelism,
 		   &target->attr->parallelism,
 		   sizeof(globus_ftp_control_parallelism_t));
+	    target->parallelism_min_size = target->attr->parallelism_min_size;
+	    target->parallelism_max_size = target->attr->parallelism_max_size;
 	    memcpy(&target->layout,
 		   &target->attr->layout,
 		   sizeof(globus_ftp_control_layout_t));
@@ -1743,6 +1776,10 @@ redo:
 		memcpy(&target->parallelism,
 		       &target->attr->parallelism,
 		       sizeof(globus_ftp_control_parallelism_t));
+		target->parallelism_min_size =
+		    target->attr->parallelism_min_size;
+		target->parallelism_max_size =
+		    target->attr->parallelism_max_size;
 		memcpy(&target->layout,
 		       &target->attr->layout,
 		       sizeof(globus_ftp_control_layout_t));
@@ -5946,6 +5983,8 @@ globus_l_ftp_client_parallelism_string(
 {
     char *					ptr = GLOBUS_NULL;
     globus_size_t				length;
+    globus_size_t				min_size;
+    globus_size_t				max_size;
 
     length = 17;		/* " Parallelism=,,;\0" */
 
@@ -5967,6 +6006,26 @@ globus_l_ftp_client_parallelism_string(
 		    (int) target->attr->parallelism.fixed.size);
 	}
 	break;
+    case GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC:
+	if((target->parallelism.mode !=
+	        GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC) ||
+	   (target->attr->parallelism.base.size !=
+	        target->parallelism.base.size) ||
+	   (target->attr->parallelism_min_size !=
+	        target->parallelism_min_size) ||
+	   (target->attr->parallelism_max_size !=
+	        target->parallelism_max_size))
+	{
+	    globus_l_ftp_client_parallelism_range(
+		target->attr, &min_size, &max_size);
+	    length += 3 * globus_i_ftp_client_count_digits(max_size);
+	    ptr = globus_libc_malloc(length);
+	    sprintf(ptr, "Parallelism=%d,%d,%d;",
+		    (int) target->attr->parallelism.base.size,
+		    (int) min_size,
+		    (int) max_size);
+	}
+	break;
     case GLOBUS_FTP_CONTROL_PARALLELISM_NONE:
         if((target->parallelism.mode !=
 	        GLOBUS_FTP_CONTROL_PARALLELISM_NONE) &&
@@ -5979,6 +6038,31 @@ globus_l_ftp_client_parallelism_string(
     return ptr;
 }
 
+/**
+ * Range a dynamic parallelism attribute scales within.
+ *
+ * The starting size always falls inside it; without a range set on the
+ * attribute it is just the starting size.
+ */
+static
+void
+globus_l_ftp_client_parallelism_range(
+    globus_i_ftp_client_operationattr_t *	attr,
+    globus_size_t *				min_size,
+    globus_size_t *				max_size)
+{
+    *min_size = attr->parallelism_min_size;
+    *max_size = attr->parallelism_max_size;
+    if(*min_size < 1 || *min_size > attr->parallelism.base.size)
+    {
+	*min_size = attr->parallelism.base.size;
+    }
+    if(*max_size < attr->parallelism.base.size)
+    {
+	*max_size = attr->parallelism.base.size;
+    }
+}
+
 /**
  * faked force close oneshot wrapper
  */
@@ -131,6 +131,9 @@ do { \
 typedef struct globus_i_ftp_client_operationattr_t
 {
     globus_ftp_control_parallelism_t            parallelism;
+    /* GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC range, 0 when not set */
+    globus_size_t                               parallelism_min_size;
+    globus_size_t                               parallelism_max_size;
     globus_bool_t				force_striped;
     globus_ftp_control_layout_t                 layout;
     globus_ftp_control_tcpbuffer_t              buffer;
@@ -705,6 +708,8 @@ typedef struct globus_i_ftp_client_target_s
     globus_ftp_control_structure_t		structure;
     globus_ftp_control_layout_t			layout;
     globus_ftp_control_parallelism_t		parallelism;
+    globus_size_t                               parallelism_min_size;
+    globus_size_t                               parallelism_max_size;
     char *                                      authz_assert;
     char *                                      net_stack_str;
     char *                                      disk_stack_str;
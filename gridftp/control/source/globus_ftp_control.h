@@ -236,7 +236,10 @@ typedef enum globus_ftp_control_structure_e
 typedef enum globus_ftp_control_parallelism_mode_e
 {
     GLOBUS_FTP_CONTROL_PARALLELISM_NONE,
-    GLOBUS_FTP_CONTROL_PARALLELISM_FIXED
+    GLOBUS_FTP_CONTROL_PARALLELISM_FIXED,
+    /* base.size is the starting level; the range is set with
+     * globus_ftp_control_local_parallelism_range() */
+    GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC
 } globus_ftp_control_parallelism_mode_t;
 
 /*  
@@ -1608,6 +1611,12 @@ globus_ftp_control_local_parallelism(
     globus_ftp_control_handle_t *		handle,
     globus_ftp_control_parallelism_t *          parallelism);
 
+globus_result_t
+globus_ftp_control_local_parallelism_range(
+    globus_ftp_control_handle_t *		handle,
+    globus_size_t                               min_size,
+    globus_size_t                               max_size);
+
 globus_result_t
 globus_ftp_control_local_pasv(
     globus_ftp_control_handle_t *		handle,
@@ -1698,6 +1707,16 @@ globus_ftp_control_data_write(
     globus_ftp_control_data_callback_t        	callback,
     void *					callback_arg);
 
+globus_result_t
+globus_ftp_control_data_write_file(
+    globus_ftp_control_handle_t *		handle,
+    globus_xio_system_file_t                    fd,
+    globus_off_t                                file_offset,
+    globus_size_t				length,
+    globus_off_t				offset,
+    globus_ftp_control_data_callback_t        	callback,
+    void *					callback_arg);
+
 globus_result_t
 globus_ftp_control_data_read(
     globus_ftp_control_handle_t *		handle,
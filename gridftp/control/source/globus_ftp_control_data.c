@@ -95,6 +95,8 @@
     t_e->whos_my_daddy = GLOBUS_NULL;                                   \
     t_e->ascii_buffer = GLOBUS_NULL;                                    \
     t_e->eof = _eof;                                                    \
+    t_e->sendfile = GLOBUS_FALSE;                                       \
+    t_e->file_buffer = GLOBUS_NULL;                                     \
 }
 
 /********************************************************************
@@ -111,6 +113,17 @@ typedef struct globus_l_ftp_c_data_layout_s
     char *                                      name;
 } globus_l_ftp_c_data_layout_t;
 
+/*
+ *  GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC range of a handle, kept here
+ *  keyed by its dc_handle since globus_ftp_control_parallelism_t and the
+ *  control handle are allocated by the user
+ */
+typedef struct globus_l_ftp_c_data_range_s
+{
+    globus_size_t                               min_size;
+    globus_size_t                               max_size;
+} globus_l_ftp_c_data_range_t;
+
 
 /*
  *  individual data connection
@@ -161,6 +174,15 @@ typedef struct globus_ftp_data_stripe_s
     globus_bool_t                               eof;
     globus_size_t                               eod_count;
     globus_size_t                               eods_received;
+
+    /* GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC range and sampling state */
+    globus_size_t                               dyn_min_size;
+    globus_size_t                               dyn_max_size;
+    globus_off_t                                dyn_bytes;
+    globus_abstime_t                            dyn_sample_time;
+    double                                      dyn_rate;
+    int                                         dyn_retrans;
+    int                                         dyn_step;
 } globus_ftp_data_stripe_t;
 
 /* transient */
@@ -241,6 +263,12 @@ typedef struct globus_l_ftp_handle_table_entry_s
 
     globus_ftp_control_type_t                   type;
 
+    /* payload comes from a file, see globus_ftp_control_data_write_file() */
+    globus_bool_t                               sendfile;
+    globus_xio_system_file_t                    file_fd;
+    globus_off_t                                file_offset;
+    globus_byte_t *                             file_buffer;
+
 } globus_l_ftp_handle_table_entry_t;
 
 /*
@@ -376,6 +404,31 @@ globus_l_ftp_eb_read_callback(
     globus_byte_t *                             buf,
     globus_size_t                               nbyte);
 
+void
+globus_l_ftp_stream_write_file_callback(
+    void *                                      arg,
+    globus_io_handle_t *                        handle,
+    globus_result_t                             result,
+    struct iovec *                              iov,
+    globus_size_t                               iovcnt,
+    globus_size_t                               nbytes);
+
+void
+globus_l_ftp_eb_write_file_callback(
+    void *                                      arg,
+    globus_io_handle_t *                        handle,
+    globus_result_t                             result,
+    struct iovec *                              iov,
+    globus_size_t                               iovcnt,
+    globus_size_t                               nbytes);
+
+globus_result_t
+globus_l_ftp_control_data_register_file(
+    globus_ftp_data_connection_t *              data_conn,
+    globus_l_ftp_handle_table_entry_t *         entry,
+    struct iovec *                              io_vec,
+    globus_io_writev_callback_t                 callback);
+
 globus_result_t
 globus_l_ftp_control_data_stream_read_write(
     globus_i_ftp_dc_handle_t *                  handle,
@@ -541,6 +594,28 @@ globus_l_ftp_control_register_close_msg(
     globus_i_ftp_dc_handle_t *                   dc_handle,
     globus_ftp_data_connection_t *               data_conn);
 
+static
+globus_result_t
+globus_l_ftp_control_data_get_retransmits(
+    globus_ftp_data_connection_t *              data_conn,
+    int *                                       count);
+
+static
+void
+globus_l_ftp_control_data_scale_parallelism(
+    globus_ftp_data_stripe_t *                  stripe);
+
+static
+void
+globus_l_ftp_control_data_reset_scaling(
+    globus_ftp_data_stripe_t *                  stripe);
+
+static
+void
+globus_l_ftp_control_data_stripe_range(
+    globus_i_ftp_dc_handle_t *                  dc_handle,
+    globus_ftp_data_stripe_t *                  stripe);
+
 globus_result_t
 globus_i_ftp_control_data_write_stripe(
     globus_i_ftp_dc_handle_t *                  dc_handle,
@@ -587,8 +662,16 @@ static globus_cond_t                globus_l_ftp_control_data_cond;
 static int                          globus_l_ftp_control_data_dc_count = 0;
 
 static globus_hashtable_t           globus_l_ftp_control_data_layout_table;
+static globus_hashtable_t           globus_l_ftp_control_data_range_table;
 
 #define GFTPC_HASH_TABLE_SIZE       64
+
+/*
+ *  GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC: how often the writer measures
+ *  a stripe, and the relative throughput change it treats as noise
+ */
+#define GLOBUS_L_FTP_CONTROL_DYNAMIC_INTERVAL   2000000
+#define GLOBUS_L_FTP_CONTROL_DYNAMIC_NOISE      0.05
 /******************************************************************
 *                   header definitions
 ******************************************************************/
@@ -1425,6 +1508,7 @@ globus_l_ftp_control_data_eb_connect_write(
             stripe->eof = GLOBUS_FALSE;
             stripe->eod_count = -1;
             stripe->total_connection_count = 0;
+            globus_l_ftp_control_data_reset_scaling(stripe);
 
             while(!globus_list_empty(stripe->free_cache_list))
             {
@@ -2799,6 +2883,7 @@ globus_ftp_control_local_parallelism(
             globus_i_ftp_parallelism_copy(
                 &stripe->parallel,
                 &dc_handle->parallel);
+            globus_l_ftp_control_data_stripe_range(dc_handle, stripe);
         }
     }
     globus_mutex_unlock(&dc_handle->mutex);
@@ -2807,6 +2892,109 @@ globus_ftp_control_local_parallelism(
 }
 /* globus_ftp_control_local_parallelism() */
 
+/**
+ * @brief Set control handle parallelism range
+ * @ingroup globus_ftp_control_data
+ * @details
+ * Set the fewest and most data connections per stripe that a
+ * GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC sender may scale between.  The
+ * starting level is the size set with
+ * globus_ftp_control_local_parallelism().  Without a range a dynamic
+ * handle keeps its starting level.
+ *
+ * @param handle
+ *        A pointer to the FTP control handle for which the
+ *        parallelism range is to be updated
+ * @param min_size
+ *        The fewest data connections per stripe, at least 1
+ * @param max_size
+ *        The most data connections per stripe, at least min_size
+ */
+globus_result_t
+globus_ftp_control_local_parallelism_range(
+    globus_ftp_control_handle_t *		handle,
+    globus_size_t                               min_size,
+    globus_size_t                               max_size)
+{
+    int                                         ctr;
+    globus_ftp_data_stripe_t *                  stripe;
+    globus_i_ftp_dc_handle_t *                  dc_handle;
+    globus_object_t *                           err;
+    globus_i_ftp_dc_transfer_handle_t *         transfer_handle;
+    globus_l_ftp_c_data_range_t *               range;
+    static char *                               myname=
+                                "globus_ftp_control_local_parallelism_range";
+
+    /*
+     *  error checking
+     */
+    if(handle == GLOBUS_NULL)
+    {
+        err = globus_io_error_construct_null_parameter(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  "handle",
+                  1,
+                  myname);
+        return globus_error_put(err);
+    }
+    dc_handle = &handle->dc_handle;
+    GlobusFTPControlDataTestMagic(dc_handle);
+    if(!dc_handle->initialized)
+    {
+        err = globus_io_error_construct_not_initialized(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  "handle",
+                  1,
+                  myname);
+        return globus_error_put(err);
+    }
+    if(min_size < 1 || max_size < min_size)
+    {
+        err = globus_io_error_construct_bad_parameter(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  "max_size",
+                  3,
+                  myname);
+        return globus_error_put(err);
+    }
+
+    transfer_handle = dc_handle->transfer_handle;
+
+    globus_mutex_lock(&dc_handle->mutex);
+    {
+        globus_mutex_lock(&globus_l_ftp_control_data_mutex);
+        {
+            range = (globus_l_ftp_c_data_range_t *) globus_hashtable_lookup(
+                &globus_l_ftp_control_data_range_table, dc_handle);
+            if(range == GLOBUS_NULL)
+            {
+                range = (globus_l_ftp_c_data_range_t *)
+                    globus_malloc(sizeof(globus_l_ftp_c_data_range_t));
+                globus_hashtable_insert(
+                    &globus_l_ftp_control_data_range_table, dc_handle, range);
+            }
+            range->min_size = min_size;
+            range->max_size = max_size;
+        }
+        globus_mutex_unlock(&globus_l_ftp_control_data_mutex);
+
+        for(ctr = 0; transfer_handle != GLOBUS_NULL &&
+            ctr < transfer_handle->stripe_count; ctr++)
+        {
+            stripe = &transfer_handle->stripes[ctr];
+
+            globus_l_ftp_control_data_stripe_range(dc_handle, stripe);
+        }
+    }
+    globus_mutex_unlock(&dc_handle->mutex);
+
+    return GLOBUS_SUCCESS;
+}
+/* globus_ftp_control_local_parallelism_range() */
+
 /**
  * @brief Create a passive socket
  * @ingroup globus_ftp_control_data
@@ -3797,7 +3985,6 @@ globus_ftp_control_data_get_retransmit_count(
     globus_i_ftp_dc_transfer_handle_t *         transfer_handle;
     globus_ftp_data_stripe_t *                  stripe;
     globus_ftp_data_connection_t *              data_conn;
-    globus_xio_driver_t                         tcp_driver;
     int                                         ctr;
     int                                         count;
     char *                                      count_str = NULL;
@@ -3855,8 +4042,6 @@ globus_ftp_control_data_get_retransmit_count(
             return res;
         }
 
-        tcp_driver = globus_io_compat_get_tcp_driver();
-        
         for(ctr = 0; ctr < transfer_handle->stripe_count; ctr++)
         {
             stripe = &transfer_handle->stripes[ctr];
@@ -3864,51 +4049,19 @@ globus_ftp_control_data_get_retransmit_count(
                 !globus_list_empty(list);
                 list = globus_list_rest(list))
             {
-                globus_xio_handle_t         xio_handle;
-                globus_xio_system_socket_t  socket;
                 char *                      tmp_str;
 
                 data_conn = (globus_ftp_data_connection_t *)
                                  globus_list_first(list);
 
-                res = globus_io_handle_get_xio_handle(
-                    &data_conn->io_handle, &xio_handle);
-                if(res != GLOBUS_SUCCESS)
-                {
-                    globus_mutex_unlock(&dc_handle->mutex);
-                    return res;
-                }
-
-                res = globus_xio_handle_cntl(
-                    xio_handle,
-                    tcp_driver,
-                    GLOBUS_XIO_TCP_GET_HANDLE,
-                    &socket);
+                res = globus_l_ftp_control_data_get_retransmits(
+                    data_conn, &count);
                 if(res != GLOBUS_SUCCESS)
                 {
                     globus_mutex_unlock(&dc_handle->mutex);
                     return res;
                 }
 
-                count = -1;
-#if defined(TARGET_ARCH_LINUX) && defined(TCP_MD5SIG)
-                {
-                    struct tcp_info             tcpinfo;
-                    socklen_t                   len;
-    
-                    len = sizeof(tcpinfo);
-                    res = globus_xio_system_socket_getsockopt(
-                        socket, IPPROTO_TCP, TCP_INFO, (void *) &tcpinfo, &len);
-                    if(res != GLOBUS_SUCCESS)
-                    {
-                        globus_mutex_unlock(&dc_handle->mutex);
-                        return res;
-                    }
-    
-                    count = tcpinfo.tcpi_total_retrans;
-                }
-#endif
-
                 if(count_str)
                 {
                     tmp_str = globus_common_create_string("%s,%d", count_str, count);
@@ -3928,6 +4081,58 @@ globus_ftp_control_data_get_retransmit_count(
     return res;
 }
 
+/*
+ *  total TCP retransmits on one data connection, or -1 where the
+ *  system does not report them
+ */
+static
+globus_result_t
+globus_l_ftp_control_data_get_retransmits(
+    globus_ftp_data_connection_t *              data_conn,
+    int *                                       count)
+{
+    globus_result_t                             res;
+    globus_xio_handle_t                         xio_handle;
+    globus_xio_system_socket_t                  socket;
+
+    *count = -1;
+
+    res = globus_io_handle_get_xio_handle(&data_conn->io_handle, &xio_handle);
+    if(res != GLOBUS_SUCCESS)
+    {
+        return res;
+    }
+
+    res = globus_xio_handle_cntl(
+        xio_handle,
+        globus_io_compat_get_tcp_driver(),
+        GLOBUS_XIO_TCP_GET_HANDLE,
+        &socket);
+    if(res != GLOBUS_SUCCESS)
+    {
+        return res;
+    }
+
+#if defined(TARGET_ARCH_LINUX) && defined(TCP_MD5SIG)
+    {
+        struct tcp_info                         tcpinfo;
+        socklen_t                               len;
+
+        len = sizeof(tcpinfo);
+        res = globus_xio_system_socket_getsockopt(
+            socket, IPPROTO_TCP, TCP_INFO, (void *) &tcpinfo, &len);
+        if(res != GLOBUS_SUCCESS)
+        {
+            return res;
+        }
+
+        *count = tcpinfo.tcpi_total_retrans;
+    }
+#endif
+
+    return GLOBUS_SUCCESS;
+}
+
 
 /**
  * @brief Set data channel DCAU
@@ -3956,6 +4161,7 @@ globus_ftp_control_local_dcau(
     static char *                               myname=
 	"globus_ftp_control_local_dcau";
     globus_object_t *                           err;
+    globus_xio_attr_t                           xio_attr;
 
     /*
      *  error checking
@@ -4046,6 +4252,20 @@ globus_ftp_control_local_dcau(
 	    }
 
 	    globus_io_secure_authorization_data_destroy(&auth_data);
+
+            /* data connections of a session reuse the TLS session of the
+             * first one; a driver that cannot resume just does a full
+             * handshake, so errors are ignored
+             */
+            if(globus_io_attr_get_xio_attr(
+                   &dc_handle->io_attr, &xio_attr) == GLOBUS_SUCCESS)
+            {
+                globus_xio_attr_cntl(
+                    xio_attr,
+                    globus_io_compat_get_gsi_driver(),
+                    GLOBUS_XIO_GSI_SET_SESSION_RESUMPTION,
+                    GLOBUS_TRUE);
+            }
 	}
 	else
 	{
@@ -4623,7 +4843,201 @@ globus_ftp_control_data_write(
     }
     globus_mutex_unlock(&dc_handle->mutex);
 
-
+
+    return result;
+}
+
+/**
+ * @brief Write a range of a file to data connections
+ * @ingroup globus_ftp_control_data
+ * @details
+ * Sends length bytes of the open file fd, starting at file_offset,
+ * without copying them through user space (sendfile()).  This is only
+ * possible on unprotected, binary, single stripe stream or extended
+ * block transfers using the default data channel stack.  In every
+ * other case an error is returned without anything being queued and
+ * the caller should read the data itself and use
+ * globus_ftp_control_data_write() instead.
+ *
+ * The file must stay open until the callback has been called.  The
+ * callback is passed a NULL buffer.
+ *
+ * @param handle
+ *        A pointer to a FTP control handle.
+ * @param fd
+ *        The file to send from.
+ * @param file_offset
+ *        Where in fd the data starts.
+ * @param length
+ *        The number of bytes to send.
+ * @param offset
+ *        The offset in the transfer at which the data starts
+ * @param callback
+ *        The function to be called once the data has been sent
+ * @param callback_arg
+ *        User supplied argument to the callback function
+ */
+globus_result_t
+globus_ftp_control_data_write_file(
+    globus_ftp_control_handle_t *		handle,
+    globus_xio_system_file_t                    fd,
+    globus_off_t                                file_offset,
+    globus_size_t				length,
+    globus_off_t				offset,
+    globus_ftp_control_data_callback_t	        callback,
+    void *					callback_arg)
+{
+    globus_i_ftp_dc_handle_t *                  dc_handle;
+    globus_i_ftp_dc_transfer_handle_t *         transfer_handle;
+    globus_l_ftp_handle_table_entry_t *         entry;
+    globus_ftp_control_data_write_info_t        data_info;
+    globus_ftp_data_stripe_t *                  stripe;
+    globus_bool_t                               sendfile_ok;
+    globus_result_t                             result = GLOBUS_SUCCESS;
+    globus_object_t *                           err;
+    static char *                               myname=
+                                      "globus_ftp_control_data_write_file";
+
+    /*
+     *  error checking
+     */
+    if(handle == GLOBUS_NULL)
+    {
+        err = globus_io_error_construct_null_parameter(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  "handle",
+                  1,
+                  myname);
+        return globus_error_put(err);
+    }
+
+    dc_handle = &handle->dc_handle;
+    GlobusFTPControlDataTestMagic(dc_handle);
+    if(!dc_handle->initialized)
+    {
+        err = globus_io_error_construct_not_initialized(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  "handle",
+                  1,
+                  myname);
+        return globus_error_put(err);
+    }
+    if(callback == GLOBUS_NULL)
+    {
+        err = globus_io_error_construct_null_parameter(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  "callback",
+                  6,
+                  myname);
+        return globus_error_put(err);
+    }
+    if(length == 0)
+    {
+        err = globus_io_error_construct_bad_parameter(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  "length",
+                  4,
+                  myname);
+        return globus_error_put(err);
+    }
+
+    globus_mutex_lock(&dc_handle->mutex);
+    {
+        err = GLOBUS_NULL;
+        transfer_handle = dc_handle->transfer_handle;
+        sendfile_ok = GLOBUS_FALSE;
+        globus_io_attr_get_sendfile_ok(&dc_handle->io_attr, &sendfile_ok);
+
+        if(transfer_handle == GLOBUS_NULL ||
+           dc_handle->state != GLOBUS_FTP_DATA_STATE_CONNECT_WRITE ||
+           transfer_handle->eof_registered)
+        {
+            err = dc_handle->connect_error
+                ? globus_object_copy(dc_handle->connect_error)
+                : globus_error_construct_string(
+                      GLOBUS_FTP_CONTROL_MODULE,
+                      GLOBUS_NULL,
+         _FCSL("globus_ftp_control_data_write_file(): Handle not in proper state. %s"),
+         globus_l_ftp_control_state_to_string(dc_handle->state));
+        }
+        else if(!sendfile_ok ||
+           dc_handle->protection != GLOBUS_FTP_CONTROL_PROTECTION_CLEAR ||
+           dc_handle->type == GLOBUS_FTP_CONTROL_TYPE_ASCII ||
+           transfer_handle->stripe_count != 1 ||
+           (dc_handle->mode != GLOBUS_FTP_CONTROL_MODE_STREAM &&
+            dc_handle->mode != GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK))
+        {
+            err = globus_error_construct_string(
+                      GLOBUS_FTP_CONTROL_MODULE,
+                      GLOBUS_NULL,
+         _FCSL("globus_ftp_control_data_write_file(): Data channel cannot send directly from a file."));
+        }
+        else if(dc_handle->mode == GLOBUS_FTP_CONTROL_MODE_STREAM)
+        {
+            result = globus_l_ftp_control_data_stream_read_write(
+                         dc_handle,
+                         GLOBUS_NULL,
+                         length,
+                         offset,
+                         GLOBUS_FALSE,
+                         callback,
+                         callback_arg);
+        }
+        else
+        {
+            globus_i_ftp_control_create_data_info(
+                dc_handle,
+                &data_info,
+                GLOBUS_NULL,
+                length,
+                offset,
+                GLOBUS_FALSE,
+                callback,
+                callback_arg);
+
+            /* can't fail, everything it checks was checked above */
+            result = globus_i_ftp_control_data_write_stripe(
+                dc_handle,
+                GLOBUS_NULL,
+                length,
+                offset,
+                GLOBUS_FALSE,
+                0,
+                &data_info);
+            globus_assert(result == GLOBUS_SUCCESS);
+        }
+
+        if(err)
+        {
+            globus_mutex_unlock(&dc_handle->mutex);
+            return globus_error_put(err);
+        }
+
+        if(result == GLOBUS_SUCCESS)
+        {
+            /* both paths above queue the new entry last on the stripe */
+            stripe = &transfer_handle->stripes[0];
+            entry = (globus_l_ftp_handle_table_entry_t *)
+                globus_fifo_tail_peek(&stripe->command_q);
+            entry->sendfile = GLOBUS_TRUE;
+            entry->file_fd = fd;
+            entry->file_offset = file_offset;
+
+            if(dc_handle->mode == GLOBUS_FTP_CONTROL_MODE_EXTENDED_BLOCK)
+            {
+                globus_i_ftp_control_release_data_info(
+                    dc_handle,
+                    &data_info);
+            }
+        }
+        globus_l_ftp_data_stripe_poll(dc_handle);
+    }
+    globus_mutex_unlock(&dc_handle->mutex);
+
     return result;
 }
 
@@ -5053,6 +5467,11 @@ globus_i_ftp_control_data_activate(void)
         GFTPC_HASH_TABLE_SIZE,
         globus_hashtable_string_hash,
         globus_hashtable_string_keyeq);
+    globus_hashtable_init(
+        &globus_l_ftp_control_data_range_table,
+        GFTPC_HASH_TABLE_SIZE,
+        globus_hashtable_voidp_hash,
+        globus_hashtable_voidp_keyeq);
 
     globus_ftp_control_layout_register_func(
         "Blocked",
@@ -5101,6 +5520,9 @@ globus_i_ftp_control_data_deactivate(void)
     globus_hashtable_destroy_all(
         &globus_l_ftp_control_data_layout_table,
         globus_l_ftp_control_data_layout_clean);
+    globus_hashtable_destroy_all(
+        &globus_l_ftp_control_data_range_table,
+        globus_libc_free);
     globus_cond_destroy(&globus_l_ftp_control_data_cond);
     globus_mutex_destroy(&globus_l_ftp_control_data_mutex);
 
@@ -6388,7 +6810,26 @@ globus_l_ftp_data_stream_stripe_poll(
         if(data_conn != GLOBUS_NULL)
         {
             entry->whos_my_daddy = data_conn;
-            if(entry->direction == GLOBUS_FTP_DATA_STATE_CONNECT_WRITE)
+            if(entry->direction == GLOBUS_FTP_DATA_STATE_CONNECT_WRITE &&
+               entry->sendfile)
+            {
+                struct iovec *                    io_vec;
+
+                globus_fifo_dequeue(&stripe->command_q);
+                globus_fifo_dequeue(&stripe->free_conn_q);
+
+                /* nothing precedes the payload in stream mode */
+                io_vec = (struct iovec *)
+                    globus_calloc(2, sizeof(struct iovec));
+
+                result = globus_l_ftp_control_data_register_file(
+                             data_conn,
+                             entry,
+                             io_vec,
+                             globus_l_ftp_stream_write_file_callback);
+                globus_assert(result == GLOBUS_SUCCESS);
+            }
+            else if(entry->direction == GLOBUS_FTP_DATA_STATE_CONNECT_WRITE)
             {
                 globus_byte_t *                   tmp_buf = entry->buffer;
                 globus_off_t                      tmp_len;
@@ -6628,6 +7069,32 @@ globus_l_ftp_data_eb_poll(
                             globus_assert(res == GLOBUS_SUCCESS);
                         }
                     }
+                    /* payload comes straight from a file */
+                    else if(entry->sendfile)
+                    {
+                        eb_header = (globus_l_ftp_eb_header_t *)
+                            globus_malloc(sizeof(globus_l_ftp_eb_header_t));
+                        eb_header->descriptor = 0;
+
+                        globus_l_ftp_control_data_encode(
+                             eb_header->count,
+                             entry->length);
+                        globus_l_ftp_control_data_encode(
+                             eb_header->offset,
+                             entry->offset);
+
+                        io_vec = (struct iovec *)globus_calloc(
+                                     2, sizeof(struct iovec));
+                        io_vec[0].iov_base = eb_header;
+                        io_vec[0].iov_len = sizeof(globus_l_ftp_eb_header_t);
+
+                        res = globus_l_ftp_control_data_register_file(
+                                  data_conn,
+                                  entry,
+                                  io_vec,
+                                  globus_l_ftp_eb_write_file_callback);
+                        globus_assert(res == GLOBUS_SUCCESS);
+                    }
                     /* not an eof message */
                     else
                     {
@@ -7185,6 +7652,7 @@ globus_l_ftp_control_stripes_create(
 
         globus_i_ftp_parallelism_copy(&stripe->parallel,
             &dc_handle->parallel);
+        globus_l_ftp_control_data_stripe_range(dc_handle, stripe);
         stripe->stripe_ndx = ctr;
         stripe->outstanding_connections = 0;
 
@@ -7201,6 +7669,7 @@ globus_l_ftp_control_stripes_create(
         stripe->eof_sent = GLOBUS_FALSE;
         stripe->eof = GLOBUS_FALSE;
         stripe->eod_count = -1;
+        globus_l_ftp_control_data_reset_scaling(stripe);
 
         stripe->whos_my_daddy = transfer_handle;
         stripe->connection_count = 0;
@@ -7430,6 +7899,19 @@ globus_l_ftp_control_data_adjust_connection(
         return GLOBUS_SUCCESS;
     }
 
+    /*
+     *  let a dynamic stripe pick its new level first, unless the next
+     *  command is the eof, whose EOD count is fixed by the connections
+     *  open when it is dispatched
+     */
+    if(stripe->parallel.mode == GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC &&
+       !globus_fifo_empty(&stripe->command_q) &&
+       !((globus_l_ftp_handle_table_entry_t *)
+            globus_fifo_peek(&stripe->command_q))->eof)
+    {
+        globus_l_ftp_control_data_scale_parallelism(stripe);
+    }
+
     /*
      *  if not enough connections register a new connection
      */
@@ -7469,13 +7951,181 @@ globus_l_ftp_control_data_adjust_connection(
                       data_conn);
         }
     }
-    /*
-     * TODO:  remove a connection if the current count is too high.
-     */
 
     return res;
 }
 
+static
+void
+globus_l_ftp_control_data_reset_scaling(
+    globus_ftp_data_stripe_t *                  stripe)
+{
+    stripe->dyn_bytes = 0;
+    GlobusTimeAbstimeSet(stripe->dyn_sample_time, 0, 0);
+    stripe->dyn_rate = -1.0;
+    stripe->dyn_retrans = -1;
+    stripe->dyn_step = 0;
+}
+
+/*
+ *  pick up the handle's dynamic range, if any, and start the stripe
+ *  inside it.  without one the stripe stays at its starting level.
+ *
+ *  called locked
+ */
+static
+void
+globus_l_ftp_control_data_stripe_range(
+    globus_i_ftp_dc_handle_t *                  dc_handle,
+    globus_ftp_data_stripe_t *                  stripe)
+{
+    globus_l_ftp_c_data_range_t *               range;
+
+    stripe->dyn_min_size = stripe->parallel.base.size;
+    stripe->dyn_max_size = stripe->parallel.base.size;
+    if(stripe->parallel.mode != GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC)
+    {
+        return;
+    }
+
+    globus_mutex_lock(&globus_l_ftp_control_data_mutex);
+    {
+        range = (globus_l_ftp_c_data_range_t *) globus_hashtable_lookup(
+            &globus_l_ftp_control_data_range_table, dc_handle);
+        if(range != GLOBUS_NULL)
+        {
+            stripe->dyn_min_size = range->min_size;
+            stripe->dyn_max_size = range->max_size;
+        }
+    }
+    globus_mutex_unlock(&globus_l_ftp_control_data_mutex);
+
+    if(stripe->parallel.base.size < stripe->dyn_min_size)
+    {
+        stripe->parallel.base.size = stripe->dyn_min_size;
+    }
+    if(stripe->parallel.base.size > stripe->dyn_max_size)
+    {
+        stripe->parallel.base.size = stripe->dyn_max_size;
+    }
+}
+
+/*
+ *  GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC
+ *
+ *  every GLOBUS_L_FTP_CONTROL_DYNAMIC_INTERVAL compare the stripe's
+ *  throughput with the previous interval and move parallel.base.size one
+ *  connection at a time within [min_size, max_size]:  keep going in the
+ *  same direction while throughput improves, turn around when it drops,
+ *  and back off when the connections are retransmitting without any gain.
+ *  adjust_connection() then opens or retires connections to match; a
+ *  retired connection is closed with an EOD, so the EOD count sent with
+ *  the EOF still adds up.
+ *
+ *  called locked
+ */
+static
+void
+globus_l_ftp_control_data_scale_parallelism(
+    globus_ftp_data_stripe_t *                  stripe)
+{
+    globus_ftp_data_connection_t *              data_conn;
+    globus_list_t *                             list;
+    globus_abstime_t                            now;
+    globus_reltime_t                            elapsed;
+    long                                        usecs;
+    double                                      rate;
+    double                                      change;
+    int                                         retrans = 0;
+    int                                         count;
+    int                                         size;
+
+    GlobusTimeAbstimeGetCurrent(now);
+    if(stripe->dyn_sample_time.tv_sec == 0)
+    {
+        stripe->dyn_sample_time = now;
+        stripe->dyn_bytes = 0;
+        return;
+    }
+    GlobusTimeAbstimeDiff(elapsed, now, stripe->dyn_sample_time);
+    GlobusTimeReltimeToUSec(usecs, elapsed);
+    if(usecs < GLOBUS_L_FTP_CONTROL_DYNAMIC_INTERVAL)
+    {
+        return;
+    }
+
+    rate = (double) stripe->dyn_bytes * 1000000.0 / usecs;
+
+    for(list = stripe->all_conn_list;
+        !globus_list_empty(list) && retrans >= 0;
+        list = globus_list_rest(list))
+    {
+        data_conn = (globus_ftp_data_connection_t *) globus_list_first(list);
+        if(globus_l_ftp_control_data_get_retransmits(
+            data_conn, &count) != GLOBUS_SUCCESS || count < 0)
+        {
+            retrans = -1;
+        }
+        else
+        {
+            retrans += count;
+        }
+    }
+
+    if(stripe->dyn_rate < 0)
+    {
+        /* first sample, see if one more connection helps */
+        stripe->dyn_step = 1;
+    }
+    else
+    {
+        change = stripe->dyn_rate > 0 ?
+            (rate - stripe->dyn_rate) / stripe->dyn_rate : 0;
+
+        /* a retired connection takes its retransmits out of the total */
+        if(retrans > stripe->dyn_retrans && stripe->dyn_retrans >= 0 &&
+            change <= GLOBUS_L_FTP_CONTROL_DYNAMIC_NOISE)
+        {
+            stripe->dyn_step = -1;
+        }
+        else if(change > GLOBUS_L_FTP_CONTROL_DYNAMIC_NOISE)
+        {
+            if(stripe->dyn_step == 0)
+            {
+                stripe->dyn_step = 1;
+            }
+        }
+        else if(change < -GLOBUS_L_FTP_CONTROL_DYNAMIC_NOISE)
+        {
+            stripe->dyn_step = -stripe->dyn_step;
+        }
+        else
+        {
+            stripe->dyn_step = 0;
+        }
+    }
+
+    size = stripe->parallel.base.size + stripe->dyn_step;
+    if(size < (int) stripe->dyn_min_size)
+    {
+        size = stripe->dyn_min_size;
+    }
+    if(size > (int) stripe->dyn_max_size)
+    {
+        size = stripe->dyn_max_size;
+    }
+    if(size == (int) stripe->parallel.base.size)
+    {
+        stripe->dyn_step = 0;
+    }
+    stripe->parallel.base.size = size;
+
+    stripe->dyn_rate = rate;
+    stripe->dyn_retrans = retrans;
+    stripe->dyn_bytes = 0;
+    stripe->dyn_sample_time = now;
+}
+
 static
 void
 globus_l_ftp_control_command_flush_callback(
@@ -7701,6 +8351,7 @@ globus_i_ftp_control_data_cc_init(
     globus_ftp_control_handle_t *                control_handle)
 {
     globus_i_ftp_dc_handle_t *                   dc_handle;
+    globus_l_ftp_c_data_range_t *                range;
     globus_result_t                              res;
     globus_object_t *                            err;
 
@@ -7745,6 +8396,13 @@ globus_i_ftp_control_data_cc_init(
             dc_handle->parallel.base.mode =
                GLOBUS_FTP_CONTROL_PARALLELISM_FIXED;
             dc_handle->parallel.base.size = 1;
+            /* in case an earlier handle here was never destroyed */
+            range = (globus_l_ftp_c_data_range_t *) globus_hashtable_remove(
+                &globus_l_ftp_control_data_range_table, dc_handle);
+            if(range != GLOBUS_NULL)
+            {
+                globus_free(range);
+            }
 
             globus_mutex_init(&dc_handle->mutex, GLOBUS_NULL);
 
@@ -7891,6 +8549,7 @@ globus_i_ftp_control_data_cc_destroy(
     globus_ftp_control_handle_t *                control_handle)
 {
     globus_i_ftp_dc_handle_t *                   dc_handle;
+    globus_l_ftp_c_data_range_t *                range;
     globus_result_t                              res = GLOBUS_SUCCESS;
     globus_object_t *                            err;
 
@@ -7925,6 +8584,18 @@ globus_i_ftp_control_data_cc_destroy(
             {
                 globus_object_free(dc_handle->connect_error);
             }
+
+            globus_mutex_lock(&globus_l_ftp_control_data_mutex);
+            {
+                range = (globus_l_ftp_c_data_range_t *)
+                    globus_hashtable_remove(
+                        &globus_l_ftp_control_data_range_table, dc_handle);
+            }
+            globus_mutex_unlock(&globus_l_ftp_control_data_mutex);
+            if(range != GLOBUS_NULL)
+            {
+                globus_free(range);
+            }
         }
         else
         {
@@ -10320,6 +10991,8 @@ globus_l_ftp_eb_write_callback(
         }
         else
         {
+            stripe->dyn_bytes += nbytes;
+
             /*
              *  if the stripe is trying to
              *  close so we need to register an EOD or an EOF
@@ -10548,6 +11221,239 @@ globus_l_ftp_eb_write_callback(
 }
 
 
+/*
+ *  file entries are written with globus_io_register_sendfile() (or
+ *  writev if that was refused) so their completions come back with an
+ *  iovec.  drop the bits that are private to the file path and carry on
+ *  as if it had been an ordinary buffer.
+ */
+void
+globus_l_ftp_stream_write_file_callback(
+    void *                                      arg,
+    globus_io_handle_t *                        handle,
+    globus_result_t                             result,
+    struct iovec *                              iov,
+    globus_size_t                               iovcnt,
+    globus_size_t                               nbytes)
+{
+    globus_l_ftp_handle_table_entry_t *         entry;
+
+    entry = (globus_l_ftp_handle_table_entry_t *) arg;
+    if(entry->file_buffer != GLOBUS_NULL)
+    {
+        globus_free(entry->file_buffer);
+        entry->file_buffer = GLOBUS_NULL;
+    }
+    globus_free(iov);
+
+    globus_l_ftp_stream_write_callback(
+        arg,
+        handle,
+        result,
+        GLOBUS_NULL,
+        nbytes);
+}
+
+void
+globus_l_ftp_eb_write_file_callback(
+    void *                                      arg,
+    globus_io_handle_t *                        handle,
+    globus_result_t                             result,
+    struct iovec *                              iov,
+    globus_size_t                               iovcnt,
+    globus_size_t                               nbytes)
+{
+    globus_l_ftp_handle_table_entry_t *         entry;
+
+    entry = (globus_l_ftp_handle_table_entry_t *) arg;
+    if(entry->file_buffer != GLOBUS_NULL)
+    {
+        globus_free(entry->file_buffer);
+        entry->file_buffer = GLOBUS_NULL;
+    }
+
+    /* frees iov and the header */
+    globus_l_ftp_eb_write_callback(
+        arg,
+        handle,
+        result,
+        iov,
+        iovcnt,
+        nbytes);
+}
+
+typedef struct globus_l_ftp_file_read_info_s
+{
+    globus_io_writev_callback_t                 callback;
+    globus_l_ftp_handle_table_entry_t *         entry;
+    globus_ftp_data_connection_t *              data_conn;
+    struct iovec *                              io_vec;
+} globus_l_ftp_file_read_info_t;
+
+/*
+ *  globus_io refused to send from the file, so read the range into
+ *  memory and write it the ordinary way.  this runs from a oneshot so
+ *  the read doesn't block other users of the dc_handle.  a failure
+ *  reading the file is delivered through the callback like any other
+ *  write error.
+ */
+static
+void
+globus_l_ftp_control_data_file_read_kickout(
+    void *                                      user_args)
+{
+    globus_l_ftp_file_read_info_t *             read_info;
+    globus_l_ftp_handle_table_entry_t *         entry;
+    globus_ftp_data_connection_t *              data_conn;
+    struct iovec *                              io_vec;
+    globus_result_t                             res;
+    globus_object_t *                           err;
+    globus_size_t                               nbytes;
+    static char *                               myname =
+        "globus_l_ftp_control_data_file_read_kickout";
+
+    read_info = (globus_l_ftp_file_read_info_t *) user_args;
+    entry = read_info->entry;
+    data_conn = read_info->data_conn;
+    io_vec = read_info->io_vec;
+
+    err = GLOBUS_NULL;
+    entry->file_buffer = globus_malloc(entry->length);
+    if(entry->file_buffer == GLOBUS_NULL)
+    {
+        err = globus_error_construct_string(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  _FCSL("[%s]:%s() : malloc failed."),
+                  GLOBUS_FTP_CONTROL_MODULE->module_name,
+                  myname);
+    }
+#ifndef TARGET_ARCH_WIN32
+    for(nbytes = 0; err == GLOBUS_NULL && nbytes < entry->length; )
+    {
+        ssize_t                                 rc;
+
+        rc = pread(
+                 entry->file_fd,
+                 entry->file_buffer + nbytes,
+                 entry->length - nbytes,
+                 entry->file_offset + nbytes);
+        if(rc > 0)
+        {
+            nbytes += rc;
+        }
+        else if(rc < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            err = globus_error_construct_string(
+                      GLOBUS_FTP_CONTROL_MODULE,
+                      GLOBUS_NULL,
+                      _FCSL("[%s]:%s() : unable to read from file: %s"),
+                      GLOBUS_FTP_CONTROL_MODULE->module_name,
+                      myname,
+                      rc < 0 ? strerror(errno) : "unexpected end of file");
+        }
+    }
+#else
+    nbytes = 0;
+    if(err == GLOBUS_NULL)
+    {
+        err = globus_error_construct_string(
+                  GLOBUS_FTP_CONTROL_MODULE,
+                  GLOBUS_NULL,
+                  _FCSL("[%s]:%s() : sending from a file is not supported."),
+                  GLOBUS_FTP_CONTROL_MODULE->module_name,
+                  myname);
+    }
+#endif
+
+    if(err == GLOBUS_NULL)
+    {
+        io_vec[1].iov_base = entry->file_buffer;
+        io_vec[1].iov_len = entry->length;
+
+        globus_mutex_lock(&entry->dc_handle->mutex);
+        {
+            res = globus_io_register_writev(
+                      &data_conn->io_handle,
+                      io_vec,
+                      2,
+                      read_info->callback,
+                      (void *) entry);
+        }
+        globus_mutex_unlock(&entry->dc_handle->mutex);
+        if(res != GLOBUS_SUCCESS)
+        {
+            err = globus_error_get(res);
+        }
+    }
+
+    if(err != GLOBUS_NULL)
+    {
+        read_info->callback(
+            entry,
+            &data_conn->io_handle,
+            globus_error_put(err),
+            io_vec,
+            2,
+            0);
+    }
+    globus_free(read_info);
+}
+
+/*
+ *  register the write for an entry queued by
+ *  globus_ftp_control_data_write_file().  io_vec has room for 2 entries;
+ *  the first holds the header (empty in stream mode).  if globus_io won't
+ *  send from the file itself (no sendfile() on this platform) the range is
+ *  read and written from a oneshot, see above.
+ *
+ *  called locked
+ */
+globus_result_t
+globus_l_ftp_control_data_register_file(
+    globus_ftp_data_connection_t *              data_conn,
+    globus_l_ftp_handle_table_entry_t *         entry,
+    struct iovec *                              io_vec,
+    globus_io_writev_callback_t                 callback)
+{
+    globus_l_ftp_file_read_info_t *             read_info;
+    globus_result_t                             res;
+    globus_reltime_t                            reltime;
+
+    res = globus_io_register_sendfile(
+              &data_conn->io_handle,
+              io_vec,
+              1,
+              entry->file_fd,
+              entry->file_offset,
+              entry->length,
+              callback,
+              (void *) entry);
+    if(res == GLOBUS_SUCCESS)
+    {
+        return GLOBUS_SUCCESS;
+    }
+    globus_object_free(globus_error_get(res));
+
+    read_info = (globus_l_ftp_file_read_info_t *)
+        globus_malloc(sizeof(globus_l_ftp_file_read_info_t));
+    read_info->callback = callback;
+    read_info->entry = entry;
+    read_info->data_conn = data_conn;
+    read_info->io_vec = io_vec;
+
+    GlobusTimeReltimeSet(reltime, 0, 0);
+    return globus_callback_register_oneshot(
+               GLOBUS_NULL,
+               &reltime,
+               globus_l_ftp_control_data_file_read_kickout,
+               (void *) read_info);
+}
+
 void
 globus_l_ftp_close_msg_callback(
     void *                                      arg,
@@ -419,7 +419,8 @@ hdfs_start(
     globus_result_t rc;
 
     int max_buffer_count = 200;
-    int max_file_buffer_count = 1500;
+    int reserve_buffer_count = -1;
+    int read_threads = 4;
     int load_limit = 20;
     int replicas;
     int port;
@@ -453,6 +454,8 @@ hdfs_start(
         globus_gridftp_server_operation_finished(op, rc, &finished_info);
         return;
     }
+    globus_cond_init(&hdfs_handle->writer_cond, GLOBUS_NULL);
+    globus_cond_init(&hdfs_handle->reader_cond, GLOBUS_NULL);
 
     hdfs_handle->io_block_size = 0;
     hdfs_handle->io_count = 0;
@@ -502,7 +505,8 @@ hdfs_start(
             snprintf(hdfs_handle->syslog_msg, 255, "%s %s %%s %%i %%i", hdfs_handle->local_host, hdfs_handle->remote_host);
     }
 
-    // Determine the maximum number of buffers; default to 200.
+    // Determine the maximum number of buffers a write may hold while
+    // reassembling the data stream; default to 200.
     char * max_buffer_char = getenv("GRIDFTP_BUFFER_COUNT");
     if (max_buffer_char != NULL) {
         max_buffer_count = atoi(max_buffer_char);
@@ -513,14 +517,43 @@ hdfs_start(
     snprintf(err_msg, MSG_SIZE, "Max memory buffer count: %i.\n", hdfs_handle->max_buffer_count);
     globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,err_msg);
 
+    // Determine how many more buffers a write may take when every held
+    // block is stuck behind a gap; default to GRIDFTP_BUFFER_COUNT.
+    char * reserve_buffer_char = getenv("GRIDFTP_BUFFER_RESERVE");
+    if (reserve_buffer_char != NULL) {
+        reserve_buffer_count = atoi(reserve_buffer_char);
+        if ((reserve_buffer_count < 0) || (reserve_buffer_count > 5000))
+            reserve_buffer_count = -1;
+    }
+    // GRIDFTP_FILE_BUFFER_COUNT used to allow this many blocks of
+    // reordering on top of GRIDFTP_BUFFER_COUNT, spilled to $TMPDIR;
+    // keep honoring it as the reserve for sites that still set it.
     char * max_file_buffer_char = getenv("GRIDFTP_FILE_BUFFER_COUNT");
     if (max_file_buffer_char != NULL) {
-        max_file_buffer_count = atoi(max_file_buffer_char);
-        if ((max_file_buffer_count < max_buffer_count)  || (max_buffer_count > 50000))
-            max_file_buffer_count = 3*max_buffer_count;
+        globus_gfs_log_message(GLOBUS_GFS_LOG_WARN, "GRIDFTP_FILE_BUFFER_COUNT is obsolete; use GRIDFTP_BUFFER_RESERVE instead.\n");
+        if (reserve_buffer_char == NULL) {
+            reserve_buffer_count = atoi(max_file_buffer_char);
+            if ((reserve_buffer_count < max_buffer_count) || (reserve_buffer_count > 5000))
+                reserve_buffer_count = 3*max_buffer_count;
+        }
     }
-    hdfs_handle->max_file_buffer_count = max_file_buffer_count;
-    snprintf(err_msg, MSG_SIZE, "Max file buffer count: %i.\n", hdfs_handle->max_file_buffer_count);
+    if (reserve_buffer_count < 0)
+        reserve_buffer_count = max_buffer_count;
+    hdfs_handle->reserve_buffer_count = reserve_buffer_count;
+    snprintf(err_msg, MSG_SIZE, "Reserve memory buffer count: %i.\n", hdfs_handle->reserve_buffer_count);
+    globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,err_msg);
+
+    // Determine the number of hdfsPread calls a send keeps in flight, each
+    // in its own reader thread; default to 4.  Zero reads from the
+    // globus callback threads instead.
+    char * read_threads_char = getenv("GRIDFTP_READ_THREADS");
+    if (read_threads_char != NULL) {
+        read_threads = atoi(read_threads_char);
+        if ((read_threads < 0) || (read_threads > 64))
+            read_threads = 4;
+    }
+    hdfs_handle->read_threads = read_threads;
+    snprintf(err_msg, MSG_SIZE, "Read threads: %i.\n", hdfs_handle->read_threads);
     globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,err_msg);
 
     if (load_limit_char != NULL) {
@@ -547,8 +580,6 @@ hdfs_start(
             hdfs_handle->port = port;
     }
 
-    hdfs_handle->using_file_buffer = 0;
-
     hdfs_handle->cksm_root = "/cksums";
 
     globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "Checking current load on the server.\n");
@@ -604,8 +635,6 @@ hdfs_start(
         hdfs_handle->cksm_types = 0;
     }
 
-    hdfs_handle->tmp_file_pattern = (char *)NULL;
-
     // Handle core limits
     gridftp_check_core();
 
@@ -637,8 +666,13 @@ hdfs_destroy(
             globus_free(hdfs_handle->local_host);
         if (hdfs_handle->syslog_msg)
             globus_free(hdfs_handle->syslog_msg);
-        remove_file_buffer(hdfs_handle);
         if (hdfs_handle->mutex) {
+            globus_mutex_lock(hdfs_handle->mutex);
+            hdfs_stop_writer(hdfs_handle, GLOBUS_TRUE);
+            hdfs_stop_readers(hdfs_handle, GLOBUS_TRUE);
+            globus_mutex_unlock(hdfs_handle->mutex);
+            globus_cond_destroy(&hdfs_handle->writer_cond);
+            globus_cond_destroy(&hdfs_handle->reader_cond);
             globus_mutex_destroy(hdfs_handle->mutex);
             globus_free(hdfs_handle->mutex);
         }
@@ -35,6 +35,26 @@ extern globus_version_t gridftp_hdfs_local_version;
 #define HDFS_CKSM_TYPE_ADLER32 4
 #define HDFS_CKSM_TYPE_MD5     8
 
+// A block received for a write, waiting for its turn to go to HDFS.
+typedef struct hdfs_write_block_s
+{
+    globus_byte_t *                     buffer;
+    globus_off_t                        offset;
+    globus_size_t                       nbytes;
+    struct hdfs_write_block_s *         next;
+} hdfs_write_block_t;
+
+// A block read for a send, from hdfsPread until the client has it.
+typedef struct hdfs_read_block_s
+{
+    struct globus_l_gfs_hdfs_handle_s * hdfs_handle;
+    globus_byte_t *                     buffer;
+    globus_off_t                        offset;
+    globus_size_t                       length; // Bytes to read.
+    globus_size_t                       nbytes; // Bytes actually read.
+    struct hdfs_read_block_s *          next;
+} hdfs_read_block_t;
+
 typedef struct globus_l_gfs_hdfs_handle_s
 {
     char *                              pathname;
@@ -48,25 +68,38 @@ typedef struct globus_l_gfs_hdfs_handle_s
     globus_result_t                     done_status; // The status of the finished transfer.
     globus_bool_t                       sent_finish; // Whether or not we have sent the client an abort.
     globus_gfs_operation_t              op;
-    globus_byte_t *                     buffer;
-    globus_off_t *                      offsets; // The offset of each buffer.
-    globus_size_t *                     nbytes; // The number of bytes in each buffer.
-    short *                             used;
     int                                 optimal_count;
-    unsigned int                        max_buffer_count;
-    unsigned int                        max_file_buffer_count;
-    unsigned int                        buffer_count; // Number of buffers we currently maintain in memory waiting to be written to HDFS.
+    unsigned int                        max_buffer_count; // Blocks a transfer may hold or have in flight.
+    unsigned int                        reserve_buffer_count; // Extra blocks allowed while a gap blocks every write.
     unsigned int                        outstanding;
     globus_mutex_t *                    mutex;
+    // Write-side reassembly; see gridftp_hdfs_buffers.c
+    globus_priority_q_t                 pending; // Blocks ahead of offset, keyed by offset.
+    hdfs_write_block_t *                ready; // In-order blocks waiting for hdfsWrite.
+    hdfs_write_block_t **               ready_tail;
+    unsigned int                        held_count; // Blocks pending, ready or being written.
+    globus_cond_t                       writer_cond;
+    globus_bool_t                       writer_running;
+    globus_bool_t                       writer_busy; // The writer is inside hdfsWrite.
+    globus_bool_t                       writer_stop;
+    // Read pipeline; see gridftp_hdfs_send.c
+    globus_fifo_t                       read_queue; // Reads waiting for a reader thread.
+    globus_priority_q_t                 read_done; // Stream mode: blocks waiting to be sent in order.
+    hdfs_read_block_t *                 read_free; // Buffers of sent blocks, for reuse.
+    globus_bool_t                       send_ordered;
+    globus_off_t                        send_offset; // Stream mode: offset of the next block to send.
+    globus_off_t                        hdfs_block_size; // HDFS block size of the file being read.
+    unsigned int                        read_threads; // Reader threads to start for each send.
+    unsigned int                        reader_count; // Reader threads running.
+    unsigned int                        reads_in_flight; // Reads queued or inside hdfsPread.
+    globus_cond_t                       reader_cond;
+    globus_bool_t                       reader_stop;
     int                                 port;
     char *                              host;
     char *                              mount_point;
     unsigned int                        mount_point_len;
     unsigned int                        replicas;
     char *                              username;
-    char *                              tmp_file_pattern;
-    int                                 tmpfilefd;
-    globus_bool_t                       using_file_buffer;
     char *                              syslog_host; // The host to send syslog message to.
     char *                              remote_host; // The remote host connecting to us.
     char *                              local_host;  // Our local hostname.
@@ -99,6 +132,13 @@ hdfs_send(
     globus_gfs_transfer_info_t *        transfer_info,
     void *                              user_arg);
 
+// Stop the reader threads of a send; with wait set, wait for them to exit.
+// Must be called with the hdfs_handle mutex held.
+void
+hdfs_stop_readers(
+    hdfs_handle_t *                   hdfs_handle,
+    globus_bool_t                     wait);
+
 
 // Function for receiving a file from the client.
 void
@@ -107,7 +147,26 @@ hdfs_recv(
     globus_gfs_transfer_info_t *        transfer_info,
     void *                              user_arg);
 
+// Continue a receive after a block was read or written out.
+// Must be called with the hdfs_handle mutex held.
+void
+hdfs_recv_next(
+    hdfs_handle_t *                   hdfs_handle,
+    globus_result_t                   rc);
+
 // Buffer management for writes
+void
+hdfs_buffers_init(
+    hdfs_handle_t *                   hdfs_handle);
+
+void
+hdfs_buffers_destroy(
+    hdfs_handle_t *                   hdfs_handle);
+
+globus_bool_t
+hdfs_buffers_idle(
+    hdfs_handle_t *                   hdfs_handle);
+
 globus_result_t
 hdfs_store_buffer(
     globus_l_gfs_hdfs_handle_t * hdfs_handle,
@@ -119,35 +178,28 @@ globus_result_t
 hdfs_dump_buffers(
     globus_l_gfs_hdfs_handle_t *      hdfs_handle);
 
-globus_result_t
-hdfs_dump_buffer_immed(
+void
+hdfs_start_writer(
+    hdfs_handle_t *                   hdfs_handle);
+
+void
+hdfs_stop_writer(
     hdfs_handle_t *                   hdfs_handle,
-    globus_byte_t *                   buffer,
-    globus_size_t                     nbytes);
+    globus_bool_t                     wait);
 
 // Buffer management for reads
-globus_result_t
-allocate_buffers(
-    hdfs_handle_t *    hdfs_handle,
-    globus_size_t             num_buffers);
-    
-globus_ssize_t
-find_buffer(
-    hdfs_handle_t *    hdfs_handle,
-    globus_byte_t *    buffer); 
-            
-globus_ssize_t
-find_empty_buffer(
-    hdfs_handle_t *    hdfs_handle);
+hdfs_read_block_t *
+hdfs_get_read_block(
+    hdfs_handle_t *                   hdfs_handle);
 
 void
-disgard_buffer(
-    hdfs_handle_t * hdfs_handle,
-    globus_ssize_t idx);
+hdfs_put_read_block(
+    hdfs_handle_t *                   hdfs_handle,
+    hdfs_read_block_t *               block);
 
 void
-remove_file_buffer(
-    hdfs_handle_t * hdfs_handle);
+hdfs_free_read_blocks(
+    hdfs_handle_t *                   hdfs_handle);
 
 
 // Metadata-related functions
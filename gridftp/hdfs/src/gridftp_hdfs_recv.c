@@ -1,6 +1,5 @@
 
 #include "gridftp_hdfs.h"
-#include <sys/mman.h>
 
 #define ADVANCE_SLASHES(x) {while (x[0] == '/' && x[1] == '/') x++;}
 
@@ -58,16 +57,8 @@ close_and_clean(hdfs_handle_t *hdfs_handle, globus_result_t rc) {
         hdfs_handle->fd = NULL;
     }
 
-    if (hdfs_handle->using_file_buffer == 0) {
-        globus_free(hdfs_handle->buffer);
-    } else {
-        munmap(hdfs_handle->buffer, hdfs_handle->block_size*hdfs_handle->buffer_count*sizeof(globus_byte_t));
-        hdfs_handle->using_file_buffer = 0;
-        close(hdfs_handle->tmpfilefd);
-    }
-    globus_free(hdfs_handle->used);
-    globus_free(hdfs_handle->nbytes);
-    globus_free(hdfs_handle->offsets);
+    hdfs_stop_writer(hdfs_handle, GLOBUS_FALSE);
+    hdfs_buffers_destroy(hdfs_handle);
 
     globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "receive %d blocks of size %d bytes\n",
         hdfs_handle->io_count, hdfs_handle->io_block_size);
@@ -194,19 +185,6 @@ globus_result_t prepare_handle(hdfs_handle_t *hdfs_handle) {
 
     globus_gridftp_server_get_optimal_concurrency(hdfs_handle->op,
                                                   &hdfs_handle->optimal_count);
-    hdfs_handle->buffer_count = hdfs_handle->optimal_count;
-    hdfs_handle->nbytes = globus_malloc(hdfs_handle->buffer_count*sizeof(globus_size_t));
-    hdfs_handle->offsets = globus_malloc(hdfs_handle->buffer_count*sizeof(globus_off_t));
-    hdfs_handle->used = globus_malloc(hdfs_handle->buffer_count*sizeof(short));
-    int i;
-    for (i=0; i<hdfs_handle->buffer_count; i++)
-        hdfs_handle->used[i] = 0;
-    hdfs_handle->buffer = globus_malloc(hdfs_handle->buffer_count*hdfs_handle->block_size*sizeof(globus_byte_t));
-    if (hdfs_handle->buffer == NULL || hdfs_handle->nbytes==NULL || 
-            hdfs_handle->offsets==NULL || hdfs_handle->used==NULL) {
-        MemoryError(hdfs_handle, "Memory allocation error.", rc);
-        return rc;
-    }
     return GLOBUS_SUCCESS;
 }
 
@@ -284,6 +262,9 @@ hdfs_recv(
         "Successfully opened file %s for user %s.\n", hdfs_handle->pathname,
          hdfs_handle->username);
 
+    hdfs_buffers_init(hdfs_handle);
+    hdfs_start_writer(hdfs_handle);
+
     globus_gridftp_server_begin_transfer(hdfs_handle->op, 0, hdfs_handle);
     hdfs_dispatch_write(hdfs_handle);
 
@@ -359,23 +340,17 @@ hdfs_handle_write_op(
         goto cleanup;
     }
 
-    // First, see if we can dump this block immediately.
-    if (offset == hdfs_handle->offset) {
-        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Dumping this block immediately.\n");
-        if ((rc = hdfs_dump_buffer_immed(hdfs_handle, buffer, nbytes)) != GLOBUS_SUCCESS) {
-            goto cleanup;
-        }
-    } else {
-        // Try to store the buffer into memory.
-        if ((rc = hdfs_store_buffer(hdfs_handle, buffer, offset, nbytes)) != GLOBUS_SUCCESS) {
-            goto cleanup;
-        }
+    // Hand the buffer over; it is held until the data before it arrives.
+    rc = hdfs_store_buffer(hdfs_handle, buffer, offset, nbytes);
+    buffer = NULL;
+    if (rc != GLOBUS_SUCCESS) {
+        goto cleanup;
     }
 
-    // Try to write out as many buffers as we can to HDFS.
+    // Pass whatever is now in order on to HDFS.
     if ((rc = hdfs_dump_buffers(hdfs_handle)) != GLOBUS_SUCCESS) {
         goto cleanup;
-    }   
+    }
 
 cleanup:
 
@@ -393,24 +368,51 @@ cleanup:
         }
     }
 
-    // Finish the transfer on failure
-    if (rc != GLOBUS_SUCCESS) {
-        set_done(hdfs_handle, rc);
-    }
-
     if (buffer) {
         globus_free(buffer);
     }
     hdfs_handle->outstanding--;
 
+    hdfs_recv_next(hdfs_handle, rc);
+    globus_mutex_unlock(hdfs_handle->mutex);
+}
+
+/*************************************************************************
+ * hdfs_recv_next
+ * --------------
+ * Decide what a receive does next, after a block has been read from the
+ * data channel or written to HDFS: request more data, close the file,
+ * or report the failure.
+ * Note: The hdfs_handle mutex *must* be locked prior to calling
+ *************************************************************************/
+void
+hdfs_recv_next(
+    hdfs_handle_t *                   hdfs_handle,
+    globus_result_t                   rc)
+{
+    GlobusGFSName(hdfs_recv_next);
+
+    // Finish the transfer on failure
+    if (rc != GLOBUS_SUCCESS) {
+        set_done(hdfs_handle, rc);
+    }
+
     if (!is_done(hdfs_handle)) {
         // Request more transfers.
         hdfs_dispatch_write(hdfs_handle);
-    } else if (hdfs_handle->outstanding == 0) {
+    }
+    if (!is_done(hdfs_handle)) {
+        // Nothing else to do until more data arrives.
+    } else if (hdfs_handle->outstanding == 0 && hdfs_buffers_idle(hdfs_handle)) {
         // No I/O in-flight, clean-up.
+        if (hdfs_handle->done_status == GLOBUS_SUCCESS &&
+                !globus_priority_q_empty(&hdfs_handle->pending)) {
+            GenericError(hdfs_handle, "Transfer ended with data missing from the middle of the file.", rc);
+            set_done(hdfs_handle, rc);
+        }
         rc = close_and_clean(hdfs_handle, rc);
         if (!hdfs_handle->sent_finish) {
-            globus_gridftp_server_finished_transfer(op, hdfs_handle->done_status);
+            globus_gridftp_server_finished_transfer(hdfs_handle->op, hdfs_handle->done_status);
             hdfs_handle->sent_finish = GLOBUS_TRUE;
         }
     } else if (rc != GLOBUS_SUCCESS) {
@@ -420,13 +422,13 @@ cleanup:
             "We failed to finish the transfer, but there are %i outstanding writes left over.\n",
             hdfs_handle->outstanding);
         if (!hdfs_handle->sent_finish) {
-            globus_gridftp_server_finished_transfer(op, hdfs_handle->done_status);
+            globus_gridftp_server_finished_transfer(hdfs_handle->op, hdfs_handle->done_status);
             hdfs_handle->sent_finish = GLOBUS_TRUE;
         }
     } else {
-        // Nothing to do if we are done and there was no error, but outstanding transfers exist.
+        // Nothing to do if we are done and there was no error, but
+        // outstanding reads or writes exist.
     }
-    globus_mutex_unlock(hdfs_handle->mutex);
 }
 
 /*************************************************************************
@@ -441,6 +443,7 @@ hdfs_dispatch_write(
     globus_l_gfs_hdfs_handle_t *      hdfs_handle)
 {
     globus_byte_t *                     buffer;
+    unsigned int                        limit;
     globus_result_t                     rc = GLOBUS_SUCCESS;
 
     GlobusGFSName(hdfs_dispatch_write);
@@ -455,7 +458,16 @@ hdfs_dispatch_write(
         "hdfs_dispatch_write; outstanding %d, optimal %d.\n",
         hdfs_handle->outstanding, hdfs_handle->optimal_count);
 
-    while (hdfs_handle->outstanding < hdfs_handle->optimal_count)  {
+    // Blocks held for reassembly or waiting on HDFS count against the
+    // same limit as reads in flight; past it, the data channel waits.
+    // If every held block is stuck behind a gap, nothing will be written
+    // until more data arrives, so dip into the reserve to read it.
+    limit = hdfs_handle->max_buffer_count;
+    if (hdfs_handle->held_count > 0 && hdfs_buffers_idle(hdfs_handle)) {
+        limit += hdfs_handle->reserve_buffer_count;
+    }
+    while (hdfs_handle->outstanding < hdfs_handle->optimal_count &&
+            hdfs_handle->outstanding + hdfs_handle->held_count < limit)  {
 
         buffer = globus_malloc(hdfs_handle->block_size);
         if (buffer == NULL) {
@@ -475,11 +487,23 @@ hdfs_dispatch_write(
 
     }
 
+    // Every buffer, reserve included, is held behind a gap that no read
+    // can fill.  Raising GRIDFTP_BUFFER_RESERVE lets such a transfer go on.
+    if (hdfs_handle->outstanding == 0 && hdfs_handle->held_count > 0 &&
+            hdfs_buffers_idle(hdfs_handle)) {
+        globus_gfs_log_message(GLOBUS_GFS_LOG_ERR,
+            "Holding %u blocks from offset %lld onwards; none can be written.\n",
+            hdfs_handle->held_count, (long long)hdfs_handle->offset);
+        GenericError(hdfs_handle, "Data arrived too far out of order to reassemble; try raising GRIDFTP_BUFFER_RESERVE.", rc);
+        goto cleanup;
+    }
+
 cleanup:
     if (rc != GLOBUS_SUCCESS) {
         set_done(hdfs_handle, rc);
         if (!hdfs_handle->sent_finish) {
             globus_gridftp_server_finished_transfer(hdfs_handle->op, hdfs_handle->done_status);
+            hdfs_handle->sent_finish = GLOBUS_TRUE;
         }
     }
 }
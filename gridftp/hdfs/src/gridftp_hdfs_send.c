@@ -2,12 +2,25 @@
 #include "gridftp_hdfs.h"
 #include <syslog.h>
 
-// Forward declarations of local functions
+/*************************************************************************
+ *  Read pipeline
+ *  -------------
+ *  hdfsPread has a high per-call latency, but scales with the number of
+ *  calls in flight across datanodes.  hdfs_dispatch_read splits the
+ *  requested range into blocks that never straddle an HDFS block, and
+ *  queues them on hdfs_handle->read_queue for a small pool of reader
+ *  threads, which keep up to read_threads preads in flight.
+ *
+ *  In MODE E, a block is passed to globus_gridftp_server_register_write
+ *  as soon as its read completes, in whatever order that happens.  In
+ *  stream mode, the data channel ignores offsets, so finished blocks
+ *  wait in hdfs_handle->read_done until the blocks before them are sent.
+ *
+ *  outstanding counts blocks from dispatch until the client has them;
+ *  reads_in_flight counts those still queued or inside hdfsPread.
+ ************************************************************************/
 
-typedef struct hdfs_read_s {
-    hdfs_handle_t *hdfs_handle;
-    globus_size_t idx;
-} hdfs_read_t;
+// Forward declarations of local functions
 
 static void
 hdfs_finish_read_cb(
@@ -19,7 +32,7 @@ hdfs_finish_read_cb(
 
 static void
 hdfs_perform_read_cb(
-    void *  hdfs_read_handle);
+    void *                              user_arg);
 
 static void
 hdfs_dispatch_read(
@@ -27,16 +40,32 @@ hdfs_dispatch_read(
 
 #define ADVANCE_SLASHES(x) {while (x[0] == '/' && x[1] == '/') x++;}
 
+static int
+hdfs_read_block_cmp(void * priority_1, void * priority_2) {
+    globus_off_t offset_1 = *(globus_off_t *)priority_1;
+    globus_off_t offset_2 = *(globus_off_t *)priority_2;
+
+    if (offset_1 > offset_2) {
+        return 1;
+    }
+    if (offset_1 < offset_2) {
+        return -1;
+    }
+    return 0;
+}
+
 /*************************************************************************
  *  close_and_clean
  *  --------------
- *  Close the HDFS file and clean up the write-related resources in the
+ *  Close the HDFS file and clean up the read-related resources in the
  *  handle.
  *************************************************************************/
 static globus_result_t
 close_and_clean(hdfs_handle_t *hdfs_handle, globus_result_t rc) {
 
     GlobusGFSName(close_and_clean);
+    hdfs_read_block_t * block;
+
     globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,
         "Trying to close file in HDFS; zero outstanding blocks.\n");
     if (is_close_done(hdfs_handle)) {
@@ -53,18 +82,101 @@ close_and_clean(hdfs_handle_t *hdfs_handle, globus_result_t rc) {
         hdfs_handle->fd = NULL;
     }
 
-    if (hdfs_handle->buffer)
-        globus_free(hdfs_handle->buffer);
-    if (hdfs_handle->used)
-        globus_free(hdfs_handle->used);
+    hdfs_stop_readers(hdfs_handle, GLOBUS_FALSE);
+    while ((block = globus_fifo_dequeue(&hdfs_handle->read_queue)) != NULL) {
+        hdfs_put_read_block(hdfs_handle, block);
+    }
+    globus_fifo_destroy(&hdfs_handle->read_queue);
+    while ((block = globus_priority_q_dequeue(&hdfs_handle->read_done)) != NULL) {
+        hdfs_put_read_block(hdfs_handle, block);
+    }
+    globus_priority_q_destroy(&hdfs_handle->read_done);
+    hdfs_free_read_blocks(hdfs_handle);
 
-    globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "receive %d blocks of size %d bytes\n",
+    globus_gfs_log_message(GLOBUS_GFS_LOG_INFO, "send %d blocks of size %d bytes\n",
         hdfs_handle->io_count, hdfs_handle->io_block_size);
 
     set_close_done(hdfs_handle, rc);
     return rc;
 }
 
+/*************************************************************************
+ *  hdfs_reader
+ *  -----------
+ *  Reader thread for one send.  Takes blocks off the read queue and
+ *  reads them with the mutex released.
+ ************************************************************************/
+static void *
+hdfs_reader(void * user_arg) {
+    hdfs_handle_t * hdfs_handle = (hdfs_handle_t *) user_arg;
+    hdfs_read_block_t * block;
+
+    globus_mutex_lock(hdfs_handle->mutex);
+    while (!hdfs_handle->reader_stop) {
+        if (globus_fifo_empty(&hdfs_handle->read_queue)) {
+            globus_cond_wait(&hdfs_handle->reader_cond, hdfs_handle->mutex);
+            continue;
+        }
+        block = globus_fifo_dequeue(&hdfs_handle->read_queue);
+        globus_mutex_unlock(hdfs_handle->mutex);
+
+        hdfs_perform_read_cb(block);
+
+        globus_mutex_lock(hdfs_handle->mutex);
+    }
+    hdfs_handle->reader_count--;
+    globus_cond_broadcast(&hdfs_handle->reader_cond);
+    globus_mutex_unlock(hdfs_handle->mutex);
+
+    return NULL;
+}
+
+/*************************************************************************
+ *  hdfs_start_readers
+ *  ------------------
+ *  Start the reader threads for a new send.  If none can be started,
+ *  the reads are run from globus callback threads instead.
+ *  Must be called with the hdfs_handle mutex held.
+ ************************************************************************/
+static void
+hdfs_start_readers(hdfs_handle_t * hdfs_handle) {
+    globus_thread_t thread;
+    unsigned int i;
+
+    // The readers of a previous send may still be on their way out.
+    while (hdfs_handle->reader_count > 0) {
+        globus_cond_wait(&hdfs_handle->reader_cond, hdfs_handle->mutex);
+    }
+    hdfs_handle->reader_stop = GLOBUS_FALSE;
+    for (i = 0; i < hdfs_handle->read_threads; i++) {
+        if (globus_thread_create(&thread, NULL, hdfs_reader, hdfs_handle) != 0) {
+            break;
+        }
+        hdfs_handle->reader_count++;
+    }
+    if (hdfs_handle->reader_count == 0 && hdfs_handle->read_threads > 0) {
+        globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,
+            "No reader threads available; reading from HDFS in the callbacks.\n");
+    }
+}
+
+/*************************************************************************
+ *  hdfs_stop_readers
+ *  -----------------
+ *  Tell the reader threads to exit; with wait set, also wait for them to
+ *  do so.  Only hdfs_destroy waits: the last read may finish the
+ *  transfer from a reader thread itself.
+ *  Must be called with the hdfs_handle mutex held.
+ ************************************************************************/
+void
+hdfs_stop_readers(hdfs_handle_t * hdfs_handle, globus_bool_t wait) {
+    hdfs_handle->reader_stop = GLOBUS_TRUE;
+    globus_cond_broadcast(&hdfs_handle->reader_cond);
+    while (wait && hdfs_handle->reader_count > 0) {
+        globus_cond_wait(&hdfs_handle->reader_cond, hdfs_handle->mutex);
+    }
+}
+
 /*************************************************************************
  *  send
  *  ----
@@ -89,6 +201,7 @@ hdfs_send(
     globus_l_gfs_hdfs_handle_t *       hdfs_handle;
     GlobusGFSName(globus_l_gfs_hdfs_send);
     globus_result_t                     rc = GLOBUS_SUCCESS;
+    char                                mode;
 
 
     hdfs_handle = (globus_l_gfs_hdfs_handle_t *) user_arg;
@@ -105,11 +218,12 @@ hdfs_send(
     hdfs_handle->outstanding = 0;
     hdfs_handle->done = 0;
     hdfs_handle->done_status = GLOBUS_SUCCESS;
-    hdfs_handle->buffer_count = 0;
-    hdfs_handle->buffer = NULL;
-    hdfs_handle->offsets = NULL;
-    hdfs_handle->nbytes = NULL;
-    hdfs_handle->used = NULL;
+    hdfs_handle->sent_finish = GLOBUS_FALSE;
+    hdfs_handle->reads_in_flight = 0;
+    hdfs_handle->read_free = NULL;
+    hdfs_handle->hdfs_block_size = 0;
+    globus_fifo_init(&hdfs_handle->read_queue);
+    globus_priority_q_init(&hdfs_handle->read_done, hdfs_read_block_cmp);
 
     globus_gridftp_server_get_block_size(op, &hdfs_handle->block_size);
 
@@ -120,20 +234,28 @@ hdfs_send(
         "Operation starting at %d, length %d\n", hdfs_handle->offset,
         hdfs_handle->op_length);
 
+    globus_gridftp_server_get_data_mode(op, &mode);
+    hdfs_handle->send_ordered = (mode != 'E');
+    hdfs_handle->send_offset = hdfs_handle->offset;
+
     globus_gridftp_server_begin_transfer(hdfs_handle->op, 0, hdfs_handle);
 
     if (hdfsExists(hdfs_handle->fs, hdfs_handle->pathname) == 0) {
         hdfsFileInfo *fileInfo;
-        int hasStat = 1;
 
-        if((fileInfo = hdfsGetPathInfo(hdfs_handle->fs, hdfs_handle->pathname)) == NULL)
-            hasStat = 0;
+        if((fileInfo = hdfsGetPathInfo(hdfs_handle->fs, hdfs_handle->pathname)) == NULL) {
+            SystemError(hdfs_handle, "stat of file for read", rc);
+            goto cleanup;
+        }
 
-        if (hasStat && fileInfo->mKind == kObjectKindDirectory) {
+        if (fileInfo->mKind == kObjectKindDirectory) {
+            hdfsFreeFileInfo(fileInfo, 1);
             GenericError(hdfs_handle, "The file you are trying to read is a directory", rc)
             goto cleanup;
         }
         hdfs_handle->file_size = fileInfo->mSize;
+        hdfs_handle->hdfs_block_size = fileInfo->mBlockSize;
+        hdfsFreeFileInfo(fileInfo, 1);
     } else {
         errno = ENOENT;
         SystemError(hdfs_handle, "opening file for read", rc);
@@ -156,10 +278,7 @@ hdfs_send(
         goto cleanup;
     }
 
-    if (hdfsSeek(hdfs_handle->fs, hdfs_handle->fd, hdfs_handle->offset) == -1) {
-        GenericError(hdfs_handle, "seek() fail", rc);
-    }
-
+    hdfs_start_readers(hdfs_handle);
     hdfs_dispatch_read(hdfs_handle);
 
 cleanup:
@@ -167,13 +286,119 @@ cleanup:
     if (rc != GLOBUS_SUCCESS) {
         globus_gfs_log_message(GLOBUS_GFS_LOG_ERR, "Failed to initialize read setup");
         set_done(hdfs_handle, rc);
+        close_and_clean(hdfs_handle, rc);
         globus_gridftp_server_finished_transfer(op, rc);
+        hdfs_handle->sent_finish = GLOBUS_TRUE;
     }
 
     globus_mutex_unlock(hdfs_handle->mutex);
 
 }
 
+/*************************************************************************
+ *  hdfs_finish_block
+ *  -----------------
+ *  Retire a block once the client has it, or once it has failed, and
+ *  decide whether to read more, finish the transfer or wait.
+ *  Note: The hdfs_handle mutex *must* be locked prior to calling
+ ************************************************************************/
+static void
+hdfs_finish_block(
+    hdfs_handle_t *                     hdfs_handle,
+    hdfs_read_block_t *                 block,
+    globus_result_t                     rc)
+{
+    if (rc != GLOBUS_SUCCESS) {
+        set_done(hdfs_handle, rc);
+    }
+
+    hdfs_put_read_block(hdfs_handle, block);
+    hdfs_handle->outstanding--;
+
+    // After a failure, blocks waiting for their turn will never be sent.
+    if (is_done(hdfs_handle) && (hdfs_handle->done_status != GLOBUS_SUCCESS)) {
+        while ((block = globus_priority_q_dequeue(&hdfs_handle->read_done)) != NULL) {
+            hdfs_put_read_block(hdfs_handle, block);
+            hdfs_handle->outstanding--;
+        }
+    }
+
+    if (!is_done(hdfs_handle)) {
+        hdfs_dispatch_read(hdfs_handle);
+    } else if (hdfs_handle->outstanding == 0) {
+        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Transfer has finished!\n");
+        rc = close_and_clean(hdfs_handle, hdfs_handle->done_status);
+        if (!hdfs_handle->sent_finish) {
+            globus_gridftp_server_finished_transfer(hdfs_handle->op, rc);
+            hdfs_handle->sent_finish = GLOBUS_TRUE;
+        }
+    } else if (rc != GLOBUS_SUCCESS) {
+        // Don't close the file because the other transfers will want to finish up.
+        // However, do set the failure status.
+        globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,
+            "We failed to finish the transfer, but there are %i outstanding reads left over.\n",
+            hdfs_handle->outstanding);
+        if (!hdfs_handle->sent_finish) {
+            globus_gridftp_server_finished_transfer(hdfs_handle->op, rc);
+            hdfs_handle->sent_finish = GLOBUS_TRUE;
+        }
+    } else {
+        // Nothing to do if we are done and there was no error, but outstanding transfers exist.
+        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP,
+            "Transfer finished successfully; %i outstanding reads left over.\n", hdfs_handle->outstanding);
+        // Note we do NOT call globus_gridftp_server_finished_transfer yet!
+    }
+}
+
+/*************************************************************************
+ *  hdfs_send_block
+ *  ---------------
+ *  Pass a block that has been read to the data channel.  In stream mode,
+ *  hold it until every block before it has been passed on.
+ *  Note: The hdfs_handle mutex *must* be locked prior to calling
+ ************************************************************************/
+static void
+hdfs_send_block(
+    hdfs_handle_t *                     hdfs_handle,
+    hdfs_read_block_t *                 block)
+{
+    globus_result_t rc;
+
+    if (hdfs_handle->send_ordered) {
+        globus_priority_q_enqueue(&hdfs_handle->read_done, block, &block->offset);
+        block = globus_priority_q_first(&hdfs_handle->read_done);
+        if (block == NULL || block->offset != hdfs_handle->send_offset) {
+            return;
+        }
+        globus_priority_q_dequeue(&hdfs_handle->read_done);
+    }
+
+    while (block != NULL) {
+        // When the write to the network is finished, hdfs_finish_read_cb will be called.
+        rc = globus_gridftp_server_register_write(hdfs_handle->op,
+            block->buffer,
+            block->nbytes,
+            block->offset,
+            -1, // Stripe index
+            hdfs_finish_read_cb,
+            block);
+        if (rc != GLOBUS_SUCCESS) {
+            globus_gfs_log_message(GLOBUS_GFS_LOG_ERR, "Failed to create callback\n");
+            hdfs_finish_block(hdfs_handle, block, rc);
+            return;
+        }
+        if (!hdfs_handle->send_ordered) {
+            return;
+        }
+        hdfs_handle->send_offset += block->nbytes;
+        block = globus_priority_q_first(&hdfs_handle->read_done);
+        if (block == NULL || block->offset != hdfs_handle->send_offset) {
+            return;
+        }
+        globus_priority_q_dequeue(&hdfs_handle->read_done);
+    }
+}
+
 // Allow injection of garbage errors, allowing us to test error-handling
 //#define FAKE_ERROR
 #ifdef FAKE_ERROR
@@ -189,19 +414,19 @@ hdfs_finish_read_cb(
     void *                              user_arg)
 {
     GlobusGFSName(hdfs_handle_read_cb);
+    hdfs_read_block_t *block = (hdfs_read_block_t *) user_arg;
     globus_l_gfs_hdfs_handle_t *      hdfs_handle;
     globus_result_t rc = GLOBUS_SUCCESS;
-    globus_ssize_t idx = -1;
 
-    hdfs_handle = (globus_l_gfs_hdfs_handle_t *) user_arg;
+    hdfs_handle = block->hdfs_handle;
     globus_mutex_lock(hdfs_handle->mutex);
 
-#ifdef FAKE_ERROR 
+#ifdef FAKE_ERROR
     block_count ++;
     if (block_count == 30) {
         GenericError(hdfs_handle, "Got bored, threw an error.", rc);
         goto cleanup;
-    }   
+    }
 #endif
 
     // Various short-circuit routines
@@ -214,19 +439,8 @@ hdfs_finish_read_cb(
         rc = result;
         goto cleanup;
     }
-    if (nbytes == 0) {
-        rc = result;
-        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Read of size zero.\n");
-        goto cleanup;
-    }
-
-    // Determine the idx of the buffer.
-    idx = find_buffer(hdfs_handle, buffer);
-    if (idx < 0) {
-        GenericError(hdfs_handle, "Unknown read operation", rc)
-        goto cleanup;
-    }
-    globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Finishing read op from buffer %d.\n", idx);
+    globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Finishing read op at offset %lld.\n",
+        (long long)block->offset);
 
     // Do statistics
     if (hdfs_handle->syslog_host != NULL) {
@@ -244,127 +458,70 @@ hdfs_finish_read_cb(
     }
 
 cleanup:
-    if (rc != GLOBUS_SUCCESS) {
-        set_done(hdfs_handle, rc);
-    }
-
-    disgard_buffer(hdfs_handle, idx);
-
-    hdfs_handle->outstanding--;
-    if (!is_done(hdfs_handle)) {
-        hdfs_dispatch_read(hdfs_handle);
-    } else if (hdfs_handle->outstanding == 0) {
-        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Transfer has finished!\n");
-        rc = close_and_clean(hdfs_handle, rc);
-        globus_gridftp_server_finished_transfer(hdfs_handle->op, rc);
-        
-    } else if (rc != GLOBUS_SUCCESS) {
-        // Don't close the file because the other transfers will want to finish up.
-        // However, do set the failure status.
-        globus_gfs_log_message(GLOBUS_GFS_LOG_INFO,
-            "We failed to finish the transfer, but there are %i outstanding reads left over.\n",
-            hdfs_handle->outstanding);
-        globus_gridftp_server_finished_transfer(op, rc);
-    } else {
-        // Nothing to do if we are done and there was no error, but outstanding transfers exist.
-        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP,
-            "Transfer finished successfully; %i outstanding reads left over.\n", hdfs_handle->outstanding);
-        // Note we do NOT call globus_gridftp_server_finished_transfer yet!
-    }
+    hdfs_finish_block(hdfs_handle, block, rc);
     globus_mutex_unlock(hdfs_handle->mutex);
 
 }
 
+/*************************************************************************
+ *  hdfs_perform_read_cb
+ *  --------------------
+ *  Read one block from HDFS.  Runs in a reader thread, or as a globus
+ *  callback when there are none, without the hdfs_handle mutex.
+ ************************************************************************/
 static void
 hdfs_perform_read_cb(
     void *                              user_arg)
 {
     GlobusGFSName(hdfs_perform_read_cb);
-    hdfs_read_t *read_op = (hdfs_read_t*) user_arg;
-    hdfs_handle_t *hdfs_handle = read_op->hdfs_handle;
-    globus_size_t idx = read_op->idx;
-    //globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Starting read for buffer %u.\n", idx);
+    hdfs_read_block_t *block = (hdfs_read_block_t *) user_arg;
+    hdfs_handle_t *hdfs_handle = block->hdfs_handle;
     globus_result_t rc = GLOBUS_SUCCESS;
-    globus_size_t read_length, remaining_read;
-    globus_off_t offset, cur_offset;
     globus_ssize_t nbytes;
 
-    offset = hdfs_handle->offsets[idx];
-    read_length = hdfs_handle->nbytes[idx];
-    globus_byte_t *buffer_pos = hdfs_handle->buffer + idx*hdfs_handle->block_size;
-    globus_byte_t *cur_buffer_pos = buffer_pos;
+    block->nbytes = 0;
 
     // Check to see if we can short-circuit
     globus_bool_t short_circuit = GLOBUS_FALSE;
     globus_mutex_lock(hdfs_handle->mutex);
     if (is_done(hdfs_handle) && (hdfs_handle->done_status != GLOBUS_SUCCESS)) {
         short_circuit = GLOBUS_TRUE;
+        rc = hdfs_handle->done_status;
     }
     globus_mutex_unlock(hdfs_handle->mutex);
-    if (short_circuit) {
-        goto cleanup;
+
+    if (!short_circuit && hdfs_handle->syslog_host != NULL) {
+        syslog(LOG_INFO, hdfs_handle->syslog_msg, "READ", block->length, block->offset);
     }
 
-    if (hdfs_handle->syslog_host != NULL) {
-        syslog(LOG_INFO, hdfs_handle->syslog_msg, "READ", read_length, hdfs_handle->io_count);
-    }
-    //globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP,
-    //    "hdfs_perform_read_cb for %u@%lu.\n", read_length, offset);
-
-    remaining_read = read_length;
-    cur_offset = offset;
-    while (remaining_read != 0) {
-       nbytes = hdfsPread(hdfs_handle->fs, hdfs_handle->fd, cur_offset, cur_buffer_pos, remaining_read);
-       if (nbytes == 0) {    /* eof */
-           // No error
-           globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "hdfs_perform_read_cb EOF.\n");
-           globus_mutex_lock(hdfs_handle->mutex);
-           set_done(hdfs_handle, GLOBUS_SUCCESS);
-           globus_mutex_unlock(hdfs_handle->mutex);
+    while (!short_circuit && block->nbytes != block->length) {
+       nbytes = hdfsPread(hdfs_handle->fs, hdfs_handle->fd,
+           block->offset + block->nbytes,
+           block->buffer + block->nbytes,
+           block->length - block->nbytes);
+       if (nbytes == 0) {
+           // The read is within the size we found when opening the file.
+           GenericError(hdfs_handle, "File became shorter while being read", rc)
            break;
        } else if (nbytes == -1) {
            SystemError(hdfs_handle, "reading from HDFS", rc)
-           goto cleanup;
+           break;
        }
-       //globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Read size %d of %d requested\n", nbytes, remaining_read);
-       remaining_read -= nbytes;
-       cur_buffer_pos += nbytes;
-       cur_offset += nbytes;
+       block->nbytes += nbytes;
     }
 
-    //globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Read length: %d; remaining: %d\n", read_length, remaining_read);
-    if (read_length != remaining_read) {
-        // If we read anything at all, write it out to the client.
-        // When the write to the network is finished, hdfs_finish_read_cb will be called.
-        rc = globus_gridftp_server_register_write(hdfs_handle->op,
-            buffer_pos,
-            read_length - remaining_read,
-            offset,
-            -1, // Stripe index
-            hdfs_finish_read_cb,
-            hdfs_handle);
-        if (rc != GLOBUS_SUCCESS) {
-            globus_gfs_log_message(GLOBUS_GFS_LOG_ERR, "Failed to create callback\n");
-            goto cleanup;
-        }
+    globus_mutex_lock(hdfs_handle->mutex);
+    hdfs_handle->reads_in_flight--;
+    if (rc != GLOBUS_SUCCESS) {
+        hdfs_finish_block(hdfs_handle, block, rc);
     } else {
-        //globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Zero-length read; call finish_read_cb directly.\n");
-        hdfs_finish_read_cb(hdfs_handle->op, rc, NULL, 0, (void*)hdfs_handle);
-    }
-
-cleanup:
-
-    free(read_op);
-
-    if (short_circuit || (rc != GLOBUS_SUCCESS)) {
-        globus_mutex_lock(hdfs_handle->mutex);
-        set_done(hdfs_handle, rc);
-        globus_mutex_unlock(hdfs_handle->mutex);
-        //globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Short-circuit read.\n");
-        // Call finish_read_op directly.
-        hdfs_finish_read_cb(hdfs_handle->op, rc, buffer_pos,
-            read_length, (void*)hdfs_handle);
+        hdfs_send_block(hdfs_handle, block);
+        // A reader is free; keep the pipeline full.
+        if (!is_done(hdfs_handle)) {
+            hdfs_dispatch_read(hdfs_handle);
+        }
     }
+    globus_mutex_unlock(hdfs_handle->mutex);
 }
 
 // Must be called with hdfs_handle->mutex LOCKED!
@@ -372,21 +529,33 @@ static void
 hdfs_dispatch_read(
     globus_l_gfs_hdfs_handle_t *      hdfs_handle)
 {
-    globus_size_t read_length, idx;
+    globus_size_t read_length;
+    globus_off_t boundary;
     globus_result_t rc = GLOBUS_SUCCESS;
-    hdfs_read_t *hdfs_read_handle;
+    hdfs_read_block_t *block;
+    unsigned int max_reads, max_outstanding;
 
     GlobusGFSName(hdfs_dispatch_read);
 
     globus_gridftp_server_get_optimal_concurrency(hdfs_handle->op,
                                                   &hdfs_handle->optimal_count);
 
-    // Verify we have sufficient buffer space.
-    if ((rc = allocate_buffers(hdfs_handle, hdfs_handle->optimal_count)) != GLOBUS_SUCCESS) {
-        goto cleanup;
+    // With reader threads, keep one read in flight per thread, plus enough
+    // finished blocks to keep the data channel busy.  Without, the
+    // callbacks read as many blocks as the data channel takes at once.
+    if (hdfs_handle->reader_count > 0) {
+        max_reads = hdfs_handle->reader_count;
+        max_outstanding = hdfs_handle->optimal_count + hdfs_handle->reader_count;
+    } else {
+        max_reads = hdfs_handle->optimal_count;
+        max_outstanding = hdfs_handle->optimal_count;
+    }
+    if (max_outstanding > hdfs_handle->max_buffer_count) {
+        max_outstanding = hdfs_handle->max_buffer_count;
     }
 
-    while ((hdfs_handle->outstanding < hdfs_handle->optimal_count) && !is_done(hdfs_handle)) {
+    while ((hdfs_handle->reads_in_flight < max_reads) &&
+            (hdfs_handle->outstanding < max_outstanding) && !is_done(hdfs_handle)) {
         // Determine the size of this read operation.
         read_length = hdfs_handle->block_size;
         if ((hdfs_handle->op_length != -1)
@@ -397,6 +566,14 @@ hdfs_dispatch_read(
         {
             read_length = hdfs_handle->file_size - hdfs_handle->offset;
         }
+        // Stop at the end of the HDFS block, so each read goes to one datanode.
+        if (hdfs_handle->hdfs_block_size > 0) {
+            boundary = (hdfs_handle->offset / hdfs_handle->hdfs_block_size + 1) *
+                hdfs_handle->hdfs_block_size;
+            if (hdfs_handle->offset + read_length > boundary) {
+                read_length = boundary - hdfs_handle->offset;
+            }
+        }
 
         // Short-circuit the case where we are done
         if (read_length == 0) {
@@ -404,47 +581,49 @@ hdfs_dispatch_read(
             break;
         }
 
-        // Determine a buffer for this read to use.
-        if ((idx = find_empty_buffer(hdfs_handle)) < 0) {
-            GenericError(hdfs_handle, "Ran out of buffer space", rc)
-            break;
-        }
-
-        // Record the offset and buffer length
-        hdfs_handle->nbytes[idx] = read_length;
-        hdfs_handle->offsets[idx] = hdfs_handle->offset;
-
-        if ((hdfs_read_handle = globus_malloc(sizeof(hdfs_read_t))) == NULL) {
-            MemoryError(hdfs_handle, "Unable to allocate read handle", rc)
+        if ((block = hdfs_get_read_block(hdfs_handle)) == NULL) {
+            MemoryError(hdfs_handle, "Unable to allocate read buffer", rc)
             break;
         }
-        hdfs_read_handle->idx = idx;
-        hdfs_read_handle->hdfs_handle = hdfs_handle;
-
-        rc = globus_callback_register_oneshot(
-            NULL,
-            NULL,
-            hdfs_perform_read_cb,
-            hdfs_read_handle);
+        block->offset = hdfs_handle->offset;
+        block->length = read_length;
+        block->nbytes = 0;
 
-        if (rc != GLOBUS_SUCCESS) {
-            globus_gfs_log_message(GLOBUS_GFS_LOG_ERR, "Failed to create callback\n");
-            break;
+        if (hdfs_handle->reader_count > 0) {
+            globus_fifo_enqueue(&hdfs_handle->read_queue, block);
+            globus_cond_signal(&hdfs_handle->reader_cond);
+        } else {
+            rc = globus_callback_register_oneshot(
+                NULL,
+                NULL,
+                hdfs_perform_read_cb,
+                block);
+            if (rc != GLOBUS_SUCCESS) {
+                globus_gfs_log_message(GLOBUS_GFS_LOG_ERR, "Failed to create callback\n");
+                hdfs_put_read_block(hdfs_handle, block);
+                break;
+            }
         }
         hdfs_handle->outstanding++;
-        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Issued read from buffer %u (outstanding=%u).\n", idx, hdfs_handle->outstanding);
+        hdfs_handle->reads_in_flight++;
+        globus_gfs_log_message(GLOBUS_GFS_LOG_DUMP, "Issued read at %lld (outstanding=%u).\n",
+            (long long)block->offset, hdfs_handle->outstanding);
 
         hdfs_handle->offset += read_length;
-        if (hdfs_handle->op_length != -1) { 
+        if (hdfs_handle->op_length != -1) {
             hdfs_handle->op_length -= read_length;
         }
     }
 
-cleanup:
     if (rc != GLOBUS_SUCCESS) {
         set_done(hdfs_handle, rc);
-        globus_gridftp_server_finished_transfer(hdfs_handle->op, rc);
+        if (hdfs_handle->outstanding == 0) {
+            close_and_clean(hdfs_handle, rc);
+        }
+        if (!hdfs_handle->sent_finish) {
+            globus_gridftp_server_finished_transfer(hdfs_handle->op, rc);
+            hdfs_handle->sent_finish = GLOBUS_TRUE;
+        }
     }
 
 }
-
@@ -0,0 +1,76 @@
+/**
+ * The subset of the libhdfs API used by GridFTP-HDFS, as implemented by
+ * hdfs_stub.c on top of a local directory.  Only used when configured
+ * with --with-hdfs-stub; otherwise hdfs.h comes from Hadoop.
+ */
+
+#ifndef LIBHDFS_HDFS_H
+#define LIBHDFS_HDFS_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef EINTERNAL
+#define EINTERNAL 255
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t   tSize;
+typedef time_t    tTime;
+typedef int64_t   tOffset;
+typedef uint16_t  tPort;
+
+typedef enum tObjectKind {
+    kObjectKindFile = 'F',
+    kObjectKindDirectory = 'D',
+} tObjectKind;
+
+struct hdfs_internal;
+typedef struct hdfs_internal* hdfsFS;
+
+struct hdfsFile_internal;
+typedef struct hdfsFile_internal* hdfsFile;
+
+typedef struct {
+    tObjectKind mKind;
+    char *mName;
+    tTime mLastMod;
+    tOffset mSize;
+    short mReplication;
+    tOffset mBlockSize;
+    char *mOwner;
+    char *mGroup;
+    short mPermissions;
+    tTime mLastAccess;
+} hdfsFileInfo;
+
+hdfsFS hdfsConnect(const char* host, tPort port);
+hdfsFS hdfsConnectAsUser(const char* host, tPort port, const char *user);
+int hdfsDisconnect(hdfsFS fs);
+
+hdfsFile hdfsOpenFile(hdfsFS fs, const char* path, int flags,
+                      int bufferSize, short replication, tSize blocksize);
+int hdfsCloseFile(hdfsFS fs, hdfsFile file);
+int hdfsExists(hdfsFS fs, const char *path);
+int hdfsSeek(hdfsFS fs, hdfsFile file, tOffset desiredPos);
+tSize hdfsRead(hdfsFS fs, hdfsFile file, void* buffer, tSize length);
+tSize hdfsPread(hdfsFS fs, hdfsFile file, tOffset position,
+                void* buffer, tSize length);
+tSize hdfsWrite(hdfsFS fs, hdfsFile file, const void* buffer, tSize length);
+
+int hdfsCreateDirectory(hdfsFS fs, const char* path);
+int hdfsDelete(hdfsFS fs, const char* path, int recursive);
+hdfsFileInfo *hdfsListDirectory(hdfsFS fs, const char* path, int *numEntries);
+hdfsFileInfo *hdfsGetPathInfo(hdfsFS fs, const char* path);
+void hdfsFreeFileInfo(hdfsFileInfo *hdfsFileInfo, int numEntries);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBHDFS_HDFS_H */
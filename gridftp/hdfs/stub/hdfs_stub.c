@@ -0,0 +1,441 @@
+
+/**
+ * A stand-in for libhdfs that keeps the "HDFS" namespace in a local
+ * directory, so GridFTP-HDFS can be run and benchmarked without a Hadoop
+ * cluster or a JVM.  Configure with --with-hdfs-stub and load the DSI as
+ * usual; the following environment variables control the stub:
+ *
+ *   GRIDFTP_HDFS_STUB_ROOT        Directory holding the namespace
+ *                                 (default /tmp/hdfs-stub).
+ *   GRIDFTP_HDFS_STUB_WRITE_USEC  Delay added to every hdfsWrite, to
+ *                                 stand in for the datanode pipeline.
+ *   GRIDFTP_HDFS_STUB_READ_USEC   Delay added to every hdfsRead and
+ *                                 hdfsPread.  Delays overlap between
+ *                                 threads, as datanode round trips do.
+ *   GRIDFTP_HDFS_STUB_BLOCK_SIZE  Block size reported for files
+ *                                 (default 128MB).
+ *
+ * Like HDFS, files opened for writing can only be appended to.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <limits.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "hdfs.h"
+
+struct hdfs_internal
+{
+    char *      root;
+    useconds_t  write_delay;
+    useconds_t  read_delay;
+    tOffset     block_size;
+};
+
+struct hdfsFile_internal
+{
+    int         fd;
+    int         flags;
+};
+
+static useconds_t
+stub_delay(const char * name)
+{
+    const char * value = getenv(name);
+
+    return value ? (useconds_t) strtoul(value, NULL, 10) : 0;
+}
+
+static char *
+stub_path(hdfsFS fs, const char * path)
+{
+    char * full;
+
+    while (path[0] == '/')
+    {
+        path++;
+    }
+    if (asprintf(&full, "%s/%s", fs->root, path) < 0)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return full;
+}
+
+static int
+stub_mkdirs(char * path)
+{
+    char * slash;
+
+    for (slash = strchr(path + 1, '/'); slash; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        if (mkdir(path, 0755) == -1 && errno != EEXIST)
+        {
+            *slash = '/';
+            return -1;
+        }
+        *slash = '/';
+    }
+    if (mkdir(path, 0755) == -1 && errno != EEXIST)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+hdfsFS
+hdfsConnectAsUser(const char * host, tPort port, const char * user)
+{
+    const char * root = getenv("GRIDFTP_HDFS_STUB_ROOT");
+    const char * block_size;
+    hdfsFS fs;
+
+    fs = calloc(1, sizeof(struct hdfs_internal));
+    if (fs == NULL)
+    {
+        return NULL;
+    }
+    fs->root = strdup(root ? root : "/tmp/hdfs-stub");
+    if (fs->root == NULL || stub_mkdirs(fs->root) == -1)
+    {
+        free(fs->root);
+        free(fs);
+        return NULL;
+    }
+    fs->write_delay = stub_delay("GRIDFTP_HDFS_STUB_WRITE_USEC");
+    fs->read_delay = stub_delay("GRIDFTP_HDFS_STUB_READ_USEC");
+    block_size = getenv("GRIDFTP_HDFS_STUB_BLOCK_SIZE");
+    fs->block_size = block_size ? strtoll(block_size, NULL, 10) : 0;
+    if (fs->block_size <= 0)
+    {
+        fs->block_size = 128 * 1024 * 1024;
+    }
+
+    return fs;
+}
+
+hdfsFS
+hdfsConnect(const char * host, tPort port)
+{
+    return hdfsConnectAsUser(host, port, NULL);
+}
+
+int
+hdfsDisconnect(hdfsFS fs)
+{
+    free(fs->root);
+    free(fs);
+    return 0;
+}
+
+hdfsFile
+hdfsOpenFile(
+    hdfsFS fs, const char * path, int flags,
+    int bufferSize, short replication, tSize blocksize)
+{
+    hdfsFile file;
+    char * full;
+    int fd;
+
+    full = stub_path(fs, path);
+    if (full == NULL)
+    {
+        return NULL;
+    }
+    if ((flags & O_ACCMODE) == O_WRONLY)
+    {
+        fd = open(full, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    else
+    {
+        fd = open(full, O_RDONLY);
+    }
+    free(full);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+
+    file = malloc(sizeof(struct hdfsFile_internal));
+    if (file == NULL)
+    {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    file->fd = fd;
+    file->flags = flags & O_ACCMODE;
+
+    return file;
+}
+
+int
+hdfsCloseFile(hdfsFS fs, hdfsFile file)
+{
+    int rc;
+
+    rc = close(file->fd);
+    free(file);
+
+    return rc == 0 ? 0 : -1;
+}
+
+int
+hdfsExists(hdfsFS fs, const char * path)
+{
+    struct stat st;
+    char * full;
+    int rc;
+
+    full = stub_path(fs, path);
+    if (full == NULL)
+    {
+        return -1;
+    }
+    rc = stat(full, &st);
+    free(full);
+
+    return rc == 0 ? 0 : -1;
+}
+
+int
+hdfsSeek(hdfsFS fs, hdfsFile file, tOffset desiredPos)
+{
+    if (file->flags != O_RDONLY)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    return lseek(file->fd, desiredPos, SEEK_SET) == -1 ? -1 : 0;
+}
+
+tSize
+hdfsRead(hdfsFS fs, hdfsFile file, void * buffer, tSize length)
+{
+    if (fs->read_delay)
+    {
+        usleep(fs->read_delay);
+    }
+    return read(file->fd, buffer, length);
+}
+
+tSize
+hdfsPread(
+    hdfsFS fs, hdfsFile file, tOffset position, void * buffer, tSize length)
+{
+    if (fs->read_delay)
+    {
+        usleep(fs->read_delay);
+    }
+    return pread(file->fd, buffer, length, position);
+}
+
+tSize
+hdfsWrite(hdfsFS fs, hdfsFile file, const void * buffer, tSize length)
+{
+    const char * ptr = buffer;
+    ssize_t nbytes;
+    tSize written = 0;
+
+    if (file->flags != O_WRONLY)
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if (fs->write_delay)
+    {
+        usleep(fs->write_delay);
+    }
+    while (written < length)
+    {
+        nbytes = write(file->fd, ptr + written, length - written);
+        if (nbytes < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        written += nbytes;
+    }
+    return written;
+}
+
+int
+hdfsCreateDirectory(hdfsFS fs, const char * path)
+{
+    char * full;
+    int rc;
+
+    full = stub_path(fs, path);
+    if (full == NULL)
+    {
+        return -1;
+    }
+    rc = stub_mkdirs(full);
+    free(full);
+
+    return rc;
+}
+
+int
+hdfsDelete(hdfsFS fs, const char * path, int recursive)
+{
+    char * full;
+    int rc;
+
+    full = stub_path(fs, path);
+    if (full == NULL)
+    {
+        return -1;
+    }
+    rc = remove(full);
+    free(full);
+
+    return rc == 0 ? 0 : -1;
+}
+
+static int
+stub_fill_info(
+    hdfsFS fs, hdfsFileInfo * info, const char * full, const char * name)
+{
+    struct stat st;
+    struct passwd * pw;
+    struct group * gr;
+
+    if (stat(full, &st) == -1)
+    {
+        return -1;
+    }
+    memset(info, 0, sizeof(hdfsFileInfo));
+    info->mKind = S_ISDIR(st.st_mode) ? kObjectKindDirectory : kObjectKindFile;
+    info->mName = strdup(name);
+    info->mLastMod = st.st_mtime;
+    info->mLastAccess = st.st_atime;
+    info->mSize = st.st_size;
+    info->mReplication = 1;
+    info->mBlockSize = fs->block_size;
+    info->mPermissions = st.st_mode & 0777;
+    pw = getpwuid(st.st_uid);
+    info->mOwner = strdup(pw ? pw->pw_name : "nobody");
+    gr = getgrgid(st.st_gid);
+    info->mGroup = strdup(gr ? gr->gr_name : "nobody");
+
+    return 0;
+}
+
+hdfsFileInfo *
+hdfsGetPathInfo(hdfsFS fs, const char * path)
+{
+    hdfsFileInfo * info;
+    char * full;
+
+    full = stub_path(fs, path);
+    if (full == NULL)
+    {
+        return NULL;
+    }
+    info = malloc(sizeof(hdfsFileInfo));
+    if (info == NULL || stub_fill_info(fs, info, full, path) == -1)
+    {
+        free(info);
+        info = NULL;
+    }
+    free(full);
+
+    return info;
+}
+
+hdfsFileInfo *
+hdfsListDirectory(hdfsFS fs, const char * path, int * numEntries)
+{
+    hdfsFileInfo * infos = NULL;
+    hdfsFileInfo * tmp;
+    struct dirent * entry;
+    char * full;
+    char * child;
+    char * name;
+    DIR * dir;
+    int count = 0;
+
+    *numEntries = 0;
+    full = stub_path(fs, path);
+    if (full == NULL)
+    {
+        return NULL;
+    }
+    dir = opendir(full);
+    if (dir == NULL)
+    {
+        free(full);
+        return NULL;
+    }
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+        {
+            continue;
+        }
+        tmp = realloc(infos, (count + 1) * sizeof(hdfsFileInfo));
+        if (tmp == NULL)
+        {
+            break;
+        }
+        infos = tmp;
+        if (asprintf(&child, "%s/%s", full, entry->d_name) < 0)
+        {
+            break;
+        }
+        if (asprintf(&name, "%s/%s", path, entry->d_name) < 0)
+        {
+            free(child);
+            break;
+        }
+        if (stub_fill_info(fs, &infos[count], child, name) == 0)
+        {
+            count++;
+        }
+        free(child);
+        free(name);
+    }
+    closedir(dir);
+    free(full);
+
+    /* an empty directory is a NULL list with errno clear */
+    errno = 0;
+    if (count == 0)
+    {
+        free(infos);
+        return NULL;
+    }
+    *numEntries = count;
+
+    return infos;
+}
+
+void
+hdfsFreeFileInfo(hdfsFileInfo * hdfsFileInfo, int numEntries)
+{
+    int i;
+
+    for (i = 0; i < numEntries; i++)
+    {
+        free(hdfsFileInfo[i].mName);
+        free(hdfsFileInfo[i].mOwner);
+        free(hdfsFileInfo[i].mGroup);
+    }
+    free(hdfsFileInfo);
+}
@@ -201,6 +201,7 @@ typedef struct globus_l_gsc_reply_ent_s
 typedef struct globus_l_libc_cached_pwent_s
 {
     struct passwd                       pw;
+    globus_bool_t                       found;
     char                                buffer[GSU_MAX_PW_LENGTH];
 } globus_l_libc_cached_pwent_t;
 
@@ -289,6 +290,7 @@ static globus_xio_driver_t              globus_l_gsc_gssapi_ftp_driver;
 static globus_xio_driver_t              globus_l_gsc_telnet_driver;
 static globus_hashtable_t               globus_l_gsc_pwent_cache;
 static globus_hashtable_t               globus_l_gsc_grent_cache;
+static globus_mutex_t                   globus_l_gsc_ent_cache_lock;
 static int                              globus_l_gsc_max_read_q = 
                                             DEFAULT_MAX_Q_LEN;
 
@@ -367,6 +369,7 @@ globus_l_gsc_activate()
         128,
         globus_hashtable_ulong_hash,
         globus_hashtable_ulong_keyeq);
+    globus_mutex_init(&globus_l_gsc_ent_cache_lock, NULL);
 
     return rc;
 }
@@ -376,7 +379,7 @@ void
 globus_l_gsc_pwent_hash_destroy(
     void *                              arg)
 {
-    /* right now this is just to get around the assertion */
+    globus_free(arg);
 }
 
 static
@@ -404,6 +407,7 @@ globus_l_gsc_deactivate()
         &globus_l_gsc_pwent_cache, globus_l_gsc_pwent_hash_destroy);
     globus_hashtable_destroy_all(
         &globus_l_gsc_grent_cache, globus_l_gsc_grent_hash_destroy);
+    globus_mutex_destroy(&globus_l_gsc_ent_cache_lock);
 
     globus_xio_driver_unload(globus_l_gsc_tcp_driver);
     globus_xio_driver_unload(globus_l_gsc_gsi_driver);
@@ -3032,6 +3036,8 @@ globus_gridftp_server_control_start(
     server_handle->opts.restart_frequency = 5;
     server_handle->opts.receive_buf = 0;
     server_handle->opts.parallelism = 1;
+    server_handle->opts.parallelism_min = 1;
+    server_handle->opts.parallelism_max = 1;
     server_handle->opts.packet_size = 0;
     server_handle->opts.delayed_passive = GLOBUS_FALSE;
     server_handle->opts.passive_only = GLOBUS_FALSE;
@@ -3827,6 +3833,12 @@ globus_l_gsc_mlsx_urlencode(
     GlobusGridFTPServerDebugInternalExit();
 }
 
+/*
+ * uid/gid name lookups for listings.  entries are never removed, so the
+ * returned pointers stay valid until deactivate.  misses are cached too,
+ * otherwise every entry owned by an unknown id in a large directory costs
+ * another trip through nss.
+ */
 static
 struct passwd *
 globus_libc_cached_getpwuid(
@@ -3837,6 +3849,7 @@ globus_libc_cached_getpwuid(
     globus_l_libc_cached_pwent_t *      pwent;
     int                                 rc;
     
+    globus_mutex_lock(&globus_l_gsc_ent_cache_lock);
     /* XXX TODO make proper function in globus_libc */
     pwent = (globus_l_libc_cached_pwent_t *) globus_hashtable_lookup(
         &globus_l_gsc_pwent_cache, (void *) (intptr_t) uid);
@@ -3844,28 +3857,27 @@ globus_libc_cached_getpwuid(
     if(pwent == NULL)
     {
         pwent = (globus_l_libc_cached_pwent_t *) 
-            globus_calloc(1, sizeof(globus_l_libc_cached_pwent_t));		        rc = globus_libc_getpwuid_r(
-            uid, &pwent->pw, pwent->buffer, GSU_MAX_PW_LENGTH, &result_pw);
-        if(rc != 0 || result_pw == NULL)
-        {
-            goto error_pwent;
-        }
-        if(pwent->pw.pw_uid != uid)
+            globus_calloc(1, sizeof(globus_l_libc_cached_pwent_t));
+        if(pwent == NULL)
         {
-            goto error_pwent;
+            globus_mutex_unlock(&globus_l_gsc_ent_cache_lock);
+            return NULL;
         }
+        rc = globus_libc_getpwuid_r(
+            uid, &pwent->pw, pwent->buffer, GSU_MAX_PW_LENGTH, &result_pw);
+        pwent->found = 
+            (rc == 0 && result_pw != NULL && pwent->pw.pw_uid == uid);
         globus_hashtable_insert(
             &globus_l_gsc_pwent_cache,
-            (void *) (intptr_t) pwent->pw.pw_uid,
+            (void *) (intptr_t) uid,
             pwent);
     }
+    globus_mutex_unlock(&globus_l_gsc_ent_cache_lock);
 
-    return &pwent->pw;
-    
-error_pwent:
-    globus_free(pwent);
-#endif
+    return pwent->found ? &pwent->pw : NULL;
+#else
     return NULL;
+#endif
 }   
 
 static
@@ -3875,8 +3887,8 @@ globus_libc_cached_getgrgid(
 {
     struct group *                      gr;
     struct group *                      grent;
-    char                                name[GSU_MAX_USERNAME_LENGTH];
 
+    globus_mutex_lock(&globus_l_gsc_ent_cache_lock);
     /* XXX TODO make proper function in globus_libc */
     grent = (struct group *) globus_hashtable_lookup(
         &globus_l_gsc_grent_cache, (void *) (intptr_t) gid);
@@ -3884,33 +3896,31 @@ globus_libc_cached_getgrgid(
     if(grent == NULL)
     {
         grent = (struct group *) globus_calloc(1, sizeof(struct group));
+        if(grent == NULL)
+        {
+            globus_mutex_unlock(&globus_l_gsc_ent_cache_lock);
+            return NULL;
+        }
 
+        /* gr_name stays NULL for a gid with no group entry */
+        grent->gr_gid = gid;
         globus_libc_lock();
         gr = getgrgid(gid);
-        if(gr == NULL)
+        if(gr != NULL && gr->gr_gid == gid)
         {
-            goto error_group;
+            grent->gr_name = globus_libc_strdup(gr->gr_name);
         }
-        strncpy(name, gr->gr_name, GSU_MAX_USERNAME_LENGTH);
-        name[GSU_MAX_USERNAME_LENGTH - 1] = '\0';
-        grent->gr_gid = gr->gr_gid;
         /* we don't use other members */
         globus_libc_unlock();
         
-        grent->gr_name = globus_libc_strdup(name);
-        
         globus_hashtable_insert(
             &globus_l_gsc_grent_cache,
-            (void *) (intptr_t) grent->gr_gid,
+            (void *) (intptr_t) gid,
             grent);
     }
+    globus_mutex_unlock(&globus_l_gsc_ent_cache_lock);
 
-    return grent;
-    
-error_group:
-    globus_libc_unlock();
-    globus_free(grent);
-    return NULL;
+    return grent->gr_name ? grent : NULL;
 }   
 
 char *
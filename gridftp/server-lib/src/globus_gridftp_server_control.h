@@ -679,6 +679,15 @@ globus_gridftp_server_control_get_parallelism(
     globus_gridftp_server_control_op_t      op,
     int *                                   out_parallelism);
 
+/* the min and max levels of OPTS RETR Parallelism=; equal to the level
+ * returned by globus_gridftp_server_control_get_parallelism() unless the
+ * client asked for a range */
+globus_result_t
+globus_gridftp_server_control_get_parallelism_range(
+    globus_gridftp_server_control_op_t      op,
+    int *                                   out_min,
+    int *                                   out_max);
+
 globus_result_t
 globus_gridftp_server_control_get_mode(
     globus_gridftp_server_control_op_t      op,
@@ -145,6 +145,30 @@ globus_gridftp_server_control_get_parallelism(
     return GLOBUS_SUCCESS;
 }
 
+globus_result_t
+globus_gridftp_server_control_get_parallelism_range(
+    globus_gridftp_server_control_op_t      op,
+    int *                                   out_min,
+    int *                                   out_max)
+{
+    GlobusGridFTPServerName(
+        globus_gridftp_server_control_get_parallelism_range);
+
+    if(op == NULL)
+    {
+        return GlobusGridFTPServerErrorParameter("op");
+    }
+
+    globus_mutex_lock(&op->server_handle->mutex);
+    {
+        *out_min = op->server_handle->opts.parallelism_min;
+        *out_max = op->server_handle->opts.parallelism_max;
+    }
+    globus_mutex_unlock(&op->server_handle->mutex);
+
+    return GLOBUS_SUCCESS;
+}
+
 globus_result_t
 globus_gridftp_server_control_get_mode(
     globus_gridftp_server_control_op_t      op,
@@ -1352,6 +1352,38 @@ globus_l_gsc_cmd_help(
     globus_i_gsc_command_panic(op);
 }
 
+/*
+ * value of OPTS RETR Parallelism=<start>,<min>,<max>;
+ * a range that does not hold the starting level is treated as a fixed
+ * level, as it always was
+ */
+globus_bool_t
+globus_i_gsc_parse_parallelism(
+    const char *                            value,
+    int *                                   start,
+    int *                                   min,
+    int *                                   max)
+{
+    int                                     tmp_i;
+    int                                     tmp_min;
+    int                                     tmp_max;
+
+    if(sscanf(value, "%d,%d,%d;", &tmp_i, &tmp_min, &tmp_max) != 3)
+    {
+        return GLOBUS_FALSE;
+    }
+    if(tmp_min < 1 || tmp_min > tmp_i || tmp_max < tmp_i)
+    {
+        tmp_min = tmp_i;
+        tmp_max = tmp_i;
+    }
+    *start = tmp_i;
+    *min = tmp_min;
+    *max = tmp_max;
+
+    return GLOBUS_TRUE;
+}
+
 /*
  * opts
  */
@@ -1365,6 +1397,8 @@ globus_l_gsc_cmd_opts(
 {
     globus_bool_t                           done = GLOBUS_FALSE;
     int                                     tmp_i;
+    int                                     tmp_min;
+    int                                     tmp_max;
     char *                                  msg;
     char *                                  tmp_ptr;
     globus_i_gsc_handle_opts_t *            opts;
@@ -1422,9 +1456,12 @@ globus_l_gsc_cmd_opts(
                 strncmp(tmp_ptr, "parallelism=", sizeof("parallelism=")-1) == 0)
             {
                 tmp_ptr += sizeof("parallelism=")-1;
-                if(sscanf(tmp_ptr, "%d,%*d,%*d;", &tmp_i) == 1)
+                if(globus_i_gsc_parse_parallelism(
+                    tmp_ptr, &tmp_i, &tmp_min, &tmp_max))
                 {
                     opts->parallelism = tmp_i;
+                    opts->parallelism_min = tmp_min;
+                    opts->parallelism_max = tmp_max;
                 }
                 else
                 {
@@ -363,12 +363,8 @@ globus_l_gsc_send_restart(
     int                                 size;
     globus_off_t                        offset;
     globus_off_t                        length;
-    globus_range_list_t                 new_range_list;
 
-    globus_range_list_merge(
-        &new_range_list, op->perf_range_list, range_list);
-    globus_range_list_destroy(op->perf_range_list);
-    op->perf_range_list = new_range_list;
+    globus_range_list_merge_into(op->perf_range_list, range_list);
 
     size = globus_range_list_size(range_list);
     if(size < 1)
@@ -220,6 +220,8 @@ typedef struct globus_i_gsc_handle_opts_s
 {
     char                                    mlsx_fact_str[16];
     int                                     parallelism;
+    int                                     parallelism_min;
+    int                                     parallelism_max;
     globus_size_t                           send_buf;
     globus_size_t                           receive_buf;
     globus_bool_t                           refresh;
@@ -508,6 +510,13 @@ globus_i_gsc_get_help(
     globus_i_gsc_server_handle_t *      server_handle,
     const char *                        command_name);
 
+globus_bool_t
+globus_i_gsc_parse_parallelism(
+    const char *                        value,
+    int *                               start,
+    int *                               min,
+    int *                               max);
+
 globus_result_t
 globus_i_gsc_intermediate_reply(
     globus_i_gsc_op_t *                 op,
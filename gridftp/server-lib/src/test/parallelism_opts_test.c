@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "globus_i_gridftp_server_control.h"
+
+typedef struct
+{
+    char *                              value;
+    globus_bool_t                       expect_ok;
+    int                                 start;
+    int                                 min;
+    int                                 max;
+}
+parallelism_test_case_t;
+
+int main()
+{
+    parallelism_test_case_t             test_cases[] =
+    {
+        /* old clients send the starting level three times */
+        { "4,4,4;",     GLOBUS_TRUE,    4, 4, 4 },
+        { "1,1,1;",     GLOBUS_TRUE,    1, 1, 1 },
+        { "4,2,8;",     GLOBUS_TRUE,    4, 2, 8 },
+        { "2,2,8;",     GLOBUS_TRUE,    2, 2, 8 },
+        { "8,2,8;",     GLOBUS_TRUE,    8, 2, 8 },
+        /* ranges that don't hold the start become a fixed level */
+        { "4,5,8;",     GLOBUS_TRUE,    4, 4, 4 },
+        { "4,2,3;",     GLOBUS_TRUE,    4, 4, 4 },
+        { "4,0,8;",     GLOBUS_TRUE,    4, 4, 4 },
+        { "4,-1,8;",    GLOBUS_TRUE,    4, 4, 4 },
+        { "4;",         GLOBUS_FALSE,   0, 0, 0 },
+        { "4,2;",       GLOBUS_FALSE,   0, 0, 0 },
+        { "a,b,c;",     GLOBUS_FALSE,   0, 0, 0 },
+        { "",           GLOBUS_FALSE,   0, 0, 0 }
+    };
+    int                                 test_count;
+    int                                 failed = 0;
+    int                                 start;
+    int                                 min;
+    int                                 max;
+    globus_bool_t                       ok;
+
+    test_count = (int) (sizeof(test_cases)/sizeof(test_cases[0]));
+    printf("1..%d\n", test_count);
+
+    for (int i = 0; i < test_count; i++)
+    {
+        start = min = max = 0;
+        ok = globus_i_gsc_parse_parallelism(
+            test_cases[i].value, &start, &min, &max);
+
+        if (ok != test_cases[i].expect_ok ||
+            (ok && (start != test_cases[i].start ||
+                    min != test_cases[i].min ||
+                    max != test_cases[i].max)))
+        {
+            printf("# got %s %d,%d,%d\n",
+                    ok ? "ok" : "error", start, min, max);
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - Parallelism=%s\n", i+1, test_cases[i].value);
+    }
+
+    return failed;
+}
@@ -89,6 +89,14 @@ static globus_bool_t                    globus_l_gfs_sigint_caught = GLOBUS_FALS
 static char **                          globus_l_gfs_child_argv = NULL;
 static int                              globus_l_gfs_child_argc = 0;
 
+/* worker_processes: the daemon's pool, and what a worker has served */
+static pid_t *                          globus_l_gfs_worker_pids = NULL;
+static time_t *                         globus_l_gfs_worker_started = NULL;
+static int                              globus_l_gfs_worker_count = 0;
+static char **                          globus_l_gfs_worker_argv = NULL;
+static globus_xio_system_socket_t       globus_l_gfs_worker_socket;
+static int                              globus_l_gfs_worker_sessions = 0;
+
 
 #ifndef BUILD_LITE
 #define GLOBUS_L_GFS_SIGCHLD_DELAY 10
@@ -131,6 +139,16 @@ void
 globus_l_gfs_sigchld(
     void *                              user_arg);
 
+static
+void
+globus_l_gfs_signal_workers(
+    int                                 signum);
+
+static
+void
+globus_l_gfs_respawn_workers(
+    pid_t                               exited_pid);
+
 static
 void
 globus_l_gfs_bad_signal_handler(
@@ -247,6 +265,7 @@ globus_l_gfs_sigint(
             globus_i_gfs_ipc_stop();
             if(globus_i_gfs_config_bool("daemon"))
             {
+                globus_l_gfs_signal_workers(SIGINT);
                 globus_l_gfs_sigchld(user_arg);
             }
         }
@@ -278,6 +297,10 @@ globus_l_gfs_sighup(
         GLOBUS_GFS_LOG_INFO, 
         "Done reloading config.\n");           
 
+#ifdef SIGHUP
+    globus_l_gfs_signal_workers(SIGHUP);
+#endif
+
     GlobusGFSDebugExit();
 }
 
@@ -333,10 +356,21 @@ globus_l_gfs_sigchld(
     
         globus_mutex_lock(&globus_l_gfs_mutex);
         {
+            globus_l_gfs_respawn_workers(child_pid);
             globus_i_gfs_connection_closed();
         }
         globus_mutex_unlock(&globus_l_gfs_mutex);   
     }
+
+    if(globus_l_gfs_worker_count > 0)
+    {
+        /* retry any that could not be started last time */
+        globus_mutex_lock(&globus_l_gfs_mutex);
+        {
+            globus_l_gfs_respawn_workers(0);
+        }
+        globus_mutex_unlock(&globus_l_gfs_mutex);   
+    }
 #endif
     GlobusGFSDebugExit();
 }
@@ -559,6 +593,319 @@ error:
     return result;
 }
 
+/*
+ * worker_processes: instead of a process per connection, the daemon starts
+ * a fixed set of workers, each an exec of the server like a forked child
+ * but handed the listening socket instead of a connection.  a worker
+ * accepts for itself and runs every session it accepts on threads in its
+ * own process, so process startup, module activation and configuration
+ * loading are paid once per worker rather than once per session.  sessions
+ * in a worker cannot each setuid, so a worker runs as process_user (or as
+ * whoever started the daemon) and the data layer only records the mapped
+ * user for the session.
+ */
+static
+globus_bool_t
+globus_l_gfs_workers_allowed(void)
+{
+    if(getuid() == 0 && globus_i_gfs_config_string("process_user") == NULL)
+    {
+        globus_gfs_log_message(
+            GLOBUS_GFS_LOG_ERR,
+            "worker_processes requires process_user when running as root.  "
+            "Starting a process per connection instead.\n");
+        return GLOBUS_FALSE;
+    }
+    if(globus_i_gfs_config_string("chroot_path") != NULL)
+    {
+        globus_gfs_log_message(
+            GLOBUS_GFS_LOG_ERR,
+            "worker_processes cannot be used with chroot_path.  "
+            "Starting a process per connection instead.\n");
+        return GLOBUS_FALSE;
+    }
+
+    return GLOBUS_TRUE;
+}
+
+/* called locked */
+static
+globus_result_t
+globus_l_gfs_spawn_worker(
+    int                                 ndx)
+{
+    globus_result_t                     result;
+    pid_t                               child_pid;
+    int                                 rc;
+    GlobusGFSName(globus_l_gfs_spawn_worker);
+    GlobusGFSDebugEnter();
+
+    globus_l_gfs_worker_started[ndx] = time(NULL);
+
+    child_pid = fork();
+    if(child_pid == 0)
+    {
+        /* the listener is close on exec, the dup is not */
+        rc = dup2(globus_l_gfs_worker_socket, STDIN_FILENO);
+        if(rc == -1)
+        {
+            result = GlobusGFSErrorSystemError("dup2", errno);
+            globus_gfs_log_result(
+                GLOBUS_GFS_LOG_ERR, 
+                _GSSL("Could not pass the listener to a worker process"), 
+                result);
+            goto child_error;
+        }
+
+        if(*globus_l_gfs_worker_argv[0] == '/')
+        {
+            rc = execv(globus_l_gfs_worker_argv[0], globus_l_gfs_worker_argv);
+        }
+        else
+        {
+            rc = execvp(globus_l_gfs_worker_argv[0], globus_l_gfs_worker_argv);
+        }
+        if(rc == -1)
+        {
+            char *                      error_msg;
+
+            error_msg = globus_common_create_string("%s\n%s\n%s\n%s",
+                _GSSL("Could not exec worker process."),
+                _GSSL("Please verify that a gridftp server is located at: "),
+                globus_l_gfs_worker_argv[0],
+                _GSSL("Or try the -exec flag."));
+            result = GlobusGFSErrorSystemError("execv", errno);
+            globus_gfs_log_result(GLOBUS_GFS_LOG_ERR, error_msg, result);
+
+            goto child_error;
+        }
+    }
+    else if(child_pid == -1)
+    {
+        result = GlobusGFSErrorSystemError("fork", errno);
+        goto error;
+    }
+
+    globus_l_gfs_worker_pids[ndx] = child_pid;
+    globus_gfs_log_event(
+        GLOBUS_GFS_LOG_INFO,
+        GLOBUS_GFS_LOG_EVENT_START,
+        "worker",
+        0,
+        "c.id=%d", 
+        child_pid);
+
+    /* a worker counts as a connection until the sigchld handler reaps it */
+    globus_gfs_config_inc_int("open_connections_count", 1);
+
+    GlobusGFSDebugExit();
+    return GLOBUS_SUCCESS;
+
+child_error:
+    exit(1);
+error:
+    GlobusGFSDebugExitWithError();
+    return result;
+}
+
+/* called locked */
+static
+globus_result_t
+globus_l_gfs_start_workers(void)
+{
+    globus_result_t                     result;
+    int                                 count;
+    int                                 i;
+    GlobusGFSName(globus_l_gfs_start_workers);
+    GlobusGFSDebugEnter();
+
+    result = globus_xio_server_cntl(
+        globus_l_gfs_xio_server,
+        globus_l_gfs_tcp_driver,
+        GLOBUS_XIO_TCP_GET_HANDLE,
+        &globus_l_gfs_worker_socket);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+
+    /* the same as a forked child, but listening */
+    globus_l_gfs_worker_argv = (char **) globus_calloc(
+        globus_l_gfs_child_argc + 1, sizeof(char *));
+    if(globus_l_gfs_worker_argv == NULL)
+    {
+        result = GlobusGFSErrorMemory("worker_argv");
+        goto error;
+    }
+    for(i = 0; i < globus_l_gfs_child_argc; i++)
+    {
+        globus_l_gfs_worker_argv[i] = 
+            strcmp(globus_l_gfs_child_argv[i], "-inetd") == 0 ?
+                "-pool-worker" : globus_l_gfs_child_argv[i];
+    }
+
+    count = globus_i_gfs_config_int("worker_processes");
+    globus_l_gfs_worker_pids = (pid_t *) globus_calloc(count, sizeof(pid_t));
+    globus_l_gfs_worker_started = 
+        (time_t *) globus_calloc(count, sizeof(time_t));
+    if(globus_l_gfs_worker_pids == NULL || 
+        globus_l_gfs_worker_started == NULL)
+    {
+        result = GlobusGFSErrorMemory("worker_pids");
+        goto error;
+    }
+    globus_l_gfs_worker_count = count;
+
+    for(i = 0; i < count; i++)
+    {
+        result = globus_l_gfs_spawn_worker(i);
+        if(result != GLOBUS_SUCCESS)
+        {
+            /* the sigchld handler tries again */
+            globus_gfs_log_result(
+                GLOBUS_GFS_LOG_ERR, "Could not start a worker process", result);
+        }
+    }
+
+    GlobusGFSDebugExit();
+    return GLOBUS_SUCCESS;
+
+error:
+    GlobusGFSDebugExitWithError();
+    return result;
+}
+
+/* called locked.  keeps the pool full until the server is shutting down;
+ * a worker that died right after it was started is left for the next
+ * periodic pass so a broken install does not fork in a loop */
+static
+void
+globus_l_gfs_respawn_workers(
+    pid_t                               exited_pid)
+{
+    globus_result_t                     result;
+    time_t                              now;
+    int                                 i;
+    GlobusGFSName(globus_l_gfs_respawn_workers);
+    GlobusGFSDebugEnter();
+
+    now = time(NULL);
+    for(i = 0; i < globus_l_gfs_worker_count; i++)
+    {
+        if(exited_pid != 0 && globus_l_gfs_worker_pids[i] == exited_pid)
+        {
+            globus_l_gfs_worker_pids[i] = 0;
+        }
+        if(globus_l_gfs_worker_pids[i] == 0 && !globus_l_gfs_terminated &&
+            now - globus_l_gfs_worker_started[i] >= 
+                GLOBUS_L_GFS_SIGCHLD_DELAY)
+        {
+            result = globus_l_gfs_spawn_worker(i);
+            if(result != GLOBUS_SUCCESS)
+            {
+                globus_gfs_log_result(
+                    GLOBUS_GFS_LOG_ERR, 
+                    "Could not start a worker process", 
+                    result);
+            }
+        }
+    }
+
+    GlobusGFSDebugExit();
+}
+
+static
+void
+globus_l_gfs_signal_workers(
+    int                                 signum)
+{
+    int                                 i;
+
+    for(i = 0; i < globus_l_gfs_worker_count; i++)
+    {
+        if(globus_l_gfs_worker_pids[i] > 0)
+        {
+            kill(globus_l_gfs_worker_pids[i], signum);
+        }
+    }
+}
+
+/* a worker runs every session as the same user, so switch to it before
+ * accepting any */
+static
+globus_result_t
+globus_l_gfs_pool_worker_setuid(void)
+{
+    globus_result_t                     result;
+    struct passwd                       pwent;
+    struct passwd *                     pw_result;
+    struct group *                      grent;
+    char                                buf[1024];
+    char *                              name;
+    gid_t                               gid;
+    int                                 rc;
+    GlobusGFSName(globus_l_gfs_pool_worker_setuid);
+    GlobusGFSDebugEnter();
+
+    if(getuid() != 0)
+    {
+        goto done;
+    }
+
+    name = globus_i_gfs_config_string("process_user");
+    if(name == NULL)
+    {
+        result = GlobusGFSErrorGeneric(
+            "Worker processes need process_user when running as root.");
+        goto error;
+    }
+    rc = globus_libc_getpwnam_r(name, &pwent, buf, sizeof(buf), &pw_result);
+    if(rc != 0 || pw_result == NULL)
+    {
+        result = GlobusGFSErrorGeneric("Configured process user is invalid.");
+        goto error;
+    }
+    gid = pwent.pw_gid;
+    if((name = globus_i_gfs_config_string("process_group")) != NULL)
+    {
+        grent = getgrnam(name);
+        if(grent == NULL)
+        {
+            result = GlobusGFSErrorGeneric(
+                "Configured process group is invalid.");
+            goto error;
+        }
+        gid = grent->gr_gid;
+    }
+
+    if(setgid(gid) != 0)
+    {
+        result = GlobusGFSErrorSystemError(
+            "Unable to set the gid of the server process.", errno);
+        goto error;
+    }
+    if(initgroups(pwent.pw_name, gid) != 0)
+    {
+        result = GlobusGFSErrorGeneric(
+            "Unable to set the supplemental groups of the server process.");
+        goto error;
+    }
+    if(setuid(pwent.pw_uid) != 0)
+    {
+        result = GlobusGFSErrorSystemError(
+            "Unable to set the uid of the server process.", errno);
+        goto error;
+    }
+
+done:
+    GlobusGFSDebugExit();
+    return GLOBUS_SUCCESS;
+
+error:
+    GlobusGFSDebugExitWithError();
+    return result;
+}
+
 static
 void
 globus_i_gfs_connection_closed()
@@ -1228,6 +1575,10 @@ globus_l_gfs_server_accept_cb(
                         result);
                     result = GLOBUS_SUCCESS;
                 }
+                else
+                {
+                    globus_l_gfs_worker_sessions++;
+                }
             }
         }
         /* be sure to close handle on server proc and close server on 
@@ -1410,6 +1761,119 @@ globus_l_gfs_be_daemon()
         fflush(stdout);
     }
 
+    if(globus_i_gfs_config_bool("daemon") &&
+        globus_i_gfs_config_int("worker_processes") > 0 &&
+        globus_l_gfs_workers_allowed())
+    {
+        /* the workers accept, the daemon only keeps them running */
+        result = globus_l_gfs_start_workers();
+        if(result != GLOBUS_SUCCESS)
+        {
+            goto contact_error;
+        }
+    }
+    else
+    {
+        result = globus_xio_server_register_accept(
+            globus_l_gfs_xio_server,
+            globus_l_gfs_server_accept_cb,
+            NULL);
+        if(result != GLOBUS_SUCCESS)
+        {
+            goto contact_error;
+        }
+        globus_l_gfs_outstanding++;
+
+        globus_l_gfs_xio_server_accepting = GLOBUS_TRUE;
+    }
+    globus_xio_stack_destroy(stack);
+    globus_xio_attr_destroy(attr);
+
+    GlobusGFSDebugExit();
+    return GLOBUS_SUCCESS;
+
+contact_error:
+    globus_free(contact_string);
+server_error:
+    globus_xio_server_close(globus_l_gfs_xio_server);
+attr_error:
+    globus_xio_attr_destroy(attr);
+stack_error:
+    globus_xio_stack_destroy(stack);
+error:
+    GlobusGFSDebugExitWithError();
+    return result;
+}
+
+/* start up a worker: accept on the listener the daemon passed as stdin
+ * and serve sessions in this process */
+static
+globus_result_t
+globus_l_gfs_be_pool_worker()
+{
+    char *                              contact_string;
+    globus_result_t                     result;
+    globus_xio_stack_t                  stack;
+    globus_xio_attr_t                   attr;
+    GlobusGFSName(globus_l_gfs_be_pool_worker);
+    GlobusGFSDebugEnter();
+
+    result = globus_l_gfs_prepare_stack(&stack);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+
+    result = globus_xio_attr_init(&attr);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto stack_error;
+    }
+    result = globus_xio_attr_cntl(
+        attr,
+        globus_l_gfs_tcp_driver,
+        GLOBUS_XIO_TCP_SET_HANDLE,
+        STDIN_FILENO);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto attr_error;
+    }
+    
+    result = globus_xio_server_create(&globus_l_gfs_xio_server, attr, stack);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto attr_error;
+    }
+
+    result = globus_l_gfs_pool_worker_setuid();
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto server_error;
+    }
+
+    if(globus_i_gfs_config_bool("chdir"))
+    {
+        char *                          chdir_to;
+        chdir_to = globus_i_gfs_config_string("chdir_to");
+        if(chdir_to != NULL)
+        {
+            chdir(chdir_to);
+        }
+        else
+        {
+            chdir("/");
+        }
+    }
+
+    result = globus_xio_server_get_contact_string(
+        globus_l_gfs_xio_server,
+        &contact_string);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto server_error;
+    }
+    globus_gfs_config_set_ptr("contact_string", contact_string);
+
     result = globus_xio_server_register_accept(
         globus_l_gfs_xio_server,
         globus_l_gfs_server_accept_cb,
@@ -1977,6 +2441,15 @@ main(
                 goto error_lock;
             }
         }
+        else if(globus_i_gfs_config_bool("pool_worker"))
+        {
+            result = globus_l_gfs_be_pool_worker();
+            if(result != GLOBUS_SUCCESS)
+            {
+                rc = 1;
+                goto error_lock;
+            }
+        }
         else
         {
             globus_l_gfs_server_build_child_args(GLOBUS_FALSE);
@@ -2017,6 +2490,15 @@ main(
     }
     globus_mutex_unlock(&globus_l_gfs_mutex);
 
+    if(globus_i_gfs_config_bool("pool_worker"))
+    {
+        globus_gfs_log_message(
+            GLOBUS_GFS_LOG_INFO,
+            "Worker process %d served %d sessions.\n",
+            getpid(),
+            globus_l_gfs_worker_sessions);
+    }
+
     globus_xio_attr_destroy(globus_l_gfs_xio_attr);
     globus_xio_driver_unload(globus_l_gfs_tcp_driver);
     
@@ -555,6 +555,11 @@ typedef struct globus_gfs_data_info_s
 
     /** op info */
     globus_gfs_op_info_t                op_info;
+
+    /** fewest and most parallel streams the sender may scale between,
+     *  equal to nstreams (or 0) for a fixed number of streams */
+    int                                 nstreams_min;
+    int                                 nstreams_max;
 } globus_gfs_data_info_t;
 
 /*
@@ -975,6 +980,28 @@ globus_gridftp_server_register_write(
     globus_gridftp_server_write_cb_t    callback,  
     void *                              user_arg);
 
+/*
+ * sendfile
+ *
+ * Like globus_gridftp_server_register_write(), but the data is sent
+ * straight from length bytes of the open file fd starting at file_offset
+ * without passing through a buffer.  This only works when the data channel
+ * is unprotected, in binary mode and not striped or http; otherwise an
+ * error is returned and nothing is queued, and the DSI should fall back to
+ * reading the data itself and calling globus_gridftp_server_register_write().
+ * The callback is called with a NULL buffer.
+ */
+globus_result_t
+globus_gridftp_server_register_sendfile(
+    globus_gfs_operation_t              op,
+    globus_xio_system_file_t            fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       length,
+    globus_off_t                        offset,
+    int                                 stripe_ndx,
+    globus_gridftp_server_write_cb_t    callback,
+    void *                              user_arg);
+
 /*
  * read
  * 
@@ -1202,6 +1229,18 @@ void
 globus_gridftp_server_get_stripe_block_size(
     globus_gfs_operation_t              op,
     globus_size_t *                     stripe_block_size);
+
+/*
+ * get data mode
+ *
+ * This can be called during a send() to find the transfer mode of the
+ * data channel, 'S' or 'E'.  Buffers may only be passed to
+ * globus_gridftp_server_register_write() out of offset order in mode E.
+ */
+void
+globus_gridftp_server_get_data_mode(
+    globus_gfs_operation_t              op,
+    char *                              mode);
     
 /*
  * get session username
@@ -1270,6 +1309,18 @@ globus_gridftp_server_get_ordered_data(
     globus_gfs_operation_t              op,
     globus_bool_t *                     ordered_data);
 
+/* 
+ * set synced ranges
+ * 
+ * A DSI that flushes data to storage before passing its range to
+ * globus_gridftp_server_update_range_recvd() calls this during a recv()
+ * so that sync_writes does not also sync() before each restart marker.
+ */
+void
+globus_gridftp_server_set_synced_ranges(
+    globus_gfs_operation_t              op,
+    globus_bool_t                       synced_ranges);
+
 /*
  * get config string
  * 
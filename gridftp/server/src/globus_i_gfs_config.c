@@ -140,6 +140,16 @@ static const globus_l_gfs_config_option_t option_list[] =
     "Server will fork for each new connection.  Disabling this option is only recommended "
     "when debugging. Note that non-forked servers running as 'root' will only "
     "accept a single connection, and then exit.", NULL, NULL,GLOBUS_FALSE, NULL},
+ {"worker_processes", "worker_processes", NULL, "worker-processes", NULL, GLOBUS_L_GFS_CONFIG_INT, 0, NULL,
+    "Serve connections from this many worker processes started with the daemon, "
+    "each running many sessions on threads, instead of starting a new process for "
+    "every connection.  Sessions then share their worker's uid, so when running as "
+    "root process_user must be set and every worker switches to it on startup; "
+    "chroot_path cannot be used.  Logins that map to any other uid are refused.  "
+    "connections_max applies to each worker.  "
+    "0 starts a process per connection.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"pool_worker", "pool_worker", NULL, "pool-worker", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL,
+    NULL /* started by a daemon with worker_processes; accepts on stdin */, NULL, NULL, GLOBUS_FALSE, NULL},
  {"fork_fallback", "fork_fallback", NULL, "fork-fallback", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL,
     NULL /* attempt to run non-forked if fork fails */, NULL, NULL, GLOBUS_FALSE, NULL},
  {"single", "single", NULL, "single", "1", GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL, 
@@ -360,13 +370,60 @@ static const globus_l_gfs_config_option_t option_list[] =
 {NULL, "Disk Options", NULL, NULL, NULL, 0, 0, NULL, NULL, NULL, NULL,GLOBUS_FALSE, NULL},
  {"blocksize", "blocksize", NULL, "blocksize", "bs", GLOBUS_L_GFS_CONFIG_INT, (256 * 1024), NULL,
     "Size in bytes of data blocks to read from disk before posting to the network.", NULL, NULL,GLOBUS_FALSE, NULL},
+ {"autotune", "autotune", NULL, "autotune", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL,
+    "Adjust the number of data buffers kept in flight per stream during a transfer from "
+    "the throughput each stream achieves, and the blocksize of later transfers in the "
+    "same session from where that ends up.  Decisions are reported in the transfer log.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"autotune_max_buffers", "autotune_max_buffers", NULL, "autotune-max-buffers", NULL, GLOBUS_L_GFS_CONFIG_INT, 8, NULL,
+    "Most data buffers per stream autotune will keep in flight.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"autotune_blocksize_min", "autotune_blocksize_min", NULL, "autotune-blocksize-min", NULL, GLOBUS_L_GFS_CONFIG_INT, (64 * 1024), NULL,
+    "Smallest blocksize in bytes autotune will use.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"autotune_blocksize_max", "autotune_blocksize_max", NULL, "autotune-blocksize-max", NULL, GLOBUS_L_GFS_CONFIG_INT, (4 * 1024 * 1024), NULL,
+    "Largest blocksize in bytes autotune will use.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"http_concurrency", "http_concurrency", NULL, "http-concurrency", NULL, GLOBUS_L_GFS_CONFIG_INT, 4, NULL,
+    "Data buffers to keep in flight while an HTTP GET body that is larger than "
+    "one block is written through the DSI.  Reads from the HTTP connection stay "
+    "sequential; the extra buffers let storage writes overlap them.", NULL, NULL, GLOBUS_FALSE, NULL},
  {"sync_writes", "sync_writes", NULL, "sync-writes", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL,
     "Flush disk writes before sending a restart marker.  This attempts to ensure that "
     "the range specified in the restart marker has actually been committed to disk. "
     "This option will probably impact performance, and may result in different behavior "
     "on different storage systems. See the manpage for sync() for more information.", NULL, NULL,GLOBUS_FALSE, NULL},
+ {"sync_writes_threshold", "sync_writes_threshold", NULL, "sync-writes-threshold", NULL, GLOBUS_L_GFS_CONFIG_INT, (64 * 1024 * 1024), NULL,
+    "With sync_writes, flush a file being received to disk in the background "
+    "each time this many bytes have been written since the last flush, and "
+    "only send restart markers for data that has been flushed.  This keeps "
+    "dirty data and the wait at the end of the transfer bounded.  0 syncs all "
+    "filesystems before each restart marker instead.  Only applies to files "
+    "on the default disk stack.", NULL, NULL, GLOBUS_FALSE, NULL},
  {"direct_io", "direct", NULL, "direct", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL,
     NULL /* use O_DIRECT */, NULL, NULL, GLOBUS_FALSE, NULL},
+ {"write_extent_size", "write_extent_size", NULL, "write-extent-size", NULL, GLOBUS_L_GFS_CONFIG_INT, (4 * 1024 * 1024), NULL,
+    "Largest disk write in bytes the server builds by joining received blocks that "
+    "follow on from each other in the file.  Blocks that arrive ahead of a gap are "
+    "held back, up to half of the transfer's buffers, so that the file is written "
+    "in order.  0 writes each block as it arrives.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"sendfile", "sendfile", NULL, "sendfile", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_TRUE, NULL,
+    "Send file data directly from the page cache to unprotected data channels "
+    "using sendfile() where the system supports it.  Disable with -no-sendfile "
+    "if the data channel or storage misbehaves.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"checksum_concurrency", "checksum_concurrency", NULL, "checksum-concurrency", NULL, GLOBUS_L_GFS_CONFIG_INT, 4, NULL,
+    "Number of blocks read and checksummed in parallel when computing a file checksum. "
+    "Only used when the server is threaded.  A value of 1 or less reads the file serially.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"checksum_inline", "checksum_inline", NULL, "checksum-inline", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL,
+    "When a client supplies a checksum to verify an upload against, compute it from the "
+    "data as it is written instead of reading the file back afterwards.  The file is "
+    "still read back if the data was not seen in a form that can be checksummed "
+    "(MD5 and SHA need it in order; ADLER32 and CRC32C do not).", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"checksum_cache", "checksum_cache", NULL, "checksum-cache", NULL, GLOBUS_L_GFS_CONFIG_BOOL, GLOBUS_FALSE, NULL,
+    "Keep checksums the server computes in an extended attribute of the file "
+    "(user.globus.cksm.<algorithm>) and answer later requests from it for as long "
+    "as the file's device, inode, size and modification time are unchanged.  Files "
+    "the user cannot write, or filesystems without user extended attributes, are "
+    "checksummed as usual.", NULL, NULL, GLOBUS_FALSE, NULL},
+ {"checksum_cache_max_age", "checksum_cache_max_age", NULL, "checksum-cache-max-age", NULL, GLOBUS_L_GFS_CONFIG_INT, 0, NULL,
+    "Recompute a checksum rather than use a cached one stored more than this many "
+    "days ago.  0 trusts cached checksums for as long as the file is unchanged.", NULL, NULL, GLOBUS_FALSE, NULL},
  {"perms", "perms", NULL, "perms", NULL, GLOBUS_L_GFS_CONFIG_STRING, 0, NULL,
     "Set the default permissions for created files. Should be an octal number "
     "such as 0644.  The default is 0644.  Note: If umask is set it will affect "
@@ -497,6 +554,8 @@ static const globus_l_gfs_config_option_t option_list[] =
     NULL, NULL, NULL,GLOBUS_FALSE, NULL}, /* exit cleanly on bad signals (no core dump) */
  {"slow_dirlist", "slow_dirlist", NULL, NULL, NULL, GLOBUS_L_GFS_CONFIG_INT, 0, NULL,
     NULL, NULL, NULL,GLOBUS_FALSE, NULL}, /* fake stat responses on dirs with more than this many entries */
+ {"sort_dirlist_max", "sort_dirlist_max", NULL, NULL, NULL, GLOBUS_L_GFS_CONFIG_INT, 100000, NULL,
+    NULL, NULL, NULL,GLOBUS_FALSE, NULL}, /* sort listings of dirs with up to this many entries, larger dirs are streamed unsorted */
  {"checksum_throttle", "checksum_throttle", NULL, NULL, NULL, GLOBUS_L_GFS_CONFIG_INT, 0, NULL,
     NULL, NULL, NULL,GLOBUS_FALSE, NULL}, /* delay checksum reads by this many microseconds per blocksize'd read, 
     * effectively setting a floor on the checksum rate to size/blocksize*delay per size */
@@ -572,6 +631,7 @@ static int                              globus_l_gfs_num_threads = -1;
 static char *                           globus_l_gfs_port_range = NULL;
 static globus_bool_t                    globus_l_gfs_common_loaded = GLOBUS_FALSE;
 static globus_bool_t                    globus_l_gfs_is_worker = GLOBUS_FALSE;
+static globus_bool_t                    globus_l_gfs_pool_worker = GLOBUS_FALSE;
 
 /* for string options, setting with an int_val of 1 will free the old one */ 
 static
@@ -2483,6 +2543,14 @@ globus_l_gfs_config_misc()
         globus_l_gfs_config_set("anonymous_names_allowed", 0, "*");
     }
 
+    if(globus_i_gfs_config_bool("pool_worker"))
+    {
+        globus_l_gfs_config_set("daemon", GLOBUS_FALSE, NULL);
+        globus_l_gfs_config_set("detach", GLOBUS_FALSE, NULL);
+        globus_l_gfs_config_set("single", GLOBUS_FALSE, NULL);
+        globus_l_gfs_config_set("worker_processes", 0, NULL);
+    }
+
     if(globus_i_gfs_config_bool("inetd"))
     {
         globus_l_gfs_config_set("single", GLOBUS_TRUE, NULL);
@@ -2802,8 +2870,9 @@ globus_l_gfs_config_misc()
     }
 
     /* make sure root running process that does not fork can only run
-        once */
-    if(!globus_i_gfs_config_bool("daemon") && getuid() == 0)
+        once.  pool workers switch to process_user before accepting */
+    if(!globus_i_gfs_config_bool("daemon") && getuid() == 0 &&
+        !globus_i_gfs_config_bool("pool_worker"))
     {
         globus_l_gfs_config_set("connections_max", 1, NULL);
         globus_l_gfs_config_set("single", 1, NULL);
@@ -3031,6 +3100,12 @@ globus_i_gfs_config_init_envs(
         {            
             globus_l_gfs_is_worker = GLOBUS_TRUE;
         }
+        else if(!strcmp(argp, "pool-worker"))
+        {
+            /* sessions share the process, so it is always threaded */
+            globus_l_gfs_is_worker = GLOBUS_TRUE;
+            globus_l_gfs_pool_worker = GLOBUS_TRUE;
+        }
         else if(!strcmp(argp, "port-range") && tmp_argv[arg_num + 1])
         {
             /* save arg and set after file is loaded */
@@ -3117,6 +3192,11 @@ globus_i_gfs_config_init_envs(
         setenv("GLOBUS_UDP_PORT_RANGE", globus_l_gfs_port_range, 1);
     }
 
+    if(globus_l_gfs_pool_worker && globus_l_gfs_num_threads < 1)
+    {
+        globus_l_gfs_num_threads = 2;
+    }
+
     /* only enable threads for real process, not daemon */
     if(globus_l_gfs_num_threads > 0 && globus_l_gfs_is_worker)
     {
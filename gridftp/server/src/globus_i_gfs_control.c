@@ -2768,6 +2768,10 @@ globus_l_gfs_get_data_info(
         op, &data_info->nstreams);
     globus_assert(result == GLOBUS_SUCCESS);
 
+    result = globus_gridftp_server_control_get_parallelism_range(
+        op, &data_info->nstreams_min, &data_info->nstreams_max);
+    globus_assert(result == GLOBUS_SUCCESS);
+
     result = globus_gridftp_server_control_get_data_auth(
         op,
         &data_info->subject,
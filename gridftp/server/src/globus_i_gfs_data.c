@@ -216,8 +216,31 @@ typedef struct
     globus_byte_t *                     list_response;
     globus_bool_t                       free_buffer;
     globus_bool_t                       final;
+    globus_byte_t *                     buffer;
+    globus_size_t                       length;
 } globus_l_gfs_data_bounce_t;
 
+/* state for reading the body of an HTTP GET into posted DSI buffers.
+ * reads from the connection are issued one at a time and in order;
+ * a multipart/byteranges body is split into its parts here. */
+typedef struct globus_l_gfs_data_http_reader_s
+{
+    globus_fifo_t                       reads;
+    globus_l_gfs_data_bounce_t *        current;
+    globus_bool_t                       busy;
+    char *                              delim;
+    globus_off_t                        base;
+    globus_off_t                        part_offset;
+    globus_off_t                        part_left;
+    globus_off_t                        skip;
+    globus_byte_t *                     hdr;
+    globus_size_t                       hdr_len;
+    globus_size_t                       hdr_size;
+    globus_bool_t                       stream_eof;
+    globus_bool_t                       eof;
+    globus_bool_t                       failed;
+} globus_l_gfs_data_http_reader_t;
+
 typedef struct 
 {
     char *                              all;
@@ -308,6 +331,10 @@ typedef struct
     globus_callback_handle_t            watch_handle;
     
     globus_hashtable_t                  custom_cmd_table;
+
+    /* where autotune left off, the next transfer starts from here */
+    int                                 tune_buffers;
+    globus_size_t                       tune_blocksize;
 } globus_l_gfs_data_session_t;
 
 typedef struct
@@ -328,6 +355,7 @@ typedef struct
     char *                              http_response_str;
     char *                              http_ip;
     globus_callback_handle_t            perf_handle;
+    globus_l_gfs_data_http_reader_t *   http_reader;
 
 } globus_l_gfs_data_handle_t;
 
@@ -445,6 +473,21 @@ typedef struct globus_l_gfs_data_operation_s
 
     globus_bool_t                       order_data;
     globus_off_t                        order_data_start;
+
+    /* the dsi syncs what it reports with update_range_recvd() itself */
+    globus_bool_t                       synced_ranges;
+
+    /* autotune state, see globus_l_gfs_data_autotune_sample() */
+    globus_bool_t                       tune;
+    int                                 tune_buffers;
+    int                                 tune_step;
+    int                                 tune_changes;
+    int                                 tune_pending;
+    globus_bool_t                       tune_dry;
+    globus_size_t                       tune_blocksize;
+    globus_off_t                        tune_bytes;
+    double                              tune_rate;
+    struct timeval                      tune_timeval;
 } globus_l_gfs_data_operation_t;
 
 typedef struct
@@ -592,14 +635,9 @@ void
 globus_l_gfs_data_brain_ready_delay_cb(
     void *                              user_arg);
 
+static
 void
-globus_i_gfs_data_http_read_cb(
-    globus_xio_handle_t                 xio_handle, 
-    globus_result_t                     result,
-    globus_byte_t *                     buffer,
-    globus_size_t                       length,
-    globus_size_t                       nbytes, 
-    globus_xio_data_descriptor_t        data_desc,
+globus_l_gfs_data_http_reader_kickout(
     void *                              user_arg);
 void
 globus_i_gfs_data_http_write_cb(
@@ -4445,8 +4483,10 @@ globus_l_gfs_data_authorize(
     }
     else if(pw_file != NULL)
     {
-        /* if we have not yet looked it up for this user */
-        if(globus_l_gfs_data_pwent == NULL)
+        /* if we have not yet looked it up for this user.  a pool worker
+         * serves many users, so it looks up every session */
+        if(globus_l_gfs_data_pwent == NULL ||
+            globus_i_gfs_config_bool("pool_worker"))
         {
 #           ifdef HAVE_FGETPWENT
             {
@@ -4473,7 +4513,11 @@ globus_l_gfs_data_authorize(
                     res = GlobusGFSErrorGeneric("Invalid user.");
                     goto pwent_error;
                 }
-                globus_l_gfs_data_pwent = globus_l_gfs_pw_copy(pwent);
+                pwent = globus_l_gfs_pw_copy(pwent);
+                if(!globus_i_gfs_config_bool("pool_worker"))
+                {
+                    globus_l_gfs_data_pwent = globus_l_gfs_pw_copy(pwent);
+                }
                 globus_libc_unlock();
             }
 #           else
@@ -4486,14 +4530,15 @@ globus_l_gfs_data_authorize(
         else
         {
             /* if already looked up (and setuid()) use global value */
-            if(strcmp(pwent->pw_name, session_info->username) != 0)
+            if(strcmp(globus_l_gfs_data_pwent->pw_name,
+                session_info->username) != 0)
             {
                 res = GlobusGFSErrorGeneric(
                     "Invalid user for current session.");
                 goto pwent_error;
             }
+            pwent = globus_l_gfs_pw_copy(globus_l_gfs_data_pwent);
         }
-        pwent = globus_l_gfs_pw_copy(globus_l_gfs_data_pwent);
         grent = globus_l_gfs_getgrgid(pwent->pw_gid);
         if(grent == NULL)
         {
@@ -4536,8 +4581,30 @@ globus_l_gfs_data_authorize(
     }
 
 
+    if(!(auth_level & GLOBUS_L_GFS_AUTH_NOSETUID) &&
+        pwent->pw_uid == 0 && !globus_i_gfs_config_bool("allow_root"))
+    {
+        res = GlobusGFSErrorGeneric(
+            "User was mapped as root but root is not allowed.");
+        goto uid_error;
+    }
+
+    /* a pool worker shares its process between sessions and already runs
+     * as process_user or the invoking user, so it can only serve users
+     * that map to that uid */
+    if(!(auth_level & GLOBUS_L_GFS_AUTH_NOSETUID) &&
+        globus_i_gfs_config_bool("pool_worker") &&
+        pwent->pw_uid != getuid())
+    {
+        GlobusGFSErrorGenericStr(res,
+            ("User '%s' does not match the uid of this worker process.",
+            session_info->username));
+        goto uid_error;
+    }
+
     /* change process ids */
-    if(!(auth_level & GLOBUS_L_GFS_AUTH_NOSETUID))
+    if(!(auth_level & GLOBUS_L_GFS_AUTH_NOSETUID) &&
+        !globus_i_gfs_config_bool("pool_worker"))
     {
         rc = setgid(gid);
         if(rc != 0)
@@ -4568,13 +4635,6 @@ globus_l_gfs_data_authorize(
         }
         
 
-        if(pwent->pw_uid == 0 && !globus_i_gfs_config_bool("allow_root"))
-        {
-            res = GlobusGFSErrorGeneric(
-                "User was mapped as root but root is not allowed.");
-            goto uid_error;
-        }
-
         if((chroot_dir = globus_i_gfs_config_string("chroot_path")) != NULL)
         {
             chdir(chroot_dir);
@@ -6975,8 +7035,32 @@ globus_l_gfs_data_handle_init(
 
         globus_assert(handle->info.mode == 'E');
 
-        parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_FIXED;
-        parallelism.fixed.size = handle->info.nstreams;
+        /* the client gave a range around the starting level; when this
+         * end sends it opens or retires streams within it as it goes */
+        if(handle->info.nstreams_min > 0 &&
+            handle->info.nstreams_min < handle->info.nstreams_max &&
+            handle->info.nstreams_min <= handle->info.nstreams &&
+            handle->info.nstreams <= handle->info.nstreams_max)
+        {
+            parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_DYNAMIC;
+            parallelism.base.size = handle->info.nstreams;
+
+            result = globus_ftp_control_local_parallelism_range(
+                &handle->data_channel,
+                handle->info.nstreams_min,
+                handle->info.nstreams_max);
+            if(result != GLOBUS_SUCCESS)
+            {
+                result = GlobusGFSErrorWrapFailed(
+                    "globus_ftp_control_local_parallelism_range", result);
+                goto error_control;
+            }
+        }
+        else
+        {
+            parallelism.mode = GLOBUS_FTP_CONTROL_PARALLELISM_FIXED;
+            parallelism.fixed.size = handle->info.nstreams;
+        }
 
         result = globus_ftp_control_local_parallelism(
             &handle->data_channel, &parallelism);
@@ -10016,6 +10100,240 @@ globus_l_gfs_data_get_nl_msg(
 }
 
 
+/*
+ * autotune.
+ *
+ * with autotune on, the number of buffers per stream a DSI is told to
+ * keep in flight follows a hill climb on the per stream goodput.  about
+ * once a second the goodput is compared to the last sample: if it went up
+ * the last change is repeated, if it went down the last change is undone.
+ * if it stayed put the queue of reads or writes outstanding on the data
+ * channel decides: if it ran dry, the DSI could not keep it fed and gets
+ * another buffer, otherwise one is given back.
+ *
+ * a DSI sizes its buffers once per transfer, so the blocksize is tuned
+ * between transfers of a session instead, from where the buffer count
+ * ended up.
+ */
+#define GLOBUS_L_GFS_AUTOTUNE_INTERVAL  1000000
+#define GLOBUS_L_GFS_AUTOTUNE_NOISE     0.05
+
+/* called locked */
+static
+void
+globus_l_gfs_data_autotune_start(
+    globus_l_gfs_data_operation_t *     op)
+{
+    globus_l_gfs_data_session_t *       session_handle;
+    int                                 max_buffers;
+    globus_size_t                       min_bs;
+    globus_size_t                       max_bs;
+    GlobusGFSName(globus_l_gfs_data_autotune_start);
+    GlobusGFSDebugEnter();
+
+    session_handle = op->session_handle;
+    /* what get_optimal_concurrency has always handed out */
+    op->tune_buffers = 2;
+
+    if(!globus_i_gfs_config_bool("autotune") ||
+        op->data_handle->http_handle ||
+        (op->type != GLOBUS_L_GFS_DATA_INFO_TYPE_SEND &&
+            op->type != GLOBUS_L_GFS_DATA_INFO_TYPE_RECV))
+    {
+        GlobusGFSDebugExit();
+        return;
+    }
+
+    max_buffers = globus_i_gfs_config_int("autotune_max_buffers");
+    min_bs = (globus_size_t) globus_i_gfs_config_int("autotune_blocksize_min");
+    max_bs = (globus_size_t) globus_i_gfs_config_int("autotune_blocksize_max");
+    if(max_buffers < 1)
+    {
+        max_buffers = 1;
+    }
+    if(max_bs < min_bs)
+    {
+        max_bs = min_bs;
+    }
+
+    if(session_handle->tune_buffers > 0)
+    {
+        op->tune_buffers = session_handle->tune_buffers;
+    }
+    if(op->tune_buffers > max_buffers)
+    {
+        op->tune_buffers = max_buffers;
+    }
+    if(session_handle->tune_blocksize > 0)
+    {
+        op->tune_blocksize = session_handle->tune_blocksize;
+    }
+    else
+    {
+        op->tune_blocksize = op->data_handle->info.blocksize;
+    }
+    if(op->tune_blocksize < min_bs)
+    {
+        op->tune_blocksize = min_bs;
+    }
+    if(op->tune_blocksize > max_bs)
+    {
+        op->tune_blocksize = max_bs;
+    }
+
+    op->tune = GLOBUS_TRUE;
+    op->tune_step = 1;
+    op->tune_rate = 0;
+    op->tune_bytes = op->bytes_transferred;
+    gettimeofday(&op->tune_timeval, NULL);
+
+    GlobusGFSDebugExit();
+}
+
+/* called locked, after each data channel read or write completes */
+static
+void
+globus_l_gfs_data_autotune_sample(
+    globus_l_gfs_data_operation_t *     op)
+{
+    struct timeval                      now;
+    double                              usecs;
+    double                              rate;
+    int                                 streams;
+    int                                 buffers;
+    int                                 max_buffers;
+    const char *                        reason;
+    GlobusGFSName(globus_l_gfs_data_autotune_sample);
+    GlobusGFSDebugEnter();
+
+    if(op->tune_pending == 0)
+    {
+        op->tune_dry = GLOBUS_TRUE;
+    }
+
+    gettimeofday(&now, NULL);
+    usecs = (now.tv_sec - op->tune_timeval.tv_sec) * 1000000.0 +
+        (now.tv_usec - op->tune_timeval.tv_usec);
+    if(usecs < GLOBUS_L_GFS_AUTOTUNE_INTERVAL)
+    {
+        GlobusGFSDebugExit();
+        return;
+    }
+
+    streams = op->data_handle->info.nstreams * op->stripe_count;
+    if(streams < 1)
+    {
+        streams = 1;
+    }
+    rate = (op->bytes_transferred - op->tune_bytes) * 1000000.0 /
+        usecs / streams;
+
+    if(op->tune_rate == 0)
+    {
+        reason = "first sample";
+    }
+    else if(rate > op->tune_rate * (1 + GLOBUS_L_GFS_AUTOTUNE_NOISE))
+    {
+        reason = "faster";
+    }
+    else if(rate < op->tune_rate * (1 - GLOBUS_L_GFS_AUTOTUNE_NOISE))
+    {
+        op->tune_step = -op->tune_step;
+        reason = "slower";
+    }
+    else if(op->tune_dry)
+    {
+        op->tune_step = 1;
+        reason = "queue ran dry";
+    }
+    else
+    {
+        op->tune_step = -1;
+        reason = "queue full";
+    }
+
+    max_buffers = globus_i_gfs_config_int("autotune_max_buffers");
+    buffers = op->tune_buffers + op->tune_step;
+    if(buffers > max_buffers)
+    {
+        buffers = max_buffers;
+    }
+    if(buffers < 1)
+    {
+        buffers = 1;
+    }
+    if(buffers != op->tune_buffers)
+    {
+        op->tune_changes++;
+        globus_gfs_log_message(
+            GLOBUS_GFS_LOG_INFO,
+            "Autotune: %d -> %d buffers per stream, "
+            "%.0f bytes/sec per stream (%s).\n",
+            op->tune_buffers,
+            buffers,
+            rate,
+            reason);
+        op->tune_buffers = buffers;
+    }
+
+    op->tune_rate = rate;
+    op->tune_bytes = op->bytes_transferred;
+    op->tune_timeval = now;
+    op->tune_dry = GLOBUS_FALSE;
+
+    GlobusGFSDebugExit();
+}
+
+/*
+ * called locked at the end of a transfer.  picks the blocksize and buffer
+ * count the session's next transfer starts with and returns a summary for
+ * the transfer log.
+ */
+static
+char *
+globus_l_gfs_data_autotune_finish(
+    globus_l_gfs_data_operation_t *     op)
+{
+    globus_l_gfs_data_session_t *       session_handle;
+    int                                 buffers;
+    globus_size_t                       blocksize;
+    GlobusGFSName(globus_l_gfs_data_autotune_finish);
+    GlobusGFSDebugEnter();
+
+    session_handle = op->session_handle;
+    buffers = op->tune_buffers;
+    blocksize = op->tune_blocksize;
+
+    /* it wanted more data in flight than it was allowed, or less than a
+     * block per stream; keep the bytes in flight and move the blocksize */
+    if(buffers >= globus_i_gfs_config_int("autotune_max_buffers") &&
+        buffers > 1 && blocksize * 2 <=
+            (globus_size_t) globus_i_gfs_config_int("autotune_blocksize_max"))
+    {
+        blocksize *= 2;
+        buffers = (buffers + 1) / 2;
+    }
+    else if(buffers == 1 && blocksize / 2 >=
+        (globus_size_t) globus_i_gfs_config_int("autotune_blocksize_min"))
+    {
+        blocksize /= 2;
+        buffers = 2;
+    }
+    session_handle->tune_buffers = buffers;
+    session_handle->tune_blocksize = blocksize;
+
+    GlobusGFSDebugExit();
+    return globus_common_create_string(
+        "buffers:%d,blocksize:%ld,changes:%d,rate:%.0f,next:%d/%ld",
+        op->tune_buffers,
+        (long) op->tune_blocksize,
+        op->tune_changes,
+        op->tune_rate,
+        buffers,
+        (long) blocksize);
+}
+
+
 static
 void
 globus_l_gfs_data_end_transfer_kickout(
@@ -10033,6 +10351,7 @@ globus_l_gfs_data_end_transfer_kickout(
     globus_gfs_event_info_t             event_info;
     globus_result_t                     result = GLOBUS_SUCCESS;
     char *                              retransmit_str = NULL;
+    char *                              autotune_str = NULL;
     GlobusGFSName(globus_l_gfs_data_end_transfer_kickout);
     GlobusGFSDebugEnter();
 
@@ -10233,6 +10552,10 @@ response_exit:
                 globus_assert(0 && "possible memory corruption");
                 break;
         }
+        if(op->tune && op->cached_res == GLOBUS_SUCCESS)
+        {
+            autotune_str = globus_l_gfs_data_autotune_finish(op);
+        }
     }
     globus_mutex_unlock(&op->session_handle->mutex);
 
@@ -10324,6 +10647,7 @@ response_exit:
             type,
             op->session_handle->username,
             retransmit_str,
+            autotune_str,
             op->session_handle->taskid);
 
         globus_gfs_log_event(
@@ -10443,6 +10767,7 @@ response_exit:
             type,
             op->session_handle->username,
             retransmit_str,
+            autotune_str,
             op->session_handle->taskid);
     }
 
@@ -10450,6 +10775,10 @@ response_exit:
     {
         globus_free(retransmit_str);
     }
+    if(autotune_str)
+    {
+        globus_free(autotune_str);
+    }
     
     /* XXX sc process bytes transferred count */
     {
@@ -10995,6 +11324,15 @@ globus_l_gfs_data_write_cb(
 
     bounce_info->op->bytes_transferred += length;
     bounce_info->op->recvd_bytes += length;
+    if(bounce_info->op->tune)
+    {
+        globus_mutex_lock(&bounce_info->op->session_handle->mutex);
+        {
+            bounce_info->op->tune_pending--;
+            globus_l_gfs_data_autotune_sample(bounce_info->op);
+        }
+        globus_mutex_unlock(&bounce_info->op->session_handle->mutex);
+    }
 
     bounce_info->callback.write(
         bounce_info->op,
@@ -11027,6 +11365,15 @@ globus_l_gfs_data_read_cb(
     globus_l_gfs_data_alive(bounce_info->op->session_handle);
 
     bounce_info->op->bytes_transferred += length;
+    if(bounce_info->op->tune)
+    {
+        globus_mutex_lock(&bounce_info->op->session_handle->mutex);
+        {
+            bounce_info->op->tune_pending--;
+            globus_l_gfs_data_autotune_sample(bounce_info->op);
+        }
+        globus_mutex_unlock(&bounce_info->op->session_handle->mutex);
+    }
 
     bounce_info->callback.read(
         bounce_info->op,
@@ -11138,7 +11485,8 @@ globus_l_gfs_data_trev_kickout(
     }
     globus_mutex_unlock(&bounce_info->op->session_handle->mutex);
 
-    if(globus_i_gfs_config_bool("sync_writes"))
+    if(globus_i_gfs_config_bool("sync_writes") &&
+        !bounce_info->op->synced_ranges)
     {
         sync();
     }
@@ -13135,12 +13483,26 @@ globus_gridftp_server_get_optimal_concurrency(
     globus_gfs_operation_t              op,
     int *                               count)
 {
+    int                                 streams;
     GlobusGFSName(globus_gridftp_server_get_optimal_concurrency);
     GlobusGFSDebugEnter();
 
     if(op->data_handle->http_handle)
     {
+        /* a GET body is still read one buffer at a time, but a few more
+         * buffers posted let the DSI write one while the next is read */
         *count = 1;
+        if(!op->writing && (op->data_handle->http_length < 0 ||
+            op->data_handle->http_length >
+                (globus_off_t) globus_i_gfs_config_int("blocksize")))
+        {
+            *count = globus_i_gfs_config_int("http_concurrency");
+            if(*count < 1)
+            {
+                *count = 1;
+            }
+        }
+        GlobusGFSDebugExit();
         return;
     }
     if(!op->writing)
@@ -13169,7 +13531,22 @@ globus_gridftp_server_get_optimal_concurrency(
             op->data_handle->info.nstreams = 1;
         }
     }
-    *count = op->data_handle->info.nstreams * op->stripe_count * 2;
+    globus_mutex_lock(&op->session_handle->mutex);
+    {
+        if(op->tune_buffers == 0)
+        {
+            globus_l_gfs_data_autotune_start(op);
+        }
+        /* a dynamic sender may open up to nstreams_max streams, keep
+         * enough buffers posted to feed them all */
+        streams = op->data_handle->info.nstreams;
+        if(op->writing && op->data_handle->info.nstreams_max > streams)
+        {
+            streams = op->data_handle->info.nstreams_max;
+        }
+        *count = streams * op->stripe_count * op->tune_buffers;
+    }
+    globus_mutex_unlock(&op->session_handle->mutex);
 
     GlobusGFSDebugExit();
 }
@@ -13186,7 +13563,22 @@ globus_gridftp_server_get_block_size(
 
     if(op && op->data_handle != NULL && op->data_handle->is_mine)
     {
-        *block_size = op->data_handle->info.blocksize;
+        globus_mutex_lock(&op->session_handle->mutex);
+        {
+            if(op->tune_buffers == 0)
+            {
+                globus_l_gfs_data_autotune_start(op);
+            }
+            if(op->tune)
+            {
+                *block_size = op->tune_blocksize;
+            }
+            else
+            {
+                *block_size = op->data_handle->info.blocksize;
+            }
+        }
+        globus_mutex_unlock(&op->session_handle->mutex);
 
         tcp_mem_limit = globus_gfs_config_get_int("tcp_mem_limit");
 
@@ -13227,6 +13619,25 @@ globus_gridftp_server_get_stripe_block_size(
     GlobusGFSDebugExit();
 }
 
+void
+globus_gridftp_server_get_data_mode(
+    globus_gfs_operation_t              op,
+    char *                              mode)
+{
+    GlobusGFSName(globus_gridftp_server_get_data_mode);
+    GlobusGFSDebugEnter();
+    /* http responses are written in order, like stream mode */
+    if(op->data_handle != NULL && !op->data_handle->http_handle)
+    {
+        *mode = op->data_handle->info.mode;
+    }
+    else
+    {
+        *mode = 'S';
+    }
+    GlobusGFSDebugExit();
+}
+
 void
 globus_gridftp_server_get_update_interval(
     globus_gfs_operation_t              op,
@@ -13342,6 +13753,19 @@ globus_gridftp_server_get_ordered_data(
     GlobusGFSDebugExit();
 }
 
+void
+globus_gridftp_server_set_synced_ranges(
+    globus_gfs_operation_t              op,
+    globus_bool_t                       synced_ranges)
+{
+    GlobusGFSName(globus_gridftp_server_set_synced_ranges);
+    GlobusGFSDebugEnter();
+
+    op->synced_ranges = synced_ranges;
+
+    GlobusGFSDebugExit();
+}
+
 
 
 globus_result_t
@@ -13876,23 +14300,51 @@ globus_gridftp_server_register_read(
 
     if(op->data_handle->http_handle)
     {
-        result = globus_xio_register_read(
-            op->data_handle->http_handle,
-            buffer,
-            length,
-            length,
-            NULL,
-            globus_i_gfs_data_http_read_cb,
-            bounce_info);
-        if(result != GLOBUS_SUCCESS)
+        globus_l_gfs_data_http_reader_t *   reader;
+        globus_bool_t                       start;
+
+        /* the connection is read in order by one pump; queue the buffer
+         * and start the pump from a oneshot if it is idle */
+        bounce_info->buffer = buffer;
+        bounce_info->length = length;
+        reader = op->data_handle->http_reader;
+        globus_mutex_lock(&op->session_handle->mutex);
         {
-            result = GlobusGFSErrorWrapFailed(
-                "globus_ftp_control_data_read", result);
-            goto error_register;
+            globus_fifo_enqueue(&reader->reads, bounce_info);
+            start = !reader->busy;
+            reader->busy = GLOBUS_TRUE;
+        }
+        globus_mutex_unlock(&op->session_handle->mutex);
+
+        if(start)
+        {
+            result = globus_callback_register_oneshot(
+                NULL,
+                NULL,
+                globus_l_gfs_data_http_reader_kickout,
+                op);
+            if(result != GLOBUS_SUCCESS)
+            {
+                globus_mutex_lock(&op->session_handle->mutex);
+                {
+                    globus_fifo_remove(&reader->reads, bounce_info);
+                    reader->busy = GLOBUS_FALSE;
+                }
+                globus_mutex_unlock(&op->session_handle->mutex);
+                result = GlobusGFSErrorWrapFailed(
+                    "globus_callback_register_oneshot", result);
+                goto error_register;
+            }
         }
     }
     else
     {
+    if(op->tune)
+    {
+        globus_mutex_lock(&op->session_handle->mutex);
+        op->tune_pending++;
+        globus_mutex_unlock(&op->session_handle->mutex);
+    }
     result = globus_ftp_control_data_read(
         &op->data_handle->data_channel,
         buffer,
@@ -13901,6 +14353,12 @@ globus_gridftp_server_register_read(
         bounce_info);
     if(result != GLOBUS_SUCCESS)
     {
+        if(op->tune)
+        {
+            globus_mutex_lock(&op->session_handle->mutex);
+            op->tune_pending--;
+            globus_mutex_unlock(&op->session_handle->mutex);
+        }
         result = GlobusGFSErrorWrapFailed(
             "globus_ftp_control_data_read", result);
         goto error_register;
@@ -13947,6 +14405,12 @@ globus_gridftp_server_register_write(
     bounce_info->callback.write = callback;
     bounce_info->user_arg = user_arg;
 
+    if(op->tune)
+    {
+        globus_mutex_lock(&op->session_handle->mutex);
+        op->tune_pending++;
+        globus_mutex_unlock(&op->session_handle->mutex);
+    }
     if(op->data_handle->info.mode == 'E' && op->stripe_count > 1)
     {
         /* XXX not sure what this is all about */
@@ -14016,6 +14480,12 @@ globus_gridftp_server_register_write(
     return GLOBUS_SUCCESS;
 
 error_register:
+    if(op->tune)
+    {
+        globus_mutex_lock(&op->session_handle->mutex);
+        op->tune_pending--;
+        globus_mutex_unlock(&op->session_handle->mutex);
+    }
     globus_free(bounce_info);
 
 error_alloc:
@@ -14023,15 +14493,91 @@ error_alloc:
     return result;
 }
 
-void
-globus_gridftp_server_finished_session_start(
+globus_result_t
+globus_gridftp_server_register_sendfile(
     globus_gfs_operation_t              op,
-    globus_result_t                     result,
-    void *                              session_arg,
-    char *                              username,
-    char *                              home_dir)
+    globus_xio_system_file_t            fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       length,
+    globus_off_t                        offset,
+    int                                 stripe_ndx,
+    globus_gridftp_server_write_cb_t    callback,
+    void *                              user_arg)
 {
-    globus_gfs_finished_info_t          finished_info;
+    globus_result_t                     result;
+    globus_l_gfs_data_bounce_t *        bounce_info;
+    GlobusGFSName(globus_gridftp_server_register_sendfile);
+    GlobusGFSDebugEnter();
+
+    globus_l_gfs_data_alive(op->session_handle);
+
+    if(op->data_handle->http_handle ||
+        (op->data_handle->info.mode == 'E' && op->stripe_count > 1))
+    {
+        result = GlobusGFSErrorGeneric(
+            "Data channel cannot send directly from a file.");
+        goto error_alloc;
+    }
+
+    bounce_info = (globus_l_gfs_data_bounce_t *)
+        globus_malloc(sizeof(globus_l_gfs_data_bounce_t));
+    if(!bounce_info)
+    {
+        result = GlobusGFSErrorMemory("bounce_info");
+        goto error_alloc;
+    }
+
+    bounce_info->op = op;
+    bounce_info->callback.write = callback;
+    bounce_info->user_arg = user_arg;
+
+    if(op->tune)
+    {
+        globus_mutex_lock(&op->session_handle->mutex);
+        op->tune_pending++;
+        globus_mutex_unlock(&op->session_handle->mutex);
+    }
+    result = globus_ftp_control_data_write_file(
+        &op->data_handle->data_channel,
+        fd,
+        file_offset,
+        length,
+        offset + op->write_delta,
+        globus_l_gfs_data_write_cb,
+        bounce_info);
+    if(result != GLOBUS_SUCCESS)
+    {
+        result = GlobusGFSErrorWrapFailed(
+            "globus_ftp_control_data_write_file", result);
+        goto error_register;
+    }
+
+    GlobusGFSDebugExit();
+    return GLOBUS_SUCCESS;
+
+error_register:
+    if(op->tune)
+    {
+        globus_mutex_lock(&op->session_handle->mutex);
+        op->tune_pending--;
+        globus_mutex_unlock(&op->session_handle->mutex);
+    }
+    globus_free(bounce_info);
+
+error_alloc:
+    GlobusGFSDebugExitWithError();
+    return result;
+}
+
+void
+globus_gridftp_server_finished_session_start(
+    globus_gfs_operation_t              op,
+    globus_result_t                     result,
+    void *                              session_arg,
+    char *                              username,
+    char *                              home_dir)
+{
+    globus_gfs_finished_info_t          finished_info;
     int                                 code;
     GlobusGFSName(globus_gridftp_server_finished_session_start);
     GlobusGFSDebugEnter();
@@ -14213,53 +14759,86 @@ globus_i_gfs_data_request_buffer_send(
 
 
 
+static
 void
-globus_i_gfs_data_http_read_cb(
-    globus_xio_handle_t                 xio_handle, 
+globus_l_gfs_data_http_reader_pump(
+    globus_l_gfs_data_operation_t *     op);
+
+/* the body starts at remote byte start and byte base is stored at the
+ * first offset; bytes before base are read and dropped */
+static
+globus_l_gfs_data_http_reader_t *
+globus_l_gfs_data_http_reader_create(
+    char *                              delim,
+    globus_off_t                        start,
+    globus_off_t                        base,
+    globus_off_t                        length)
+{
+    globus_l_gfs_data_http_reader_t *   reader;
+
+    reader = (globus_l_gfs_data_http_reader_t *)
+        globus_calloc(1, sizeof(globus_l_gfs_data_http_reader_t));
+    if(reader == NULL)
+    {
+        return NULL;
+    }
+    globus_fifo_init(&reader->reads);
+    reader->delim = delim;
+    reader->base = base;
+    reader->part_offset = start;
+    reader->skip = base - start;
+    /* a multipart body starts with the headers of its first part */
+    reader->part_left = delim ? 0 : length;
+
+    return reader;
+}
+
+static
+void
+globus_l_gfs_data_http_reader_destroy(
+    globus_l_gfs_data_http_reader_t *   reader)
+{
+    globus_fifo_destroy(&reader->reads);
+    if(reader->delim)
+    {
+        globus_free(reader->delim);
+    }
+    if(reader->hdr)
+    {
+        globus_free(reader->hdr);
+    }
+    globus_free(reader);
+}
+
+/* hand the current read back to the DSI */
+static
+void
+globus_l_gfs_data_http_reader_finish(
+    globus_l_gfs_data_operation_t *     op,
     globus_result_t                     result,
-    globus_byte_t *                     buffer,
-    globus_size_t                       length,
-    globus_size_t                       nbytes, 
-    globus_xio_data_descriptor_t        data_desc,
-    void *                              user_arg)
+    globus_size_t                       nbytes,
+    globus_off_t                        offset,
+    globus_bool_t                       eof)
 {
-    globus_off_t                        offset;
+    globus_l_gfs_data_http_reader_t *   reader;
     globus_l_gfs_data_bounce_t *        bounce_info;
-    globus_bool_t                       eof;
-    GlobusGFSName(globus_l_gfs_data_http_read_cb);
+    GlobusGFSName(globus_l_gfs_data_http_reader_finish);
     GlobusGFSDebugEnter();
-    bounce_info = (globus_l_gfs_data_bounce_t *) user_arg;
 
-    offset = bounce_info->op->bytes_transferred;
-    bounce_info->op->bytes_transferred += nbytes;
-    
-    eof = globus_xio_error_is_eof(result);
-    if(eof)
-    {        
-        if(bounce_info->op->bytes_transferred < 
-            bounce_info->op->data_handle->http_length)
-        {
-            result = GlobusGFSErrorGeneric(
-                "HTTP data length was shorter than expected.");
-        }
-        else
-        {
-            result = GLOBUS_SUCCESS;
-        }
-    }
-    if(bounce_info->op->bytes_transferred > 
-        bounce_info->op->data_handle->http_length)
+    reader = op->data_handle->http_reader;
+    bounce_info = reader->current;
+    reader->current = NULL;
+    if(result != GLOBUS_SUCCESS)
     {
-        result = GlobusGFSErrorGeneric(
-            "HTTP data length was longer than expected.");
+        reader->failed = GLOBUS_TRUE;
     }
 
     bounce_info->callback.read(
         bounce_info->op,
         result,
-        buffer,
+        bounce_info->buffer,
         nbytes,
-        offset + bounce_info->op->write_delta,
+        offset + op->write_delta,
         eof,
         bounce_info->user_arg);
 
@@ -14268,6 +14847,632 @@ globus_i_gfs_data_http_read_cb(
     GlobusGFSDebugExit();
 }
 
+/* nbytes of the current part have been placed in the current buffer */
+static
+void
+globus_l_gfs_data_http_reader_deliver(
+    globus_l_gfs_data_operation_t *     op,
+    globus_size_t                       nbytes)
+{
+    globus_l_gfs_data_http_reader_t *   reader;
+    globus_off_t                        offset;
+
+    reader = op->data_handle->http_reader;
+    offset = reader->part_offset - reader->base;
+    reader->part_offset += nbytes;
+    if(reader->part_left > 0)
+    {
+        reader->part_left -= nbytes;
+    }
+    if(reader->skip > 0)
+    {
+        /* not asked for; keep the buffer for the next read */
+        reader->skip -= nbytes;
+        return;
+    }
+    op->bytes_transferred += nbytes;
+
+    globus_l_gfs_data_http_reader_finish(
+        op, GLOBUS_SUCCESS, nbytes, offset, GLOBUS_FALSE);
+}
+
+static
+globus_byte_t *
+globus_l_gfs_data_http_find(
+    globus_byte_t *                     buf,
+    globus_size_t                       len,
+    const char *                        str)
+{
+    globus_size_t                       str_len;
+    globus_size_t                       i;
+
+    str_len = strlen(str);
+    for(i = 0; i + str_len <= len; i++)
+    {
+        if(memcmp(buf + i, str, str_len) == 0)
+        {
+            return buf + i;
+        }
+    }
+    return NULL;
+}
+
+/* Content-Range: bytes <first>-<last>/<total or *> */
+static
+globus_result_t
+globus_l_gfs_data_http_parse_content_range(
+    const char *                        value,
+    globus_off_t *                      start,
+    globus_off_t *                      end)
+{
+    const char *                        ptr = value;
+    int                                 consumed;
+    GlobusGFSName(globus_l_gfs_data_http_parse_content_range);
+
+    while(isspace(*ptr))
+    {
+        ptr++;
+    }
+    if(strncasecmp(ptr, "bytes", 5) != 0)
+    {
+        goto error;
+    }
+    ptr += 5;
+    while(isspace(*ptr))
+    {
+        ptr++;
+    }
+    if(globus_libc_scan_off_t((char *) ptr, start, &consumed) < 1)
+    {
+        goto error;
+    }
+    ptr += consumed;
+    if(*ptr++ != '-' ||
+        globus_libc_scan_off_t((char *) ptr, end, &consumed) < 1)
+    {
+        goto error;
+    }
+    ptr += consumed;
+    if(*ptr != '/' || *start < 0 || *end < *start)
+    {
+        goto error;
+    }
+
+    return GLOBUS_SUCCESS;
+
+error:
+    return GlobusGFSErrorGeneric("Invalid Content-Range in HTTP response.");
+}
+
+/* Range: bytes=<spec>[,<spec>...]; returns the lowest first byte asked
+ * for, or -1 for a lone suffix range (bytes=-n), which only the
+ * response can place. */
+static
+globus_result_t
+globus_l_gfs_data_http_parse_range(
+    const char *                        value,
+    globus_off_t *                      first)
+{
+    const char *                        ptr = value;
+    globus_off_t                        start;
+    globus_off_t                        end;
+    globus_off_t                        lowest = -1;
+    globus_bool_t                       suffix = GLOBUS_FALSE;
+    int                                 specs = 0;
+    int                                 consumed;
+    GlobusGFSName(globus_l_gfs_data_http_parse_range);
+
+    while(isspace(*ptr))
+    {
+        ptr++;
+    }
+    if(strncasecmp(ptr, "bytes", 5) != 0)
+    {
+        goto error;
+    }
+    ptr += 5;
+    while(isspace(*ptr))
+    {
+        ptr++;
+    }
+    if(*ptr++ != '=')
+    {
+        goto error;
+    }
+
+    do
+    {
+        while(isspace(*ptr))
+        {
+            ptr++;
+        }
+        if(*ptr == '-')
+        {
+            ptr++;
+            if(globus_libc_scan_off_t((char *) ptr, &end, &consumed) < 1 ||
+                end <= 0)
+            {
+                goto error;
+            }
+            ptr += consumed;
+            suffix = GLOBUS_TRUE;
+        }
+        else
+        {
+            if(globus_libc_scan_off_t((char *) ptr, &start, &consumed) < 1 ||
+                start < 0)
+            {
+                goto error;
+            }
+            ptr += consumed;
+            if(*ptr++ != '-')
+            {
+                goto error;
+            }
+            if(isdigit(*ptr))
+            {
+                if(globus_libc_scan_off_t(
+                    (char *) ptr, &end, &consumed) < 1 || end < start)
+                {
+                    goto error;
+                }
+                ptr += consumed;
+            }
+            if(lowest < 0 || start < lowest)
+            {
+                lowest = start;
+            }
+        }
+        specs++;
+        while(isspace(*ptr))
+        {
+            ptr++;
+        }
+    } while(*ptr++ == ',');
+
+    if(*(ptr - 1) != '\0')
+    {
+        goto error;
+    }
+    if(suffix && specs > 1)
+    {
+        return GlobusGFSErrorGeneric(
+            "Suffix byte ranges can only be requested alone.");
+    }
+    *first = suffix ? -1 : lowest;
+
+    return GLOBUS_SUCCESS;
+
+error:
+    return GlobusGFSErrorGeneric("Invalid Range header in HTTP request.");
+}
+
+/* "--" plus the boundary parameter of a multipart/byteranges type */
+static
+char *
+globus_l_gfs_data_http_boundary(
+    const char *                        content_type)
+{
+    const char *                        ptr;
+    int                                 len;
+
+    if(strncasecmp(content_type, "multipart/byteranges", 20) != 0)
+    {
+        return NULL;
+    }
+    for(ptr = strchr(content_type, ';'); ptr; ptr = strchr(ptr, ';'))
+    {
+        ptr++;
+        while(isspace(*ptr))
+        {
+            ptr++;
+        }
+        if(strncasecmp(ptr, "boundary=", 9) == 0)
+        {
+            ptr += 9;
+            if(*ptr == '"')
+            {
+                ptr++;
+                len = strcspn(ptr, "\"");
+            }
+            else
+            {
+                len = strcspn(ptr, "; \t");
+            }
+            if(len == 0)
+            {
+                return NULL;
+            }
+            return globus_common_create_string("--%.*s", len, ptr);
+        }
+    }
+    return NULL;
+}
+
+/* response headers are kept by name as sent; match them without case */
+static
+char *
+globus_l_gfs_data_http_response_header(
+    globus_hashtable_t *                header_table,
+    const char *                        name)
+{
+    globus_list_t *                     header_list = NULL;
+    globus_xio_http_header_t *          header;
+    char *                              value = NULL;
+
+    globus_hashtable_to_list(header_table, &header_list);
+    while(!globus_list_empty(header_list))
+    {
+        header = globus_list_remove(&header_list, header_list);
+        if(value == NULL && strcasecmp(header->name, name) == 0)
+        {
+            value = header->value;
+        }
+    }
+    return value;
+}
+
+/* The current part is used up.  With a plain body the response must end
+ * here; with a multipart body, find the next part's headers in hdr, or
+ * the closing delimiter.  Sets more if hdr needs more of the body. */
+static
+globus_result_t
+globus_l_gfs_data_http_reader_parse(
+    globus_l_gfs_data_http_reader_t *   reader,
+    globus_bool_t *                     more)
+{
+    globus_byte_t *                     delim;
+    globus_byte_t *                     ptr;
+    globus_byte_t *                     end;
+    char *                              line;
+    char *                              next;
+    globus_off_t                        start = -1;
+    globus_off_t                        last = -1;
+    globus_size_t                       keep;
+    globus_result_t                     result;
+    GlobusGFSName(globus_l_gfs_data_http_reader_parse);
+
+    *more = GLOBUS_FALSE;
+    if(reader->delim == NULL)
+    {
+        if(reader->hdr_len > 0)
+        {
+            return GlobusGFSErrorGeneric(
+                "HTTP data length was longer than expected.");
+        }
+        if(reader->stream_eof)
+        {
+            reader->eof = GLOBUS_TRUE;
+        }
+        else
+        {
+            *more = GLOBUS_TRUE;
+        }
+        return GLOBUS_SUCCESS;
+    }
+
+    delim = globus_l_gfs_data_http_find(
+        reader->hdr, reader->hdr_len, reader->delim);
+    if(delim == NULL)
+    {
+        /* drop whatever cannot be the start of a delimiter */
+        keep = strlen(reader->delim) - 1;
+        if(reader->hdr_len > keep)
+        {
+            memmove(reader->hdr,
+                reader->hdr + reader->hdr_len - keep, keep);
+            reader->hdr_len = keep;
+        }
+        goto need_more;
+    }
+    ptr = delim + strlen(reader->delim);
+    if(ptr + 2 > reader->hdr + reader->hdr_len)
+    {
+        goto need_more;
+    }
+    if(ptr[0] == '-' && ptr[1] == '-')
+    {
+        reader->hdr_len = 0;
+        reader->eof = GLOBUS_TRUE;
+        return GLOBUS_SUCCESS;
+    }
+    end = globus_l_gfs_data_http_find(
+        ptr, reader->hdr + reader->hdr_len - ptr, "\r\n\r\n");
+    if(end == NULL)
+    {
+        goto need_more;
+    }
+
+    *end = '\0';
+    for(line = (char *) ptr; line; line = next)
+    {
+        next = strstr(line, "\r\n");
+        if(next)
+        {
+            *next = '\0';
+            next += 2;
+        }
+        if(strncasecmp(line, "Content-Range:", 14) == 0)
+        {
+            result = globus_l_gfs_data_http_parse_content_range(
+                line + 14, &start, &last);
+            if(result != GLOBUS_SUCCESS)
+            {
+                return result;
+            }
+        }
+    }
+    if(start < 0)
+    {
+        return GlobusGFSErrorGeneric(
+            "HTTP multipart response part has no Content-Range.");
+    }
+    if(start < reader->base)
+    {
+        return GlobusGFSErrorGeneric(
+            "HTTP response contains a range that was not requested.");
+    }
+    reader->part_offset = start;
+    reader->part_left = last - start + 1;
+
+    end += 4;
+    reader->hdr_len -= end - reader->hdr;
+    memmove(reader->hdr, end, reader->hdr_len);
+
+    return GLOBUS_SUCCESS;
+
+need_more:
+    if(reader->stream_eof)
+    {
+        return GlobusGFSErrorGeneric(
+            "HTTP multipart response ended early.");
+    }
+    *more = GLOBUS_TRUE;
+    return GLOBUS_SUCCESS;
+}
+
+static
+void
+globus_l_gfs_data_http_reader_data_cb(
+    globus_xio_handle_t                 xio_handle,
+    globus_result_t                     result,
+    globus_byte_t *                     buffer,
+    globus_size_t                       length,
+    globus_size_t                       nbytes,
+    globus_xio_data_descriptor_t        data_desc,
+    void *                              user_arg)
+{
+    globus_l_gfs_data_operation_t *     op;
+    globus_l_gfs_data_http_reader_t *   reader;
+    GlobusGFSName(globus_l_gfs_data_http_reader_data_cb);
+    GlobusGFSDebugEnter();
+
+    op = (globus_l_gfs_data_operation_t *) user_arg;
+    reader = op->data_handle->http_reader;
+
+    if(globus_xio_error_is_eof(result))
+    {
+        reader->stream_eof = GLOBUS_TRUE;
+        result = GLOBUS_SUCCESS;
+    }
+    if(result != GLOBUS_SUCCESS)
+    {
+        globus_l_gfs_data_http_reader_finish(
+            op, GlobusGFSErrorWrapFailed("HTTP read", result), 0,
+            reader->part_offset - reader->base, GLOBUS_FALSE);
+    }
+    else if(nbytes > 0)
+    {
+        globus_l_gfs_data_http_reader_deliver(op, nbytes);
+    }
+    globus_l_gfs_data_http_reader_pump(op);
+
+    GlobusGFSDebugExit();
+}
+
+static
+void
+globus_l_gfs_data_http_reader_hdr_cb(
+    globus_xio_handle_t                 xio_handle,
+    globus_result_t                     result,
+    globus_byte_t *                     buffer,
+    globus_size_t                       length,
+    globus_size_t                       nbytes,
+    globus_xio_data_descriptor_t        data_desc,
+    void *                              user_arg)
+{
+    globus_l_gfs_data_operation_t *     op;
+    globus_l_gfs_data_http_reader_t *   reader;
+    GlobusGFSName(globus_l_gfs_data_http_reader_hdr_cb);
+    GlobusGFSDebugEnter();
+
+    op = (globus_l_gfs_data_operation_t *) user_arg;
+    reader = op->data_handle->http_reader;
+
+    reader->hdr_len += nbytes;
+    if(globus_xio_error_is_eof(result))
+    {
+        reader->stream_eof = GLOBUS_TRUE;
+        result = GLOBUS_SUCCESS;
+    }
+    if(result != GLOBUS_SUCCESS)
+    {
+        globus_l_gfs_data_http_reader_finish(
+            op, GlobusGFSErrorWrapFailed("HTTP read", result), 0,
+            reader->part_offset - reader->base, GLOBUS_FALSE);
+    }
+    globus_l_gfs_data_http_reader_pump(op);
+
+    GlobusGFSDebugExit();
+}
+
+/* Serve queued DSI reads until one has to wait on the connection or the
+ * queue is empty.  Only one pump runs at a time (reader->busy). */
+static
+void
+globus_l_gfs_data_http_reader_pump(
+    globus_l_gfs_data_operation_t *     op)
+{
+    globus_l_gfs_data_http_reader_t *   reader;
+    globus_l_gfs_data_bounce_t *        bounce_info;
+    globus_result_t                     result;
+    globus_size_t                       nbytes;
+    globus_bool_t                       more;
+    GlobusGFSName(globus_l_gfs_data_http_reader_pump);
+    GlobusGFSDebugEnter();
+
+    reader = op->data_handle->http_reader;
+    for(;;)
+    {
+        globus_mutex_lock(&op->session_handle->mutex);
+        {
+            if(reader->current == NULL)
+            {
+                if(globus_fifo_empty(&reader->reads))
+                {
+                    reader->busy = GLOBUS_FALSE;
+                }
+                else
+                {
+                    reader->current = (globus_l_gfs_data_bounce_t *)
+                        globus_fifo_dequeue(&reader->reads);
+                }
+            }
+            bounce_info = reader->current;
+        }
+        globus_mutex_unlock(&op->session_handle->mutex);
+
+        if(bounce_info == NULL)
+        {
+            break;
+        }
+
+        if(reader->failed)
+        {
+            result = GlobusGFSErrorGeneric("HTTP GET already failed.");
+            goto error;
+        }
+        if(reader->eof)
+        {
+            globus_l_gfs_data_http_reader_finish(op, GLOBUS_SUCCESS, 0,
+                reader->part_offset - reader->base, GLOBUS_TRUE);
+            continue;
+        }
+
+        if(reader->part_left != 0)
+        {
+            /* part_left < 0 is a body of unknown length, read to eof */
+            nbytes = bounce_info->length;
+            if(reader->part_left > 0 && nbytes > reader->part_left)
+            {
+                nbytes = reader->part_left;
+            }
+            if(reader->skip > 0 && nbytes > reader->skip)
+            {
+                nbytes = reader->skip;
+            }
+            if(reader->hdr_len > 0)
+            {
+                /* part data read along with the part headers */
+                nbytes = GLOBUS_MIN(nbytes, reader->hdr_len);
+                memcpy(bounce_info->buffer, reader->hdr, nbytes);
+                reader->hdr_len -= nbytes;
+                memmove(reader->hdr, reader->hdr + nbytes, reader->hdr_len);
+                globus_l_gfs_data_http_reader_deliver(op, nbytes);
+                continue;
+            }
+            if(reader->stream_eof)
+            {
+                if(reader->part_left < 0)
+                {
+                    reader->eof = GLOBUS_TRUE;
+                    continue;
+                }
+                result = GlobusGFSErrorGeneric(
+                    "HTTP data length was shorter than expected.");
+                goto error;
+            }
+            result = globus_xio_register_read(
+                op->data_handle->http_handle,
+                bounce_info->buffer,
+                nbytes,
+                1,
+                NULL,
+                globus_l_gfs_data_http_reader_data_cb,
+                op);
+            if(result != GLOBUS_SUCCESS)
+            {
+                result = GlobusGFSErrorWrapFailed(
+                    "globus_xio_register_read", result);
+                goto error;
+            }
+            break;
+        }
+
+        result = globus_l_gfs_data_http_reader_parse(reader, &more);
+        if(result != GLOBUS_SUCCESS)
+        {
+            goto error;
+        }
+        if(!more)
+        {
+            continue;
+        }
+
+        /* read more of the body into hdr; for a plain body this is the
+         * one byte that shows whether it ends where it should */
+        if(reader->hdr_len == reader->hdr_size)
+        {
+            globus_byte_t *             hdr;
+
+            if(reader->hdr_size >= 64 * 1024)
+            {
+                result = GlobusGFSErrorGeneric(
+                    "HTTP multipart response part headers are too long.");
+                goto error;
+            }
+            hdr = globus_realloc(reader->hdr, reader->hdr_size + 4096);
+            if(hdr == NULL)
+            {
+                result = GlobusGFSErrorMemory("hdr");
+                goto error;
+            }
+            reader->hdr = hdr;
+            reader->hdr_size += 4096;
+        }
+        result = globus_xio_register_read(
+            op->data_handle->http_handle,
+            reader->hdr + reader->hdr_len,
+            reader->delim ? reader->hdr_size - reader->hdr_len : 1,
+            1,
+            NULL,
+            globus_l_gfs_data_http_reader_hdr_cb,
+            op);
+        if(result != GLOBUS_SUCCESS)
+        {
+            result = GlobusGFSErrorWrapFailed(
+                "globus_xio_register_read", result);
+            goto error;
+        }
+        break;
+
+error:
+        globus_l_gfs_data_http_reader_finish(op, result, 0,
+            reader->part_offset - reader->base, GLOBUS_FALSE);
+    }
+
+    GlobusGFSDebugExit();
+}
+
+static
+void
+globus_l_gfs_data_http_reader_kickout(
+    void *                              user_arg)
+{
+    globus_l_gfs_data_http_reader_pump(
+        (globus_l_gfs_data_operation_t *) user_arg);
+}
+
 
 void
 globus_i_gfs_data_http_write_cb(
@@ -14360,6 +15565,11 @@ globus_l_gfs_data_http_transfer_cb(
     
     globus_xio_close(op->data_handle->http_handle, NULL);
     globus_libc_unsetenv("GLOBUS_GFS_EXTRA_CA_CERTS");
+    if(op->data_handle->http_reader)
+    {
+        globus_l_gfs_data_http_reader_destroy(op->data_handle->http_reader);
+        op->data_handle->http_reader = NULL;
+    }
 
     if(reply->result != GLOBUS_SUCCESS || result != GLOBUS_SUCCESS)
     {
@@ -14894,6 +16104,15 @@ globus_i_gfs_data_http_get(
     globus_bool_t                       eof;
     globus_bool_t                       retry = GLOBUS_FALSE;
     char *                              ptr;
+    char *                              range = NULL;
+    char *                              value;
+    char *                              delim = NULL;
+    globus_off_t                        first = 0;
+    globus_off_t                        base = 0;
+    globus_off_t                        start = 0;
+    globus_off_t                        range_start;
+    globus_off_t                        range_end;
+    globus_l_gfs_data_http_reader_t *   reader;
     GlobusGFSName(globus_l_gfs_data_http_get);
     GlobusGFSDebugEnter();
     
@@ -14937,6 +16156,10 @@ globus_i_gfs_data_http_get(
     /* set individual headers */    
     for (i = 0; i < count; i++)
     {
+        if(strcasecmp(headers[i].name, "Range") == 0)
+        {
+            range = headers[i].value;
+        }
         result = globus_xio_attr_cntl(
                 attr,
                 op->session_handle->http_driver,
@@ -15117,6 +16340,96 @@ globus_i_gfs_data_http_get(
             status_code, &header_table, NULL, &op->user_msg);
     }        
     
+    /* with a Range request, remote byte n is stored at
+     * offset + n - first, first being the lowest byte asked for.  the
+     * body may be one range (206), several (206 multipart/byteranges),
+     * or the whole file when the server ignored Range or an If-Range
+     * validator no longer matched (200).  a body starting before first
+     * has its leading bytes dropped. */
+    if(range != NULL)
+    {
+        result = globus_l_gfs_data_http_parse_range(range, &first);
+        if(result != GLOBUS_SUCCESS)
+        {
+            goto open_exit;
+        }
+        value = globus_l_gfs_data_http_response_header(
+            &header_table, "Content-Type");
+        if(status_code == 206 && value &&
+            strncasecmp(value, "multipart/byteranges", 20) == 0)
+        {
+            delim = globus_l_gfs_data_http_boundary(value);
+            if(delim == NULL || first < 0)
+            {
+                result = GlobusGFSErrorGeneric(
+                    "Unexpected multipart/byteranges HTTP response.");
+                goto range_exit;
+            }
+            base = first;
+            length = -1;
+        }
+        else if(status_code == 206)
+        {
+            value = globus_l_gfs_data_http_response_header(
+                &header_table, "Content-Range");
+            if(value == NULL)
+            {
+                result = GlobusGFSErrorGeneric(
+                    "Partial HTTP response has no Content-Range.");
+                goto open_exit;
+            }
+            result = globus_l_gfs_data_http_parse_content_range(
+                value, &range_start, &range_end);
+            if(result != GLOBUS_SUCCESS)
+            {
+                goto open_exit;
+            }
+            if(first < 0)
+            {
+                first = range_start;
+            }
+            base = range_start;
+            length = range_end - range_start + 1;
+        }
+        else
+        {
+            if(first < 0)
+            {
+                result = GlobusGFSErrorGeneric(
+                    "HTTP server sent the whole file for a suffix range.");
+                goto open_exit;
+            }
+            base = 0;
+            length = -1;
+        }
+        start = base;
+        if(base < first)
+        {
+            if(length >= 0 && length <= first - base)
+            {
+                result = GlobusGFSErrorGeneric(
+                    "HTTP response does not contain the requested range.");
+                goto range_exit;
+            }
+            base = first;
+        }
+        else
+        {
+            offset += base - first;
+        }
+    }
+
+    reader = globus_l_gfs_data_http_reader_create(
+        delim, start, base, length);
+    if(reader == NULL)
+    {
+        result = GlobusGFSErrorMemory("http_reader");
+        goto range_exit;
+    }
+    if(length >= 0)
+    {
+        length -= base - start;
+    }
     
     /* set up internal file recv request */    
     recv_info = (globus_gfs_transfer_info_t *)
@@ -15151,6 +16464,7 @@ globus_i_gfs_data_http_get(
             
     data_handle->http_handle = handle;
     data_handle->http_length = length;
+    data_handle->http_reader = reader;
     data_handle->http_ip = globus_libc_strdup(op->http_ip);
     op->data_handle = data_handle;
 
@@ -15167,6 +16481,11 @@ globus_i_gfs_data_http_get(
     
     return GLOBUS_SUCCESS;
 
+range_exit:
+    if(delim)
+    {
+        globus_free(delim);
+    }
 open_exit:
     globus_xio_close(handle, NULL);
 response_exit:
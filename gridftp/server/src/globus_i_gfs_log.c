@@ -645,6 +645,7 @@ globus_i_gfs_log_create_transfer_event_msg(
     char *                              type,
     char *                              username,
     char *                              retransmit_str,
+    char *                              autotune_str,
     char *                              taskid)
 {
     char *                              transfermsg;
@@ -662,6 +663,7 @@ globus_i_gfs_log_create_transfer_event_msg(
         "remoteIP=%s "
         "type=%s "
         "taskid=%s"
+        "%s%s"
         "%s%s",
         username,
         fname,
@@ -674,7 +676,9 @@ globus_i_gfs_log_create_transfer_event_msg(
         type,
         taskid ? taskid : "none",
         retransmit_str ? " retrans=" : "",
-        retransmit_str ? retransmit_str : "");
+        retransmit_str ? retransmit_str : "",
+        autotune_str ? " autotune=" : "",
+        autotune_str ? autotune_str : "");
 
     GlobusGFSDebugExit();
     return transfermsg;
@@ -696,6 +700,7 @@ globus_i_gfs_log_transfer(
     char *                              type,
     char *                              username,
     char *                              retransmit_str,
+    char *                              autotune_str,
     char *                              taskid)
 {
     time_t                              start_time_time;
@@ -757,6 +762,7 @@ globus_i_gfs_log_transfer(
         "TYPE=%s "
         "CODE=%d "
         "TASKID=%s"
+        "%s%s"
         "%s%s\n",
         /* end time */
         end_tm_time.tm_year + 1900,
@@ -790,7 +796,9 @@ globus_i_gfs_log_transfer(
         code,
         taskid ? taskid : "none",
         retransmit_str ? " retrans=" : "",
-        retransmit_str ? retransmit_str : "");
+        retransmit_str ? retransmit_str : "",
+        autotune_str ? " AUTOTUNE=" : "",
+        autotune_str ? autotune_str : "");
 
     out_buf[sizeof(out_buf)-1] = '\0';
 
@@ -73,6 +73,7 @@ globus_i_gfs_log_transfer(
     char *                              type,
     char *                              username,
     char *                              retrans,
+    char *                              autotune,
     char *                              taskid);
 
 char *
@@ -87,6 +88,7 @@ globus_i_gfs_log_create_transfer_event_msg(
     char *                              type,
     char *                              username,
     char *                              retrans,
+    char *                              autotune,
     char *                              taskid);
 
 #endif
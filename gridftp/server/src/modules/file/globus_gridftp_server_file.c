@@ -14,7 +14,13 @@
  * limitations under the License.
  */
 
+/* O_DIRECT and sync_file_range() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "globus_common.h"
+#include "globus_buffer_pool.h"
 #include "globus_gridftp_server.h"
 #include "globus_xio.h"
 #include "globus_xio_file_driver.h"
@@ -27,6 +33,9 @@
 #ifndef TARGET_ARCH_WIN32
 #include <grp.h>
 #endif
+#ifdef __linux__
+#include <sys/xattr.h>
+#endif
 
 #ifdef TARGET_ARCH_WIN32
 #include <time.h>
@@ -47,7 +56,14 @@
 #define MAXPATHLEN 4096
 #endif
 
-#define GFS_L_FILE_CKSM_SUPPORT "MD5:10;ADLER32:10;SHA1:10;SHA256:11;SHA512:12;"
+#define GFS_L_FILE_CKSM_SUPPORT "MD5:10;ADLER32:10;CRC32C:10;SHA1:10;SHA256:11;SHA512:12;"
+
+/* hex digest of the largest supported checksum plus nul */
+#define GFS_L_FILE_CKSM_MAX_LEN (SHA512_DIGEST_LENGTH * 2 + 1)
+
+/* extended attribute that holds a cached checksum, see
+ * globus_l_gfs_file_cksm_cache_lookup() */
+#define GFS_L_FILE_CKSM_CACHE_XATTR "user.globus.cksm."
 
 GlobusDebugDeclare(GLOBUS_GRIDFTP_SERVER_FILE);
 
@@ -85,9 +101,45 @@ enum
     GLOBUS_GFS_FILE_CKSM_TYPE_MD5,
     GLOBUS_GFS_FILE_CKSM_TYPE_SHA1,
     GLOBUS_GFS_FILE_CKSM_TYPE_SHA256,
-    GLOBUS_GFS_FILE_CKSM_TYPE_SHA512
+    GLOBUS_GFS_FILE_CKSM_TYPE_SHA512,
+    GLOBUS_GFS_FILE_CKSM_TYPE_CRC32C
 };
 
+typedef struct
+{
+    unsigned char                       type;
+    MD5_CTX                             mdctx;
+    SHA_CTX                             sha1ctx;
+    SHA256_CTX                          sha256ctx;
+    SHA512_CTX                          sha512ctx;
+    uint32_t                            adler32ctx;
+    uint32_t                            crc32cctx;
+} globus_l_gfs_file_cksm_ctx_t;
+
+/* a contiguous piece of a combinable (adler32, crc32c) checksum */
+typedef struct globus_l_gfs_file_cksm_range_s
+{
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    uint32_t                            partial;
+    struct globus_l_gfs_file_cksm_range_s * next;
+} globus_l_gfs_file_cksm_range_t;
+
+struct globus_l_gfs_file_cksm_monitor_s;
+
+/* one block in flight in the parallel checksum engine */
+typedef struct
+{
+    struct globus_l_gfs_file_cksm_monitor_s * monitor;
+    int                                 index;
+    globus_off_t                        offset;
+    globus_size_t                       length;
+    globus_size_t                       nbytes;
+    uint32_t                            partial;
+    globus_bool_t                       done;
+    globus_byte_t *                     buffer;
+} globus_l_gfs_file_cksm_chunk_t;
+
 typedef struct globus_l_gfs_file_cksm_monitor_s
 {
     globus_gfs_operation_t              op;
@@ -106,12 +158,28 @@ typedef struct globus_l_gfs_file_cksm_monitor_s
 
     int                                 delay_read;
 
-    unsigned char                       cksum_type;
-    MD5_CTX                             mdctx;
-    SHA_CTX                             sha1ctx;
-    SHA256_CTX                          sha256ctx;
-    SHA512_CTX                          sha512ctx;
-    uint32_t                            adler32ctx;
+    globus_xio_handle_t                 handle;
+    globus_l_gfs_file_cksm_ctx_t        ctx;
+
+    /* file as it was when the checksum started, to be cached under if it
+     * has not changed by the end; NULL if not caching */
+    char *                              cache_path;
+    char *                              cache_alg;
+    struct stat                         cache_stat;
+
+    /* parallel engine state, only used if chunks != NULL */
+    globus_mutex_t                      lock;
+    globus_l_gfs_file_cksm_chunk_t *    chunks;
+    int                                 depth;
+    int                                 active;
+    globus_xio_system_file_t            fd;
+    globus_off_t                        end;
+    globus_off_t                        next_offset;
+    int                                 next_index;
+    int                                 hash_index;
+    globus_bool_t                       hashing;
+    globus_bool_t                       eof;
+    globus_result_t                     result;
 
     globus_byte_t                       buffer[];
 } globus_l_gfs_file_cksm_monitor_t;
@@ -127,7 +195,7 @@ typedef struct
 typedef struct
 {
     globus_mutex_t                      lock;
-    globus_memory_t                     mem;
+    globus_buffer_pool_t                mem;
     globus_priority_q_t                 queue;
     globus_list_t *                     buffer_list;
     globus_gfs_operation_t              op;
@@ -147,12 +215,47 @@ typedef struct
     globus_bool_t                       aborted;
     int                                 concurrency_check;
     int                                 concurrency_check_interval;
+    /* buffers a send holds, on buffer_list or in flight; 0 when receiving */
+    int                                 buffer_count;
     char *                              expected_cksm;
     char *                              expected_cksm_alg;
     time_t                              utime;
     /* added for multicast stuff, but cold be generally useful */
     gfs_l_file_session_t *              session;
 
+    /* checksum of the data as it is written, NULL if not being kept */
+    globus_l_gfs_file_cksm_ctx_t *      inline_cksm;
+    globus_off_t                        inline_cksm_offset;
+    globus_l_gfs_file_cksm_range_t *    inline_cksm_ranges;
+
+    /* send straight from the fd instead of reading into buffer_list */
+    globus_bool_t                       sendfile;
+    globus_off_t                        file_size;
+
+    /* fd of a file on the default disk stack, for sendfile and I/O hints;
+     * GLOBUS_XIO_FILE_INVALID_HANDLE with a custom stack */
+    globus_xio_system_file_t            disk_fd;
+    /* direct_io is on and O_DIRECT is currently set on disk_fd */
+    globus_bool_t                       direct;
+    /* received blocks waiting in queue for the gap before them to fill */
+    int                                 queued_count;
+    /* largest write built from contiguous received blocks, 0 for one
+     * block per write */
+    globus_size_t                       extent_size;
+    /* where the next read ahead hint for a send starts */
+    globus_off_t                        readahead_offset;
+
+    /* with sync_writes, ranges written since the last flush and the ones
+     * being flushed now; neither is reported as received until it is on
+     * disk.  NULL when the data layer's sync is used instead */
+    globus_range_list_t                 dirty_ranges;
+    globus_range_list_t                 flush_ranges;
+    globus_off_t                        dirty_bytes;
+    globus_off_t                        sync_threshold;
+    globus_bool_t                       flushing;
+    /* close was asked for while a flush was in progress */
+    globus_bool_t                       close_pending;
+
     globus_result_t                     finish_result;
 } globus_l_file_monitor_t;
 
@@ -190,6 +293,22 @@ globus_l_gfs_file_cksm(
     globus_off_t                        length,
     globus_l_gfs_file_cksm_cb_t         internal_cb,
     void *                              internal_cb_arg);
+
+static
+globus_bool_t
+globus_l_gfs_file_inline_cksm_final(
+    globus_l_file_monitor_t *           monitor,
+    char *                              cksm);
+
+static
+void
+globus_l_gfs_file_cksm_cache_store(
+    const char *                        pathname,
+    const struct stat *                 stat_buf,
+    const char *                        algorithm,
+    globus_off_t                        offset,
+    globus_off_t                        length,
+    const char *                        cksm);
     
 static
 globus_result_t
@@ -330,8 +449,17 @@ globus_l_gfs_file_monitor_init(
         goto error_alloc;
     }
        
-    rc = globus_memory_init(&monitor->mem, block_size, optimal_count);
-    if(!rc)
+    /* page aligned so the buffers can be used with direct_io; anything
+     * beyond optimal_count left over from concurrency increases is
+     * released as it comes back
+     */
+    rc = globus_buffer_pool_init(
+        &monitor->mem,
+        block_size,
+        optimal_count,
+        optimal_count,
+        GLOBUS_BUFFER_POOL_PAGE_ALIGNED | GLOBUS_BUFFER_POOL_NUMA_LOCAL);
+    if(rc != GLOBUS_SUCCESS)
     {
         globus_free(monitor);
         result = GlobusGFSErrorMemory("buffer");
@@ -354,10 +482,25 @@ globus_l_gfs_file_monitor_init(
     monitor->aborted = GLOBUS_FALSE;
     monitor->concurrency_check = 2;
     monitor->concurrency_check_interval = 2;
+    monitor->buffer_count = 0;
     monitor->expected_cksm = NULL;
     monitor->expected_cksm_alg = NULL;
     monitor->utime = -1;
     monitor->pathname = NULL;
+    monitor->sendfile = GLOBUS_FALSE;
+    monitor->inline_cksm = NULL;
+    monitor->inline_cksm_ranges = NULL;
+    monitor->disk_fd = GLOBUS_XIO_FILE_INVALID_HANDLE;
+    monitor->direct = GLOBUS_FALSE;
+    monitor->queued_count = 0;
+    monitor->extent_size = globus_gfs_config_get_int("write_extent_size");
+    monitor->readahead_offset = 0;
+    monitor->dirty_ranges = NULL;
+    monitor->flush_ranges = NULL;
+    monitor->dirty_bytes = 0;
+    monitor->sync_threshold = 0;
+    monitor->flushing = GLOBUS_FALSE;
+    monitor->close_pending = GLOBUS_FALSE;
 
     *u_monitor = monitor;
     
@@ -388,7 +531,7 @@ globus_l_gfs_file_monitor_destroy(
         {
             if(buf_info->buffer)
             {
-                globus_memory_push_node(&monitor->mem, buf_info->buffer);
+                globus_buffer_pool_put(&monitor->mem, buf_info->buffer);
             }
             globus_free(buf_info);
         }
@@ -399,7 +542,7 @@ globus_l_gfs_file_monitor_destroy(
         list = globus_list_rest(list))
     {
         buffer = (globus_byte_t *) globus_list_first(list);
-        globus_memory_push_node(&monitor->mem, buffer);
+        globus_buffer_pool_put(&monitor->mem, buffer);
     }
     
     if(monitor->pathname)
@@ -415,10 +558,30 @@ globus_l_gfs_file_monitor_destroy(
     {
         globus_free(monitor->expected_cksm_alg);
     }
+    if(monitor->inline_cksm)
+    {
+        globus_free(monitor->inline_cksm);
+    }
+    while(monitor->inline_cksm_ranges)
+    {
+        globus_l_gfs_file_cksm_range_t *    range;
+
+        range = monitor->inline_cksm_ranges;
+        monitor->inline_cksm_ranges = range->next;
+        globus_free(range);
+    }
+    if(monitor->dirty_ranges)
+    {
+        globus_range_list_destroy(monitor->dirty_ranges);
+    }
+    if(monitor->flush_ranges)
+    {
+        globus_range_list_destroy(monitor->flush_ranges);
+    }
     
     globus_priority_q_destroy(&monitor->queue);
     globus_list_free(monitor->buffer_list);
-    globus_memory_destroy(&monitor->mem);
+    globus_buffer_pool_destroy(&monitor->mem);
     globus_mutex_destroy(&monitor->lock);
     globus_free(monitor);
 
@@ -486,6 +649,7 @@ globus_l_gfs_file_close_cb(
     void *                              user_arg)
 {
     globus_l_file_monitor_t *           monitor;
+    char                                cksm[GFS_L_FILE_CKSM_MAX_LEN];
     GlobusGFSName(globus_l_gfs_file_close_cb);
 
     monitor = (globus_l_file_monitor_t *) user_arg;
@@ -513,6 +677,20 @@ globus_l_gfs_file_close_cb(
         }
         
         if(monitor->finish_result == GLOBUS_SUCCESS && 
+            monitor->expected_cksm != NULL &&
+            globus_l_gfs_file_inline_cksm_final(monitor, cksm))
+        {
+            /* every byte of the file went past write_cb */
+            globus_l_gfs_file_cksm_cache_store(
+                monitor->pathname,
+                NULL,
+                monitor->expected_cksm_alg,
+                0,
+                -1,
+                cksm);
+            globus_l_gfs_file_cksm_verify(GLOBUS_SUCCESS, cksm, monitor);
+        }
+        else if(monitor->finish_result == GLOBUS_SUCCESS && 
             monitor->expected_cksm != NULL)
         {
             /* verify file before finishing */
@@ -552,6 +730,12 @@ globus_l_gfs_file_close_kickout(
     globus_l_gfs_file_monitor_destroy(monitor);
 }
 
+static
+void
+globus_l_gfs_file_sync_start(
+    globus_l_file_monitor_t *           monitor);
+
+/* Called LOCKED */
 static
 void
 globus_l_gfs_file_close(
@@ -562,6 +746,19 @@ globus_l_gfs_file_close(
     globus_result_t                     result;
 
     monitor->finish_result = in_result;
+    if(monitor->flushing)
+    {
+        /* the flush callback closes when it is done with the fd */
+        monitor->close_pending = GLOBUS_TRUE;
+        return;
+    }
+    if(monitor->dirty_bytes > 0 && in_result == GLOBUS_SUCCESS)
+    {
+        /* whatever is left is under the threshold */
+        monitor->close_pending = GLOBUS_TRUE;
+        globus_l_gfs_file_sync_start(monitor);
+        return;
+    }
     if(monitor->file_handle)
     {
         result = globus_xio_register_close(
@@ -770,6 +967,62 @@ globus_l_gfs_file_destroy_stat(
 #define GFS_STAT_COUNT_MAX 1000
 #define GFS_STAT_TIME 10
 
+#ifndef WIN32
+/* just what a listing needs from a struct dirent, so a directory can be
+ * read into a compact array for sorting */
+typedef struct
+{
+    char *                              name;
+    ino_t                               ino;
+    unsigned char                       type;
+} globus_l_gfs_file_dirent_t;
+
+static
+void
+globus_l_gfs_file_dirent_set(
+    globus_l_gfs_file_dirent_t *        entry,
+    struct dirent *                     dir_entry)
+{
+    entry->name = globus_libc_strdup(dir_entry->d_name);
+    entry->ino = dir_entry->d_ino;
+#ifdef _DIRENT_HAVE_D_TYPE
+    entry->type = dir_entry->d_type;
+#else
+    entry->type = 0;
+#endif
+}
+
+static
+void
+globus_l_gfs_file_dirent_free(
+    globus_l_gfs_file_dirent_t *        entries,
+    int                                 entry_count)
+{
+    int                                 i;
+
+    for(i = 0; i < entry_count; i++)
+    {
+        globus_free(entries[i].name);
+    }
+    if(entries)
+    {
+        globus_free(entries);
+    }
+}
+
+/* same order as alphasort() */
+static
+int
+globus_l_gfs_file_dirent_cmp(
+    const void *                        a,
+    const void *                        b)
+{
+    return strcoll(
+        ((const globus_l_gfs_file_dirent_t *) a)->name,
+        ((const globus_l_gfs_file_dirent_t *) b)->name);
+}
+#endif
+
 static
 void
 globus_l_gfs_file_stat(
@@ -1058,44 +1311,98 @@ done_fake:
 
 #else
     {
+        DIR *                           dir;
         struct dirent *                 dir_entry;
-        struct dirent **                entries = NULL;
+        globus_l_gfs_file_dirent_t *    entries = NULL;
+        globus_l_gfs_file_dirent_t      stream_entry;
+        globus_l_gfs_file_dirent_t *    entry;
+        int                             entry_count = 0;
+        int                             entry_max = 0;
+        int                             entry_ndx = 0;
+        int                             seen_count = 0;
+        int                             sort_max;
+        int                             dir_fd;
+        int                             rc;
         int                             i;
-        int                             j;
         char                            dir_path[MAXPATHLEN];
+        char                            path[MAXPATHLEN];
         int                             stat_limit_check = GFS_STAT_COUNT_CHECK;
         int                             stat_limit_max = GFS_STAT_COUNT_MAX;
         time_t                          stat_limit_time;
         globus_bool_t                   check_cdir = GLOBUS_TRUE;
+        globus_bool_t                   dir_eof = GLOBUS_FALSE;
         globus_bool_t                   slow_listings = GLOBUS_FALSE;
         int                             slow_listing_thresh;
 
         stat_limit_time = time(NULL) + GFS_STAT_TIME;
         
-        total_stat_count = scandir(
-            stat_info->pathname, 
-            &entries, 
-            NULL, 
-            (getenv("FTPNOSORT") ? NULL : alphasort));
-        if(total_stat_count < 0)
-        {
-            result = GlobusGFSErrorSystemError("scandir", errno);
+        dir = opendir(stat_info->pathname);
+        if(!dir)
+        {
+            result = GlobusGFSErrorSystemError("opendir", errno);
             goto error_open;
         }
+        dir_fd = dirfd(dir);
+
+        /* sorting needs every name up front, so only directories up to
+         * sort_dirlist_max entries are sorted.  anything bigger is listed
+         * in directory order as it is read, keeping memory bounded. */
+        sort_max = getenv("FTPNOSORT") ? 
+            0 : globus_gfs_config_get_int("sort_dirlist_max");
+        while(entry_count < sort_max)
+        {
+            errno = 0;
+            dir_entry = readdir(dir);
+            if(!dir_entry)
+            {
+                if(errno != 0)
+                {
+                    result = GlobusGFSErrorSystemError("readdir", errno);
+                    goto error_entries;
+                }
+                dir_eof = GLOBUS_TRUE;
+                break;
+            }
+            if(entry_count == entry_max)
+            {
+                globus_l_gfs_file_dirent_t *  tmp_entries;
 
-        slow_listing_thresh = globus_gfs_config_get_int("slow_dirlist");
-        if(slow_listing_thresh > 0 && total_stat_count > slow_listing_thresh)
+                entry_max = entry_max ? entry_max * 2 : GFS_STAT_COUNT_MAX;
+                tmp_entries = (globus_l_gfs_file_dirent_t *) globus_realloc(
+                    entries, sizeof(globus_l_gfs_file_dirent_t) * entry_max);
+                if(!tmp_entries)
+                {
+                    result = GlobusGFSErrorMemory("entries");
+                    goto error_entries;
+                }
+                entries = tmp_entries;
+            }
+            globus_l_gfs_file_dirent_set(&entries[entry_count], dir_entry);
+            if(!entries[entry_count].name)
+            {
+                result = GlobusGFSErrorMemory("entries");
+                goto error_entries;
+            }
+            entry_count++;
+        }
+        if(dir_eof)
         {
-            slow_listings = GLOBUS_TRUE;
+            qsort(
+                entries,
+                entry_count,
+                sizeof(globus_l_gfs_file_dirent_t),
+                globus_l_gfs_file_dirent_cmp);
+            total_stat_count = entry_count;
         }
 
+        slow_listing_thresh = globus_gfs_config_get_int("slow_dirlist");
+
         stat_array = (globus_gfs_stat_t *) globus_malloc(
-            sizeof(globus_gfs_stat_t) * 
-            (GLOBUS_MIN(stat_limit_max, total_stat_count) + 1));
+            sizeof(globus_gfs_stat_t) * (stat_limit_max + 1));
         if(!stat_array)
         {
             result = GlobusGFSErrorMemory("stat_array");
-            goto error_open;
+            goto error_entries;
         }
         
         snprintf(
@@ -1108,53 +1415,97 @@ done_fake:
         dir_path[MAXPATHLEN - 1] = '\0';
         
         i = 0;
-        j = 0;
-        while(j < total_stat_count)
-        {            
-            char                        path[MAXPATHLEN];
-            
-            dir_entry = entries[j++];
-            snprintf(path, sizeof(path), "%s/%s", dir_path, dir_entry->d_name);
+        for(;;)
+        {
+            if(entry_ndx < entry_count)
+            {
+                entry = &entries[entry_ndx++];
+            }
+            else if(dir_eof)
+            {
+                break;
+            }
+            else
+            {
+                errno = 0;
+                dir_entry = readdir(dir);
+                if(!dir_entry)
+                {
+                    if(errno != 0)
+                    {
+                        result = GlobusGFSErrorSystemError("readdir", errno);
+                    }
+                    break;
+                }
+                entry = &stream_entry;
+                entry->name = dir_entry->d_name;
+                entry->ino = dir_entry->d_ino;
+#ifdef _DIRENT_HAVE_D_TYPE
+                entry->type = dir_entry->d_type;
+#endif
+            }
+            seen_count++;
+
+            /* entries past the threshold are faked when the filesystem
+             * is too slow to stat them all */
+            if(slow_listing_thresh > 0 && !slow_listings &&
+                (total_stat_count > slow_listing_thresh ||
+                    seen_count > slow_listing_thresh))
+            {
+                slow_listings = GLOBUS_TRUE;
+            }
+
+            base_error = GLOBUS_GRIDFTP_SERVER_CONTROL_STAT_SUCCESS;
+            *symlink_target = '\0';
+            snprintf(path, sizeof(path), "%s/%s", dir_path, entry->name);
             path[MAXPATHLEN - 1] = '\0';
             
             /* fake a stat response if stats are slow, d_type is valid,
              * and indicates a file or dir */
 #ifndef _DIRENT_HAVE_D_TYPE
-            globus_gfs_log_message(
-                GLOBUS_GFS_LOG_WARN,
-                "Slow listing behavior enabled but system does not support it.");
+            if(slow_listings && seen_count == slow_listing_thresh + 1)
+            {
+                globus_gfs_log_message(
+                    GLOBUS_GFS_LOG_WARN,
+                    "Slow listing behavior enabled but system does not "
+                    "support it.");
+            }
 #else
             if(slow_listings &&
-                (dir_entry->d_type == DT_DIR || dir_entry->d_type == DT_REG))
+                (entry->type == DT_DIR || entry->type == DT_REG))
             {
                 stat_buf = (struct stat)
                 {
                     .st_mode = S_IRWXU |
-                        ((dir_entry->d_type == DT_DIR) ? S_IFDIR : S_IFREG),
+                        ((entry->type == DT_DIR) ? S_IFDIR : S_IFREG),
                     .st_size = 1,
                     .st_mtime = -1,
                     .st_atime = -1,
                     .st_ctime = -1,
                     .st_dev = 1,
-                    .st_ino = dir_entry->d_ino,
+                    .st_ino = entry->ino,
                     .st_nlink = 1,
                 };
             }
             else
 #endif
             {
-                /* lstat is the same as stat when not operating on a link */
-                if(lstat(path, &stat_buf) != 0)
+                /* stat relative to the open directory so the kernel
+                 * doesn't walk the full path again for every entry */
+#ifdef AT_SYMLINK_NOFOLLOW
+                rc = fstatat(
+                    dir_fd, entry->name, &stat_buf, AT_SYMLINK_NOFOLLOW);
+#else
+                rc = lstat(path, &stat_buf);
+#endif
+                if(rc != 0)
                 {
-                    result = GlobusGFSErrorSystemError("lstat", errno);
-                    globus_free(dir_entry);
                     /* just skip invalid entries */
                     continue;
                 }
                 /* if this is a link we still need to stat to get the info we are
                     interested in and then use realpath() to get the full path of
                     the symlink target */
-                *symlink_target = '\0';
                 if(S_ISLNK(stat_buf.st_mode))
                 {
                     int stat_result = 0;
@@ -1166,7 +1517,6 @@ done_fake:
                     }
                     else if(stat(path, &stat_buf) != 0)
                     {
-                        globus_free(dir_entry);
                         /* just skip invalid entries */
                         continue;
                     }
@@ -1175,7 +1525,6 @@ done_fake:
                         int nchars = readlink(path, symlink_target, MAXPATHLEN);
                         if (nchars < 0)
                         {
-                            globus_free(dir_entry);
                             /* just skip invalid entries */
                             continue;
                         }
@@ -1185,21 +1534,25 @@ done_fake:
                 }
             }
             globus_l_gfs_file_copy_stat(
-                    &stat_array[i], &stat_buf, dir_entry->d_name, symlink_target, link_stat_buf.st_mode, base_error);
+                    &stat_array[i], &stat_buf, entry->name, symlink_target, link_stat_buf.st_mode, base_error);
             
-            /* set nlink to total files in dir for . entry */
+            /* set nlink to total files in dir for . entry, if the whole
+             * directory was read up front */
             if(check_cdir &&
-                dir_entry->d_name[0] == '.' && dir_entry->d_name[1] == '\0')
+                entry->name[0] == '.' && entry->name[1] == '\0')
             {
                 check_cdir = GLOBUS_FALSE;
-                stat_array[i].nlink = total_stat_count;
+                if(total_stat_count > 0)
+                {
+                    stat_array[i].nlink = total_stat_count;
+                }
             }
 
             i++;
-            globus_free(dir_entry);
 
             /* send updates every GFS_STAT_TIME, checked every GFS_STAT_CHECK
-             * unless config is set for a slow listing filesystem */
+             * unless config is set for a slow listing filesystem.  a batch
+             * never grows past GFS_STAT_COUNT_MAX. */
             if(slow_listings || i >= stat_limit_check)
             {
                 time_t                  tmp_time;
@@ -1210,43 +1563,47 @@ done_fake:
                 {
                     send_stats = GLOBUS_TRUE;
                 }
-                else
+                else if(i >= stat_limit_check)
                 {
                     stat_limit_check += GFS_STAT_COUNT_CHECK;
                 }
                 
                 if(send_stats)
                 {
-                    stat_count = i;
                     stat_limit_check = GFS_STAT_COUNT_CHECK;
                     stat_limit_time = tmp_time + GFS_STAT_TIME;
 
-                    i = 0;
-
                     globus_gridftp_server_finished_stat_partial(
-                        op, GLOBUS_SUCCESS, stat_array, stat_count);
+                        op, GLOBUS_SUCCESS, stat_array, i);
 
-                    globus_l_gfs_file_destroy_stat(stat_array, stat_count);
-                    
-                    stat_array = (globus_gfs_stat_t *) globus_malloc(
-                        sizeof(globus_gfs_stat_t) * (stat_limit_max + 1));
-                    if(!stat_array)
+                    /* reuse the batch array rather than reallocating it */
+                    while(i > 0)
                     {
-                        result = GlobusGFSErrorMemory("stat_array");
-                        goto error_open;
+                        i--;
+                        if(stat_array[i].name != NULL)
+                        {
+                            globus_free(stat_array[i].name);
+                        }
+                        if(stat_array[i].symlink_target != NULL)
+                        {
+                            globus_free(stat_array[i].symlink_target);
+                        }
                     }
-                    
-                    stat_count = 0;
                 }
             }                
         }
         stat_count = i;
         
-        if(entries)
-        {
-            globus_free(entries);
-        }
+        globus_l_gfs_file_dirent_free(entries, entry_count);
+        closedir(dir);
+        goto done_list;
+
+error_entries:
+        globus_l_gfs_file_dirent_free(entries, entry_count);
+        closedir(dir);
+        goto error_open;
     }
+done_list:
 #endif
 
     globus_gridftp_server_finished_stat(
@@ -1756,93 +2113,713 @@ error:
     return result;
 }
 
+/*
+ * crc32c (castagnoli), same calling convention as zlib's crc32(): pass 0 to
+ * start and the previous return value to continue.
+ */
+#define GFS_L_FILE_CRC32C_POLY 0x82f63b78
+
+static uint32_t                         globus_l_gfs_file_crc32c_table[256];
+
 static
 void
-globus_l_gfs_file_cksm_read_cb(
-    globus_xio_handle_t                 handle, 
-    globus_result_t                     result,
-    globus_byte_t *                     buffer,
-    globus_size_t                       len,
-    globus_size_t                       nbytes, 
-    globus_xio_data_descriptor_t        data_desc,
-    void *                              user_arg)
+globus_l_gfs_file_crc32c_init(void)
 {
-    globus_l_gfs_file_cksm_monitor_t *  monitor;
-    globus_bool_t                       eof = GLOBUS_FALSE;
-    char *                              cksmptr = NULL;
-    char *                              md5ptr;
-    char *                              shaptr;
-    unsigned char                       md[MD5_DIGEST_LENGTH];
-    char                                md5sum[MD5_DIGEST_LENGTH * 2 + 1] = {0};
-    unsigned char                       sha[SHA512_DIGEST_LENGTH];
-    char                                shasum[SHA512_DIGEST_LENGTH * 2 + 1] = {0};
-    char                                adler32_human[2*sizeof(uint32_t)+1];
-    int                                 i;    
-
-    GlobusGFSName(globus_l_gfs_file_cksm_read_cb);
-    GlobusGFSFileDebugEnter();
-    
-    monitor = (globus_l_gfs_file_cksm_monitor_t *) user_arg;
+    uint32_t                            crc;
+    int                                 i;
+    int                                 j;
 
-    if(result != GLOBUS_SUCCESS)
-    {
-        if(globus_xio_error_is_eof(result))
-        {
-            eof = GLOBUS_TRUE;
-        }
-        else
-        {
-            result = GlobusGFSErrorWrapFailed(
-                "checksum read callback", result);
-            goto error_read;
-        }
-    }        
-    if(monitor->length >= 0)
+    for(i = 0; i < 256; i++)
     {
-        monitor->read_left -= nbytes;
-        monitor->count = (monitor->read_left > monitor->block_size) ? 
-            monitor->block_size : monitor->read_left;
-        if(monitor->read_left == 0)
+        crc = i;
+        for(j = 0; j < 8; j++)
         {
-            eof = GLOBUS_TRUE;
+            crc = (crc & 1) ? (crc >> 1) ^ GFS_L_FILE_CRC32C_POLY : crc >> 1;
         }
+        globus_l_gfs_file_crc32c_table[i] = crc;
     }
-    monitor->total_bytes += nbytes;
+}
 
-    if(monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_MD5)
+static
+uint32_t
+globus_l_gfs_file_crc32c(
+    uint32_t                            crc,
+    const globus_byte_t *               buffer,
+    globus_size_t                       len)
+{
+    crc = ~crc;
+    while(len--)
     {
-        MD5_Update(&monitor->mdctx, buffer, nbytes);
+        crc = globus_l_gfs_file_crc32c_table[(crc ^ *buffer++) & 0xff] ^
+            (crc >> 8);
     }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA1)
+    return ~crc;
+}
+
+static
+uint32_t
+globus_l_gfs_file_gf2_times(
+    const uint32_t *                    mat,
+    uint32_t                            vec)
+{
+    uint32_t                            sum = 0;
+
+    while(vec)
     {
-        SHA1_Update(&monitor->sha1ctx, buffer, nbytes);
+        if(vec & 1)
+        {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
     }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA256)
+    return sum;
+}
+
+static
+void
+globus_l_gfs_file_gf2_square(
+    uint32_t *                          square,
+    const uint32_t *                    mat)
+{
+    int                                 i;
+
+    for(i = 0; i < 32; i++)
     {
-        SHA256_Update(&monitor->sha256ctx, buffer, nbytes);
+        square[i] = globus_l_gfs_file_gf2_times(mat, mat[i]);
     }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA512)
+}
+
+/* crc32c of A followed by B, given crc32c(A), crc32c(B) and len(B).  this
+ * is zlib's crc32_combine() with the castagnoli polynomial */
+static
+uint32_t
+globus_l_gfs_file_crc32c_combine(
+    uint32_t                            crc1,
+    uint32_t                            crc2,
+    globus_off_t                        len2)
+{
+    uint32_t                            even[32];
+    uint32_t                            odd[32];
+    uint32_t                            row;
+    int                                 i;
+
+    if(len2 <= 0)
     {
-        SHA512_Update(&monitor->sha512ctx, buffer, nbytes);
+        return crc1;
     }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+
+    odd[0] = GFS_L_FILE_CRC32C_POLY;
+    row = 1;
+    for(i = 1; i < 32; i++)
     {
-        monitor->adler32ctx = adler32(monitor->adler32ctx, buffer, nbytes);
+        odd[i] = row;
+        row <<= 1;
     }
+    globus_l_gfs_file_gf2_square(even, odd);
+    globus_l_gfs_file_gf2_square(odd, even);
 
-    if(!eof)
+    do
     {
-        if(monitor->send_marker)
+        globus_l_gfs_file_gf2_square(even, odd);
+        if(len2 & 1)
         {
-            monitor->send_marker = GLOBUS_FALSE;
-            
-            char                        count[128];
-            sprintf(count, "%"GLOBUS_OFF_T_FORMAT, monitor->total_bytes);
-            
-            globus_gridftp_server_intermediate_command(
-                monitor->op, GLOBUS_SUCCESS, count);
+            crc1 = globus_l_gfs_file_gf2_times(even, crc1);
         }
-
+        len2 >>= 1;
+        if(len2 == 0)
+        {
+            break;
+        }
+        globus_l_gfs_file_gf2_square(odd, even);
+        if(len2 & 1)
+        {
+            crc1 = globus_l_gfs_file_gf2_times(odd, crc1);
+        }
+        len2 >>= 1;
+    } while(len2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+static
+int
+globus_l_gfs_file_cksm_type(
+    const char *                        algorithm)
+{
+    if(!strcasecmp("md5", algorithm))
+    {
+        return GLOBUS_GFS_FILE_CKSM_TYPE_MD5;
+    }
+    else if(!strcasecmp("sha1", algorithm))
+    {
+        return GLOBUS_GFS_FILE_CKSM_TYPE_SHA1;
+    }
+    else if(!strcasecmp("sha256", algorithm))
+    {
+        return GLOBUS_GFS_FILE_CKSM_TYPE_SHA256;
+    }
+    else if(!strcasecmp("sha512", algorithm))
+    {
+        return GLOBUS_GFS_FILE_CKSM_TYPE_SHA512;
+    }
+    else if(!strcasecmp("adler32", algorithm))
+    {
+        return GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32;
+    }
+    else if(!strcasecmp("crc32c", algorithm))
+    {
+        return GLOBUS_GFS_FILE_CKSM_TYPE_CRC32C;
+    }
+    return GLOBUS_GFS_FILE_CKSM_TYPE_NONE;
+}
+
+/* adler32 and crc32c can be computed over pieces in any order and then
+ * joined; the digests have to see the data in order */
+static
+globus_bool_t
+globus_l_gfs_file_cksm_combinable(
+    int                                 type)
+{
+    return type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32 ||
+        type == GLOBUS_GFS_FILE_CKSM_TYPE_CRC32C;
+}
+
+static
+void
+globus_l_gfs_file_cksm_ctx_init(
+    globus_l_gfs_file_cksm_ctx_t *      ctx,
+    int                                 type)
+{
+    ctx->type = type;
+    if(type == GLOBUS_GFS_FILE_CKSM_TYPE_MD5)
+    {
+        MD5_Init(&ctx->mdctx);
+    }
+    else if (type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA1)
+    {
+        SHA1_Init(&ctx->sha1ctx);
+    }
+    else if (type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA256)
+    {
+        SHA256_Init(&ctx->sha256ctx);
+    }
+    else if (type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA512)
+    {
+        SHA512_Init(&ctx->sha512ctx);
+    }
+    else if (type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+    {
+        ctx->adler32ctx = adler32(0, NULL, 0);
+    }
+    else if (type == GLOBUS_GFS_FILE_CKSM_TYPE_CRC32C)
+    {
+        ctx->crc32cctx = 0;
+    }
+}
+
+static
+void
+globus_l_gfs_file_cksm_ctx_update(
+    globus_l_gfs_file_cksm_ctx_t *      ctx,
+    const globus_byte_t *               buffer,
+    globus_size_t                       nbytes)
+{
+    if(ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_MD5)
+    {
+        MD5_Update(&ctx->mdctx, buffer, nbytes);
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA1)
+    {
+        SHA1_Update(&ctx->sha1ctx, buffer, nbytes);
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA256)
+    {
+        SHA256_Update(&ctx->sha256ctx, buffer, nbytes);
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA512)
+    {
+        SHA512_Update(&ctx->sha512ctx, buffer, nbytes);
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+    {
+        ctx->adler32ctx = adler32(ctx->adler32ctx, buffer, nbytes);
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_CRC32C)
+    {
+        ctx->crc32cctx = globus_l_gfs_file_crc32c(
+            ctx->crc32cctx, buffer, nbytes);
+    }
+}
+
+/* checksum of one piece on its own, to be joined with _ctx_combine() */
+static
+uint32_t
+globus_l_gfs_file_cksm_partial(
+    int                                 type,
+    const globus_byte_t *               buffer,
+    globus_size_t                       nbytes)
+{
+    if(type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+    {
+        return adler32(adler32(0, NULL, 0), buffer, nbytes);
+    }
+    return globus_l_gfs_file_crc32c(0, buffer, nbytes);
+}
+
+static
+uint32_t
+globus_l_gfs_file_cksm_join(
+    int                                 type,
+    uint32_t                            first,
+    uint32_t                            second,
+    globus_off_t                        second_len)
+{
+    if(type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+    {
+        return adler32_combine(first, second, second_len);
+    }
+    return globus_l_gfs_file_crc32c_combine(first, second, second_len);
+}
+
+/* append a piece computed with _cksm_partial() */
+static
+void
+globus_l_gfs_file_cksm_ctx_combine(
+    globus_l_gfs_file_cksm_ctx_t *      ctx,
+    uint32_t                            partial,
+    globus_off_t                        length)
+{
+    if(ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+    {
+        ctx->adler32ctx = globus_l_gfs_file_cksm_join(
+            ctx->type, ctx->adler32ctx, partial, length);
+    }
+    else
+    {
+        ctx->crc32cctx = globus_l_gfs_file_cksm_join(
+            ctx->type, ctx->crc32cctx, partial, length);
+    }
+}
+
+/* cksm must have room for GFS_L_FILE_CKSM_MAX_LEN */
+static
+void
+globus_l_gfs_file_cksm_ctx_final(
+    globus_l_gfs_file_cksm_ctx_t *      ctx,
+    char *                              cksm)
+{
+    unsigned char                       md[SHA512_DIGEST_LENGTH];
+    int                                 md_len = 0;
+    int                                 i;
+
+    if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_MD5)
+    {
+        MD5_Final(md, &ctx->mdctx);
+        md_len = MD5_DIGEST_LENGTH;
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA1)
+    {
+        SHA1_Final(md, &ctx->sha1ctx);
+        md_len = SHA_DIGEST_LENGTH;
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA256)
+    {
+        SHA256_Final(md, &ctx->sha256ctx);
+        md_len = SHA256_DIGEST_LENGTH;
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA512)
+    {
+        SHA512_Final(md, &ctx->sha512ctx);
+        md_len = SHA512_DIGEST_LENGTH;
+    }
+
+    cksm[0] = '\0';
+    if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+    {
+        snprintf(cksm, GFS_L_FILE_CKSM_MAX_LEN, "%08x", ctx->adler32ctx);
+    }
+    else if (ctx->type == GLOBUS_GFS_FILE_CKSM_TYPE_CRC32C)
+    {
+        snprintf(cksm, GFS_L_FILE_CKSM_MAX_LEN, "%08x", ctx->crc32cctx);
+    }
+    else
+    {
+        for(i = 0; i < md_len; i++)
+        {
+            sprintf(cksm + i * 2, "%02x", md[i]);
+        }
+    }
+}
+
+/*
+ * checksum cache
+ *
+ * a checksum the server has computed is kept in an extended attribute of
+ * the file, one per algorithm and range, e.g. user.globus.cksm.adler32 for
+ * the whole file or user.globus.cksm.md5.<offset>.<length> for part of it.
+ * the value records the device, inode, size and mtime of the file it was
+ * computed from and when it was stored; an entry is only used while all of
+ * those still match and, with checksum_cache_max_age, it is not too old.
+ * anything that gets in the way (no xattr support, no permission to write
+ * one) just means the checksum is computed as before.
+ */
+
+/* whole-file ranges get the short name whatever length they were asked as */
+static
+globus_bool_t
+globus_l_gfs_file_cksm_cache_key(
+    const struct stat *                 stat_buf,
+    const char *                        algorithm,
+    globus_off_t                        offset,
+    globus_off_t                        length,
+    char *                              name,
+    globus_size_t                       name_len)
+{
+    char                                alg[16];
+    int                                 i;
+
+    if(offset > stat_buf->st_size || strlen(algorithm) >= sizeof(alg))
+    {
+        return GLOBUS_FALSE;
+    }
+    if(length < 0 || offset + length > stat_buf->st_size)
+    {
+        length = stat_buf->st_size - offset;
+    }
+    for(i = 0; algorithm[i] != '\0'; i++)
+    {
+        alg[i] = tolower(algorithm[i]);
+    }
+    alg[i] = '\0';
+
+    if(offset == 0 && length == stat_buf->st_size)
+    {
+        snprintf(name, name_len, GFS_L_FILE_CKSM_CACHE_XATTR "%s", alg);
+    }
+    else
+    {
+        snprintf(name, name_len, GFS_L_FILE_CKSM_CACHE_XATTR
+            "%s.%"GLOBUS_OFF_T_FORMAT".%"GLOBUS_OFF_T_FORMAT,
+            alg, offset, length);
+    }
+    return GLOBUS_TRUE;
+}
+
+#ifdef __linux__
+/* "<dev> <ino> <size> <mtime>.<nsec> <stored> <cksm>" */
+static
+void
+globus_l_gfs_file_cksm_cache_value(
+    const struct stat *                 stat_buf,
+    time_t                              stored,
+    const char *                        cksm,
+    char *                              value,
+    globus_size_t                       value_len)
+{
+    snprintf(value, value_len, "%llu %llu %lld %lld.%09ld %lld %s",
+        (unsigned long long) stat_buf->st_dev,
+        (unsigned long long) stat_buf->st_ino,
+        (long long) stat_buf->st_size,
+        (long long) stat_buf->st_mtim.tv_sec,
+        (long) stat_buf->st_mtim.tv_nsec,
+        (long long) stored,
+        cksm);
+}
+
+/* true, with the checksum in cksm, if value was stored for the file as
+ * stat_buf has it and, with max_age days, not too long before now.  cksm
+ * must have room for GFS_L_FILE_CKSM_MAX_LEN */
+static
+globus_bool_t
+globus_l_gfs_file_cksm_cache_match(
+    const char *                        value,
+    const struct stat *                 stat_buf,
+    int                                 max_age,
+    time_t                              now,
+    char *                              cksm)
+{
+    char                                fmt[64];
+    unsigned long long                  dev;
+    unsigned long long                  ino;
+    long long                           size;
+    long long                           mtime;
+    long                                mtime_nsec;
+    long long                           stored;
+
+    snprintf(fmt, sizeof(fmt), "%%llu %%llu %%lld %%lld.%%ld %%lld %%%ds",
+        GFS_L_FILE_CKSM_MAX_LEN - 1);
+    if(sscanf(value, fmt,
+        &dev, &ino, &size, &mtime, &mtime_nsec, &stored, cksm) != 7)
+    {
+        return GLOBUS_FALSE;
+    }
+
+    if(dev != (unsigned long long) stat_buf->st_dev ||
+        ino != (unsigned long long) stat_buf->st_ino ||
+        size != (long long) stat_buf->st_size ||
+        mtime != (long long) stat_buf->st_mtim.tv_sec ||
+        mtime_nsec != stat_buf->st_mtim.tv_nsec)
+    {
+        return GLOBUS_FALSE;
+    }
+
+    if(max_age > 0 && now - stored > (long long) max_age * 86400)
+    {
+        return GLOBUS_FALSE;
+    }
+
+    return GLOBUS_TRUE;
+}
+#endif
+
+/* cksm must have room for GFS_L_FILE_CKSM_MAX_LEN */
+static
+globus_bool_t
+globus_l_gfs_file_cksm_cache_lookup(
+    const char *                        pathname,
+    const char *                        algorithm,
+    globus_off_t                        offset,
+    globus_off_t                        length,
+    char *                              cksm)
+{
+#ifdef __linux__
+    struct stat                         stat_buf;
+    char                                name[128];
+    char                                value[GFS_L_FILE_CKSM_MAX_LEN + 128];
+    ssize_t                             len;
+
+    if(!globus_gfs_config_get_bool("checksum_cache") ||
+        stat(pathname, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode) ||
+        !globus_l_gfs_file_cksm_cache_key(
+            &stat_buf, algorithm, offset, length, name, sizeof(name)))
+    {
+        return GLOBUS_FALSE;
+    }
+
+    len = getxattr(pathname, name, value, sizeof(value) - 1);
+    if(len <= 0)
+    {
+        return GLOBUS_FALSE;
+    }
+    value[len] = '\0';
+
+    if(!globus_l_gfs_file_cksm_cache_match(
+        value,
+        &stat_buf,
+        globus_gfs_config_get_int("checksum_cache_max_age"),
+        time(NULL),
+        cksm))
+    {
+        return GLOBUS_FALSE;
+    }
+
+    globus_gfs_log_message(
+        GLOBUS_GFS_LOG_INFO,
+        "Using cached %s checksum of %s.\n", algorithm, pathname);
+
+    return GLOBUS_TRUE;
+#else
+    return GLOBUS_FALSE;
+#endif
+}
+
+/*
+ * stat_buf is the file as it was before the checksum was computed, the
+ * entry is not stored if it has changed since.  NULL takes the file as it
+ * is now, for a checksum of data the server wrote itself.
+ */
+static
+void
+globus_l_gfs_file_cksm_cache_store(
+    const char *                        pathname,
+    const struct stat *                 stat_buf,
+    const char *                        algorithm,
+    globus_off_t                        offset,
+    globus_off_t                        length,
+    const char *                        cksm)
+{
+#ifdef __linux__
+    struct stat                         now_buf;
+    char                                name[128];
+    char                                value[GFS_L_FILE_CKSM_MAX_LEN + 128];
+
+    if(!globus_gfs_config_get_bool("checksum_cache") ||
+        stat(pathname, &now_buf) != 0 || !S_ISREG(now_buf.st_mode))
+    {
+        return;
+    }
+    if(stat_buf == NULL)
+    {
+        stat_buf = &now_buf;
+    }
+    else if(stat_buf->st_dev != now_buf.st_dev ||
+        stat_buf->st_ino != now_buf.st_ino ||
+        stat_buf->st_size != now_buf.st_size ||
+        stat_buf->st_mtim.tv_sec != now_buf.st_mtim.tv_sec ||
+        stat_buf->st_mtim.tv_nsec != now_buf.st_mtim.tv_nsec)
+    {
+        return;
+    }
+
+    if(!globus_l_gfs_file_cksm_cache_key(
+        stat_buf, algorithm, offset, length, name, sizeof(name)))
+    {
+        return;
+    }
+
+    globus_l_gfs_file_cksm_cache_value(
+        stat_buf, time(NULL), cksm, value, sizeof(value));
+
+    if(setxattr(pathname, name, value, strlen(value), 0) != 0)
+    {
+        globus_gfs_log_message(
+            GLOBUS_GFS_LOG_DUMP,
+            "Unable to cache checksum of %s: %s\n",
+            pathname, strerror(errno));
+    }
+#endif
+}
+
+/*
+ * everything that ends a checksum goes through here, success or not.
+ * the monitor is freed.
+ */
+static
+void
+globus_l_gfs_file_cksm_finished(
+    globus_l_gfs_file_cksm_monitor_t *  monitor,
+    globus_result_t                     result)
+{
+    char                                cksm[GFS_L_FILE_CKSM_MAX_LEN];
+    char *                              cksmptr = NULL;
+    int                                 i;
+    GlobusGFSName(globus_l_gfs_file_cksm_finished);
+    GlobusGFSFileDebugEnter();
+
+    if(monitor->marker_handle)
+    {
+        globus_callback_unregister(
+            monitor->marker_handle,
+            NULL,
+            NULL,
+            NULL);
+        monitor->marker_handle = GLOBUS_NULL_HANDLE;
+    }
+
+    globus_xio_register_close(
+        monitor->handle,
+        NULL,
+        globus_l_gfs_file_close_cb,
+        NULL);
+
+    if(result == GLOBUS_SUCCESS)
+    {
+        globus_l_gfs_file_cksm_ctx_final(&monitor->ctx, cksm);
+        cksmptr = cksm;
+
+        if(monitor->cache_path != NULL)
+        {
+            globus_l_gfs_file_cksm_cache_store(
+                monitor->cache_path,
+                &monitor->cache_stat,
+                monitor->cache_alg,
+                monitor->offset,
+                monitor->length,
+                cksm);
+        }
+    }
+
+    if(monitor->internal_cb)
+    {
+        monitor->internal_cb(result, cksmptr, monitor->internal_cb_arg);
+    }
+    else
+    {
+        globus_gridftp_server_finished_command(monitor->op, result, cksmptr);
+    }
+
+    if(monitor->chunks)
+    {
+        for(i = 0; i < monitor->depth; i++)
+        {
+            if(monitor->chunks[i].buffer)
+            {
+                globus_free(monitor->chunks[i].buffer);
+            }
+        }
+        globus_free(monitor->chunks);
+        globus_mutex_destroy(&monitor->lock);
+    }
+    if(monitor->cache_path)
+    {
+        globus_free(monitor->cache_path);
+        globus_free(monitor->cache_alg);
+    }
+    globus_free(monitor);
+
+    GlobusGFSFileDebugExit();
+}
+
+static
+void
+globus_l_gfs_file_cksm_read_cb(
+    globus_xio_handle_t                 handle, 
+    globus_result_t                     result,
+    globus_byte_t *                     buffer,
+    globus_size_t                       len,
+    globus_size_t                       nbytes, 
+    globus_xio_data_descriptor_t        data_desc,
+    void *                              user_arg)
+{
+    globus_l_gfs_file_cksm_monitor_t *  monitor;
+    globus_bool_t                       eof = GLOBUS_FALSE;
+
+    GlobusGFSName(globus_l_gfs_file_cksm_read_cb);
+    GlobusGFSFileDebugEnter();
+    
+    monitor = (globus_l_gfs_file_cksm_monitor_t *) user_arg;
+
+    if(result != GLOBUS_SUCCESS)
+    {
+        if(globus_xio_error_is_eof(result))
+        {
+            eof = GLOBUS_TRUE;
+        }
+        else
+        {
+            result = GlobusGFSErrorWrapFailed(
+                "checksum read callback", result);
+            goto error_read;
+        }
+    }        
+    if(monitor->length >= 0)
+    {
+        monitor->read_left -= nbytes;
+        monitor->count = (monitor->read_left > monitor->block_size) ? 
+            monitor->block_size : monitor->read_left;
+        if(monitor->read_left == 0)
+        {
+            eof = GLOBUS_TRUE;
+        }
+    }
+    monitor->total_bytes += nbytes;
+
+    globus_l_gfs_file_cksm_ctx_update(&monitor->ctx, buffer, nbytes);
+
+    if(!eof)
+    {
+        if(monitor->send_marker)
+        {
+            monitor->send_marker = GLOBUS_FALSE;
+            
+            char                        count[128];
+            sprintf(count, "%"GLOBUS_OFF_T_FORMAT, monitor->total_bytes);
+            
+            globus_gridftp_server_intermediate_command(
+                monitor->op, GLOBUS_SUCCESS, count);
+        }
+
         if (monitor->delay_read)
         {
             nanosleep(&(struct timespec) {.tv_nsec = monitor->delay_read * 1000}, NULL);
@@ -1865,95 +2842,312 @@ globus_l_gfs_file_cksm_read_cb(
     }
     else
     {
-        if(monitor->marker_handle)
+        globus_l_gfs_file_cksm_finished(monitor, GLOBUS_SUCCESS);
+    }        
+    GlobusGFSFileDebugExit();
+    return;
+        
+
+error_register:
+error_read:
+    globus_l_gfs_file_cksm_finished(monitor, result);
+    
+    GlobusGFSFileDebugExitWithError();
+}
+
+/*
+ * parallel checksum engine
+ *
+ * depth blocks of the range are pread() concurrently from the callback
+ * thread pool.  adler32 and crc32c are computed by each worker on its own
+ * block and joined in order as they finish.  the digests are fed whole
+ * blocks in file order by whichever worker holds the hashing token, while
+ * the others keep reading ahead.  only used when the server is threaded.
+ */
+
+static
+void
+globus_l_gfs_file_cksm_worker(
+    void *                              user_arg);
+
+/* called locked */
+static
+globus_bool_t
+globus_l_gfs_file_cksm_dispatch(
+    globus_l_gfs_file_cksm_monitor_t *  monitor,
+    globus_l_gfs_file_cksm_chunk_t *    chunk)
+{
+    globus_reltime_t                    delay;
+    globus_result_t                     result;
+
+    if(monitor->result != GLOBUS_SUCCESS || monitor->eof ||
+        monitor->next_offset >= monitor->end)
+    {
+        return GLOBUS_FALSE;
+    }
+
+    chunk->index = monitor->next_index;
+    chunk->offset = monitor->next_offset;
+    chunk->length = monitor->block_size;
+    if(chunk->length > monitor->end - monitor->next_offset)
+    {
+        chunk->length = monitor->end - monitor->next_offset;
+    }
+    chunk->nbytes = 0;
+    chunk->done = GLOBUS_FALSE;
+
+    GlobusTimeReltimeSet(delay, 0, 0);
+    result = globus_callback_register_oneshot(
+        NULL,
+        &delay,
+        globus_l_gfs_file_cksm_worker,
+        chunk);
+    if(result != GLOBUS_SUCCESS)
+    {
+        monitor->result = GlobusGFSErrorWrapFailed(
+            "globus_callback_register_oneshot", result);
+        return GLOBUS_FALSE;
+    }
+
+    monitor->next_index++;
+    monitor->next_offset += chunk->length;
+    monitor->active++;
+
+    return GLOBUS_TRUE;
+}
+
+/* called locked, consumes finished blocks in order and refills them */
+static
+void
+globus_l_gfs_file_cksm_drain(
+    globus_l_gfs_file_cksm_monitor_t *  monitor)
+{
+    globus_l_gfs_file_cksm_chunk_t *    chunk;
+    char                                count[128];
+
+    while(!monitor->hashing && !monitor->eof &&
+        monitor->result == GLOBUS_SUCCESS)
+    {
+        chunk = &monitor->chunks[monitor->hash_index % monitor->depth];
+        if(chunk->index != monitor->hash_index || !chunk->done)
         {
-            globus_callback_unregister(
-                monitor->marker_handle,
-                NULL,
-                NULL,
-                NULL);
-            monitor->marker_handle = GLOBUS_NULL_HANDLE;
+            break;
         }
-        
-        globus_xio_register_close(
-            handle,
-            NULL,
-            globus_l_gfs_file_close_cb,
-            NULL);
 
-        if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_MD5)
+        monitor->hashing = GLOBUS_TRUE;
+        if(globus_l_gfs_file_cksm_combinable(monitor->ctx.type))
         {
-            MD5_Final(md, &monitor->mdctx);
-            md5ptr = md5sum;
-            for(i = 0; i < MD5_DIGEST_LENGTH; i++)
-            {
-               md5ptr += sprintf(md5ptr, "%02x", md[i]);
-            }
-            cksmptr = md5sum;
+            globus_l_gfs_file_cksm_ctx_combine(
+                &monitor->ctx, chunk->partial, chunk->nbytes);
         }
-        else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA1)
+        else
         {
-            SHA1_Final(sha, &monitor->sha1ctx);
-            shaptr = shasum;
-            for(i = 0; i < SHA_DIGEST_LENGTH; i++)
-            {
-               shaptr += sprintf(shaptr, "%02x", sha[i]);
-            }
-            cksmptr = shasum;
+            globus_mutex_unlock(&monitor->lock);
+            globus_l_gfs_file_cksm_ctx_update(
+                &monitor->ctx, chunk->buffer, chunk->nbytes);
+            globus_mutex_lock(&monitor->lock);
         }
-        else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA256)
+
+        monitor->total_bytes += chunk->nbytes;
+        monitor->hash_index++;
+        if(chunk->nbytes < chunk->length)
         {
-            SHA256_Final(sha, &monitor->sha256ctx);
-            shaptr = shasum;
-            for(i = 0; i < SHA256_DIGEST_LENGTH; i++)
-            {
-               shaptr += sprintf(shaptr, "%02x", sha[i]);
-            }
-            cksmptr = shasum;
+            /* file got shorter, stop here like a serial read would */
+            monitor->eof = GLOBUS_TRUE;
         }
-        else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA512)
+
+        if(monitor->send_marker)
         {
-            SHA512_Final(sha, &monitor->sha512ctx);
-            shaptr = shasum;
-            for(i = 0; i < SHA512_DIGEST_LENGTH; i++)
-            {
-               shaptr += sprintf(shaptr, "%02x", sha[i]);
-            }
-            cksmptr = shasum;
+            monitor->send_marker = GLOBUS_FALSE;
+            sprintf(count, "%"GLOBUS_OFF_T_FORMAT, monitor->total_bytes);
+
+            globus_mutex_unlock(&monitor->lock);
+            globus_gridftp_server_intermediate_command(
+                monitor->op, GLOBUS_SUCCESS, count);
+            globus_mutex_lock(&monitor->lock);
+        }
+        monitor->hashing = GLOBUS_FALSE;
+
+        globus_l_gfs_file_cksm_dispatch(monitor, chunk);
+    }
+}
+
+static
+void
+globus_l_gfs_file_cksm_worker(
+    void *                              user_arg)
+{
+    globus_l_gfs_file_cksm_chunk_t *    chunk;
+    globus_l_gfs_file_cksm_monitor_t *  monitor;
+    globus_bool_t                       finished;
+    ssize_t                             rc;
+    int                                 err = 0;
+    GlobusGFSName(globus_l_gfs_file_cksm_worker);
+    GlobusGFSFileDebugEnter();
+
+    chunk = (globus_l_gfs_file_cksm_chunk_t *) user_arg;
+    monitor = chunk->monitor;
+
+    if (monitor->delay_read)
+    {
+        nanosleep(&(struct timespec) {.tv_nsec = monitor->delay_read * 1000}, NULL);
+    }
+
+    while(chunk->nbytes < chunk->length)
+    {
+        rc = pread(
+            monitor->fd,
+            chunk->buffer + chunk->nbytes,
+            chunk->length - chunk->nbytes,
+            chunk->offset + chunk->nbytes);
+        if(rc > 0)
+        {
+            chunk->nbytes += rc;
+        }
+        else if(rc == 0)
+        {
+            break;
         }
-        else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
+        else if(errno != EINTR)
         {
-            snprintf(adler32_human, sizeof(adler32_human),
-                "%08x", monitor->adler32ctx);
-            cksmptr = adler32_human;
+            err = errno;
+            break;
         }
+    }
+    if(!err && globus_l_gfs_file_cksm_combinable(monitor->ctx.type))
+    {
+        chunk->partial = globus_l_gfs_file_cksm_partial(
+            monitor->ctx.type, chunk->buffer, chunk->nbytes);
+    }
 
-        if(monitor->internal_cb)
+    globus_mutex_lock(&monitor->lock);
+    {
+        monitor->active--;
+        chunk->done = GLOBUS_TRUE;
+        if(err && monitor->result == GLOBUS_SUCCESS)
         {
-            monitor->internal_cb(
-                GLOBUS_SUCCESS, cksmptr, monitor->internal_cb_arg);
+            monitor->result = GlobusGFSErrorSystemError("pread", err);
         }
-        else
+
+        globus_l_gfs_file_cksm_drain(monitor);
+
+        finished = monitor->active == 0 && !monitor->hashing;
+    }
+    globus_mutex_unlock(&monitor->lock);
+
+    if(finished)
+    {
+        globus_l_gfs_file_cksm_finished(monitor, monitor->result);
+    }
+
+    GlobusGFSFileDebugExit();
+}
+
+/* returns FALSE if the serial path should be used instead */
+static
+globus_bool_t
+globus_l_gfs_file_cksm_engine_start(
+    globus_l_gfs_file_cksm_monitor_t *  monitor)
+{
+#ifndef TARGET_ARCH_WIN32
+    struct stat                         stat_buf;
+    globus_result_t                     result;
+    globus_bool_t                       finished;
+    int                                 depth;
+    int                                 i;
+    GlobusGFSName(globus_l_gfs_file_cksm_engine_start);
+    GlobusGFSFileDebugEnter();
+
+    depth = globus_gfs_config_get_int("checksum_concurrency");
+    if(depth < 2 || !globus_thread_preemptive_threads())
+    {
+        goto error_serial;
+    }
+
+    result = globus_xio_handle_cntl(
+        monitor->handle,
+        globus_l_gfs_file_driver,
+        GLOBUS_XIO_FILE_GET_HANDLE,
+        &monitor->fd);
+    if(result != GLOBUS_SUCCESS)
+    {
+        globus_object_free(globus_error_get(result));
+        goto error_serial;
+    }
+    if(fstat(monitor->fd, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode))
+    {
+        goto error_serial;
+    }
+
+    monitor->end = stat_buf.st_size;
+    if(monitor->length >= 0 && monitor->offset + monitor->length < monitor->end)
+    {
+        monitor->end = monitor->offset + monitor->length;
+    }
+    /* nothing to gain from less than two blocks */
+    if(monitor->end - monitor->offset <= (globus_off_t) monitor->block_size)
+    {
+        goto error_serial;
+    }
+
+    monitor->chunks = (globus_l_gfs_file_cksm_chunk_t *)
+        globus_calloc(depth, sizeof(globus_l_gfs_file_cksm_chunk_t));
+    if(monitor->chunks == NULL)
+    {
+        goto error_serial;
+    }
+    monitor->depth = depth;
+    for(i = 0; i < depth; i++)
+    {
+        monitor->chunks[i].monitor = monitor;
+        monitor->chunks[i].index = -1;
+        monitor->chunks[i].buffer = globus_malloc(monitor->block_size);
+        if(monitor->chunks[i].buffer == NULL)
         {
-            globus_gridftp_server_finished_command(
-                monitor->op, GLOBUS_SUCCESS, cksmptr);
-        }   
-        
-        globus_free(monitor);
-            
-    }        
+            goto error_buffers;
+        }
+    }
+
+    globus_mutex_init(&monitor->lock, NULL);
+    monitor->next_offset = monitor->offset;
+    monitor->result = GLOBUS_SUCCESS;
+
+    globus_mutex_lock(&monitor->lock);
+    {
+        for(i = 0; i < depth; i++)
+        {
+            if(!globus_l_gfs_file_cksm_dispatch(monitor, &monitor->chunks[i]))
+            {
+                break;
+            }
+        }
+        finished = monitor->active == 0;
+    }
+    globus_mutex_unlock(&monitor->lock);
+
+    if(finished)
+    {
+        globus_l_gfs_file_cksm_finished(monitor, monitor->result);
+    }
+
     GlobusGFSFileDebugExit();
-    return;
-        
+    return GLOBUS_TRUE;
 
-error_register:
-error_read:
-    globus_xio_register_close(handle, NULL, NULL, NULL);
-    handle = NULL;
-    globus_gridftp_server_finished_command(monitor->op, result, NULL);    
-    globus_free(monitor);
-    
-    GlobusGFSFileDebugExitWithError();
+error_buffers:
+    for(i = 0; i < depth; i++)
+    {
+        if(monitor->chunks[i].buffer)
+        {
+            globus_free(monitor->chunks[i].buffer);
+        }
+    }
+    globus_free(monitor->chunks);
+    monitor->chunks = NULL;
+
+error_serial:
+    GlobusGFSFileDebugExit();
+#endif
+    return GLOBUS_FALSE;
 }
 
 
@@ -1979,6 +3173,7 @@ globus_l_gfs_file_open_cksm_cb(
     GlobusGFSFileDebugEnter();
     
     monitor = (globus_l_gfs_file_cksm_monitor_t *) user_arg;
+    monitor->handle = handle;
 
     if(result != GLOBUS_SUCCESS)
     {
@@ -2011,6 +3206,14 @@ globus_l_gfs_file_open_cksm_cb(
         }
     }
     
+    globus_l_gfs_file_cksm_ctx_init(&monitor->ctx, monitor->ctx.type);
+
+    if(globus_l_gfs_file_cksm_engine_start(monitor))
+    {
+        GlobusGFSFileDebugExit();
+        return;
+    }
+
     if(monitor->length >= 0)
     {
         monitor->read_left = monitor->length;
@@ -2038,28 +3241,6 @@ globus_l_gfs_file_open_cksm_cb(
         }
     }
 
-    if(monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_MD5)
-    {
-        MD5_Init(&monitor->mdctx);
-    }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA1)
-    {
-        SHA1_Init(&monitor->sha1ctx);
-    }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA256)
-    {
-        SHA256_Init(&monitor->sha256ctx);
-    }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_SHA512)
-    {
-        SHA512_Init(&monitor->sha512ctx);
-    }
-    else if (monitor->cksum_type == GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32)
-    {
-        monitor->adler32ctx = adler32(0, NULL, 0);
-    }
-    
-    
     result = globus_xio_register_read(
         handle,
         monitor->buffer,
@@ -2081,17 +3262,7 @@ globus_l_gfs_file_open_cksm_cb(
 error_register:
 error_seek:
 error_open:
-    globus_xio_register_close(handle, NULL, NULL, NULL);
-    handle = NULL;
-    if(monitor->internal_cb)
-    {
-        monitor->internal_cb(result, NULL, monitor->internal_cb_arg);
-    }
-    else
-    {
-        globus_gridftp_server_finished_command(monitor->op, result, NULL);
-    }   
-    globus_free(monitor);
+    globus_l_gfs_file_cksm_finished(monitor, result);
     
     GlobusGFSFileDebugExitWithError();
 }
@@ -2116,6 +3287,7 @@ globus_l_gfs_file_cksm(
     globus_size_t                       block_size;
     int                                 timeout;
     int                                 cksm_type = 0;
+    char                                cksm[GFS_L_FILE_CKSM_MAX_LEN];
     GlobusGFSName(globus_l_gfs_file_cksm);
     GlobusGFSFileDebugEnter();
     
@@ -2125,32 +3297,29 @@ globus_l_gfs_file_cksm(
         goto param_error;
     }
 
-    if(!strcasecmp("md5", algorithm))
-    {
-        cksm_type = GLOBUS_GFS_FILE_CKSM_TYPE_MD5;
-    }
-    else if(!strcasecmp("sha1", algorithm))
-    {
-        cksm_type = GLOBUS_GFS_FILE_CKSM_TYPE_SHA1;
-    }
-    else if(!strcasecmp("sha256", algorithm))
-    {
-        cksm_type = GLOBUS_GFS_FILE_CKSM_TYPE_SHA256;
-    }
-    else if(!strcasecmp("sha512", algorithm))
-    {
-        cksm_type = GLOBUS_GFS_FILE_CKSM_TYPE_SHA512;
-    }
-    else if(!strcasecmp("adler32", algorithm))
-    {
-        cksm_type = GLOBUS_GFS_FILE_CKSM_TYPE_ADLER32;
-    }
-    else
+    cksm_type = globus_l_gfs_file_cksm_type(algorithm);
+    if(cksm_type == GLOBUS_GFS_FILE_CKSM_TYPE_NONE)
     {
         result = GlobusGFSErrorGeneric("Unknown checksum algorithm requested.");
         goto alg_error;
     }
 
+    if(globus_l_gfs_file_cksm_cache_lookup(
+        pathname, algorithm, offset, length, cksm))
+    {
+        if(internal_cb)
+        {
+            internal_cb(GLOBUS_SUCCESS, cksm, internal_cb_arg);
+        }
+        else
+        {
+            globus_gridftp_server_finished_command(op, GLOBUS_SUCCESS, cksm);
+        }
+
+        GlobusGFSFileDebugExit();
+        return GLOBUS_SUCCESS;
+    }
+
     result = globus_xio_attr_init(&attr);
     if(result != GLOBUS_SUCCESS)
     {
@@ -2230,7 +3399,14 @@ globus_l_gfs_file_cksm(
     monitor->internal_cb = internal_cb;
     monitor->internal_cb_arg = internal_cb_arg;
     monitor->delay_read = globus_gfs_config_get_int("checksum_throttle");
-    monitor->cksum_type = cksm_type;
+    monitor->ctx.type = cksm_type;
+
+    if(globus_gfs_config_get_bool("checksum_cache") &&
+        stat(pathname, &monitor->cache_stat) == 0)
+    {
+        monitor->cache_path = globus_libc_strdup(pathname);
+        monitor->cache_alg = globus_libc_strdup(algorithm);
+    }
 
     result = globus_xio_register_open(
         file_handle,
@@ -2253,6 +3429,11 @@ globus_l_gfs_file_cksm(
 error_register:
     globus_xio_register_close(file_handle, NULL, NULL, NULL);
     file_handle = NULL;
+    if(monitor->cache_path)
+    {
+        globus_free(monitor->cache_path);
+        globus_free(monitor->cache_alg);
+    }
     globus_free(monitor);
     
 error_mem:
@@ -2338,52 +3519,572 @@ globus_l_gfs_file_command(
         break;
     }
 
-    if(result != GLOBUS_SUCCESS)
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+    
+    GlobusGFSFileDebugExit();
+    return;
+
+error:
+    globus_gridftp_server_finished_command(op, result, NULL);    
+
+    GlobusGFSFileDebugExitWithError();
+}
+
+/**
+ * disk I/O scheduling
+ *
+ * the fd is only used for files opened on the default disk stack; with a
+ * custom stack what reaches the file is up to its drivers, so no hints are
+ * given and direct_io is ignored.  files are never opened with O_DIRECT,
+ * it is only set once the fd is known and the I/O on it is aligned.
+ */
+
+/* most blocks joined into one write */
+#define GFS_L_FILE_WRITE_IOV_MAX 64
+
+static
+void
+globus_l_gfs_file_disk_init(
+    globus_l_file_monitor_t *           monitor)
+{
+#ifndef TARGET_ARCH_WIN32
+    globus_list_t *                     driver_list;
+    globus_xio_system_file_t            fd;
+    globus_result_t                     result;
+    GlobusGFSName(globus_l_gfs_file_disk_init);
+    GlobusGFSFileDebugEnter();
+
+    globus_gfs_data_get_file_stack_list(monitor->op, &driver_list);
+    if(driver_list != NULL)
+    {
+        globus_list_free(driver_list);
+        goto done;
+    }
+
+    result = globus_xio_handle_cntl(
+        monitor->file_handle,
+        globus_l_gfs_file_driver,
+        GLOBUS_XIO_FILE_GET_HANDLE,
+        &fd);
+    if(result != GLOBUS_SUCCESS)
+    {
+        globus_object_free(globus_error_get(result));
+        goto done;
+    }
+
+    monitor->disk_fd = fd;
+
+done:
+    GlobusGFSFileDebugExit();
+#endif
+}
+
+/*
+ * O_DIRECT needs the offset, length and memory of every transfer aligned.
+ * the buffers are page aligned, so only the odd piece is not (the end of
+ * the file, a restart at an unaligned offset, a short block from the
+ * network); O_DIRECT is only turned on for the aligned pieces.
+ * reads and writes on a monitor are issued one at a time, so the flag
+ * never changes under one in flight.
+ *
+ * called locked
+ */
+static
+void
+globus_l_gfs_file_disk_align(
+    globus_l_file_monitor_t *           monitor,
+    globus_off_t                        offset,
+    const globus_xio_iovec_t *          iov,
+    int                                 iovc)
+{
+#if defined(O_DIRECT) && !defined(TARGET_ARCH_WIN32)
+    globus_bool_t                       aligned;
+    long                                page_size;
+    int                                 flags;
+    int                                 i;
+
+    if(monitor->disk_fd == GLOBUS_XIO_FILE_INVALID_HANDLE ||
+        !globus_gfs_config_get_bool("direct_io"))
+    {
+        return;
+    }
+
+    page_size = sysconf(_SC_PAGESIZE);
+    aligned = (offset % page_size) == 0;
+    for(i = 0; i < iovc && aligned; i++)
+    {
+        aligned = ((uintptr_t) iov[i].iov_base % page_size) == 0 &&
+            (iov[i].iov_len % page_size) == 0;
+    }
+
+    if(aligned != monitor->direct)
+    {
+        flags = fcntl(monitor->disk_fd, F_GETFL);
+        if(flags != -1 && fcntl(monitor->disk_fd, F_SETFL,
+            aligned ? (flags | O_DIRECT) : (flags & ~O_DIRECT)) != -1)
+        {
+            monitor->direct = aligned;
+        }
+    }
+#endif
+}
+
+/*
+ * a send reads the range in order: say so when it starts, then keep asking
+ * for about twice what the buffers hold to be read ahead of file_offset.
+ * pointless when O_DIRECT skips the page cache.
+ *
+ * called locked
+ */
+static
+void
+globus_l_gfs_file_disk_readahead(
+    globus_l_file_monitor_t *           monitor,
+    globus_bool_t                       start)
+{
+#if defined(POSIX_FADV_WILLNEED) && !defined(TARGET_ARCH_WIN32)
+    globus_off_t                        window;
+    globus_off_t                        end;
+
+    if(monitor->disk_fd == GLOBUS_XIO_FILE_INVALID_HANDLE ||
+        globus_gfs_config_get_bool("direct_io"))
+    {
+        return;
+    }
+
+    if(start)
+    {
+        posix_fadvise(
+            monitor->disk_fd,
+            monitor->read_offset,
+            monitor->read_length == -1 ? 0 : monitor->read_length,
+            POSIX_FADV_SEQUENTIAL);
+        monitor->readahead_offset = monitor->read_offset;
+    }
+
+    window = (globus_off_t) monitor->block_size * monitor->optimal_count * 2;
+    end = monitor->file_offset + window;
+    if(monitor->read_length != -1 &&
+        end > monitor->file_offset + monitor->read_length)
+    {
+        end = monitor->file_offset + monitor->read_length;
+    }
+    if(monitor->readahead_offset < monitor->file_offset)
+    {
+        monitor->readahead_offset = monitor->file_offset;
+    }
+
+    /* half a window at a time */
+    if(end - monitor->readahead_offset >= window / 2 ||
+        (end > monitor->readahead_offset && monitor->read_length != -1 &&
+            end == monitor->file_offset + monitor->read_length))
+    {
+        posix_fadvise(
+            monitor->disk_fd,
+            monitor->readahead_offset,
+            end - monitor->readahead_offset,
+            POSIX_FADV_WILLNEED);
+        monitor->readahead_offset = end;
+    }
+#endif
+}
+
+/*
+ * sync_writes flusher: written ranges collect in dirty_ranges and are
+ * reported to the server as received only once they are on disk, so a
+ * restart marker never covers data a crash could lose.  writeback of each
+ * write is started straight away with sync_file_range(); once
+ * sync_writes_threshold bytes are dirty, fdatasync() runs in a callback
+ * while writes carry on into a fresh list.  that keeps the page cache
+ * from filling between markers and leaves close at most a threshold's
+ * worth of data to wait for, instead of the data layer syncing every
+ * filesystem before each marker.
+ */
+static
+void
+globus_l_gfs_file_sync_init(
+    globus_l_file_monitor_t *           monitor)
+{
+    int                                 threshold;
+    GlobusGFSName(globus_l_gfs_file_sync_init);
+    GlobusGFSFileDebugEnter();
+
+    threshold = globus_gfs_config_get_int("sync_writes_threshold");
+    if(!globus_gfs_config_get_bool("sync_writes") || threshold <= 0 ||
+        monitor->disk_fd == GLOBUS_XIO_FILE_INVALID_HANDLE)
+    {
+        goto done;
+    }
+
+    if(globus_range_list_init(&monitor->dirty_ranges) != GLOBUS_SUCCESS)
+    {
+        monitor->dirty_ranges = NULL;
+        goto done;
+    }
+    if(globus_range_list_init(&monitor->flush_ranges) != GLOBUS_SUCCESS)
+    {
+        globus_range_list_destroy(monitor->dirty_ranges);
+        monitor->dirty_ranges = NULL;
+        monitor->flush_ranges = NULL;
+        goto done;
+    }
+
+    monitor->sync_threshold = threshold;
+    globus_gridftp_server_set_synced_ranges(monitor->op, GLOBUS_TRUE);
+
+done:
+    GlobusGFSFileDebugExit();
+}
+
+static
+void
+globus_l_gfs_file_sync_cb(
+    void *                              user_arg)
+{
+    globus_l_file_monitor_t *           monitor;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    int                                 i;
+    GlobusGFSName(globus_l_gfs_file_sync_cb);
+    GlobusGFSFileDebugEnter();
+
+    monitor = (globus_l_file_monitor_t *) user_arg;
+
+    /* nothing else touches flush_ranges or closes the fd while flushing */
+#ifndef TARGET_ARCH_WIN32
+    if(fdatasync(monitor->disk_fd) != 0)
+    {
+        result = GlobusGFSErrorSystemError("fdatasync", errno);
+    }
+#endif
+
+    globus_mutex_lock(&monitor->lock);
+    {
+        monitor->flushing = GLOBUS_FALSE;
+
+        if(result == GLOBUS_SUCCESS)
+        {
+            for(i = 0; i < globus_range_list_size(monitor->flush_ranges); i++)
+            {
+                globus_range_list_at(
+                    monitor->flush_ranges, i, &offset, &length);
+                globus_gridftp_server_update_range_recvd(
+                    monitor->op, offset, length);
+            }
+        }
+        globus_range_list_remove(
+            monitor->flush_ranges, 0, GLOBUS_RANGE_LIST_MAX);
+
+        if(monitor->close_pending)
+        {
+            monitor->close_pending = GLOBUS_FALSE;
+            if(result != GLOBUS_SUCCESS &&
+                monitor->finish_result == GLOBUS_SUCCESS)
+            {
+                monitor->finish_result = result;
+            }
+            globus_l_gfs_file_close(monitor, monitor->finish_result);
+        }
+        else if(result != GLOBUS_SUCCESS)
+        {
+            /* the next read or write callback fails the transfer */
+            if(monitor->error == NULL)
+            {
+                monitor->error = globus_error_get(result);
+            }
+            else
+            {
+                globus_object_free(globus_error_get(result));
+            }
+        }
+        else if(monitor->dirty_bytes >= monitor->sync_threshold)
+        {
+            globus_l_gfs_file_sync_start(monitor);
+        }
+    }
+    globus_mutex_unlock(&monitor->lock);
+
+    GlobusGFSFileDebugExit();
+}
+
+/* Called LOCKED */
+static
+void
+globus_l_gfs_file_sync_start(
+    globus_l_file_monitor_t *           monitor)
+{
+    globus_range_list_t                 ranges;
+    GlobusGFSName(globus_l_gfs_file_sync_start);
+    GlobusGFSFileDebugEnter();
+
+    ranges = monitor->flush_ranges;
+    monitor->flush_ranges = monitor->dirty_ranges;
+    monitor->dirty_ranges = ranges;
+    monitor->dirty_bytes = 0;
+    monitor->flushing = GLOBUS_TRUE;
+
+    globus_callback_register_oneshot(
+        NULL,
+        NULL,
+        globus_l_gfs_file_sync_cb,
+        monitor);
+
+    GlobusGFSFileDebugExit();
+}
+
+/* Called LOCKED */
+static
+void
+globus_l_gfs_file_sync_written(
+    globus_l_file_monitor_t *           monitor,
+    globus_off_t                        offset,
+    globus_size_t                       nbytes)
+{
+    GlobusGFSName(globus_l_gfs_file_sync_written);
+    GlobusGFSFileDebugEnter();
+
+    if(nbytes > 0)
+    {
+        globus_range_list_insert(monitor->dirty_ranges, offset, nbytes);
+        monitor->dirty_bytes += nbytes;
+#ifdef SYNC_FILE_RANGE_WRITE
+        sync_file_range(
+            monitor->disk_fd, offset, nbytes, SYNC_FILE_RANGE_WRITE);
+#endif
+        if(!monitor->flushing &&
+            monitor->dirty_bytes >= monitor->sync_threshold)
+        {
+            globus_l_gfs_file_sync_start(monitor);
+        }
+    }
+
+    GlobusGFSFileDebugExit();
+}
+
+/**
+ * recv calls
+ */
+
+static
+void
+globus_l_gfs_file_server_read_cb(
+    globus_gfs_operation_t   op,
+    globus_result_t                     result,
+    globus_byte_t *                     buffer,
+    globus_size_t                       nbytes,
+    globus_off_t                        offset,
+    globus_bool_t                       eof,
+    void *                              user_arg);
+
+static
+globus_result_t
+globus_l_gfs_file_dispatch_write(
+    globus_l_file_monitor_t *           monitor);
+    
+/*
+ * inline checksum for verifying a RECV without reading the file back.
+ * digests can only follow the data if it is written strictly in order from
+ * offset 0; adler32 and crc32c keep a sorted list of the contiguous ranges
+ * seen so far and join neighbours as the gaps fill in, so out of order
+ * MODE E blocks are fine.  anything else (overlap, a gap in a digest) just
+ * drops the inline checksum and the file is read back as before.
+ */
+static
+void
+globus_l_gfs_file_inline_cksm_abandon(
+    globus_l_file_monitor_t *           monitor)
+{
+    globus_l_gfs_file_cksm_range_t *    range;
+
+    globus_free(monitor->inline_cksm);
+    monitor->inline_cksm = NULL;
+    while(monitor->inline_cksm_ranges)
+    {
+        range = monitor->inline_cksm_ranges;
+        monitor->inline_cksm_ranges = range->next;
+        globus_free(range);
+    }
+}
+
+/* called locked */
+static
+void
+globus_l_gfs_file_inline_cksm_update(
+    globus_l_file_monitor_t *           monitor,
+    globus_byte_t *                     buffer,
+    globus_off_t                        offset,
+    globus_size_t                       nbytes)
+{
+    globus_l_gfs_file_cksm_range_t **   prev_next;
+    globus_l_gfs_file_cksm_range_t *    prev = NULL;
+    globus_l_gfs_file_cksm_range_t *    range;
+    globus_l_gfs_file_cksm_range_t *    next;
+    int                                 type;
+
+    if(monitor->inline_cksm == NULL || nbytes == 0)
+    {
+        return;
+    }
+    type = monitor->inline_cksm->type;
+
+    if(!globus_l_gfs_file_cksm_combinable(type))
+    {
+        if(offset != monitor->inline_cksm_offset)
+        {
+            globus_l_gfs_file_inline_cksm_abandon(monitor);
+            return;
+        }
+        globus_l_gfs_file_cksm_ctx_update(
+            monitor->inline_cksm, buffer, nbytes);
+        monitor->inline_cksm_offset += nbytes;
+        return;
+    }
+
+    prev_next = &monitor->inline_cksm_ranges;
+    while(*prev_next && (*prev_next)->offset < offset)
+    {
+        prev = *prev_next;
+        prev_next = &prev->next;
+    }
+    next = *prev_next;
+    if((prev && prev->offset + prev->length > offset) ||
+        (next && offset + (globus_off_t) nbytes > next->offset))
+    {
+        globus_l_gfs_file_inline_cksm_abandon(monitor);
+        return;
+    }
+
+    range = (globus_l_gfs_file_cksm_range_t *)
+        globus_malloc(sizeof(globus_l_gfs_file_cksm_range_t));
+    if(range == NULL)
+    {
+        globus_l_gfs_file_inline_cksm_abandon(monitor);
+        return;
+    }
+    range->offset = offset;
+    range->length = nbytes;
+    range->partial = globus_l_gfs_file_cksm_partial(type, buffer, nbytes);
+    range->next = next;
+    *prev_next = range;
+
+    if(next && range->offset + range->length == next->offset)
+    {
+        range->partial = globus_l_gfs_file_cksm_join(
+            type, range->partial, next->partial, next->length);
+        range->length += next->length;
+        range->next = next->next;
+        globus_free(next);
+    }
+    if(prev && prev->offset + prev->length == range->offset)
+    {
+        prev->partial = globus_l_gfs_file_cksm_join(
+            type, prev->partial, range->partial, range->length);
+        prev->length += range->length;
+        prev->next = range->next;
+        globus_free(range);
+    }
+}
+
+/* TRUE and the checksum in cksm if the whole file was seen */
+static
+globus_bool_t
+globus_l_gfs_file_inline_cksm_final(
+    globus_l_file_monitor_t *           monitor,
+    char *                              cksm)
+{
+    globus_l_gfs_file_cksm_range_t *    range;
+    struct stat                         stat_buf;
+
+    if(monitor->inline_cksm == NULL || monitor->pathname == NULL ||
+        stat(monitor->pathname, &stat_buf) != 0)
     {
-        goto error;
+        return GLOBUS_FALSE;
     }
-    
-    GlobusGFSFileDebugExit();
-    return;
 
-error:
-    globus_gridftp_server_finished_command(op, result, NULL);    
+    if(globus_l_gfs_file_cksm_combinable(monitor->inline_cksm->type))
+    {
+        range = monitor->inline_cksm_ranges;
+        if(stat_buf.st_size == 0 && range == NULL)
+        {
+            /* empty file, ctx still holds the initial value */
+        }
+        else if(range == NULL || range->next != NULL ||
+            range->offset != 0 || range->length != stat_buf.st_size)
+        {
+            return GLOBUS_FALSE;
+        }
+        else
+        {
+            globus_l_gfs_file_cksm_ctx_combine(
+                monitor->inline_cksm, range->partial, range->length);
+        }
+    }
+    else if(monitor->inline_cksm_offset != stat_buf.st_size)
+    {
+        return GLOBUS_FALSE;
+    }
 
-    GlobusGFSFileDebugExitWithError();
+    globus_l_gfs_file_cksm_ctx_final(monitor->inline_cksm, cksm);
+    return GLOBUS_TRUE;
 }
 
-/**
- * recv calls
- */
-
+/* only when the bytes handed to write_cb are the bytes on disk */
 static
 void
-globus_l_gfs_file_server_read_cb(
-    globus_gfs_operation_t   op,
-    globus_result_t                     result,
-    globus_byte_t *                     buffer,
-    globus_size_t                       nbytes,
-    globus_off_t                        offset,
-    globus_bool_t                       eof,
-    void *                              user_arg);
+globus_l_gfs_file_inline_cksm_init(
+    globus_l_file_monitor_t *           monitor)
+{
+    globus_list_t *                     driver_list;
+    int                                 type;
+
+    if(!globus_gfs_config_get_bool("checksum_inline") ||
+        monitor->expected_cksm == NULL || monitor->expected_cksm_alg == NULL)
+    {
+        return;
+    }
+
+    type = globus_l_gfs_file_cksm_type(monitor->expected_cksm_alg);
+    if(type == GLOBUS_GFS_FILE_CKSM_TYPE_NONE)
+    {
+        return;
+    }
+
+    globus_gfs_data_get_file_stack_list(monitor->op, &driver_list);
+    if(driver_list != NULL)
+    {
+        globus_list_free(driver_list);
+        return;
+    }
+
+    monitor->inline_cksm = (globus_l_gfs_file_cksm_ctx_t *)
+        globus_malloc(sizeof(globus_l_gfs_file_cksm_ctx_t));
+    if(monitor->inline_cksm == NULL)
+    {
+        return;
+    }
+    globus_l_gfs_file_cksm_ctx_init(monitor->inline_cksm, type);
+    monitor->inline_cksm_offset = 0;
+    monitor->inline_cksm_ranges = NULL;
+}
 
-static
-globus_result_t
-globus_l_gfs_file_dispatch_write(
-    globus_l_file_monitor_t *           monitor);
-    
 static
 void
 globus_l_gfs_file_write_cb(
     globus_xio_handle_t                 xio_handle, 
     globus_result_t                     result,
-    globus_byte_t *                     buffer,
-    globus_size_t                       len,
+    globus_xio_iovec_t *                iov,
+    int                                 iovc,
     globus_size_t                       nbytes, 
     globus_xio_data_descriptor_t        data_desc,
     void *                              user_arg)
 {
     globus_l_file_monitor_t *           monitor;
+    globus_off_t                        offset;
+    int                                 i;
     GlobusGFSName(globus_l_gfs_file_write_cb);
     GlobusGFSFileDebugEnter();
     
@@ -2392,41 +4093,62 @@ globus_l_gfs_file_write_cb(
     globus_mutex_lock(&monitor->lock);
     { 
         monitor->pending_writes--;
-        globus_gridftp_server_update_bytes_written(
-            monitor->op, 
-            monitor->file_offset,
-            nbytes);
+        if(monitor->dirty_ranges != NULL)
+        {
+            globus_gridftp_server_update_bytes_recvd(monitor->op, nbytes);
+            globus_l_gfs_file_sync_written(
+                monitor, monitor->file_offset, nbytes);
+        }
+        else
+        {
+            globus_gridftp_server_update_bytes_written(
+                monitor->op, 
+                monitor->file_offset,
+                nbytes);
+        }
+        if(result == GLOBUS_SUCCESS)
+        {
+            offset = monitor->file_offset;
+            for(i = 0; i < iovc; i++)
+            {
+                globus_l_gfs_file_inline_cksm_update(
+                    monitor, iov[i].iov_base, offset, iov[i].iov_len);
+                offset += iov[i].iov_len;
+            }
+        }
         monitor->file_offset += nbytes;
 
         if(result != GLOBUS_SUCCESS && monitor->error == NULL)
         {
             monitor->error = GlobusGFSErrorObjWrapFailed("callback", result);
         }
-        if(monitor->error != NULL)
-        {
-            goto error;
-        }
-        
-        if(!monitor->eof)
+
+        for(i = 0; i < iovc; i++)
         {
-            result = globus_gridftp_server_register_read(
-                monitor->op,
-                buffer,
-                monitor->block_size,
-                globus_l_gfs_file_server_read_cb,
-                monitor);
-            if(result != GLOBUS_SUCCESS)
+            if(monitor->error == NULL && !monitor->eof &&
+                monitor->pending_reads < monitor->optimal_count)
             {
+                result = globus_gridftp_server_register_read(
+                    monitor->op,
+                    iov[i].iov_base,
+                    monitor->block_size,
+                    globus_l_gfs_file_server_read_cb,
+                    monitor);
+                if(result == GLOBUS_SUCCESS)
+                {
+                    monitor->pending_reads++;
+                    continue;
+                }
                 monitor->error = GlobusGFSErrorObjWrapFailed(
                     "globus_gridftp_server_register_read", result);
-                goto error;
             }
-            
-            monitor->pending_reads++;
+            globus_buffer_pool_put(&monitor->mem, iov[i].iov_base);
         }
-        else
+        globus_free(iov);
+
+        if(monitor->error != NULL)
         {
-            globus_memory_push_node(&monitor->mem, buffer);
+            goto error;
         }
         
         result = globus_l_gfs_file_dispatch_write(monitor);
@@ -2434,7 +4156,7 @@ globus_l_gfs_file_write_cb(
         {
             monitor->error = GlobusGFSErrorObjWrapFailed(
                 "globus_l_gfs_file_dispatch_write", result);
-            goto error_dispatch;
+            goto error;
         }
         
         if(monitor->pending_reads == 0 && monitor->pending_writes == 0)
@@ -2455,8 +4177,6 @@ globus_l_gfs_file_write_cb(
     return;
 
 error:
-    globus_memory_push_node(&monitor->mem, buffer);
-error_dispatch:
     if(monitor->pending_reads != 0 || monitor->pending_writes != 0)
     {
         /* there are still outstanding callbacks, wait for them */
@@ -2472,21 +4192,43 @@ error_dispatch:
     GlobusGFSFileDebugExitWithError();
 }
 
-/* Called LOCKED */
+/*
+ * write behind: the queue is ordered by offset, so write from its head,
+ * joining the blocks that follow on in the file into one write of up to
+ * extent_size.  a head that is past a gap is held back while reads are
+ * still out that might fill it, so the file is written front to back
+ * instead of in the order blocks arrived from the parallel streams.  no
+ * more than half the buffers are held that way; the rest keep receiving.
+ *
+ * Called LOCKED
+ */
 static
 globus_result_t
 globus_l_gfs_file_dispatch_write(
     globus_l_file_monitor_t *           monitor)
 {
     globus_l_buffer_info_t *            buf_info;
+    globus_xio_iovec_t *                iov = NULL;
+    int                                 iovc = 0;
+    int                                 iov_max;
+    globus_size_t                       length = 0;
+    globus_off_t                        end;
     globus_result_t                     result;
+    int                                 i;
     GlobusGFSName(globus_l_gfs_file_dispatch_write);
     GlobusGFSFileDebugEnter();
     
     if(monitor->pending_writes == 0 && !monitor->aborted)
     {
         buf_info = (globus_l_buffer_info_t *)
-            globus_priority_q_dequeue(&monitor->queue);
+            globus_priority_q_first(&monitor->queue);
+        if(buf_info && buf_info->offset != monitor->file_offset &&
+            monitor->extent_size > 0 && !monitor->eof &&
+            monitor->pending_reads > 0 &&
+            monitor->queued_count * 2 < monitor->optimal_count)
+        {
+            buf_info = NULL;
+        }
         if(buf_info)
         {
             if(buf_info->offset != monitor->file_offset)
@@ -2509,25 +4251,60 @@ globus_l_gfs_file_dispatch_write(
                     goto error_seek;
                 }
             }
-            
-            result = globus_xio_register_write(
+
+            iov_max = monitor->extent_size > 0 ?
+                GFS_L_FILE_WRITE_IOV_MAX : 1;
+            if(iov_max > monitor->queued_count)
+            {
+                iov_max = monitor->queued_count;
+            }
+            iov = (globus_xio_iovec_t *)
+                globus_malloc(sizeof(globus_xio_iovec_t) * iov_max);
+            if(iov == NULL)
+            {
+                result = GlobusGFSErrorMemory("iovec");
+                goto error_seek;
+            }
+
+            end = buf_info->offset;
+            while(buf_info != NULL && buf_info->offset == end &&
+                iovc < iov_max &&
+                (iovc == 0 || length + buf_info->length <=
+                    monitor->extent_size))
+            {
+                globus_priority_q_dequeue(&monitor->queue);
+                monitor->queued_count--;
+
+                iov[iovc].iov_base = buf_info->buffer;
+                iov[iovc].iov_len = buf_info->length;
+                iovc++;
+                length += buf_info->length;
+                end += buf_info->length;
+                globus_free(buf_info);
+
+                buf_info = (globus_l_buffer_info_t *)
+                    globus_priority_q_first(&monitor->queue);
+            }
+
+            globus_l_gfs_file_disk_align(
+                monitor, monitor->file_offset, iov, iovc);
+
+            result = globus_xio_register_writev(
                 monitor->file_handle,
-                buf_info->buffer,
-                buf_info->length,
-                buf_info->length,
+                iov,
+                iovc,
+                length,
                 NULL,
                 globus_l_gfs_file_write_cb,
                 monitor);
             if(result != GLOBUS_SUCCESS)
             {
                 result = GlobusGFSErrorWrapFailed(
-                    "globus_xio_register_write", result);
+                    "globus_xio_register_writev", result);
                 goto error_register;
             }
             
             monitor->pending_writes++;
-            
-            globus_free(buf_info);
         }
     }
     
@@ -2535,10 +4312,22 @@ globus_l_gfs_file_dispatch_write(
     return GLOBUS_SUCCESS;
 
 error_register:
+    for(i = 0; i < iovc; i++)
+    {
+        globus_buffer_pool_put(&monitor->mem, iov[i].iov_base);
+    }
+    globus_free(iov);
+
+    GlobusGFSFileDebugExitWithError();
+    return result;
+
 error_seek:
+    buf_info = (globus_l_buffer_info_t *)
+        globus_priority_q_dequeue(&monitor->queue);
+    monitor->queued_count--;
     if(buf_info->buffer)
     {
-        globus_memory_push_node(&monitor->mem, buf_info->buffer);
+        globus_buffer_pool_put(&monitor->mem, buf_info->buffer);
     }
     globus_free(buf_info);
 
@@ -2554,29 +4343,46 @@ globus_l_gfs_file_update_concurrency(
 {
     globus_result_t                     result;
     int                                 optimal_count;
+    int                                 max_interval;
     int                                 extra;
     GlobusGFSName(globus_l_gfs_file_update_concurrency);
     GlobusGFSFileDebugEnter();
     
     if(!monitor->eof)
     {
+        /* autotune may move the count every second, keep checking often */
+        max_interval = globus_gfs_config_get_bool("autotune") ? 32 : 1024;
         monitor->concurrency_check = monitor->concurrency_check_interval;
         monitor->concurrency_check_interval *= 2;
-        if(monitor->concurrency_check_interval > 1024)
+        if(monitor->concurrency_check_interval > max_interval)
         {
-            monitor->concurrency_check_interval = 1024;
+            monitor->concurrency_check_interval = max_interval;
         }
         
         globus_gridftp_server_get_optimal_concurrency(
             monitor->op, &optimal_count);
         extra = optimal_count - monitor->optimal_count;
             
+        /* a lower count takes effect as buffers come back: the receive
+         * side stops reposting reads beyond it, the send side frees them */
         monitor->optimal_count = optimal_count;
-        while(extra-- > 0)
+        while(monitor->buffer_count > 0 && !monitor->sendfile && extra-- > 0)
+        {
+            globus_byte_t *             buffer;
+            
+            buffer = globus_buffer_pool_get(&monitor->mem);
+            if(!buffer)
+            {
+                break;
+            }
+            globus_list_insert(&monitor->buffer_list, buffer);
+            monitor->buffer_count++;
+        }
+        while(monitor->buffer_count == 0 && extra-- > 0)
         {
             globus_byte_t *             buffer;
             
-            buffer = globus_memory_pop_node(&monitor->mem);
+            buffer = globus_buffer_pool_get(&monitor->mem);
             result = globus_gridftp_server_register_read(
                 monitor->op,
                 buffer,
@@ -2585,7 +4391,7 @@ globus_l_gfs_file_update_concurrency(
                 monitor);
             if(result != GLOBUS_SUCCESS)
             {
-                globus_memory_push_node(&monitor->mem, buffer);
+                globus_buffer_pool_put(&monitor->mem, buffer);
                 result = GlobusGFSErrorWrapFailed(
                     "globus_gridftp_server_register_read", result);
                 goto error_register;
@@ -2666,6 +4472,7 @@ globus_l_gfs_file_server_read_cb(
                 "globus_priority_q_enqueue failed");
             goto error_enqueue;
         }
+        monitor->queued_count++;
 
         result = globus_l_gfs_file_dispatch_write(monitor);
         if(result != GLOBUS_SUCCESS)
@@ -2682,13 +4489,15 @@ globus_l_gfs_file_server_read_cb(
     return;
     
 error_enqueue:
-error_dispatch:
-    /* can't free buf_info, its in queue */
     globus_free(buf_info);
     
 error_alloc:
 error:
-    globus_memory_push_node(&monitor->mem, buffer);
+    globus_buffer_pool_put(&monitor->mem, buffer);
+
+error_dispatch:
+    /* a failed dispatch has freed what it took off the queue, whatever
+     * is still on it goes with the monitor */
     if(monitor->pending_reads != 0 || monitor->pending_writes != 0)
     {
         /* there are still outstanding callbacks, wait for them */
@@ -2731,13 +4540,15 @@ globus_l_gfs_file_open_write_cb(
         int                             optimal_count;
         globus_size_t                   block_size;
         
+        globus_l_gfs_file_disk_init(monitor);
+        globus_l_gfs_file_sync_init(monitor);
         optimal_count = monitor->optimal_count;
         block_size = monitor->block_size;
         while(optimal_count--)
         {
             globus_byte_t *             buffer;
             
-            buffer = globus_memory_pop_node(&monitor->mem);
+            buffer = globus_buffer_pool_get(&monitor->mem);
             result = globus_gridftp_server_register_read(
                 monitor->op,
                 buffer,
@@ -2746,7 +4557,7 @@ globus_l_gfs_file_open_write_cb(
                 monitor);
             if(result != GLOBUS_SUCCESS)
             {
-                globus_memory_push_node(&monitor->mem, buffer);
+                globus_buffer_pool_put(&monitor->mem, buffer);
                 result = GlobusGFSErrorWrapFailed(
                     "globus_gridftp_server_register_read", result);
                 goto error_register;
@@ -2812,13 +4623,6 @@ globus_l_gfs_file_open(
         goto error_attr;
     }
 
-#ifdef O_DIRECT
-    if(globus_gfs_config_get_bool("direct_io"))
-    {
-        open_flags |= O_DIRECT;
-    }    
-#endif
-
     result = globus_xio_attr_cntl(
         attr,
         globus_l_gfs_file_driver,
@@ -3009,6 +4813,7 @@ globus_l_gfs_file_recv(
         monitor->expected_cksm_alg = 
             globus_libc_strdup(transfer_info->expected_checksum_alg);
     }
+    globus_l_gfs_file_inline_cksm_init(monitor);
     
     result = globus_l_gfs_file_open(
         &monitor->file_handle, transfer_info->pathname, open_flags, monitor);
@@ -3044,6 +4849,11 @@ globus_l_gfs_file_read_cb(
     globus_size_t                       nbytes, 
     globus_xio_data_descriptor_t        data_desc,
     void *                              user_arg);
+
+static
+globus_result_t
+globus_l_gfs_file_dispatch_sendfile(
+    globus_l_file_monitor_t *           monitor);
     
 /* called LOCKED */
 static
@@ -3054,9 +4864,16 @@ globus_l_gfs_file_dispatch_read(
     globus_result_t                     result;
     globus_byte_t *                     buffer;
     globus_size_t                       read_length;
+    globus_xio_iovec_t                  iov;
     GlobusGFSName(globus_l_gfs_file_dispatch_read);
     GlobusGFSFileDebugEnter();
     
+    if(monitor->sendfile)
+    {
+        GlobusGFSFileDebugExit();
+        return globus_l_gfs_file_dispatch_sendfile(monitor);
+    }
+
     if(monitor->first_read && monitor->pending_reads == 0 && 
         !monitor->eof && !globus_list_empty(monitor->buffer_list) &&
         !monitor->aborted)
@@ -3091,7 +4908,7 @@ globus_l_gfs_file_dispatch_read(
                 }
                 monitor->file_offset = monitor->read_offset;
             }
-            
+            globus_l_gfs_file_disk_readahead(monitor, GLOBUS_TRUE);
         }
         monitor->first_read = GLOBUS_FALSE;
     }             
@@ -3112,6 +4929,25 @@ globus_l_gfs_file_dispatch_read(
         {
             read_length = monitor->block_size;
         }
+
+        /* with direct_io, a read from an unaligned offset stops at the
+         * next block boundary so the ones after it are aligned again */
+        if(monitor->disk_fd != GLOBUS_XIO_FILE_INVALID_HANDLE &&
+            globus_gfs_config_get_bool("direct_io") &&
+            monitor->file_offset % monitor->block_size != 0)
+        {
+            read_length = monitor->block_size -
+                monitor->file_offset % monitor->block_size;
+            if(monitor->read_length != -1 &&
+                read_length > monitor->read_length)
+            {
+                read_length = monitor->read_length;
+            }
+        }
+        iov.iov_base = buffer;
+        iov.iov_len = read_length;
+        globus_l_gfs_file_disk_align(monitor, monitor->file_offset, &iov, 1);
+        globus_l_gfs_file_disk_readahead(monitor, GLOBUS_FALSE);
         
         result = globus_xio_register_read(
             monitor->file_handle,
@@ -3159,7 +4995,15 @@ globus_l_gfs_file_server_write_cb(
     globus_mutex_lock(&monitor->lock);
     { 
         monitor->pending_writes--;
-        globus_list_insert(&monitor->buffer_list, buffer);
+        if(buffer != NULL && monitor->buffer_count > monitor->optimal_count)
+        {
+            globus_buffer_pool_put(&monitor->mem, buffer);
+            monitor->buffer_count--;
+        }
+        else if(buffer != NULL)
+        {
+            globus_list_insert(&monitor->buffer_list, buffer);
+        }
 
         if(result != GLOBUS_SUCCESS && monitor->error == NULL)
         {
@@ -3170,6 +5014,12 @@ globus_l_gfs_file_server_write_cb(
             goto error;
         }
         
+        monitor->concurrency_check--;
+        if(monitor->concurrency_check == 0)
+        {
+            globus_l_gfs_file_update_concurrency(monitor);
+        }
+
         result = globus_l_gfs_file_dispatch_read(monitor);
         if(result != GLOBUS_SUCCESS)
         {
@@ -3209,6 +5059,156 @@ error:
     GlobusGFSFileDebugExitWithError();
 }
 
+/*
+ * plain files on the default disk stack can be handed to the data channel
+ * by fd; it will use sendfile() if it is able to.  anything that needs to
+ * see the data on the way (O_DIRECT alignment, custom disk stacks) keeps
+ * going through the buffers.
+ */
+static
+void
+globus_l_gfs_file_check_sendfile(
+    globus_l_file_monitor_t *           monitor)
+{
+#ifndef TARGET_ARCH_WIN32
+    struct stat                         stat_buf;
+    GlobusGFSName(globus_l_gfs_file_check_sendfile);
+    GlobusGFSFileDebugEnter();
+
+    monitor->sendfile = GLOBUS_FALSE;
+
+    if(!globus_gfs_config_get_bool("sendfile") ||
+        globus_gfs_config_get_bool("direct_io") ||
+        monitor->disk_fd == GLOBUS_XIO_FILE_INVALID_HANDLE)
+    {
+        goto done;
+    }
+
+    if(fstat(monitor->disk_fd, &stat_buf) != 0 ||
+        !S_ISREG(stat_buf.st_mode))
+    {
+        goto done;
+    }
+
+    monitor->sendfile = GLOBUS_TRUE;
+    monitor->file_size = stat_buf.st_size;
+
+done:
+    GlobusGFSFileDebugExit();
+#endif
+}
+
+/* called LOCKED */
+static
+globus_result_t
+globus_l_gfs_file_dispatch_sendfile(
+    globus_l_file_monitor_t *           monitor)
+{
+    globus_result_t                     result;
+    globus_off_t                        send_length;
+#ifndef TARGET_ARCH_WIN32
+    struct stat                         stat_buf;
+#endif
+    GlobusGFSName(globus_l_gfs_file_dispatch_sendfile);
+    GlobusGFSFileDebugEnter();
+
+    while(monitor->pending_writes < monitor->optimal_count &&
+        !monitor->eof && !monitor->aborted)
+    {
+        if(monitor->first_read)
+        {
+            globus_gridftp_server_get_read_range(
+                monitor->op,
+                &monitor->read_offset,
+                &monitor->read_length);
+            if(monitor->read_length == 0)
+            {
+                monitor->eof = GLOBUS_TRUE;
+                break;
+            }
+            monitor->file_offset = monitor->read_offset;
+            monitor->first_read = GLOBUS_FALSE;
+            globus_l_gfs_file_disk_readahead(monitor, GLOBUS_TRUE);
+        }
+
+#ifndef TARGET_ARCH_WIN32
+        /* like the buffered path, send until eof even if the file has
+         * grown since it was opened */
+        if(monitor->file_offset >= monitor->file_size &&
+            fstat(monitor->disk_fd, &stat_buf) == 0)
+        {
+            monitor->file_size = stat_buf.st_size;
+        }
+#endif
+        if(monitor->file_offset >= monitor->file_size)
+        {
+            monitor->eof = GLOBUS_TRUE;
+            break;
+        }
+
+        send_length = monitor->file_size - monitor->file_offset;
+        if(send_length > monitor->block_size)
+        {
+            send_length = monitor->block_size;
+        }
+        if(monitor->read_length != -1 && send_length > monitor->read_length)
+        {
+            send_length = monitor->read_length;
+        }
+
+        result = globus_gridftp_server_register_sendfile(
+            monitor->op,
+            monitor->disk_fd,
+            monitor->file_offset,
+            send_length,
+            monitor->file_offset,
+            -1,
+            globus_l_gfs_file_server_write_cb,
+            monitor);
+        if(result != GLOBUS_SUCCESS)
+        {
+            /* data channel can't take it, read the rest through the
+             * buffers from where we got to */
+            globus_object_free(globus_error_get(result));
+            monitor->sendfile = GLOBUS_FALSE;
+
+            result = globus_xio_handle_cntl(
+                monitor->file_handle,
+                GLOBUS_XIO_QUERY,
+                GLOBUS_XIO_SEEK,
+                monitor->file_offset,
+                GLOBUS_XIO_FILE_SEEK_SET);
+            if(result != GLOBUS_SUCCESS)
+            {
+                result = GlobusGFSErrorWrapFailed(
+                    "globus_xio_handle_cntl", result);
+                goto error_seek;
+            }
+
+            GlobusGFSFileDebugExit();
+            return globus_l_gfs_file_dispatch_read(monitor);
+        }
+
+        monitor->pending_writes++;
+        monitor->file_offset += send_length;
+        if(monitor->read_length != -1)
+        {
+            monitor->read_length -= send_length;
+            if(monitor->read_length == 0)
+            {
+                monitor->first_read = GLOBUS_TRUE;
+            }
+        }
+    }
+
+    GlobusGFSFileDebugExit();
+    return GLOBUS_SUCCESS;
+
+error_seek:
+    GlobusGFSFileDebugExitWithError();
+    return result;
+}
+
 static
 void
 globus_l_gfs_file_read_cb(
@@ -3347,6 +5347,8 @@ globus_l_gfs_file_open_read_cb(
     
     globus_mutex_lock(&monitor->lock);
     monitor->first_read = GLOBUS_TRUE;
+    globus_l_gfs_file_disk_init(monitor);
+    globus_l_gfs_file_check_sendfile(monitor);
     result = globus_l_gfs_file_dispatch_read(monitor);
     if(result != GLOBUS_SUCCESS)
     {
@@ -3411,8 +5413,9 @@ globus_l_gfs_file_send(
     while(optimal_count--)
     {
         globus_byte_t *                 buffer;
-        buffer = globus_memory_pop_node(&monitor->mem);
+        buffer = globus_buffer_pool_get(&monitor->mem);
         globus_list_insert(&monitor->buffer_list, buffer);
+        monitor->buffer_count++;
     }
     monitor->session = (gfs_l_file_session_t *) user_arg;
 
@@ -3592,6 +5595,18 @@ globus_l_gfs_file_activate(void)
 
     GlobusDebugInit(GLOBUS_GRIDFTP_SERVER_FILE,
         ERROR WARNING TRACE INTERNAL_TRACE INFO STATE INFO_VERBOSE);
+
+    globus_l_gfs_file_crc32c_init();
+
+#ifndef O_DIRECT
+    if(globus_gfs_config_get_bool("direct_io"))
+    {
+        globus_gfs_log_message(
+            GLOBUS_GFS_LOG_WARN,
+            "direct_io is set, but this system has no O_DIRECT; "
+            "file data will go through the page cache.\n");
+    }
+#endif
     
     return GLOBUS_SUCCESS;
     
@@ -0,0 +1,168 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "globus_common.h"
+#include "globus_gridftp_server.h"
+#include "globus_preload.h"
+
+#include "modules/file/globus_gridftp_server_file.c"
+
+typedef struct
+{
+    char *                              algorithm;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    char *                              expect;
+}
+key_test_case_t;
+
+#ifdef __linux__
+typedef struct
+{
+    char *                              test_name;
+    /* NULL for the value stored for the unchanged file */
+    char *                              value;
+    int                                 dev_delta;
+    int                                 ino_delta;
+    int                                 size_delta;
+    int                                 nsec_delta;
+    int                                 max_age;
+    time_t                              age;
+    globus_bool_t                       expect_match;
+}
+match_test_case_t;
+#endif
+
+int main()
+{
+    struct stat                         stat_buf;
+    key_test_case_t                     key_tests[] =
+    {
+        /* whole file, however the range was asked for */
+        { "ADLER32", 0, -1,   "user.globus.cksm.adler32" },
+        { "md5",     0, 1000, "user.globus.cksm.md5" },
+        { "md5",     0, 5000, "user.globus.cksm.md5" },
+        /* part of the file */
+        { "MD5",     0, 10,   "user.globus.cksm.md5.0.10" },
+        { "md5",     100, -1, "user.globus.cksm.md5.100.900" },
+        { "sha512",  100, 9000, "user.globus.cksm.sha512.100.900" },
+        /* no entry */
+        { "md5",     1001, -1, NULL },
+        { "averyveryverylongname", 0, -1, NULL }
+    };
+    int                                 key_count;
+    int                                 test_count;
+    char                                name[128];
+    globus_bool_t                       rc;
+    int                                 failed = 0;
+    int                                 i;
+#ifdef __linux__
+    match_test_case_t                   match_tests[] =
+    {
+        { "value matches the file it was stored for",
+            NULL, 0, 0, 0, 0, 0, 0, GLOBUS_TRUE },
+        { "other device does not match",
+            NULL, 1, 0, 0, 0, 0, 0, GLOBUS_FALSE },
+        { "other inode does not match",
+            NULL, 0, 1, 0, 0, 0, 0, GLOBUS_FALSE },
+        { "other size does not match",
+            NULL, 0, 0, 1, 0, 0, 0, GLOBUS_FALSE },
+        { "other mtime nanoseconds do not match",
+            NULL, 0, 0, 0, 1, 0, 0, GLOBUS_FALSE },
+        { "entry of exactly max age matches",
+            NULL, 0, 0, 0, 0, 1, 86400, GLOBUS_TRUE },
+        { "entry past max age does not match",
+            NULL, 0, 0, 0, 0, 1, 86401, GLOBUS_FALSE },
+        { "value without nanoseconds does not match",
+            "2049 1234567 1000 1690000000 1700000000 0a1b2c3d",
+            0, 0, 0, 0, 0, 0, GLOBUS_FALSE },
+        { "value without checksum does not match",
+            "2049 1234567 1000 1690000000.000000005 1700000000",
+            0, 0, 0, 0, 0, 0, GLOBUS_FALSE }
+    };
+    int                                 match_count;
+    char                                value[GFS_L_FILE_CKSM_MAX_LEN + 128];
+    char                                cksm[GFS_L_FILE_CKSM_MAX_LEN];
+    struct stat                         changed;
+    time_t                              now = 1700000000;
+#endif
+
+    LTDL_SET_PRELOADED_SYMBOLS();
+
+    key_count = (int) (sizeof(key_tests)/sizeof(key_tests[0]));
+    test_count = key_count;
+#ifdef __linux__
+    match_count = (int) (sizeof(match_tests)/sizeof(match_tests[0]));
+    test_count += 1 + match_count;
+#endif
+    printf("1..%d\n", test_count);
+
+    memset(&stat_buf, 0, sizeof(stat_buf));
+    stat_buf.st_dev = 2049;
+    stat_buf.st_ino = 1234567;
+    stat_buf.st_size = 1000;
+
+    for (i = 0; i < key_count; i++)
+    {
+        name[0] = '\0';
+        rc = globus_l_gfs_file_cksm_cache_key(
+            &stat_buf,
+            key_tests[i].algorithm,
+            key_tests[i].offset,
+            key_tests[i].length,
+            name,
+            sizeof(name));
+        if (key_tests[i].expect == NULL ? rc :
+                (!rc || strcmp(name, key_tests[i].expect) != 0))
+        {
+            printf("# got %s \"%s\"\n", rc ? "true" : "false", name);
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - key for %s\n", i+1, key_tests[i].algorithm);
+    }
+
+#ifdef __linux__
+    stat_buf.st_mtim.tv_sec = 1690000000;
+    stat_buf.st_mtim.tv_nsec = 5;
+
+    globus_l_gfs_file_cksm_cache_value(
+        &stat_buf, now, "0a1b2c3d", value, sizeof(value));
+    if (strcmp(value, "2049 1234567 1000 1690000000.000000005 "
+            "1700000000 0a1b2c3d") != 0)
+    {
+        printf("# got \"%s\"\n", value);
+        printf("not ");
+        failed++;
+    }
+    printf("ok %d - value format\n", key_count + 1);
+
+    for (i = 0; i < match_count; i++)
+    {
+        changed = stat_buf;
+        changed.st_dev += match_tests[i].dev_delta;
+        changed.st_ino += match_tests[i].ino_delta;
+        changed.st_size += match_tests[i].size_delta;
+        changed.st_mtim.tv_nsec += match_tests[i].nsec_delta;
+
+        rc = globus_l_gfs_file_cksm_cache_match(
+            match_tests[i].value ? match_tests[i].value : value,
+            &changed,
+            match_tests[i].max_age,
+            now + match_tests[i].age,
+            cksm);
+        if (rc != match_tests[i].expect_match ||
+            (rc && strcmp(cksm, "0a1b2c3d") != 0))
+        {
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - %s\n", key_count + 2 + i, match_tests[i].test_name);
+    }
+#endif
+
+    return failed;
+}
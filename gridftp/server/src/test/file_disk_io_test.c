@@ -0,0 +1,313 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <fcntl.h>
+
+#include "globus_common.h"
+#include "globus_gridftp_server.h"
+#include "globus_preload.h"
+
+#include "modules/file/globus_gridftp_server_file.c"
+
+extern int globus_i_gfs_config_init();
+
+#define TEST_ASSERT(x) \
+    if (!(x)) { \
+        fprintf(stderr, "# Failed %s: %s\n", test_name, #x); \
+        test_result = 1; \
+        goto test_cleanup; \
+    }
+
+static char                             test_path[] = "file_disk_io_test.XXXXXX";
+static int                              test_fd = -1;
+static bool                             have_o_direct = false;
+
+static
+int
+set_config(char * arg1, char * arg2, char * arg3)
+{
+    char *                              argv[4] = {"globus-gridftp-server"};
+    int                                 argc = 1;
+
+    if (arg1)
+    {
+        argv[argc++] = arg1;
+    }
+    if (arg2)
+    {
+        argv[argc++] = arg2;
+    }
+    if (arg3)
+    {
+        argv[argc++] = arg3;
+    }
+    return globus_i_gfs_config_init(argc, argv, true);
+}
+
+static
+bool
+fd_direct(int fd)
+{
+#ifdef O_DIRECT
+    return (fcntl(fd, F_GETFL) & O_DIRECT) != 0;
+#else
+    return false;
+#endif
+}
+
+/* O_DIRECT only goes on for aligned I/O on a fd the DSI owns */
+static
+int
+test_disk_align(void)
+{
+    const char *                        test_name = "disk_align";
+    globus_l_file_monitor_t *           monitor = NULL;
+    globus_xio_iovec_t                  iov[2];
+    long                                page_size;
+    void *                              buffer = NULL;
+    int                                 test_result = 0;
+
+    page_size = sysconf(_SC_PAGESIZE);
+    TEST_ASSERT(posix_memalign(&buffer, page_size, page_size * 2) == 0);
+    TEST_ASSERT(set_config("-direct", NULL, NULL) == 0);
+    TEST_ASSERT(globus_l_gfs_file_monitor_init(
+        &monitor, page_size, 2) == GLOBUS_SUCCESS);
+
+    /* custom stack: no fd, nothing to do */
+    iov[0].iov_base = buffer;
+    iov[0].iov_len = page_size;
+    globus_l_gfs_file_disk_align(monitor, 0, iov, 1);
+    TEST_ASSERT(!monitor->direct);
+    TEST_ASSERT(!fd_direct(test_fd));
+
+    monitor->disk_fd = test_fd;
+    globus_l_gfs_file_disk_align(monitor, 0, iov, 1);
+    TEST_ASSERT(monitor->direct == fd_direct(test_fd));
+    if (!have_o_direct)
+    {
+        goto test_cleanup;
+    }
+    TEST_ASSERT(monitor->direct);
+
+    /* unaligned offset, length or memory each turn it off again */
+    globus_l_gfs_file_disk_align(monitor, 512, iov, 1);
+    TEST_ASSERT(!monitor->direct && !fd_direct(test_fd));
+
+    globus_l_gfs_file_disk_align(monitor, page_size, iov, 1);
+    TEST_ASSERT(monitor->direct && fd_direct(test_fd));
+
+    iov[1].iov_base = (char *) buffer + page_size;
+    iov[1].iov_len = 100;
+    globus_l_gfs_file_disk_align(monitor, 0, iov, 2);
+    TEST_ASSERT(!monitor->direct && !fd_direct(test_fd));
+
+    iov[1].iov_len = page_size;
+    globus_l_gfs_file_disk_align(monitor, 0, iov, 2);
+    TEST_ASSERT(monitor->direct && fd_direct(test_fd));
+
+    iov[0].iov_base = (char *) buffer + 1;
+    globus_l_gfs_file_disk_align(monitor, 0, iov, 1);
+    TEST_ASSERT(!monitor->direct && !fd_direct(test_fd));
+
+test_cleanup:
+    if (monitor)
+    {
+        globus_l_gfs_file_monitor_destroy(monitor);
+    }
+    free(buffer);
+    return test_result;
+}
+
+/* without -direct the flag is never touched */
+static
+int
+test_disk_align_off(void)
+{
+    const char *                        test_name = "disk_align_off";
+    globus_l_file_monitor_t *           monitor = NULL;
+    globus_xio_iovec_t                  iov;
+    long                                page_size;
+    void *                              buffer = NULL;
+    int                                 test_result = 0;
+
+    page_size = sysconf(_SC_PAGESIZE);
+    TEST_ASSERT(posix_memalign(&buffer, page_size, page_size) == 0);
+    TEST_ASSERT(set_config(NULL, NULL, NULL) == 0);
+    TEST_ASSERT(globus_l_gfs_file_monitor_init(
+        &monitor, page_size, 2) == GLOBUS_SUCCESS);
+
+    monitor->disk_fd = test_fd;
+    iov.iov_base = buffer;
+    iov.iov_len = page_size;
+    globus_l_gfs_file_disk_align(monitor, 0, &iov, 1);
+    TEST_ASSERT(!monitor->direct);
+    TEST_ASSERT(!fd_direct(test_fd));
+
+test_cleanup:
+    if (monitor)
+    {
+        globus_l_gfs_file_monitor_destroy(monitor);
+    }
+    free(buffer);
+    return test_result;
+}
+
+/* background syncing is only set up when it can work */
+static
+int
+test_sync_init_off(void)
+{
+    const char *                        test_name = "sync_init_off";
+    globus_l_file_monitor_t *           monitor = NULL;
+    int                                 test_result = 0;
+
+    TEST_ASSERT(set_config(NULL, NULL, NULL) == 0);
+    TEST_ASSERT(globus_l_gfs_file_monitor_init(
+        &monitor, 65536, 2) == GLOBUS_SUCCESS);
+    monitor->disk_fd = test_fd;
+    globus_l_gfs_file_sync_init(monitor);
+    TEST_ASSERT(monitor->dirty_ranges == NULL);
+    globus_l_gfs_file_monitor_destroy(monitor);
+    monitor = NULL;
+
+    TEST_ASSERT(set_config(
+        "-sync-writes", "-sync-writes-threshold", "0") == 0);
+    TEST_ASSERT(globus_l_gfs_file_monitor_init(
+        &monitor, 65536, 2) == GLOBUS_SUCCESS);
+    monitor->disk_fd = test_fd;
+    globus_l_gfs_file_sync_init(monitor);
+    TEST_ASSERT(monitor->dirty_ranges == NULL);
+    globus_l_gfs_file_monitor_destroy(monitor);
+    monitor = NULL;
+
+    /* custom stack */
+    TEST_ASSERT(set_config("-sync-writes", NULL, NULL) == 0);
+    TEST_ASSERT(globus_l_gfs_file_monitor_init(
+        &monitor, 65536, 2) == GLOBUS_SUCCESS);
+    globus_l_gfs_file_sync_init(monitor);
+    TEST_ASSERT(monitor->dirty_ranges == NULL);
+
+test_cleanup:
+    if (monitor)
+    {
+        globus_l_gfs_file_monitor_destroy(monitor);
+    }
+    return test_result;
+}
+
+/* writes collect in dirty_ranges; nothing moves to flush_ranges while a
+ * flush is still in flight, however much is dirty */
+static
+int
+test_sync_written(void)
+{
+    const char *                        test_name = "sync_written";
+    globus_l_file_monitor_t *           monitor = NULL;
+    globus_off_t                        offset;
+    globus_off_t                        length;
+    int                                 test_result = 0;
+
+    TEST_ASSERT(set_config("-sync-writes", NULL, NULL) == 0);
+    TEST_ASSERT(globus_l_gfs_file_monitor_init(
+        &monitor, 65536, 2) == GLOBUS_SUCCESS);
+    TEST_ASSERT(globus_range_list_init(&monitor->dirty_ranges) == 0);
+    TEST_ASSERT(globus_range_list_init(&monitor->flush_ranges) == 0);
+    monitor->disk_fd = test_fd;
+    monitor->sync_threshold = 1000;
+    monitor->flushing = GLOBUS_TRUE;
+
+    globus_l_gfs_file_sync_written(monitor, 0, 400);
+    globus_l_gfs_file_sync_written(monitor, 800, 400);
+    globus_l_gfs_file_sync_written(monitor, 1200, 0);
+    TEST_ASSERT(monitor->dirty_bytes == 800);
+    TEST_ASSERT(globus_range_list_size(monitor->dirty_ranges) == 2);
+
+    globus_l_gfs_file_sync_written(monitor, 400, 400);
+    TEST_ASSERT(monitor->dirty_bytes == 1200);
+    TEST_ASSERT(globus_range_list_size(monitor->dirty_ranges) == 1);
+    globus_range_list_at(monitor->dirty_ranges, 0, &offset, &length);
+    TEST_ASSERT(offset == 0 && length == 1200);
+
+    TEST_ASSERT(monitor->flushing);
+    TEST_ASSERT(globus_range_list_size(monitor->flush_ranges) == 0);
+
+test_cleanup:
+    if (monitor)
+    {
+        globus_l_gfs_file_monitor_destroy(monitor);
+    }
+    return test_result;
+}
+
+int main()
+{
+    struct
+    {
+        char *                          name;
+        int                           (*func)(void);
+    }
+    test_cases[] =
+    {
+        { "disk_align", test_disk_align },
+        { "disk_align_off", test_disk_align_off },
+        { "sync_init_off", test_sync_init_off },
+        { "sync_written", test_sync_written }
+    };
+    int                                 test_count;
+    int                                 failed = 0;
+    int                                 rc;
+    globus_module_descriptor_t         *modules[] = {
+        GLOBUS_COMMON_MODULE,
+        GLOBUS_GRIDFTP_SERVER_MODULE,
+        NULL
+    };
+
+    LTDL_SET_PRELOADED_SYMBOLS();
+
+    test_fd = mkstemp(test_path);
+    if (test_fd < 0)
+    {
+        fprintf(stderr, "Unable to create %s: %s\n",
+                test_path, strerror(errno));
+        exit(99);
+    }
+#ifdef O_DIRECT
+    /* not every filesystem has it */
+    if (fcntl(test_fd, F_SETFL, fcntl(test_fd, F_GETFL) | O_DIRECT) == 0)
+    {
+        have_o_direct = fd_direct(test_fd);
+        fcntl(test_fd, F_SETFL, fcntl(test_fd, F_GETFL) & ~O_DIRECT);
+    }
+#endif
+
+    rc = globus_module_activate_array(modules, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        fprintf(stderr, "Error activating modules: %d\n", rc);
+        exit(99);
+    }
+
+    test_count = (int) (sizeof(test_cases)/sizeof(test_cases[0]));
+    printf("1..%d\n", test_count);
+    for (int i = 0; i < test_count; i++)
+    {
+        rc = test_cases[i].func();
+        if (rc != 0)
+        {
+            failed++;
+            printf("not ");
+        }
+        printf("ok %d - %s", i+1, test_cases[i].name);
+        if (i == 0 && !have_o_direct)
+        {
+            printf(" # SKIP no O_DIRECT on this filesystem");
+        }
+        printf("\n");
+    }
+
+    globus_module_deactivate_all();
+    close(test_fd);
+    unlink(test_path);
+    return failed;
+}
@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "globus_common.h"
+#include "globus_gridftp_server.h"
+#include "globus_preload.h"
+
+#include "globus_i_gfs_data.c"
+
+typedef struct
+{
+    char *                              value;
+    globus_bool_t                       expect_ok;
+    globus_off_t                        first;
+    globus_off_t                        last;
+}
+range_test_case_t;
+
+typedef struct
+{
+    char *                              content_type;
+    char *                              expect;
+}
+boundary_test_case_t;
+
+#define TEST_ASSERT(x) \
+    if (!(x)) { \
+        fprintf(stderr, "# Failed %s: %s\n", test_name, #x); \
+        test_result = 1; \
+        goto test_cleanup; \
+    }
+
+static
+globus_bool_t
+result_ok(globus_result_t result)
+{
+    if (result != GLOBUS_SUCCESS)
+    {
+        globus_object_free(globus_error_get(result));
+        return GLOBUS_FALSE;
+    }
+    return GLOBUS_TRUE;
+}
+
+/* the reader owns hdr and may write into it */
+static
+void
+set_hdr(globus_l_gfs_data_http_reader_t * reader, const char * data)
+{
+    if (reader->hdr)
+    {
+        globus_free(reader->hdr);
+    }
+    reader->hdr_len = reader->hdr_size = strlen(data);
+    reader->hdr = globus_malloc(reader->hdr_size + 1);
+    memcpy(reader->hdr, data, reader->hdr_size + 1);
+}
+
+static
+int
+test_reader_multipart(void)
+{
+    const char *                        test_name = "reader_multipart";
+    globus_l_gfs_data_http_reader_t *   reader;
+    globus_bool_t                       more;
+    int                                 test_result = 0;
+
+    reader = globus_l_gfs_data_http_reader_create(
+        globus_libc_strdup("--XYZ"), 0, 100, -1);
+
+    /* preamble and the headers of the first part, then its data */
+    set_hdr(reader,
+        "preamble\r\n--XYZ\r\nContent-Type: text/plain\r\n"
+        "content-range: bytes 100-199/1000\r\n\r\nDATA");
+    TEST_ASSERT(result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+    TEST_ASSERT(!more && !reader->eof);
+    TEST_ASSERT(reader->part_offset == 100 && reader->part_left == 100);
+    TEST_ASSERT(reader->hdr_len == 4 && memcmp(reader->hdr, "DATA", 4) == 0);
+
+    /* delimiter split across reads */
+    set_hdr(reader, "\r\n--XY");
+    TEST_ASSERT(result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+    TEST_ASSERT(more);
+    TEST_ASSERT(reader->hdr_len == 4 && memcmp(reader->hdr, "--XY", 4) == 0);
+
+    set_hdr(reader, "\r\n--XYZ\r\nContent-Range: bytes 300-");
+    TEST_ASSERT(result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+    TEST_ASSERT(more);
+
+    /* body ending inside part headers */
+    reader->stream_eof = GLOBUS_TRUE;
+    TEST_ASSERT(!result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+    reader->stream_eof = GLOBUS_FALSE;
+
+    set_hdr(reader, "\r\n--XYZ\r\nContent-Type: text/plain\r\n\r\n");
+    TEST_ASSERT(!result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+
+    /* part before the requested range */
+    set_hdr(reader, "\r\n--XYZ\r\nContent-Range: bytes 0-99/1000\r\n\r\n");
+    TEST_ASSERT(!result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+
+    set_hdr(reader, "\r\n--XYZ--\r\n");
+    TEST_ASSERT(result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+    TEST_ASSERT(!more && reader->eof);
+
+test_cleanup:
+    globus_l_gfs_data_http_reader_destroy(reader);
+    return test_result;
+}
+
+static
+int
+test_reader_plain(void)
+{
+    const char *                        test_name = "reader_plain";
+    globus_l_gfs_data_http_reader_t *   reader;
+    globus_bool_t                       more;
+    int                                 test_result = 0;
+
+    reader = globus_l_gfs_data_http_reader_create(NULL, 100, 100, 500);
+    TEST_ASSERT(reader->part_offset == 100 && reader->part_left == 500);
+    TEST_ASSERT(reader->skip == 0);
+
+    /* waits for the end of the stream */
+    TEST_ASSERT(result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+    TEST_ASSERT(more && !reader->eof);
+
+    reader->stream_eof = GLOBUS_TRUE;
+    TEST_ASSERT(result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+    TEST_ASSERT(!more && reader->eof);
+
+    /* longer than the Content-Range said */
+    set_hdr(reader, "x");
+    TEST_ASSERT(!result_ok(globus_l_gfs_data_http_reader_parse(reader, &more)));
+
+test_cleanup:
+    globus_l_gfs_data_http_reader_destroy(reader);
+    return test_result;
+}
+
+int main()
+{
+    struct
+    {
+        char *                          name;
+        int                           (*func)(void);
+    }
+    reader_tests[] =
+    {
+        { "multipart reader", test_reader_multipart },
+        { "plain body reader", test_reader_plain }
+    };
+    range_test_case_t                   range_tests[] =
+    {
+        { "bytes=0-99",             GLOBUS_TRUE,  0,   0 },
+        { "bytes=500-",             GLOBUS_TRUE,  500, 0 },
+        { " Bytes = 200-299, 100-149", GLOBUS_TRUE, 100, 0 },
+        { "bytes=300-,10-20,40-50", GLOBUS_TRUE,  10,  0 },
+        { "bytes=-500",             GLOBUS_TRUE,  -1,  0 },
+        { "bytes=-500,0-99",        GLOBUS_FALSE, 0,   0 },
+        { "bytes=0-99,-500",        GLOBUS_FALSE, 0,   0 },
+        { "bytes=-0",               GLOBUS_FALSE, 0,   0 },
+        { "bytes=99-0",             GLOBUS_FALSE, 0,   0 },
+        { "bytes=0-99,",            GLOBUS_FALSE, 0,   0 },
+        { "bytes=0-99x",            GLOBUS_FALSE, 0,   0 },
+        { "bytes 0-99",             GLOBUS_FALSE, 0,   0 },
+        { "items=0-99",             GLOBUS_FALSE, 0,   0 }
+    };
+    range_test_case_t                   content_range_tests[] =
+    {
+        { "bytes 0-99/1000",        GLOBUS_TRUE,  0,   99 },
+        { " bytes 100-199/*",       GLOBUS_TRUE,  100, 199 },
+        { "BYTES 5-5/6",            GLOBUS_TRUE,  5,   5 },
+        { "bytes 100-99/1000",      GLOBUS_FALSE, 0,   0 },
+        { "bytes 0-99",             GLOBUS_FALSE, 0,   0 },
+        { "bytes */1000",           GLOBUS_FALSE, 0,   0 },
+        { "0-99/1000",              GLOBUS_FALSE, 0,   0 }
+    };
+    boundary_test_case_t                boundary_tests[] =
+    {
+        { "multipart/byteranges; boundary=3d6b6a416f9b5", "--3d6b6a416f9b5" },
+        { "multipart/byteranges;boundary=\"a b\"",        "--a b" },
+        { "Multipart/Byteranges; charset=x; Boundary=abc; y=z", "--abc" },
+        { "multipart/byteranges",                         NULL },
+        { "multipart/byteranges; boundary=",              NULL },
+        { "multipart/mixed; boundary=abc",                NULL },
+        { "text/plain",                                   NULL }
+    };
+    int                                 range_count;
+    int                                 content_range_count;
+    int                                 boundary_count;
+    int                                 reader_count;
+    int                                 test_num = 0;
+    int                                 failed = 0;
+    globus_off_t                        first;
+    globus_off_t                        last;
+    char *                              boundary;
+    globus_bool_t                       rc;
+    int                                 i;
+    globus_module_descriptor_t         *modules[] = {
+        GLOBUS_COMMON_MODULE,
+        GLOBUS_GRIDFTP_SERVER_MODULE,
+        NULL
+    };
+
+    LTDL_SET_PRELOADED_SYMBOLS();
+
+    rc = globus_module_activate_array(modules, NULL);
+    if (rc != GLOBUS_SUCCESS)
+    {
+        fprintf(stderr, "Error activating modules: %d\n", rc);
+        exit(99);
+    }
+
+    range_count = (int) (sizeof(range_tests)/sizeof(range_tests[0]));
+    content_range_count = (int)
+        (sizeof(content_range_tests)/sizeof(content_range_tests[0]));
+    boundary_count = (int) (sizeof(boundary_tests)/sizeof(boundary_tests[0]));
+    reader_count = (int) (sizeof(reader_tests)/sizeof(reader_tests[0]));
+    printf("1..%d\n",
+        range_count + content_range_count + boundary_count + reader_count);
+
+    for (i = 0; i < range_count; i++)
+    {
+        first = -2;
+        rc = result_ok(globus_l_gfs_data_http_parse_range(
+            range_tests[i].value, &first));
+        if (rc != range_tests[i].expect_ok ||
+            (rc && first != range_tests[i].first))
+        {
+            printf("# got %s %"GLOBUS_OFF_T_FORMAT"\n",
+                rc ? "ok" : "error", first);
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - Range: %s\n", ++test_num, range_tests[i].value);
+    }
+
+    for (i = 0; i < content_range_count; i++)
+    {
+        first = last = -2;
+        rc = result_ok(globus_l_gfs_data_http_parse_content_range(
+            content_range_tests[i].value, &first, &last));
+        if (rc != content_range_tests[i].expect_ok ||
+            (rc && (first != content_range_tests[i].first ||
+                    last != content_range_tests[i].last)))
+        {
+            printf("# got %s %"GLOBUS_OFF_T_FORMAT"-%"GLOBUS_OFF_T_FORMAT"\n",
+                rc ? "ok" : "error", first, last);
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - Content-Range: %s\n",
+            ++test_num, content_range_tests[i].value);
+    }
+
+    for (i = 0; i < boundary_count; i++)
+    {
+        boundary = globus_l_gfs_data_http_boundary(
+            boundary_tests[i].content_type);
+        rc = boundary_tests[i].expect == NULL ? boundary == NULL :
+            (boundary != NULL &&
+                strcmp(boundary, boundary_tests[i].expect) == 0);
+        if (!rc)
+        {
+            printf("# got \"%s\"\n", boundary ? boundary : "(null)");
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - Content-Type: %s\n",
+            ++test_num, boundary_tests[i].content_type);
+        if (boundary)
+        {
+            globus_free(boundary);
+        }
+    }
+
+    for (i = 0; i < reader_count; i++)
+    {
+        if (reader_tests[i].func() != 0)
+        {
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - %s\n", ++test_num, reader_tests[i].name);
+    }
+
+    globus_module_deactivate_all();
+    return failed;
+}
@@ -1701,19 +1701,6 @@ globus_gsi_cred_verify_cert_chain(
 
     GLOBUS_I_GSI_CRED_DEBUG_ENTER;
     
-    cert_store = X509_STORE_new();
-    if (cert_store == NULL)
-    {
-        GLOBUS_GSI_CRED_ERROR_CHAIN_RESULT(
-            result,
-                GLOBUS_GSI_CRED_ERROR_WITH_CALLBACK_DATA);
-        goto exit;
-    }
-
-    X509_STORE_set_verify_cb_func(cert_store, 
-                                  globus_gsi_callback_create_proxy_callback);
-    X509_STORE_set_depth(cert_store, GLOBUS_GSI_CALLBACK_VERIFY_DEPTH);
-
     result = globus_gsi_callback_get_cert_dir(callback_data, &cert_dir);
     if(result != GLOBUS_SUCCESS)
     {
@@ -1726,18 +1713,27 @@ globus_gsi_cred_verify_cert_chain(
     tmp_cert = cred_handle->cert;
     cert = tmp_cert;
     
-    if (X509_STORE_load_locations(cert_store, NULL, cert_dir))
+    if (cert_dir != NULL)
     {
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-        /* override the check_issued with our version */
-        cert_store->check_issued = globus_gsi_callback_check_issued;
-#else
-        X509_STORE_set_check_issued(cert_store, globus_gsi_callback_check_issued);
-#endif
+        /*
+         * The trust store is shared with other verifications using the
+         * same cert_dir, so the proxy callback is set on the store
+         * context rather than on the store.
+         */
+        result = globus_gsi_cred_get_trust_store(cert_dir, &cert_store);
+        if(result != GLOBUS_SUCCESS)
+        {
+            GLOBUS_GSI_CRED_ERROR_CHAIN_RESULT(
+                result,
+                GLOBUS_GSI_CRED_ERROR_VERIFYING_CRED);
+            goto exit;
+        }
 
         store_context = X509_STORE_CTX_new();
         X509_STORE_CTX_init(store_context, cert_store, cert,
                             cred_handle->cert_chain);
+        X509_STORE_CTX_set_verify_cb(store_context,
+                                     globus_gsi_callback_create_proxy_callback);
         X509_STORE_CTX_set_depth(store_context,
                                  GLOBUS_GSI_CALLBACK_VERIFY_DEPTH);
 
@@ -1894,18 +1890,6 @@ globus_gsi_cred_verify_cert_chain_when(
         }
     }
     
-    cert_store = X509_STORE_new();
-    if(cert_store == NULL)
-    {
-        GLOBUS_GSI_CRED_ERROR_CHAIN_RESULT(
-            result, GLOBUS_GSI_CRED_ERROR_WITH_CALLBACK_DATA);
-        goto exit;
-    }
-
-    X509_STORE_set_verify_cb_func(cert_store, 
-                                  globus_gsi_callback_create_proxy_callback);
-    X509_STORE_set_depth(cert_store, GLOBUS_GSI_CALLBACK_VERIFY_DEPTH);
-
     result = globus_gsi_callback_get_cert_dir(callback_data, &cert_dir);
     if(result != GLOBUS_SUCCESS)
     {
@@ -1918,18 +1902,27 @@ globus_gsi_cred_verify_cert_chain_when(
     tmp_cert = cred_handle->cert;
     cert = tmp_cert;
     
-    if (X509_STORE_load_locations(cert_store, NULL, cert_dir))
+    if (cert_dir != NULL)
     {
-        /* override the check_issued with our version */
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-        cert_store->check_issued = globus_gsi_callback_check_issued;
-#else
-        X509_STORE_set_check_issued(cert_store, globus_gsi_callback_check_issued);
-#endif
+        /*
+         * The trust store is shared with other verifications using the
+         * same cert_dir, so the proxy callback is set on the store
+         * context rather than on the store.
+         */
+        result = globus_gsi_cred_get_trust_store(cert_dir, &cert_store);
+        if(result != GLOBUS_SUCCESS)
+        {
+            GLOBUS_GSI_CRED_ERROR_CHAIN_RESULT(
+                result,
+                GLOBUS_GSI_CRED_ERROR_VERIFYING_CRED);
+            goto exit;
+        }
 
         store_context = X509_STORE_CTX_new();
         X509_STORE_CTX_init(store_context, cert_store, cert,
                             cred_handle->cert_chain);
+        X509_STORE_CTX_set_verify_cb(store_context,
+                                     globus_gsi_callback_create_proxy_callback);
         X509_STORE_CTX_set_depth(store_context,
                                  GLOBUS_GSI_CALLBACK_VERIFY_DEPTH);
 
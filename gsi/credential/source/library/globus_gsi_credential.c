@@ -22,6 +22,7 @@
 #include "openssl/x509.h"
 #include "openssl/pkcs12.h"
 #include "openssl/err.h"
+#include <sys/stat.h>
 
 #ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
 
@@ -30,8 +31,35 @@
 #define PKCS12_bag_type(b) M_PKCS12_bag_type(b)
 #define PKCS12_cert_bag_type(b) M_PKCS12_cert_bag_type(b)
 #define PKCS12_SAFEBAG_get0_p8inf(bag) (bag)->value.keybag;
+#define X509_STORE_up_ref(s) \
+    CRYPTO_add(&(s)->references, 1, CRYPTO_LOCK_X509_STORE)
 #endif
 
+/* Default number of seconds a cached trust store is used before it is
+ * rebuilt, even if the trusted certificate directory appears unchanged.
+ * This bounds how long an in-place CRL or CA file update goes unnoticed.
+ */
+#define GLOBUS_L_GSI_CRED_TRUST_STORE_LIFETIME 300
+
+typedef struct globus_l_gsi_cred_trust_store_s
+{
+    char *                              cert_dir;
+    X509_STORE *                        store;
+    dev_t                               dev;
+    ino_t                               ino;
+    time_t                              mtime;
+    time_t                              created;
+    struct globus_l_gsi_cred_trust_store_s *
+                                        next;
+}
+globus_l_gsi_cred_trust_store_t;
+
+static globus_mutex_t                   globus_l_gsi_cred_trust_store_mutex;
+static globus_l_gsi_cred_trust_store_t *
+                                        globus_l_gsi_cred_trust_stores = NULL;
+static int                              globus_l_gsi_cred_trust_store_lifetime =
+                                        GLOBUS_L_GSI_CRED_TRUST_STORE_LIFETIME;
+
 static int globus_l_gsi_credential_activate(void);
 static int globus_l_gsi_credential_deactivate(void);
 
@@ -118,6 +146,18 @@ globus_l_gsi_credential_activate(void)
     
     OpenSSL_add_all_algorithms();
 
+    tmp_string = globus_module_getenv("GLOBUS_GSI_CRED_TRUST_STORE_LIFETIME");
+    if(tmp_string != GLOBUS_NULL)
+    {
+        globus_l_gsi_cred_trust_store_lifetime = atoi(tmp_string);
+
+        if(globus_l_gsi_cred_trust_store_lifetime < 0)
+        {
+            globus_l_gsi_cred_trust_store_lifetime = 0;
+        }
+    }
+    globus_mutex_init(&globus_l_gsi_cred_trust_store_mutex, NULL);
+
     GLOBUS_I_GSI_CRED_DEBUG_EXIT;
     
  exit:
@@ -137,6 +177,19 @@ globus_l_gsi_credential_deactivate(void)
 
     GLOBUS_I_GSI_CRED_DEBUG_ENTER;
 
+    while(globus_l_gsi_cred_trust_stores != NULL)
+    {
+        globus_l_gsi_cred_trust_store_t *   entry;
+
+        entry = globus_l_gsi_cred_trust_stores;
+        globus_l_gsi_cred_trust_stores = entry->next;
+
+        X509_STORE_free(entry->store);
+        free(entry->cert_dir);
+        free(entry);
+    }
+    globus_mutex_destroy(&globus_l_gsi_cred_trust_store_mutex);
+
     EVP_cleanup();
 
     globus_module_deactivate(GLOBUS_GSI_CALLBACK_MODULE);
@@ -1997,6 +2050,165 @@ globus_gsi_cred_get_cert_type(
 }
 /* globus_gsi_cred_get_cert_type() */
 
+/**
+ * @brief Get a shared trust store
+ * @ingroup globus_gsi_cred_operations
+ * @details
+ * Return an X.509 certificate store which looks up trusted certificates,
+ * CRLs and signing policies in the given trusted certificate directory.
+ * Stores are cached per directory and shared by every caller in the
+ * process, so certificates and CRLs loaded from the directory during one
+ * path validation are reused by the next.  A cached store is replaced when
+ * the directory's modification time changes, or when it is older than
+ * GLOBUS_GSI_CRED_TRUST_STORE_LIFETIME seconds (default 300).  Setting
+ * that environment variable to 0 disables caching.
+ *
+ * Callers must not add certificates or CRLs of their own to the returned
+ * store, as they would become trusted by every other user of the store.
+ *
+ * @param cert_dir
+ *        The trusted certificate directory.
+ * @param trust_store
+ *        The returned store. The caller holds a reference to it and must
+ *        release it with X509_STORE_free(), or pass it on to something
+ *        which takes ownership such as SSL_CTX_set_cert_store().
+ *
+ * @return
+ *        GLOBUS_SUCCESS or an error captured in a globus_result_t
+ */
+globus_result_t
+globus_gsi_cred_get_trust_store(
+    const char *                        cert_dir,
+    X509_STORE **                       trust_store)
+{
+    globus_l_gsi_cred_trust_store_t *   entry = NULL;
+    X509_STORE *                        store = NULL;
+    struct stat                         stat_buf;
+    time_t                              now;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+
+    GLOBUS_I_GSI_CRED_DEBUG_ENTER;
+
+    if(cert_dir == NULL || trust_store == NULL)
+    {
+        GLOBUS_GSI_CRED_ERROR_RESULT(
+            result,
+            GLOBUS_GSI_CRED_ERROR_BAD_PARAMETER,
+            (_GCRSL("NULL parameter passed to function: %s"), __func__));
+        goto exit;
+    }
+    *trust_store = NULL;
+
+    /* a missing directory is not an error here, as it was never one for
+     * X509_STORE_load_locations(); it just yields a store with nothing in it
+     */
+    if(stat(cert_dir, &stat_buf) != 0)
+    {
+        memset(&stat_buf, 0, sizeof(stat_buf));
+    }
+    now = time(NULL);
+
+    globus_mutex_lock(&globus_l_gsi_cred_trust_store_mutex);
+
+    if(globus_l_gsi_cred_trust_store_lifetime > 0)
+    {
+        for(entry = globus_l_gsi_cred_trust_stores;
+            entry != NULL;
+            entry = entry->next)
+        {
+            if(strcmp(entry->cert_dir, cert_dir) == 0)
+            {
+                break;
+            }
+        }
+        if(entry != NULL &&
+           entry->dev == stat_buf.st_dev &&
+           entry->ino == stat_buf.st_ino &&
+           entry->mtime == stat_buf.st_mtime &&
+           now >= entry->created &&
+           now - entry->created < globus_l_gsi_cred_trust_store_lifetime)
+        {
+            X509_STORE_up_ref(entry->store);
+            *trust_store = entry->store;
+            goto unlock;
+        }
+    }
+
+    store = X509_STORE_new();
+    if(store == NULL)
+    {
+        GLOBUS_GSI_CRED_OPENSSL_ERROR_RESULT(
+            result,
+            GLOBUS_GSI_CRED_ERROR_SYSTEM_CONFIG,
+            (_GCRSL("Couldn't create trusted certificate store")));
+        goto unlock;
+    }
+    if(!X509_STORE_load_locations(store, NULL, cert_dir))
+    {
+        GLOBUS_GSI_CRED_OPENSSL_ERROR_RESULT(
+            result,
+            GLOBUS_GSI_CRED_ERROR_SYSTEM_CONFIG,
+            (_GCRSL("Couldn't load trusted certificate directory %s"),
+             cert_dir));
+        X509_STORE_free(store);
+        goto unlock;
+    }
+
+    /* override the check_issued with our version */
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+    store->check_issued = globus_gsi_callback_check_issued;
+#else
+    X509_STORE_set_check_issued(store, globus_gsi_callback_check_issued);
+#endif
+
+    if(globus_l_gsi_cred_trust_store_lifetime > 0)
+    {
+        if(entry == NULL)
+        {
+            entry = calloc(1, sizeof(globus_l_gsi_cred_trust_store_t));
+            if(entry != NULL)
+            {
+                entry->cert_dir = strdup(cert_dir);
+                if(entry->cert_dir == NULL)
+                {
+                    free(entry);
+                    entry = NULL;
+                }
+                else
+                {
+                    entry->next = globus_l_gsi_cred_trust_stores;
+                    globus_l_gsi_cred_trust_stores = entry;
+                }
+            }
+        }
+        else
+        {
+            /* holders of the old store keep their own references */
+            X509_STORE_free(entry->store);
+            entry->store = NULL;
+        }
+
+        /* if the entry couldn't be allocated the store is simply not cached */
+        if(entry != NULL)
+        {
+            X509_STORE_up_ref(store);
+            entry->store = store;
+            entry->dev = stat_buf.st_dev;
+            entry->ino = stat_buf.st_ino;
+            entry->mtime = stat_buf.st_mtime;
+            entry->created = now;
+        }
+    }
+    *trust_store = store;
+
+ unlock:
+    globus_mutex_unlock(&globus_l_gsi_cred_trust_store_mutex);
+ exit:
+    GLOBUS_I_GSI_CRED_DEBUG_EXIT;
+    return result;
+}
+/* globus_gsi_cred_get_trust_store() */
+
 #ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
 
 /**
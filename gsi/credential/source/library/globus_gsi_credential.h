@@ -255,6 +255,11 @@ globus_gsi_cred_verify_cert_chain_when(
 globus_result_t globus_gsi_cred_verify(
     globus_gsi_cred_handle_t            handle);
 
+globus_result_t
+globus_gsi_cred_get_trust_store(
+    const char *                        cert_dir,
+    X509_STORE **                       trust_store);
+
 globus_result_t globus_gsi_cred_get_X509_subject_name(
     globus_gsi_cred_handle_t            handle,
     X509_NAME **                        subject_name);
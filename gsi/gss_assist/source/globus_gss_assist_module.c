@@ -92,6 +92,7 @@ globus_l_gsi_gss_assist_activate(void)
     globus_module_activate(GLOBUS_GSI_GSSAPI_MODULE);
 
     globus_mutex_init(&globus_i_gsi_gss_assist_mutex, NULL);
+    globus_i_gss_assist_gridmap_cache_init();
 
  exit:
     GLOBUS_I_GSI_GSS_ASSIST_DEBUG_EXIT;    
@@ -110,6 +111,7 @@ globus_l_gsi_gss_assist_deactivate(void)
     
     GLOBUS_I_GSI_GSS_ASSIST_DEBUG_ENTER;
     
+    globus_i_gss_assist_gridmap_cache_destroy();
     globus_mutex_destroy(&globus_i_gsi_gss_assist_mutex);
 
     globus_module_deactivate(GLOBUS_GSI_GSSAPI_MODULE);
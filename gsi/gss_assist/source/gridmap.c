@@ -29,6 +29,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 typedef struct _gridmap_line_s {
   char *dn;
@@ -938,6 +940,476 @@ globus_gss_assist_map_local_user(
 /* globus_gss_assist_map_local_user() */
 
 #ifndef GLOBUS_DONT_DOCUMENT_INTERNAL
+/*
+ * Parsed copy of the gridmap file, indexed by DN and by local user.  Only
+ * one file is cached at a time; it is rebuilt whenever the configured
+ * gridmap filename changes or the file's identity, size or timestamps do,
+ * so each lookup costs one stat() instead of a full parse.  The cache is
+ * only touched with globus_l_gss_assist_gridmap_cache_mutex held, and
+ * lookups hand back private copies of the lines they find.
+ */
+#define GLOBUS_L_GSS_ASSIST_GRIDMAP_MALLOC_ERROR(_RESULT_) \
+    _RESULT_ = globus_error_put(globus_error_wrap_errno_error( \
+        GLOBUS_GSI_GSS_ASSIST_MODULE, \
+        errno, \
+        GLOBUS_GSI_GSS_ASSIST_ERROR_ERRNO, \
+        __FILE__, \
+        _function_name_, \
+        __LINE__, \
+        _GASL("Could not allocate enough memory")))
+
+typedef struct
+{
+    /* line numbers of every gridmap line that lists this user */
+    int *                               lines;
+    int                                 line_count;
+    int                                 line_max;
+    /* first line with this user as the default, or -1 */
+    int                                 default_line;
+    /* first line with this user as a secondary mapping, or -1 */
+    int                                 nondefault_line;
+} globus_l_gss_assist_gridmap_user_t;
+
+typedef struct
+{
+    char *                              filename;
+    struct stat                         stat_buf;
+    globus_i_gss_assist_gridmap_line_t **
+                                        lines;
+    char **                             dn_keys;
+    int                                 line_count;
+    int                                 line_max;
+    globus_hashtable_t                  dn_index;
+    globus_hashtable_t                  user_index;
+} globus_l_gss_assist_gridmap_cache_t;
+
+static globus_mutex_t                   globus_l_gss_assist_gridmap_cache_mutex;
+static globus_l_gss_assist_gridmap_cache_t *
+                                        globus_l_gss_assist_gridmap_cache;
+
+/*
+ * Key under which globus_i_gsi_cert_utils_dn_cmp() would consider two DNs
+ * equal: the same UID/E/Email rewriting, folded to lower case.
+ */
+static
+char *
+globus_l_gss_assist_gridmap_dn_key(
+    const char *                        dn)
+{
+    char *                              key;
+    const char *                        from;
+    char *                              to;
+
+    /* each rewrite grows by at most 11 characters per 2 consumed */
+    key = malloc(strlen(dn) * 7 + 1);
+    if (key == NULL)
+    {
+        return NULL;
+    }
+
+    from = dn;
+    to = key;
+    while (*from != NUL)
+    {
+        *to++ = tolower((unsigned char) *from);
+        if (*from++ == '/')
+        {
+            if (strncasecmp(from, "UID=", 4) == 0)
+            {
+                memcpy(to, "userid=", 7);
+                to += 7;
+                from += 4;
+            }
+            else if (strncasecmp(from, "E=", 2) == 0)
+            {
+                memcpy(to, "emailaddress=", 13);
+                to += 13;
+                from += 2;
+            }
+            else if (strncasecmp(from, "Email=", 6) == 0)
+            {
+                memcpy(to, "emailaddress=", 13);
+                to += 13;
+                from += 6;
+            }
+        }
+    }
+    *to = NUL;
+
+    return key;
+}
+
+static
+globus_result_t
+globus_l_gss_assist_gridmap_line_copy(
+    const globus_i_gss_assist_gridmap_line_t *
+                                        gline,
+    globus_i_gss_assist_gridmap_line_t **
+                                        copy)
+{
+    globus_i_gss_assist_gridmap_line_t *
+                                        gline_tmp;
+    int                                 count = 0;
+    int                                 i;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    static char *                       _function_name_ =
+        "globus_l_gss_assist_gridmap_line_copy";
+
+    gline_tmp = calloc(1, sizeof(globus_i_gss_assist_gridmap_line_t));
+    if (gline_tmp == NULL)
+    {
+        goto error;
+    }
+    gline_tmp->dn = strdup(gline->dn);
+    if (gline_tmp->dn == NULL)
+    {
+        goto error;
+    }
+    if (gline->user_ids != NULL)
+    {
+        while (gline->user_ids[count] != NULL)
+        {
+            count++;
+        }
+        gline_tmp->user_ids = calloc(count + 1, sizeof(char *));
+        if (gline_tmp->user_ids == NULL)
+        {
+            goto error;
+        }
+        for (i = 0; i < count; i++)
+        {
+            gline_tmp->user_ids[i] = strdup(gline->user_ids[i]);
+            if (gline_tmp->user_ids[i] == NULL)
+            {
+                goto error;
+            }
+        }
+    }
+    *copy = gline_tmp;
+
+    return result;
+
+error:
+    globus_i_gss_assist_gridmap_line_free(gline_tmp);
+    GLOBUS_L_GSS_ASSIST_GRIDMAP_MALLOC_ERROR(result);
+    *copy = NULL;
+
+    return result;
+}
+
+static
+void
+globus_l_gss_assist_gridmap_user_free(
+    void *                              datum)
+{
+    globus_l_gss_assist_gridmap_user_t *
+                                        user = datum;
+
+    free(user->lines);
+    free(user);
+}
+
+static
+void
+globus_l_gss_assist_gridmap_cache_free(
+    globus_l_gss_assist_gridmap_cache_t *
+                                        cache)
+{
+    int                                 i;
+
+    if (cache == NULL)
+    {
+        return;
+    }
+    globus_hashtable_destroy(&cache->dn_index);
+    globus_hashtable_destroy_all(
+        &cache->user_index, globus_l_gss_assist_gridmap_user_free);
+    for (i = 0; i < cache->line_count; i++)
+    {
+        globus_i_gss_assist_gridmap_line_free(cache->lines[i]);
+        free(cache->dn_keys[i]);
+    }
+    free(cache->lines);
+    free(cache->dn_keys);
+    free(cache->filename);
+    free(cache);
+}
+
+static
+globus_bool_t
+globus_l_gss_assist_gridmap_cache_valid(
+    globus_l_gss_assist_gridmap_cache_t *
+                                        cache,
+    const char *                        filename,
+    const struct stat *                 stat_buf)
+{
+    return cache != NULL &&
+        strcmp(cache->filename, filename) == 0 &&
+        cache->stat_buf.st_dev == stat_buf->st_dev &&
+        cache->stat_buf.st_ino == stat_buf->st_ino &&
+        cache->stat_buf.st_size == stat_buf->st_size &&
+        cache->stat_buf.st_mtime == stat_buf->st_mtime &&
+        cache->stat_buf.st_ctime == stat_buf->st_ctime
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        && cache->stat_buf.st_mtim.tv_nsec == stat_buf->st_mtim.tv_nsec
+        && cache->stat_buf.st_ctim.tv_nsec == stat_buf->st_ctim.tv_nsec
+#endif
+        ;
+}
+
+/* record that line line_no maps dn to each of its user ids */
+static
+globus_result_t
+globus_l_gss_assist_gridmap_cache_add(
+    globus_l_gss_assist_gridmap_cache_t *
+                                        cache,
+    globus_i_gss_assist_gridmap_line_t *
+                                        gline)
+{
+    globus_l_gss_assist_gridmap_user_t *
+                                        user;
+    char *                              key;
+    int                                 line_no;
+    int                                 i;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    static char *                       _function_name_ =
+        "globus_l_gss_assist_gridmap_cache_add";
+
+    if (cache->line_count == cache->line_max)
+    {
+        void *                          tmp;
+        int                             new_max;
+
+        new_max = cache->line_max ? cache->line_max * 2 : 256;
+        tmp = realloc(cache->lines, new_max * sizeof(*cache->lines));
+        if (tmp == NULL)
+        {
+            goto error;
+        }
+        cache->lines = tmp;
+        tmp = realloc(cache->dn_keys, new_max * sizeof(*cache->dn_keys));
+        if (tmp == NULL)
+        {
+            goto error;
+        }
+        cache->dn_keys = tmp;
+        cache->line_max = new_max;
+    }
+
+    key = globus_l_gss_assist_gridmap_dn_key(gline->dn);
+    if (key == NULL)
+    {
+        goto error;
+    }
+    line_no = cache->line_count++;
+    cache->lines[line_no] = gline;
+    cache->dn_keys[line_no] = key;
+
+    /* the first line for a DN wins, as with a top to bottom scan */
+    if (globus_hashtable_lookup(&cache->dn_index, key) == NULL)
+    {
+        globus_hashtable_insert(&cache->dn_index, key, gline);
+    }
+
+    for (i = 0; gline->user_ids != NULL && gline->user_ids[i] != NULL; i++)
+    {
+        user = globus_hashtable_lookup(
+            &cache->user_index, gline->user_ids[i]);
+        if (user == NULL)
+        {
+            user = calloc(1, sizeof(globus_l_gss_assist_gridmap_user_t));
+            if (user == NULL)
+            {
+                goto error;
+            }
+            user->default_line = -1;
+            user->nondefault_line = -1;
+            globus_hashtable_insert(
+                &cache->user_index, gline->user_ids[i], user);
+        }
+        /* a user listed twice on one line still counts once */
+        if (user->line_count > 0 &&
+            user->lines[user->line_count - 1] == line_no)
+        {
+            continue;
+        }
+        if (user->line_count == user->line_max)
+        {
+            int *                       tmp;
+
+            tmp = realloc(user->lines,
+                (user->line_max ? user->line_max * 2 : 4) * sizeof(int));
+            if (tmp == NULL)
+            {
+                goto error;
+            }
+            user->lines = tmp;
+            user->line_max = user->line_max ? user->line_max * 2 : 4;
+        }
+        user->lines[user->line_count++] = line_no;
+
+        if (i == 0 && user->default_line == -1)
+        {
+            user->default_line = line_no;
+        }
+        else if (i != 0 && user->nondefault_line == -1)
+        {
+            user->nondefault_line = line_no;
+        }
+    }
+
+    return result;
+
+error:
+    GLOBUS_L_GSS_ASSIST_GRIDMAP_MALLOC_ERROR(result);
+    return result;
+}
+
+/*
+ * Make sure globus_l_gss_assist_gridmap_cache holds the current contents
+ * of the default gridmap file, parsing it again if it has changed.
+ * Called with globus_l_gss_assist_gridmap_cache_mutex held.
+ */
+static
+globus_result_t
+globus_l_gss_assist_gridmap_cache_load(void)
+{
+    char *                              gridmap_filename = NULL;
+    struct stat                         stat_buf;
+    FILE *                              gmap_stream = NULL;
+    globus_l_gss_assist_gridmap_cache_t *
+                                        cache = NULL;
+    globus_i_gss_assist_gridmap_line_t *
+                                        gline;
+    char *                              line;
+    int                                 buckets;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    static char *                       _function_name_ =
+        "globus_l_gss_assist_gridmap_cache_load";
+
+    result = GLOBUS_GSI_SYSCONFIG_GET_GRIDMAP_FILENAME(&gridmap_filename);
+    if (result != GLOBUS_SUCCESS)
+    {
+        gridmap_filename = NULL;
+        GLOBUS_GSI_GSS_ASSIST_ERROR_CHAIN_RESULT(
+            result,
+            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP);
+        goto exit;
+    }
+
+    gmap_stream = fopen(gridmap_filename, "r");
+    if (gmap_stream == NULL || fstat(fileno(gmap_stream), &stat_buf) != 0)
+    {
+        GLOBUS_GSI_GSS_ASSIST_ERROR_RESULT(
+            result,
+            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP,
+            (_GASL("Couldn't open gridmap file: %s for reading."),
+             gridmap_filename));
+        goto exit;
+    }
+
+    if (globus_l_gss_assist_gridmap_cache_valid(
+            globus_l_gss_assist_gridmap_cache, gridmap_filename, &stat_buf))
+    {
+        goto exit;
+    }
+
+    cache = calloc(1, sizeof(globus_l_gss_assist_gridmap_cache_t));
+    if (cache == NULL)
+    {
+        GLOBUS_L_GSS_ASSIST_GRIDMAP_MALLOC_ERROR(result);
+        goto exit;
+    }
+    /* start the tables at roughly one slot per line so loading a large
+     * file doesn't resize them over and over */
+    buckets = GLOBUS_MAX(1024, stat_buf.st_size / 64) | 1;
+    globus_hashtable_init(
+        &cache->dn_index,
+        buckets,
+        globus_hashtable_string_hash,
+        globus_hashtable_string_keyeq);
+    globus_hashtable_init(
+        &cache->user_index,
+        buckets,
+        globus_hashtable_string_hash,
+        globus_hashtable_string_keyeq);
+    cache->filename = gridmap_filename;
+    gridmap_filename = NULL;
+    cache->stat_buf = stat_buf;
+
+    for (;;)
+    {
+        result = globus_l_gss_assist_read_line(gmap_stream, &line);
+        if (result != GLOBUS_SUCCESS || line == NULL)
+        {
+            break;
+        }
+
+        result = globus_i_gss_assist_gridmap_parse_line(line, &gline);
+        free(line);
+        if (result != GLOBUS_SUCCESS)
+        {
+            /* Parse error, skip the line like a direct scan would */
+            result = GLOBUS_SUCCESS;
+            continue;
+        }
+        if (gline == NULL)
+        {
+            /* Empty line or comment */
+            continue;
+        }
+
+        result = globus_l_gss_assist_gridmap_cache_add(cache, gline);
+        if (result != GLOBUS_SUCCESS)
+        {
+            if (cache->line_count == 0 ||
+                cache->lines[cache->line_count - 1] != gline)
+            {
+                globus_i_gss_assist_gridmap_line_free(gline);
+            }
+            break;
+        }
+    }
+    if (result != GLOBUS_SUCCESS)
+    {
+        GLOBUS_GSI_GSS_ASSIST_ERROR_CHAIN_RESULT(
+            result,
+            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP);
+        globus_l_gss_assist_gridmap_cache_free(cache);
+        goto exit;
+    }
+
+    globus_l_gss_assist_gridmap_cache_free(globus_l_gss_assist_gridmap_cache);
+    globus_l_gss_assist_gridmap_cache = cache;
+
+ exit:
+    if (gmap_stream != NULL)
+    {
+        fclose(gmap_stream);
+    }
+    if (gridmap_filename != NULL)
+    {
+        free(gridmap_filename);
+    }
+
+    return result;
+}
+
+void
+globus_i_gss_assist_gridmap_cache_init(void)
+{
+    globus_mutex_init(&globus_l_gss_assist_gridmap_cache_mutex, NULL);
+    globus_l_gss_assist_gridmap_cache = NULL;
+}
+
+void
+globus_i_gss_assist_gridmap_cache_destroy(void)
+{
+    globus_l_gss_assist_gridmap_cache_free(globus_l_gss_assist_gridmap_cache);
+    globus_l_gss_assist_gridmap_cache = NULL;
+    globus_mutex_destroy(&globus_l_gss_assist_gridmap_cache_mutex);
+}
+
 /**
  * @ingroup globus_i_gsi_gss_assist
  * Locate the entry for the given DN in the default gridmap file
@@ -963,11 +1435,8 @@ globus_i_gss_assist_gridmap_find_dn(
     globus_i_gss_assist_gridmap_line_t **		        
                                         gline)
 {
-    char *                              gridmap_filename = NULL;
     globus_result_t                     result = GLOBUS_SUCCESS;
-    char *				open_mode = "r";
-    FILE *				gmap_stream = NULL;
-    int					found = 0;
+    char *                              key = NULL;
     globus_i_gss_assist_gridmap_line_t *			
                                         gline_tmp = NULL;
     static char *                       _function_name_ =
@@ -985,80 +1454,35 @@ globus_i_gss_assist_gridmap_find_dn(
 	goto exit;
     }
 
-    result = GLOBUS_GSI_SYSCONFIG_GET_GRIDMAP_FILENAME(&gridmap_filename);
-    if(result != GLOBUS_SUCCESS)
-    {
-        gridmap_filename = NULL;
-        GLOBUS_GSI_GSS_ASSIST_ERROR_CHAIN_RESULT(
-            result,
-            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP);
-        goto exit;
-    }
-
-    gmap_stream = fopen(gridmap_filename, open_mode);
-
-    if (gmap_stream == NULL)
+    key = globus_l_gss_assist_gridmap_dn_key(dn);
+    if (key == NULL)
     {
-        GLOBUS_GSI_GSS_ASSIST_ERROR_RESULT(
-            result,
-            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP,
-            (_GASL("Couldn't open gridmap file: %s for reading."),
-             gridmap_filename));
+        GLOBUS_L_GSS_ASSIST_GRIDMAP_MALLOC_ERROR(result);
         goto exit;
     }
 
-    free(gridmap_filename);
-    gridmap_filename = NULL;
-
-    do
+    globus_mutex_lock(&globus_l_gss_assist_gridmap_cache_mutex);
+    result = globus_l_gss_assist_gridmap_cache_load();
+    if (result == GLOBUS_SUCCESS)
     {
-        char *                          line;
-
-	result = globus_l_gss_assist_read_line(gmap_stream, &line);
-        if (result != GLOBUS_SUCCESS || line == NULL)
+        gline_tmp = globus_hashtable_lookup(
+            &globus_l_gss_assist_gridmap_cache->dn_index, key);
+        if (gline_tmp != NULL)
         {
-            break;
+            result = globus_l_gss_assist_gridmap_line_copy(gline_tmp, gline);
         }
-
-        result = globus_i_gss_assist_gridmap_parse_line(line, &gline_tmp);
-	if (result != GLOBUS_SUCCESS)
-	{
-            GLOBUS_GSI_GSS_ASSIST_ERROR_CHAIN_RESULT(
-                result,
-                GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP);
-            free(line);
-            continue;		/* Parse error */
+        else
+        {
+            *gline = NULL;
         }
-
-	if ((gline_tmp != NULL) &&
-            (globus_i_gsi_cert_utils_dn_cmp(dn, gline_tmp->dn) == 0))
-	{
-            found = 1;
-	}
-	else
-	{
-	    globus_i_gss_assist_gridmap_line_free(gline_tmp);
-	}
-        free(line);
-    } while (!found);
-
-    fclose(gmap_stream);
-    gmap_stream = NULL;
-
-    if (found)
-    {
-        *gline = gline_tmp;
-    }
-    else
-    {
-        *gline = NULL;
     }
+    globus_mutex_unlock(&globus_l_gss_assist_gridmap_cache_mutex);
 
  exit:
 
-    if (gridmap_filename != NULL)
+    if (key != NULL)
     {
-	free(gridmap_filename);
+	free(key);
     }
 
     GLOBUS_I_GSI_GSS_ASSIST_DEBUG_EXIT;
@@ -1093,14 +1517,9 @@ globus_i_gss_assist_gridmap_find_local_user(
     globus_i_gss_assist_gridmap_line_t **	                
                                         gline)
 {
-    char *				gridmap_filename = NULL;
-    char *				open_mode = "r";
-    FILE *				gmap_stream = NULL;
-    int					found = 0;
-    globus_i_gss_assist_gridmap_line_t *			
-                                        gline_tmp;
-    char ** 	                        useridp;
-    char *                              nondefault_line = NULL;
+    globus_l_gss_assist_gridmap_user_t *
+                                        user;
+    int                                 line_no = -1;
     globus_result_t                     result = GLOBUS_SUCCESS;
     static char *                       _function_name_ =
         "globus_i_gss_assist_gridmap_find_local_user";
@@ -1116,112 +1535,33 @@ globus_i_gss_assist_gridmap_find_local_user(
         goto exit;
     }
 
-    result = GLOBUS_GSI_SYSCONFIG_GET_GRIDMAP_FILENAME(&gridmap_filename);
-    if(result != GLOBUS_SUCCESS)
-    {
-        gridmap_filename = NULL;
-        GLOBUS_GSI_GSS_ASSIST_ERROR_CHAIN_RESULT(
-            result,
-            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP);
-        goto exit;
-    }
-            
-    gmap_stream = fopen(gridmap_filename, open_mode);
-
-    if (gmap_stream == NULL)
+    globus_mutex_lock(&globus_l_gss_assist_gridmap_cache_mutex);
+    result = globus_l_gss_assist_gridmap_cache_load();
+    if (result == GLOBUS_SUCCESS)
     {
-        GLOBUS_GSI_GSS_ASSIST_ERROR_RESULT(
-            result,
-            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP,
-            (_GASL("Can't open the file: %s"), gridmap_filename));
-        goto exit;
-    }
-
-    do
-    {
-        char *                          line;
-        char *                          save_line;
-
-        result = globus_l_gss_assist_read_line(gmap_stream, &line);
-        if (result != GLOBUS_SUCCESS || line == NULL)
+        user = globus_hashtable_lookup(
+            &globus_l_gss_assist_gridmap_cache->user_index,
+            (void *) local_user);
+        if (user != NULL)
         {
-            break;
+            /* prefer a line where the user is the default mapping, 
+             * otherwise the first line where it is a secondary one */
+            line_no = (user->default_line != -1) 
+                ? user->default_line : user->nondefault_line;
         }
-        
-        save_line = strdup(line);
-        
-	result = globus_i_gss_assist_gridmap_parse_line(line, &gline_tmp);
-        if(result != GLOBUS_SUCCESS)
-        {
-            free(line);
-            free(save_line);
-	    continue;		/* Parse error */
-        }
-
-	if (gline_tmp == NULL)
-	{
-	    /* Empty line */
-            free(line);
-            free(save_line);
-	    continue;
-	}
-
-        for(useridp = gline_tmp->user_ids; 
-            useridp != NULL && *useridp != NULL && !found; 
-            useridp++)
+        if (line_no != -1)
         {
-            if(strcmp(local_user, *useridp) == 0)
-            {
-                /* check all names, but only stop looking if we match a 
-                 * default name.  Save the first non-default match until 
-                 * we've checked all the defaults */
-                if(*useridp == gline_tmp->user_ids[0])
-                {
-                    found = 1;
-                }
-                else if(nondefault_line == NULL)
-                {
-                    nondefault_line = strdup(save_line);
-                }
-            }
+            result = globus_l_gss_assist_gridmap_line_copy(
+                globus_l_gss_assist_gridmap_cache->lines[line_no], gline);
         }
-        if(!found)
-	{
-	    globus_i_gss_assist_gridmap_line_free(gline_tmp);
-	}
-        free(line);
-        free(save_line);
-    } while (!found);
-    
-    if(nondefault_line != NULL)
-    {
-	result = globus_i_gss_assist_gridmap_parse_line(
-	    nondefault_line, &gline_tmp);
-        free(nondefault_line);
-        if(result != GLOBUS_SUCCESS)
+        else
         {
-	    goto exit;
+            *gline = NULL;
         }
-        found = 1;
-    }        
-
-    fclose(gmap_stream);
-    gmap_stream = NULL;
-
-    if (found)
-	*gline = gline_tmp;
-    else
-	*gline = NULL;
-
- exit:
-
-    if (gridmap_filename)
-    {
-	free(gridmap_filename);
     }
+    globus_mutex_unlock(&globus_l_gss_assist_gridmap_cache_mutex);
 
-    if (gmap_stream)
-	fclose(gmap_stream);
+ exit:
 
     GLOBUS_I_GSI_GSS_ASSIST_DEBUG_EXIT;
     return result;
@@ -1771,15 +2111,11 @@ globus_gss_assist_lookup_all_globusid(
     char **                                     dns[],
     int *                                       dn_count)
 {
-    char *                                      line;
     int                                         i;
-    int                                         max_ndx = 512;
     int                                         ndx = 0;
     char **                                     l_dns;
-    globus_i_gss_assist_gridmap_line_t *        gline = NULL;
-    char *                                      gridmap_filename = NULL;
+    globus_l_gss_assist_gridmap_user_t *        user;
     globus_result_t                             res = GLOBUS_SUCCESS;
-    FILE *                                      gmap_stream = NULL;
     static char *                       _function_name_ =
         "globus_gss_assist_lookup_all_globusid";
 
@@ -1798,84 +2134,45 @@ globus_gss_assist_lookup_all_globusid(
         goto exit;
     }
 
-    res = GLOBUS_GSI_SYSCONFIG_GET_GRIDMAP_FILENAME(&gridmap_filename);
+    globus_mutex_lock(&globus_l_gss_assist_gridmap_cache_mutex);
+    res = globus_l_gss_assist_gridmap_cache_load();
     if(res != GLOBUS_SUCCESS)
     {
-        gridmap_filename = NULL;
-        GLOBUS_GSI_GSS_ASSIST_ERROR_CHAIN_RESULT(
-            res,
-            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP);
+        globus_mutex_unlock(&globus_l_gss_assist_gridmap_cache_mutex);
 
         goto exit;
     }
 
-    gmap_stream = fopen(gridmap_filename, "r");
+    user = globus_hashtable_lookup(
+        &globus_l_gss_assist_gridmap_cache->user_index, username);
 
-    if (gmap_stream == NULL)
+    l_dns = (char **)globus_malloc(
+        sizeof(char *) * ((user != NULL ? user->line_count : 0) + 1));
+    if(l_dns == NULL)
     {
-        GLOBUS_GSI_GSS_ASSIST_ERROR_RESULT(
-            res,
-            GLOBUS_GSI_GSS_ASSIST_ERROR_WITH_GRIDMAP,
-            (_GASL("Couldn't open gridmap file: %s for reading."),
-             gridmap_filename));
+        globus_mutex_unlock(&globus_l_gss_assist_gridmap_cache_mutex);
+        GLOBUS_L_GSS_ASSIST_GRIDMAP_MALLOC_ERROR(res);
 
         goto exit;
     }
 
-    ndx = 0;
-    l_dns = (char **)globus_malloc(sizeof(char *) * max_ndx);
-
-    while (!feof(gmap_stream))
+    for(i = 0; user != NULL && i < user->line_count; i++)
     {
-        res = globus_l_gss_assist_read_line(gmap_stream, &line);
-        if (res != GLOBUS_SUCCESS || line == NULL)
+        l_dns[ndx] = strdup(
+            globus_l_gss_assist_gridmap_cache->lines[user->lines[i]]->dn);
+        if(l_dns[ndx] != NULL)
         {
-            break;
-        }
-
-        res = globus_i_gss_assist_gridmap_parse_line(line, &gline);
-
-        if(res == GLOBUS_SUCCESS &&
-           gline != NULL &&
-           gline->user_ids != NULL)
-        {
-            for (i = 0; gline->user_ids[i] != NULL; i++)
-            {
-                if(strcmp(gline->user_ids[i], username) == 0)
-                {
-                    l_dns[ndx] = strdup(gline->dn);
-                    ndx++;
-                    if(ndx >= max_ndx)
-                    {
-                        max_ndx *= 2;
-                        l_dns = (char **)globus_libc_realloc(l_dns,
-                                             sizeof(char *) * max_ndx);
-                    }
-                    break;
-                }
-            }
+            ndx++;
         }
-        if (gline != NULL)
-        {
-            globus_i_gss_assist_gridmap_line_free(gline);
-            gline = NULL;
-        }
-        free(line);
     }
+    globus_mutex_unlock(&globus_l_gss_assist_gridmap_cache_mutex);
+
     l_dns[ndx] = NULL;
     *dns = l_dns;
     *dn_count = ndx;
 
-    fclose(gmap_stream);
-    gmap_stream = NULL;
-
  exit:
 
-    if(gridmap_filename != NULL)
-    {
-        free(gridmap_filename);
-    }
-
     GLOBUS_I_GSI_GSS_ASSIST_DEBUG_EXIT;
 
     return res;
@@ -792,6 +792,111 @@ setenv_failed:
 /* blank_line_test() */
 
 
+static
+int
+write_gridmap(
+    const char *                        path,
+    const char *                        dn,
+    const char *                        username)
+{
+    FILE *                              fp;
+    char *                              tmp_path;
+    int                                 rc = 0;
+
+    /* replace the file rather than rewriting it in place, as the
+     * grid-mapfile tools do */
+    tmp_path = globus_common_create_string("%s.tmp", path);
+    fp = fopen(tmp_path, "w");
+    if (fp == NULL)
+    {
+        rc = 1;
+        goto out;
+    }
+    fprintf(fp, "\"%s\" %s\n", dn, username);
+    fclose(fp);
+    rc = rename(tmp_path, path);
+out:
+    free(tmp_path);
+    return rc;
+}
+/* write_gridmap() */
+
+int
+gridmap_reload_test(void)
+{
+    int                                 failed = 0;
+    int                                 rc;
+    char *                              gridmap = "gridmap.reload";
+    char *                              userid = NULL;
+    char *                              equivalent_dn = 
+        "/dc=org/dc=doegrids/ou=people/USERID=328453245"
+        "/emailAddress=john@doe.com/emailAddress=john@doe.com";
+
+    rc = write_gridmap(gridmap, test_dn, primary_username);
+    if (rc != 0)
+    {
+        fprintf(stderr, "# Error writing %s\n", gridmap);
+        failed++;
+        goto out;
+    }
+    rc = globus_libc_setenv("GRIDMAP", gridmap, 1);
+    if (rc != 0)
+    {
+        fprintf(stderr, "# Error setting GRIDMAP location\n");
+        failed++;
+        goto out;
+    }
+
+    rc = globus_gss_assist_gridmap(test_dn, &userid);
+    if (rc != 0 || strcmp(userid, primary_username) != 0)
+    {
+        fprintf(stderr, "# globus_gss_assist_gridmap unexpectedly failed [%s in %s]\n", test_dn, gridmap);
+        failed++;
+    }
+    free(userid);
+    userid = NULL;
+
+    /* same DN with the attribute spellings dn_cmp treats as equal */
+    rc = globus_gss_assist_gridmap(equivalent_dn, &userid);
+    if (rc != 0 || strcmp(userid, primary_username) != 0)
+    {
+        fprintf(stderr, "# globus_gss_assist_gridmap unexpectedly failed [%s in %s]\n", equivalent_dn, gridmap);
+        failed++;
+    }
+    free(userid);
+    userid = NULL;
+
+    /* a changed file must be picked up by the next lookup */
+    rc = write_gridmap(gridmap, test_dn, secondary_username[0]);
+    if (rc != 0)
+    {
+        fprintf(stderr, "# Error writing %s\n", gridmap);
+        failed++;
+        goto out;
+    }
+    rc = globus_gss_assist_gridmap(test_dn, &userid);
+    if (rc != 0 || strcmp(userid, secondary_username[0]) != 0)
+    {
+        fprintf(stderr, "# globus_gss_assist_gridmap returned stale mapping [%s in %s]\n", test_dn, gridmap);
+        failed++;
+    }
+    free(userid);
+    userid = NULL;
+
+    rc = globus_gss_assist_userok(test_dn, primary_username);
+    if (rc == 0)
+    {
+        fprintf(stderr, "# globus_gss_assist_userok unexpectedly succeeded [userok %s for %s in %s]\n", primary_username, test_dn, gridmap);
+        failed++;
+    }
+
+out:
+    remove(gridmap);
+    return failed;
+}
+/* gridmap_reload_test() */
+
+
 int main(int argc, char * argv[])
 {
     test_case_t                         tests[] =
@@ -806,7 +911,8 @@ int main(int argc, char * argv[])
         TEST_CASE(map_local_user_test),
         TEST_CASE(lookup_all_globusid_test),
         TEST_CASE(long_line_test),
-        TEST_CASE(blank_line_test)
+        TEST_CASE(blank_line_test),
+        TEST_CASE(gridmap_reload_test)
     };
     int                                 i;
     int                                 failed = 0;
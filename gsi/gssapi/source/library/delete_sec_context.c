@@ -160,6 +160,15 @@ GSS_CALLCONV gss_delete_sec_context(
 
     if ((*context_handle)->gss_ssl)
     {
+        if ((*context_handle)->gss_state == GSS_CON_ST_DONE)
+        {
+            /* GSI contexts are not closed with TLS alerts, so an
+             * established context must be marked as shut down or
+             * SSL_free() evicts its session from the cache
+             */
+            SSL_set_shutdown((*context_handle)->gss_ssl,
+                             SSL_SENT_SHUTDOWN|SSL_RECEIVED_SHUTDOWN);
+        }
         SSL_free((*context_handle)->gss_ssl);
         (*context_handle)->gss_ssl = NULL;
     } 
@@ -197,6 +206,9 @@ GSS_CALLCONV gss_delete_sec_context(
     }
     free((*context_handle)->sni_credentials);
     free((*context_handle)->alpn);
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    SSL_SESSION_free((*context_handle)->tls_session);
+#endif
 #if OPENSSL_VERSION_NUMBER >= 0x10000100L
     free((*context_handle)->mac_key);
     free((*context_handle)->mac_iv_fixed);
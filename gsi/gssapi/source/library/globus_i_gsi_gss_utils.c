@@ -62,6 +62,16 @@ globus_l_gsi_gss_alpn_select_callback(
     const unsigned char                *in,
     unsigned int                        inlen,
     void                               *arg);
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+static
+OM_uint32
+globus_l_gsi_gss_restore_resumed_peer(
+    OM_uint32 *                         minor_status,
+    gss_ctx_id_desc *                   context_handle,
+    X509 *                              peer_cert);
+#endif
+
 /**
  * @defgroup globus_i_gsi_gss_utils Globus GSSAPI Internals
  * @brief Globus GSSAPI Internals
@@ -526,27 +536,6 @@ globus_i_gsi_gss_create_and_fill_context(
         }
     }
 
-    #if (OPENSSL_VERSION_NUMBER >= 0x009080dfL)
-    {
-        /*
-         * OpenSSL 0.9.8m and 1.0.0 introduce changes to how
-         * ssl3_output_cert_chain creates the certificate chain to send.
-         *
-         * The new code uses X509_verify_cert(), which fails if
-         * a certificate does not have a X509_V_ERR_KEYUSAGE_NO_CERTSIGN but
-         * signs a proxy. As a result, the entire certificate chain is not
-         * sent during the handshake.
-         *
-         * This code causes the issuer checks to use
-         * globus_gsi_callback_check_issued() to handle that error if
-         * the certificate in question is a proxy.
-         */
-        X509_STORE * store = SSL_CTX_get_cert_store(
-                context->cred_handle->ssl_context);
-        X509_STORE_set_check_issued(store, globus_gsi_callback_check_issued);
-    }
-    #endif
-
     context->gss_ssl = SSL_new(context->cred_handle->ssl_context);
 
     if (context->gss_ssl == NULL)
@@ -576,6 +565,24 @@ globus_i_gsi_gss_create_and_fill_context(
             context->gss_ssl, context->alpn, context->alpn_length);
     }
 #endif
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    /*
+     * Resumption uses TLS 1.2 session IDs: TLS 1.3 only resumes with
+     * tickets sent after the handshake, which the GSI token exchange has
+     * no room for. So an initiator asking for a resumable session caps
+     * the protocol at TLS 1.2 if the configured minimum allows it.
+     */
+    if (cred_usage == GSS_C_INITIATE
+        && context->tls_resume
+        && globus_i_gsi_gssapi_min_tls_protocol <= TLS1_2_VERSION)
+    {
+        SSL_set_max_proto_version(context->gss_ssl, TLS1_2_VERSION);
+        if (context->tls_session != NULL)
+        {
+            SSL_set_session(context->gss_ssl, context->tls_session);
+        }
+    }
+#endif
 
     /* This is needed for compatibility with Bestman */
     SSL_set_options(context->gss_ssl, SSL_OP_DONT_INSERT_EMPTY_FRAGMENTS);
@@ -1359,6 +1366,21 @@ globus_i_gsi_gss_retrieve_peer(
             goto exit;
         }
 
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+        /* the verify callback doesn't run for a resumed session */
+        if (SSL_session_reused(context_handle->gss_ssl))
+        {
+            major_status = globus_l_gsi_gss_restore_resumed_peer(
+                minor_status,
+                context_handle,
+                peer_cert);
+            if (GSS_ERROR(major_status))
+            {
+                goto exit;
+            }
+        }
+#endif
+
         local_result = globus_gsi_callback_get_cert_chain(
             context_handle->callback_data,
             &peer_cert_chain);
@@ -1433,6 +1455,115 @@ globus_i_gsi_gss_retrieve_peer(
     return major_status;
 }
 
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+/**
+ * @brief Restore Resumed Peer
+ * @ingroup globus_i_gsi_gss_utils
+ * @details
+ * When a TLS session is resumed the peer's certificate chain is not
+ * verified again, so the callback data the verify callback normally fills
+ * in is empty. Fill it in from the chain stored in the session, after
+ * checking that none of the certificates has expired since the session
+ * was established.
+ *
+ * @param minor_status
+ *        The minor status returned
+ * @param context_handle
+ *        The context with the resumed session
+ * @param peer_cert
+ *        The peer's end certificate
+ *
+ * @return
+ *        GSS_S_COMPLETE on success, GSS_S_CREDENTIALS_EXPIRED if part of the
+ *        chain expired, GSS_S_FAILURE otherwise
+ */
+static
+OM_uint32
+globus_l_gsi_gss_restore_resumed_peer(
+    OM_uint32 *                         minor_status,
+    gss_ctx_id_desc *                   context_handle,
+    X509 *                              peer_cert)
+{
+    OM_uint32                           major_status = GSS_S_COMPLETE;
+    globus_result_t                     local_result;
+    STACK_OF(X509) *                    session_chain;
+    STACK_OF(X509) *                    chain = NULL;
+    globus_gsi_cert_utils_cert_type_t   cert_type;
+    int                                 index;
+
+    GLOBUS_I_GSI_GSSAPI_DEBUG_ENTER;
+
+    /* the client's view of the chain includes the peer's end certificate,
+     * the server's doesn't
+     */
+    session_chain = SSL_get_peer_cert_chain(context_handle->gss_ssl);
+    chain = session_chain ? sk_X509_dup(session_chain) : sk_X509_new_null();
+    if (chain == NULL)
+    {
+        GLOBUS_GSI_GSSAPI_MALLOC_ERROR(minor_status);
+        major_status = GSS_S_FAILURE;
+        goto exit;
+    }
+    if (sk_X509_num(chain) == 0 ||
+        X509_cmp(sk_X509_value(chain, 0), peer_cert) != 0)
+    {
+        if (!sk_X509_unshift(chain, peer_cert))
+        {
+            GLOBUS_GSI_GSSAPI_MALLOC_ERROR(minor_status);
+            major_status = GSS_S_FAILURE;
+            goto exit;
+        }
+    }
+
+    for (index = 0; index < sk_X509_num(chain); index++)
+    {
+        if (X509_cmp_current_time(
+                X509_get0_notAfter(sk_X509_value(chain, index))) <= 0)
+        {
+            GLOBUS_GSI_GSSAPI_ERROR_RESULT(
+                minor_status,
+                GLOBUS_GSI_GSSAPI_ERROR_EXPIRED_CREDENTIAL,
+                (_GGSL("A certificate in the resumed session's peer chain "
+                       "has expired")));
+            major_status = GSS_S_CREDENTIALS_EXPIRED;
+            goto exit;
+        }
+    }
+
+    local_result = globus_gsi_cert_utils_get_cert_type(peer_cert, &cert_type);
+    if (local_result == GLOBUS_SUCCESS)
+    {
+        local_result = globus_gsi_callback_set_cert_type(
+            context_handle->callback_data, cert_type);
+    }
+    if (local_result == GLOBUS_SUCCESS)
+    {
+        local_result = globus_gsi_callback_set_cert_depth(
+            context_handle->callback_data, sk_X509_num(chain));
+    }
+    if (local_result == GLOBUS_SUCCESS)
+    {
+        local_result = globus_gsi_callback_set_cert_chain(
+            context_handle->callback_data, chain);
+    }
+    if (local_result != GLOBUS_SUCCESS)
+    {
+        GLOBUS_GSI_GSSAPI_ERROR_CHAIN_RESULT(
+            minor_status, local_result,
+            GLOBUS_GSI_GSSAPI_ERROR_WITH_CALLBACK_DATA);
+        major_status = GSS_S_FAILURE;
+        goto exit;
+    }
+
+ exit:
+    /* the certificates belong to the session */
+    sk_X509_free(chain);
+
+    GLOBUS_I_GSI_GSSAPI_DEBUG_EXIT;
+    return major_status;
+}
+#endif
+
 /**
  * @brief Create Anonymous Cred
  * @ingroup globus_i_gsi_gss_utils
@@ -2281,6 +2412,7 @@ globus_i_gsi_gssapi_init_ssl_context(
     OM_uint32                           major_status = GSS_S_COMPLETE;
     gss_cred_id_desc *                  cred_handle;
     char *                              ca_cert_dir = NULL;
+    globus_bool_t                       share_trust_store = GLOBUS_FALSE;
 
     GLOBUS_I_GSI_GSSAPI_DEBUG_ENTER;
 
@@ -2378,6 +2510,18 @@ globus_i_gsi_gssapi_init_ssl_context(
 
     SSL_CTX_sess_set_cache_size(cred_handle->ssl_context, 5);
 
+    /*
+     * OpenSSL refuses to resume a session of a verified peer without a
+     * session id context. Sessions are only offered by initiators which
+     * ask for it with the GSS_TLS_SESSION option. Keep them short-lived, as
+     * revocation isn't rechecked when a session is resumed.
+     */
+    SSL_CTX_set_session_id_context(
+        cred_handle->ssl_context,
+        (const unsigned char *) "globus_gssapi_gsi",
+        sizeof("globus_gssapi_gsi") - 1);
+    SSL_CTX_set_timeout(cred_handle->ssl_context, 300);
+
     local_result = GLOBUS_GSI_SYSCONFIG_GET_CERT_DIR(&ca_cert_dir);
 
     if(local_result != GLOBUS_SUCCESS)
@@ -2390,9 +2534,40 @@ globus_i_gsi_gssapi_init_ssl_context(
         goto exit;
     }
 
-    if(!SSL_CTX_load_verify_locations(cred_handle->ssl_context,
-                                      NULL,
-                                      ca_cert_dir))
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+    /*
+     * Credentials share the process-wide trust store for the cert dir, so
+     * that CA certificates, CRLs and lookups loaded for one handshake are
+     * reused by the next. The credential's own chain is sent from the
+     * SSL_CTX chain instead of being added to the store. SNI credentials
+     * and anonymous credentials with extra CA certificates modify their
+     * store, so they still get a private one.
+     */
+    share_trust_store =
+        !sni_context &&
+        (anon_ctx != GLOBUS_I_GSI_GSS_ANON_CONTEXT ||
+         getenv("GLOBUS_GFS_EXTRA_CA_CERTS") == NULL);
+#endif
+
+    if(share_trust_store)
+    {
+        X509_STORE *                    trust_store = NULL;
+
+        local_result = globus_gsi_cred_get_trust_store(
+            ca_cert_dir, &trust_store);
+        if(local_result != GLOBUS_SUCCESS)
+        {
+            GLOBUS_GSI_GSSAPI_ERROR_CHAIN_RESULT(
+                minor_status, local_result,
+                GLOBUS_GSI_GSSAPI_ERROR_WITH_GSI_CREDENTIAL);
+            major_status = GSS_S_FAILURE;
+            goto exit;
+        }
+        SSL_CTX_set_cert_store(cred_handle->ssl_context, trust_store);
+    }
+    else if(!SSL_CTX_load_verify_locations(cred_handle->ssl_context,
+                                           NULL,
+                                           ca_cert_dir))
     {
         major_status = GSS_S_FAILURE;
         GLOBUS_GSI_GSSAPI_OPENSSL_ERROR_RESULT(
@@ -2402,6 +2577,29 @@ globus_i_gsi_gssapi_init_ssl_context(
         goto exit;
     }
 
+    #if (OPENSSL_VERSION_NUMBER >= 0x009080dfL)
+    if(!share_trust_store)
+    {
+        /*
+         * OpenSSL 0.9.8m and 1.0.0 introduce changes to how
+         * ssl3_output_cert_chain creates the certificate chain to send.
+         *
+         * The new code uses X509_verify_cert(), which fails if
+         * a certificate does not have a X509_V_ERR_KEYUSAGE_NO_CERTSIGN but
+         * signs a proxy. As a result, the entire certificate chain is not
+         * sent during the handshake.
+         *
+         * This code causes the issuer checks to use
+         * globus_gsi_callback_check_issued() to handle that error if
+         * the certificate in question is a proxy. A shared trust store
+         * has it set already by globus_gsi_cred_get_trust_store().
+         */
+        X509_STORE_set_check_issued(
+            SSL_CTX_get_cert_store(cred_handle->ssl_context),
+            globus_gsi_callback_check_issued);
+    }
+    #endif
+
     /* Set the verify callback to test our proxy
      * policies.
      */
@@ -2514,6 +2712,29 @@ globus_i_gsi_gssapi_init_ssl_context(
                 goto exit;
             }
 
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+            if(client_cert_chain && share_trust_store)
+            {
+                int                         index;
+
+                for(index = 0; index < sk_X509_num(client_cert_chain); ++index)
+                {
+                    if(!SSL_CTX_add1_chain_cert(
+                           cred_handle->ssl_context,
+                           sk_X509_value(client_cert_chain, index)))
+                    {
+                        GLOBUS_GSI_GSSAPI_OPENSSL_ERROR_RESULT(
+                            minor_status,
+                            GLOBUS_GSI_GSSAPI_ERROR_WITH_OPENSSL,
+                            (_GGSL("Couldn't add certificate to the SSL context's "
+                             "certificate chain.")));
+                        major_status = GSS_S_FAILURE;
+                        goto exit;
+                    }
+                }
+            }
+            else
+#endif
             if(client_cert_chain)
             {
                 int                         index;
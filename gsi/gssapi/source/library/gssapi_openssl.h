@@ -207,6 +207,10 @@ typedef struct gss_ctx_id_desc_struct{
     char                               *sni_servername;
     unsigned char                      *alpn;
     size_t                              alpn_length;
+    /** Offer TLS session resumption (initiator only) */
+    bool                                tls_resume;
+    /** Session to resume, from a previous context to the same peer */
+    SSL_SESSION                        *tls_session;
 } gss_ctx_id_desc;
 
 extern
@@ -236,6 +240,9 @@ const gss_OID_desc * const gss_ext_tls_version_oid;
 extern
 const gss_OID_desc * const gss_ext_tls_cipher_oid;
 
+extern
+const gss_OID_desc * const gss_ext_tls_session_oid;
+
 extern
 globus_bool_t                           globus_i_backward_compatible_mic;
 extern
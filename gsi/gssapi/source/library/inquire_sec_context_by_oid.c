@@ -253,6 +253,47 @@ GSS_CALLCONV gss_inquire_sec_context_by_oid(
             }
         }
     }
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    else if (g_OID_equal(desired_object, gss_ext_tls_session_oid))
+    {
+        SSL_SESSION *                   session;
+        unsigned char *                 session_der = NULL;
+        unsigned char *                 p;
+        int                             len;
+
+        /* Nothing is returned if the session can't be resumed, for example
+         * if TLS 1.3 was negotiated
+         */
+        session = SSL_get_session(context_handle->gss_ssl);
+        if (session != NULL
+            && SSL_SESSION_is_resumable(session)
+            && (len = i2d_SSL_SESSION(session, NULL)) > 0
+            && (session_der = malloc(len)) != NULL)
+        {
+            p = session_der;
+            i2d_SSL_SESSION(session, &p);
+
+            major_status = gss_add_buffer_set_member(
+                &local_minor_status,
+                &(gss_buffer_desc)
+                {
+                    .value = session_der,
+                    .length = len,
+                },
+                data_set);
+            OPENSSL_cleanse(session_der, len);
+            free(session_der);
+
+            if(GSS_ERROR(major_status))
+            {
+                GLOBUS_GSI_GSSAPI_ERROR_CHAIN_RESULT(
+                    minor_status, local_minor_status,
+                    GLOBUS_GSI_GSSAPI_ERROR_WITH_BUFFER);
+                goto unlock_exit;
+            }
+        }
+    }
+#endif
     else if(((gss_OID_desc *)desired_object)->length !=
        gss_ext_x509_cert_chain_oid->length ||
        memcmp(((gss_OID_desc *)desired_object)->elements,
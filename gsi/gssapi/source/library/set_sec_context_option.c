@@ -54,6 +54,11 @@ static const gss_OID_desc GSS_ALPN_OID =
 const gss_OID_desc * const GSS_ALPN =
    &GSS_ALPN_OID;
 
+static const gss_OID_desc GSS_TLS_SESSION_OID =
+   {11, "\x2b\x06\x01\x04\x01\x9b\x50\x01\x01\x03\x06"};
+const gss_OID_desc * const GSS_TLS_SESSION =
+   &GSS_TLS_SESSION_OID;
+
 /**
  * @brief Set Security Context Option
  * @ingroup globus_gsi_gssapi_extensions
@@ -257,6 +262,42 @@ GSS_CALLCONV gss_set_sec_context_option(
         memcpy(context->alpn, value->value, value->length);
         context->alpn_length = value->length;
     }
+#endif
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    else if(g_OID_equal(option, GSS_TLS_SESSION))
+    {
+        const unsigned char *           session_der;
+
+        if (value == GSS_C_NO_BUFFER)
+        {
+            GLOBUS_GSI_GSSAPI_ERROR_RESULT(
+                minor_status,
+                GLOBUS_GSI_GSSAPI_ERROR_BAD_ARGUMENT,
+                (_GGSL("Invalid buffer passed to function")));
+            major_status = GSS_S_FAILURE;
+            goto exit;
+        }
+        /* An empty buffer asks for a resumable session without offering
+         * one, for the first connection to a peer.
+         */
+        context->tls_resume = true;
+        if (value->length > 0)
+        {
+            SSL_SESSION_free(context->tls_session);
+            session_der = value->value;
+            context->tls_session = d2i_SSL_SESSION(
+                NULL, &session_der, (long) value->length);
+            if (context->tls_session == NULL)
+            {
+                GLOBUS_GSI_GSSAPI_OPENSSL_ERROR_RESULT(
+                    minor_status,
+                    GLOBUS_GSI_GSSAPI_ERROR_BAD_ARGUMENT,
+                    (_GGSL("Couldn't decode TLS session")));
+                major_status = GSS_S_FAILURE;
+                goto exit;
+            }
+        }
+    }
 #endif
     else
     {
@@ -0,0 +1,317 @@
+/*
+ * Copyright 1999-2017 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gssapi_test_utils.h"
+#include <stdbool.h>
+
+static gss_OID_desc tls_session_oid_desc =
+     {11, "\x2b\x06\x01\x04\x01\x9b\x50\x01\x01\x01\x0d"};
+static gss_OID_desc * tls_session_oid = &tls_session_oid_desc;
+
+#define GSS_TLS_SESSION \
+    &(gss_OID_desc) {11, "\x2b\x06\x01\x04\x01\x9b\x50\x01\x01\x03\x06"}
+
+struct test_case
+{
+    bool                              (*func)(void);
+    const char *                        name;
+};
+
+static gss_cred_id_t                    cred = GSS_C_NO_CREDENTIAL;
+
+/*
+ * Establish a context pair using cred on both sides, offering session to
+ * the initiator if non-NULL, and counting the bytes the initiator
+ * sent. If saved is non-NULL, the initiator's session is returned in
+ * it.
+ */
+static
+bool
+establish(
+    gss_buffer_t                        session,
+    size_t                             *init_bytes,
+    gss_buffer_t                        saved,
+    const char                        **why)
+{
+    OM_uint32                           major_status = GSS_S_COMPLETE;
+    OM_uint32                           minor_status = GLOBUS_SUCCESS;
+    gss_ctx_id_t                        init_context = GSS_C_NO_CONTEXT;
+    gss_ctx_id_t                        accept_context = GSS_C_NO_CONTEXT;
+    gss_buffer_desc                     init_generated_token = {0};
+    gss_buffer_desc                     accept_generated_token = {0};
+    OM_uint32                           ignore_minor_status = 0;
+    gss_buffer_set_desc                *data = NULL;
+    bool                                result = true;
+
+    *init_bytes = 0;
+
+    if (session != NULL)
+    {
+        major_status = gss_set_sec_context_option(
+                &minor_status,
+                &init_context,
+                GSS_TLS_SESSION,
+                session);
+        if (major_status != GSS_S_COMPLETE)
+        {
+            *why = "gss_set_sec_context_option";
+            result = false;
+            goto fail;
+        }
+    }
+    do
+    {
+        major_status = gss_init_sec_context(
+                &minor_status,
+                cred,
+                &init_context,
+                GSS_C_NO_NAME,
+                GSS_C_NO_OID,
+                0,
+                0,
+                GSS_C_NO_CHANNEL_BINDINGS,
+                &accept_generated_token,
+                NULL,
+                &init_generated_token,
+                NULL,
+                NULL);
+
+        gss_release_buffer(
+                &ignore_minor_status,
+                &accept_generated_token);
+
+        if (GSS_ERROR(major_status))
+        {
+            *why = "gss_init_sec_context";
+            result = false;
+            break;
+        }
+
+        if (init_generated_token.length > 0)
+        {
+            *init_bytes += init_generated_token.length;
+            major_status = gss_accept_sec_context(
+                    &minor_status,
+                    &accept_context,
+                    cred,
+                    &init_generated_token,
+                    GSS_C_NO_CHANNEL_BINDINGS,
+                    NULL,
+                    NULL,
+                    &accept_generated_token,
+                    NULL,
+                    NULL,
+                    NULL);
+            gss_release_buffer(
+                    &ignore_minor_status,
+                    &init_generated_token);
+
+            if (GSS_ERROR(major_status))
+            {
+                *why = "gss_accept_sec_context";
+                result = false;
+            }
+        }
+    }
+    while (major_status == GSS_S_CONTINUE_NEEDED);
+
+    if (major_status == GSS_S_COMPLETE && saved != NULL)
+    {
+        major_status = gss_inquire_sec_context_by_oid(
+            &minor_status,
+            init_context,
+            (gss_OID_desc *) tls_session_oid,
+            &data);
+
+        if (major_status != GSS_S_COMPLETE)
+        {
+            *why = "gss_inquire_sec_context_by_oid";
+            result = false;
+            goto fail;
+        }
+        if (data->count != 1)
+        {
+            *why = "no resumable session";
+            result = false;
+            goto fail;
+        }
+        saved->length = data->elements[0].length;
+        saved->value = malloc(saved->length);
+        memcpy(saved->value, data->elements[0].value, saved->length);
+    }
+
+fail:
+    if (major_status != GSS_S_COMPLETE)
+    {
+        globus_gsi_gssapi_test_print_error(
+                stderr,
+                major_status,
+                minor_status);
+    }
+    if (data != NULL)
+    {
+        gss_release_buffer_set(&ignore_minor_status, &data);
+    }
+    if (init_context != GSS_C_NO_CONTEXT)
+    {
+        gss_delete_sec_context(
+                &ignore_minor_status,
+                &init_context,
+                NULL);
+    }
+    if (accept_context != GSS_C_NO_CONTEXT)
+    {
+        gss_delete_sec_context(
+                &ignore_minor_status,
+                &accept_context,
+                NULL);
+    }
+    if (init_generated_token.length != 0)
+    {
+        gss_release_buffer(
+                &ignore_minor_status,
+                &init_generated_token);
+    }
+    if (accept_generated_token.length != 0)
+    {
+        gss_release_buffer(
+                &ignore_minor_status,
+                &accept_generated_token);
+    }
+    return result;
+}
+/* establish() */
+
+/**
+ * @brief Test case for session resumption
+ * @details
+ *     In this test case, establish a security context asking for a
+ *     resumable session, then establish a second one offering that
+ *     session, and check that the second handshake is abbreviated: the
+ *     initiator no longer sends its certificate chain.
+ */
+bool
+resume_session(void)
+{
+    gss_buffer_desc                     session = GSS_C_EMPTY_BUFFER;
+    gss_buffer_desc                     empty = GSS_C_EMPTY_BUFFER;
+    size_t                              full_bytes = 0;
+    size_t                              resumed_bytes = 0;
+    const char                         *why = "";
+    bool                                result;
+
+    result = establish(&empty, &full_bytes, &session, &why);
+    if (result)
+    {
+        result = establish(&session, &resumed_bytes, NULL, &why);
+    }
+    if (result && resumed_bytes >= full_bytes)
+    {
+        why = globus_common_create_string(
+            "resumed handshake sent %zu bytes, full sent %zu",
+            resumed_bytes, full_bytes);
+        result = false;
+    }
+    free(session.value);
+
+    if (!result)
+    {
+        fprintf(stderr, "Failed because %s\n", why);
+    }
+    return result;
+}
+/* resume_session() */
+
+/**
+ * @brief Test case for a malformed session
+ * @details
+ *     In this test case, offer a buffer which is not an encoded session
+ *     and check that the option is rejected.
+ */
+bool
+bad_session(void)
+{
+    OM_uint32                           major_status;
+    OM_uint32                           minor_status;
+    gss_ctx_id_t                        context = GSS_C_NO_CONTEXT;
+    char                                garbage[] = "not a session";
+
+    major_status = gss_set_sec_context_option(
+            &minor_status,
+            &context,
+            GSS_TLS_SESSION,
+            &(gss_buffer_desc)
+            {
+                .value = garbage,
+                .length = sizeof(garbage),
+            });
+    if (context != GSS_C_NO_CONTEXT)
+    {
+        gss_delete_sec_context(&minor_status, &context, NULL);
+    }
+    if (!GSS_ERROR(major_status))
+    {
+        fprintf(stderr, "Failed because garbage session was accepted\n");
+        return false;
+    }
+    return true;
+}
+/* bad_session() */
+
+#define TEST_CASE_INITIALIZER(f) {f, #f}
+
+int
+main(int argc, char *argv[])
+{
+    int                                 failed = 0;
+    struct test_case                    test_cases[] =
+    {
+        TEST_CASE_INITIALIZER(resume_session),
+        TEST_CASE_INITIALIZER(bad_session),
+    };
+
+    size_t num_test_cases = sizeof(test_cases)/sizeof(test_cases[0]);
+    printf("1..%zu\n", num_test_cases);
+
+    globus_module_activate(GLOBUS_GSI_GSSAPI_MODULE);
+
+    /* Both contexts share one credential, so the acceptor's session
+       cache survives from one handshake to the next */
+    cred = globus_gsi_gssapi_test_acquire_credential();
+    if (cred == GSS_C_NO_CREDENTIAL)
+    {
+        fprintf(stderr, "Unable to acquire credential\n");
+        exit(99);
+    }
+
+    for (size_t i = 0; i < num_test_cases; i++)
+    {
+        bool                            ok = test_cases[i].func();
+
+        if (!ok)
+        {
+            printf("not ");
+            failed++;
+        }
+        printf("ok %zu - %s\n",
+                i+1,
+                test_cases[i].name);
+    }
+    globus_gsi_gssapi_test_release_credential(&cred);
+    globus_module_deactivate(GLOBUS_GSI_GSSAPI_MODULE);
+
+    exit(failed);
+}
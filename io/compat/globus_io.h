@@ -216,6 +216,22 @@ globus_io_register_writev(
     globus_io_writev_callback_t         writev_callback,
     void *                              callback_arg);
 
+globus_result_t
+globus_io_attr_get_sendfile_ok(
+    globus_io_attr_t *                  attr,
+    globus_bool_t *                     sendfile_ok);
+
+globus_result_t
+globus_io_register_sendfile(
+    globus_io_handle_t *                handle,
+    struct iovec *                      iov,
+    globus_size_t                       iovcnt,
+    globus_xio_system_file_t            file_fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       file_length,
+    globus_io_writev_callback_t         writev_callback,
+    void *                              callback_arg);
+
 globus_result_t
 globus_io_try_write(
     globus_io_handle_t *                handle,
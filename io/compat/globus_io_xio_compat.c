@@ -3393,6 +3393,151 @@ error_alloc:
     return result;
 }
 
+/*
+ * sendfile() puts bytes on the socket behind the back of every driver above
+ * tcp, so only allow it when none of them would have changed the data
+ */
+static
+globus_bool_t
+globus_l_io_attr_sendfile_ok(
+    globus_l_io_attr_t *                iattr)
+{
+    return iattr->type == GLOBUS_I_IO_TCP_ATTR &&
+        iattr->channel_mode == GLOBUS_IO_SECURE_CHANNEL_MODE_CLEAR &&
+        iattr->stack == GLOBUS_NULL;
+}
+
+globus_result_t
+globus_io_attr_get_sendfile_ok(
+    globus_io_attr_t *                  attr,
+    globus_bool_t *                     sendfile_ok)
+{
+    GlobusIOName(globus_io_attr_get_sendfile_ok);
+    
+    GlobusLIOCheckAttr(attr, GLOBUS_I_IO_TCP_ATTR);
+    GlobusLIOCheckNullParam(sendfile_ok);
+    
+    *sendfile_ok = globus_l_io_attr_sendfile_ok(*attr);
+    return GLOBUS_SUCCESS;
+}
+
+/*
+ * write iov followed by file_length bytes of file_fd without copying the
+ * file data through user space.  handles that fail
+ * globus_io_attr_get_sendfile_ok() are refused up front; the caller is
+ * expected to fall back to globus_io_register_writev().
+ *
+ * nbytes passed to the callback includes the file data.
+ */
+globus_result_t
+globus_io_register_sendfile(
+    globus_io_handle_t *                handle,
+    struct iovec *                      iov,
+    globus_size_t                       iovcnt,
+    globus_xio_system_file_t            file_fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       file_length,
+    globus_io_writev_callback_t         writev_callback,
+    void *                              callback_arg)
+{
+    globus_l_io_bounce_t *              bounce_info;
+    globus_l_io_handle_t *              ihandle;
+    globus_result_t                     result;
+    globus_xio_data_descriptor_t        dd;
+    int                                 i;
+    globus_size_t                       nbytes;
+    GlobusIOName(globus_io_register_sendfile);
+    
+    GlobusLIOCheckNullParam(writev_callback);
+    GlobusLIOCheckNullParam(iov);
+    GlobusLIOCheckHandle(handle, GLOBUS_I_IO_TCP_HANDLE);
+    
+    ihandle = *handle;
+    if(!ihandle->attr || !globus_l_io_attr_sendfile_ok(ihandle->attr))
+    {
+        return globus_error_put(
+            globus_io_error_construct_bad_protection(
+                GLOBUS_IO_MODULE,
+                GLOBUS_NULL,
+                handle,
+                0,
+                0,
+                0));
+    }
+    
+    result = GlobusLIOMalloc(bounce_info, globus_l_io_bounce_t);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto error_alloc;
+    }
+    
+    result = globus_xio_data_descriptor_init(&dd, ihandle->xio_handle);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto error_dd;
+    }
+    
+    result = globus_xio_data_descriptor_cntl(
+        dd,
+        globus_l_io_tcp_driver,
+        GLOBUS_XIO_TCP_SET_SENDFILE,
+        file_fd,
+        file_offset,
+        file_length);
+    if(result != GLOBUS_SUCCESS)
+    {
+        goto error_dd_cntl;
+    }
+    
+    bounce_info->handle = ihandle;
+    bounce_info->cb.writev = writev_callback;
+    bounce_info->user_arg = callback_arg;
+    bounce_info->blocking = GLOBUS_FALSE;
+    bounce_info->cancel_info = GLOBUS_NULL;
+    
+    nbytes = 0;
+    for(i = 0; i < iovcnt; i++)
+    {
+        nbytes += iov[i].iov_len;
+    }
+    
+    globus_mutex_lock(&ihandle->pending_lock);
+    {
+        result = globus_xio_register_writev(
+            ihandle->xio_handle,
+            iov,
+            iovcnt,
+            nbytes,
+            dd,
+            globus_l_io_bounce_iovec_cb,
+            bounce_info);
+        dd = GLOBUS_NULL;
+        if(result != GLOBUS_SUCCESS)
+        {
+            globus_mutex_unlock(&ihandle->pending_lock);
+            goto error_register;
+        }
+        
+        globus_l_io_cancel_insert(bounce_info);
+    }
+    globus_mutex_unlock(&ihandle->pending_lock);
+    
+    return GLOBUS_SUCCESS;
+
+error_register:
+error_dd_cntl:
+    if(dd)
+    {
+        globus_xio_data_descriptor_destroy(dd);
+    }
+    
+error_dd:
+    globus_free(bounce_info);
+    
+error_alloc:
+    return result;
+}
+
 globus_result_t
 globus_io_try_write(
     globus_io_handle_t *                handle,
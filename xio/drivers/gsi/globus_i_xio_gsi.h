@@ -168,6 +168,25 @@ GlobusDebugDeclare(GLOBUS_XIO_GSI);
         GLOBUS_XIO_GSI_DEBUG_INTERNAL_TRACE,                                \
         (_XIOSL("[%s] I Exiting with error\n"), _xio_name))
 
+/*
+ * TLS sessions saved from completed handshakes, one per peer host. A cache
+ * is shared by reference between an attr and all its copies, so every
+ * handle opened with the same attr can resume the others' sessions.
+ */
+typedef struct globus_l_xio_gsi_session_s
+{
+    char *                              host_name;
+    gss_buffer_desc                     session;
+    struct globus_l_xio_gsi_session_s * next;
+} globus_l_xio_gsi_session_t;
+
+typedef struct
+{
+    globus_mutex_t                      mutex;
+    int                                 ref;
+    globus_l_xio_gsi_session_t *        sessions;
+} globus_l_xio_gsi_session_cache_t;
+
 /*
  *  attribute structure
  */
@@ -187,6 +206,7 @@ typedef struct
     char *                              credentials_dir;
     unsigned char *                     alpn_list;
     size_t                              alpn_list_len;
+    globus_l_xio_gsi_session_cache_t *  session_cache;
 } globus_l_attr_t;
 
 /*
@@ -35,6 +35,15 @@ static gss_OID_desc GSS_SNI_CREDENTIALS_OID =
 static gss_OID_desc GSS_ALPN_OID =
    {11, "\x2b\x06\x01\x04\x01\x9b\x50\x01\x01\x03\x05"};
 
+static gss_OID_desc GSS_TLS_SESSION_OID =
+   {11, "\x2b\x06\x01\x04\x01\x9b\x50\x01\x01\x03\x06"};
+
+static gss_OID_desc gss_ext_tls_session_oid =
+   {11, "\x2b\x06\x01\x04\x01\x9b\x50\x01\x01\x01\x0d"};
+
+/* sessions remembered per cache; a control connection talks to few hosts */
+#define GLOBUS_L_XIO_GSI_SESSION_CACHE_MAX 16
+
 
 
 static globus_bool_t globus_l_xio_gsi_host_ip_supported;
@@ -112,6 +121,223 @@ GlobusXIODefineModule(gsi) =
 
 GlobusDebugDefine(GLOBUS_XIO_GSI);
 
+/*
+ * TLS session cache, shared by an attr and its copies
+ */
+static
+globus_l_xio_gsi_session_cache_t *
+globus_l_xio_gsi_session_cache_create(void)
+{
+    globus_l_xio_gsi_session_cache_t *  cache;
+
+    cache = calloc(1, sizeof(globus_l_xio_gsi_session_cache_t));
+    if(cache != NULL)
+    {
+        globus_mutex_init(&cache->mutex, NULL);
+        cache->ref = 1;
+    }
+    return cache;
+}
+
+static
+void
+globus_l_xio_gsi_session_free(
+    globus_l_xio_gsi_session_t *        session)
+{
+    /* the session holds the master secret */
+    memset(session->session.value, 0, session->session.length);
+    free(session->session.value);
+    free(session->host_name);
+    free(session);
+}
+
+static
+void
+globus_l_xio_gsi_session_cache_release(
+    globus_l_xio_gsi_session_cache_t *  cache)
+{
+    globus_l_xio_gsi_session_t *        session;
+    int                                 ref;
+
+    globus_mutex_lock(&cache->mutex);
+    {
+        ref = --cache->ref;
+    }
+    globus_mutex_unlock(&cache->mutex);
+
+    if(ref == 0)
+    {
+        while(cache->sessions != NULL)
+        {
+            session = cache->sessions;
+            cache->sessions = session->next;
+            globus_l_xio_gsi_session_free(session);
+        }
+        globus_mutex_destroy(&cache->mutex);
+        free(cache);
+    }
+}
+
+/*
+ * Ask a new initiating context to resume the session remembered for the
+ * handle's host, or to negotiate a resumable one if there is none. Errors
+ * are ignored: a GSSAPI without the option just does a full handshake.
+ */
+static
+void
+globus_l_xio_gsi_session_cache_offer(
+    globus_l_handle_t *                 handle)
+{
+    globus_l_xio_gsi_session_cache_t *  cache = handle->attr->session_cache;
+    globus_l_xio_gsi_session_t *        session;
+    const char *                        host_name;
+    OM_uint32                           minor_status;
+    gss_buffer_desc                     empty_buffer = GSS_C_EMPTY_BUFFER;
+    GlobusXIOName(globus_l_xio_gsi_session_cache_offer);
+    GlobusXIOGSIDebugInternalEnter();
+
+    host_name = handle->host_name ? handle->host_name : "";
+
+    globus_mutex_lock(&cache->mutex);
+    {
+        for(session = cache->sessions;
+            session != NULL;
+            session = session->next)
+        {
+            if(strcmp(session->host_name, host_name) == 0)
+            {
+                break;
+            }
+        }
+
+        GlobusXIOGSIDebugPrintf(
+            GLOBUS_XIO_GSI_DEBUG_INTERNAL_TRACE,
+            (_XIOSL("[%s:%d] %s TLS session for %s\n"), _xio_name,
+             handle->connection_id,
+             session ? "Resuming" : "No", host_name));
+
+        /* the option decodes the session, so the cache entry can change
+         * once it returns
+         */
+        gss_set_sec_context_option(
+            &minor_status,
+            &handle->context,
+            &GSS_TLS_SESSION_OID,
+            session ? &session->session : &empty_buffer);
+    }
+    globus_mutex_unlock(&cache->mutex);
+
+    GlobusXIOGSIDebugInternalExit();
+}
+
+/*
+ * Remember the session of a completed initiating context for the next
+ * handle to the same host.
+ */
+static
+void
+globus_l_xio_gsi_session_cache_save(
+    globus_l_handle_t *                 handle)
+{
+    globus_l_xio_gsi_session_cache_t *  cache = handle->attr->session_cache;
+    globus_l_xio_gsi_session_t *        session;
+    globus_l_xio_gsi_session_t **       prev;
+    const char *                        host_name;
+    gss_buffer_set_t                    data_set = GSS_C_NO_BUFFER_SET;
+    OM_uint32                           major_status;
+    OM_uint32                           minor_status;
+    void *                              value;
+    size_t                              length;
+    int                                 count = 0;
+    GlobusXIOName(globus_l_xio_gsi_session_cache_save);
+    GlobusXIOGSIDebugInternalEnter();
+
+    major_status = gss_inquire_sec_context_by_oid(
+        &minor_status,
+        handle->context,
+        &gss_ext_tls_session_oid,
+        &data_set);
+    if(GSS_ERROR(major_status) ||
+       data_set == GSS_C_NO_BUFFER_SET ||
+       data_set->count == 0)
+    {
+        goto exit;
+    }
+
+    length = data_set->elements[0].length;
+    value = malloc(length);
+    if(value == NULL)
+    {
+        goto exit;
+    }
+    memcpy(value, data_set->elements[0].value, length);
+    memset(data_set->elements[0].value, 0, length);
+
+    host_name = handle->host_name ? handle->host_name : "";
+
+    globus_mutex_lock(&cache->mutex);
+    {
+        /* move the host's entry to the front, dropping the least
+         * recently used one if the cache is full
+         */
+        for(prev = &cache->sessions, session = cache->sessions;
+            session != NULL;
+            prev = &session->next, session = session->next, count++)
+        {
+            if(strcmp(session->host_name, host_name) == 0 ||
+               count == GLOBUS_L_XIO_GSI_SESSION_CACHE_MAX - 1)
+            {
+                *prev = session->next;
+                break;
+            }
+        }
+        if(session != NULL && strcmp(session->host_name, host_name) != 0)
+        {
+            globus_l_xio_gsi_session_free(session);
+            session = NULL;
+        }
+        if(session == NULL)
+        {
+            session = calloc(1, sizeof(globus_l_xio_gsi_session_t));
+            if(session != NULL)
+            {
+                session->host_name = strdup(host_name);
+                if(session->host_name == NULL)
+                {
+                    free(session);
+                    session = NULL;
+                }
+            }
+        }
+        else
+        {
+            memset(session->session.value, 0, session->session.length);
+            free(session->session.value);
+        }
+
+        if(session != NULL)
+        {
+            session->session.value = value;
+            session->session.length = length;
+            session->next = cache->sessions;
+            cache->sessions = session;
+        }
+        else
+        {
+            memset(value, 0, length);
+            free(value);
+        }
+    }
+    globus_mutex_unlock(&cache->mutex);
+
+ exit:
+    if(data_set != GSS_C_NO_BUFFER_SET)
+    {
+        gss_release_buffer_set(&minor_status, &data_set);
+    }
+    GlobusXIOGSIDebugInternalExit();
+}
+
 /*
  *  initialize a driver attribute
  */
@@ -285,6 +511,24 @@ globus_l_xio_gsi_attr_cntl(
         out_cred = va_arg(ap, gss_cred_id_t *);
         *out_cred = attr->credential;
         break;
+
+      case GLOBUS_XIO_GSI_SET_SESSION_RESUMPTION:
+        in_bool = va_arg(ap, globus_bool_t);
+        if(in_bool && attr->session_cache == NULL)
+        {
+            attr->session_cache = globus_l_xio_gsi_session_cache_create();
+            if(attr->session_cache == NULL)
+            {
+                result = GlobusXIOErrorMemory("session_cache");
+                goto error_invalid;
+            }
+        }
+        else if(!in_bool && attr->session_cache != NULL)
+        {
+            globus_l_xio_gsi_session_cache_release(attr->session_cache);
+            attr->session_cache = NULL;
+        }
+        break;
         
         /*
          * GSSAPI flags
@@ -580,6 +824,14 @@ globus_l_xio_gsi_attr_copy(
             attr = NULL;
         }
     }
+    if (attr != NULL && attr->session_cache != NULL)
+    {
+        globus_mutex_lock(&attr->session_cache->mutex);
+        {
+            attr->session_cache->ref++;
+        }
+        globus_mutex_unlock(&attr->session_cache->mutex);
+    }
 
     *dst = attr;
 
@@ -617,6 +869,10 @@ globus_l_xio_gsi_attr_destroy(
     }
     free(attr->credentials_dir);
     free(attr->alpn_list);
+    if (attr->session_cache != NULL)
+    {
+        globus_l_xio_gsi_session_cache_release(attr->session_cache);
+    }
     free(attr);
 
     GlobusXIOGSIDebugExit();
@@ -1442,6 +1698,11 @@ globus_l_xio_gsi_read_token_cb(
                                                      minor_status);
                 goto error_pass_close;
             }
+
+            if(handle->attr->session_cache != NULL)
+            {
+                globus_l_xio_gsi_session_cache_save(handle);
+            }
         }
         else
         {
@@ -1720,6 +1981,11 @@ globus_l_xio_gsi_open_cb(
         OM_uint32                       minor_status = GLOBUS_SUCCESS;
         gss_buffer_desc 	        output_token = GSS_C_EMPTY_BUFFER;
 
+        if (handle->context == GSS_C_NO_CONTEXT
+            && handle->attr->session_cache != NULL)
+        {
+            globus_l_xio_gsi_session_cache_offer(handle);
+        }
         if (handle->context == GSS_C_NO_CONTEXT
             && handle->attr->alpn_list != NULL)
         {
@@ -3994,6 +4260,7 @@ static globus_xio_string_cntl_table_t  gsi_l_string_opts_table[] =
     {"ssl_compatible", GLOBUS_XIO_GSI_SET_SSL_COMPATIBLE, globus_xio_string_cntl_bool},
     {"application_protocols", GLOBUS_XIO_GSI_SET_APPLICATION_PROTOCOLS, globus_xio_string_cntl_string_list},
     {"credentials_dir", GLOBUS_XIO_GSI_SET_CREDENTIALS_DIR, globus_xio_string_cntl_string},
+    {"session_resumption", GLOBUS_XIO_GSI_SET_SESSION_RESUMPTION, globus_xio_string_cntl_bool},
     {NULL, 0, NULL}
 };
 
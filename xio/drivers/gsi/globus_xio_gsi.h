@@ -601,6 +601,26 @@ typedef enum
      */
     /* char **                  protocols */
     GLOBUS_XIO_GSI_SET_APPLICATION_PROTOCOLS,
+
+    /** GlobusVarArgEnum(attr)
+     * Resume TLS sessions between handles opened with this attribute.
+     * @ingroup globus_xio_gsi_driver
+     *
+     * When enabled, the session of each security context this side
+     * initiates is remembered per peer host, and offered again when the
+     * attribute (or a copy of it) is used to open another handle to the
+     * same host. If the peer still has the session cached the handshake
+     * skips certificate exchange and key agreement. Resumption uses TLS 1.2
+     * session IDs, so initiating contexts are limited to TLS 1.2 while this
+     * is enabled.
+     *
+     * @param resume
+     *      GLOBUS_TRUE to enable resumption, GLOBUS_FALSE to disable it and
+     *      drop any sessions remembered so far.
+     * string opt: <tt>session_resumption=<em>bool</em></tt>
+     */
+    /* globus_bool_t            resume */
+    GLOBUS_XIO_GSI_SET_SESSION_RESUMPTION,
 } globus_xio_gsi_cmd_t;
 
 /**
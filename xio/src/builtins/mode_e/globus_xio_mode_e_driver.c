@@ -16,6 +16,7 @@
 
 #include "globus_xio_driver.h"
 #include "globus_xio_mode_e_driver.h"
+#include "globus_buffer_pool.h"
 #include "version.h"
 
 GlobusDebugDefine(GLOBUS_XIO_MODE_E);
@@ -49,6 +50,8 @@ enum globus_l_xio_error_levels
 #define GLOBUS_XIO_MODE_E_HEADER_COUNT 8
 #define GLOBUS_XIO_MODE_E_MAX_OFFSET_SIZE 8
 #define GLOBUS_XIO_MODE_E_OFFSET_HT_SIZE 8
+#define GLOBUS_XIO_MODE_E_WRITE_BATCH 16
+#define GLOBUS_XIO_MODE_E_IOVEC_COUNT 64
 
 #define GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_CLOSE 0x04
 #define GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOD 0x08
@@ -83,6 +86,7 @@ typedef struct
     globus_bool_t                       manual_eodc;
     globus_off_t                        offset;
     globus_bool_t                       offset_reads;
+    int                                 read_buffer_size;
 } globus_l_xio_mode_e_attr_t;
 
 static globus_l_xio_mode_e_attr_t       globus_l_xio_mode_e_attr_default =
@@ -94,7 +98,8 @@ static globus_l_xio_mode_e_attr_t       globus_l_xio_mode_e_attr_default =
     GLOBUS_FALSE,
     GLOBUS_FALSE,
     -1,
-    GLOBUS_FALSE
+    GLOBUS_FALSE,
+    0
 };
 
 typedef struct
@@ -111,7 +116,7 @@ typedef struct
     globus_l_xio_mode_e_attr_t *        attr;
     globus_i_xio_mode_e_state_t         state;  
     globus_memory_t                     requestor_memory;
-    globus_memory_t                     header_memory;
+    globus_buffer_pool_t                header_memory;
     char *                              cs;
     globus_list_t *                     connection_list;
     globus_list_t *                     close_list;
@@ -127,9 +132,11 @@ typedef struct
     globus_bool_t                       eof_sent;
     globus_bool_t                       close_canceled;
     globus_fifo_t                       io_q;
+    globus_fifo_t                       read_done_q;
     globus_mutex_t                      mutex;
     globus_off_t                        offset;
     globus_off_t                        eod_offset;
+    globus_size_t                       eod_nbytes;
     globus_xio_operation_t              outstanding_op;
     int                                 ref_count;
     globus_xio_stack_t                  stack;
@@ -137,7 +144,7 @@ typedef struct
     globus_object_t *                   error;
 } globus_l_xio_mode_e_handle_t;
 
-typedef struct 
+typedef struct globus_i_xio_mode_e_requestor_s
 {
     globus_xio_operation_t              op;
     globus_xio_iovec_t *                iovec;
@@ -145,6 +152,17 @@ typedef struct
     globus_l_xio_mode_e_attr_t *        dd;
     globus_l_xio_mode_e_handle_t *      handle;
     globus_xio_handle_t                 xio_handle;
+    /* 
+     * the rest is used by writes and buffered reads only. Blocks written 
+     * together in one writev are chained through next. A buffered read
+     * that is done has its outcome kept here until it is finished
+     */
+    globus_l_xio_mode_e_header_t *      header;
+    globus_size_t                       length;
+    globus_off_t                        offset;
+    globus_result_t                     result;
+    struct globus_i_xio_mode_e_requestor_s *
+                                        next;
 } globus_i_xio_mode_e_requestor_t;
 
 typedef struct
@@ -158,6 +176,18 @@ typedef struct
     globus_off_t                        outstanding_data_offset;    
     globus_bool_t                       eod;
     globus_bool_t                       close;
+    /* 
+     * scratch iovec for the writev of a batch of blocks (client) or the 
+     * readv of a buffered read (server)
+     */
+    globus_xio_iovec_t *                iovec;
+    globus_xio_iovec_t                  iovec_buf[
+                                        GLOBUS_XIO_MODE_E_IOVEC_COUNT];
+    globus_byte_t *                     read_buffer;
+    globus_size_t                       read_buffer_size;
+    globus_size_t                       read_buffer_start;
+    globus_size_t                       read_buffer_end;
+    globus_size_t                       read_user_len;
 } globus_l_xio_mode_e_connection_handle_t; 
 
 static
@@ -211,6 +241,32 @@ globus_i_xio_mode_e_register_write(
     globus_l_xio_mode_e_connection_handle_t *
                                         connection_handle);
 
+static
+void
+globus_l_xio_mode_e_finish_writes(
+    globus_l_xio_mode_e_handle_t *      handle,
+    globus_i_xio_mode_e_requestor_t *   requestor,
+    globus_i_xio_mode_e_requestor_t *   unfinished,
+    globus_result_t                     result,
+    globus_size_t                       nbytes);
+
+static
+globus_result_t
+globus_l_xio_mode_e_process_buffer(
+    globus_l_xio_mode_e_connection_handle_t *
+                                        connection_handle);
+
+static
+void
+globus_l_xio_mode_e_buffered_read_cb(
+    globus_xio_handle_t                 xio_handle,
+    globus_result_t                     result,
+    globus_xio_iovec_t *                iovec,
+    int                                 iovec_count,
+    globus_size_t                       nbytes,
+    globus_xio_data_descriptor_t        data_desc,
+    void *                              user_arg);
+
 static
 globus_result_t
 globus_l_xio_mode_e_register_eod(
@@ -268,6 +324,7 @@ GlobusXIODefineModule(mode_e) =
 static globus_xio_string_cntl_table_t mode_e_l_string_opts_table[] =
 {
     {"streams", GLOBUS_XIO_MODE_E_SET_NUM_STREAMS, globus_xio_string_cntl_int},
+    {"read_buffer", GLOBUS_XIO_MODE_E_SET_READ_BUFFER_SIZE, globus_xio_string_cntl_int},
     {NULL, 0, NULL}
 };
 
@@ -400,8 +457,9 @@ globus_l_xio_mode_e_handle_destroy(
     globus_fifo_destroy(&handle->connection_q);
     globus_fifo_destroy(&handle->eod_q);
     globus_fifo_destroy(&handle->io_q);
+    globus_fifo_destroy(&handle->read_done_q);
     globus_memory_destroy(&handle->requestor_memory);
-    globus_memory_destroy(&handle->header_memory);
+    globus_buffer_pool_destroy(&handle->header_memory);
     globus_list_free(handle->connection_list);
     globus_list_free(handle->eod_list);
     globus_list_free(handle->close_list);
@@ -583,12 +641,22 @@ globus_l_xio_mode_e_handle_create(
     {
         goto error_io_q_init;
     }
+    result = globus_fifo_init(&handle->read_done_q);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error_read_done_q_init;
+    }
     node_size = sizeof(globus_i_xio_mode_e_requestor_t);  
     node_count = GLOBUS_XIO_MODE_E_IO_Q_SIZE;       
     globus_memory_init(&handle->requestor_memory, node_size, node_count);
     node_size = sizeof(globus_l_xio_mode_e_header_t);
     node_count = GLOBUS_XIO_MODE_E_HEADER_COUNT;       
-    globus_memory_init(&handle->header_memory, node_size, node_count);
+    if (globus_buffer_pool_init(
+        &handle->header_memory, node_size, node_count, 0, 0) != GLOBUS_SUCCESS)
+    {
+        result = GlobusXIOErrorMemory("header_memory");
+        goto error_header_memory_init;
+    }
     globus_mutex_init(&handle->mutex, NULL);
     /* 
      * As I did memset(handle, 0) in the beginning, here i initialize only the
@@ -600,6 +668,11 @@ globus_l_xio_mode_e_handle_create(
     GlobusXIOModeEDebugExit();
     return GLOBUS_SUCCESS;
 
+error_header_memory_init:
+    globus_memory_destroy(&handle->requestor_memory);
+    globus_fifo_destroy(&handle->read_done_q);
+error_read_done_q_init:
+    globus_fifo_destroy(&handle->io_q);
 error_io_q_init:
     globus_fifo_destroy(&handle->eod_q);
 error_eod_q_init:
@@ -1126,6 +1199,23 @@ globus_l_xio_mode_e_link_destroy(
 }
 
 
+static
+void
+globus_l_xio_mode_e_connection_handle_destroy(
+    globus_l_xio_mode_e_connection_handle_t *
+                                        connection_handle)
+{
+    GlobusXIOName(globus_l_xio_mode_e_connection_handle_destroy);
+    GlobusXIOModeEDebugEnter();
+    if (connection_handle->read_buffer)
+    {
+        globus_free(connection_handle->read_buffer);
+    }
+    globus_free(connection_handle);
+    GlobusXIOModeEDebugExit();
+}
+
+
 static
 void
 globus_l_xio_mode_e_server_connection_handle_init(
@@ -1267,7 +1357,7 @@ globus_l_xio_mode_e_process_eod(
                 handle);
         globus_list_remove(&handle->connection_list, 
             globus_list_search(handle->connection_list, connection_handle));
-        globus_free(connection_handle);
+        globus_l_xio_mode_e_connection_handle_destroy(connection_handle);
     }
     else
     {
@@ -1327,7 +1417,7 @@ globus_l_xio_mode_e_read_header_cb(
         {
             goto error;
         }
-        globus_memory_push_node(&handle->header_memory, (void*)buffer);
+        globus_buffer_pool_put(&handle->header_memory, (void*)buffer);
         if (connection_handle->outstanding_data_len > 0)
         {
             requestor = globus_l_xio_mode_e_process_outstanding_data(
@@ -1415,7 +1505,7 @@ globus_l_xio_mode_e_read_header_cb(
                 op = handle->outstanding_op;
             }
         }
-        globus_free(connection_handle);
+        globus_l_xio_mode_e_connection_handle_destroy(connection_handle);
     }
     else
     {
@@ -1564,9 +1654,8 @@ globus_i_xio_mode_e_open_cb(
     globus_l_xio_mode_e_connection_handle_t *
                                         connection_handle;
     globus_l_xio_mode_e_handle_t *      handle;
-    globus_xio_operation_t              write_op;
+    globus_i_xio_mode_e_requestor_t *   batch = GLOBUS_NULL;
     globus_result_t                     res;
-    globus_bool_t                       finish_write = GLOBUS_FALSE;
     GlobusXIOName(globus_i_xio_mode_e_open_cb);
 
     GlobusXIOModeEDebugEnter();
@@ -1597,8 +1686,7 @@ globus_i_xio_mode_e_open_cb(
             res = globus_i_xio_mode_e_register_write(connection_handle);
             if (res != GLOBUS_SUCCESS)
             {
-                write_op = requestor->op;
-                finish_write = GLOBUS_TRUE;
+                batch = requestor;
                 goto error_register_write;
             }
         }
@@ -1624,15 +1712,7 @@ error_connection_handle:
 error_open:
     globus_l_xio_mode_e_save_error(handle, res);
     globus_mutex_unlock(&handle->mutex);
-    if (finish_write)
-    {
-        globus_xio_driver_data_descriptor_cntl(
-                write_op,
-                NULL,
-                GLOBUS_XIO_DD_SET_OFFSET,
-                connection_handle->outstanding_data_offset);
-        globus_xio_driver_finished_write(write_op, res, 0);
-    }
+    globus_l_xio_mode_e_finish_writes(handle, batch, GLOBUS_NULL, res, 0);
     GlobusXIOModeEDebugExitWithError();
     return;    
 }
@@ -1660,8 +1740,35 @@ globus_i_xio_mode_e_server_open_cb(
         connection_handle = (globus_l_xio_mode_e_connection_handle_t *)
                                 globus_malloc(sizeof(
                                     globus_l_xio_mode_e_connection_handle_t));
+        if (!connection_handle)
+        {
+            res = GlobusXIOErrorMemory("connection_handle");
+            goto error;
+        }
+        memset(connection_handle, 0, 
+                        sizeof(globus_l_xio_mode_e_connection_handle_t));
         connection_handle->mode_e_handle = handle;
         connection_handle->xio_handle = xio_handle;
+        if (handle->attr->read_buffer_size > 0)
+        {
+            /* it has to hold at least one header */
+            connection_handle->read_buffer_size = 
+                                    handle->attr->read_buffer_size;
+            if (connection_handle->read_buffer_size < 
+                                    sizeof(globus_l_xio_mode_e_header_t))
+            {
+                connection_handle->read_buffer_size = 
+                                    sizeof(globus_l_xio_mode_e_header_t);
+            }
+            connection_handle->read_buffer = (globus_byte_t *)
+                        globus_malloc(connection_handle->read_buffer_size);
+            if (!connection_handle->read_buffer)
+            {
+                globus_free(connection_handle);
+                res = GlobusXIOErrorMemory("read_buffer");
+                goto error;
+            }
+        }
         globus_list_insert(&handle->connection_list, connection_handle);
         res = globus_i_xio_mode_e_register_read_header(connection_handle);
         if (res != GLOBUS_SUCCESS)
@@ -1982,8 +2089,14 @@ globus_i_xio_mode_e_register_read_header(
 
     GlobusXIOModeEDebugEnter();
     globus_l_xio_mode_e_server_connection_handle_init(connection_handle);
+    if (connection_handle->read_buffer)
+    {
+        result = globus_l_xio_mode_e_process_buffer(connection_handle);
+        GlobusXIOModeEDebugExit();
+        return result;
+    }
     header = (globus_l_xio_mode_e_header_t *)
-                    globus_memory_pop_node(
+                    globus_buffer_pool_get(
                         &connection_handle->mode_e_handle->header_memory);
     header_size = sizeof(globus_l_xio_mode_e_header_t);
     result = globus_xio_register_read(
@@ -2138,6 +2251,12 @@ globus_i_xio_mode_e_register_read(
     GlobusXIOName(globus_i_xio_mode_e_register_read);
 
     GlobusXIOModeEDebugEnter();
+    if (connection_handle->read_buffer)
+    {
+        result = globus_l_xio_mode_e_process_buffer(connection_handle);
+        GlobusXIOModeEDebugExit();
+        return result;
+    }
     iovec = connection_handle->requestor->iovec;
     iovec_count = connection_handle->requestor->iovec_count;
     GlobusXIOUtilIovTotalLength(iovec_len, iovec, iovec_count);
@@ -2179,204 +2298,441 @@ globus_i_xio_mode_e_register_read(
 }                        
 
 
-/* called locked */
+/*
+ * Buffered reads. With GLOBUS_XIO_MODE_E_SET_READ_BUFFER_SIZE set, each
+ * server side connection reads as much as it can get into its read_buffer,
+ * and headers (and payload that came in with them) are parsed out of it 
+ * without going back down the stack. Payload that has not arrived yet is
+ * read straight into the user's iovec, with the free part of read_buffer
+ * behind it to catch whatever follows. A new read is only registered once
+ * less than a header (or no payload) is left in the buffer, so the few
+ * bytes left over are moved to the front instead of wrapping around.
+ * Reads done this way are queued on read_done_q and finished by 
+ * globus_l_xio_mode_e_finish_reads() after the lock is released.
+ */
+
+/* called unlocked */
 static
 void
-globus_l_xio_mode_e_reset_connections(
+globus_l_xio_mode_e_finish_reads(
     globus_l_xio_mode_e_handle_t *      handle)
 {
-    globus_l_xio_mode_e_connection_handle_t *
-                                        connection_handle;
-    globus_result_t                     result; 
-    GlobusXIOName(globus_l_xio_mode_e_reset_connections);
+    globus_i_xio_mode_e_requestor_t *   requestor;
+    globus_fifo_t                       done_q;
+    globus_xio_operation_t              op;
+    globus_off_t                        offset;
+    globus_size_t                       nbytes;
+    globus_result_t                     result;
+    GlobusXIOName(globus_l_xio_mode_e_finish_reads);
+
     GlobusXIOModeEDebugEnter();
-    handle->eod_count = -1;
-    handle->eods_received = 0;
-    while (!globus_fifo_empty(&handle->eod_q))
+    globus_fifo_init(&done_q);
+    globus_mutex_lock(&handle->mutex);
+    globus_fifo_move(&done_q, &handle->read_done_q);
+    globus_mutex_unlock(&handle->mutex);
+    while (!globus_fifo_empty(&done_q))
     {
-        connection_handle = (globus_l_xio_mode_e_connection_handle_t *)
-                        globus_fifo_dequeue(&handle->eod_q);
-        result = globus_i_xio_mode_e_register_read_header(connection_handle);
-        if (result != GLOBUS_SUCCESS)
+        requestor = (globus_i_xio_mode_e_requestor_t *)
+                                globus_fifo_dequeue(&done_q);
+        op = requestor->op;
+        offset = requestor->offset;
+        nbytes = requestor->length;
+        result = requestor->result;
+        globus_xio_operation_disable_cancel(op);
+        globus_memory_push_node(&handle->requestor_memory, (void*)requestor);
+        if (offset != -1)
         {
-            goto error;
+            globus_xio_driver_data_descriptor_cntl(
+                            op,
+                            NULL,
+                            GLOBUS_XIO_DD_SET_OFFSET,
+                            offset);
         }
+        globus_xio_driver_finished_read(op, result, nbytes);
     }
-    handle->state = GLOBUS_XIO_MODE_E_OPEN;
+    globus_fifo_destroy(&done_q);
     GlobusXIOModeEDebugExit();
-    return;
+}
 
-error:
-    globus_l_xio_mode_e_save_error(handle, result);
-    GlobusXIOModeEDebugExitWithError();
-    return;
+
+/* called locked */
+static
+void
+globus_l_xio_mode_e_read_done(
+    globus_l_xio_mode_e_handle_t *      handle,
+    globus_i_xio_mode_e_requestor_t *   requestor,
+    globus_result_t                     result,
+    globus_size_t                       nbytes,
+    globus_off_t                        offset)
+{
+    /* cancel_cb must not cancel the connection's next read for this op */
+    requestor->xio_handle = GLOBUS_NULL;
+    requestor->result = result;
+    requestor->length = nbytes;
+    requestor->offset = offset;
+    globus_fifo_enqueue(&handle->read_done_q, requestor);
 }
 
 
+/* 
+ * called locked. Same as the eod handling in read_header_cb and read_cb;
+ * requestor is the read that got the last of the data, if any. 
+ * connection_handle may be freed by this.
+ */
 static
-globus_result_t
-globus_l_xio_mode_e_read(
-    void *                              driver_specific_handle,
-    const globus_xio_iovec_t*           iovec,
-    int                                 iovec_count,
-    globus_xio_operation_t              op)
+void
+globus_l_xio_mode_e_buffered_eod(
+    globus_l_xio_mode_e_connection_handle_t *
+                                        connection_handle,
+    globus_i_xio_mode_e_requestor_t *   requestor,
+    globus_size_t                       nbytes)
 {
     globus_l_xio_mode_e_handle_t *      handle;
-    globus_i_xio_mode_e_requestor_t *   requestor;
-    globus_l_xio_mode_e_attr_t *        dd = GLOBUS_NULL;
-    globus_result_t                     result;
-    globus_size_t                       wait_for;
-    globus_bool_t                       finish = GLOBUS_FALSE;
-    GlobusXIOName(globus_l_xio_mode_e_read);
+    globus_i_xio_mode_e_requestor_t *   eof_requestor;
+    globus_fifo_t                       requestor_q;
+    globus_off_t                        offset;
+    globus_result_t                     result = GLOBUS_SUCCESS;
+    globus_bool_t                       eof;
+    GlobusXIOName(globus_l_xio_mode_e_buffered_eod);
 
     GlobusXIOModeEDebugEnter();
-    handle = (globus_l_xio_mode_e_handle_t *) driver_specific_handle;
-    wait_for = globus_xio_operation_get_wait_for(op);
-    if (wait_for > 1)
+    handle = connection_handle->mode_e_handle;
+    offset = connection_handle->outstanding_data_offset;
+    globus_fifo_init(&requestor_q);
+    eof = globus_l_xio_mode_e_process_eod(connection_handle, &requestor_q);
+    if (eof)
     {
-        result = GlobusXIOErrorParameter("Waitforbytes");
-        goto error_wait_for;
+        result = GlobusXIOErrorEOF();
+        if (requestor)
+        {
+            globus_xio_driver_set_eof_received(requestor->op);
+        }
+        else if (!globus_fifo_empty(&requestor_q))
+        {
+            eof_requestor = (globus_i_xio_mode_e_requestor_t *)
+                                        globus_fifo_peek(&requestor_q);
+            globus_xio_driver_set_eof_received(eof_requestor->op);
+        }
+        if (handle->state == GLOBUS_XIO_MODE_E_OPEN)
+        {
+            if (requestor || !globus_fifo_empty(&requestor_q))
+            {
+                handle->state = GLOBUS_XIO_MODE_E_EOF_DELIVERED;
+            }
+            else
+            {
+                handle->state = GLOBUS_XIO_MODE_E_EOF_RECEIVED;
+            }
+        }
     }
-    else if (wait_for == 0 && !handle->attr->offset_reads)
+    if (requestor)
     {
-        result = GlobusXIOErrorParameter(
-                "Waitforbytes cant be zero. Offset reads not set on attr");
-        goto error_wait_for;
+        globus_l_xio_mode_e_read_done(
+                            handle, requestor, result, nbytes, offset);
     }
-    if (handle->attr->offset_reads)
+    while (!globus_fifo_empty(&requestor_q))
     {
-        dd = (globus_l_xio_mode_e_attr_t *)
-                globus_xio_operation_get_data_descriptor(op, GLOBUS_FALSE);
-        if (!dd)
-        {
-            result = GlobusXIOErrorParameter("data_descriptor");
-            goto error_dd;
-        }
+        eof_requestor = (globus_i_xio_mode_e_requestor_t *)
+                                    globus_fifo_dequeue(&requestor_q);
+        globus_l_xio_mode_e_read_done(
+                            handle, eof_requestor, result, 0, offset);
     }
-    requestor = (globus_i_xio_mode_e_requestor_t *)
-                globus_memory_pop_node(&handle->requestor_memory);
-    requestor->op = op;
-    requestor->iovec = (globus_xio_iovec_t*)iovec;
-    requestor->iovec_count = iovec_count;
-    requestor->dd = dd;
-    requestor->handle = handle;
-    requestor->xio_handle = GLOBUS_NULL;
-    if (globus_xio_operation_enable_cancel(
-        op, globus_l_xio_mode_e_cancel_cb, requestor))
+    globus_fifo_destroy(&requestor_q);
+    GlobusXIOModeEDebugExit();
+}
+
+
+/* 
+ * called locked. nbytes of the current block went to the read bound to
+ * connection_handle. Returns GLOBUS_TRUE if that was the end of the data
+ * on this connection for now (connection_handle may have been freed).
+ */
+static
+globus_bool_t
+globus_l_xio_mode_e_buffered_deliver(
+    globus_l_xio_mode_e_connection_handle_t *
+                                        connection_handle,
+    globus_size_t                       nbytes)
+{
+    globus_l_xio_mode_e_handle_t *      handle;
+    globus_i_xio_mode_e_requestor_t *   requestor;
+    globus_off_t                        offset;
+    GlobusXIOName(globus_l_xio_mode_e_buffered_deliver);
+
+    GlobusXIOModeEDebugEnter();
+    handle = connection_handle->mode_e_handle;
+    requestor = connection_handle->requestor;
+    connection_handle->requestor = GLOBUS_NULL;
+    offset = connection_handle->outstanding_data_offset;
+    connection_handle->outstanding_data_len -= nbytes;
+    if (connection_handle->outstanding_data_len > 0)
     {
-        result = GlobusXIOErrorCanceled();
-        goto error_cancel_enable;
+        connection_handle->outstanding_data_offset += nbytes;
     }
-    globus_mutex_lock(&handle->mutex);
-    if (globus_xio_operation_is_canceled(op))
+    else if (connection_handle->eod)
     {
-        result = GlobusXIOErrorCanceled();
-        goto error_operation_canceled;
+        globus_l_xio_mode_e_buffered_eod(connection_handle, requestor, nbytes);
+        GlobusXIOModeEDebugExit();
+        return GLOBUS_TRUE;
     }
-    switch (handle->state)
+    else
     {
-        case GLOBUS_XIO_MODE_E_EOF_RECEIVED:
-            globus_xio_driver_set_eof_received(op);
-            handle->state = GLOBUS_XIO_MODE_E_EOF_DELIVERED;
-	    globus_memory_push_node(
-			&handle->requestor_memory, (void*)requestor);
-            result = GlobusXIOErrorEOF();
-            finish = GLOBUS_TRUE;
-            break;
-        case GLOBUS_XIO_MODE_E_EOF_DELIVERED:
-            if (globus_xio_driver_eof_received(op) || 
-                                        handle->connection_count == 0)
+        globus_l_xio_mode_e_server_connection_handle_init(connection_handle);
+    }
+    globus_l_xio_mode_e_read_done(
+                        handle, requestor, GLOBUS_SUCCESS, nbytes, offset);
+    GlobusXIOModeEDebugExit();
+    return GLOBUS_FALSE;
+}
+
+
+/* called locked */
+static
+globus_result_t
+globus_l_xio_mode_e_register_buffered_read(
+    globus_l_xio_mode_e_connection_handle_t *
+                                        connection_handle)
+{
+    globus_i_xio_mode_e_requestor_t *   requestor;
+    globus_xio_iovec_t *                iovec;
+    int                                 iovec_count = 0;
+    int                                 i;
+    globus_size_t                       buffered;
+    globus_size_t                       remaining;
+    globus_size_t                       wait_for;
+    globus_result_t                     result;
+    GlobusXIOName(globus_l_xio_mode_e_register_buffered_read);
+
+    GlobusXIOModeEDebugEnter();
+    buffered = connection_handle->read_buffer_end - 
+                                    connection_handle->read_buffer_start;
+    if (connection_handle->read_buffer_start > 0)
+    {
+        memmove(connection_handle->read_buffer,
+                connection_handle->read_buffer + 
+                                    connection_handle->read_buffer_start,
+                buffered);
+        connection_handle->read_buffer_start = 0;
+        connection_handle->read_buffer_end = buffered;
+    }
+    iovec = connection_handle->iovec_buf;
+    connection_handle->read_user_len = 0;
+    requestor = connection_handle->requestor;
+    if (requestor)
+    {
+        /* 
+         * the payload goes straight into the user's iovec (but no further
+         * than this block), whatever comes after it into read_buffer
+         */
+        globus_assert(buffered == 0);
+        if (requestor->iovec_count + 1 > GLOBUS_XIO_MODE_E_IOVEC_COUNT)
+        {
+            iovec = (globus_xio_iovec_t *) globus_malloc(
+                (requestor->iovec_count + 1) * sizeof(globus_xio_iovec_t));
+            if (!iovec)
             {
-	        globus_memory_push_node(
-			&handle->requestor_memory, (void*)requestor);
-                result = GlobusXIOErrorEOF();
-                finish = GLOBUS_TRUE;
-                break;
+                result = GlobusXIOErrorMemory("iovec");
+                goto error;
             }
-            else
+        }
+        remaining = connection_handle->outstanding_data_len;
+        for (i = 0; i < requestor->iovec_count && remaining > 0; i++)
+        {
+            if (requestor->iovec[i].iov_len == 0)
             {
-                globus_l_xio_mode_e_reset_connections(handle);
-                /* 
-                 * connection_q will be empty at this point. I let this
-                 * fall through to enqueue the request in the io_q
-                 */
+                continue;
             }
-            /* fall through */
-        case GLOBUS_XIO_MODE_E_OPEN:
-            if (globus_fifo_empty(&handle->connection_q))
+            iovec[iovec_count].iov_base = requestor->iovec[i].iov_base;
+            iovec[iovec_count].iov_len = 
+                (requestor->iovec[i].iov_len < remaining) ?
+                    requestor->iovec[i].iov_len : remaining;
+            remaining -= iovec[iovec_count].iov_len;
+            connection_handle->read_user_len += iovec[iovec_count].iov_len;
+            ++iovec_count;
+        }
+        wait_for = 1;
+    }
+    else
+    {
+        wait_for = sizeof(globus_l_xio_mode_e_header_t) - buffered;
+    }
+    if (connection_handle->read_buffer_end < 
+                                    connection_handle->read_buffer_size)
+    {
+        iovec[iovec_count].iov_base = connection_handle->read_buffer +
+                                    connection_handle->read_buffer_end;
+        iovec[iovec_count].iov_len = connection_handle->read_buffer_size - 
+                                    connection_handle->read_buffer_end;
+        ++iovec_count;
+    }
+    connection_handle->iovec = iovec;
+    result = globus_xio_register_readv(
+                connection_handle->xio_handle,
+                iovec,
+                iovec_count,
+                wait_for,
+                NULL,
+                globus_l_xio_mode_e_buffered_read_cb,
+                connection_handle);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error_register;
+    }
+    GlobusXIOModeEDebugExit();
+    return GLOBUS_SUCCESS;
+
+error_register:
+    if (iovec != connection_handle->iovec_buf)
+    {
+        globus_free(iovec);
+    }
+    connection_handle->iovec = GLOBUS_NULL;
+error:
+    GlobusXIOModeEDebugExitWithError();
+    return result;
+}
+
+
+/* 
+ * called locked. Takes as many headers and payloads out of read_buffer as
+ * there are reads to take them, and registers a read when it runs short.
+ * On error, the bound read and all queued reads fail.
+ */
+static
+globus_result_t
+globus_l_xio_mode_e_process_buffer(
+    globus_l_xio_mode_e_connection_handle_t *
+                                        connection_handle)
+{
+    globus_l_xio_mode_e_handle_t *      handle;
+    globus_i_xio_mode_e_requestor_t *   requestor;
+    globus_l_xio_mode_e_header_t        header;
+    globus_size_t                       header_size;
+    globus_size_t                       buffered;
+    globus_size_t                       len;
+    globus_size_t                       nbytes;
+    globus_byte_t *                     buffer;
+    int                                 i;
+    globus_result_t                     result;
+    GlobusXIOName(globus_l_xio_mode_e_process_buffer);
+
+    GlobusXIOModeEDebugEnter();
+    handle = connection_handle->mode_e_handle;
+    header_size = sizeof(globus_l_xio_mode_e_header_t);
+    for (;;)
+    {
+        buffer = connection_handle->read_buffer + 
+                                    connection_handle->read_buffer_start;
+        buffered = connection_handle->read_buffer_end - 
+                                    connection_handle->read_buffer_start;
+        if (connection_handle->outstanding_data_len == 0)
+        {
+            if (buffered < header_size)
             {
-                globus_fifo_enqueue(&handle->io_q, requestor);
+                result = globus_l_xio_mode_e_register_buffered_read(
+                                                        connection_handle);
+                if (result != GLOBUS_SUCCESS)
+                {
+                    goto error;
+                }
+                break;
             }
-            else
+            memcpy(&header, buffer, header_size);
+            connection_handle->read_buffer_start += header_size;
+            result = globus_l_xio_mode_e_process_header(
+                                            &header, connection_handle);
+            if (result != GLOBUS_SUCCESS)
             {
-                globus_l_xio_mode_e_connection_handle_t *      
-                                                connection_handle;
-                if (wait_for == 0)
-                {
-                    globus_memory_push_node(
-                                &handle->requestor_memory, (void*)requestor);
-                    connection_handle = 
-                                (globus_l_xio_mode_e_connection_handle_t*) 
-                                    globus_fifo_dequeue(&handle->connection_q);
-                    globus_hashtable_insert(
+                goto error;
+            }
+            if (connection_handle->outstanding_data_len > 0)
+            {
+                continue;
+            }
+            if (connection_handle->eod)
+            {
+                globus_l_xio_mode_e_buffered_eod(
+                                    connection_handle, GLOBUS_NULL, 0);
+                break;
+            }
+            globus_l_xio_mode_e_server_connection_handle_init(
+                                                    connection_handle);
+            continue;
+        }
+        if (!connection_handle->requestor)
+        {
+            if (globus_fifo_empty(&handle->io_q))
+            {
+                globus_fifo_enqueue(&handle->connection_q, connection_handle);
+                break;
+            }
+            requestor = (globus_i_xio_mode_e_requestor_t *)
+                                    globus_fifo_dequeue(&handle->io_q);
+            if (handle->attr->offset_reads)
+            {
+                /* wait_for of this requestor should be zero */
+                requestor->dd->offset = 
+                                connection_handle->outstanding_data_offset;
+                globus_hashtable_insert(
                         &handle->offset_ht, 
-                        (void *)&connection_handle->outstanding_data_offset, 
-                        (void *)connection_handle);
-                    dd->offset = connection_handle->outstanding_data_offset;
-                    result = GLOBUS_SUCCESS;
-                    finish = GLOBUS_TRUE;
-                }
-                else 
-                {
-                    if (handle->attr->offset_reads)
-                    {
-                        connection_handle = 
-                                (globus_l_xio_mode_e_connection_handle_t*) 
-                                        globus_hashtable_remove(
-                                            &handle->offset_ht, &dd->offset);
-                        if (!connection_handle)
-                        {
-                            result = GlobusXIOErrorParameter("Invalid offset");
-                            goto error_offset;
-                        }
-                    }
-                    else
-                    {
-                        connection_handle = 
-                            (globus_l_xio_mode_e_connection_handle_t*) 
-                                globus_fifo_dequeue(&handle->connection_q);
-                    }
-                    connection_handle->requestor = requestor;
-                    requestor->xio_handle = connection_handle->xio_handle;
-                    globus_i_xio_mode_e_register_read(connection_handle);
-                }
+                        (void *) &connection_handle->outstanding_data_offset, 
+                        (void *) connection_handle);
+                globus_l_xio_mode_e_read_done(
+                                handle, requestor, GLOBUS_SUCCESS, 0, -1);
+                break;
+            }
+            connection_handle->requestor = requestor;
+            requestor->xio_handle = connection_handle->xio_handle;
+        }
+        if (buffered == 0)
+        {
+            result = globus_l_xio_mode_e_register_buffered_read(
+                                                    connection_handle);
+            if (result != GLOBUS_SUCCESS)
+            {
+                goto error;
             }
             break;
-        case GLOBUS_XIO_MODE_E_ERROR:
-            result = globus_error_put(globus_object_copy(handle->error));
-            goto error_invalid_state;
-        default:
-            result = GlobusXIOErrorInvalidState(handle->state);
-            goto error_invalid_state;
-    }
-    globus_mutex_unlock(&handle->mutex);
-    if (finish)
-    {
-        globus_xio_operation_disable_cancel(op);
-        globus_xio_driver_finished_read(op, result, 0);
+        }
+        requestor = connection_handle->requestor;
+        if (buffered > connection_handle->outstanding_data_len)
+        {
+            buffered = connection_handle->outstanding_data_len;
+        }
+        nbytes = 0;
+        for (i = 0; i < requestor->iovec_count && nbytes < buffered; i++)
+        {
+            len = buffered - nbytes;
+            if (requestor->iovec[i].iov_len < len)
+            {
+                len = requestor->iovec[i].iov_len;
+            }
+            memcpy(requestor->iovec[i].iov_base, buffer + nbytes, len);
+            nbytes += len;
+        }
+        connection_handle->read_buffer_start += nbytes;
+        if (globus_l_xio_mode_e_buffered_deliver(connection_handle, nbytes))
+        {
+            break;
+        }
     }
     GlobusXIOModeEDebugExit();
     return GLOBUS_SUCCESS;
 
-error_invalid_state:
-error_offset:
-error_operation_canceled:
-    globus_mutex_unlock(&handle->mutex);
-    globus_xio_operation_disable_cancel(op);
-error_cancel_enable:
-    globus_memory_push_node(&handle->requestor_memory, (void*)requestor);
-error_dd:
-error_wait_for:
+error:
+    if (connection_handle->requestor)
+    {
+        globus_l_xio_mode_e_read_done(
+            handle, connection_handle->requestor, result, 0, -1);
+        connection_handle->requestor = GLOBUS_NULL;
+    }
+    while (!globus_fifo_empty(&handle->io_q))
+    {
+        requestor = (globus_i_xio_mode_e_requestor_t *)
+                                globus_fifo_dequeue(&handle->io_q);
+        globus_l_xio_mode_e_read_done(handle, requestor, result, 0, -1);
+    }
+    globus_l_xio_mode_e_save_error(handle, result);
     GlobusXIOModeEDebugExitWithError();
     return result;
 }
@@ -2384,155 +2740,387 @@ error_wait_for:
 
 static
 void
-globus_l_xio_mode_e_write_cb(
+globus_l_xio_mode_e_buffered_read_cb(
     globus_xio_handle_t                 xio_handle,
     globus_result_t                     result,
     globus_xio_iovec_t *                iovec,
-    int                                 count,
+    int                                 iovec_count,
     globus_size_t                       nbytes,
     globus_xio_data_descriptor_t        data_desc,
     void *                              user_arg)
 {
-    globus_result_t                     requestor_result;
-    globus_l_xio_mode_e_connection_handle_t *
+    globus_l_xio_mode_e_connection_handle_t *      
                                         connection_handle;
     globus_l_xio_mode_e_handle_t *      handle;
+    globus_i_xio_mode_e_requestor_t *   requestor;
     globus_xio_operation_t              op;
-    globus_xio_operation_t              requestor_op;
-    globus_off_t                        offset;
-    globus_off_t                        requestor_offset;
-    globus_bool_t                       finish = GLOBUS_TRUE;
-    globus_bool_t                       finish_next = GLOBUS_FALSE;
-    GlobusXIOName(globus_l_xio_mode_e_write_cb);
+    globus_size_t                       user_len;
+    globus_bool_t                       finish_close = GLOBUS_FALSE;
+    GlobusXIOName(globus_l_xio_mode_e_buffered_read_cb);
 
     GlobusXIOModeEDebugEnter();
     connection_handle = (globus_l_xio_mode_e_connection_handle_t *) user_arg;
-    handle = connection_handle->mode_e_handle;
-    op = connection_handle->requestor->op;
-    /* push_node has its own lock. so need for lock before this call */
-    globus_memory_push_node(
-        &handle->requestor_memory, (void*)connection_handle->requestor);
-    offset = connection_handle->outstanding_data_offset;
-    globus_mutex_lock(&handle->mutex);
+    handle = connection_handle->mode_e_handle; 
+    if (connection_handle->iovec != connection_handle->iovec_buf)
+    {
+        globus_free(connection_handle->iovec);
+    }
+    connection_handle->iovec = GLOBUS_NULL;
+    requestor = connection_handle->requestor;
+    if (requestor)
+    {
+        globus_xio_operation_disable_cancel(requestor->op);
+    }
+    user_len = (nbytes < connection_handle->read_user_len) ? 
+                            nbytes : connection_handle->read_user_len;
+    globus_mutex_lock(&handle->mutex); 
     if (result != GLOBUS_SUCCESS)
     {
-        requestor_result = result;
         goto error;
     }
-    if (!globus_fifo_empty(&handle->io_q))
+    connection_handle->read_buffer_end += nbytes - user_len;
+    if (!requestor || 
+        !globus_l_xio_mode_e_buffered_deliver(connection_handle, user_len))
+    {
+        globus_l_xio_mode_e_process_buffer(connection_handle);
+    }
+    globus_mutex_unlock(&handle->mutex); 
+    globus_l_xio_mode_e_finish_reads(handle);
+    GlobusXIOModeEDebugExit();
+    return;
+
+error:
+    if (!requestor && globus_error_match(
+                            globus_error_peek(result), 
+                            GLOBUS_XIO_MODULE, 
+                            GLOBUS_XIO_ERROR_CANCELED))
+    {
+        /* 
+         * as in read_header_cb, the header read was canceled by close
+         */
+        if (!handle->close_canceled)
+        {
+            globus_xio_register_close(
+                connection_handle->xio_handle,
+                NULL,
+                globus_l_xio_mode_e_close_cb,
+                connection_handle->mode_e_handle);
+            globus_list_insert(
+                &handle->close_list, connection_handle->xio_handle);
+        }
+        else
+        {
+            ++handle->close_count;
+            if (handle->close_count == handle->connection_count)
+            {
+                finish_close = GLOBUS_TRUE;
+                op = handle->outstanding_op;
+            }
+        }
+        globus_l_xio_mode_e_connection_handle_destroy(connection_handle);
+        globus_mutex_unlock(&handle->mutex); 
+        if (finish_close)
+        {
+            globus_xio_operation_disable_cancel(op);
+            globus_xio_driver_finished_close(op, result);
+        }
+        GlobusXIOModeEDebugExitWithError();
+        return;
+    }
+    if (requestor)
+    {
+        globus_l_xio_mode_e_read_done(
+            handle, 
+            requestor, 
+            result, 
+            user_len, 
+            connection_handle->outstanding_data_offset);
+        connection_handle->requestor = GLOBUS_NULL;
+    }
+    while (!globus_fifo_empty(&handle->io_q))
     {
-        globus_i_xio_mode_e_requestor_t * requestor;
         requestor = (globus_i_xio_mode_e_requestor_t *)
-                        globus_fifo_dequeue(&handle->io_q);
-        connection_handle->requestor = requestor;
-        requestor_result = globus_i_xio_mode_e_register_write(
-                                                        connection_handle);
-        if (requestor_result != GLOBUS_SUCCESS)
-        {   
-            requestor_op = requestor->op;    
-            requestor_offset = connection_handle->outstanding_data_offset;
-            finish_next = GLOBUS_TRUE;
-            globus_memory_push_node(
-                        &handle->requestor_memory, (void*)requestor);
-            goto error_register_write;
+                                globus_fifo_dequeue(&handle->io_q);
+        globus_l_xio_mode_e_read_done(handle, requestor, result, 0, -1);
+    }
+    globus_l_xio_mode_e_save_error(handle, result);
+    globus_mutex_unlock(&handle->mutex); 
+    globus_l_xio_mode_e_finish_reads(handle);
+    GlobusXIOModeEDebugExitWithError();
+    return;
+}
+
+
+/* called locked */
+static
+void
+globus_l_xio_mode_e_reset_connections(
+    globus_l_xio_mode_e_handle_t *      handle)
+{
+    globus_l_xio_mode_e_connection_handle_t *
+                                        connection_handle;
+    globus_result_t                     result; 
+    GlobusXIOName(globus_l_xio_mode_e_reset_connections);
+    GlobusXIOModeEDebugEnter();
+    handle->eod_count = -1;
+    handle->eods_received = 0;
+    while (!globus_fifo_empty(&handle->eod_q))
+    {
+        connection_handle = (globus_l_xio_mode_e_connection_handle_t *)
+                        globus_fifo_dequeue(&handle->eod_q);
+        result = globus_i_xio_mode_e_register_read_header(connection_handle);
+        if (result != GLOBUS_SUCCESS)
+        {
+            goto error;
         }
     }
-    else
+    handle->state = GLOBUS_XIO_MODE_E_OPEN;
+    GlobusXIOModeEDebugExit();
+    return;
+
+error:
+    globus_l_xio_mode_e_save_error(handle, result);
+    GlobusXIOModeEDebugExitWithError();
+    return;
+}
+
+
+static
+globus_result_t
+globus_l_xio_mode_e_read(
+    void *                              driver_specific_handle,
+    const globus_xio_iovec_t*           iovec,
+    int                                 iovec_count,
+    globus_xio_operation_t              op)
+{
+    globus_l_xio_mode_e_handle_t *      handle;
+    globus_i_xio_mode_e_requestor_t *   requestor;
+    globus_l_xio_mode_e_attr_t *        dd = GLOBUS_NULL;
+    globus_result_t                     result;
+    globus_size_t                       wait_for;
+    globus_bool_t                       finish = GLOBUS_FALSE;
+    GlobusXIOName(globus_l_xio_mode_e_read);
+
+    GlobusXIOModeEDebugEnter();
+    handle = (globus_l_xio_mode_e_handle_t *) driver_specific_handle;
+    wait_for = globus_xio_operation_get_wait_for(op);
+    if (wait_for > 1)
     {
-        if (handle->state == GLOBUS_XIO_MODE_E_SENDING_EOD)
+        result = GlobusXIOErrorParameter("Waitforbytes");
+        goto error_wait_for;
+    }
+    else if (wait_for == 0 && !handle->attr->offset_reads)
+    {
+        result = GlobusXIOErrorParameter(
+                "Waitforbytes cant be zero. Offset reads not set on attr");
+        goto error_wait_for;
+    }
+    if (handle->attr->offset_reads)
+    {
+        dd = (globus_l_xio_mode_e_attr_t *)
+                globus_xio_operation_get_data_descriptor(op, GLOBUS_FALSE);
+        if (!dd)
         {
-            globus_byte_t               descriptor;
-            /* 
-             * I'll get this cb with eod_sent == TRUE for one connection alone
-             * and I send EOF (if need be) on this connection alone. If I don't
-             * need to send EOF and eods_sent == connection_count, I need to 
-             * finish the write (that had SEND_EOD set on dd)
-             */
-            if (!connection_handle->eod)
+            result = GlobusXIOErrorParameter("data_descriptor");
+            goto error_dd;
+        }
+    }
+    requestor = (globus_i_xio_mode_e_requestor_t *)
+                globus_memory_pop_node(&handle->requestor_memory);
+    requestor->op = op;
+    requestor->iovec = (globus_xio_iovec_t*)iovec;
+    requestor->iovec_count = iovec_count;
+    requestor->dd = dd;
+    requestor->handle = handle;
+    requestor->xio_handle = GLOBUS_NULL;
+    if (globus_xio_operation_enable_cancel(
+        op, globus_l_xio_mode_e_cancel_cb, requestor))
+    {
+        result = GlobusXIOErrorCanceled();
+        goto error_cancel_enable;
+    }
+    globus_mutex_lock(&handle->mutex);
+    if (globus_xio_operation_is_canceled(op))
+    {
+        result = GlobusXIOErrorCanceled();
+        goto error_operation_canceled;
+    }
+    switch (handle->state)
+    {
+        case GLOBUS_XIO_MODE_E_EOF_RECEIVED:
+            globus_xio_driver_set_eof_received(op);
+            handle->state = GLOBUS_XIO_MODE_E_EOF_DELIVERED;
+	    globus_memory_push_node(
+			&handle->requestor_memory, (void*)requestor);
+            result = GlobusXIOErrorEOF();
+            finish = GLOBUS_TRUE;
+            break;
+        case GLOBUS_XIO_MODE_E_EOF_DELIVERED:
+            if (globus_xio_driver_eof_received(op) || 
+                                        handle->connection_count == 0)
             {
-                descriptor = GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOD;
-                requestor_result = globus_l_xio_mode_e_register_eod(
-                                              connection_handle, descriptor);
-                if (requestor_result != GLOBUS_SUCCESS)
-                {
-                    goto error_register_eod;
-                }
+	        globus_memory_push_node(
+			&handle->requestor_memory, (void*)requestor);
+                result = GlobusXIOErrorEOF();
+                finish = GLOBUS_TRUE;
+                break;
+            }
+            else
+            {
+                globus_l_xio_mode_e_reset_connections(handle);
+                /* 
+                 * connection_q will be empty at this point (unless a read
+                 * buffer already had the next data). I let this fall 
+                 * through to enqueue the request in the io_q
+                 */
+            }
+            /* fall through */
+        case GLOBUS_XIO_MODE_E_OPEN:
+            if (globus_fifo_empty(&handle->connection_q))
+            {
+                globus_fifo_enqueue(&handle->io_q, requestor);
             }
-            else 
+            else
             {
-                connection_handle->eod = GLOBUS_FALSE;
-                if (handle->eod_count > -1)
+                globus_l_xio_mode_e_connection_handle_t *      
+                                                connection_handle;
+                if (wait_for == 0)
+                {
+                    globus_memory_push_node(
+                                &handle->requestor_memory, (void*)requestor);
+                    connection_handle = 
+                                (globus_l_xio_mode_e_connection_handle_t*) 
+                                    globus_fifo_dequeue(&handle->connection_q);
+                    globus_hashtable_insert(
+                        &handle->offset_ht, 
+                        (void *)&connection_handle->outstanding_data_offset, 
+                        (void *)connection_handle);
+                    dd->offset = connection_handle->outstanding_data_offset;
+                    result = GLOBUS_SUCCESS;
+                    finish = GLOBUS_TRUE;
+                }
+                else 
                 {
-                    descriptor = GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOF;
-                    requestor_result = globus_l_xio_mode_e_register_eod(
-                                              connection_handle, descriptor);
-                    if (requestor_result != GLOBUS_SUCCESS)
+                    if (handle->attr->offset_reads)
                     {
-                        goto error_register_eod;
+                        connection_handle = 
+                                (globus_l_xio_mode_e_connection_handle_t*) 
+                                        globus_hashtable_remove(
+                                            &handle->offset_ht, &dd->offset);
+                        if (!connection_handle)
+                        {
+                            result = GlobusXIOErrorParameter("Invalid offset");
+                            goto error_offset;
+                        }
                     }
-                }
-                else
-                {
-                    globus_fifo_enqueue(
-                                &handle->connection_q, connection_handle);
-                    if (handle->eods_sent < handle->connection_count)
+                    else
                     {
-                        finish = GLOBUS_FALSE;
+                        connection_handle = 
+                            (globus_l_xio_mode_e_connection_handle_t*) 
+                                globus_fifo_dequeue(&handle->connection_q);
                     }
+                    connection_handle->requestor = requestor;
+                    requestor->xio_handle = connection_handle->xio_handle;
+                    globus_i_xio_mode_e_register_read(connection_handle);
                 }
             }
-        }
-        else
-        {
-            globus_fifo_enqueue(&handle->connection_q, connection_handle);
-        }
+            break;
+        case GLOBUS_XIO_MODE_E_ERROR:
+            result = globus_error_put(globus_object_copy(handle->error));
+            goto error_invalid_state;
+        default:
+            result = GlobusXIOErrorInvalidState(handle->state);
+            goto error_invalid_state;
     }
     globus_mutex_unlock(&handle->mutex);
     if (finish)
     {
-        globus_xio_driver_data_descriptor_cntl(
-                            op,
-                            NULL,
-                            GLOBUS_XIO_DD_SET_OFFSET,
-                            offset);
-        globus_xio_driver_finished_write(op, result, nbytes);
+        globus_xio_operation_disable_cancel(op);
+        globus_xio_driver_finished_read(op, result, 0);
+    }
+    if (handle->attr->read_buffer_size > 0)
+    {
+        globus_l_xio_mode_e_finish_reads(handle);
     }
     GlobusXIOModeEDebugExit();
-    return;
+    return GLOBUS_SUCCESS;
 
-error_register_eod:
-error_register_write:
-error:
-    globus_fifo_enqueue(&handle->connection_q, connection_handle);
-    globus_l_xio_mode_e_save_error(handle, result);
+error_invalid_state:
+error_offset:
+error_operation_canceled:
     globus_mutex_unlock(&handle->mutex);
-    if (finish_next)
+    globus_xio_operation_disable_cancel(op);
+error_cancel_enable:
+    globus_memory_push_node(&handle->requestor_memory, (void*)requestor);
+error_dd:
+error_wait_for:
+    GlobusXIOModeEDebugExitWithError();
+    return result;
+}
+
+
+/* 
+ * called unlocked. Finishes the writes chained from requestor (except 
+ * unfinished, which gets finished in eod_cb) and frees their requestors.
+ * nbytes is what the writev they went out in reported, headers included.
+ */
+static
+void
+globus_l_xio_mode_e_finish_writes(
+    globus_l_xio_mode_e_handle_t *      handle,
+    globus_i_xio_mode_e_requestor_t *   requestor,
+    globus_i_xio_mode_e_requestor_t *   unfinished,
+    globus_result_t                     result,
+    globus_size_t                       nbytes)
+{
+    globus_i_xio_mode_e_requestor_t *   next;
+    globus_xio_operation_t              op;
+    globus_off_t                        offset;
+    globus_size_t                       header_size;
+    globus_size_t                       len;
+    globus_bool_t                       finish;
+    GlobusXIOName(globus_l_xio_mode_e_finish_writes);
+
+    GlobusXIOModeEDebugEnter();
+    header_size = sizeof(globus_l_xio_mode_e_header_t);
+    while (requestor)
     {
-        globus_xio_driver_data_descriptor_cntl(
-                    requestor_op,
-                    NULL,
-                    GLOBUS_XIO_DD_SET_OFFSET,
-                    requestor_offset);
-        globus_xio_driver_finished_write(requestor_op, requestor_result, 0);
+        next = requestor->next;
+        op = requestor->op;
+        offset = requestor->offset;
+        finish = (requestor != unfinished);
+        nbytes -= (nbytes < header_size) ? nbytes : header_size;
+        len = (nbytes < requestor->length) ? nbytes : requestor->length;
+        nbytes -= len;
+        /* 
+         * cancel_cb gets the requestor, so cancel has to be off before the
+         * node goes back. push_node has its own lock. so need for lock
+         * before this call
+         */
+        globus_xio_operation_disable_cancel(op);
+        globus_memory_push_node(&handle->requestor_memory, (void*)requestor);
+        if (finish)
+        {
+            globus_xio_driver_data_descriptor_cntl(
+                                op,
+                                NULL,
+                                GLOBUS_XIO_DD_SET_OFFSET,
+                                offset);
+            globus_xio_driver_finished_write(op, result, len);
+        }
+        requestor = next;
     }
-    globus_xio_driver_data_descriptor_cntl(
-                        op,
-                        NULL,
-                        GLOBUS_XIO_DD_SET_OFFSET,
-                        offset);
-    globus_xio_driver_finished_write(op, result, nbytes);
-    GlobusXIOModeEDebugExitWithError();
-    return;
+    GlobusXIOModeEDebugExit();
 }
 
 
 static
 void
-globus_l_xio_mode_e_write_header_cb(
+globus_l_xio_mode_e_write_cb(
     globus_xio_handle_t                 xio_handle,
     globus_result_t                     result,
-    globus_byte_t *                     buffer,
-    globus_size_t                       len,
+    globus_xio_iovec_t *                iovec,
+    int                                 count,
     globus_size_t                       nbytes,
     globus_xio_data_descriptor_t        data_desc,
     void *                              user_arg)
@@ -2540,67 +3128,69 @@ globus_l_xio_mode_e_write_header_cb(
     globus_l_xio_mode_e_connection_handle_t *
                                         connection_handle;
     globus_l_xio_mode_e_handle_t *      handle;
-    globus_l_xio_mode_e_header_t *      header;
-    const globus_xio_iovec_t *          iovec;
-    int                                 iovec_count;
-    globus_size_t                       iovec_len;
-    globus_xio_operation_t              op;
-    globus_off_t                        offset;
-    globus_bool_t                       finish = GLOBUS_FALSE;
+    globus_i_xio_mode_e_requestor_t *   batch;
+    globus_i_xio_mode_e_requestor_t *   next_batch = GLOBUS_NULL;
+    globus_i_xio_mode_e_requestor_t *   last = GLOBUS_NULL;
+    globus_i_xio_mode_e_requestor_t *   unfinished = GLOBUS_NULL;
+    globus_i_xio_mode_e_requestor_t *   requestor;
+    globus_byte_t                       descriptor;
     globus_result_t                     res;
-    GlobusXIOName(globus_l_xio_mode_e_write_header_cb);
+    GlobusXIOName(globus_l_xio_mode_e_write_cb);
 
     GlobusXIOModeEDebugEnter();
     connection_handle = (globus_l_xio_mode_e_connection_handle_t *) user_arg;
     handle = connection_handle->mode_e_handle;
-    header = (globus_l_xio_mode_e_header_t *) buffer;
-    globus_xio_operation_disable_cancel(connection_handle->requestor->op);
+    batch = connection_handle->requestor;
+    for (requestor = batch; requestor; requestor = requestor->next)
+    {
+        globus_xio_operation_disable_cancel(requestor->op);
+        last = requestor;
+    }
+    if (connection_handle->iovec != connection_handle->iovec_buf)
+    {
+        globus_free(connection_handle->iovec);
+    }
+    connection_handle->iovec = GLOBUS_NULL;
     globus_mutex_lock(&handle->mutex);
-    if (result == GLOBUS_SUCCESS)
+    /* only the last block of a batch can carry EOD */
+    descriptor = last->header->descriptor;
+    for (requestor = batch; requestor; requestor = requestor->next)
+    {
+        globus_buffer_pool_put(
+                &handle->header_memory, (void*)requestor->header);
+        requestor->header = GLOBUS_NULL;
+    }
+    if (result != GLOBUS_SUCCESS)
+    {
+        res = result;
+        goto error;
+    }
+    /* 
+     * if handle->eod_count != -1, then register_eod will be called (either
+     * in here or in a later write_cb) to send EOF and eods_sent will be 
+     * incremented in eod_cb
+     */
+    if (descriptor & GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOD &&
+        handle->eod_count == -1) 
+    {
+        ++handle->eods_sent;
+    }
+    if (!last->iovec)
     {
         /* 
-         * if handle->eod_count != -1, then register_eod will be called (either
-         * in here or in write_cb) to send EOF and eods_sent will be 
-         * incremented in eod_cb
+         * last->iovec can be NULL only when the user sets SEND_EOD on the
+         * dd. So I just wrote EOD on this channel and now i check to see if
+         * i need to send EOF
          */
-        if (header->descriptor & GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOD &&
-            handle->eod_count == -1) 
-        {
-            ++handle->eods_sent;
-        }
-        globus_memory_push_node(&handle->header_memory, (void*)header);
-        if (connection_handle->requestor->iovec)
-        {
-            iovec = connection_handle->requestor->iovec;
-            iovec_count = connection_handle->requestor->iovec_count;
-            GlobusXIOUtilIovTotalLength(iovec_len, iovec, iovec_count);
-            res = globus_xio_register_writev(
-                        connection_handle->xio_handle,
-                        (globus_xio_iovec_t*)iovec,
-                        iovec_count,
-                        iovec_len,
-                        GLOBUS_NULL,
-                        globus_l_xio_mode_e_write_cb,
-                        connection_handle);
-            if (res != GLOBUS_SUCCESS)
-            {
-                goto error;
-            }
-        }
-        else if (handle->eod_count > -1)
+        connection_handle->eod = GLOBUS_FALSE;
+        if (handle->eod_count > -1)
         {
-            globus_byte_t               descriptor;
-            /* 
-             * handle->iovec can be NULL only when the user sets SEND_EOD
-             * on the dd. So I just wrote EOD on this channel and now i check
-             * to see if i need to send EOF
-             */
             descriptor = GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOF;
             res = globus_l_xio_mode_e_register_eod(
                                 connection_handle, descriptor);
             if (res != GLOBUS_SUCCESS)
             {
-                goto error;
+                goto error_register_eod;
             }
         }
         else 
@@ -2616,55 +3206,114 @@ globus_l_xio_mode_e_write_header_cb(
                 handle->eod_count = -1;
                 handle->attr->eod_count = -1;
                 handle->offset = 0;
-                finish = GLOBUS_TRUE;
+            }
+            else
+            {
+                /* the op is stored in handle->outstanding_op too */
+                unfinished = last;
+                handle->eod_nbytes = 0;
+            }
+        }
+    }
+    else if (!globus_fifo_empty(&handle->io_q))
+    {
+        next_batch = (globus_i_xio_mode_e_requestor_t *)
+                        globus_fifo_dequeue(&handle->io_q);
+        connection_handle->requestor = next_batch;
+        res = globus_i_xio_mode_e_register_write(connection_handle);
+        if (res != GLOBUS_SUCCESS)
+        {   
+            goto error_register_write;
+        }
+    }
+    else if (handle->state == GLOBUS_XIO_MODE_E_SENDING_EOD)
+    {
+        /* 
+         * I'll get this cb with eod_sent == TRUE for one connection alone
+         * and I send EOF (if need be) on this connection alone. If I don't
+         * need to send EOF and eods_sent == connection_count, I need to 
+         * finish the write (that had SEND_EOD set on dd)
+         */
+        if (!connection_handle->eod)
+        {
+            descriptor = GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOD;
+            res = globus_l_xio_mode_e_register_eod(
+                                          connection_handle, descriptor);
+            if (res != GLOBUS_SUCCESS)
+            {
+                goto error_register_eod;
+            }
+        }
+        else 
+        {
+            connection_handle->eod = GLOBUS_FALSE;
+            if (handle->eod_count > -1)
+            {
+                descriptor = GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOF;
+                res = globus_l_xio_mode_e_register_eod(
+                                          connection_handle, descriptor);
+                if (res != GLOBUS_SUCCESS)
+                {
+                    goto error_register_eod;
+                }
                 /* 
-                 * handle->eod_offset also has same value. if i have to finish
-                 * in eod_cb, connection_handle->outstanding_data_offset cant
-                 * be used coz i don't know which connection_handle is 
-                 * associated with the user_write (that had SEND_EOD set).
+                 * last is the write that had SEND_EOD set; eod_cb finishes
+                 * it (as handle->outstanding_op) once the EOF is out
                  */
-                offset = connection_handle->outstanding_data_offset;
-                /* the op is stored in handle->outstanding_op too */
-                op = connection_handle->requestor->op;
-                globus_memory_push_node(
-                    &handle->requestor_memory, 
-                    (void*)connection_handle->requestor);
+                unfinished = last;
+                handle->eod_nbytes = last->length;
+            }
+            else
+            {
+                globus_fifo_enqueue(
+                            &handle->connection_q, connection_handle);
+                if (handle->eods_sent < handle->connection_count)
+                {
+                    unfinished = last;
+                    handle->eod_nbytes = last->length;
+                }
             }
         }
     }
     else
     {
-        globus_memory_push_node(&handle->header_memory, (void*)header);
-        res = result;
-        goto error;
+        globus_fifo_enqueue(&handle->connection_q, connection_handle);
     }
     globus_mutex_unlock(&handle->mutex);
-    if (finish)
-    {
-        globus_xio_driver_data_descriptor_cntl(
-                    op,
-                    NULL,
-                    GLOBUS_XIO_DD_SET_OFFSET,
-                    offset);
-        globus_xio_driver_finished_write(op, result, 0);
-    }
+    globus_l_xio_mode_e_finish_writes(
+                            handle, batch, unfinished, result, nbytes);
     GlobusXIOModeEDebugExit();
     return;
 
-error:
+error_register_write:
+    /* the batch just written went out fine; the next one never will */
+    globus_fifo_enqueue(&handle->connection_q, connection_handle);
     globus_l_xio_mode_e_save_error(handle, res);
-    op = connection_handle->requestor->op;
-    globus_memory_push_node(
-        &handle->requestor_memory, (void*)connection_handle->requestor);
+    globus_mutex_unlock(&handle->mutex);
+    globus_l_xio_mode_e_finish_writes(handle, next_batch, GLOBUS_NULL, res, 0);
+    globus_l_xio_mode_e_finish_writes(
+                            handle, batch, GLOBUS_NULL, result, nbytes);
+    GlobusXIOModeEDebugExitWithError();
+    return;
+
+error_register_eod:
+error:
     globus_fifo_enqueue(&handle->connection_q, connection_handle);
+    globus_l_xio_mode_e_save_error(handle, res);
     globus_mutex_unlock(&handle->mutex);
-    globus_xio_driver_finished_write(op, res, 0);
+    globus_l_xio_mode_e_finish_writes(handle, batch, GLOBUS_NULL, res, nbytes);
     GlobusXIOModeEDebugExitWithError();
     return;
 }
 
 
-/* called locked */
+/* 
+ * called locked. connection_handle->requestor is the block to send; more
+ * blocks are taken off io_q and sent in the same writev, each behind its
+ * own header, as long as this connection's share of the queue allows.
+ * If the writev cannot be registered, the blocks are left chained off
+ * connection_handle->requestor for the caller to fail.
+ */
 static
 globus_result_t
 globus_i_xio_mode_e_register_write(
@@ -2672,6 +3321,15 @@ globus_i_xio_mode_e_register_write(
                                         connection_handle)
 {
     globus_l_xio_mode_e_handle_t *      handle;
+    globus_i_xio_mode_e_requestor_t *   requestor;
+    globus_i_xio_mode_e_requestor_t *   next;
+    globus_xio_iovec_t *                iovec;
+    int                                 iovec_count = 0;
+    int                                 iovec_max;
+    int                                 block_count = 1;
+    int                                 block_max = 1;
+    int                                 i;
+    globus_size_t                       total_len = 0;
     globus_off_t                        size;
     globus_off_t                        offset;
     globus_l_xio_mode_e_header_t *      header;
@@ -2681,44 +3339,106 @@ globus_i_xio_mode_e_register_write(
 
     GlobusXIOModeEDebugEnter();
     handle = connection_handle->mode_e_handle;
-    header = (globus_l_xio_mode_e_header_t *) globus_memory_pop_node(
-                                                    &handle->header_memory);
     header_size = sizeof(globus_l_xio_mode_e_header_t);
-    memset(header, 0, header_size);
-    GlobusXIOUtilIovTotalLength(
-                size, 
-                connection_handle->requestor->iovec, 
-                connection_handle->requestor->iovec_count);
-    globus_i_xio_mode_e_header_encode(header->count, size);
-    result = globus_xio_driver_data_descriptor_cntl(
-                connection_handle->requestor->op,
-                NULL,
-                GLOBUS_XIO_DD_GET_OFFSET,
-                &offset);
-    if (result != GLOBUS_SUCCESS || offset == -1)
+    requestor = connection_handle->requestor;
+    if (!globus_fifo_empty(&handle->io_q) && handle->connection_count > 0)
     {
-        offset = handle->offset;
+        /* leave the other connections their share of what is queued */
+        block_max += globus_fifo_size(&handle->io_q) / 
+                                            handle->connection_count;
+        if (block_max > GLOBUS_XIO_MODE_E_WRITE_BATCH)
+        {
+            block_max = GLOBUS_XIO_MODE_E_WRITE_BATCH;
+        }
     }
-    if (handle->state == GLOBUS_XIO_MODE_E_SENDING_EOD && 
-        globus_fifo_empty(&handle->io_q))
+    iovec = connection_handle->iovec_buf;
+    iovec_max = GLOBUS_XIO_MODE_E_IOVEC_COUNT;
+    if (requestor->iovec_count + 1 > iovec_max)
     {
-        header->descriptor = GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOD;
-        handle->eod_offset = offset;
+        iovec_max = requestor->iovec_count + 1;
+        iovec = (globus_xio_iovec_t *) 
+                    globus_malloc(iovec_max * sizeof(globus_xio_iovec_t));
+        if (!iovec)
+        {
+            result = GlobusXIOErrorMemory("iovec");
+            goto error_iovec;
+        }
     }
-    globus_i_xio_mode_e_header_encode(header->offset, offset);
-    connection_handle->outstanding_data_offset = offset;
-    offset += size;
-    if (offset > handle->offset)
+    for (;;)
     {
-        handle->offset = offset;
+        requestor->next = GLOBUS_NULL;
+        requestor->xio_handle = connection_handle->xio_handle;
+        header = (globus_l_xio_mode_e_header_t *) globus_buffer_pool_get(
+                                                    &handle->header_memory);
+        memset(header, 0, header_size);
+        requestor->header = header;
+        size = 0;
+        if (requestor->iovec)
+        {
+            GlobusXIOUtilIovTotalLength(
+                        size, requestor->iovec, requestor->iovec_count);
+        }
+        requestor->length = size;
+        globus_i_xio_mode_e_header_encode(header->count, size);
+        result = globus_xio_driver_data_descriptor_cntl(
+                    requestor->op,
+                    NULL,
+                    GLOBUS_XIO_DD_GET_OFFSET,
+                    &offset);
+        if (result != GLOBUS_SUCCESS || offset == -1)
+        {
+            offset = handle->offset;
+        }
+        if (handle->state == GLOBUS_XIO_MODE_E_SENDING_EOD && 
+            globus_fifo_empty(&handle->io_q))
+        {
+            header->descriptor = GLOBUS_XIO_MODE_E_DATA_DESCRIPTOR_EOD;
+            handle->eod_offset = offset;
+        }
+        globus_i_xio_mode_e_header_encode(header->offset, offset);
+        requestor->offset = offset;
+        connection_handle->outstanding_data_offset = offset;
+        offset += size;
+        if (offset > handle->offset)
+        {
+            handle->offset = offset;
+        }
+
+        iovec[iovec_count].iov_base = header;
+        iovec[iovec_count].iov_len = header_size;
+        ++iovec_count;
+        for (i = 0; requestor->iovec && i < requestor->iovec_count; i++)
+        {
+            if (requestor->iovec[i].iov_len > 0)
+            {
+                iovec[iovec_count++] = requestor->iovec[i];
+            }
+        }
+        total_len += header_size + size;
+
+        if (block_count == block_max || globus_fifo_empty(&handle->io_q))
+        {
+            break;
+        }
+        next = (globus_i_xio_mode_e_requestor_t *) 
+                                    globus_fifo_peek(&handle->io_q);
+        if (iovec_count + next->iovec_count + 1 > iovec_max)
+        {
+            break;
+        }
+        globus_fifo_dequeue(&handle->io_q);
+        requestor->next = next;
+        requestor = next;
+        ++block_count;
     }
-    result = globus_xio_register_write(
+    connection_handle->iovec = iovec;
+    result = globus_xio_register_writev(
                 connection_handle->xio_handle, 
-                (globus_byte_t*)header, 
-                header_size,
-                header_size,
+                iovec,
+                iovec_count,
+                total_len,
                 GLOBUS_NULL,
-                globus_l_xio_mode_e_write_header_cb,
+                globus_l_xio_mode_e_write_cb,
                 connection_handle);
     if (result != GLOBUS_SUCCESS)
     {
@@ -2732,6 +3452,26 @@ globus_i_xio_mode_e_register_write(
     return GLOBUS_SUCCESS;
 
 error:
+    for (requestor = connection_handle->requestor; 
+         requestor; 
+         requestor = requestor->next)
+    {
+        globus_buffer_pool_put(
+                &handle->header_memory, (void*)requestor->header);
+        requestor->header = GLOBUS_NULL;
+    }
+    if (iovec != connection_handle->iovec_buf)
+    {
+        globus_free(iovec);
+    }
+    connection_handle->iovec = GLOBUS_NULL;
+    GlobusXIOModeEDebugExitWithError();
+    return result;
+
+error_iovec:
+    requestor->next = GLOBUS_NULL;
+    requestor->length = 0;
+    requestor->offset = handle->offset;
     GlobusXIOModeEDebugExitWithError();
     return result;
 }
@@ -2863,9 +3603,19 @@ globus_l_xio_mode_e_write(
     GlobusXIOModeEDebugExit();
     return GLOBUS_SUCCESS;
 
+error_register_write:
+    /* 
+     * io_q should be empty while a connection is idle, but should blocks
+     * have been batched behind this one, they fail along with it
+     */
+    globus_mutex_unlock(&handle->mutex);
+    globus_l_xio_mode_e_finish_writes(
+                        handle, requestor->next, GLOBUS_NULL, result, 0);
+    globus_xio_operation_disable_cancel(op);
+    goto error_cancel_enable;
+
 error_invalid_state:
 error_open_new_stream:
-error_register_write:
 error_operation_canceled:
     globus_mutex_unlock(&handle->mutex);
     globus_xio_operation_disable_cancel(op);
@@ -2976,6 +3726,7 @@ globus_l_xio_mode_e_write_eod_cb(
     globus_l_xio_mode_e_header_t *      header; 
     globus_xio_operation_t              op;
     globus_off_t                        offset;
+    globus_size_t                       eod_nbytes;
     globus_bool_t                       finish = GLOBUS_FALSE;
     globus_bool_t                       finish_close = GLOBUS_FALSE;
     globus_result_t                     res;
@@ -3035,7 +3786,7 @@ globus_l_xio_mode_e_write_eod_cb(
                 op = handle->outstanding_op;
             }
         }
-        globus_free(connection_handle);
+        globus_l_xio_mode_e_connection_handle_destroy(connection_handle);
     }
     else
     {
@@ -3056,6 +3807,8 @@ globus_l_xio_mode_e_write_eod_cb(
             handle->offset = 0;
             op = handle->outstanding_op;
             offset = handle->eod_offset;
+            eod_nbytes = handle->eod_nbytes;
+            handle->eod_nbytes = 0;
             finish = GLOBUS_TRUE;
         }
         if (!globus_error_match(
@@ -3070,7 +3823,7 @@ globus_l_xio_mode_e_write_eod_cb(
         }
         
     }           
-    globus_memory_push_node(&handle->header_memory, (void*)header);
+    globus_buffer_pool_put(&handle->header_memory, (void*)header);
     globus_mutex_unlock(&handle->mutex);
     if (finish)
     {
@@ -3080,7 +3833,7 @@ globus_l_xio_mode_e_write_eod_cb(
                     NULL,
                     GLOBUS_XIO_DD_SET_OFFSET,
                     offset);
-        globus_xio_driver_finished_write(op, result, 0);
+        globus_xio_driver_finished_write(op, result, eod_nbytes);
     }
     if (finish_close)
     {
@@ -3093,7 +3846,7 @@ error_close:
 error:
     globus_l_xio_mode_e_save_error(handle, res);
     globus_mutex_unlock(&handle->mutex);
-    globus_memory_push_node(&handle->header_memory, (void*)header);
+    globus_buffer_pool_put(&handle->header_memory, (void*)header);
     GlobusXIOModeEDebugExitWithError();
     return;
 }
@@ -3116,7 +3869,7 @@ globus_l_xio_mode_e_register_eod(
     GlobusXIOModeEDebugEnter();
     handle = connection_handle->mode_e_handle;
     header = (globus_l_xio_mode_e_header_t *)
-                    globus_memory_pop_node(&handle->header_memory);
+                    globus_buffer_pool_get(&handle->header_memory);
     header_size = sizeof(globus_l_xio_mode_e_header_t);
     memset(header, 0, header_size);
     header->descriptor = descriptor;
@@ -3143,7 +3896,7 @@ globus_l_xio_mode_e_register_eod(
     return GLOBUS_SUCCESS;
 
 error:
-    globus_memory_push_node(&handle->header_memory, (void*)header);         
+    globus_buffer_pool_put(&handle->header_memory, (void*)header);         
     GlobusXIOModeEDebugExitWithError();
     return result;
 }
@@ -3188,7 +3941,7 @@ globus_l_xio_mode_e_close_connections(
                 connection_handle->mode_e_handle);
             globus_list_insert(
                         &handle->close_list, connection_handle->xio_handle);
-            globus_free(connection_handle);
+            globus_l_xio_mode_e_connection_handle_destroy(connection_handle);
         }
         else
         {
@@ -3493,6 +4246,23 @@ globus_l_xio_mode_e_attr_cntl(
             }
             break;
         }
+        case GLOBUS_XIO_MODE_E_SET_READ_BUFFER_SIZE:
+        {
+            int read_buffer_size = va_arg(ap, int);
+            if (read_buffer_size < 0)
+            {
+                result = GlobusXIOErrorParameter("read_buffer_size");
+                goto error;
+            }
+            attr->read_buffer_size = read_buffer_size;
+            break;
+        }
+        case GLOBUS_XIO_MODE_E_GET_READ_BUFFER_SIZE:
+        {
+            int * read_buffer_size_out = va_arg(ap, int*);
+            *read_buffer_size_out = attr->read_buffer_size;
+            break;
+        }
         default:
            result = GlobusXIOErrorInvalidCommand(cmd);
            goto error;
@@ -308,7 +308,32 @@ typedef enum
      */
     /* globus_xio_attr_t *         stack_out */
 
-    GLOBUS_XIO_MODE_E_GET_STACK_ATTR
+    GLOBUS_XIO_MODE_E_GET_STACK_ATTR,
+
+    /** GlobusVarArgEnum(attr)
+     * Set the size of the buffer each stream reads into on the server side.
+     * @ingroup globus_xio_mode_e_driver_cntls
+     * With a buffer, a stream reads as much as is available into it and
+     * the block headers, and any payload that arrived with them, are taken
+     * out of the buffer without another read.  Payload that has not
+     * arrived yet is still read directly into the user's buffer.
+     *
+     * @param read_buffer_size
+     *      The buffer size in bytes, or 0 (default) to read each header 
+     *      and payload separately.
+     */
+    /* int                                  read_buffer_size */
+    GLOBUS_XIO_MODE_E_SET_READ_BUFFER_SIZE,
+
+    /** GlobusVarArgEnum(attr)
+     * Get the read buffer size on the attr.
+     * @ingroup globus_xio_mode_e_driver_cntls
+     *
+     * @param read_buffer_size_out
+     *      The read buffer size will be stored here.
+     */
+    /* int *                                read_buffer_size_out */
+    GLOBUS_XIO_MODE_E_GET_READ_BUFFER_SIZE
 
 } globus_xio_mode_e_cmd_t;	
 
@@ -116,6 +116,10 @@ typedef struct
     
     /* data descriptor */
     int                                 send_flags;
+    globus_bool_t                       sendfile;
+    globus_xio_system_file_t            sendfile_fd;
+    globus_off_t                        sendfile_offset;
+    globus_size_t                       sendfile_length;
     
     globus_bool_t                       global;
     globus_bool_t                       use_blocking_io;
@@ -149,6 +153,10 @@ static globus_l_attr_t                  globus_l_xio_tcp_attr_default =
     0,                                  /* connector_max_port */
     
     0,                                  /* send_flags */
+    GLOBUS_FALSE,                       /* sendfile */
+    0,                                  /* sendfile_fd */
+    0,                                  /* sendfile_offset */
+    0,                                  /* sendfile_length */
     GLOBUS_FALSE,                       /* global */
     GLOBUS_FALSE                        /* use_blocking_io */
 };
@@ -755,6 +763,16 @@ globus_l_xio_tcp_attr_cntl(
         *out_int = attr->send_flags;
         break;
 
+      /* globus_xio_system_file_t       file_fd,
+       * globus_off_t                   offset,
+       * globus_size_t                  length */
+      case GLOBUS_XIO_TCP_SET_SENDFILE:
+        attr->sendfile = GLOBUS_TRUE;
+        attr->sendfile_fd = va_arg(ap, globus_xio_system_file_t);
+        attr->sendfile_offset = va_arg(ap, globus_off_t);
+        attr->sendfile_length = va_arg(ap, globus_size_t);
+        break;
+
       /* globus_bool_t                  use_blocking_io */
       case GLOBUS_XIO_TCP_SET_BLOCKING_IO:
         attr->use_blocking_io = va_arg(ap, globus_bool_t);
@@ -2657,8 +2675,27 @@ globus_l_xio_tcp_write(
     attr = (globus_l_attr_t *)
         globus_xio_operation_get_data_descriptor(op, GLOBUS_FALSE);
     
+    if(attr && attr->sendfile)
+    {
+        result = globus_xio_system_socket_register_sendfile(
+            op,
+            handle->system,
+            iovec,
+            iovec_count,
+            attr->sendfile_fd,
+            attr->sendfile_offset,
+            attr->sendfile_length,
+            globus_l_xio_tcp_system_write_cb,
+            handle);
+        if(result != GLOBUS_SUCCESS)
+        {
+            result = GlobusXIOErrorWrapFailed(
+                "globus_xio_system_socket_register_sendfile", result);
+            goto error_register;
+        }
+    }
     /* if buflen and waitfor are both 0, we behave like register select */
-    if((globus_xio_operation_get_wait_for(op) == 0 &&
+    else if((globus_xio_operation_get_wait_for(op) == 0 &&
         (iovec_count > 1 || iovec[0].iov_len > 0)) ||
         (handle->use_blocking_io &&
         globus_xio_driver_operation_is_blocking(op)))
@@ -769,7 +769,34 @@ typedef enum
      *      The flag will be set here.  GLOBUS_TRUE for enabled.
      */
     /* globus_bool_t *                  use_blocking_io_out */
-    GLOBUS_XIO_TCP_GET_BLOCKING_IO
+    GLOBUS_XIO_TCP_GET_BLOCKING_IO,
+    
+    /**GlobusVarArgEnum(dd)
+     * Send a range of a file after the write buffer.
+     * @ingroup globus_xio_tcp_driver_cntls
+     * Used only for data descriptors to write calls.  The write buffer
+     * (which may be empty) is sent first, followed by @a length bytes of
+     * @a file_fd starting at @a offset, using sendfile() so the file data
+     * is never copied into user space.  The write does not complete until
+     * everything has been sent and the reported nbytes includes the file
+     * data.  The file's own position is not changed.
+     *
+     * This bypasses any drivers above tcp, so only use it when every
+     * driver above tcp passes writes through unmodified.  If the platform
+     * has no sendfile() the write fails with a system error (ENOSYS) and
+     * the caller is expected to fall back to an ordinary write.
+     * 
+     * @param file_fd
+     *      An open file descriptor to send from.
+     * @param offset
+     *      The file offset to start sending from.
+     * @param length
+     *      The number of file bytes to send.
+     */
+    /* globus_xio_system_file_t         file_fd,
+     * globus_off_t                     offset,
+     * globus_size_t                    length */
+    GLOBUS_XIO_TCP_SET_SENDFILE
     
 } globus_xio_tcp_cmd_t;
 
@@ -17,6 +17,9 @@
 #include "globus_i_xio_system_common.h"
 #include <unistd.h>
 #include <limits.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #ifndef WIN32
 #define GlobusLXIOSystemWouldBlock(err)                                     \
@@ -989,3 +992,72 @@ globus_i_xio_system_socket_try_write(
     GlobusXIOSystemDebugExit();
     return result;
 }
+
+/*
+ * move up to length bytes of file_fd (starting at file_offset) onto the
+ * socket without copying through user space.  file_fd's own position is
+ * left untouched.
+ */
+globus_result_t
+globus_i_xio_system_socket_try_sendfile(
+    globus_xio_system_socket_t          handle,
+    globus_xio_system_file_t            file_fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       length,
+    globus_size_t *                     nbytes)
+{
+    globus_result_t                     result;
+    GlobusXIOName(globus_i_xio_system_socket_try_sendfile);
+
+    GlobusXIOSystemDebugEnterFD(handle);
+
+#if defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE)
+    {
+        globus_ssize_t                  rc;
+        off_t                           offset = file_offset;
+
+        do
+        {
+            rc = sendfile(handle, file_fd, &offset, length);
+            GlobusXIOSystemUpdateErrno();
+        } while(rc < 0 && errno == EINTR);
+
+        if(rc < 0)
+        {
+            if(GlobusLXIOSystemWouldBlock(errno))
+            {
+                rc = 0;
+            }
+            else
+            {
+                result = GlobusXIOErrorSystemError("sendfile", errno);
+                goto error_errno;
+            }
+        }
+        else if(rc == 0 && length > 0)
+        {
+            /* file is shorter than the caller claimed */
+            result = GlobusXIOErrorEOF();
+            goto error_errno;
+        }
+
+        *nbytes = rc;
+
+        GlobusXIOSystemDebugPrintf(
+            GLOBUS_I_XIO_SYSTEM_DEBUG_DATA,
+            ("[%s] Sent %ld bytes from fd %d\n",
+                _xio_name, (long) rc, (int) file_fd));
+    }
+
+    GlobusXIOSystemDebugExitFD(handle);
+    return GLOBUS_SUCCESS;
+#else
+    result = GlobusXIOErrorSystemError("sendfile", ENOSYS);
+    goto error_errno;
+#endif
+
+error_errno:
+    *nbytes = 0;
+    GlobusXIOSystemDebugExitWithErrorFD(handle);
+    return result;
+}
@@ -182,7 +182,8 @@ typedef enum
     GLOBUS_I_XIO_SYSTEM_OP_ACCEPT,
     GLOBUS_I_XIO_SYSTEM_OP_CONNECT,
     GLOBUS_I_XIO_SYSTEM_OP_READ,
-    GLOBUS_I_XIO_SYSTEM_OP_WRITE
+    GLOBUS_I_XIO_SYSTEM_OP_WRITE,
+    GLOBUS_I_XIO_SYSTEM_OP_SENDFILE
 } globus_i_xio_system_op_type_t;
 
 typedef enum
@@ -249,6 +250,11 @@ typedef struct
             int                         iovc;
             globus_sockaddr_t *         addr;
             int                         flags;
+
+            /* sendfile ops only -- iov is sent first, then the file range */
+            globus_xio_system_file_t    file_fd;
+            globus_off_t                file_offset;
+            globus_size_t               iov_bytes;
         } data;
     } sop;
 } globus_i_xio_system_op_info_t;
@@ -361,6 +367,14 @@ globus_i_xio_system_socket_try_write(
     globus_sockaddr_t *                 to,
     globus_size_t *                     nbytes);
 
+globus_result_t
+globus_i_xio_system_socket_try_sendfile(
+    globus_xio_system_socket_t          handle,
+    globus_xio_system_file_t            file_fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       length,
+    globus_size_t *                     nbytes);
+
 int
 globus_i_xio_system_common_activate(void);
 
@@ -250,6 +250,23 @@ globus_xio_system_socket_register_write(
     globus_xio_system_data_callback_t   callback,
     void *                              user_arg);
 
+/* write all of iov, then file_length bytes of file_fd starting at
+ * file_offset, without copying the file data through user space.
+ * callback is not called until everything is sent (or an error occurs).
+ * returns an error immediately if the platform has no sendfile()
+ */
+globus_result_t
+globus_xio_system_socket_register_sendfile(
+    globus_xio_operation_t              op,
+    globus_xio_system_socket_handle_t   handle,
+    const globus_xio_iovec_t *          iov,
+    int                                 iovc,
+    globus_xio_system_file_t            file_fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       file_length,
+    globus_xio_system_data_callback_t   callback,
+    void *                              user_arg);
+
 /* if waitforbytes == 0, do a non-blocking read */
 globus_result_t
 globus_xio_system_socket_read(
@@ -23,6 +23,21 @@
 #include "globus_xio_driver.h"
 #include <stdio.h>
 #include <fcntl.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#include <limits.h>
+#endif
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_LINUX_IO_URING_H) && \
+    defined(HAVE_SYS_EVENTFD_H)
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_NODROP)
+#define GLOBUS_L_XIO_SYSTEM_URING 1
+#endif
+#endif
 
 #ifdef HAVE_SYSCONF
 #define GLOBUS_L_OPEN_MAX sysconf(_SC_OPEN_MAX)
@@ -30,12 +45,24 @@
 #define GLOBUS_L_OPEN_MAX 256
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#define GLOBUS_L_XIO_SYSTEM_EPOLL_MAX_EVENTS 256
+#endif
+
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+#define GLOBUS_L_XIO_SYSTEM_URING_ENTRIES 256
+#endif
+
 typedef struct globus_l_xio_system_s
 {
     globus_xio_system_type_t            type;
     int                                 fd;
     globus_mutex_t                      lock; /* only used to protect below */
     globus_off_t                        file_position;
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+    /* regular file, data ops are submitted to the io_uring */
+    globus_bool_t                       uring;
+#endif
 } globus_l_xio_system_t;
 
 static
@@ -78,6 +105,61 @@ static globus_i_xio_system_op_info_t ** globus_l_xio_system_write_operations;
 static int                              globus_l_xio_system_wakeup_pipe[2];
 static globus_callback_handle_t         globus_l_xio_system_poll_handle;
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * When epoll is available (and not disabled by setting
+ * GLOBUS_XIO_SYSTEM_POLLER=select), the fd_sets above are not used to wait
+ * for events.  The read/write operation tables are still indexed by fd, but
+ * readiness comes from an edge triggered epoll set, so the cost of a wakeup
+ * is proportional to the number of ready fds, not the highest fd.
+ *
+ * Regular files can't be added to an epoll set.  They are always ready, so
+ * they are put on the unpolled lists and handled on the next pass.
+ */
+static globus_bool_t                    globus_l_xio_system_use_epoll;
+static int                              globus_l_xio_system_epoll_fd;
+static struct epoll_event *             globus_l_xio_system_epoll_events;
+static globus_list_t *                  globus_l_xio_system_unpolled_reads;
+static globus_list_t *                  globus_l_xio_system_unpolled_writes;
+#endif
+
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+/*
+ * For regular files readiness is meaningless, waiting for it and then
+ * calling read()/write() just does blocking disk io on the poller thread.
+ * When the kernel supports io_uring, data operations on regular files are
+ * instead submitted as READV/WRITEV at explicit offsets.  Completions are
+ * signaled through an eventfd that sits in the epoll set next to the wakeup
+ * pipe, so they are reaped by the poll callback and kicked out through the
+ * normal oneshot path.  Set GLOBUS_XIO_SYSTEM_URING=0 to disable.
+ *
+ * the submission queue and the count of ops in flight are protected by the
+ * uring lock, the completion queue is only touched by the poll callback
+ * (and by deactivate, once that has stopped).
+ */
+static globus_bool_t                    globus_l_xio_system_use_uring;
+static globus_mutex_t                   globus_l_xio_system_uring_lock;
+static int                              globus_l_xio_system_uring_fd;
+static int                              globus_l_xio_system_uring_eventfd;
+static int                              globus_l_xio_system_uring_unsubmitted;
+static int                              globus_l_xio_system_uring_in_flight;
+static void *                           globus_l_xio_system_uring_sq_ring;
+static void *                           globus_l_xio_system_uring_cq_ring;
+static size_t                           globus_l_xio_system_uring_sq_size;
+static size_t                           globus_l_xio_system_uring_cq_size;
+static struct io_uring_sqe *            globus_l_xio_system_uring_sqes;
+static size_t                           globus_l_xio_system_uring_sqes_size;
+static unsigned *                       globus_l_xio_system_uring_sq_head;
+static unsigned *                       globus_l_xio_system_uring_sq_tail;
+static unsigned *                       globus_l_xio_system_uring_sq_array;
+static unsigned                         globus_l_xio_system_uring_sq_mask;
+static unsigned                         globus_l_xio_system_uring_sq_entries;
+static unsigned *                       globus_l_xio_system_uring_cq_head;
+static unsigned *                       globus_l_xio_system_uring_cq_tail;
+static unsigned                         globus_l_xio_system_uring_cq_mask;
+static struct io_uring_cqe *            globus_l_xio_system_uring_cqes;
+#endif
+
 /* In the pre-activation of the thread module, we
  * are setting up some code to block the SIGPIPE
  * signal. This is necessary because some of
@@ -91,6 +173,63 @@ void
 globus_l_xio_system_poll(
     void *                              user_args);
 
+#ifdef HAVE_SYS_EPOLL_H
+static
+void
+globus_l_xio_system_epoll_poll(
+    void *                              user_args);
+
+static
+globus_bool_t
+globus_l_xio_system_epoll_activate(void);
+
+static
+void
+globus_l_xio_system_epoll_deactivate(void);
+
+static
+globus_result_t
+globus_l_xio_system_epoll_register(
+    int                                 fd,
+    globus_bool_t                       read,
+    globus_bool_t *                     need_wakeup);
+
+static
+void
+globus_l_xio_system_epoll_unregister(
+    int                                 fd);
+#endif
+
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+static
+globus_bool_t
+globus_l_xio_system_uring_activate(void);
+
+static
+void
+globus_l_xio_system_uring_deactivate(void);
+
+static
+globus_bool_t
+globus_l_xio_system_uring_submit(
+    globus_i_xio_system_op_info_t *     op_info);
+
+static
+void
+globus_l_xio_system_uring_cancel_cb(
+    globus_xio_operation_t              op,
+    void *                              user_arg,
+    globus_xio_error_type_t             reason);
+
+static
+globus_bool_t
+globus_l_xio_system_uring_reap(void);
+
+static
+void
+globus_l_xio_system_uring_flush(void);
+#endif
+
 static
 void
 globus_l_xio_system_kickout(
@@ -249,12 +388,26 @@ globus_l_xio_system_activate(void)
     globus_l_xio_system_highest_fd = globus_l_xio_system_wakeup_pipe[0];
     FD_SET(globus_l_xio_system_wakeup_pipe[0], globus_l_xio_system_read_fds);
 
+#ifdef HAVE_SYS_EPOLL_H
+    globus_l_xio_system_use_epoll = globus_l_xio_system_epoll_activate();
+#endif
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+    globus_l_xio_system_use_uring = globus_l_xio_system_use_epoll &&
+        globus_l_xio_system_uring_activate();
+#endif
+
     GlobusTimeReltimeSet(period, 0, 0);
     result = globus_callback_register_periodic(
         &globus_l_xio_system_poll_handle,
          GLOBUS_NULL,
          &period,
+#ifdef HAVE_SYS_EPOLL_H
+         globus_l_xio_system_use_epoll
+            ? globus_l_xio_system_epoll_poll
+            : globus_l_xio_system_poll,
+#else
          globus_l_xio_system_poll,
+#endif
          GLOBUS_NULL);
     if(result != GLOBUS_SUCCESS)
     {
@@ -270,6 +423,12 @@ globus_l_xio_system_activate(void)
     return GLOBUS_SUCCESS;
 
 error_register:
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+    globus_l_xio_system_uring_deactivate();
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+    globus_l_xio_system_epoll_deactivate();
+#endif
     globus_l_xio_system_close(globus_l_xio_system_wakeup_pipe[0]);
     globus_l_xio_system_close(globus_l_xio_system_wakeup_pipe[1]);
 
@@ -341,6 +500,12 @@ globus_l_xio_system_deactivate(void)
     }
     globus_mutex_unlock(&globus_l_xio_system_fdset_mutex);
 
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+    globus_l_xio_system_uring_deactivate();
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+    globus_l_xio_system_epoll_deactivate();
+#endif
     globus_l_xio_system_close(globus_l_xio_system_wakeup_pipe[0]);
     globus_l_xio_system_close(globus_l_xio_system_wakeup_pipe[1]);
 
@@ -386,6 +551,20 @@ globus_l_xio_system_handle_init(
     handle->fd = fd;
     
     handle->file_position = globus_xio_system_file_get_position(fd);
+
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+    handle->uring = GLOBUS_FALSE;
+    if(globus_l_xio_system_use_uring && type == GLOBUS_XIO_SYSTEM_FILE)
+    {
+        struct stat                     stat_buf;
+
+        /* pipes and ttys passed in as files still need readiness */
+        if(fstat(fd, &stat_buf) == 0 && S_ISREG(stat_buf.st_mode))
+        {
+            handle->uring = GLOBUS_TRUE;
+        }
+    }
+#endif
     
     rc = globus_l_xio_system_add_nonblocking(handle);
     if(rc < 0)
@@ -595,6 +774,7 @@ globus_l_xio_system_register_read_fd(
 {
     globus_result_t                     result;
     globus_bool_t                       do_wakeup = GLOBUS_FALSE;
+    globus_bool_t                       need_wakeup = GLOBUS_TRUE;
     GlobusXIOName(globus_l_xio_system_register_read_fd);
 
     GlobusXIOSystemDebugEnterFD(fd);
@@ -642,7 +822,22 @@ globus_l_xio_system_register_read_fd(
         FD_SET(fd, globus_l_xio_system_read_fds);
         globus_l_xio_system_read_operations[fd] = read_info;
 
-        if(globus_l_xio_system_select_active &&
+#ifdef HAVE_SYS_EPOLL_H
+        if(globus_l_xio_system_use_epoll)
+        {
+            result = globus_l_xio_system_epoll_register(
+                fd, GLOBUS_TRUE, &need_wakeup);
+            if(result != GLOBUS_SUCCESS)
+            {
+                FD_CLR(fd, globus_l_xio_system_read_fds);
+                globus_l_xio_system_read_operations[fd] = GLOBUS_NULL;
+                goto error_epoll;
+            }
+        }
+#endif
+
+        if(need_wakeup &&
+            globus_l_xio_system_select_active &&
             !globus_l_xio_system_wakeup_pending)
         {
             globus_l_xio_system_wakeup_pending = GLOBUS_TRUE;
@@ -665,6 +860,9 @@ globus_l_xio_system_register_read_fd(
     GlobusXIOSystemDebugExitFD(fd);
     return GLOBUS_SUCCESS;
 
+#ifdef HAVE_SYS_EPOLL_H
+error_epoll:
+#endif
 error_already_registered:
 error_too_many_fds:
 error_deactivated:
@@ -686,6 +884,7 @@ globus_l_xio_system_register_write_fd(
 {
     globus_result_t                     result;
     globus_bool_t                       do_wakeup = GLOBUS_FALSE;
+    globus_bool_t                       need_wakeup = GLOBUS_TRUE;
     GlobusXIOName(globus_l_xio_system_register_write_fd);
 
     GlobusXIOSystemDebugEnterFD(fd);
@@ -733,7 +932,22 @@ globus_l_xio_system_register_write_fd(
         FD_SET(fd, globus_l_xio_system_write_fds);
         globus_l_xio_system_write_operations[fd] = write_info;
 
-        if(globus_l_xio_system_select_active &&
+#ifdef HAVE_SYS_EPOLL_H
+        if(globus_l_xio_system_use_epoll)
+        {
+            result = globus_l_xio_system_epoll_register(
+                fd, GLOBUS_FALSE, &need_wakeup);
+            if(result != GLOBUS_SUCCESS)
+            {
+                FD_CLR(fd, globus_l_xio_system_write_fds);
+                globus_l_xio_system_write_operations[fd] = GLOBUS_NULL;
+                goto error_epoll;
+            }
+        }
+#endif
+
+        if(need_wakeup &&
+            globus_l_xio_system_select_active &&
             !globus_l_xio_system_wakeup_pending)
         {
             globus_l_xio_system_wakeup_pending = GLOBUS_TRUE;
@@ -756,6 +970,9 @@ globus_l_xio_system_register_write_fd(
     GlobusXIOSystemDebugExitFD(fd);
     return GLOBUS_SUCCESS;
 
+#ifdef HAVE_SYS_EPOLL_H
+error_epoll:
+#endif
 error_already_registered:
 error_too_many_fds:
 error_deactivated:
@@ -783,6 +1000,13 @@ globus_l_xio_system_unregister_read(
     FD_CLR(fd, globus_l_xio_system_read_fds);
     globus_l_xio_system_read_operations[fd] = GLOBUS_NULL;
 
+#ifdef HAVE_SYS_EPOLL_H
+    if(globus_l_xio_system_use_epoll)
+    {
+        globus_l_xio_system_epoll_unregister(fd);
+    }
+#endif
+
     GlobusXIOSystemDebugExitFD(fd);
 }
 
@@ -800,6 +1024,13 @@ globus_l_xio_system_unregister_write(
     FD_CLR(fd, globus_l_xio_system_write_fds);
     globus_l_xio_system_write_operations[fd] = GLOBUS_NULL;
 
+#ifdef HAVE_SYS_EPOLL_H
+    if(globus_l_xio_system_use_epoll)
+    {
+        globus_l_xio_system_epoll_unregister(fd);
+    }
+#endif
+
     GlobusXIOSystemDebugExitFD(fd);
 }
 
@@ -1128,6 +1359,45 @@ globus_l_xio_system_handle_write(
         }
         break;
 
+      case GLOBUS_I_XIO_SYSTEM_OP_SENDFILE:
+        /* drain the leading iovec (usually a protocol header) first */
+        if(write_info->nbytes < write_info->sop.data.iov_bytes)
+        {
+            result = globus_l_xio_system_try_write(
+                write_info->handle,
+                -1,
+                write_info->sop.data.iov,
+                write_info->sop.data.iovc,
+                write_info->sop.data.flags,
+                GLOBUS_NULL,
+                &nbytes);
+            if(result == GLOBUS_SUCCESS)
+            {
+                write_info->nbytes += nbytes;
+                GlobusIXIOUtilAdjustIovec(
+                    write_info->sop.data.iov,
+                    write_info->sop.data.iovc,
+                    nbytes);
+            }
+        }
+        if(result == GLOBUS_SUCCESS &&
+            write_info->nbytes >= write_info->sop.data.iov_bytes &&
+            write_info->nbytes < write_info->waitforbytes)
+        {
+            result = globus_i_xio_system_socket_try_sendfile(
+                fd,
+                write_info->sop.data.file_fd,
+                write_info->sop.data.file_offset +
+                    (write_info->nbytes - write_info->sop.data.iov_bytes),
+                write_info->waitforbytes - write_info->nbytes,
+                &nbytes);
+            if(result == GLOBUS_SUCCESS)
+            {
+                write_info->nbytes += nbytes;
+            }
+        }
+        break;
+
       default:
         globus_assert(0 && "Unexpected type for write operation");
         return GLOBUS_FALSE;
@@ -1422,160 +1692,1250 @@ globus_l_xio_system_poll(
     GlobusXIOSystemDebugExit();
 }
 
-globus_result_t
-globus_xio_system_socket_register_connect(
-    globus_xio_operation_t              op,
-    globus_xio_system_socket_handle_t   handle,
-    globus_sockaddr_t *                 addr,
-    globus_xio_system_callback_t        callback,
-    void *                              user_arg)
+#ifdef HAVE_SYS_EPOLL_H
+static
+globus_bool_t
+globus_l_xio_system_epoll_activate(void)
 {
-    globus_bool_t                       done;
-    globus_result_t                     result;
-    globus_i_xio_system_op_info_t *     op_info;
-    int                                 fd = handle->fd;
-    GlobusXIOName(globus_xio_system_socket_register_connect);
+    char *                              poller;
+    struct epoll_event                  event;
+    GlobusXIOName(globus_l_xio_system_epoll_activate);
 
-    GlobusXIOSystemDebugEnterFD(fd);
+    GlobusXIOSystemDebugEnter();
 
-    done = GLOBUS_FALSE;
-    while(!done && connect(
-        fd, (const struct sockaddr *) addr, GlobusLibcSockaddrLen(addr)) < 0)
+    poller = globus_module_getenv("GLOBUS_XIO_SYSTEM_POLLER");
+    if(poller && strcmp(poller, "select") == 0)
     {
-        GlobusXIOSystemUpdateErrno();
-        switch(errno)
-        {
-          case EINPROGRESS:
-            done = GLOBUS_TRUE;
-            break;
-
-          case EINTR:
-            /* retry */
-            break;
+        goto error_disabled;
+    }
 
-          case ETIMEDOUT: /* this was in globus io.. not sure why */
-            globus_thread_yield();
-            break;
+    globus_l_xio_system_epoll_fd =
+        epoll_create(GLOBUS_L_XIO_SYSTEM_EPOLL_MAX_EVENTS);
+    if(globus_l_xio_system_epoll_fd < 0)
+    {
+        goto error_create;
+    }
+    fcntl(globus_l_xio_system_epoll_fd, F_SETFD, FD_CLOEXEC);
 
-          default:
-            result = GlobusXIOErrorSystemError("connect", errno);
-            goto error_connect;
-        }
+    globus_l_xio_system_epoll_events = (struct epoll_event *)
+        globus_calloc(
+            GLOBUS_L_XIO_SYSTEM_EPOLL_MAX_EVENTS, sizeof(struct epoll_event));
+    if(!globus_l_xio_system_epoll_events)
+    {
+        goto error_events;
     }
 
-    GlobusIXIOSystemAllocOperation(op_info);
-    if(!op_info)
+    /* the wakeup pipe stays level triggered, a single read may not drain it */
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = globus_l_xio_system_wakeup_pipe[0];
+    if(epoll_ctl(
+        globus_l_xio_system_epoll_fd,
+        EPOLL_CTL_ADD,
+        globus_l_xio_system_wakeup_pipe[0],
+        &event) < 0)
     {
-        result = GlobusXIOErrorMemory("op_info");
-        goto error_op_info;
+        goto error_ctl;
     }
 
-    op_info->type = GLOBUS_I_XIO_SYSTEM_OP_CONNECT;
-    op_info->state = GLOBUS_I_XIO_SYSTEM_OP_NEW;
-    op_info->op = op;
-    op_info->handle = handle;
-    op_info->user_arg = user_arg;
-    op_info->sop.non_data.callback = callback;
+    globus_l_xio_system_unpolled_reads = GLOBUS_NULL;
+    globus_l_xio_system_unpolled_writes = GLOBUS_NULL;
 
-    result = globus_l_xio_system_register_write_fd(fd, op_info);
+    GlobusXIOSystemDebugPrintf(
+        GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+        (_XIOSL("[%s] Using epoll, fd=%d\n"),
+            _xio_name, globus_l_xio_system_epoll_fd));
 
-    if(result != GLOBUS_SUCCESS)
-    {
-        result = GlobusXIOErrorWrapFailed(
-            _XIOSL("globus_l_xio_system_register_write_fd"), result);
-        goto error_register;
+    GlobusXIOSystemDebugExit();
+    return GLOBUS_TRUE;
 
-    }
-    
-    /* handle could be destroyed by time we get here - no touch! */
-    GlobusXIOSystemDebugExitFD(fd);
-    return GLOBUS_SUCCESS;
+error_ctl:
+    globus_free(globus_l_xio_system_epoll_events);
 
-error_register:
-    GlobusIXIOSystemFreeOperation(op_info);
+error_events:
+    globus_l_xio_system_close(globus_l_xio_system_epoll_fd);
 
-error_op_info:
-error_connect:
-    GlobusXIOSystemDebugExitWithErrorFD(fd);
-    return result;
+error_create:
+error_disabled:
+    GlobusXIOSystemDebugPrintf(
+        GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+        (_XIOSL("[%s] Using select\n"), _xio_name));
+
+    GlobusXIOSystemDebugExit();
+    return GLOBUS_FALSE;
 }
 
-globus_result_t
-globus_xio_system_socket_register_accept(
-    globus_xio_operation_t              op,
-    globus_xio_system_socket_handle_t   listener_handle,
-    globus_xio_system_socket_t *        out_fd,
-    globus_xio_system_callback_t        callback,
-    void *                              user_arg)
+static
+void
+globus_l_xio_system_epoll_deactivate(void)
 {
-    globus_result_t                     result;
-    globus_i_xio_system_op_info_t *     op_info;
-    int                                 fd = listener_handle->fd;
-    GlobusXIOName(globus_xio_system_socket_register_accept);
+    GlobusXIOName(globus_l_xio_system_epoll_deactivate);
 
-    GlobusXIOSystemDebugEnterFD(fd);
-    
-    GlobusIXIOSystemAllocOperation(op_info);
-    if(!op_info)
+    GlobusXIOSystemDebugEnter();
+
+    if(globus_l_xio_system_use_epoll)
     {
-        result = GlobusXIOErrorMemory("op_info");
-        goto error_op_info;
+        globus_l_xio_system_close(globus_l_xio_system_epoll_fd);
+        globus_free(globus_l_xio_system_epoll_events);
+        globus_list_free(globus_l_xio_system_unpolled_reads);
+        globus_list_free(globus_l_xio_system_unpolled_writes);
+        globus_l_xio_system_use_epoll = GLOBUS_FALSE;
     }
 
-    op_info->type = GLOBUS_I_XIO_SYSTEM_OP_ACCEPT;
-    op_info->state = GLOBUS_I_XIO_SYSTEM_OP_NEW;
-    op_info->op = op;
-    op_info->handle = listener_handle;
-    op_info->user_arg = user_arg;
-    op_info->sop.non_data.callback = callback;
-    op_info->sop.non_data.out_fd = out_fd;
-    op_info->waitforbytes = 1;
+    GlobusXIOSystemDebugExit();
+}
 
-    result = globus_l_xio_system_register_read_fd(fd, op_info);
+/*
+ * set the interest mask for fd to match the registered operations.  fds are
+ * left in the epoll set with an empty mask when idle, the kernel drops them
+ * when they are closed.  modifying the mask also re-evaluates readiness, so
+ * an fd that became ready before an operation was registered still gets an
+ * edge.
+ *
+ * called locked, returns 0 or an errno
+ */
+static
+int
+globus_l_xio_system_epoll_ctl(
+    int                                 fd)
+{
+    struct epoll_event                  event;
+    int                                 rc;
 
-    if(result != GLOBUS_SUCCESS)
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLET;
+    event.data.fd = fd;
+    if(globus_l_xio_system_read_operations[fd])
     {
-        result = GlobusXIOErrorWrapFailed(
-            _XIOSL("globus_l_xio_system_register_read_fd"), result);
-        goto error_register;
+        event.events |= EPOLLIN;
+    }
+    if(globus_l_xio_system_write_operations[fd])
+    {
+        event.events |= EPOLLOUT;
     }
-    
-    /* handle could be destroyed by time we get here - no touch! */
-    GlobusXIOSystemDebugExitFD(fd);
-    return GLOBUS_SUCCESS;
 
-error_register:
-    GlobusIXIOSystemFreeOperation(op_info);
+    rc = epoll_ctl(globus_l_xio_system_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    if(rc < 0 && errno == ENOENT)
+    {
+        rc = epoll_ctl(
+            globus_l_xio_system_epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
 
-error_op_info:
-    GlobusXIOSystemDebugExitWithErrorFD(fd);
-    return result;
+    return rc < 0 ? errno : 0;
 }
 
+/* called locked */
 static
 globus_result_t
-globus_l_xio_system_register_read(
-    globus_xio_operation_t              op,
-    globus_l_xio_system_t *             handle,
-    globus_off_t                        offset,
-    const globus_xio_iovec_t *          u_iov,
-    int                                 u_iovc,
-    globus_size_t                       waitforbytes,
-    int                                 flags,
-    globus_sockaddr_t *                 from,
-    globus_xio_system_data_callback_t   callback,
-    void *                              user_arg)
+globus_l_xio_system_epoll_register(
+    int                                 fd,
+    globus_bool_t                       read,
+    globus_bool_t *                     need_wakeup)
 {
+    int                                 err;
     globus_result_t                     result;
-    globus_i_xio_system_op_info_t *     op_info;
-    struct iovec *                      iov;
-    int                                 fd = handle->fd;
-    GlobusXIOName(globus_l_xio_system_register_read);
+    GlobusXIOName(globus_l_xio_system_epoll_register);
 
     GlobusXIOSystemDebugEnterFD(fd);
-    GlobusXIOSystemDebugPrintf(
-        GLOBUS_I_XIO_SYSTEM_DEBUG_DATA,
-        (_XIOSL("[%s] Waiting for %u bytes\n"), _xio_name, (unsigned) waitforbytes));
+
+    /* epoll_wait picks up the new mask on its own, no wakeup required */
+    *need_wakeup = GLOBUS_FALSE;
+
+    err = globus_l_xio_system_epoll_ctl(fd);
+    if(err == EPERM)
+    {
+        /* regular file, always ready */
+        globus_list_insert(
+            read
+                ? &globus_l_xio_system_unpolled_reads
+                : &globus_l_xio_system_unpolled_writes,
+            (void *) (intptr_t) fd);
+        *need_wakeup = GLOBUS_TRUE;
+    }
+    else if(err != 0)
+    {
+        result = GlobusXIOErrorSystemError("epoll_ctl", err);
+        goto error_ctl;
+    }
+
+    GlobusXIOSystemDebugExitFD(fd);
+    return GLOBUS_SUCCESS;
+
+error_ctl:
+    GlobusXIOSystemDebugExitWithErrorFD(fd);
+    return result;
+}
+
+/* called locked */
+static
+void
+globus_l_xio_system_epoll_unregister(
+    int                                 fd)
+{
+    GlobusXIOName(globus_l_xio_system_epoll_unregister);
+
+    GlobusXIOSystemDebugEnterFD(fd);
+
+    /* errors here just mean the fd is closed or a regular file */
+    globus_l_xio_system_epoll_ctl(fd);
+
+    GlobusXIOSystemDebugExitFD(fd);
+}
+
+/*
+ * an edge was consumed but the operation is still pending (short read,
+ * aborted accept, etc).  modify the mask to have the kernel recheck
+ * readiness, otherwise we could wait forever for an edge that already
+ * happened.
+ */
+static
+void
+globus_l_xio_system_epoll_rearm(
+    int                                 fd)
+{
+    globus_mutex_lock(&globus_l_xio_system_fdset_mutex);
+    {
+        if(globus_l_xio_system_read_operations[fd] ||
+            globus_l_xio_system_write_operations[fd])
+        {
+            globus_l_xio_system_epoll_ctl(fd);
+        }
+    }
+    globus_mutex_unlock(&globus_l_xio_system_fdset_mutex);
+}
+
+/*
+ * same contract as globus_l_xio_system_poll(), cancels are pended on the
+ * canceled lists while we're in epoll_wait and handled after it returns
+ */
+static
+void
+globus_l_xio_system_epoll_poll(
+    void *                              user_args)
+{
+    globus_bool_t                       time_left_is_zero;
+    globus_bool_t                       handled_something;
+    GlobusXIOName(globus_l_xio_system_epoll_poll);
+
+    GlobusXIOSystemDebugEnter();
+
+    handled_something = GLOBUS_FALSE;
+
+    do
+    {
+        globus_reltime_t                time_left;
+        globus_list_t *                 unpolled_reads;
+        globus_list_t *                 unpolled_writes;
+        struct epoll_event *            event;
+        int                             timeout;
+        int                             nready;
+        int                             fd;
+        int                             i;
+        int                             save_errno;
+
+        time_left_is_zero = GLOBUS_FALSE;
+
+        globus_callback_get_timeout(&time_left);
+
+        if(globus_reltime_cmp(&time_left, &globus_i_reltime_zero) == 0)
+        {
+            time_left_is_zero = GLOBUS_TRUE;
+            timeout = 0;
+        }
+        else if(globus_time_reltime_is_infinity(&time_left) ||
+            time_left.tv_sec >= INT_MAX / 1000 - 1)
+        {
+            timeout = -1;
+        }
+        else
+        {
+            timeout = time_left.tv_sec * 1000 +
+                (time_left.tv_usec + 999) / 1000;
+        }
+
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+        if(globus_l_xio_system_use_uring &&
+            globus_l_xio_system_uring_unsubmitted > 0)
+        {
+            globus_mutex_lock(&globus_l_xio_system_uring_lock);
+            {
+                globus_l_xio_system_uring_flush();
+            }
+            globus_mutex_unlock(&globus_l_xio_system_uring_lock);
+        }
+#endif
+
+        globus_mutex_lock(&globus_l_xio_system_fdset_mutex);
+        {
+            unpolled_reads = globus_l_xio_system_unpolled_reads;
+            unpolled_writes = globus_l_xio_system_unpolled_writes;
+            globus_l_xio_system_unpolled_reads = GLOBUS_NULL;
+            globus_l_xio_system_unpolled_writes = GLOBUS_NULL;
+            if(unpolled_reads || unpolled_writes)
+            {
+                timeout = 0;
+            }
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+            /* the kernel refused some sqes, retry them soon */
+            if(globus_l_xio_system_use_uring &&
+                globus_l_xio_system_uring_unsubmitted > 0 &&
+                (timeout < 0 || timeout > 1))
+            {
+                timeout = 1;
+            }
+#endif
+
+            globus_l_xio_system_select_active = GLOBUS_TRUE;
+        }
+        globus_mutex_unlock(&globus_l_xio_system_fdset_mutex);
+
+        GlobusXIOSystemDebugPrintf(
+            GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+            (_XIOSL("[%s] Before epoll_wait\n"), _xio_name));
+
+        nready = epoll_wait(
+            globus_l_xio_system_epoll_fd,
+            globus_l_xio_system_epoll_events,
+            GLOBUS_L_XIO_SYSTEM_EPOLL_MAX_EVENTS,
+            timeout);
+
+        GlobusXIOSystemUpdateErrno();
+        save_errno = errno;
+
+        GlobusXIOSystemDebugPrintf(
+            GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+            (_XIOSL("[%s] After epoll_wait, nready=%d\n"),
+                _xio_name, nready));
+
+        globus_mutex_lock(&globus_l_xio_system_cancel_mutex);
+        {
+            globus_l_xio_system_select_active = GLOBUS_FALSE;
+
+            if(nready == 0 && !unpolled_reads && !unpolled_writes)
+            {
+                time_left_is_zero = GLOBUS_TRUE;
+            }
+            else if(nready < 0)
+            {
+                /* EINTR, or nothing we can do about it */
+                GlobusXIOSystemDebugPrintf(
+                    GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+                    (_XIOSL("[%s] epoll_wait failed, errno=%d\n"),
+                        _xio_name, save_errno));
+                nready = 0;
+            }
+
+            for(i = 0; i < nready; i++)
+            {
+                event = &globus_l_xio_system_epoll_events[i];
+                fd = event->data.fd;
+
+                if(fd == globus_l_xio_system_wakeup_pipe[0])
+                {
+                    globus_l_xio_system_handle_wakeup();
+                    globus_l_xio_system_wakeup_pending = GLOBUS_FALSE;
+                    continue;
+                }
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+                if(globus_l_xio_system_use_uring &&
+                    fd == globus_l_xio_system_uring_eventfd)
+                {
+                    if(globus_l_xio_system_uring_reap())
+                    {
+                        handled_something = GLOBUS_TRUE;
+                    }
+                    continue;
+                }
+#endif
+
+                if((event->events & (EPOLLIN | EPOLLERR | EPOLLHUP)) &&
+                    globus_l_xio_system_read_operations[fd])
+                {
+                    if(globus_l_xio_system_handle_read(fd))
+                    {
+                        handled_something = GLOBUS_TRUE;
+                    }
+                    else
+                    {
+                        globus_l_xio_system_epoll_rearm(fd);
+                    }
+                }
+
+                if((event->events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) &&
+                    globus_l_xio_system_write_operations[fd])
+                {
+                    if(globus_l_xio_system_handle_write(fd))
+                    {
+                        handled_something = GLOBUS_TRUE;
+                    }
+                    else
+                    {
+                        globus_l_xio_system_epoll_rearm(fd);
+                    }
+                }
+            }
+
+            while(!globus_list_empty(unpolled_reads))
+            {
+                fd = (int) (intptr_t) globus_list_remove(
+                    &unpolled_reads, unpolled_reads);
+
+                if(!globus_l_xio_system_read_operations[fd])
+                {
+                    continue;
+                }
+
+                if(globus_l_xio_system_handle_read(fd))
+                {
+                    handled_something = GLOBUS_TRUE;
+                }
+                else
+                {
+                    globus_mutex_lock(&globus_l_xio_system_fdset_mutex);
+                    globus_list_insert(
+                        &globus_l_xio_system_unpolled_reads,
+                        (void *) (intptr_t) fd);
+                    globus_mutex_unlock(&globus_l_xio_system_fdset_mutex);
+                }
+            }
+
+            while(!globus_list_empty(unpolled_writes))
+            {
+                fd = (int) (intptr_t) globus_list_remove(
+                    &unpolled_writes, unpolled_writes);
+
+                if(!globus_l_xio_system_write_operations[fd])
+                {
+                    continue;
+                }
+
+                if(globus_l_xio_system_handle_write(fd))
+                {
+                    handled_something = GLOBUS_TRUE;
+                }
+                else
+                {
+                    globus_mutex_lock(&globus_l_xio_system_fdset_mutex);
+                    globus_list_insert(
+                        &globus_l_xio_system_unpolled_writes,
+                        (void *) (intptr_t) fd);
+                    globus_mutex_unlock(&globus_l_xio_system_fdset_mutex);
+                }
+            }
+
+            while(!globus_list_empty(globus_l_xio_system_canceled_reads))
+            {
+                fd = (int) (intptr_t) globus_list_remove(
+                    &globus_l_xio_system_canceled_reads,
+                    globus_l_xio_system_canceled_reads);
+
+                GlobusXIOSystemDebugPrintf(
+                    GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+                    (_XIOSL("[%s] fd=%d, Handling canceled read\n"),
+                        _xio_name, fd));
+
+                /* may have been completed by an event above */
+                if(globus_l_xio_system_read_operations[fd] &&
+                    globus_l_xio_system_handle_read(fd))
+                {
+                    handled_something = GLOBUS_TRUE;
+                }
+            }
+
+            while(!globus_list_empty(globus_l_xio_system_canceled_writes))
+            {
+                fd = (int) (intptr_t) globus_list_remove(
+                    &globus_l_xio_system_canceled_writes,
+                    globus_l_xio_system_canceled_writes);
+
+                GlobusXIOSystemDebugPrintf(
+                    GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+                    (_XIOSL("[%s] fd=%d, Handling canceled write\n"),
+                        _xio_name, fd));
+
+                if(globus_l_xio_system_write_operations[fd] &&
+                    globus_l_xio_system_handle_write(fd))
+                {
+                    handled_something = GLOBUS_TRUE;
+                }
+            }
+        }
+        globus_mutex_unlock(&globus_l_xio_system_cancel_mutex);
+
+    } while(!handled_something &&
+        !time_left_is_zero &&
+        !globus_l_xio_system_shutdown_called);
+
+    GlobusXIOSystemDebugExit();
+}
+#endif
+
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+static
+globus_bool_t
+globus_l_xio_system_uring_activate(void)
+{
+    char *                              tmp_string;
+    struct io_uring_params              params;
+    struct epoll_event                  event;
+    char *                              ring;
+    GlobusXIOName(globus_l_xio_system_uring_activate);
+
+    GlobusXIOSystemDebugEnter();
+
+    tmp_string = globus_module_getenv("GLOBUS_XIO_SYSTEM_URING");
+    if(tmp_string && strcmp(tmp_string, "0") == 0)
+    {
+        goto error_disabled;
+    }
+
+    memset(&params, 0, sizeof(params));
+    globus_l_xio_system_uring_fd = syscall(
+        __NR_io_uring_setup, GLOBUS_L_XIO_SYSTEM_URING_ENTRIES, &params);
+    if(globus_l_xio_system_uring_fd < 0)
+    {
+        goto error_setup;
+    }
+    /* without NODROP completions could be lost when the cq overflows */
+    if(!(params.features & IORING_FEAT_NODROP))
+    {
+        goto error_features;
+    }
+
+    globus_l_xio_system_uring_sq_size =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    globus_l_xio_system_uring_cq_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(globus_l_xio_system_uring_cq_size >
+            globus_l_xio_system_uring_sq_size)
+        {
+            globus_l_xio_system_uring_sq_size =
+                globus_l_xio_system_uring_cq_size;
+        }
+        globus_l_xio_system_uring_cq_size = globus_l_xio_system_uring_sq_size;
+    }
+
+    globus_l_xio_system_uring_sq_ring = mmap(
+        NULL,
+        globus_l_xio_system_uring_sq_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        globus_l_xio_system_uring_fd,
+        IORING_OFF_SQ_RING);
+    if(globus_l_xio_system_uring_sq_ring == MAP_FAILED)
+    {
+        goto error_sq_ring;
+    }
+
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        globus_l_xio_system_uring_cq_ring = globus_l_xio_system_uring_sq_ring;
+    }
+    else
+    {
+        globus_l_xio_system_uring_cq_ring = mmap(
+            NULL,
+            globus_l_xio_system_uring_cq_size,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            globus_l_xio_system_uring_fd,
+            IORING_OFF_CQ_RING);
+        if(globus_l_xio_system_uring_cq_ring == MAP_FAILED)
+        {
+            goto error_cq_ring;
+        }
+    }
+
+    globus_l_xio_system_uring_sqes_size =
+        params.sq_entries * sizeof(struct io_uring_sqe);
+    globus_l_xio_system_uring_sqes = mmap(
+        NULL,
+        globus_l_xio_system_uring_sqes_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        globus_l_xio_system_uring_fd,
+        IORING_OFF_SQES);
+    if(globus_l_xio_system_uring_sqes == MAP_FAILED)
+    {
+        goto error_sqes;
+    }
+
+    ring = globus_l_xio_system_uring_sq_ring;
+    globus_l_xio_system_uring_sq_head =
+        (unsigned *) (ring + params.sq_off.head);
+    globus_l_xio_system_uring_sq_tail =
+        (unsigned *) (ring + params.sq_off.tail);
+    globus_l_xio_system_uring_sq_array =
+        (unsigned *) (ring + params.sq_off.array);
+    globus_l_xio_system_uring_sq_mask =
+        *(unsigned *) (ring + params.sq_off.ring_mask);
+    globus_l_xio_system_uring_sq_entries = params.sq_entries;
+
+    ring = globus_l_xio_system_uring_cq_ring;
+    globus_l_xio_system_uring_cq_head =
+        (unsigned *) (ring + params.cq_off.head);
+    globus_l_xio_system_uring_cq_tail =
+        (unsigned *) (ring + params.cq_off.tail);
+    globus_l_xio_system_uring_cq_mask =
+        *(unsigned *) (ring + params.cq_off.ring_mask);
+    globus_l_xio_system_uring_cqes =
+        (struct io_uring_cqe *) (ring + params.cq_off.cqes);
+
+    globus_l_xio_system_uring_eventfd =
+        eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(globus_l_xio_system_uring_eventfd < 0)
+    {
+        goto error_eventfd;
+    }
+
+    if(syscall(
+        __NR_io_uring_register,
+        globus_l_xio_system_uring_fd,
+        IORING_REGISTER_EVENTFD,
+        &globus_l_xio_system_uring_eventfd,
+        1) < 0)
+    {
+        goto error_register;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = globus_l_xio_system_uring_eventfd;
+    if(epoll_ctl(
+        globus_l_xio_system_epoll_fd,
+        EPOLL_CTL_ADD,
+        globus_l_xio_system_uring_eventfd,
+        &event) < 0)
+    {
+        goto error_ctl;
+    }
+
+    globus_mutex_init(&globus_l_xio_system_uring_lock, NULL);
+    globus_l_xio_system_uring_unsubmitted = 0;
+    globus_l_xio_system_uring_in_flight = 0;
+
+    GlobusXIOSystemDebugPrintf(
+        GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+        (_XIOSL("[%s] Using io_uring for file io, fd=%d, entries=%u\n"),
+            _xio_name,
+            globus_l_xio_system_uring_fd,
+            globus_l_xio_system_uring_sq_entries));
+
+    GlobusXIOSystemDebugExit();
+    return GLOBUS_TRUE;
+
+error_ctl:
+error_register:
+    globus_l_xio_system_close(globus_l_xio_system_uring_eventfd);
+
+error_eventfd:
+    munmap(
+        globus_l_xio_system_uring_sqes, globus_l_xio_system_uring_sqes_size);
+
+error_sqes:
+    if(globus_l_xio_system_uring_cq_ring != globus_l_xio_system_uring_sq_ring)
+    {
+        munmap(
+            globus_l_xio_system_uring_cq_ring,
+            globus_l_xio_system_uring_cq_size);
+    }
+
+error_cq_ring:
+    munmap(
+        globus_l_xio_system_uring_sq_ring, globus_l_xio_system_uring_sq_size);
+
+error_sq_ring:
+error_features:
+    globus_l_xio_system_close(globus_l_xio_system_uring_fd);
+
+error_setup:
+error_disabled:
+    GlobusXIOSystemDebugExit();
+    return GLOBUS_FALSE;
+}
+
+/*
+ * the poller has stopped, so nothing reaps the cq any more.  wait for the
+ * kernel to finish every op still in flight, so none of them writes to a
+ * buffer or touches the rings after they are gone, and free their op_infos.
+ * like ops left in the select fd sets, they are not called back
+ */
+static
+void
+globus_l_xio_system_uring_drain(void)
+{
+    struct io_uring_cqe *               cqe;
+    globus_i_xio_system_op_info_t *     op_info;
+    unsigned                            head;
+    unsigned                            tail;
+    int                                 rc;
+    GlobusXIOName(globus_l_xio_system_uring_drain);
+
+    GlobusXIOSystemDebugEnter();
+
+    globus_mutex_lock(&globus_l_xio_system_uring_lock);
+    while(globus_l_xio_system_uring_in_flight > 0)
+    {
+        head = *globus_l_xio_system_uring_cq_head;
+        tail = __atomic_load_n(
+            globus_l_xio_system_uring_cq_tail, __ATOMIC_ACQUIRE);
+        if(head == tail)
+        {
+            globus_l_xio_system_uring_flush();
+            rc = syscall(
+                __NR_io_uring_enter,
+                globus_l_xio_system_uring_fd,
+                0,
+                1,
+                IORING_ENTER_GETEVENTS,
+                NULL,
+                0);
+            if(rc < 0 && errno != EINTR)
+            {
+                GlobusXIOSystemDebugPrintf(
+                    GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+                    (_XIOSL("[%s] io_uring_enter failed, %d ops left\n"),
+                        _xio_name, globus_l_xio_system_uring_in_flight));
+                break;
+            }
+            continue;
+        }
+
+        cqe = &globus_l_xio_system_uring_cqes[
+            head & globus_l_xio_system_uring_cq_mask];
+        op_info = (globus_i_xio_system_op_info_t *) (uintptr_t) cqe->user_data;
+        __atomic_store_n(
+            globus_l_xio_system_uring_cq_head, head + 1, __ATOMIC_RELEASE);
+
+        if(op_info != NULL)
+        {
+            globus_l_xio_system_uring_in_flight--;
+            if(op_info->error)
+            {
+                globus_object_free(op_info->error);
+            }
+            GlobusIXIOSystemFreeIovec(
+                op_info->sop.data.start_iovc,
+                op_info->sop.data.start_iov);
+            GlobusIXIOSystemFreeOperation(op_info);
+        }
+    }
+    globus_mutex_unlock(&globus_l_xio_system_uring_lock);
+
+    GlobusXIOSystemDebugExit();
+}
+
+static
+void
+globus_l_xio_system_uring_deactivate(void)
+{
+    GlobusXIOName(globus_l_xio_system_uring_deactivate);
+
+    GlobusXIOSystemDebugEnter();
+
+    if(globus_l_xio_system_use_uring)
+    {
+        globus_l_xio_system_uring_drain();
+        globus_l_xio_system_close(globus_l_xio_system_uring_eventfd);
+        munmap(
+            globus_l_xio_system_uring_sqes,
+            globus_l_xio_system_uring_sqes_size);
+        if(globus_l_xio_system_uring_cq_ring !=
+            globus_l_xio_system_uring_sq_ring)
+        {
+            munmap(
+                globus_l_xio_system_uring_cq_ring,
+                globus_l_xio_system_uring_cq_size);
+        }
+        munmap(
+            globus_l_xio_system_uring_sq_ring,
+            globus_l_xio_system_uring_sq_size);
+        globus_l_xio_system_close(globus_l_xio_system_uring_fd);
+        globus_mutex_destroy(&globus_l_xio_system_uring_lock);
+        globus_l_xio_system_use_uring = GLOBUS_FALSE;
+    }
+
+    GlobusXIOSystemDebugExit();
+}
+
+/*
+ * hand everything queued in the sq to the kernel.  anything the kernel
+ * didn't take (EBUSY, EAGAIN) stays in the ring and is picked up by the next
+ * call.  called with the uring lock held
+ */
+static
+void
+globus_l_xio_system_uring_flush(void)
+{
+    int                                 rc;
+
+    while(globus_l_xio_system_uring_unsubmitted > 0)
+    {
+        rc = syscall(
+            __NR_io_uring_enter,
+            globus_l_xio_system_uring_fd,
+            globus_l_xio_system_uring_unsubmitted,
+            0,
+            0,
+            NULL,
+            0);
+        if(rc < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(rc <= 0)
+        {
+            break;
+        }
+        globus_l_xio_system_uring_unsubmitted -= rc;
+    }
+}
+
+/*
+ * the next free sqe, cleared, or NULL if the sq is full.  it is handed to
+ * the kernel with globus_l_xio_system_uring_push().  called with the uring
+ * lock held
+ */
+static
+struct io_uring_sqe *
+globus_l_xio_system_uring_get_sqe(void)
+{
+    struct io_uring_sqe *               sqe;
+    unsigned                            head;
+    unsigned                            tail;
+
+    tail = *globus_l_xio_system_uring_sq_tail;
+    head = __atomic_load_n(
+        globus_l_xio_system_uring_sq_head, __ATOMIC_ACQUIRE);
+    if(tail - head >= globus_l_xio_system_uring_sq_entries)
+    {
+        return NULL;
+    }
+
+    sqe = &globus_l_xio_system_uring_sqes[
+        tail & globus_l_xio_system_uring_sq_mask];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+/* called with the uring lock held */
+static
+void
+globus_l_xio_system_uring_push(void)
+{
+    unsigned                            tail;
+    unsigned                            index;
+
+    tail = *globus_l_xio_system_uring_sq_tail;
+    index = tail & globus_l_xio_system_uring_sq_mask;
+    globus_l_xio_system_uring_sq_array[index] = index;
+    __atomic_store_n(
+        globus_l_xio_system_uring_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    globus_l_xio_system_uring_unsubmitted++;
+}
+
+/* returns false if the sq is full */
+static
+globus_bool_t
+globus_l_xio_system_uring_submit(
+    globus_i_xio_system_op_info_t *     op_info)
+{
+    struct io_uring_sqe *               sqe;
+    globus_bool_t                       submitted = GLOBUS_FALSE;
+    GlobusXIOName(globus_l_xio_system_uring_submit);
+
+    GlobusXIOSystemDebugEnterFD(op_info->handle->fd);
+
+    globus_mutex_lock(&globus_l_xio_system_uring_lock);
+    {
+        sqe = globus_l_xio_system_uring_get_sqe();
+        if(sqe)
+        {
+            sqe->opcode = op_info->type == GLOBUS_I_XIO_SYSTEM_OP_READ
+                ? IORING_OP_READV
+                : IORING_OP_WRITEV;
+            sqe->fd = op_info->handle->fd;
+            sqe->addr = (uintptr_t) op_info->sop.data.iov;
+            sqe->len = op_info->sop.data.iovc;
+            sqe->off = op_info->offset;
+            sqe->user_data = (uintptr_t) op_info;
+
+            globus_l_xio_system_uring_push();
+            globus_l_xio_system_uring_in_flight++;
+            submitted = GLOBUS_TRUE;
+        }
+
+        globus_l_xio_system_uring_flush();
+    }
+    globus_mutex_unlock(&globus_l_xio_system_uring_lock);
+
+    GlobusXIOSystemDebugExitFD(op_info->handle->fd);
+    return submitted;
+}
+
+/*
+ * ask the kernel to cancel a submitted op.  the op is still kicked out from
+ * its own completion, which has res -ECANCELED if the cancel got to it in
+ * time.  the cancel's own completion carries user_data 0 and is ignored
+ */
+static
+void
+globus_l_xio_system_uring_cancel_cb(
+    globus_xio_operation_t              op,
+    void *                              user_arg,
+    globus_xio_error_type_t             reason)
+{
+    globus_i_xio_system_op_info_t *     op_info;
+    struct io_uring_sqe *               sqe;
+    GlobusXIOName(globus_l_xio_system_uring_cancel_cb);
+
+    GlobusXIOSystemDebugEnter();
+
+    op_info = (globus_i_xio_system_op_info_t *) user_arg;
+
+    globus_mutex_lock(&globus_l_xio_system_cancel_mutex);
+    {
+        if(op_info->state == GLOBUS_I_XIO_SYSTEM_OP_PENDING)
+        {
+            op_info->error = reason == GLOBUS_XIO_ERROR_TIMEOUT
+                ? GlobusXIOErrorObjTimeout()
+                : GlobusXIOErrorObjCanceled();
+            op_info->state = GLOBUS_I_XIO_SYSTEM_OP_CANCELED;
+
+            GlobusXIOSystemDebugPrintf(
+                GLOBUS_I_XIO_SYSTEM_DEBUG_INFO,
+                (_XIOSL("[%s] fd=%d, Canceling io_uring op\n"),
+                    _xio_name, op_info->handle->fd));
+
+            globus_mutex_lock(&globus_l_xio_system_uring_lock);
+            {
+                /* if the sq is full the op just runs to completion */
+                sqe = globus_l_xio_system_uring_get_sqe();
+                if(sqe)
+                {
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->fd = -1;
+                    sqe->addr = (uintptr_t) op_info;
+                    sqe->user_data = 0;
+
+                    globus_l_xio_system_uring_push();
+                }
+                globus_l_xio_system_uring_flush();
+            }
+            globus_mutex_unlock(&globus_l_xio_system_uring_lock);
+        }
+    }
+    globus_mutex_unlock(&globus_l_xio_system_cancel_mutex);
+
+    GlobusXIOSystemDebugExit();
+}
+
+/*
+ * account for one completion.  short transfers are resubmitted from where
+ * they left off, like the select path does with GlobusIXIOUtilAdjustIovec.
+ * a canceled op is kicked out with the error set by the cancel callback.
+ * returns true if the operation was kicked out
+ */
+static
+globus_bool_t
+globus_l_xio_system_uring_complete(
+    globus_i_xio_system_op_info_t *     op_info,
+    int                                 res)
+{
+    globus_result_t                     result;
+    GlobusXIOName(globus_l_xio_system_uring_complete);
+
+    GlobusXIOSystemDebugPrintf(
+        GLOBUS_I_XIO_SYSTEM_DEBUG_DATA,
+        (_XIOSL("[%s] fd=%d, res=%d\n"), _xio_name, op_info->handle->fd, res));
+
+    globus_mutex_lock(&globus_l_xio_system_cancel_mutex);
+    if(op_info->state == GLOBUS_I_XIO_SYSTEM_OP_CANCELED)
+    {
+        if(res > 0)
+        {
+            op_info->nbytes += res;
+        }
+    }
+    else if(res < 0)
+    {
+        op_info->error = GlobusXIOErrorObjSystemError(
+            op_info->type == GLOBUS_I_XIO_SYSTEM_OP_READ ? "readv" : "writev",
+            -res);
+    }
+    else if(res == 0 && op_info->type == GLOBUS_I_XIO_SYSTEM_OP_READ)
+    {
+        op_info->error = GlobusXIOErrorObjEOF();
+    }
+    else if(res == 0)
+    {
+        /* a write that makes no progress would be resubmitted forever */
+        op_info->error = GlobusXIOErrorObjSystemError("writev", EIO);
+    }
+    else
+    {
+        op_info->nbytes += res;
+        op_info->offset += res;
+        GlobusIXIOUtilAdjustIovec(
+            op_info->sop.data.iov, op_info->sop.data.iovc, res);
+
+        if(op_info->nbytes < op_info->waitforbytes)
+        {
+            if(globus_l_xio_system_uring_submit(op_info))
+            {
+                globus_mutex_unlock(&globus_l_xio_system_cancel_mutex);
+                return GLOBUS_FALSE;
+            }
+
+            op_info->error = globus_error_get(
+                GlobusXIOErrorSystemResource(
+                    _XIOSL("io_uring submission queue full")));
+        }
+    }
+
+    op_info->state = GLOBUS_I_XIO_SYSTEM_OP_COMPLETE;
+    globus_mutex_unlock(&globus_l_xio_system_cancel_mutex);
+
+    result = globus_callback_register_oneshot(
+        GLOBUS_NULL, GLOBUS_NULL, globus_l_xio_system_kickout, op_info);
+    /* really cant do anything else */
+    if(result != GLOBUS_SUCCESS)
+    {
+        globus_panic(
+            GLOBUS_XIO_SYSTEM_MODULE,
+            result,
+            _XIOSL("[%s:%d] Couldn't register callback"),
+            _xio_name,
+            __LINE__);
+    }
+
+    return GLOBUS_TRUE;
+}
+
+/* called from the poll callback when the eventfd fires */
+static
+globus_bool_t
+globus_l_xio_system_uring_reap(void)
+{
+    struct io_uring_cqe *               cqe;
+    globus_i_xio_system_op_info_t *     op_info;
+    unsigned                            head;
+    unsigned                            tail;
+    uint64_t                            count;
+    globus_ssize_t                      rc;
+    int                                 res;
+    int                                 reaped = 0;
+    globus_bool_t                       handled_something;
+    GlobusXIOName(globus_l_xio_system_uring_reap);
+
+    GlobusXIOSystemDebugEnter();
+
+    handled_something = GLOBUS_FALSE;
+
+    /* reset the counter before looking at the cq so nothing is missed */
+    do
+    {
+        rc = read(globus_l_xio_system_uring_eventfd, &count, sizeof(count));
+    } while(rc < 0 && errno == EINTR);
+
+    head = *globus_l_xio_system_uring_cq_head;
+    tail = __atomic_load_n(globus_l_xio_system_uring_cq_tail, __ATOMIC_ACQUIRE);
+    while(head != tail)
+    {
+        cqe = &globus_l_xio_system_uring_cqes[
+            head & globus_l_xio_system_uring_cq_mask];
+        op_info = (globus_i_xio_system_op_info_t *) (uintptr_t) cqe->user_data;
+        res = cqe->res;
+
+        head++;
+        __atomic_store_n(
+            globus_l_xio_system_uring_cq_head, head, __ATOMIC_RELEASE);
+
+        /* user_data 0 is the completion of a cancel request */
+        if(op_info != NULL)
+        {
+            /* a resubmitted op counts again */
+            reaped++;
+            if(globus_l_xio_system_uring_complete(op_info, res))
+            {
+                handled_something = GLOBUS_TRUE;
+            }
+        }
+
+        tail = __atomic_load_n(
+            globus_l_xio_system_uring_cq_tail, __ATOMIC_ACQUIRE);
+    }
+
+    globus_mutex_lock(&globus_l_xio_system_uring_lock);
+    {
+        globus_l_xio_system_uring_in_flight -= reaped;
+        globus_l_xio_system_uring_flush();
+    }
+    globus_mutex_unlock(&globus_l_xio_system_uring_lock);
+
+    GlobusXIOSystemDebugExit();
+    return handled_something;
+}
+#endif
+
+globus_result_t
+globus_xio_system_socket_register_connect(
+    globus_xio_operation_t              op,
+    globus_xio_system_socket_handle_t   handle,
+    globus_sockaddr_t *                 addr,
+    globus_xio_system_callback_t        callback,
+    void *                              user_arg)
+{
+    globus_bool_t                       done;
+    globus_result_t                     result;
+    globus_i_xio_system_op_info_t *     op_info;
+    int                                 fd = handle->fd;
+    GlobusXIOName(globus_xio_system_socket_register_connect);
+
+    GlobusXIOSystemDebugEnterFD(fd);
+
+    done = GLOBUS_FALSE;
+    while(!done && connect(
+        fd, (const struct sockaddr *) addr, GlobusLibcSockaddrLen(addr)) < 0)
+    {
+        GlobusXIOSystemUpdateErrno();
+        switch(errno)
+        {
+          case EINPROGRESS:
+            done = GLOBUS_TRUE;
+            break;
+
+          case EINTR:
+            /* retry */
+            break;
+
+          case ETIMEDOUT: /* this was in globus io.. not sure why */
+            globus_thread_yield();
+            break;
+
+          default:
+            result = GlobusXIOErrorSystemError("connect", errno);
+            goto error_connect;
+        }
+    }
+
+    GlobusIXIOSystemAllocOperation(op_info);
+    if(!op_info)
+    {
+        result = GlobusXIOErrorMemory("op_info");
+        goto error_op_info;
+    }
+
+    op_info->type = GLOBUS_I_XIO_SYSTEM_OP_CONNECT;
+    op_info->state = GLOBUS_I_XIO_SYSTEM_OP_NEW;
+    op_info->op = op;
+    op_info->handle = handle;
+    op_info->user_arg = user_arg;
+    op_info->sop.non_data.callback = callback;
+
+    result = globus_l_xio_system_register_write_fd(fd, op_info);
+
+    if(result != GLOBUS_SUCCESS)
+    {
+        result = GlobusXIOErrorWrapFailed(
+            _XIOSL("globus_l_xio_system_register_write_fd"), result);
+        goto error_register;
+
+    }
+    
+    /* handle could be destroyed by time we get here - no touch! */
+    GlobusXIOSystemDebugExitFD(fd);
+    return GLOBUS_SUCCESS;
+
+error_register:
+    GlobusIXIOSystemFreeOperation(op_info);
+
+error_op_info:
+error_connect:
+    GlobusXIOSystemDebugExitWithErrorFD(fd);
+    return result;
+}
+
+globus_result_t
+globus_xio_system_socket_register_accept(
+    globus_xio_operation_t              op,
+    globus_xio_system_socket_handle_t   listener_handle,
+    globus_xio_system_socket_t *        out_fd,
+    globus_xio_system_callback_t        callback,
+    void *                              user_arg)
+{
+    globus_result_t                     result;
+    globus_i_xio_system_op_info_t *     op_info;
+    int                                 fd = listener_handle->fd;
+    GlobusXIOName(globus_xio_system_socket_register_accept);
+
+    GlobusXIOSystemDebugEnterFD(fd);
+    
+    GlobusIXIOSystemAllocOperation(op_info);
+    if(!op_info)
+    {
+        result = GlobusXIOErrorMemory("op_info");
+        goto error_op_info;
+    }
+
+    op_info->type = GLOBUS_I_XIO_SYSTEM_OP_ACCEPT;
+    op_info->state = GLOBUS_I_XIO_SYSTEM_OP_NEW;
+    op_info->op = op;
+    op_info->handle = listener_handle;
+    op_info->user_arg = user_arg;
+    op_info->sop.non_data.callback = callback;
+    op_info->sop.non_data.out_fd = out_fd;
+    op_info->waitforbytes = 1;
+
+    result = globus_l_xio_system_register_read_fd(fd, op_info);
+
+    if(result != GLOBUS_SUCCESS)
+    {
+        result = GlobusXIOErrorWrapFailed(
+            _XIOSL("globus_l_xio_system_register_read_fd"), result);
+        goto error_register;
+    }
+    
+    /* handle could be destroyed by time we get here - no touch! */
+    GlobusXIOSystemDebugExitFD(fd);
+    return GLOBUS_SUCCESS;
+
+error_register:
+    GlobusIXIOSystemFreeOperation(op_info);
+
+error_op_info:
+    GlobusXIOSystemDebugExitWithErrorFD(fd);
+    return result;
+}
+
+static
+globus_result_t
+globus_l_xio_system_register_read(
+    globus_xio_operation_t              op,
+    globus_l_xio_system_t *             handle,
+    globus_off_t                        offset,
+    const globus_xio_iovec_t *          u_iov,
+    int                                 u_iovc,
+    globus_size_t                       waitforbytes,
+    int                                 flags,
+    globus_sockaddr_t *                 from,
+    globus_xio_system_data_callback_t   callback,
+    void *                              user_arg)
+{
+    globus_result_t                     result;
+    globus_i_xio_system_op_info_t *     op_info;
+    struct iovec *                      iov;
+    int                                 fd = handle->fd;
+    GlobusXIOName(globus_l_xio_system_register_read);
+
+    GlobusXIOSystemDebugEnterFD(fd);
+    GlobusXIOSystemDebugPrintf(
+        GLOBUS_I_XIO_SYSTEM_DEBUG_DATA,
+        (_XIOSL("[%s] Waiting for %u bytes\n"), _xio_name, (unsigned) waitforbytes));
         
     GlobusIXIOSystemAllocOperation(op_info);
     if(!op_info)
@@ -1609,6 +2969,34 @@ globus_l_xio_system_register_read(
     op_info->waitforbytes = waitforbytes;
     op_info->offset = offset;
     
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+    if(handle->uring && waitforbytes > 0)
+    {
+        op_info->state = GLOBUS_I_XIO_SYSTEM_OP_PENDING;
+        if(globus_xio_operation_enable_cancel(
+            op, globus_l_xio_system_uring_cancel_cb, op_info))
+        {
+            result = GlobusXIOErrorCanceled();
+            goto error_register;
+        }
+        if(globus_l_xio_system_uring_submit(op_info))
+        {
+            /* handle could be destroyed by time we get here - no touch! */
+            GlobusXIOSystemDebugExitFD(fd);
+            return GLOBUS_SUCCESS;
+        }
+        /* ring is backed up, wait for it the old fashioned way.  a cancel
+         * that came in meanwhile is picked up by register_read_fd */
+        globus_xio_operation_disable_cancel(op);
+        globus_mutex_lock(&globus_l_xio_system_cancel_mutex);
+        if(op_info->state == GLOBUS_I_XIO_SYSTEM_OP_PENDING)
+        {
+            op_info->state = GLOBUS_I_XIO_SYSTEM_OP_NEW;
+        }
+        globus_mutex_unlock(&globus_l_xio_system_cancel_mutex);
+    }
+#endif
+
     result = globus_l_xio_system_register_read_fd(fd, op_info);
     if(result != GLOBUS_SUCCESS)
     {
@@ -1738,6 +3126,34 @@ globus_l_xio_system_register_write(
     op_info->waitforbytes = waitforbytes;
     op_info->offset = offset;
     
+#ifdef GLOBUS_L_XIO_SYSTEM_URING
+    if(handle->uring && waitforbytes > 0)
+    {
+        op_info->state = GLOBUS_I_XIO_SYSTEM_OP_PENDING;
+        if(globus_xio_operation_enable_cancel(
+            op, globus_l_xio_system_uring_cancel_cb, op_info))
+        {
+            result = GlobusXIOErrorCanceled();
+            goto error_register;
+        }
+        if(globus_l_xio_system_uring_submit(op_info))
+        {
+            /* handle could be destroyed by time we get here - no touch! */
+            GlobusXIOSystemDebugExitFD(fd);
+            return GLOBUS_SUCCESS;
+        }
+        /* ring is backed up, wait for it the old fashioned way.  a cancel
+         * that came in meanwhile is picked up by register_write_fd */
+        globus_xio_operation_disable_cancel(op);
+        globus_mutex_lock(&globus_l_xio_system_cancel_mutex);
+        if(op_info->state == GLOBUS_I_XIO_SYSTEM_OP_PENDING)
+        {
+            op_info->state = GLOBUS_I_XIO_SYSTEM_OP_NEW;
+        }
+        globus_mutex_unlock(&globus_l_xio_system_cancel_mutex);
+    }
+#endif
+
     result = globus_l_xio_system_register_write_fd(fd, op_info);
     if(result != GLOBUS_SUCCESS)
     {
@@ -1810,6 +3226,102 @@ globus_xio_system_socket_register_write(
         user_arg);
 }
 
+globus_result_t
+globus_xio_system_socket_register_sendfile(
+    globus_xio_operation_t              op,
+    globus_xio_system_socket_handle_t   handle,
+    const globus_xio_iovec_t *          u_iov,
+    int                                 u_iovc,
+    globus_xio_system_file_t            file_fd,
+    globus_off_t                        file_offset,
+    globus_size_t                       file_length,
+    globus_xio_system_data_callback_t   callback,
+    void *                              user_arg)
+{
+    globus_result_t                     result;
+    globus_i_xio_system_op_info_t *     op_info;
+    struct iovec *                      iov;
+    globus_size_t                       iov_bytes;
+    int                                 fd = handle->fd;
+    GlobusXIOName(globus_xio_system_socket_register_sendfile);
+
+    GlobusXIOSystemDebugEnterFD(fd);
+    
+#if !defined(HAVE_SYS_SENDFILE_H) || !defined(HAVE_SENDFILE)
+    result = GlobusXIOErrorSystemError("sendfile", ENOSYS);
+    goto error_op_info;
+#endif
+
+    GlobusXIOUtilIovTotalLength(iov_bytes, u_iov, u_iovc);
+    GlobusXIOSystemDebugPrintf(
+        GLOBUS_I_XIO_SYSTEM_DEBUG_DATA,
+        (_XIOSL("[%s] Sending %u header bytes and %u bytes from fd %d\n"),
+            _xio_name, (unsigned) iov_bytes, (unsigned) file_length,
+            (int) file_fd));
+        
+    GlobusIXIOSystemAllocOperation(op_info);
+    if(!op_info)
+    {
+        result = GlobusXIOErrorMemory("op_info");
+        goto error_op_info;
+    }
+    
+    GlobusIXIOSystemAllocIovec(u_iovc, iov);
+    if(!iov)
+    {
+        result = GlobusXIOErrorMemory("iov");
+        goto error_iovec;
+    }
+
+    GlobusIXIOUtilTransferIovec(iov, u_iov, u_iovc);
+    
+    op_info->type = GLOBUS_I_XIO_SYSTEM_OP_SENDFILE;
+    op_info->sop.data.start_iov = iov;
+    op_info->sop.data.start_iovc = u_iovc;
+    op_info->sop.data.iov = iov;
+    op_info->sop.data.iovc = u_iovc;
+    op_info->sop.data.file_fd = file_fd;
+    op_info->sop.data.file_offset = file_offset;
+    op_info->sop.data.iov_bytes = iov_bytes;
+#ifdef MSG_MORE
+    /* keep the header in the same segment as the start of the payload */
+    if(file_length > 0)
+    {
+        op_info->sop.data.flags = MSG_MORE;
+    }
+#endif
+    
+    op_info->state = GLOBUS_I_XIO_SYSTEM_OP_NEW;
+    op_info->op = op;
+    op_info->handle = handle;
+    op_info->user_arg = user_arg;
+    op_info->sop.data.callback = callback;
+    op_info->waitforbytes = iov_bytes + file_length;
+    op_info->offset = -1;
+
+    result = globus_l_xio_system_register_write_fd(fd, op_info);
+    if(result != GLOBUS_SUCCESS)
+    {
+        result = GlobusXIOErrorWrapFailed(
+            "globus_l_xio_system_register_write_fd", result);
+        goto error_register;
+    }
+    
+    /* handle could be destroyed by time we get here - no touch! */
+    GlobusXIOSystemDebugExitFD(fd);
+    return GLOBUS_SUCCESS;
+
+error_register:
+    GlobusIXIOSystemFreeIovec(u_iovc, iov);
+
+error_iovec:
+    GlobusIXIOSystemFreeOperation(op_info);
+
+error_op_info:
+    GlobusXIOSystemDebugExitWithErrorFD(fd);
+    return result;
+}
+
 static
 globus_result_t
 globus_l_xio_system_try_read(
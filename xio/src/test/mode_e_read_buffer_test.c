@@ -0,0 +1,427 @@
+/*
+ * Copyright 1999-2014 University of Chicago
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "globus_common.h"
+#include "globus_xio.h"
+#include "globus_xio_mode_e_driver.h"
+
+/*
+ * This test program sends a pattern over a MODE E loopback connection with
+ * several streams and checks that every byte arrives once, at the offset it
+ * was sent from. The driver options, including the read buffer, are set
+ * with a driver string. The cases are:
+ *
+ * no_buffer:
+ *     Headers and payload are each read separately.
+ * split_header:
+ *     Small blocks in a buffer just bigger than a header, so most headers
+ *     arrive in two reads.
+ * scatter:
+ *     Blocks bigger than the buffer, read into several user iovecs (one of
+ *     them empty), so payload goes straight into the user's iovec.
+ * carry_over:
+ *     Many blocks fit in the buffer and each user read is smaller than a
+ *     block, so what is left of a block is delivered from the buffer by
+ *     the next read.
+ */
+#define TEST_DATA_SIZE (256 * 1024)
+#define TEST_MAX_IOVECS 4
+
+typedef struct
+{
+    const char *                        name;
+    const char *                        opts;
+    int                                 read_buffer_size;
+    globus_size_t                       block_size;
+    globus_size_t                       iovec_len[TEST_MAX_IOVECS];
+}
+mode_e_test_case_t;
+
+static globus_mutex_t                   mutex;
+static globus_cond_t                    cond;
+static globus_byte_t *                  send_data;
+static globus_size_t                    block_size;
+static int                              writes_left;
+static globus_bool_t                    client_done;
+static globus_result_t                  client_result;
+
+static
+void
+client_close_cb(
+    globus_xio_handle_t                 handle,
+    globus_result_t                     result,
+    void *                              user_arg)
+{
+    globus_mutex_lock(&mutex);
+    if (client_result == GLOBUS_SUCCESS)
+    {
+        client_result = result;
+    }
+    client_done = GLOBUS_TRUE;
+    globus_cond_signal(&cond);
+    globus_mutex_unlock(&mutex);
+}
+
+static
+void
+client_write_cb(
+    globus_xio_handle_t                 handle,
+    globus_result_t                     result,
+    globus_byte_t *                     buffer,
+    globus_size_t                       len,
+    globus_size_t                       nbytes,
+    globus_xio_data_descriptor_t        data_desc,
+    void *                              user_arg)
+{
+    globus_bool_t                       close;
+
+    globus_mutex_lock(&mutex);
+    if (client_result == GLOBUS_SUCCESS)
+    {
+        client_result = result;
+    }
+    close = (--writes_left == 0);
+    globus_mutex_unlock(&mutex);
+
+    if (close)
+    {
+        result = globus_xio_register_close(
+            handle, NULL, client_close_cb, NULL);
+        if (result != GLOBUS_SUCCESS)
+        {
+            client_close_cb(handle, result, NULL);
+        }
+    }
+}
+
+/* writes go out on whichever stream is free, so they arrive out of order */
+static
+void
+client_open_cb(
+    globus_xio_handle_t                 handle,
+    globus_result_t                     result,
+    void *                              user_arg)
+{
+    globus_size_t                       offset;
+    globus_size_t                       len;
+
+    if (result != GLOBUS_SUCCESS)
+    {
+        globus_mutex_lock(&mutex);
+        client_result = result;
+        client_done = GLOBUS_TRUE;
+        globus_cond_signal(&cond);
+        globus_mutex_unlock(&mutex);
+        return;
+    }
+    globus_mutex_lock(&mutex);
+    writes_left = (TEST_DATA_SIZE + block_size - 1) / block_size;
+    globus_mutex_unlock(&mutex);
+
+    for (offset = 0; offset < TEST_DATA_SIZE; offset += len)
+    {
+        len = TEST_DATA_SIZE - offset;
+        if (len > block_size)
+        {
+            len = block_size;
+        }
+        result = globus_xio_register_write(
+            handle,
+            send_data + offset,
+            len,
+            len,
+            NULL,
+            client_write_cb,
+            NULL);
+        if (result != GLOBUS_SUCCESS)
+        {
+            client_write_cb(handle, result, NULL, len, 0, NULL, NULL);
+        }
+    }
+}
+
+static
+int
+mode_e_loopback_test(
+    globus_xio_driver_t                 mode_e_driver,
+    globus_xio_stack_t                  stack,
+    const mode_e_test_case_t *          test)
+{
+    globus_xio_attr_t                   attr = NULL;
+    globus_xio_server_t                 server = NULL;
+    globus_xio_handle_t                 client = NULL;
+    globus_xio_handle_t                 handle = NULL;
+    globus_xio_data_descriptor_t        dd = NULL;
+    globus_xio_iovec_t                  iovec[TEST_MAX_IOVECS];
+    globus_byte_t *                     read_data = NULL;
+    globus_byte_t *                     recv_data = NULL;
+    char *                              received = NULL;
+    char *                              contact = NULL;
+    globus_off_t                        offset;
+    globus_size_t                       nbytes;
+    globus_size_t                       read_len;
+    globus_size_t                       total = 0;
+    globus_size_t                       i;
+    globus_size_t                       j;
+    globus_size_t                       k;
+    int                                 read_buffer_size;
+    globus_bool_t                       eof = GLOBUS_FALSE;
+    globus_result_t                     result;
+    int                                 rc = 1;
+
+    block_size = test->block_size;
+    client_done = GLOBUS_FALSE;
+    client_result = GLOBUS_SUCCESS;
+
+    result = globus_xio_attr_init(&attr);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+    result = globus_xio_attr_cntl(
+        attr, mode_e_driver, GLOBUS_XIO_SET_STRING_OPTIONS, test->opts);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+    result = globus_xio_attr_cntl(
+        attr, mode_e_driver, GLOBUS_XIO_MODE_E_GET_READ_BUFFER_SIZE,
+        &read_buffer_size);
+    if (result != GLOBUS_SUCCESS ||
+        read_buffer_size != test->read_buffer_size)
+    {
+        fprintf(stderr, "# %s: read_buffer not set by \"%s\"\n",
+            test->name, test->opts);
+        goto error;
+    }
+
+    read_len = 0;
+    for (i = 0; i < TEST_MAX_IOVECS; i++)
+    {
+        read_len += test->iovec_len[i];
+    }
+    recv_data = globus_malloc(TEST_DATA_SIZE);
+    received = globus_calloc(TEST_DATA_SIZE, 1);
+    read_data = globus_malloc(read_len);
+    if (!recv_data || !received || !read_data)
+    {
+        goto error;
+    }
+    for (i = 0, j = 0; i < TEST_MAX_IOVECS; i++)
+    {
+        iovec[i].iov_base = read_data + j;
+        iovec[i].iov_len = test->iovec_len[i];
+        j += test->iovec_len[i];
+    }
+
+    result = globus_xio_server_create(&server, attr, stack);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+    result = globus_xio_server_get_contact_string(server, &contact);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+    result = globus_xio_handle_create(&client, stack);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+    result = globus_xio_register_open(
+        client, contact, attr, client_open_cb, NULL);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error;
+    }
+    result = globus_xio_server_accept(&handle, server);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error_wait;
+    }
+    result = globus_xio_open(handle, NULL, attr);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error_wait;
+    }
+    result = globus_xio_data_descriptor_init(&dd, handle);
+    if (result != GLOBUS_SUCCESS)
+    {
+        goto error_wait;
+    }
+
+    while (!eof)
+    {
+        nbytes = 0;
+        result = globus_xio_readv(
+            handle, iovec, TEST_MAX_IOVECS, 1, &nbytes, dd);
+        if (result != GLOBUS_SUCCESS)
+        {
+            if (!globus_xio_error_is_eof(result))
+            {
+                goto error_wait;
+            }
+            eof = GLOBUS_TRUE;
+        }
+        if (nbytes == 0)
+        {
+            continue;
+        }
+        result = globus_xio_data_descriptor_cntl(
+            dd, NULL, GLOBUS_XIO_DD_GET_OFFSET, &offset);
+        if (result != GLOBUS_SUCCESS || offset < 0 ||
+            offset + nbytes > TEST_DATA_SIZE)
+        {
+            fprintf(stderr, "# %s: %lu bytes at bad offset %ld\n",
+                test->name, (unsigned long) nbytes, (long) offset);
+            goto error_wait;
+        }
+        /* a read is filled from one block, in iovec order */
+        for (i = 0, k = 0; i < TEST_MAX_IOVECS && k < nbytes; i++)
+        {
+            for (j = 0; j < iovec[i].iov_len && k < nbytes; j++, k++)
+            {
+                if (received[offset + k])
+                {
+                    fprintf(stderr, "# %s: offset %ld received twice\n",
+                        test->name, (long) (offset + k));
+                    goto error_wait;
+                }
+                received[offset + k] = 1;
+                recv_data[offset + k] = ((globus_byte_t *)
+                    iovec[i].iov_base)[j];
+            }
+        }
+        total += nbytes;
+    }
+
+    if (total != TEST_DATA_SIZE ||
+        memcmp(recv_data, send_data, TEST_DATA_SIZE) != 0)
+    {
+        fprintf(stderr, "# %s: received %lu of %d bytes, data %s\n",
+            test->name, (unsigned long) total, TEST_DATA_SIZE,
+            total == TEST_DATA_SIZE ? "differs" : "incomplete");
+        goto error_wait;
+    }
+    rc = 0;
+
+error_wait:
+    /* closing the server side makes any write still outstanding fail */
+    if (handle)
+    {
+        globus_xio_close(handle, NULL);
+    }
+    globus_mutex_lock(&mutex);
+    while (!client_done)
+    {
+        globus_cond_wait(&cond, &mutex);
+    }
+    globus_mutex_unlock(&mutex);
+    client = NULL;
+    if (client_result != GLOBUS_SUCCESS)
+    {
+        char * msg = globus_error_print_friendly(
+            globus_error_peek(client_result));
+        fprintf(stderr, "# %s: client: %s\n", test->name, msg);
+        free(msg);
+        rc = 1;
+    }
+error:
+    if (rc != 0 && result != GLOBUS_SUCCESS)
+    {
+        char * msg = globus_error_print_friendly(globus_error_peek(result));
+        fprintf(stderr, "# %s: %s\n", test->name, msg);
+        free(msg);
+    }
+    if (dd)
+    {
+        globus_xio_data_descriptor_destroy(dd);
+    }
+    if (client)
+    {
+        globus_xio_close(client, NULL);
+    }
+    if (server)
+    {
+        globus_xio_server_close(server);
+    }
+    if (attr)
+    {
+        globus_xio_attr_destroy(attr);
+    }
+    free(contact);
+    globus_free(read_data);
+    globus_free(received);
+    globus_free(recv_data);
+
+    return rc;
+}
+
+int main()
+{
+    /* a MODE E header is 17 bytes */
+    mode_e_test_case_t                  tests[] =
+    {
+        { "no_buffer", "streams=4", 0, 1000, { 4096 } },
+        { "split_header", "streams=2;read_buffer=40", 40, 10, { 4096 } },
+        { "scatter", "streams=4;read_buffer=64", 64, 5000,
+            { 7, 0, 1000, 3000 } },
+        { "carry_over", "streams=4;read_buffer=65536", 65536, 300,
+            { 100, 20 } }
+    };
+    globus_xio_driver_t                 mode_e_driver;
+    globus_xio_stack_t                  stack;
+    int                                 test_count;
+    int                                 failed = 0;
+    int                                 i;
+
+    test_count = (int) (sizeof(tests)/sizeof(tests[0]));
+    printf("1..%d\n", test_count);
+
+    globus_module_activate(GLOBUS_XIO_MODULE);
+    globus_mutex_init(&mutex, NULL);
+    globus_cond_init(&cond, NULL);
+
+    send_data = globus_malloc(TEST_DATA_SIZE);
+    for (i = 0; i < TEST_DATA_SIZE; i++)
+    {
+        send_data[i] = (globus_byte_t) (i * 7 + i / 251);
+    }
+
+    globus_xio_driver_load("mode_e", &mode_e_driver);
+    globus_xio_stack_init(&stack, NULL);
+    globus_xio_stack_push_driver(stack, mode_e_driver);
+
+    for (i = 0; i < test_count; i++)
+    {
+        if (mode_e_loopback_test(mode_e_driver, stack, &tests[i]) != 0)
+        {
+            printf("not ");
+            failed++;
+        }
+        printf("ok %d - %s\n", i + 1, tests[i].name);
+    }
+
+    globus_xio_stack_destroy(stack);
+    globus_xio_driver_unload(mode_e_driver);
+    globus_free(send_data);
+    globus_cond_destroy(&cond);
+    globus_mutex_destroy(&mutex);
+    globus_module_deactivate(GLOBUS_XIO_MODULE);
+
+    return failed;
+}